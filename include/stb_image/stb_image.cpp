@@ -1,2 +1,12 @@
+// Only PNG ships with the game; the other decoders would be dead code. stb_image's
+// SSE2 paths (JPEG only) stay at their default of on for x64 targets.
+#define STBI_ONLY_PNG
+
+// Decoder allocations go to the calling thread's ImageArena, when one is in scope
+#include "../../src/image_arena.h"
+#define STBI_MALLOC(size) imageMalloc(size)
+#define STBI_REALLOC_SIZED(p, oldSize, newSize) imageRealloc(p, oldSize, newSize)
+#define STBI_FREE(p) imageFree(p)
+
 #define STB_IMAGE_IMPLEMENTATION
-#include "stb_image.h"
\ No newline at end of file
+#include "stb_image.h"
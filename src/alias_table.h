@@ -0,0 +1,149 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+
+// Draws from a weighted choice of outcomes with the raw values of a batch sampled
+// together; the AVX2 path, picked on first use where the CPU has it, resolves eight
+// per step with gathers, the scalar one each in turn.
+typedef void (*AliasSampleFn)(const uint32_t *threshold, const uint32_t *alias, uint32_t n, const uint32_t *raw,
+                              uint32_t *out, size_t count);
+
+// One raw 32-bit value times n: the high half picks a bucket uniformly and the low
+// half, uniform in steps of n, is the coin tossed against the bucket's threshold
+inline uint32_t aliasSampleOne(const uint32_t *threshold, const uint32_t *alias, uint32_t n, uint32_t raw) {
+    uint64_t product = (uint64_t)raw * n;
+    uint32_t bucket = (uint32_t)(product >> 32);
+    return (uint32_t)product < threshold[bucket] ? bucket : alias[bucket];
+}
+
+inline void aliasSampleScalar(const uint32_t *threshold, const uint32_t *alias, uint32_t n, const uint32_t *raw,
+                              uint32_t *out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = aliasSampleOne(threshold, alias, n, raw[i]);
+    }
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+__attribute__((target("avx2")))
+inline void aliasSampleAvx2(const uint32_t *threshold, const uint32_t *alias, uint32_t n, const uint32_t *raw,
+                            uint32_t *out, size_t count) {
+    const __m256i vn = _mm256_set1_epi32((int)n), sign = _mm256_set1_epi32((int)0x80000000u);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        // 32x32 -> 64-bit products of the even and the odd lanes, recombined into the
+        // high halves (buckets) and the low halves (coins) of all eight
+        __m256i r = _mm256_loadu_si256((const __m256i *)(raw + i));
+        __m256i even = _mm256_mul_epu32(r, vn);
+        __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(r, 32), vn);
+        __m256i bucket = _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+        __m256i coin = _mm256_blend_epi32(even, _mm256_slli_epi64(odd, 32), 0xAA);
+        __m256i limit = _mm256_i32gather_epi32((const int *)threshold, bucket, 4);
+        __m256i other = _mm256_i32gather_epi32((const int *)alias, bucket, 4);
+        __m256i keep = _mm256_cmpgt_epi32(_mm256_xor_si256(limit, sign), _mm256_xor_si256(coin, sign)); // unsigned coin < limit
+        _mm256_storeu_si256((__m256i *)(out + i), _mm256_blendv_epi8(other, bucket, keep));
+    }
+    aliasSampleScalar(threshold, alias, n, raw + i, out + i, count - i);
+}
+#endif
+
+inline AliasSampleFn selectAliasSample() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    if (__builtin_cpu_supports("avx2")) {
+        return aliasSampleAvx2;
+    }
+#endif
+    return aliasSampleScalar;
+}
+
+// Walker's alias method, built with Vose's worklists: N outcomes with arbitrary
+// weights become N equally likely buckets, each holding its own outcome up to a
+// threshold and one other outcome (its alias) above it. A draw is then one raw
+// random value and one lookup, however skewed the weights, against the linear scan
+// or binary search a cumulative table costs. Building is O(N) and done once per set
+// of weights. Probabilities are kept as 32-bit fixed point, worked out in integers
+// so that equal weights fill every bucket exactly: a uniform table draws precisely
+// what Pcg32::below(raw, N) would, so a run seeded before weights existed replays
+// the same. Weights that are all zero (or negative) count as equal.
+template <int N>
+struct AliasTable {
+    static_assert(N > 0, "an alias table needs an outcome");
+    static constexpr uint64_t ONE = 1ull << 32; // a full bucket
+
+    uint32_t threshold[N]; // the coin below which a bucket keeps its own outcome
+    uint32_t alias[N];     // the outcome above it; a full bucket is its own alias
+    int possible = N;      // outcomes with a weight
+
+    AliasTable() {
+        for (int i = 0; i < N; i++) {
+            threshold[i] = UINT32_MAX;
+            alias[i] = (uint32_t)i;
+        }
+    }
+
+    explicit AliasTable(const float *weights) {
+        build(weights);
+    }
+
+    void build(const float *weights) {
+        double sum = 0.0;
+        possible = 0;
+        for (int i = 0; i < N; i++) {
+            sum += weights[i] > 0.0f ? weights[i] : 0.0f;
+            possible += weights[i] > 0.0f;
+        }
+        possible = possible > 0 ? possible : N;
+        // Each outcome's share of N full buckets, rounded, with the rounding's
+        // remainder given to the largest so the shares add up exactly
+        int64_t share[N];
+        int64_t total = 0;
+        int largest = 0;
+        for (int i = 0; i < N; i++) {
+            double w = sum > 0.0 ? (weights[i] > 0.0f ? weights[i] : 0.0f) : 1.0;
+            share[i] = (int64_t)(w * N * (double)ONE / (sum > 0.0 ? sum : N) + 0.5);
+            total += share[i];
+            largest = share[i] > share[largest] ? i : largest;
+        }
+        share[largest] += (int64_t)N * (int64_t)ONE - total;
+
+        // Pair each underfull bucket with an overfull outcome that tops it up
+        int small[N], large[N];
+        int smalls = 0, larges = 0;
+        for (int i = 0; i < N; i++) {
+            alias[i] = (uint32_t)i;
+            threshold[i] = UINT32_MAX;
+            (share[i] < (int64_t)ONE ? small[smalls++] : large[larges++]) = i;
+        }
+        while (smalls > 0 && larges > 0) {
+            int s = small[--smalls], l = large[larges - 1];
+            threshold[s] = (uint32_t)share[s];
+            alias[s] = (uint32_t)l;
+            share[l] -= (int64_t)ONE - share[s];
+            if (share[l] < (int64_t)ONE) {
+                larges--;
+                small[smalls++] = l;
+            }
+        }
+        // The shares add up exactly, so whatever is left is full and keeps its own outcome
+    }
+
+    // The outcome one raw 32-bit random value picks
+    uint32_t sample(uint32_t raw) const {
+        return aliasSampleOne(threshold, alias, N, raw);
+    }
+
+    // The outcomes count raw values pick, into out
+    void sample(const uint32_t *raw, uint32_t *out, size_t count) const {
+        static const AliasSampleFn impl = selectAliasSample();
+        impl(threshold, alias, N, raw, out, count);
+    }
+
+    // True when only one outcome can come out, so a draw can be skipped
+    bool certain() const {
+        return possible == 1;
+    }
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#include <execinfo.h>
+#endif
+#include "profiler.h"
+#include "shard_counters.h"
+
+// What the guard does with a heap allocation made while it is armed
+enum class AllocationGuardMode {
+    Off,    // not armed in the game loop; the benchmark still counts
+    Report, // print each frame that allocated and every new call site
+    Abort   // print the first offending call site and abort, for a debugger or crash dump
+};
+
+inline bool parseAllocationGuardMode(const char *name, AllocationGuardMode &mode) {
+    if (strcmp(name, "off") == 0 || strcmp(name, "0") == 0) mode = AllocationGuardMode::Off;
+    else if (strcmp(name, "report") == 0 || strcmp(name, "1") == 0) mode = AllocationGuardMode::Report;
+    else if (strcmp(name, "abort") == 0) mode = AllocationGuardMode::Abort;
+    else return false;
+    return true;
+}
+
+// Catches heap allocations in steady-state frames. The replaced global operator new
+// in game.cpp and stb_image's malloc fallbacks call record(), which counts every
+// allocation in the sharded counters (shard_counters.h); while the guard is disarmed
+// that and one relaxed load are all it does. Once the loop has warmed up it is
+// armed, and every allocation is also attributed to a call site: the return
+// addresses from the allocator up plus the profiler zone open on the thread. A
+// frame's counts are the growth of the sharded totals since the last. None of that
+// allocates itself; sites live in a fixed table, so a site past the SITE_SLOTS is
+// still counted, under the last slot. Plain malloc from other code is not hooked.
+struct AllocationGuard {
+    static constexpr int SITE_SLOTS = 64;
+    static constexpr int SITE_DEPTH = 8; // return addresses kept per site
+    static constexpr int REPORTED_FRAMES = 10; // frames printed in report mode; the rest only count
+
+    // One distinct call stack
+    struct Site {
+        void *frames[SITE_DEPTH];
+        int depth;
+        const char *zone;
+        uint64_t count, bytes;
+        bool printed;
+    };
+
+    AllocationGuardMode mode = AllocationGuardMode::Off;
+    std::atomic<bool> armed{false};
+    uint64_t countBefore = 0, bytesBefore = 0; // sharded totals when the frame began
+    Site sites[SITE_SLOTS] = {};
+    int siteCount = 0;
+    std::atomic_flag siteLock = ATOMIC_FLAG_INIT;
+    uint64_t totalCount = 0, totalBytes = 0; // every armed frame
+    uint64_t framesArmed = 0, framesAllocating = 0;
+
+    static bool &inGuard() {
+        static thread_local bool inside = false;
+        return inside;
+    }
+
+    // Start counting. The first stack capture loads the unwinder, which may allocate,
+    // so it is done here rather than in the first counted allocation.
+    void arm() {
+        void *frames[SITE_DEPTH];
+        captureStack(frames);
+        countBefore = counters.total(COUNTER_ALLOCATIONS);
+        bytesBefore = counters.total(COUNTER_ALLOCATED_BYTES);
+        armed.store(true, std::memory_order_release);
+    }
+
+    void disarm() {
+        armed.store(false, std::memory_order_release);
+    }
+
+    // Called by the allocator for every allocation of size bytes. Not inlined, so the
+    // stack always has the same frames above the caller.
+    __attribute__((noinline)) void record(size_t size) {
+        counters.add(COUNTER_ALLOCATIONS);
+        counters.add(COUNTER_ALLOCATED_BYTES, size);
+        if (!armed.load(std::memory_order_relaxed) || inGuard()) {
+            return;
+        }
+        inGuard() = true;
+        void *frames[SITE_DEPTH];
+        int depth = captureStack(frames);
+        Site &site = addSite(frames, depth, profiler.activeZone(), size);
+        if (mode == AllocationGuardMode::Abort) {
+            std::fprintf(stderr, "Heap allocation of %zu bytes in a steady-state frame\n", size);
+            printSite(site);
+            std::fflush(stderr);
+            std::abort();
+        }
+        inGuard() = false;
+    }
+
+    // Close an armed frame: take its counts from the sharded totals and,
+    // in report mode, print the frame and any call site not printed before
+    void endFrame(uint64_t frame) {
+        if (!armed.load(std::memory_order_relaxed)) {
+            return;
+        }
+        ShardedCounters::Totals now = counters.totals();
+        uint64_t count = now[COUNTER_ALLOCATIONS] - countBefore, bytes = now[COUNTER_ALLOCATED_BYTES] - bytesBefore;
+        countBefore = now[COUNTER_ALLOCATIONS];
+        bytesBefore = now[COUNTER_ALLOCATED_BYTES];
+        framesArmed++;
+        totalCount += count;
+        totalBytes += bytes;
+        if (count == 0) {
+            return;
+        }
+        framesAllocating++;
+        if (mode == AllocationGuardMode::Report && framesAllocating <= REPORTED_FRAMES) {
+            std::fprintf(stderr, "frame %llu: %llu heap allocations, %llu bytes\n", (unsigned long long)frame,
+                         (unsigned long long)count, (unsigned long long)bytes);
+            lockSites();
+            for (int i = 0; i < siteCount; i++) {
+                if (!sites[i].printed) {
+                    printSite(sites[i]);
+                    sites[i].printed = true;
+                }
+            }
+            siteLock.clear(std::memory_order_release);
+        }
+    }
+
+    // Totals over every armed frame, then the call sites by allocation count
+    void printSummary(FILE *out = stdout) {
+        std::fprintf(out, "steady heap: %llu allocations, %llu bytes in %llu of %llu frames\n",
+                     (unsigned long long)totalCount, (unsigned long long)totalBytes,
+                     (unsigned long long)framesAllocating, (unsigned long long)framesArmed);
+        lockSites();
+        bool shown[SITE_SLOTS] = {};
+        for (int n = 0; n < siteCount; n++) {
+            int best = -1;
+            for (int i = 0; i < siteCount; i++) {
+                if (!shown[i] && (best < 0 || sites[i].count > sites[best].count)) {
+                    best = i;
+                }
+            }
+            shown[best] = true;
+            printSite(sites[best], out);
+        }
+        siteLock.clear(std::memory_order_release);
+    }
+
+    void lockSites() {
+        while (siteLock.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    // The site with this stack and zone, made if new; the last slot takes the overflow
+    Site &addSite(void *const *frames, int depth, const char *zone, size_t size) {
+        lockSites();
+        Site *site = nullptr;
+        for (int i = 0; i < siteCount && !site; i++) {
+            Site &s = sites[i];
+            if (s.depth == depth && s.zone == zone && std::memcmp(s.frames, frames, depth * sizeof(void*)) == 0) {
+                site = &s;
+            }
+        }
+        if (!site) {
+            site = &sites[siteCount < SITE_SLOTS ? siteCount++ : SITE_SLOTS - 1];
+            if (site->count == 0) {
+                std::memcpy(site->frames, frames, depth * sizeof(void*));
+                site->depth = depth;
+                site->zone = zone;
+            }
+        }
+        site->count++;
+        site->bytes += size;
+        siteLock.clear(std::memory_order_release);
+        return *site;
+    }
+
+    // Return addresses from the allocator up, skipping this function and record();
+    // the allocator's own frame is kept, as it may have been inlined into its caller
+    __attribute__((noinline)) static int captureStack(void **frames) {
+        const int SKIP = 2;
+#ifdef _WIN32
+        return RtlCaptureStackBackTrace(SKIP, SITE_DEPTH, frames, nullptr);
+#else
+        void *all[SITE_DEPTH + SKIP];
+        int depth = backtrace(all, SITE_DEPTH + SKIP) - SKIP;
+        depth = depth < 0 ? 0 : depth;
+        std::memcpy(frames, all + SKIP, depth * sizeof(void*));
+        return depth;
+#endif
+    }
+
+    // One line per site: counts, profiler zone and each frame as module+offset from
+    // the loaded base, so ASLR does not matter. addr2line -f -C -e game.exe resolves
+    // offset plus the preferred image base (0x140000000 for a 64-bit MinGW build).
+    static void printSite(const Site &site, FILE *out = stderr) {
+        std::fprintf(out, "  %llu allocations, %llu bytes in %s:", (unsigned long long)site.count,
+                     (unsigned long long)site.bytes, site.zone ? site.zone : "(no zone)");
+        for (int i = 0; i < site.depth; i++) {
+            printFrame(site.frames[i], out);
+        }
+        std::fprintf(out, "\n");
+    }
+
+    // One return address as " module+offset"
+    static void printFrame(void *frame, FILE *out) {
+        char text[96];
+        formatFrame(frame, text, sizeof(text));
+        std::fprintf(out, " %s", text);
+    }
+
+    // One return address as "module+offset", into text
+    static void formatFrame(void *frame, char *text, size_t size) {
+        char module[64] = "?";
+        uintptr_t base = 0;
+#ifdef _WIN32
+        HMODULE handle = nullptr;
+        if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                               (LPCSTR)frame, &handle)) {
+            char path[MAX_PATH];
+            DWORD length = GetModuleFileNameA(handle, path, MAX_PATH);
+            const char *file = path + length;
+            while (file > path && file[-1] != '\\' && file[-1] != '/') {
+                file--;
+            }
+            std::snprintf(module, sizeof(module), "%s", file);
+            base = (uintptr_t)handle;
+        }
+#else
+        Dl_info info;
+        if (dladdr(frame, &info) && info.dli_fname) {
+            const char *file = std::strrchr(info.dli_fname, '/');
+            std::snprintf(module, sizeof(module), "%s", file ? file + 1 : info.dli_fname);
+            base = (uintptr_t)info.dli_fbase;
+        }
+#endif
+        std::snprintf(text, size, "%s+0x%llx", module, (unsigned long long)((uintptr_t)frame - base));
+    }
+};
+
+inline AllocationGuard allocationGuard;
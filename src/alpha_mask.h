@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "collision_kernel.h"
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+
+// 1-bit opacity of a sprite at the size it collides at, one bit per screen pixel:
+// bit c of row r is set where the texel drawn at column c of row r, counted from the
+// sprite's top-left, is at least half opaque. A row is one 64-bit word, so a mask
+// covers up to 64x64 pixels, and two masks share an opaque pixel where some row of
+// one ANDed with the matching row of the other, shifted by their horizontal offset,
+// is non-zero. Narrow phase only: pairs reach it after their boxes have met.
+struct AlphaMask {
+    static const int MAX_SIZE = 64;
+    static const unsigned char OPAQUE = 128; // alpha from which a texel is solid
+
+    int width = 0, height = 0; // pixels; 0 until built
+    alignas(16) uint64_t rows[MAX_SIZE] = {};
+
+    bool empty() const {
+        return width == 0;
+    }
+
+    // The part of rect (xy = offset, zw = scale) holding the mask's opaque pixels;
+    // all of rect for an empty or fully clear mask
+    glm::vec4 opaqueBounds(const glm::vec4 &rect) const {
+        int left = width, right = 0, top = height, bottom = 0;
+        for (int r = 0; r < height; r++) {
+            if (rows[r]) {
+                left = std::min(left, __builtin_ctzll(rows[r]));
+                right = std::max(right, 64 - __builtin_clzll(rows[r]));
+                top = std::min(top, r);
+                bottom = r + 1;
+            }
+        }
+        if (left >= right) {
+            return rect;
+        }
+        return glm::vec4(rect.x + rect.z * left / width, rect.y + rect.w * top / height,
+                         rect.z * (right - left) / width, rect.w * (bottom - top) / height);
+    }
+
+    // Sample the source rect of an alpha plane (one byte per texel, stride texels per
+    // row) at w x h pixels, taking the texel under each pixel centre
+    void build(const unsigned char *alpha, int stride, int srcX, int srcY, int srcW, int srcH, int w, int h) {
+        width = std::min(std::max(w, 0), MAX_SIZE);
+        height = std::min(std::max(h, 0), MAX_SIZE);
+        for (int r = 0; r < MAX_SIZE; r++) {
+            rows[r] = 0;
+            if (r >= height) {
+                continue;
+            }
+            int sy = srcY + std::min((int)((r + 0.5f) * srcH / height), srcH - 1);
+            for (int c = 0; c < width; c++) {
+                int sx = srcX + std::min((int)((c + 0.5f) * srcW / width), srcW - 1);
+                if (alpha[(size_t)sy * stride + sx] >= OPAQUE) {
+                    rows[r] |= 1ull << c;
+                }
+            }
+        }
+    }
+};
+
+// Whether b, placed with its top-left dx pixels right of and dy pixels below a's,
+// shares an opaque pixel with a. SSE2 ANDs two rows per step; shifting by one count
+// for both lanes needs nothing wider, so there is no AVX path.
+inline bool masksOverlapScalar(const AlphaMask &a, const AlphaMask &b, int dx, int dy) {
+    if (dx <= -AlphaMask::MAX_SIZE || dx >= AlphaMask::MAX_SIZE) {
+        return false;
+    }
+    int end = std::min(a.height, b.height + dy);
+    uint64_t hit = 0;
+    for (int r = std::max(dy, 0); r < end; r++) {
+        uint64_t row = b.rows[r - dy];
+        hit |= a.rows[r] & (dx >= 0 ? row << dx : row >> -dx);
+    }
+    return hit != 0;
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+inline bool masksOverlapSse2(const AlphaMask &a, const AlphaMask &b, int dx, int dy) {
+    if (dx <= -AlphaMask::MAX_SIZE || dx >= AlphaMask::MAX_SIZE) {
+        return false;
+    }
+    int r = std::max(dy, 0), end = std::min(a.height, b.height + dy);
+    const __m128i count = _mm_cvtsi32_si128(dx >= 0 ? dx : -dx);
+    __m128i hit = _mm_setzero_si128();
+    for (; r + 2 <= end; r += 2) {
+        __m128i row = _mm_loadu_si128((const __m128i *)&b.rows[r - dy]);
+        row = dx >= 0 ? _mm_sll_epi64(row, count) : _mm_srl_epi64(row, count);
+        hit = _mm_or_si128(hit, _mm_and_si128(_mm_loadu_si128((const __m128i *)&a.rows[r]), row));
+    }
+    uint64_t lanes[2];
+    _mm_storeu_si128((__m128i *)lanes, hit);
+    if (r < end) {
+        uint64_t row = b.rows[r - dy];
+        lanes[0] |= a.rows[r] & (dx >= 0 ? row << dx : row >> -dx);
+    }
+    return (lanes[0] | lanes[1]) != 0;
+}
+#endif
+
+inline bool masksOverlap(const AlphaMask &a, const AlphaMask &b, int dx, int dy) {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    return masksOverlapSse2(a, b, dx, dy);
+#else
+    return masksOverlapScalar(a, b, dx, dy);
+#endif
+}
+
+// Swept narrow phase for two masks centred offset apart (b minus a, y up) at the start
+// of the tick and closing by move over it: the part of the tick their boxes overlap is
+// sampled about a pixel of relative motion apart, and any sample where the masks
+// share a pixel is a hit
+inline bool sweptMasksOverlap(const AlphaMask &a, const AlphaMask &b, float offsetX, float offsetY, float moveX,
+                              float moveY) {
+    const int MAX_SAMPLES = 64;
+    float enter, exit;
+    sweptInterval(offsetX, offsetY, moveX, moveY, (a.width + b.width) / 2.0f, (a.height + b.height) / 2.0f, enter,
+                  exit);
+    if (enter >= exit) {
+        return false;
+    }
+    float span = exit - enter;
+    float travel = std::max(std::fabs(moveX), std::fabs(moveY)) * span;
+    int samples = std::min(std::max((int)std::ceil(travel), 1), MAX_SAMPLES);
+    for (int k = 0; k < samples; k++) {
+        float t = enter + (k + 0.5f) / samples * span;
+        int dx = (int)std::lround(offsetX + moveX * t - (b.width - a.width) / 2.0f);
+        int dy = (int)std::lround((a.height - b.height) / 2.0f - (offsetY + moveY * t));
+        if (masksOverlap(a, b, dx, dy)) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// Compile-time archetype definitions over EntityPool's runtime ones. A component is
+// a tag type carrying its EntityPool bit (0 for render-only traits the pool never
+// queries, like rotating); an archetype is its pool id and a list of tags. Systems
+// take the archetype as a template parameter and test tags with if constexpr, so
+// each archetype's range gets its own loop with the branches it does not need
+// compiled out, and no dispatch happens per entity. ArchetypeList::masks() hands
+// the same definitions to EntityPool::setArchetypes, so the two cannot disagree.
+template <uint8_t Id, typename... Components>
+struct ArchetypeDef {
+    static constexpr uint8_t ID = Id;
+    static constexpr uint32_t MASK = (Components::BIT | ... | 0u);
+
+    template <typename Component>
+    static constexpr bool has = (std::is_same_v<Component, Components> || ...);
+};
+
+template <typename... Archetypes>
+struct ArchetypeList {
+    static constexpr size_t COUNT = sizeof...(Archetypes);
+
+    static constexpr bool inIdOrder() {
+        uint8_t ids[] = {Archetypes::ID...};
+        for (size_t i = 0; i < COUNT; i++) {
+            if (ids[i] != i) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Component masks in pool order
+    static std::vector<uint32_t> masks() {
+        static_assert(inIdOrder(), "archetypes must be listed in ID order");
+        return {Archetypes::MASK...};
+    }
+
+    // fn.template operator()<Archetype>() for every archetype, in pool order
+    template <typename Fn>
+    static void forEach(Fn &&fn) {
+        (fn.template operator()<Archetypes>(), ...);
+    }
+};
@@ -0,0 +1,229 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <stb_image.h>
+#include "asset_pack.h"
+#include "generational_handle.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "image_arena.h"
+#include "memory_stats.h"
+#include "premultiplied_alpha.h"
+#include "sampler_cache.h"
+#include "texture_format.h"
+
+// Generational handle to a texture owned by the AssetManager; stays valid across hot
+// reloads, though the GL name behind it may not, so look it up with texture() rather
+// than keeping it. Once the texture is released it looks up as 0, even after its
+// slot went to another file.
+typedef uint32_t TextureHandle;
+static const TextureHandle INVALID_TEXTURE = 0xFFFFFFFFu;
+
+// Interns texture paths so every caller asking for the same file shares one GL
+// texture, refcounted and deleted when the last user releases it. Files can also be
+// watched: pollChanges() compares modification times (at most every POLL_INTERVAL)
+// and re-uploads changed textures, or runs the callback registered for a watched
+// file. Hot reload is meant for dev builds. Storage is immutable with exactly the
+// levels the mip policy needs, in textureFormat's sized format: a reload of the same
+// size and format writes into the existing name, anything else gets a new one.
+// Textures carry no filtering of their own beyond their level count; draws pick it
+// with a sampler, and only callers that sample with a mipmapped filter ask for mips.
+struct AssetManager {
+    struct Texture {
+        std::string path; // normalised; empty while the slot is free
+        GLuint texID = 0;
+        int width = 0, height = 0;
+        int levels = 0;
+        GLenum format = 0;
+        int refs = 0;
+        MipPolicy mips = MIPS_NONE;
+        uint32_t generation = 0; // of the slot, bumped when the texture is released
+    };
+
+    // A file whose changes trigger a reload
+    struct Watch {
+        std::string path;
+        std::filesystem::file_time_type stamp;
+        TextureHandle texture; // re-uploaded in place, or INVALID_TEXTURE
+        std::function<void()> changed; // called after a change, if set
+    };
+
+    static constexpr double POLL_INTERVAL = 0.5; // seconds between modification checks
+
+    std::vector<Texture> textures;
+    std::vector<uint32_t> freeSlots;
+    std::map<std::string, TextureHandle> byPath;
+    std::vector<Watch> watches;
+    std::chrono::steady_clock::time_point lastPoll;
+    int reloads = 0;
+    ImageArena arena; // decoder scratch, reset after every upload
+
+    static std::string normalise(const std::string &path) {
+        std::error_code ec;
+        std::filesystem::path p = std::filesystem::weakly_canonical(path, ec);
+        return (ec ? std::filesystem::path(path).lexically_normal() : p).generic_string();
+    }
+
+    // Shared texture for a file, loading it on first use; INVALID_TEXTURE if it fails.
+    // A later caller asking for mips on a texture loaded without them upgrades it.
+    TextureHandle acquire(const std::string &path, MipPolicy mips = MIPS_NONE) {
+        std::string key = normalise(path);
+        auto it = byPath.find(key);
+        if (it != byPath.end()) {
+            Texture &t = textures[handleIndex(it->second)];
+            t.refs++;
+            if (mips == MIPS_GENERATE && t.mips == MIPS_NONE) {
+                t.mips = mips;
+                upload(t);
+            }
+            return it->second;
+        }
+
+        uint32_t slot;
+        if (!freeSlots.empty()) {
+            slot = freeSlots.back();
+            freeSlots.pop_back();
+        } else {
+            slot = (uint32_t)textures.size();
+            textures.emplace_back();
+        }
+        Texture &t = textures[slot];
+        TextureHandle handle = makeHandle(slot, t.generation);
+        t.path = key;
+        t.refs = 1;
+        t.mips = mips;
+        if (!upload(t)) {
+            freeSlot(slot);
+            return INVALID_TEXTURE;
+        }
+        byPath[key] = handle;
+        watch(key, handle, nullptr);
+        return handle;
+    }
+
+    // Drop one reference; the GL texture is deleted with the last one
+    void release(TextureHandle handle) {
+        if (!live(handle) || --textures[handleIndex(handle)].refs > 0) {
+            return;
+        }
+        Texture &t = textures[handleIndex(handle)];
+        for (size_t i = watches.size(); i-- > 0;) {
+            if (watches[i].texture == handle) {
+                watches.erase(watches.begin() + i);
+            }
+        }
+        byPath.erase(t.path);
+        memoryStats.untrackGl(GL_TEXTURE, t.texID);
+        glState.deleteTextures(1, &t.texID);
+        freeSlot(handleIndex(handle));
+    }
+
+    // Empty a slot for reuse under the next generation
+    void freeSlot(uint32_t slot) {
+        uint32_t generation = textures[slot].generation + 1;
+        textures[slot] = Texture();
+        textures[slot].generation = generation;
+        freeSlots.push_back(slot);
+    }
+
+    // False for INVALID_TEXTURE and for handles whose texture was released
+    bool live(TextureHandle handle) const {
+        uint32_t slot = handleIndex(handle);
+        return slot < textures.size() && makeHandle(slot, textures[slot].generation) == handle;
+    }
+
+    GLuint texture(TextureHandle handle) const {
+        return live(handle) ? textures[handleIndex(handle)].texID : 0;
+    }
+
+    // Watch a file: reload a texture in place and/or run a callback when it changes
+    void watch(const std::string &path, TextureHandle texture, std::function<void()> changed) {
+        std::error_code ec;
+        Watch w = {normalise(path), std::filesystem::last_write_time(path, ec), texture, std::move(changed)};
+        watches.push_back(std::move(w));
+    }
+
+    // Check watched files for changes, at most every POLL_INTERVAL; render thread only
+    void pollChanges() {
+        auto now = std::chrono::steady_clock::now();
+        if (std::chrono::duration<double>(now - lastPoll).count() < POLL_INTERVAL) {
+            return;
+        }
+        lastPoll = now;
+        for (Watch &w : watches) {
+            std::error_code ec;
+            auto stamp = std::filesystem::last_write_time(w.path, ec);
+            if (ec || stamp == w.stamp) {
+                continue;
+            }
+            w.stamp = stamp;
+            if (live(w.texture) && upload(textures[handleIndex(w.texture)])) {
+                reloads++;
+                std::cout << "Reloaded " << w.path << std::endl;
+            }
+            if (w.changed) {
+                w.changed();
+            }
+        }
+    }
+
+    // Delete every texture still held; must run while the context is still current
+    void releaseAll() {
+        for (Texture &t : textures) {
+            if (t.texID) {
+                memoryStats.untrackGl(GL_TEXTURE, t.texID);
+                glState.deleteTextures(1, &t.texID);
+            }
+        }
+        textures.clear();
+        freeSlots.clear();
+        byPath.clear();
+        watches.clear();
+    }
+
+    // Decode the file (or its copy in the asset pack) into the texture, reallocating
+    // its storage if it no longer fits
+    bool upload(Texture &t) {
+        ImageArenaScope scope(arena);
+        int width, height;
+        unsigned char *data = loadImage(t.path, &width, &height);
+        if (!data) {
+            arena.reset();
+            std::cout << "Failed to load texture " << t.path << std::endl;
+            return false;
+        }
+        premultiplyAlpha(data, (size_t)width * height);
+        int levels = t.mips == MIPS_GENERATE ? fullMipLevels(width, height) : 1;
+        GLenum format = textureFormat.choose(data, (size_t)width * height);
+        if (!t.texID || width != t.width || height != t.height || levels != t.levels || format != t.format) {
+            if (t.texID) {
+                memoryStats.untrackGl(GL_TEXTURE, t.texID);
+                glState.deleteTextures(1, &t.texID);
+            }
+            t.texID = createTexture2D();
+            t.width = width;
+            t.height = height;
+            t.levels = levels;
+            t.format = format;
+            textureParameter(t.texID, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST);
+            textureParameter(t.texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            textureStorage2D(t.texID, levels, format, width, height);
+            memoryStats.trackGl(GL_TEXTURE, t.texID, MEM_TEXTURES,
+                                textureBytes(width, height, TextureFormat::bytesPerTexel(format), levels));
+        }
+        textureSubImage2D(t.texID, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+        if (levels > 1) {
+            generateMipmap(t.texID);
+        }
+        stbi_image_free(data);
+        arena.reset(); // GL has its own copy now
+        return true;
+    }
+};
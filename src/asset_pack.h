@@ -0,0 +1,315 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "image_decoder.h"
+#include "mapped_file.h"
+
+// Single-file archive of the game's assets written by the pack tool (pack_assets.cpp)
+// and memory-mapped at startup, so loading is one open however many files it holds.
+// Layout, all little-endian:
+//
+//   PackHeader
+//   PackEntry[entryCount]  table of contents, looked up by file name
+//   entry data, each entry starting on a 16-byte boundary
+//
+// Stored entries are read in place: a baked atlas opens from the mapping as it
+// would from its own file, and PNGs decode (image_decoder.h) straight from it without
+// a copy. An entry the tool found worth compressing (a baked RGBA8 atlas, say)
+// is inflated on its first read into a buffer the pack keeps until it closes.
+static const char PACK_MAGIC[4] = {'S', 'P', 'A', 'K'};
+static const uint32_t PACK_VERSION = 1;
+static const uint64_t PACK_ALIGNMENT = 16; // at least BakedTexture's 8
+
+enum PackCompression : uint32_t {
+    PACK_STORED = 0,
+    PACK_LZ = 1 // byte-oriented LZ77, see compressLz()
+};
+
+struct PackHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t entryCount;
+    uint32_t reserved;
+};
+
+struct PackEntry {
+    char name[48];        // file name, NUL-terminated
+    uint64_t offset;      // from the start of the file
+    uint64_t bytes;       // as stored
+    uint64_t size;        // once inflated; equal to bytes when stored
+    uint32_t compression; // PackCompression
+    uint32_t reserved;
+};
+
+// One file ready to pack; used by the pack tool
+struct PackFile {
+    std::string name;
+    std::vector<unsigned char> bytes; // as stored
+    uint64_t size = 0;                // of the original
+    PackCompression compression = PACK_STORED;
+};
+
+// LZ77 in sequences of a token byte (literal count in the high nibble, match length
+// minus 4 in the low, 15 meaning more follow in bytes of 255 and a remainder), the
+// literals, and a 16-bit offset back into the output. The last sequence is literals
+// only. Greedy, with one hash slot per 4-byte prefix: fast rather than small.
+inline std::vector<unsigned char> compressLz(const unsigned char *src, size_t size) {
+    static const size_t MIN_MATCH = 4, WINDOW = 65535;
+    std::vector<unsigned char> out;
+    out.reserve(size / 2 + 16);
+    auto length = [&out](size_t n) {
+        for (; n >= 255; n -= 255) {
+            out.push_back(255);
+        }
+        out.push_back((unsigned char)n);
+    };
+    auto sequence = [&](size_t literalStart, size_t literals, size_t offset, size_t match) {
+        size_t extra = match ? match - MIN_MATCH : 0;
+        out.push_back((unsigned char)((literals < 15 ? literals : 15) << 4 | (extra < 15 ? extra : 15)));
+        if (literals >= 15) {
+            length(literals - 15);
+        }
+        out.insert(out.end(), src + literalStart, src + literalStart + literals);
+        if (match) {
+            out.push_back((unsigned char)offset);
+            out.push_back((unsigned char)(offset >> 8));
+            if (extra >= 15) {
+                length(extra - 15);
+            }
+        }
+    };
+    std::vector<uint32_t> table(1 << 16, 0); // position + 1 of the last prefix with this hash
+    size_t anchor = 0, i = 0;
+    while (i + MIN_MATCH <= size && i < UINT32_MAX) {
+        uint32_t prefix;
+        std::memcpy(&prefix, src + i, 4);
+        uint32_t hash = (prefix * 2654435761u) >> 16;
+        size_t candidate = table[hash];
+        table[hash] = (uint32_t)(i + 1);
+        if (candidate && i - (candidate - 1) <= WINDOW && std::memcmp(src + candidate - 1, src + i, 4) == 0) {
+            size_t from = candidate - 1, match = MIN_MATCH;
+            while (i + match < size && src[from + match] == src[i + match]) {
+                match++;
+            }
+            sequence(anchor, i - anchor, i - from, match);
+            i += match;
+            anchor = i;
+        } else {
+            i++;
+        }
+    }
+    sequence(anchor, size - anchor, 0, 0);
+    return out;
+}
+
+// Inflate compressLz() output into exactly size bytes at dst; false if it is malformed
+inline bool decompressLz(const unsigned char *src, size_t srcSize, unsigned char *dst, size_t size) {
+    const unsigned char *in = src, *end = src + srcSize;
+    unsigned char *out = dst, *outEnd = dst + size;
+    auto length = [&in, end](size_t &n) {
+        for (unsigned char b = 255; b == 255;) {
+            if (in == end) {
+                return false;
+            }
+            b = *in++;
+            n += b;
+        }
+        return true;
+    };
+    while (in < end) {
+        unsigned char token = *in++;
+        size_t literals = token >> 4;
+        if (literals == 15 && !length(literals)) {
+            return false;
+        }
+        if ((size_t)(end - in) < literals || (size_t)(outEnd - out) < literals) {
+            return false;
+        }
+        std::memcpy(out, in, literals);
+        in += literals;
+        out += literals;
+        if (in == end) {
+            break; // the last sequence
+        }
+        if (end - in < 2) {
+            return false;
+        }
+        size_t offset = (size_t)in[0] | (size_t)in[1] << 8;
+        in += 2;
+        size_t match = token & 15;
+        if (match == 15 && !length(match)) {
+            return false;
+        }
+        match += 4;
+        if (offset == 0 || offset > (size_t)(out - dst) || (size_t)(outEnd - out) < match) {
+            return false;
+        }
+        const unsigned char *from = out - offset;
+        for (size_t b = 0; b < match; b++) {
+            out[b] = from[b]; // byte by byte: a match may overlap its own output
+        }
+        out += match;
+    }
+    return out == outEnd;
+}
+
+// Read-only view of a mapped pack; entry pointers stay valid while it is open. Reads
+// may come from any thread.
+struct AssetPack {
+    static constexpr const char *FILE_NAME = "assets.pak"; // looked for in the texture directory
+
+    MappedFile file;
+    const PackHeader *header = nullptr;
+    const PackEntry *entries = nullptr;
+    std::mutex lock; // guards inflated
+    std::map<const PackEntry *, std::vector<unsigned char>> inflated;
+
+    // Map the file and validate its table; false if it is missing or malformed
+    bool open(const std::string &path) {
+        close();
+        if (!file.open(path)) {
+            return false;
+        }
+        const PackHeader *h = (const PackHeader *)file.data;
+        if (file.size < sizeof(PackHeader) || std::memcmp(h->magic, PACK_MAGIC, 4) != 0 || h->version != PACK_VERSION ||
+            (file.size - sizeof(PackHeader)) / sizeof(PackEntry) < h->entryCount) {
+            close();
+            return false;
+        }
+        const PackEntry *table = (const PackEntry *)(file.data + sizeof(PackHeader));
+        for (uint32_t i = 0; i < h->entryCount; i++) {
+            const PackEntry &e = table[i];
+            if (e.offset % PACK_ALIGNMENT || e.offset > file.size || e.bytes > file.size - e.offset ||
+                strnlen(e.name, sizeof(e.name)) == sizeof(e.name) || e.compression > PACK_LZ ||
+                (e.compression == PACK_STORED && e.size != e.bytes)) {
+                close();
+                return false;
+            }
+        }
+        header = h;
+        entries = table;
+        return true;
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    uint32_t count() const {
+        return header ? header->entryCount : 0;
+    }
+
+    // True if any entry's name ends in suffix, e.g. ".png"
+    bool holds(const char *suffix) const {
+        size_t n = std::strlen(suffix);
+        for (uint32_t i = 0; i < count(); i++) {
+            size_t length = std::strlen(entries[i].name);
+            if (length >= n && std::strcmp(entries[i].name + length - n, suffix) == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The entry for a file name, or nullptr
+    const PackEntry *find(const char *name) const {
+        for (uint32_t i = 0; i < count(); i++) {
+            if (std::strcmp(entries[i].name, name) == 0) {
+                return &entries[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // An entry's contents: in the mapping when stored, else inflated once and kept.
+    // nullptr if it does not inflate.
+    const unsigned char *read(const PackEntry &e, size_t &size) {
+        size = (size_t)e.size;
+        if (e.compression == PACK_STORED) {
+            return file.data + e.offset;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        auto it = inflated.find(&e);
+        if (it == inflated.end()) {
+            std::vector<unsigned char> bytes((size_t)e.size);
+            if (!decompressLz(file.data + e.offset, (size_t)e.bytes, bytes.data(), bytes.size())) {
+                std::printf("Asset pack entry %s is corrupt\n", e.name);
+                return nullptr;
+            }
+            it = inflated.emplace(&e, std::move(bytes)).first;
+        }
+        return it->second.data();
+    }
+
+    // Decode an image entry to RGBA8 straight from the pack; free with stbi_image_free
+    unsigned char *loadImage(const PackEntry &e, int *width, int *height) {
+        size_t size;
+        const unsigned char *bytes = read(e, size);
+        return bytes ? decodeImage(bytes, size, width, height) : nullptr;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> guard(lock);
+        inflated.clear();
+        file.close();
+        header = nullptr;
+        entries = nullptr;
+    }
+};
+
+inline AssetPack assetPack;
+
+// Decode an image to RGBA8 from the open pack when it holds the path's file name,
+// else from the file itself; free with stbi_image_free
+inline unsigned char *loadImage(const std::string &path, int *width, int *height) {
+    if (assetPack.isOpen()) {
+        if (const PackEntry *e = assetPack.find(path.substr(path.find_last_of("/\\") + 1).c_str())) {
+            return assetPack.loadImage(*e, width, height);
+        }
+    }
+    return decodeImageFile(path, width, height);
+}
+
+// Write a pack of already compressed (or stored) files; used by the pack tool
+inline bool writeAssetPack(const std::string &path, const std::vector<PackFile> &files) {
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    PackHeader header = {};
+    std::memcpy(header.magic, PACK_MAGIC, 4);
+    header.version = PACK_VERSION;
+    header.entryCount = (uint32_t)files.size();
+
+    std::vector<PackEntry> table(files.size());
+    uint64_t offset = sizeof(PackHeader) + table.size() * sizeof(PackEntry);
+    for (size_t i = 0; i < files.size(); i++) {
+        offset = (offset + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+        PackEntry &e = table[i];
+        std::strncpy(e.name, files[i].name.c_str(), sizeof(e.name) - 1);
+        e.offset = offset;
+        e.bytes = files[i].bytes.size();
+        e.size = files[i].size;
+        e.compression = files[i].compression;
+        offset += e.bytes;
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && (table.empty() || std::fwrite(table.data(), sizeof(PackEntry), table.size(), out) == table.size());
+    static const unsigned char zeros[PACK_ALIGNMENT] = {};
+    uint64_t written = sizeof(PackHeader) + table.size() * sizeof(PackEntry);
+    for (size_t i = 0; i < files.size() && ok; i++) {
+        ok = table[i].offset == written || std::fwrite(zeros, 1, (size_t)(table[i].offset - written), out) ==
+                                                   (size_t)(table[i].offset - written);
+        ok = ok && (files[i].bytes.empty() ||
+                    std::fwrite(files[i].bytes.data(), 1, files[i].bytes.size(), out) == files[i].bytes.size());
+        written = table[i].offset + table[i].bytes;
+    }
+    return std::fclose(out) == 0 && ok;
+}
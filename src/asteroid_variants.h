@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include "alpha_mask.h"
+#include "generational_handle.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "shader_program.h"
+#include "sprite_outline.h"
+#include "texture_array.h"
+
+// Comet sprites that come in several looks, as the layers of one texture array: each
+// comet shows the layer its handle hashes to, in the sprite, impostor and GPU-motion
+// paths alike, and collides with that layer's mask. The layers are either drawn by
+// asteroid.frag.glsl at startup, one pass per layer, or decoded from a directory of
+// same-sized images. The noise is fixed, so every run draws the same asteroids; the
+// drawn masks come from the GPU's rasterization, though, so a replay recorded with
+// procedural comets is only guaranteed to play back the same on the same driver.
+struct AsteroidVariants {
+    static const int PROCEDURAL = 8; // layers bake() draws
+    static const int CELL = 64;      // texels per side of a drawn layer
+
+    GLuint texture = 0; // GL_TEXTURE_2D_ARRAY
+    int layers = 0;
+    std::vector<AlphaMask> masks; // per layer, at the size comets collide at
+    SpriteOutline outline;        // around every layer, as they share one mesh
+
+    // Same hash as comet.vert.glsl's, which has only the handle's slot (its instance) to go on
+    uint32_t variantOf(uint32_t handle) const {
+        return (handleIndex(handle) * 2654435761u >> 16) % (uint32_t)layers;
+    }
+
+    // Draw every layer with program over the fullscreen triangle (vertexArray bound,
+    // no attributes) and build masks of maskSize pixels. Leaves framebuffer 0 bound;
+    // the caller restores its viewport.
+    void bake(ShaderProgram &program, GLuint vertexArray, int maskSize) {
+        TextureArrayImages images;
+        images.width = images.height = CELL;
+        images.layers = PROCEDURAL;
+        images.pixels.resize((size_t)CELL * CELL * 4 * PROCEDURAL);
+        const int levels = mipLevels(CELL, CELL);
+        texture = createTexture2D(GL_TEXTURE_2D_ARRAY);
+        textureStorage2DArray(texture, levels, GL_RGBA8, CELL, CELL, PROCEDURAL);
+        memoryStats.trackGl(GL_TEXTURE, texture, MEM_TEXTURES, textureBytes(CELL, CELL, 4, levels) * PROCEDURAL);
+        glMarkers.label(GL_TEXTURE, texture, "asteroid variants");
+        GLuint fbo;
+        glGenFramebuffers(1, &fbo);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glViewport(0, 0, CELL, CELL);
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        program.use();
+        program.set(program.find("cellSize"), (float)CELL);
+        glState.bindVertexArray(vertexArray);
+
+        // One synchronous read of 16 KB per layer, before the first frame
+        for (int layer = 0; layer < PROCEDURAL; layer++) {
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, texture, 0, layer);
+            glClear(GL_COLOR_BUFFER_BIT); // premultiplied blending over clear writes the colour as is
+            program.set(program.find("variant"), (float)layer);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glReadPixels(0, 0, CELL, CELL, GL_RGBA, GL_UNSIGNED_BYTE, images.pixels.data() + (size_t)layer * CELL * CELL * 4);
+        }
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glState.deleteFramebuffers(1, &fbo);
+        generateMipmap(texture, GL_TEXTURE_2D_ARRAY);
+        buildMasks(images, maskSize);
+    }
+
+    // Layers from images decoded by TextureArrayImages
+    void load(const TextureArrayImages &images, int maskSize) {
+        texture = createTextureArray(images);
+        buildMasks(images, maskSize);
+    }
+
+    void buildMasks(const TextureArrayImages &images, int maskSize) {
+        layers = images.layers;
+        masks.assign(layers, AlphaMask());
+        outline = SpriteOutline();
+        std::vector<unsigned char> alpha((size_t)images.width * images.height);
+        for (int layer = 0; layer < layers; layer++) {
+            const unsigned char *pixels = images.layer(layer);
+            for (size_t i = 0; i < alpha.size(); i++) {
+                alpha[i] = pixels[i * 4 + 3];
+            }
+            masks[layer].build(alpha.data(), images.width, 0, 0, images.width, images.height, maskSize, maskSize);
+            outline.add(alpha.data(), images.width, 0, 0, images.width, images.height);
+        }
+        outline.finish();
+    }
+
+    void release() {
+        if (!texture) {
+            return;
+        }
+        memoryStats.untrackGl(GL_TEXTURE, texture);
+        glState.deleteTextures(1, &texture);
+        texture = 0;
+    }
+};
@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "lockfree_queue.h"
+#include "thread_config.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <mmsystem.h>
+#endif
+
+// A sound decoded (or synthesized) up front: mono samples in [-1, 1] at AudioMixer::RATE
+struct SoundClip {
+    std::vector<float> samples;
+};
+
+enum AudioCommandType : uint8_t {
+    AUDIO_PLAY,   // start clip on voice at volume and pan, looping if loop
+    AUDIO_STOP,   // end voice
+    AUDIO_VOLUME, // set voice's volume
+    AUDIO_MASTER  // set the volume every voice is scaled by
+};
+
+// One request from the game thread to the mixer
+struct AudioCommand {
+    AudioCommandType type;
+    bool loop;
+    uint16_t clip;
+    uint32_t voice; // id handed out by AudioMixer::play(); unused by AUDIO_MASTER
+    float volume;
+    float pan; // -1 left to 1 right
+};
+
+// Software mixer on a dedicated, time-critical thread. The game thread only pushes
+// commands; the mixer drains them at the start of every block, sums its voices into
+// 16-bit stereo and hands the block to the device. Blocks are BLOCK_FRAMES long
+// (5 ms) and BLOCKS of them are queued, so a frame that stalls on the GPU never
+// starves the device: the mixer thread does not wait on the render loop at all.
+// Clips are added before start() and read-only while it runs, and nothing on the
+// mixer thread allocates or locks. The output is waveOut on Windows (link winmm);
+// elsewhere there is no device and start() fails, leaving the game silent.
+struct AudioMixer {
+    static const uint32_t RATE = 48000;       // frames per second
+    static const uint32_t BLOCK_FRAMES = 240; // frames per device block: 5 ms
+    static const int BLOCKS = 4;              // blocks queued on the device
+    static const int MAX_VOICES = 32;         // sounds playing at once; later plays are dropped
+
+    struct Voice {
+        uint32_t id;
+        uint16_t clip;
+        bool loop;
+        float volume, pan;
+        size_t position; // next sample of the clip
+    };
+
+    std::vector<SoundClip> clips;
+    SpscQueue<AudioCommand, 256> commands; // game thread to mixer; nothing allocates
+    uint32_t commandsDropped = 0;          // pushed while the ring was full, which only a stalled mixer causes
+    std::atomic<bool> running{false};
+    std::thread thread;
+    uint32_t nextVoice = 1; // game thread; 0 means no voice
+
+    // Mixer thread state
+    Voice voices[MAX_VOICES];
+    int voiceCount = 0;
+    float master = 1.0f;
+    int16_t pcm[BLOCKS][BLOCK_FRAMES * 2];
+    std::atomic<uint32_t> underruns{0}; // wakes that found every queued block played
+    std::atomic<uint32_t> voicesDropped{0};
+
+#ifdef _WIN32
+    HWAVEOUT device = nullptr;
+    HANDLE blockDone = nullptr; // signalled by the device whenever it finishes a block
+#endif
+
+    // Register a clip before start(); returns its index for play()
+    uint16_t addClip(SoundClip clip) {
+        clips.push_back(std::move(clip));
+        return (uint16_t)(clips.size() - 1);
+    }
+
+    // Open the output device and start mixing; false (and silent) if there is none
+    bool start() {
+#ifdef _WIN32
+        WAVEFORMATEX format = {};
+        format.wFormatTag = WAVE_FORMAT_PCM;
+        format.nChannels = 2;
+        format.nSamplesPerSec = RATE;
+        format.wBitsPerSample = 16;
+        format.nBlockAlign = 4;
+        format.nAvgBytesPerSec = RATE * 4;
+        blockDone = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+        if (!blockDone || waveOutOpen(&device, WAVE_MAPPER, &format, (DWORD_PTR)blockDone, 0, CALLBACK_EVENT) !=
+                              MMSYSERR_NOERROR) {
+            std::printf("No audio output device\n");
+            if (blockDone) {
+                CloseHandle(blockDone);
+                blockDone = nullptr;
+            }
+            device = nullptr;
+            return false;
+        }
+        running = true;
+        thread = std::thread([this] { mixerLoop(); });
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // Stop the thread and close the device; queued commands are discarded
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        thread.join();
+        if (underruns > 0 || voicesDropped > 0 || commandsDropped > 0) {
+            std::printf("Audio: %u underruns, %u voices dropped, %u commands dropped\n", underruns.load(),
+                        voicesDropped.load(), commandsDropped);
+        }
+    }
+
+    // Game thread: start a clip; returns the voice for stopVoice() and setVolume(), or 0
+    // when the mixer is not running
+    uint32_t play(uint16_t clip, float volume = 1.0f, float pan = 0.0f, bool loop = false) {
+        if (!running || clip >= clips.size()) {
+            return 0;
+        }
+        uint32_t voice = nextVoice++;
+        push({AUDIO_PLAY, loop, clip, voice, volume, pan});
+        return voice;
+    }
+
+    void stopVoice(uint32_t voice) {
+        if (running && voice) {
+            push({AUDIO_STOP, false, 0, voice, 0.0f, 0.0f});
+        }
+    }
+
+    void setVolume(uint32_t voice, float volume) {
+        if (running && voice) {
+            push({AUDIO_VOLUME, false, 0, voice, volume, 0.0f});
+        }
+    }
+
+    void setMaster(float volume) {
+        if (running) {
+            push({AUDIO_MASTER, false, 0, 0, volume, 0.0f});
+        }
+    }
+
+    // Game thread: queue a command for the mixer, counting it if the ring is full
+    void push(const AudioCommand &command) {
+        if (!commands.push(command)) {
+            commandsDropped++;
+        }
+    }
+
+    // Mixer thread: apply one command to the voice table
+    void apply(const AudioCommand &c) {
+        if (c.type == AUDIO_MASTER) {
+            master = c.volume;
+            return;
+        }
+        if (c.type == AUDIO_PLAY) {
+            if (voiceCount == MAX_VOICES) {
+                voicesDropped++;
+                return;
+            }
+            voices[voiceCount++] = {c.voice, c.clip, c.loop, c.volume, std::max(-1.0f, std::min(c.pan, 1.0f)), 0};
+            return;
+        }
+        for (int v = 0; v < voiceCount; v++) {
+            if (voices[v].id == c.voice) {
+                if (c.type == AUDIO_STOP) {
+                    voices[v] = voices[--voiceCount];
+                } else {
+                    voices[v].volume = c.volume;
+                }
+                return;
+            }
+        }
+    }
+
+    // Mixer thread: drain the commands, then sum every voice into frames of
+    // interleaved 16-bit stereo. Pan is equal-power; finished voices are freed.
+    void mix(int16_t *out, uint32_t frames) {
+        AudioCommand command;
+        while (commands.pop(command)) {
+            apply(command);
+        }
+        float left[BLOCK_FRAMES] = {}, right[BLOCK_FRAMES] = {};
+        frames = std::min(frames, BLOCK_FRAMES);
+        for (int v = 0; v < voiceCount;) {
+            Voice &voice = voices[v];
+            const std::vector<float> &samples = clips[voice.clip].samples;
+            float angle = (voice.pan + 1.0f) * 0.785398163f; // 0 to pi/2
+            float gainL = voice.volume * master * std::cos(angle), gainR = voice.volume * master * std::sin(angle);
+            bool finished = samples.empty();
+            for (uint32_t f = 0; f < frames && !finished; f++) {
+                if (voice.position == samples.size()) {
+                    finished = !voice.loop;
+                    if (finished) {
+                        break;
+                    }
+                    voice.position = 0;
+                }
+                float s = samples[voice.position++];
+                left[f] += s * gainL;
+                right[f] += s * gainR;
+            }
+            if (finished) {
+                voice = voices[--voiceCount];
+            } else {
+                v++;
+            }
+        }
+        for (uint32_t f = 0; f < frames; f++) {
+            out[2 * f] = (int16_t)(std::max(-1.0f, std::min(left[f], 1.0f)) * 32767.0f);
+            out[2 * f + 1] = (int16_t)(std::max(-1.0f, std::min(right[f], 1.0f)) * 32767.0f);
+        }
+    }
+
+#ifdef _WIN32
+    // Keep BLOCKS blocks queued: refill each as the device hands it back, in play order
+    void mixerLoop() {
+        configureThread(THREAD_AUDIO, "audio mixer");
+        WAVEHDR headers[BLOCKS] = {};
+        for (int b = 0; b < BLOCKS; b++) {
+            headers[b].lpData = (LPSTR)pcm[b];
+            headers[b].dwBufferLength = sizeof(pcm[b]);
+            waveOutPrepareHeader(device, &headers[b], sizeof(WAVEHDR));
+            mix(pcm[b], BLOCK_FRAMES);
+            waveOutWrite(device, &headers[b], sizeof(WAVEHDR));
+        }
+        int next = 0;
+        while (running) {
+            WaitForSingleObject(blockDone, 50);
+            int refilled = 0;
+            while (refilled < BLOCKS && (headers[next].dwFlags & WHDR_DONE)) {
+                mix(pcm[next], BLOCK_FRAMES);
+                waveOutWrite(device, &headers[next], sizeof(WAVEHDR));
+                next = (next + 1) % BLOCKS;
+                refilled++;
+            }
+            if (refilled == BLOCKS) {
+                underruns++; // the device ran dry before this wake
+            }
+        }
+        waveOutReset(device);
+        for (int b = 0; b < BLOCKS; b++) {
+            waveOutUnprepareHeader(device, &headers[b], sizeof(WAVEHDR));
+        }
+        waveOutClose(device);
+        CloseHandle(blockDone);
+        device = nullptr;
+        blockDone = nullptr;
+    }
+#endif
+};
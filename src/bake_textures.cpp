@@ -0,0 +1,89 @@
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "baked_texture.h"
+#include "block_compress.h"
+#include "texture_atlas.h"
+
+using namespace std;
+
+// Half-size box filter of an RGBA8 level; odd edges reuse their last row/column
+BakedLevelData downsample(const BakedLevelData &src) {
+    BakedLevelData dst;
+    dst.width = std::max(1u, src.width / 2);
+    dst.height = std::max(1u, src.height / 2);
+    dst.pixels.resize((size_t)dst.width * dst.height * 4);
+    for (uint32_t y = 0; y < dst.height; y++) {
+        for (uint32_t x = 0; x < dst.width; x++) {
+            uint32_t x0 = std::min(x * 2, src.width - 1), x1 = std::min(x * 2 + 1, src.width - 1);
+            uint32_t y0 = std::min(y * 2, src.height - 1), y1 = std::min(y * 2 + 1, src.height - 1);
+            for (int c = 0; c < 4; c++) {
+                int sum = src.pixels[((size_t)y0 * src.width + x0) * 4 + c] + src.pixels[((size_t)y0 * src.width + x1) * 4 + c] +
+                          src.pixels[((size_t)y1 * src.width + x0) * 4 + c] + src.pixels[((size_t)y1 * src.width + x1) * 4 + c];
+                dst.pixels[((size_t)y * dst.width + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+            }
+        }
+    }
+    return dst;
+}
+
+// Offline atlas bake: decodes and packs every PNG of a directory exactly as the game
+// would, and writes the result next to them as TextureAtlas::BAKED_ATLAS.
+// Usage: bake_textures [directory] [--mips] [--format=rgba8|bc3]
+int main(int argc, char **argv) {
+    string directory = "../textures";
+    bool mips = false;
+    BakedFormat format = BAKED_RGBA8;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--mips") == 0) {
+            mips = true;
+        } else if (strcmp(argv[i], "--format=rgba8") == 0) {
+            format = BAKED_RGBA8;
+        } else if (strcmp(argv[i], "--format=bc3") == 0) {
+            format = BAKED_BC3;
+        } else if (strncmp(argv[i], "--format=", 9) == 0) {
+            cout << "Unknown format " << argv[i] + 9 << " (rgba8 or bc3)" << endl;
+            return 1;
+        } else {
+            directory = argv[i];
+        }
+    }
+
+    TextureAtlas atlas;
+    vector<BakedLevelData> levels(1);
+    if (!atlas.compose(directory, levels[0].pixels)) {
+        return 1;
+    }
+    levels[0].width = (uint32_t)atlas.width;
+    levels[0].height = (uint32_t)atlas.height;
+    while (mips && (levels.back().width > 1 || levels.back().height > 1)) {
+        levels.push_back(downsample(levels.back()));
+    }
+    if (format == BAKED_BC3) {
+        for (BakedLevelData &level : levels) {
+            level.pixels = compressBc3(level.pixels.data(), level.width, level.height);
+        }
+    }
+
+    vector<BakedRegion> regions;
+    for (const auto &entry : atlas.regions) {
+        BakedRegion region = {};
+        if (entry.first.size() >= sizeof(region.name)) {
+            cout << "Region name too long: " << entry.first << endl;
+            return 1;
+        }
+        memcpy(region.name, entry.first.c_str(), entry.first.size());
+        memcpy(region.rect, &entry.second[0], sizeof(region.rect));
+        regions.push_back(region);
+    }
+
+    string out = directory + "/" + TextureAtlas::BAKED_ATLAS;
+    if (!writeBakedTexture(out, format, levels, regions)) {
+        cout << "Failed to write " << out << endl;
+        return 1;
+    }
+    cout << "Baked " << regions.size() << " images into " << out << " (" << atlas.width << "x" << atlas.height
+         << ", " << levels.size() << " levels)" << endl;
+    return 0;
+}
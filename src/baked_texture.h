@@ -0,0 +1,167 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "block_compress.h"
+#include "mapped_file.h"
+
+// Pre-decoded texture container written by the bake tool (bake_textures.cpp) and
+// memory-mapped at startup. Layout, all little-endian:
+//
+//   BakedHeader
+//   BakedLevel[levelCount]    mip chain, largest first
+//   BakedRegion[regionCount]  named UV rects, for atlases
+//   level data, each level starting on a 16-byte boundary
+//
+// Level data is in the exact layout glTexImage2D / glCompressedTexImage2D expect for
+// the stored format, so the loader passes pointers into the mapping straight to GL.
+static const char BAKED_MAGIC[4] = {'S', 'T', 'E', 'X'};
+static const uint32_t BAKED_VERSION = 2; // 2: colour is premultiplied by alpha
+
+// Pixel formats a level can be stored in
+enum BakedFormat : uint32_t {
+    BAKED_RGBA8 = 0,
+    BAKED_BC3 = 1, // S3TC DXT5, 16 bytes per 4x4 block
+    BAKED_BC7 = 2  // BPTC, 16 bytes per 4x4 block; loadable, but the bake tool does not encode it
+};
+
+struct BakedHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t format;
+    uint32_t width, height;
+    uint32_t levelCount;
+    uint32_t regionCount;
+    uint32_t reserved;
+};
+
+struct BakedLevel {
+    uint32_t width, height;
+    uint64_t offset; // from the start of the file
+    uint64_t bytes;
+};
+
+struct BakedRegion {
+    char name[48]; // NUL-terminated
+    float rect[4]; // xy = offset, zw = scale
+};
+
+// One mip level ready to bake
+struct BakedLevelData {
+    uint32_t width, height;
+    std::vector<unsigned char> pixels;
+};
+
+// Read-only view of a container, either a mapped file or bytes already in memory
+// (such as an embedded asset); pointers stay valid while the view is open
+struct BakedTexture {
+    MappedFile file;
+    const unsigned char *data = nullptr;
+    const BakedHeader *header = nullptr;
+    const BakedLevel *levels = nullptr;
+    const BakedRegion *regions = nullptr;
+
+    // Map the file and validate its tables; false if it is missing or malformed
+    bool open(const std::string &path) {
+        header = nullptr;
+        return file.open(path) && openMemory(file.data, file.size);
+    }
+
+    // Validate a container held in memory (at least 8-byte aligned) and point into it
+    bool openMemory(const unsigned char *bytes, size_t size) {
+        header = nullptr;
+        if (size < sizeof(BakedHeader)) {
+            return false;
+        }
+        const BakedHeader *h = (const BakedHeader *)bytes;
+        if (std::memcmp(h->magic, BAKED_MAGIC, 4) != 0 || h->version != BAKED_VERSION) {
+            return false;
+        }
+        size_t tables = sizeof(BakedHeader) + h->levelCount * sizeof(BakedLevel) + h->regionCount * sizeof(BakedRegion);
+        if (h->levelCount == 0 || tables > size) {
+            return false;
+        }
+        levels = (const BakedLevel *)(bytes + sizeof(BakedHeader));
+        regions = (const BakedRegion *)(levels + h->levelCount);
+        if (levels[0].width != h->width || levels[0].height != h->height) {
+            return false;
+        }
+        // Each level holds exactly its size in the format, within the bytes; the
+        // range check subtracts, since the file's offset and size could wrap a sum
+        for (uint32_t i = 0; i < h->levelCount; i++) {
+            const BakedLevel &l = levels[i];
+            if (l.bytes == 0 || l.bytes != levelBytes(h->format, l.width, l.height) || l.bytes > size ||
+                l.offset > size - l.bytes) {
+                return false;
+            }
+        }
+        data = bytes;
+        header = h;
+        return true;
+    }
+
+    // Bytes of a width x height level in format; 0 for a format this build does not know
+    static uint64_t levelBytes(uint32_t format, uint32_t width, uint32_t height) {
+        if (format == BAKED_RGBA8) {
+            return (uint64_t)width * height * 4;
+        }
+        if (format == BAKED_BC3 || format == BAKED_BC7) {
+            return bcLevelBytes(width, height);
+        }
+        return 0;
+    }
+
+    const unsigned char *levelData(uint32_t level) const {
+        return data + levels[level].offset;
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+    }
+};
+
+// Write a container; used by the bake tool
+inline bool writeBakedTexture(const std::string &path, BakedFormat format, const std::vector<BakedLevelData> &levels,
+                              const std::vector<BakedRegion> &regions) {
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out || levels.empty()) {
+        if (out) {
+            std::fclose(out);
+        }
+        return false;
+    }
+
+    BakedHeader header = {};
+    std::memcpy(header.magic, BAKED_MAGIC, 4);
+    header.version = BAKED_VERSION;
+    header.format = format;
+    header.width = levels[0].width;
+    header.height = levels[0].height;
+    header.levelCount = (uint32_t)levels.size();
+    header.regionCount = (uint32_t)regions.size();
+
+    std::vector<BakedLevel> table(levels.size());
+    uint64_t offset = sizeof(BakedHeader) + table.size() * sizeof(BakedLevel) + regions.size() * sizeof(BakedRegion);
+    for (size_t i = 0; i < levels.size(); i++) {
+        offset = (offset + 15) & ~(uint64_t)15;
+        table[i] = {levels[i].width, levels[i].height, offset, levels[i].pixels.size()};
+        offset += levels[i].pixels.size();
+    }
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    ok = ok && std::fwrite(table.data(), sizeof(BakedLevel), table.size(), out) == table.size();
+    if (!regions.empty()) {
+        ok = ok && std::fwrite(regions.data(), sizeof(BakedRegion), regions.size(), out) == regions.size();
+    }
+    for (size_t i = 0; i < levels.size() && ok; i++) {
+        static const unsigned char zeros[16] = {};
+        long pad = (long)table[i].offset - std::ftell(out);
+        ok = std::fwrite(zeros, 1, pad, out) == (size_t)pad;
+        ok = ok && std::fwrite(levels[i].pixels.data(), 1, levels[i].pixels.size(), out) == levels[i].pixels.size();
+    }
+    return std::fclose(out) == 0 && ok;
+}
@@ -0,0 +1,351 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glm/glm.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+#include "collision_kernel.h"
+#include "game_rules.h"
+#include "large_pages.h"
+#include "random.h"
+
+// Many games stepped in lock-step for training an agent, laid out structure-of-
+// arrays with one game per SIMD slot: every field is an array over games, and the
+// comets of eight games at a time sit together, slot by slot. A step applies each game's
+// action, releases due waves, then moves every comet and sweeps it against its ship
+// four (SSE2) or eight (AVX) games at a time, with masks rather than branches. The
+// rules are those of updateGame (game_rules.h), with the fixed comet speed of random
+// waves. A game that collides is reported in done and restarted within the same
+// step, drawing its next waves from where its own random stream left off.
+//
+// Observations go straight into a buffer the caller owns, written by the same pass
+// that moves the comets: OBSERVATION_SIZE floats per game, games back to back
+// (row-major float32 [games][OBSERVATION_SIZE], so Python can wrap it as an array
+// without copying). A row is the ship's lane, then for each lane the height of its
+// nearest comet above the ship still able to hit it, or CLEAR if there is none.
+// Stepping never allocates, and each step reads and writes the same bytes. The
+// arrays come from large_pages.h, so with large pages enabled before setup a big
+// batch is walked with a fraction of the TLB misses.
+struct BatchEnv {
+    // Waves alive at once in one game, plus one: a comet falls from SPAWN_Y past
+    // DESPAWN_Y before its wave's slot comes round again
+    static constexpr int WAVE_SLOTS = (int)((SPAWN_Y - DESPAWN_Y) / (COMET_SPEED * WAVE_INTERVAL)) + 2;
+    static constexpr int COMET_SLOTS = WAVE_SLOTS * 2;
+    static const uint32_t WIDTH_PAD = 8; // games are padded to whole AVX registers
+    static constexpr int OBSERVATION_SIZE = 1 + LANE_COUNT;
+    static constexpr float CLEAR = SPAWN_Y - SHIP_Y; // distance observed in a lane without comets
+    static constexpr float PASSED_Y = SHIP_Y - (SHIP_SIZE + COMET_SIZE) / 2; // comets at or below can no longer hit
+
+    uint32_t count = 0, stride = 0; // games, and games rounded up to WIDTH_PAD
+    float deltaTime = 1.0f / 120.0f;
+
+    // Per game
+    LargePageVector<int32_t> lane;
+    LargePageVector<float> shipX, prevX, fromX, toX, elapsed;
+    LargePageVector<double> simTime, waveTime;
+    LargePageVector<int32_t> nextWave; // wave slot the next wave is written to
+    LargePageVector<uint32_t> ticks;   // ticks survived in the current run
+    LargePageVector<Pcg32> random;     // wave stream of each game
+
+    // Per comet slot and game, in blocks of WIDTH_PAD games: every slot of a block
+    // of games is one run of memory, slot after slot (see comet)
+    LargePageVector<float> cometX, cometY;
+
+    // Written by step for each game
+    LargePageVector<uint8_t> done;          // the game collided and was restarted
+    LargePageVector<uint32_t> episodeTicks; // length of the run that just ended, where done
+
+    // games independent games at rate ticks per second; game i draws its waves from stream STREAM_WORKERS + i
+    void setup(uint32_t games, uint64_t seed, float rate) {
+        count = games;
+        stride = (games + WIDTH_PAD - 1) / WIDTH_PAD * WIDTH_PAD;
+        deltaTime = 1.0f / rate;
+        for (LargePageVector<float> *v : {&shipX, &prevX, &fromX, &toX, &elapsed}) {
+            v->assign(stride, 0.0f);
+        }
+        lane.assign(stride, 0);
+        simTime.assign(count, 0.0);
+        waveTime.assign(count, 0.0);
+        nextWave.assign(count, 0);
+        ticks.assign(count, 0);
+        random.resize(count);
+        cometX.assign((size_t)COMET_SLOTS * stride, 0.0f);
+        cometY.assign((size_t)COMET_SLOTS * stride, DESPAWN_Y); // parked: below the ship, out of reach
+        done.assign(count, 0);
+        episodeTicks.assign(count, 0);
+        for (uint32_t i = 0; i < count; i++) {
+            random[i].seed(seed, STREAM_WORKERS + i);
+            reset(i);
+        }
+    }
+
+    // Index of comet slot k of game i
+    size_t comet(int k, uint32_t i) const {
+        return ((size_t)(i / WIDTH_PAD) * COMET_SLOTS + k) * WIDTH_PAD + i % WIDTH_PAD;
+    }
+
+    // Start game i over: the ship in the middle lane, no comets, the first wave due now
+    void reset(uint32_t i) {
+        lane[i] = LANES.MIDDLE;
+        shipX[i] = prevX[i] = fromX[i] = toX[i] = LANES.center(LANES.MIDDLE);
+        elapsed[i] = LANE_TRANSITION_TIME;
+        simTime[i] = waveTime[i] = 0.0;
+        nextWave[i] = 0;
+        ticks[i] = 0;
+        for (int k = 0; k < COMET_SLOTS; k++) {
+            cometY[comet(k, i)] = DESPAWN_Y;
+        }
+    }
+
+    // Advance every game one tick; actions[i] is game i's press: -1 left, +1 right, 0 none.
+    // Where observations is given, every game's row is written there, restarted games
+    // observing their fresh start.
+    void step(const int8_t *actions, float *observations = nullptr) {
+        steer(actions);
+        spawn();
+        static const FallFn fall = selectFall();
+        fall(*this, 0, stride, observations);
+        for (uint32_t i = 0; i < count; i++) {
+            ticks[i]++;
+            simTime[i] += deltaTime;
+            if (done[i]) {
+                episodeTicks[i] = ticks[i];
+                reset(i);
+                if (observations) {
+                    observe(i, observations);
+                }
+            }
+        }
+    }
+
+    // Write every game's row without stepping, e.g. the first observation after setup
+    void observeAll(float *observations) const {
+        for (uint32_t i = 0; i < count; i++) {
+            observe(i, observations);
+        }
+    }
+
+    // Write game i's row from its current state
+    void observe(uint32_t i, float *observations) const {
+        float *row = observations + (size_t)i * OBSERVATION_SIZE;
+        row[0] = (float)lane[i];
+        for (int l = 0; l < LANE_COUNT; l++) {
+            row[1 + l] = CLEAR;
+        }
+        for (int k = 0; k < COMET_SLOTS; k++) {
+            float y = cometY[comet(k, i)];
+            int l = LANES.laneAt(cometX[comet(k, i)]);
+            row[1 + l] = y > PASSED_Y ? std::min(row[1 + l], y - SHIP_Y) : row[1 + l];
+        }
+    }
+
+    // The press and the lane glide, as tickSimulation's moveSpaceship and
+    // advanceSpaceship, with selects rather than branches; SSE2 steers four games at a
+    // time. The lane centre is worked out as LaneLayout does, so it matches the table
+    // without a lookup.
+    void steer(const int8_t *actions) {
+        uint32_t i = 0;
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), lastLane = _mm_set1_ps(LANE_COUNT - 1.0f);
+        const __m128 width = _mm_set1_ps(LANES.width), halfWidth = _mm_set1_ps(LANES.width / 2);
+        const __m128 duration = _mm_set1_ps(LANE_TRANSITION_TIME), dt = _mm_set1_ps(deltaTime);
+        const __m128 two = _mm_set1_ps(2.0f), three = _mm_set1_ps(3.0f);
+        auto select = [](__m128 mask, __m128 a, __m128 b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); };
+        for (; i + 4 <= count; i += 4) {
+            int32_t packed;
+            std::memcpy(&packed, actions + i, 4);
+            __m128i press = _mm_cvtsi32_si128(packed);
+            press = _mm_srai_epi32(_mm_unpacklo_epi16(_mm_unpacklo_epi8(press, press), _mm_unpacklo_epi8(press, press)), 24);
+            __m128i current = _mm_loadu_si128((const __m128i *)&lane[i]);
+            __m128 target = _mm_cvtepi32_ps(_mm_add_epi32(current, press));
+            target = _mm_min_ps(_mm_max_ps(target, zero), lastLane);
+            __m128 moving = _mm_cmpneq_ps(target, _mm_cvtepi32_ps(current));
+
+            __m128 x = _mm_loadu_ps(&shipX[i]);
+            __m128 from = select(moving, x, _mm_loadu_ps(&fromX[i]));
+            __m128 to = select(moving, _mm_add_ps(_mm_mul_ps(target, width), halfWidth), _mm_loadu_ps(&toX[i]));
+            __m128 since = _mm_andnot_ps(moving, _mm_loadu_ps(&elapsed[i]));
+            __m128 gliding = _mm_cmplt_ps(since, duration);
+            __m128 advanced = _mm_add_ps(since, dt);
+            __m128 t = _mm_min_ps(_mm_div_ps(advanced, duration), one);
+            __m128 ease = _mm_mul_ps(_mm_mul_ps(t, t), _mm_sub_ps(three, _mm_mul_ps(two, t)));
+            __m128 glided = _mm_add_ps(from, _mm_mul_ps(ease, _mm_sub_ps(to, from)));
+
+            _mm_storeu_ps(&prevX[i], x);
+            _mm_storeu_ps(&shipX[i], select(gliding, glided, x));
+            _mm_storeu_ps(&fromX[i], from);
+            _mm_storeu_ps(&toX[i], to);
+            _mm_storeu_ps(&elapsed[i], select(gliding, advanced, since));
+            _mm_storeu_si128((__m128i *)&lane[i], _mm_cvttps_epi32(target));
+        }
+#endif
+        for (; i < count; i++) {
+            int target = std::min(std::max(lane[i] + actions[i], 0), LANE_COUNT - 1);
+            bool moving = target != lane[i];
+            float x = shipX[i];
+            float from = moving ? x : fromX[i];
+            float to = moving ? (float)target * LANES.width + LANES.width / 2 : toX[i];
+            float since = moving ? 0.0f : elapsed[i];
+            bool gliding = since < LANE_TRANSITION_TIME;
+            float advanced = since + deltaTime;
+            prevX[i] = x;
+            shipX[i] = gliding ? laneTransitionX(from, to, advanced) : x;
+            fromX[i] = from;
+            toX[i] = to;
+            elapsed[i] = gliding ? advanced : since;
+            lane[i] = target;
+        }
+    }
+
+    // Release the waves due by the end of this tick into their slots; about one
+    // tick in WAVE_INTERVAL * rate has one, so this stays scalar
+    void spawn() {
+        for (uint32_t i = 0; i < count; i++) {
+            for (; waveTime[i] <= simTime[i] + deltaTime; waveTime[i] += WAVE_INTERVAL) {
+                int lanes[2];
+                int n = waveLanes(random[i], lanes);
+                size_t slot = (size_t)nextWave[i] * 2;
+                nextWave[i] = (nextWave[i] + 1) % WAVE_SLOTS;
+                for (int c = 0; c < 2; c++) {
+                    size_t k = comet((int)slot + c, i);
+                    cometX[k] = LANES.center(lanes[c < n ? c : 0]);
+                    cometY[k] = c < n ? SPAWN_Y : DESPAWN_Y;
+                }
+            }
+        }
+    }
+
+    // Comet motion and the swept ship test for games [begin, end), writing done and,
+    // unless observations is null, the games' rows
+    typedef void (*FallFn)(BatchEnv &env, uint32_t begin, uint32_t end, float *observations);
+
+    static void fallScalar(BatchEnv &env, uint32_t begin, uint32_t end, float *observations) {
+        const float fall = COMET_SPEED * env.deltaTime, reach = (SHIP_SIZE + COMET_SIZE) / 2;
+        for (uint32_t i = begin; i < end; i++) {
+            float shipMove = env.shipX[i] - env.prevX[i];
+            bool hit = false;
+            for (int k = 0; k < COMET_SLOTS; k++) {
+                float &y = env.cometY[env.comet(k, i)];
+                float startY = y;
+                y -= fall;
+                hit |= sweptOverlap(env.cometX[env.comet(k, i)] - env.prevX[i], startY - SHIP_Y, 0.0f - shipMove,
+                                    y - startY, reach, reach);
+            }
+            if (i < env.count) {
+                env.done[i] = hit;
+                if (observations) {
+                    env.observe(i, observations);
+                }
+            }
+        }
+    }
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    static void fallSse2(BatchEnv &env, uint32_t begin, uint32_t end, float *observations) {
+        const __m128 fall = _mm_set1_ps(COMET_SPEED * env.deltaTime);
+        const __m128 shipY = _mm_set1_ps(SHIP_Y), reach = _mm_set1_ps((SHIP_SIZE + COMET_SIZE) / 2);
+        const __m128 passed = _mm_set1_ps(PASSED_Y), clear = _mm_set1_ps(CLEAR);
+        for (uint32_t i = begin; i < end; i += 4) {
+            __m128 prev = _mm_loadu_ps(&env.prevX[i]);
+            __m128 shipMove = _mm_sub_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_loadu_ps(&env.shipX[i]), prev));
+            __m128 hit = _mm_setzero_ps();
+            for (int k = 0; k < COMET_SLOTS; k++) {
+                float *row = &env.cometY[env.comet(k, i)];
+                __m128 start = _mm_loadu_ps(row), y = _mm_sub_ps(start, fall);
+                _mm_storeu_ps(row, y);
+                hit = _mm_or_ps(hit, sweptOverlapSse2(_mm_sub_ps(_mm_loadu_ps(&env.cometX[env.comet(k, i)]), prev),
+                                                      _mm_sub_ps(start, shipY), shipMove, _mm_sub_ps(y, start), reach,
+                                                      reach));
+            }
+            env.storeDone(i, 4, _mm_movemask_ps(hit));
+            if (!observations) {
+                continue;
+            }
+            // The block's comets are still in L1: one more pass over them per lane
+            float rows[LANE_COUNT][WIDTH_PAD];
+            for (int l = 0; l < LANE_COUNT; l++) {
+                __m128 center = _mm_set1_ps(LANES.center(l)), nearest = clear;
+                for (int k = 0; k < COMET_SLOTS; k++) {
+                    __m128 y = _mm_loadu_ps(&env.cometY[env.comet(k, i)]);
+                    __m128 mine = _mm_and_ps(_mm_cmpgt_ps(y, passed),
+                                             _mm_cmpeq_ps(_mm_loadu_ps(&env.cometX[env.comet(k, i)]), center));
+                    nearest = _mm_min_ps(nearest, _mm_or_ps(_mm_and_ps(mine, _mm_sub_ps(y, shipY)), _mm_andnot_ps(mine, clear)));
+                }
+                _mm_storeu_ps(rows[l], nearest);
+            }
+            env.storeObservations(observations, i, 4, rows);
+        }
+    }
+
+    __attribute__((target("avx")))
+    static void fallAvx(BatchEnv &env, uint32_t begin, uint32_t end, float *observations) {
+        const __m256 fall = _mm256_set1_ps(COMET_SPEED * env.deltaTime);
+        const __m256 shipY = _mm256_set1_ps(SHIP_Y), reach = _mm256_set1_ps((SHIP_SIZE + COMET_SIZE) / 2);
+        const __m256 passed = _mm256_set1_ps(PASSED_Y), clear = _mm256_set1_ps(CLEAR);
+        for (uint32_t i = begin; i < end; i += 8) {
+            __m256 prev = _mm256_loadu_ps(&env.prevX[i]);
+            __m256 shipMove = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_sub_ps(_mm256_loadu_ps(&env.shipX[i]), prev));
+            __m256 hit = _mm256_setzero_ps();
+            for (int k = 0; k < COMET_SLOTS; k++) {
+                float *row = &env.cometY[env.comet(k, i)];
+                __m256 start = _mm256_loadu_ps(row), y = _mm256_sub_ps(start, fall);
+                _mm256_storeu_ps(row, y);
+                hit = _mm256_or_ps(hit, sweptOverlapAvx(_mm256_sub_ps(_mm256_loadu_ps(&env.cometX[env.comet(k, i)]), prev),
+                                                        _mm256_sub_ps(start, shipY), shipMove, _mm256_sub_ps(y, start),
+                                                        reach, reach));
+            }
+            env.storeDone(i, 8, _mm256_movemask_ps(hit));
+            if (!observations) {
+                continue;
+            }
+            float rows[LANE_COUNT][WIDTH_PAD];
+            for (int l = 0; l < LANE_COUNT; l++) {
+                __m256 center = _mm256_set1_ps(LANES.center(l)), nearest = clear;
+                for (int k = 0; k < COMET_SLOTS; k++) {
+                    __m256 y = _mm256_loadu_ps(&env.cometY[env.comet(k, i)]);
+                    __m256 mine = _mm256_and_ps(_mm256_cmp_ps(y, passed, _CMP_GT_OQ),
+                                                _mm256_cmp_ps(_mm256_loadu_ps(&env.cometX[env.comet(k, i)]), center, _CMP_EQ_OQ));
+                    nearest = _mm256_min_ps(nearest, _mm256_or_ps(_mm256_and_ps(mine, _mm256_sub_ps(y, shipY)),
+                                                                  _mm256_andnot_ps(mine, clear)));
+                }
+                _mm256_storeu_ps(rows[l], nearest);
+            }
+            env.storeObservations(observations, i, 8, rows);
+        }
+    }
+#endif
+
+    // Spread a movemask over done for lanes games from i; padding games are dropped
+    void storeDone(uint32_t i, uint32_t lanes, int mask) {
+        for (uint32_t l = 0; l < lanes && i + l < count; l++) {
+            done[i + l] = (uint8_t)((mask >> l) & 1);
+        }
+    }
+
+    // Transpose the per-lane distances of lanes games from i into their rows
+    void storeObservations(float *observations, uint32_t i, uint32_t lanes, const float (*rows)[WIDTH_PAD]) const {
+        for (uint32_t g = 0; g < lanes && i + g < count; g++) {
+            float *row = observations + (size_t)(i + g) * OBSERVATION_SIZE;
+            row[0] = (float)lane[i + g];
+            for (int l = 0; l < LANE_COUNT; l++) {
+                row[1 + l] = rows[l][g];
+            }
+        }
+    }
+
+    static FallFn selectFall() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        if (__builtin_cpu_supports("avx")) {
+            return fallAvx;
+        }
+        return fallSse2;
+#else
+        return fallScalar;
+#endif
+    }
+};
@@ -0,0 +1,84 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "batch_env.h"
+#include "monte_carlo.h"
+
+using namespace std;
+
+// Steps per second of N games driven by the same random presses, first as a loop
+// over HeadlessGame instances, then through one BatchEnv. Both restart a game
+// where it collides, so both step every game every tick; the runs that ended and
+// the ticks they lasted must come out the same. The batch writes observations
+// every step, and its last ones must match a fresh scalar pass over the state.
+// With large 1 the batch's arrays are backed by large pages (large_pages.h).
+// Usage: bench_batch_env [games] [ticks] [large]
+int main(int argc, char **argv) {
+    uint32_t games = argc > 1 ? (uint32_t)atoi(argv[1]) : 4096;
+    uint32_t ticks = argc > 2 ? (uint32_t)atoi(argv[2]) : 2000;
+    if (argc > 3 && atoi(argv[3]) != 0) {
+        largePages.enable();
+    }
+    const uint64_t SEED = 1;
+    const float RATE = 120.0f;
+
+    // Presses decided up front, so neither variant pays for rolling them
+    vector<int8_t> actions((size_t)games * ticks);
+    Pcg32 presses(SEED, STREAM_WORKERS + games);
+    for (int8_t &a : actions) {
+        uint32_t roll = presses.nextBelow(16); // a press every eighth tick on average
+        a = roll == 0 ? -1 : roll == 1 ? 1 : 0;
+    }
+
+    vector<HeadlessGame> looped;
+    looped.reserve(games);
+    for (uint32_t i = 0; i < games; i++) {
+        looped.emplace_back(Pcg32(SEED, STREAM_WORKERS + i), Pcg32());
+    }
+    uint64_t loopedRuns = 0, loopedTicks = 0;
+    auto start = chrono::steady_clock::now();
+    for (uint32_t t = 0; t < ticks; t++) {
+        const int8_t *row = &actions[(size_t)t * games];
+        for (uint32_t i = 0; i < games; i++) {
+            HeadlessGame &game = looped[i];
+            game.tick(1.0f / RATE, LANES.step(game.lane, row[i]));
+            if (game.collided) {
+                loopedRuns++;
+                loopedTicks += game.ticks;
+                game = HeadlessGame(game.waves, Pcg32()); // the next run continues its wave stream
+            }
+        }
+    }
+    double loopSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    BatchEnv env;
+    env.setup(games, SEED, RATE);
+    vector<float> observations((size_t)games * BatchEnv::OBSERVATION_SIZE), expected(observations.size());
+    env.observeAll(observations.data());
+    uint64_t batchRuns = 0, batchTicks = 0;
+    start = chrono::steady_clock::now();
+    for (uint32_t t = 0; t < ticks; t++) {
+        env.step(&actions[(size_t)t * games], observations.data());
+        for (uint32_t i = 0; i < games; i++) {
+            if (env.done[i]) {
+                batchRuns++;
+                batchTicks += env.episodeTicks[i];
+            }
+        }
+    }
+    double batchSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    double steps = (double)games * ticks;
+    printf("%u games x %u ticks\n", games, ticks);
+    printf("%-10s %14.3g steps/s\n", "looped", steps / loopSeconds);
+    printf("%-10s %14.3g steps/s (%.1fx)\n", "batched", steps / batchSeconds, loopSeconds / batchSeconds);
+    bool same = loopedRuns == batchRuns && loopedTicks == batchTicks;
+    printf("runs ended: %llu looped, %llu batched, %s\n", (unsigned long long)loopedRuns, (unsigned long long)batchRuns,
+           same ? "same ticks" : "MISMATCH");
+    env.observeAll(expected.data());
+    bool observed = observations == expected;
+    printf("observations: %s\n", observed ? "match" : "MISMATCH");
+    largePages.print();
+    return same && observed ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "image_decoder.h"
+#include "png_decoder.h"
+
+using namespace std;
+
+// Decodes every PNG of the texture set (and of any directories or files given, such
+// as a folder of player skins) with each image decoder, from memory so the disk is
+// not timed, and reports the median time per image and the throughput in
+// decoded megapixels per second. Every decoder's pixels must match stb_image's,
+// and the fast decoder must refuse the malformed streams checked first.
+//
+//   bench_decode [--runs=N] [path...]   (default path: ../textures)
+
+struct Source {
+    string path;
+    vector<unsigned char> bytes;
+    int width = 0, height = 0;
+};
+
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void addFile(const filesystem::path &path, vector<Source> &sources) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        printf("Cannot read %s\n", path.string().c_str());
+        return;
+    }
+    Source s;
+    s.path = path.string();
+    s.bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    sources.push_back(move(s));
+}
+
+// A dynamic block whose HDIST names 32 distance codes, two past deflate's 30, with
+// code lengths running zeros through all 286 + 32 of them; the inflater must refuse
+// it before storing a length past its table
+bool rejectsTooManyDistances() {
+    vector<uint8_t> stream = {0x78, 0x01};
+    uint32_t bits = 0;
+    int count = 0;
+    auto put = [&](uint32_t value, int n) {
+        bits |= value << count;
+        for (count += n; count >= 8; count -= 8, bits >>= 8) {
+            stream.push_back((uint8_t)bits);
+        }
+    };
+    put(1, 1);  // final
+    put(2, 2);  // dynamic
+    put(29, 5); // 286 literal/length codes
+    put(31, 5); // 32 distance codes
+    put(0, 4);  // code length codes for 16, 17, 18 and 0
+    put(0, 3);
+    put(0, 3);
+    put(1, 3); // 18: code 1
+    put(1, 3); // 0: code 0
+    for (int zeros : {138, 138, 42}) {
+        put(1, 1);
+        put(zeros - 11, 7);
+    }
+    put(0, 16);
+    vector<uint8_t> out(64);
+    PngInflater inflater;
+    return !inflater.inflate(stream.data(), stream.size(), out.data(), out.size());
+}
+
+int main(int argc, char **argv) {
+    int runs = 50;
+    vector<string> paths;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = max(1, atoi(argv[i] + 7));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.empty()) {
+        paths.push_back("../textures");
+    }
+
+    if (!rejectsTooManyDistances()) {
+        printf("The fast decoder accepts a deflate block with 32 distance codes\n");
+        return 1;
+    }
+
+    vector<Source> sources;
+    for (const string &path : paths) {
+        error_code ec;
+        if (!filesystem::is_directory(path, ec)) {
+            addFile(path, sources);
+            continue;
+        }
+        for (const auto &entry : filesystem::directory_iterator(path, ec)) {
+            if (entry.path().extension() == ".png") {
+                addFile(entry.path(), sources);
+            }
+        }
+    }
+    if (sources.empty()) {
+        printf("No PNGs to decode\n");
+        return 1;
+    }
+
+    // The reference pixels, and a check that every decoder reproduces them
+    bool mismatch = false;
+    for (Source &s : sources) {
+        unsigned char *reference = decodeImage(s.bytes.data(), s.bytes.size(), &s.width, &s.height, IMAGE_DECODER_STB);
+        if (!reference) {
+            printf("stb_image cannot decode %s\n", s.path.c_str());
+            return 1;
+        }
+        for (int k = 0; k < IMAGE_DECODERS; k++) {
+            int w = 0, h = 0;
+            unsigned char *pixels = decodeImage(s.bytes.data(), s.bytes.size(), &w, &h, (ImageDecoderKind)k);
+            if (!pixels || w != s.width || h != s.height || memcmp(pixels, reference, (size_t)w * h * 4) != 0) {
+                printf("%s decodes %s differently\n", IMAGE_DECODER_NAMES[k], s.path.c_str());
+                mismatch = true;
+            }
+            stbi_image_free(pixels);
+        }
+        stbi_image_free(reference);
+    }
+
+    printf("%d runs of each decoder, median ms per image\n  %-32s %10s %11s", runs, "", "bytes", "size");
+    for (int k = 0; k < IMAGE_DECODERS; k++) {
+        printf(" %9s", IMAGE_DECODER_NAMES[k]);
+    }
+    printf(" %8s\n", "speedup");
+    vector<double> total(IMAGE_DECODERS, 0.0);
+    double pixels = 0.0;
+    for (const Source &s : sources) {
+        string name = filesystem::path(s.path).filename().string();
+        char size[32];
+        snprintf(size, sizeof(size), "%dx%d", s.width, s.height);
+        printf("  %-32s %10zu %11s", name.c_str(), s.bytes.size(), size);
+        vector<double> median(IMAGE_DECODERS);
+        for (int k = 0; k < IMAGE_DECODERS; k++) {
+            vector<double> times;
+            for (int r = 0; r < runs; r++) {
+                int w, h;
+                auto start = chrono::steady_clock::now();
+                unsigned char *decoded = decodeImage(s.bytes.data(), s.bytes.size(), &w, &h, (ImageDecoderKind)k);
+                times.push_back(secondsSince(start));
+                stbi_image_free(decoded);
+            }
+            sort(times.begin(), times.end());
+            median[k] = times[times.size() / 2];
+            total[k] += median[k];
+            printf(" %9.3f", median[k] * 1000.0);
+        }
+        printf(" %7.2fx\n", median[IMAGE_DECODER_STB] / median[IMAGE_DECODER_FAST]);
+        pixels += (double)s.width * s.height;
+    }
+    printf("  %-55s", "all, megapixels per second:");
+    for (int k = 0; k < IMAGE_DECODERS; k++) {
+        printf(" %9.1f", pixels / total[k] / 1e6);
+    }
+    printf(" %7.2fx\n", total[IMAGE_DECODER_STB] / total[IMAGE_DECODER_FAST]);
+    return mismatch ? 1 : 0;
+}
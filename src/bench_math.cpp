@@ -0,0 +1,187 @@
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <vector>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <glm/simd/matrix.h>
+#endif
+#include "draw_list.h"
+#include "random.h"
+#include "sprite_kernel.h"
+
+using namespace std;
+using namespace glm;
+
+// Sprites per pass; a bit more than a full wave set so the inputs stay in L1/L2
+const int SPRITES = 4096;
+
+// Inputs for one pass, the same for every case
+struct SpriteInputs {
+    vector<vec2> centre, size;
+    vector<float> angle;
+    vector<vec4> texRect;
+};
+
+// Name of the instruction set glm was configured for in this build
+const char *glmArchName() {
+#if GLM_ARCH & GLM_ARCH_AVX2_BIT
+    return "AVX2";
+#elif GLM_ARCH & GLM_ARCH_AVX_BIT
+    return "AVX";
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+    return "SSE2";
+#else
+    return "pure C++";
+#endif
+}
+
+// Runs the pass over every sprite until at least minSeconds have passed; returns ns per sprite
+double measure(const function<float()> &pass, double minSeconds, float &sink) {
+    sink += pass(); // warm up
+    long long sprites = 0;
+    auto start = chrono::steady_clock::now();
+    double elapsed = 0.0;
+    while (elapsed < minSeconds) {
+        sink += pass();
+        sprites += SPRITES;
+        elapsed = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    return elapsed * 1e9 / sprites;
+}
+
+// Micro-benchmark of the per-sprite math: the old model/MVP mat4 built with
+// glm::translate/rotate/scale, the same with glm's SSE glm_mat4_mul for the MVP, and
+// the SpriteInstance 2D affine path the renderer uses. Build it once per instruction
+// set (see the Build Math Benchmark tasks) to compare GLM_FORCE_* configurations.
+// Usage: bench_math [seconds per case]
+int main(int argc, char **argv) {
+    double seconds = argc > 1 ? atof(argv[1]) : 0.5;
+
+    Pcg32 random;
+    random.seed(1, 0);
+    SpriteInputs in;
+    for (int i = 0; i < SPRITES; i++) {
+        in.centre.push_back(vec2(random.nextFloat() * 800.0f, random.nextFloat() * 600.0f));
+        in.size.push_back(vec2(50.0f, 50.0f));
+        in.angle.push_back(i % 2 ? random.nextFloat() * 360.0f : 0.0f); // half rotated, like ship + comets
+        in.texRect.push_back(vec4(0.0f, 0.0f, 1.0f, 1.0f));
+    }
+    mat4 projection = ortho(0.0f, 800.0f, 0.0f, 600.0f, -1.0f, 1.0f);
+    vector<mat4> matrices(SPRITES);
+    vector<SpriteInstance> instances(SPRITES);
+
+    struct Case {
+        const char *name;
+        function<float()> pass;
+    };
+    vector<Case> cases;
+
+    cases.push_back({"mat4 translate*rotate*scale", [&] {
+        for (int i = 0; i < SPRITES; i++) {
+            mat4 model = translate(mat4(1.0f), vec3(in.centre[i], 0.0f));
+            model = rotate(model, radians(in.angle[i]), vec3(0.0f, 0.0f, 1.0f));
+            model = scale(model, vec3(in.size[i], 1.0f));
+            matrices[i] = model;
+        }
+        return matrices[SPRITES - 1][3][0];
+    }});
+
+    cases.push_back({"mat4 model + glm MVP", [&] {
+        for (int i = 0; i < SPRITES; i++) {
+            mat4 model = translate(mat4(1.0f), vec3(in.centre[i], 0.0f));
+            model = rotate(model, radians(in.angle[i]), vec3(0.0f, 0.0f, 1.0f));
+            model = scale(model, vec3(in.size[i], 1.0f));
+            matrices[i] = projection * model;
+        }
+        return matrices[SPRITES - 1][3][0];
+    }});
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    cases.push_back({"mat4 model + glm_mat4_mul MVP", [&] {
+        glm_vec4 p[4], m[4], out[4];
+        for (int c = 0; c < 4; c++) {
+            p[c] = _mm_loadu_ps(&projection[c][0]);
+        }
+        for (int i = 0; i < SPRITES; i++) {
+            mat4 model = translate(mat4(1.0f), vec3(in.centre[i], 0.0f));
+            model = rotate(model, radians(in.angle[i]), vec3(0.0f, 0.0f, 1.0f));
+            model = scale(model, vec3(in.size[i], 1.0f));
+            for (int c = 0; c < 4; c++) {
+                m[c] = _mm_loadu_ps(&model[c][0]);
+            }
+            glm_mat4_mul(p, m, out);
+            for (int c = 0; c < 4; c++) {
+                _mm_storeu_ps(&matrices[i][c][0], out[c]);
+            }
+        }
+        return matrices[SPRITES - 1][3][0];
+    }});
+#endif
+
+    cases.push_back({"2D affine (makeSpriteInstance)", [&] {
+        for (int i = 0; i < SPRITES; i++) {
+            instances[i] = makeSpriteInstance(in.centre[i], in.size[i], in.angle[i], in.texRect[i]);
+        }
+        return instances[SPRITES - 1].rotation.x;
+    }});
+
+    cases.push_back({"2D affine, unrotated only", [&] {
+        for (int i = 0; i < SPRITES; i++) {
+            instances[i] = makeSpriteInstance(in.centre[i], in.size[i], 0.0f, in.texRect[i]);
+        }
+        return instances[SPRITES - 1].placement.x;
+    }});
+
+    // The renderer's extract: interpolate, cull and place every sprite, per sprite
+    // as drawSprite used to and then batched through the SIMD kernel, a recording
+    // job's worth at a time so the placements are still in cache when read back
+    const int EXTRACT_BLOCK = 1024;
+    vector<float> x(SPRITES), y(SPRITES), prevX(SPRITES), prevY(SPRITES), w(SPRITES), h(SPRITES), spin(SPRITES, 0.0f);
+    for (int i = 0; i < SPRITES; i++) {
+        x[i] = prevX[i] = in.centre[i].x;
+        y[i] = in.centre[i].y;
+        prevY[i] = y[i] + 2.5f;
+        w[i] = in.size[i].x;
+        h[i] = in.size[i].y;
+    }
+    SpriteSoA soa = {x.data(), y.data(), prevX.data(), prevY.data(), w.data(), h.data(), in.angle.data(), spin.data()};
+    vector<aligned_vec4> placement(SPRITES);
+    vector<uint8_t> visible(SPRITES);
+
+    cases.push_back({"extract per sprite", [&] {
+        for (int i = 0; i < SPRITES; i++) {
+            vec2 position(mix(prevX[i], x[i], 0.5f), mix(prevY[i], y[i], 0.5f));
+            vec2 half = in.angle[i] != 0.0f ? vec2(length(in.size[i] * 0.5f)) : in.size[i] * 0.5f;
+            if (position.x + half.x > 0.0f && position.x - half.x < 800.0f && position.y + half.y > 0.0f &&
+                position.y - half.y < 600.0f) {
+                instances[i] = makeSpriteInstance(position, in.size[i], in.angle[i], in.texRect[i]);
+            }
+        }
+        return instances[SPRITES - 1].placement.x;
+    }});
+
+    cases.push_back({"extract, placeSprites batch", [&] {
+        for (int block = 0; block < SPRITES; block += EXTRACT_BLOCK) {
+            placeSprites(soa, block, block + EXTRACT_BLOCK, 0.5f, 800.0f, 600.0f, placement.data(), visible.data());
+            for (int i = block; i < block + EXTRACT_BLOCK; i++) {
+                if (visible[i]) {
+                    instances[i] = makeSpriteInstance(vec2(placement[i].x, placement[i].y), vec2(placement[i].z, placement[i].w),
+                                                      in.angle[i], in.texRect[i]);
+                }
+            }
+        }
+        return instances[SPRITES - 1].placement.x;
+    }});
+
+    printf("glm arch: %s, %d sprites per pass\n", glmArchName(), SPRITES);
+    printf("%-34s %10s\n", "case", "ns/sprite");
+    float sink = 0.0f;
+    for (const Case &c : cases) {
+        printf("%-34s %10.2f\n", c.name, measure(c.pass, seconds, sink));
+    }
+    printf("(checksum %g)\n", sink);
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "net_session.h"
+#include "random.h"
+
+using namespace std;
+
+// Races a host and a rival over loopback through a relay that drops a share of the
+// datagrams each way, with the rival pressing in bursts longer than one packet
+// carries. Every press must reach the host with its tick, in order; reports the
+// traffic and how long the host took to catch up.
+//
+//   bench_net [--loss=0.2] [--presses=N] [--port=P]   (P and P+1 on 127.0.0.1)
+
+// Forwards datagrams between the host at hostPort and whoever talks to relayPort,
+// dropping each with probability loss
+void relay(uint16_t hostPort, uint16_t relayPort, double loss, const atomic<bool> &stop) {
+    UdpSocket toHost, toRival;
+    toHost.open(0);
+    toHost.setPeer("127.0.0.1:" + to_string(hostPort));
+    toRival.open(relayPort);
+    Pcg32 random(7, 1);
+    uint8_t packet[NetSession::MAX_PACKET];
+    sockaddr_in from{};
+    while (!stop) {
+        size_t size;
+        bool moved = false;
+        while ((size = toRival.receive(packet, sizeof(packet), from)) > 0) {
+            toRival.peer = from;
+            toRival.hasPeer = true;
+            if (random.next() >= loss * 4294967296.0) {
+                toHost.send(packet, size);
+            }
+            moved = true;
+        }
+        while ((size = toHost.receive(packet, sizeof(packet), from)) > 0) {
+            if (random.next() >= loss * 4294967296.0) {
+                toRival.send(packet, size);
+            }
+            moved = true;
+        }
+        if (!moved) {
+            this_thread::sleep_for(chrono::microseconds(200));
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    double loss = 0.2;
+    int presses = 500;
+    int port = 47310;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--loss=", 7) == 0) {
+            loss = atof(argv[i] + 7);
+        } else if (strncmp(argv[i], "--presses=", 10) == 0) {
+            presses = max(1, atoi(argv[i] + 10));
+        } else if (strncmp(argv[i], "--port=", 7) == 0) {
+            port = atoi(argv[i] + 7);
+        }
+    }
+
+    NetSession host, rival;
+    if (!host.host((uint16_t)port) || !rival.connect("127.0.0.1:" + to_string(port + 1))) {
+        printf("Cannot open ports %d and %d\n", port, port + 1);
+        return 1;
+    }
+    atomic<bool> stop{false};
+    thread relayThread(relay, (uint16_t)port, (uint16_t)(port + 1), loss, cref(stop));
+    bool hosted = false;
+    thread hostThread([&] {
+        uint64_t seed = 1;
+        float rate = 120.0f;
+        hosted = host.handshake(seed, rate, 3, 0, 5.0) && host.waitReady(5.0);
+    });
+    uint64_t seed = 0;
+    float rate = 0.0f;
+    bool joined = rival.handshake(seed, rate, 3, 0, 5.0) && rival.waitReady(5.0);
+    hostThread.join();
+    if (!hosted || !joined) {
+        stop = true;
+        relayThread.join();
+        printf("Handshake failed\n");
+        return 1;
+    }
+
+    // Bursts of presses a tick apart, several packets' worth each, then quiet ticks
+    // until the host has everything
+    vector<NetSession::Event> sent;
+    Pcg32 keys(3, 2);
+    const int BURST = (int)NetSession::MAX_EVENTS * 3;
+    auto start = chrono::steady_clock::now();
+    uint64_t tick = 0;
+    double seconds = 0.0;
+    while (seconds < 20.0) {
+        if ((int)sent.size() < presses && tick % 10 == 0) {
+            for (int i = 0; i < BURST && (int)sent.size() < presses; i++) {
+                int key = keys.next() & 1 ? GLFW_KEY_RIGHT : GLFW_KEY_LEFT;
+                uint64_t at = tick + i / 4; // a few presses share a tick
+                rival.pressed(at, key);
+                sent.push_back({at, key});
+            }
+            tick += BURST / 4;
+        }
+        tick++;
+        rival.ticked(tick);
+        host.ticked(tick);
+        rival.poll();
+        host.poll();
+        if ((int)sent.size() == presses && host.remoteThrough > sent.back().tick) {
+            break;
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+        seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    }
+    seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    stop = true;
+    relayThread.join();
+
+    bool same = host.inbox.size() == sent.size();
+    for (size_t i = 0; same && i < sent.size(); i++) {
+        same = host.inbox[i].tick == sent[i].tick && host.inbox[i].key == sent[i].key;
+    }
+    printf("%d presses at %.0f%% loss: %zu arrived in %.2f s\n", presses, loss * 100.0, host.inbox.size(), seconds);
+    printf("rival ");
+    rival.print();
+    printf("host  ");
+    host.print();
+    if (!same) {
+        printf("The host's presses differ from the rival's\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "lockfree_queue.h"
+
+using namespace std;
+
+const uint32_t RING = 1024;
+
+// Baseline the queues replace: a deque behind a mutex, bounded like the rings
+struct MutexQueue {
+    mutex lock;
+    deque<uint64_t> items;
+
+    bool push(uint64_t value) {
+        lock_guard<mutex> guard(lock);
+        if (items.size() == RING) {
+            return false;
+        }
+        items.push_back(value);
+        return true;
+    }
+
+    bool pop(uint64_t &value) {
+        lock_guard<mutex> guard(lock);
+        if (items.empty()) {
+            return false;
+        }
+        value = items.front();
+        items.pop_front();
+        return true;
+    }
+};
+
+double secondsSince(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// One producer thread pushes 0..count-1 while this thread pops them; every value must
+// arrive once and in order. Both sides yield when the queue is full or empty, so the
+// run also works on a single core. Returns items per second, or -1 on a mismatch.
+template <typename Queue>
+double oneToOne(Queue &queue, uint64_t count) {
+    auto start = chrono::steady_clock::now();
+    thread producer([&] {
+        for (uint64_t i = 0; i < count; i++) {
+            while (!queue.push(i)) {
+                this_thread::yield();
+            }
+        }
+    });
+    bool ordered = true;
+    for (uint64_t expected = 0; expected < count;) {
+        uint64_t value;
+        if (!queue.pop(value)) {
+            this_thread::yield();
+            continue;
+        }
+        ordered &= value == expected++;
+    }
+    producer.join();
+    double seconds = secondsSince(start);
+    return ordered ? count / seconds : -1.0;
+}
+
+// producers threads push count items between them, each tagged with its producer; the
+// consumer checks each producer's items come out in its order and none go missing
+double manyToOne(MpscQueue<uint64_t, RING> &queue, int producers, uint64_t count) {
+    const int TAG = 40;
+    uint64_t each = count / producers;
+    auto start = chrono::steady_clock::now();
+    vector<thread> threads;
+    for (int p = 0; p < producers; p++) {
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 0; i < each; i++) {
+                while (!queue.push((uint64_t)p << TAG | i)) {
+                    this_thread::yield();
+                }
+            }
+        });
+    }
+    vector<uint64_t> next(producers, 0);
+    bool ordered = true;
+    for (uint64_t received = 0; received < each * producers;) {
+        uint64_t value;
+        if (!queue.pop(value)) {
+            this_thread::yield();
+            continue;
+        }
+        int p = (int)(value >> TAG);
+        ordered &= p < producers && (value & ((1ull << TAG) - 1)) == next[p]++;
+        received++;
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+    double seconds = secondsSince(start);
+    return ordered ? each * producers / seconds : -1.0;
+}
+
+// Indices wrap at 2^32: start an SPSC ring just short of it and push past the wrap
+bool wrapsAround() {
+    static SpscQueue<uint64_t, 8> queue;
+    uint32_t start = 0xFFFFFFF0u;
+    queue.head = start;
+    queue.tail = start;
+    queue.tailCache = start;
+    queue.headCache = start;
+    uint64_t in = 0, out = 0;
+    bool ok = true;
+    for (int round = 0; round < 16; round++) {
+        while (queue.push(in)) {
+            in++;
+        }
+        uint64_t value;
+        for (int i = 0; i < 5 && queue.pop(value); i++) {
+            ok &= value == out++;
+        }
+    }
+    for (uint64_t value; queue.pop(value);) {
+        ok &= value == out++;
+    }
+    return ok && in == out && queue.size() == 0;
+}
+
+// Items per second through the shared lock-free queues against a mutex-guarded deque,
+// with one producer and with several. Every run checks order and completeness, and
+// a mismatch fails the benchmark.
+// Usage: bench_queues [items]
+int main(int argc, char **argv) {
+    uint64_t items = argc > 1 ? strtoull(argv[1], nullptr, 10) : 10000000;
+    int producers = (int)std::max(2u, std::min(thread::hardware_concurrency(), 4u));
+    bool ok = wrapsAround();
+    printf("index wrap: %s\n", ok ? "ok" : "MISMATCH");
+
+    auto report = [&](const char *name, double rate) {
+        printf("%-22s %12.3g items/s%s\n", name, rate, rate < 0 ? " MISMATCH" : "");
+        ok &= rate >= 0;
+    };
+    static SpscQueue<uint64_t, RING> spsc;
+    static MpscQueue<uint64_t, RING> mpsc, mpscSingle;
+    static MutexQueue locked;
+    printf("%llu items, ring of %u\n", (unsigned long long)items, RING);
+    report("spsc", oneToOne(spsc, items));
+    report("mpsc, 1 producer", oneToOne(mpscSingle, items));
+    report("mutex deque", oneToOne(locked, items));
+    char name[32];
+    snprintf(name, sizeof(name), "mpsc, %d producers", producers);
+    report(name, manyToOne(mpsc, producers, items));
+    return ok ? 0 : 1;
+}
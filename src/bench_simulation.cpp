@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "broadphase.h"
+#include "entity_pool.h"
+#include "job_system.h"
+#include "quantized_comets.h"
+#include "random.h"
+
+using namespace std;
+
+// Same playfield as the game
+const int LANE_COUNT = 3;
+const float WIDTH = 800.0f, HEIGHT = 600.0f;
+const float LANE_WIDTH = WIDTH / LANE_COUNT;
+const float COMET_SPEED = 300.0f;
+const float SPAWN_Y = HEIGHT + 50, DESPAWN_Y = -50;
+const uint32_t MOTION_GRAIN = 8192;
+const float STEP = 1.0f / 120.0f;
+
+// Hardware counters for the calling thread (Linux perf events); unavailable elsewhere
+// or when perf_event_paranoid forbids them, in which case every read is -1
+struct CacheCounters {
+    int misses = -1, references = -1;
+
+#ifdef __linux__
+    static int open(uint64_t config) {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+    }
+#endif
+
+    CacheCounters() {
+#ifdef __linux__
+        misses = open(PERF_COUNT_HW_CACHE_MISSES);
+        references = open(PERF_COUNT_HW_CACHE_REFERENCES);
+#endif
+    }
+
+    ~CacheCounters() {
+#ifdef __linux__
+        if (misses >= 0) close(misses);
+        if (references >= 0) close(references);
+#endif
+    }
+
+    bool available() const {
+        return misses >= 0;
+    }
+
+    void start() {
+#ifdef __linux__
+        for (int fd : {misses, references}) {
+            if (fd >= 0) {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+#endif
+    }
+
+    // Counts since start(): cache misses and references
+    void stop(long long &missCount, long long &referenceCount) {
+        missCount = referenceCount = -1;
+#ifdef __linux__
+        if (misses >= 0) {
+            ioctl(misses, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(misses, &missCount, sizeof(missCount)) != sizeof(missCount)) missCount = -1;
+        }
+        if (references >= 0) {
+            ioctl(references, PERF_EVENT_IOC_DISABLE, 0);
+            if (read(references, &referenceCount, sizeof(referenceCount)) != sizeof(referenceCount)) referenceCount = -1;
+        }
+#endif
+    }
+};
+
+// The simulation step under test: comets fall, the ones below the screen go back to
+// the top (what resetComet used to do, so the count stays fixed), and every comet is
+// tested against the ship
+struct Scenario {
+    EntityPool pool;
+    QuantizedComets compact; // the same comets in the 6-byte layout, without the ship
+    Broadphase broadphase;
+    vector<uint32_t> hits;
+    uint32_t ship = 0;
+
+    void setup(uint32_t comets) {
+        pool = EntityPool();
+        pool.reserve(comets + 1);
+        pool.create(WIDTH / 2, 50, 50, 50, 0.0f, 1, 0);
+        Pcg32 random;
+        random.seed(1, 0);
+        for (uint32_t i = 0; i < comets; i++) {
+            int lane = (int)random.nextBelow(LANE_COUNT);
+            float y = DESPAWN_Y + random.nextFloat() * (SPAWN_Y - DESPAWN_Y);
+            pool.create(LANE_WIDTH / 2 + lane * LANE_WIDTH, y, 50, 50, -COMET_SPEED, (int8_t)lane, 1);
+        }
+        compact = QuantizedComets();
+        compact.setup(LANE_WIDTH, DESPAWN_Y, SPAWN_Y - DESPAWN_Y, {{50, 50}});
+        compact.reserve(comets);
+        for (uint32_t i = 1; i < pool.size(); i++) {
+            compact.create(pool.y[i], pool.vy[i], STEP, pool.lane[i], 0);
+        }
+        broadphase.setup(LANE_COUNT, WIDTH, HEIGHT, 64.0f);
+        hits.reserve(comets + 1);
+        ship = 0;
+    }
+
+    void respawn(uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            if (pool.y[i] < DESPAWN_Y) {
+                pool.y[i] += SPAWN_Y - DESPAWN_Y;
+            }
+        }
+    }
+
+    // One fused loop, kept scalar so it is the baseline
+#if defined(__GNUC__) && !defined(__clang__)
+    __attribute__((optimize("no-tree-vectorize")))
+#endif
+    void stepScalar() {
+        float sx = pool.x[ship], sy = pool.y[ship], shw = pool.width[ship] / 2, shh = pool.height[ship] / 2;
+        hits.clear();
+        for (uint32_t i = 0; i < pool.size(); i++) {
+            pool.y[i] += pool.vy[i] * STEP;
+            if (pool.y[i] < DESPAWN_Y) {
+                pool.y[i] += SPAWN_Y - DESPAWN_Y;
+            }
+            if (i != ship && fabs(pool.x[i] - sx) < shw + pool.width[i] / 2 && fabs(pool.y[i] - sy) < shh + pool.height[i] / 2) {
+                hits.push_back(i);
+            }
+        }
+    }
+
+    // Vectorised motion, then the broadphase and the SIMD lane kernel, as updateGame does;
+    // jobs spreads motion and the long lanes over worker threads
+    void stepBroadphase(JobSystem *jobs) {
+        uint32_t n = (uint32_t)pool.size();
+        auto motion = [this](uint32_t begin, uint32_t end) {
+            float *y = pool.y.data();
+            const float *vy = pool.vy.data();
+            for (uint32_t i = begin; i < end; i++) {
+                y[i] += vy[i] * STEP;
+            }
+            respawn(begin, end);
+        };
+        if (jobs) {
+            jobs->parallelFor(n, MOTION_GRAIN, motion);
+        } else {
+            motion(0, n);
+        }
+        float shw = pool.width[ship] / 2, shh = pool.height[ship] / 2;
+        broadphase.build(pool);
+        hits.clear();
+        broadphase.overlapLanes(pool.lane[ship], pool.lane[ship], pool.x[ship], pool.y[ship], shw, shh, hits, jobs);
+        hits.erase(remove(hits.begin(), hits.end(), ship), hits.end()); // the ship's own lane slot
+    }
+
+    // Fixed-point motion and the lane and height test straight on the compact layout;
+    // jobs spreads the motion
+    void stepQuantized(JobSystem *jobs) {
+        uint32_t n = (uint32_t)compact.size();
+        auto motion = [this](uint32_t begin, uint32_t end) {
+            compact.move(begin, end);
+        };
+        if (jobs) {
+            jobs->parallelFor(n, MOTION_GRAIN, motion);
+        } else {
+            motion(0, n);
+        }
+        hits.clear();
+        compact.overlap(0, n, pool.lane[ship], pool.lane[ship], pool.x[ship], pool.y[ship], pool.width[ship] / 2,
+                        pool.height[ship] / 2, hits);
+    }
+};
+
+// Simulation step scaling from 1 to 1M comets in five variants: a scalar fused loop,
+// the game's broadphase with the SIMD kernel on one thread, the same spread over the
+// job system, and the quantized layout on one thread and over the job system. Reports ns per entity per step and, on Linux when perf events are
+// permitted, cache misses per entity on the calling thread.
+// Usage: bench_simulation [max entities] [worker threads]
+int main(int argc, char **argv) {
+    uint32_t maxEntities = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000000;
+    unsigned threads = argc > 2 ? (unsigned)atoi(argv[2]) : max(1u, thread::hardware_concurrency()) - 1;
+
+    JobSystem jobs;
+    jobs.start(threads);
+    CacheCounters counters;
+    Scenario scenario;
+
+    printf("%u worker threads; cache counters %s\n", threads, counters.available() ? "on (calling thread only)" : "unavailable");
+    printf("%10s  %-12s %12s %14s %14s %10s\n", "entities", "variant", "ns/entity", "misses/entity", "miss rate", "hits");
+
+    const char *names[5] = {"scalar", "simd", "threaded", "quantized", "quantized-mt"};
+    for (uint32_t n = 1; n <= maxEntities; n *= 10) {
+        int steps = (int)max<uint32_t>(20, 20000000 / n);
+        for (int variant = 0; variant < 5; variant++) {
+            scenario.setup(n);
+            function<void()> step = [&] {
+                if (variant == 0) {
+                    scenario.stepScalar();
+                } else if (variant <= 2) {
+                    scenario.stepBroadphase(variant == 2 ? &jobs : nullptr);
+                } else {
+                    scenario.stepQuantized(variant == 4 ? &jobs : nullptr);
+                }
+            };
+            step(); // warm up caches and the broadphase buffers
+
+            long long misses, references;
+            counters.start();
+            auto start = chrono::steady_clock::now();
+            for (int s = 0; s < steps; s++) {
+                step();
+            }
+            double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+            counters.stop(misses, references);
+
+            double entities = (double)(n + 1) * steps;
+            char missText[32] = "n/a", rateText[32] = "n/a";
+            if (misses >= 0) {
+                snprintf(missText, sizeof(missText), "%.3f", misses / entities);
+            }
+            if (misses >= 0 && references > 0) {
+                snprintf(rateText, sizeof(rateText), "%.1f%%", 100.0 * misses / references);
+            }
+            printf("%10u  %-12s %12.2f %14s %14s %10zu\n", n, names[variant], ns / entities, missText, rateText,
+                   scenario.hits.size());
+        }
+    }
+    jobs.stop();
+    return 0;
+}
@@ -0,0 +1,211 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Launches the game over and over with --exit-after-first-frame and
+// --startup-trace, and reports time to first frame and each startup phase across
+// the runs. Cold runs come first in each pair: the page cache is dropped before them
+// (Linux, as root; elsewhere, or unprivileged, they only differ in the shader
+// cache) and, with --cold-shaders, the shader cache directory is deleted so every
+// program compiles from source. The warm run right after reuses whatever the cold
+// one left behind.
+//
+//   bench_startup [--runs=N] [--game=path] [--cold-shaders] [--warm-only] [-- game args...]
+
+const char *TRACE_PATH = "bench_startup_trace.json";
+const char *LOG_PATH = "bench_startup_log.txt";
+const char *SHADER_CACHE = "shader_cache"; // the game's default --shader-cache
+
+struct Run {
+    double firstFrameMs = -1.0; // launch to first present; -1 if the game never said
+    double exitMs = 0.0;        // launch to process exit
+    map<string, double> phases; // startup trace spans, summed by name, ms
+};
+
+struct Summary {
+    double median, mean, stddev, low, high;
+};
+
+Summary summarize(vector<double> values) {
+    Summary s = {0.0, 0.0, 0.0, 0.0, 0.0};
+    if (values.empty()) {
+        return s;
+    }
+    sort(values.begin(), values.end());
+    size_t n = values.size();
+    s.median = n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+    for (double v : values) {
+        s.mean += v / n;
+    }
+    for (double v : values) {
+        s.stddev += (v - s.mean) * (v - s.mean) / max<size_t>(n - 1, 1);
+    }
+    s.stddev = sqrt(s.stddev);
+    s.low = values.front();
+    s.high = values.back();
+    return s;
+}
+
+// Drop clean pages so the executable, its libraries and the assets come off disk;
+// false when the OS or the privileges do not allow it
+bool dropPageCache() {
+#ifdef __linux__
+    sync();
+    FILE *f = fopen("/proc/sys/vm/drop_caches", "w");
+    if (!f) {
+        return false;
+    }
+    bool dropped = fputs("3\n", f) >= 0;
+    return fclose(f) == 0 && dropped;
+#else
+    return false;
+#endif
+}
+
+// The spans TraceRecorder::write() puts one per line: name, then ts and dur in µs
+map<string, double> readTrace(const char *path) {
+    map<string, double> phases;
+    ifstream in(path);
+    string line;
+    while (getline(in, line)) {
+        size_t name = line.find("{\"name\":\"");
+        size_t dur = line.find("\"dur\":");
+        if (name == string::npos || dur == string::npos || line.find("\"ph\":\"X\"") == string::npos) {
+            continue;
+        }
+        name += 9;
+        phases[line.substr(name, line.find('"', name) - name)] += atof(line.c_str() + dur + 6) / 1000.0;
+    }
+    return phases;
+}
+
+Run launch(const string &command) {
+    Run run;
+    remove(TRACE_PATH);
+    auto start = chrono::steady_clock::now();
+    int status = system(command.c_str());
+    auto end = chrono::steady_clock::now();
+    run.exitMs = chrono::duration<double, milli>(end - start).count();
+    if (status != 0) {
+        printf("  game exited with status %d; see %s\n", status, LOG_PATH);
+    }
+    // The game prints the present's instant on the same steady clock
+    ifstream log(LOG_PATH);
+    string line;
+    const char *marker = "First frame presented at ";
+    while (getline(log, line)) {
+        if (line.compare(0, strlen(marker), marker) == 0) {
+            long long ns = atoll(line.c_str() + strlen(marker));
+            run.firstFrameMs = (ns - chrono::duration_cast<chrono::nanoseconds>(start.time_since_epoch()).count()) / 1e6;
+        }
+    }
+    run.phases = readTrace(TRACE_PATH);
+    return run;
+}
+
+void report(const char *label, const vector<Run> &runs) {
+    if (runs.empty()) {
+        return;
+    }
+    vector<double> firstFrame, exit;
+    vector<string> names;
+    for (const Run &run : runs) {
+        if (run.firstFrameMs >= 0.0) {
+            firstFrame.push_back(run.firstFrameMs);
+        }
+        exit.push_back(run.exitMs);
+        for (const auto &phase : run.phases) {
+            if (find(names.begin(), names.end(), phase.first) == names.end()) {
+                names.push_back(phase.first);
+            }
+        }
+    }
+    printf("\n%s, %zu runs (ms)\n  %-28s %9s %9s %9s %9s %9s\n", label, runs.size(), "", "median", "mean", "stddev", "min",
+           "max");
+    auto row = [](const char *name, const vector<double> &values) {
+        Summary s = summarize(values);
+        printf("  %-28s %9.2f %9.2f %9.2f %9.2f %9.2f\n", name, s.median, s.mean, s.stddev, s.low, s.high);
+    };
+    row("time to first frame", firstFrame);
+    row("time to exit", exit);
+    for (const string &name : names) {
+        vector<double> values;
+        for (const Run &run : runs) {
+            auto it = run.phases.find(name);
+            values.push_back(it == run.phases.end() ? 0.0 : it->second);
+        }
+        row(("  " + name).c_str(), values);
+    }
+}
+
+int main(int argc, char **argv) {
+    int runs = 10;
+#ifdef _WIN32
+    string game = "game.exe";
+#else
+    string game = "./game";
+#endif
+    bool coldShaders = false, warmOnly = false;
+    string gameArgs;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--runs=", 7) == 0) {
+            runs = max(1, atoi(arg + 7));
+        } else if (strncmp(arg, "--game=", 7) == 0) {
+            game = arg + 7;
+        } else if (strcmp(arg, "--cold-shaders") == 0) {
+            coldShaders = true;
+        } else if (strcmp(arg, "--warm-only") == 0) {
+            warmOnly = true;
+        } else if (strcmp(arg, "--") == 0) {
+            for (i++; i < argc; i++) {
+                gameArgs += string(" ") + argv[i];
+            }
+        } else {
+            printf("Unknown option %s\n", arg);
+            return 1;
+        }
+    }
+    ostringstream command;
+    command << "\"" << game << "\" --exit-after-first-frame --startup-trace=" << TRACE_PATH << gameArgs << " > " << LOG_PATH
+            << " 2>&1";
+
+    printf("Launching %s %d times%s\n", game.c_str(), runs, warmOnly ? ", warm only" : ", cold then warm");
+    launch(command.str()); // one untimed run, so the first warm run is not the first run
+    vector<Run> cold, warm;
+    bool dropped = true;
+    for (int i = 0; i < runs; i++) {
+        if (!warmOnly) {
+            if (coldShaders) {
+                error_code ignored;
+                filesystem::remove_all(SHADER_CACHE, ignored);
+            }
+            dropped &= dropPageCache();
+            cold.push_back(launch(command.str()));
+        }
+        warm.push_back(launch(command.str()));
+        printf("  run %d: cold %.1f ms, warm %.1f ms to first frame\n", i + 1, warmOnly ? 0.0 : cold.back().firstFrameMs,
+               warm.back().firstFrameMs);
+    }
+    if (!warmOnly && !dropped) {
+        printf("Page cache not dropped (needs Linux and root): cold runs read files the OS had cached\n");
+    }
+    report(coldShaders ? "Cold, page and shader caches empty" : "Cold, page cache empty", cold);
+    report("Warm", warm);
+    remove(TRACE_PATH);
+    return 0;
+}
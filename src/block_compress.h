@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// BC3 (S3TC DXT5) encoder for the bake tool. Each 4x4 block becomes 16 bytes: an
+// interpolated alpha block followed by a four-colour BC1 block, so RGBA8 shrinks
+// 4x. Endpoints come from the block's bounding box, inset slightly to cut the error
+// of the interpolated palette entries; this is fast rather than optimal, which is
+// fine for flat sprite art. Partial blocks at the edges repeat their last texel.
+
+// Pack 8-bit RGB to 5:6:5, rounding
+inline uint16_t packRgb565(int r, int g, int b) {
+    return (uint16_t)(((r * 31 + 127) / 255) << 11 | ((g * 63 + 127) / 255) << 5 | ((b * 31 + 127) / 255));
+}
+
+inline void unpackRgb565(uint16_t c, int rgb[3]) {
+    rgb[0] = ((c >> 11) & 31) * 255 / 31;
+    rgb[1] = ((c >> 5) & 63) * 255 / 63;
+    rgb[2] = (c & 31) * 255 / 31;
+}
+
+// Encode one block of 16 RGBA texels (row-major) into 16 bytes
+inline void compressBc3Block(const unsigned char texels[16][4], unsigned char out[16]) {
+    // Alpha: two endpoints and eight-step interpolation (a0 > a1 mode)
+    int aMin = 255, aMax = 0;
+    for (int i = 0; i < 16; i++) {
+        aMin = std::min(aMin, (int)texels[i][3]);
+        aMax = std::max(aMax, (int)texels[i][3]);
+    }
+    out[0] = (unsigned char)aMax;
+    out[1] = (unsigned char)aMin;
+    uint64_t alphaBits = 0;
+    if (aMax > aMin) {
+        int palette[8] = {aMax, aMin};
+        for (int k = 1; k < 7; k++) {
+            palette[k + 1] = ((7 - k) * aMax + k * aMin) / 7;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 256;
+            for (int k = 0; k < 8; k++) {
+                int error = std::abs(palette[k] - texels[i][3]);
+                if (error < bestError) {
+                    best = k;
+                    bestError = error;
+                }
+            }
+            alphaBits |= (uint64_t)best << (3 * i);
+        }
+    }
+    for (int b = 0; b < 6; b++) {
+        out[2 + b] = (unsigned char)(alphaBits >> (8 * b));
+    }
+
+    // Colour: bounding box endpoints inset by 1/16 of the range
+    int lo[3] = {255, 255, 255}, hi[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], (int)texels[i][c]);
+            hi[c] = std::max(hi[c], (int)texels[i][c]);
+        }
+    }
+    for (int c = 0; c < 3; c++) {
+        int inset = (hi[c] - lo[c]) / 16;
+        lo[c] += inset;
+        hi[c] -= inset;
+    }
+    uint16_t c0 = packRgb565(hi[0], hi[1], hi[2]);
+    uint16_t c1 = packRgb565(lo[0], lo[1], lo[2]);
+    uint32_t colorBits = 0;
+    if (c0 < c1) {
+        std::swap(c0, c1); // c0 > c1 selects four-colour mode
+    }
+    if (c0 != c1) {
+        int palette[4][3];
+        unpackRgb565(c0, palette[0]);
+        unpackRgb565(c1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            int best = 0, bestError = 1 << 30;
+            for (int k = 0; k < 4; k++) {
+                int dr = palette[k][0] - texels[i][0], dg = palette[k][1] - texels[i][1], db = palette[k][2] - texels[i][2];
+                int error = dr * dr + dg * dg + db * db;
+                if (error < bestError) {
+                    best = k;
+                    bestError = error;
+                }
+            }
+            colorBits |= (uint32_t)best << (2 * i);
+        }
+    }
+    out[8] = (unsigned char)c0;
+    out[9] = (unsigned char)(c0 >> 8);
+    out[10] = (unsigned char)c1;
+    out[11] = (unsigned char)(c1 >> 8);
+    for (int b = 0; b < 4; b++) {
+        out[12 + b] = (unsigned char)(colorBits >> (8 * b));
+    }
+}
+
+// Bytes of a BC level: 16 per 4x4 block, partial blocks included
+inline size_t bcLevelBytes(uint32_t width, uint32_t height) {
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * 16;
+}
+
+// Encode a whole RGBA8 image into BC3 blocks, row of blocks by row of blocks
+inline std::vector<unsigned char> compressBc3(const unsigned char *rgba, uint32_t width, uint32_t height) {
+    std::vector<unsigned char> out(bcLevelBytes(width, height));
+    unsigned char texels[16][4];
+    size_t block = 0;
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            for (int i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx + (i & 3), width - 1), y = std::min(by + (i >> 2), height - 1);
+                std::memcpy(texels[i], rgba + ((size_t)y * width + x) * 4, 4);
+            }
+            compressBc3Block(texels, &out[block * 16]);
+            block++;
+        }
+    }
+    return out;
+}
+
+// Decode the alpha of a BC3 image into one byte per texel (width * height), for CPU
+// work on baked art such as collision masks; the colour half is skipped
+inline void decompressBc3Alpha(const unsigned char *blocks, uint32_t width, uint32_t height, unsigned char *alpha) {
+    size_t block = 0;
+    for (uint32_t by = 0; by < height; by += 4) {
+        for (uint32_t bx = 0; bx < width; bx += 4) {
+            const unsigned char *in = blocks + block * 16;
+            int a0 = in[0], a1 = in[1];
+            int palette[8] = {a0, a1};
+            if (a0 > a1) {
+                for (int k = 1; k < 7; k++) {
+                    palette[k + 1] = ((7 - k) * a0 + k * a1) / 7;
+                }
+            } else {
+                for (int k = 1; k < 5; k++) {
+                    palette[k + 1] = ((5 - k) * a0 + k * a1) / 5;
+                }
+                palette[6] = 0;
+                palette[7] = 255;
+            }
+            uint64_t bits = 0;
+            for (int b = 0; b < 6; b++) {
+                bits |= (uint64_t)in[2 + b] << (8 * b);
+            }
+            for (int i = 0; i < 16; i++) {
+                uint32_t x = bx + (i & 3), y = by + (i >> 2);
+                if (x < width && y < height) {
+                    alpha[(size_t)y * width + x] = (unsigned char)palette[(bits >> (3 * i)) & 7];
+                }
+            }
+            block++;
+        }
+    }
+}
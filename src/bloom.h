@@ -0,0 +1,272 @@
+#pragma once
+
+#include <algorithm>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_markers.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "render_graph.h"
+#include "shader_program.h"
+#include "view_transform.h"
+
+// Glow around bright sprites. The scene is drawn into a float colour buffer instead
+// of its target; the bright pass thresholds it into a half-resolution level, which
+// is blurred along each axis, downsampled to a quarter and blurred again, and one
+// last pass adds both levels to the scene in the region of the target it would
+// have been drawn to. No pass reads a full-resolution neighbourhood, so the chain
+// costs a fraction of one full-resolution blur; without the half level (halfLevel
+// off, for integrated GPUs) the bright pass goes straight to a quarter. The levels
+// are RenderGraph targets, so each blur's intermediate shares a texture with the
+// level it came from, and every pass is timed by the graph. Everything is
+// R11F_G11F_B10F, as many bytes as RGBA8; the scene buffer is allocated for the
+// full viewport, so dynamic resolution only changes the region drawn.
+struct Bloom {
+    static const GLenum FORMAT = GL_R11F_G11F_B10F; // the scene's, so an MSAA buffer resolving into it must match
+    static constexpr float THRESHOLD = 0.8f, KNEE = 0.3f;
+    static constexpr float HALF_WEIGHT = 0.5f, QUARTER_WEIGHT = 0.7f;
+
+    // A pass's program and the uniforms it is fed every frame
+    struct Program {
+        ShaderProgram program;
+        int mapping = -1, texel = -1, uvMax = -1, threshold = -1, knee = -1;
+
+        void link(const ShaderProgram &linked) {
+            program = linked;
+            mapping = program.find("mapping");
+            texel = program.find("texel");
+            uvMax = program.find("uvMax");
+            threshold = program.find("threshold");
+            knee = program.find("knee");
+        }
+    };
+
+    bool enabled = false;
+    bool halfLevel = true;
+    GLuint fbo = 0, scene = 0, depth = 0;
+    GLuint vertexArray = 0; // the fullscreen triangle needs no attributes
+    GLuint sampler = 0;     // linear, clamped
+    Program down, blur;
+    ShaderProgram composite;
+    int origin = -1, sceneScale = -1, halfScale = -1, quarterScale = -1, halfMax = -1, quarterMax = -1; // composite's uniforms
+    int width = 0, height = 0; // allocated size of the scene buffer
+    glm::vec4 region;          // where in the destination the scene goes: xy = origin, zw = size
+    int passes = 0;            // draws issued by the last frame's passes
+
+    // This frame's graph targets, and the sizes of the level regions drawn into them
+    int sceneTarget = -1, destination = -1;
+    int bright = -1, halfX = -1, halfBlurred = -1, quarter = -1, quarterX = -1, quarterBlurred = -1;
+    int halfW = 1, halfH = 1, quarterW = 1, quarterH = 1;
+
+    // Programs over the fullscreen triangle: downProgram runs bloom_down.frag.glsl,
+    // blurProgram bloom_blur.frag.glsl and compositeProgram bloom_composite.frag.glsl
+    void setup(const ShaderProgram &downProgram, const ShaderProgram &blurProgram, const ShaderProgram &compositeProgram,
+               GLuint linearSampler, bool withHalfLevel) {
+        enabled = true;
+        halfLevel = withHalfLevel;
+        sampler = linearSampler;
+        down.link(downProgram);
+        blur.link(blurProgram);
+        composite = compositeProgram;
+        origin = composite.find("origin");
+        sceneScale = composite.find("sceneScale");
+        halfScale = composite.find("halfScale");
+        quarterScale = composite.find("quarterScale");
+        halfMax = composite.find("halfMax");
+        quarterMax = composite.find("quarterMax");
+        down.program.use();
+        down.program.set(down.program.find("source"), 0);
+        down.program.set(down.knee, KNEE);
+        blur.program.use();
+        blur.program.set(blur.program.find("source"), 0);
+        composite.use();
+        composite.set(composite.find("scene"), 0);
+        composite.set(composite.find("halfLevel"), 1);
+        composite.set(composite.find("quarterLevel"), 2);
+        composite.set(composite.find("weights"), glm::vec2(halfLevel ? HALF_WEIGHT : 0.0f, QUARTER_WEIGHT));
+
+        vertexArray = createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, vertexArray, MEM_BUFFERS, 0);
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &depth);
+    }
+
+    // Reallocate the scene buffer for a viewport of the given size; a no-op when it is unchanged
+    void resize(int w, int h) {
+        if (w == width && h == height) {
+            return;
+        }
+        width = w;
+        height = h;
+        if (scene) {
+            memoryStats.untrackGl(GL_TEXTURE, scene);
+            glState.deleteTextures(1, &scene);
+        }
+        scene = createTexture2D();
+        textureStorage2D(scene, 1, FORMAT, width, height);
+        memoryStats.trackGl(GL_TEXTURE, scene, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glMarkers.label(GL_TEXTURE, scene, "bloom scene");
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, depth, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, scene, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glMarkers.label(GL_FRAMEBUFFER, fbo, "bloom scene");
+    }
+
+    // Redirect drawing meant for the given region of the destination into the scene buffer
+    void begin(const ViewTransform &view, const glm::vec4 &targetRegion) {
+        if (!enabled) {
+            return;
+        }
+        region = targetRegion;
+        resize(view.width, view.height);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.drawInto((int)region.z, (int)region.w);
+    }
+
+    // The scene buffer as a graph target, for a pass that writes it (an MSAA resolve)
+    int importScene(RenderGraph &graph) {
+        sceneTarget = graph.import("bloom scene", fbo, scene, {FORMAT, width, height});
+        return sceneTarget;
+    }
+
+    // Declare the chain, from the imported scene buffer to the region of target
+    // given to begin(); the composite leaves that region bound with blending and
+    // depth testing off
+    void addPasses(RenderGraph &graph, int target) {
+        destination = target;
+        passes = 0;
+        const int w = (int)region.z, h = (int)region.w;
+        halfW = std::max(w / 2, 1);
+        halfH = std::max(h / 2, 1);
+        quarterW = std::max(w / 4, 1);
+        quarterH = std::max(h / 4, 1);
+        RenderGraph::TargetDesc halfDesc = {FORMAT, std::max(width / 2, 1), std::max(height / 2, 1)};
+        RenderGraph::TargetDesc quarterDesc = {FORMAT, std::max(width / 4, 1), std::max(height / 4, 1)};
+
+        quarter = graph.create("bloom quarter", quarterDesc);
+        if (halfLevel) {
+            bright = graph.create("bloom bright", halfDesc);
+            halfX = graph.create("bloom half x", halfDesc);
+            halfBlurred = graph.create("bloom half", halfDesc);
+            graph.pass("bloom bright", {sceneTarget}, {bright}, [this](RenderGraph &g) {
+                bindChainState();
+                downsample(g, bright, halfW, halfH, sceneTarget, (int)region.z, (int)region.w, THRESHOLD);
+            });
+            graph.pass("bloom blur 1/2 x", {bright}, {halfX}, [this](RenderGraph &g) {
+                blurPass(g, halfX, bright, halfW, halfH, glm::vec2(1.0f, 0.0f));
+            });
+            graph.pass("bloom blur 1/2 y", {halfX}, {halfBlurred}, [this](RenderGraph &g) {
+                blurPass(g, halfBlurred, halfX, halfW, halfH, glm::vec2(0.0f, 1.0f));
+            });
+            graph.pass("bloom downsample", {halfBlurred}, {quarter}, [this](RenderGraph &g) {
+                downsample(g, quarter, quarterW, quarterH, halfBlurred, halfW, halfH, 0.0f);
+            });
+        } else {
+            graph.pass("bloom bright", {sceneTarget}, {quarter}, [this](RenderGraph &g) {
+                bindChainState();
+                downsample(g, quarter, quarterW, quarterH, sceneTarget, (int)region.z, (int)region.w, THRESHOLD);
+            });
+        }
+        quarterX = graph.create("bloom quarter x", quarterDesc);
+        quarterBlurred = graph.create("bloom quarter blurred", quarterDesc);
+        graph.pass("bloom blur 1/4 x", {quarter}, {quarterX}, [this](RenderGraph &g) {
+            blurPass(g, quarterX, quarter, quarterW, quarterH, glm::vec2(1.0f, 0.0f));
+        });
+        graph.pass("bloom blur 1/4 y", {quarterX}, {quarterBlurred}, [this](RenderGraph &g) {
+            blurPass(g, quarterBlurred, quarterX, quarterW, quarterH, glm::vec2(0.0f, 1.0f));
+        });
+        if (halfLevel) {
+            graph.pass("bloom composite", {sceneTarget, halfBlurred, quarterBlurred}, {destination},
+                       [this](RenderGraph &g) { compositePass(g); });
+        } else {
+            graph.pass("bloom composite", {sceneTarget, quarterBlurred}, {destination}, [this](RenderGraph &g) { compositePass(g); });
+        }
+    }
+
+    // State every pass of the chain shares, set by the first
+    void bindChainState() {
+        glState.disable(GL_BLEND);
+        glState.disable(GL_DEPTH_TEST);
+        glState.bindVertexArray(vertexArray);
+        for (int unit = 0; unit < 3; unit++) {
+            glState.bindSampler(unit, sampler);
+        }
+    }
+
+    void downsample(RenderGraph &g, int target, int w, int h, int source, int sourceW, int sourceH, float threshold) {
+        down.program.use();
+        down.program.set(down.threshold, threshold);
+        pass(g, down, target, w, h, source, sourceW, sourceH, glm::vec2(1.0f));
+    }
+
+    void blurPass(RenderGraph &g, int target, int source, int w, int h, const glm::vec2 &axis) {
+        blur.program.use();
+        pass(g, blur, target, w, h, source, w, h, axis);
+    }
+
+    // Draw program (in use) over the w x h region of target, reading the sourceW x
+    // sourceH region of source; axis scales the one-texel step the program is given
+    void pass(RenderGraph &g, Program &p, int target, int w, int h, int source, int sourceW, int sourceH, const glm::vec2 &axis) {
+        const RenderGraph::TargetDesc &from = g.desc(source);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, g.framebuffer(target));
+        glViewport(0, 0, w, h);
+        glState.bindTexture(0, g.texture(source));
+        p.program.set(p.mapping, glm::vec4(0.0f, 0.0f, (float)sourceW / from.width / w, (float)sourceH / from.height / h));
+        p.program.set(p.texel, axis / glm::vec2(from.width, from.height));
+        p.program.set(p.uvMax, uvMax(from, sourceW, sourceH));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        passes++;
+    }
+
+    void compositePass(RenderGraph &g) {
+        const int w = (int)region.z, h = (int)region.w;
+        glState.bindFramebuffer(GL_FRAMEBUFFER, g.framebuffer(destination));
+        glClear(GL_COLOR_BUFFER_BIT); // the letterbox bars, when the destination is the window
+        glViewport((GLint)region.x, (GLint)region.y, w, h);
+        composite.use();
+        composite.set(origin, glm::vec2(region.x, region.y));
+        composite.set(sceneScale, glm::vec2(1.0f / width, 1.0f / height));
+        composite.set(quarterScale, levelScale(g.desc(quarterBlurred), quarterW, quarterH, w, h));
+        composite.set(quarterMax, uvMax(g.desc(quarterBlurred), quarterW, quarterH));
+        if (halfLevel) {
+            composite.set(halfScale, levelScale(g.desc(halfBlurred), halfW, halfH, w, h));
+            composite.set(halfMax, uvMax(g.desc(halfBlurred), halfW, halfH));
+        }
+        glState.bindTexture(0, scene);
+        glState.bindTexture(1, g.texture(halfLevel ? halfBlurred : quarterBlurred)); // weighed 0 without the half level
+        glState.bindTexture(2, g.texture(quarterBlurred));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        passes++;
+    }
+
+    // uv per destination pixel of a level drawn over w x h, for a destination region of regionW x regionH
+    static glm::vec2 levelScale(const RenderGraph::TargetDesc &level, int w, int h, int regionW, int regionH) {
+        return glm::vec2((float)w / level.width / regionW, (float)h / level.height / regionH);
+    }
+
+    // Last texel centre of the w x h region of a target, in uv
+    static glm::vec2 uvMax(const RenderGraph::TargetDesc &target, int w, int h) {
+        return glm::vec2((w - 0.5f) / target.width, (h - 0.5f) / target.height);
+    }
+
+    // Delete every GL object; must run while the context is still current
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        memoryStats.untrackGl(GL_TEXTURE, scene);
+        memoryStats.untrackGl(GL_RENDERBUFFER, depth);
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, vertexArray);
+        glState.deleteTextures(1, &scene);
+        glDeleteRenderbuffers(1, &depth);
+        glState.deleteFramebuffers(1, &fbo);
+        glState.deleteVertexArrays(1, &vertexArray);
+        fbo = scene = depth = vertexArray = 0;
+        width = height = 0;
+        enabled = false;
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include "collision_kernel.h"
+#include "entity_pool.h"
+#include "job_system.h"
+
+// Buckets entities once per tick so collision queries only visit nearby candidates.
+// Lane-bound entities are bucketed by lane index; free-moving ones (lane < 0) go into
+// a uniform grid. Both use counting sort into flat arrays, so rebuilding is a linear
+// pass and, after the first few ticks, does not allocate. Each lane bucket also keeps
+// its boxes packed as SoA, ready for the SIMD overlap kernel.
+struct Broadphase {
+    int laneCount = 3;
+    float cellSize = 64.0f;
+    int gridColumns = 1, gridRows = 1;
+
+    std::vector<uint32_t> laneStart;  // laneCount + 1 offsets into laneEntries
+    std::vector<uint32_t> laneEntries;
+    std::vector<float> laneX, laneY, laneHalfW, laneHalfH; // packed boxes, parallel to laneEntries
+    std::vector<float> laneStartX, laneStartY, laneMoveX, laneMoveY; // where they were last tick, and how far they moved
+    std::vector<uint32_t> cellStart;  // gridColumns * gridRows + 1 offsets into cellEntries
+    std::vector<uint32_t> cellEntries;
+    std::vector<int32_t> cellOf;      // scratch: grid cell per entity, -1 if lane-bound
+    std::vector<uint32_t> laneCursor, cellCursor; // scratch: scatter positions
+    std::vector<std::vector<uint32_t>> chunkHits;  // scratch: per-chunk results of overlapLanes
+
+    // Boxes per job when a lane is split across the job system
+    static const uint32_t OVERLAP_GRAIN = 16384;
+
+    void setup(int lanes, float worldWidth, float worldHeight, float cell) {
+        laneCount = lanes;
+        cellSize = cell;
+        gridColumns = std::max(1, (int)std::ceil(worldWidth / cell));
+        gridRows = std::max(1, (int)std::ceil(worldHeight / cell));
+        laneStart.assign(laneCount + 1, 0);
+        cellStart.assign(gridColumns * gridRows + 1, 0);
+    }
+
+    int cellIndex(float px, float py) const {
+        int cx = std::min(std::max((int)(px / cellSize), 0), gridColumns - 1);
+        int cy = std::min(std::max((int)(py / cellSize), 0), gridRows - 1);
+        return cy * gridColumns + cx;
+    }
+
+    // Rebuild every bucket from the current entity positions of the first count
+    // entities; without lanes, lane-bound entities are left out, for callers that keep
+    // their lanes some other way
+    void build(const EntityPool &pool, bool lanes = true, uint32_t count = UINT32_MAX) {
+        count = std::min(count, (uint32_t)pool.size());
+        std::fill(laneStart.begin(), laneStart.end(), 0);
+        std::fill(cellStart.begin(), cellStart.end(), 0);
+        cellOf.resize(count);
+
+        // Count
+        for (uint32_t i = 0; i < count; i++) {
+            int lane = pool.lane[i];
+            if (lane >= 0 && lane < laneCount) {
+                cellOf[i] = -1;
+                laneStart[lane + 1] += lanes;
+            } else {
+                cellOf[i] = cellIndex(pool.x[i], pool.y[i]);
+                cellStart[cellOf[i] + 1]++;
+            }
+        }
+        for (int l = 0; l < laneCount; l++) {
+            laneStart[l + 1] += laneStart[l];
+        }
+        for (size_t c = 0; c + 1 < cellStart.size(); c++) {
+            cellStart[c + 1] += cellStart[c];
+        }
+
+        // Scatter, advancing a copy of each start offset
+        laneEntries.resize(laneStart[laneCount]);
+        laneX.resize(laneEntries.size());
+        laneY.resize(laneEntries.size());
+        laneHalfW.resize(laneEntries.size());
+        laneHalfH.resize(laneEntries.size());
+        for (std::vector<float> *v : {&laneStartX, &laneStartY, &laneMoveX, &laneMoveY}) {
+            v->resize(laneEntries.size());
+        }
+        cellEntries.resize(cellStart.back());
+        laneCursor.assign(laneStart.begin(), laneStart.end() - 1);
+        cellCursor.assign(cellStart.begin(), cellStart.end() - 1);
+        for (uint32_t i = 0; i < count; i++) {
+            if (cellOf[i] < 0) {
+                if (!lanes) {
+                    continue;
+                }
+                uint32_t slot = laneCursor[pool.lane[i]]++;
+                laneEntries[slot] = i;
+                laneX[slot] = pool.x[i];
+                laneY[slot] = pool.y[i];
+                laneHalfW[slot] = pool.width[i] / 2;
+                laneHalfH[slot] = pool.height[i] / 2;
+                laneStartX[slot] = pool.prevX[i];
+                laneStartY[slot] = pool.prevY[i];
+                laneMoveX[slot] = pool.x[i] - pool.prevX[i];
+                laneMoveY[slot] = pool.y[i] - pool.prevY[i];
+            } else {
+                cellEntries[cellCursor[cellOf[i]]++] = i;
+            }
+        }
+    }
+
+    // Append to out the dense indices of entities in lanes [laneMin, laneMax] whose box
+    // overlaps the box centred at (px, py), testing each lane with the SIMD kernel
+    void overlapLanes(int laneMin, int laneMax, float px, float py, float halfW, float halfH,
+                      std::vector<uint32_t> &out, JobSystem *jobs = nullptr) {
+        eachLaneRange(laneMin, laneMax, out, jobs, [&](uint32_t from, uint32_t end, std::vector<uint32_t> &hits) {
+            overlapRange(from, end, px, py, halfW, halfH, hits);
+        });
+    }
+
+    // Append to out the dense indices of entities in lanes [laneMin, laneMax] that meet,
+    // at any moment since the previous tick, the box that started at (px, py) and
+    // moved by (moveX, moveY); both sides are swept along their motion
+    void sweepLanes(int laneMin, int laneMax, float px, float py, float moveX, float moveY, float halfW, float halfH,
+                    std::vector<uint32_t> &out, JobSystem *jobs = nullptr) {
+        eachLaneRange(laneMin, laneMax, out, jobs, [&](uint32_t from, uint32_t end, std::vector<uint32_t> &hits) {
+            while (from < end) {
+                SweptAabbSoA boxes = {&laneStartX[from], &laneStartY[from], &laneMoveX[from],
+                                      &laneMoveY[from],  &laneHalfW[from],  &laneHalfH[from]};
+                int hit = firstSweptOverlap(boxes, (int)(end - from), px, py, moveX, moveY, halfW, halfH);
+                if (hit < 0) {
+                    break;
+                }
+                hits.push_back(laneEntries[from + hit]);
+                from += hit + 1;
+            }
+        });
+    }
+
+    // Run range(from, end, hits) over the packed slots of lanes [laneMin, laneMax].
+    // Long lanes are split into chunks across the job system; chunk results are
+    // appended in chunk order, so the output is identical with any thread count.
+    template <typename RangeFn>
+    void eachLaneRange(int laneMin, int laneMax, std::vector<uint32_t> &out, JobSystem *jobs, const RangeFn &range) {
+        laneMin = std::max(laneMin, 0);
+        laneMax = std::min(laneMax, laneCount - 1);
+        for (int l = laneMin; l <= laneMax; l++) {
+            uint32_t from = laneStart[l];
+            uint32_t count = laneStart[l + 1] - from;
+            if (!jobs || count <= OVERLAP_GRAIN) {
+                range(from, from + count, out);
+                continue;
+            }
+
+            uint32_t chunks = (count + OVERLAP_GRAIN - 1) / OVERLAP_GRAIN;
+            if (chunkHits.size() < chunks) {
+                chunkHits.resize(chunks);
+            }
+            jobs->parallelFor(chunks, 1, [&](uint32_t first, uint32_t last) {
+                for (uint32_t c = first; c < last; c++) {
+                    uint32_t b = from + c * OVERLAP_GRAIN;
+                    chunkHits[c].clear();
+                    range(b, std::min(b + OVERLAP_GRAIN, from + count), chunkHits[c]);
+                }
+            });
+            for (uint32_t c = 0; c < chunks; c++) {
+                out.insert(out.end(), chunkHits[c].begin(), chunkHits[c].end());
+            }
+        }
+    }
+
+    // Run the SIMD kernel over packed lane slots [from, end), appending every hit
+    void overlapRange(uint32_t from, uint32_t end, float px, float py, float halfW, float halfH,
+                      std::vector<uint32_t> &out) const {
+        while (from < end) {
+            AabbSoA boxes = {&laneX[from], &laneY[from], &laneHalfW[from], &laneHalfH[from]};
+            int hit = firstOverlap(boxes, (int)(end - from), px, py, halfW, halfH);
+            if (hit < 0) {
+                break;
+            }
+            out.push_back(laneEntries[from + hit]);
+            from += hit + 1;
+        }
+    }
+
+    // Append to out the dense indices of free-moving entities whose cell touches the
+    // box centred at (px, py); they still need an exact overlap test
+    void queryCells(float px, float py, float halfW, float halfH, std::vector<uint32_t> &out) const {
+        if (cellEntries.empty()) {
+            return;
+        }
+        // Free movers are bucketed by centre; widening by one cell reaches every neighbour
+        // that can overlap, as long as free movers are no larger than a cell
+        int c0 = cellIndex(px - halfW - cellSize, py - halfH - cellSize);
+        int c1 = cellIndex(px + halfW + cellSize, py + halfH + cellSize);
+        for (int cy = c0 / gridColumns; cy <= c1 / gridColumns; cy++) {
+            for (int cx = c0 % gridColumns; cx <= c1 % gridColumns; cx++) {
+                int c = cy * gridColumns + cx;
+                out.insert(out.end(), cellEntries.begin() + cellStart[c], cellEntries.begin() + cellStart[c + 1]);
+            }
+        }
+    }
+};
@@ -0,0 +1,251 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <glm/glm.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+
+// Packed structure-of-arrays boxes: centre and half extents, one array per field
+struct AabbSoA {
+    const float *x, *y, *halfW, *halfH;
+};
+
+// Finds the first box in [0, count) overlapping the box (bx, by, bhw, bhh); -1 if none.
+// SSE2 tests four boxes per step and AVX eight; the widest path the running CPU
+// supports is picked on first use, based on the architecture glm/simd/platform.h detected.
+typedef int (*FirstOverlapFn)(AabbSoA boxes, int count, float bx, float by, float bhw, float bhh);
+
+inline int firstOverlapScalar(AabbSoA b, int count, float bx, float by, float bhw, float bhh) {
+    for (int i = 0; i < count; i++) {
+        if (std::fabs(b.x[i] - bx) < b.halfW[i] + bhw && std::fabs(b.y[i] - by) < b.halfH[i] + bhh) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+inline int firstOverlapSse2(AabbSoA b, int count, float bx, float by, float bhw, float bhh) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 vx = _mm_set1_ps(bx), vy = _mm_set1_ps(by);
+    const __m128 vhw = _mm_set1_ps(bhw), vhh = _mm_set1_ps(bhh);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(b.x + i), vx), absMask);
+        __m128 dy = _mm_and_ps(_mm_sub_ps(_mm_loadu_ps(b.y + i), vy), absMask);
+        __m128 hitX = _mm_cmplt_ps(dx, _mm_add_ps(_mm_loadu_ps(b.halfW + i), vhw));
+        __m128 hitY = _mm_cmplt_ps(dy, _mm_add_ps(_mm_loadu_ps(b.halfH + i), vhh));
+        int mask = _mm_movemask_ps(_mm_and_ps(hitX, hitY));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    AabbSoA tail = {b.x + i, b.y + i, b.halfW + i, b.halfH + i};
+    int hit = firstOverlapScalar(tail, count - i, bx, by, bhw, bhh);
+    return hit < 0 ? -1 : i + hit;
+}
+
+__attribute__((target("avx")))
+inline int firstOverlapAvx(AabbSoA b, int count, float bx, float by, float bhw, float bhh) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 vx = _mm256_set1_ps(bx), vy = _mm256_set1_ps(by);
+    const __m256 vhw = _mm256_set1_ps(bhw), vhh = _mm256_set1_ps(bhh);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(b.x + i), vx), absMask);
+        __m256 dy = _mm256_and_ps(_mm256_sub_ps(_mm256_loadu_ps(b.y + i), vy), absMask);
+        __m256 hitX = _mm256_cmp_ps(dx, _mm256_add_ps(_mm256_loadu_ps(b.halfW + i), vhw), _CMP_LT_OQ);
+        __m256 hitY = _mm256_cmp_ps(dy, _mm256_add_ps(_mm256_loadu_ps(b.halfH + i), vhh), _CMP_LT_OQ);
+        int mask = _mm256_movemask_ps(_mm256_and_ps(hitX, hitY));
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    AabbSoA tail = {b.x + i, b.y + i, b.halfW + i, b.halfH + i};
+    int hit = firstOverlapSse2(tail, count - i, bx, by, bhw, bhh);
+    return hit < 0 ? -1 : i + hit;
+}
+#endif
+
+inline FirstOverlapFn selectFirstOverlap() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    if (__builtin_cpu_supports("avx")) {
+        return firstOverlapAvx;
+    }
+    return firstOverlapSse2;
+#else
+    return firstOverlapScalar;
+#endif
+}
+
+inline int firstOverlap(AabbSoA boxes, int count, float bx, float by, float bhw, float bhh) {
+    static const FirstOverlapFn impl = selectFirstOverlap();
+    return impl(boxes, count, bx, by, bhw, bhh);
+}
+
+// Swept boxes: where each box starts the tick, how far it moves during it, and its
+// half extents. Two boxes moving in straight lines collide if they overlap at any
+// moment of the tick, so a fast comet or a lane change cannot step through the ship.
+struct SweptAabbSoA {
+    const float *x, *y, *moveX, *moveY, *halfW, *halfH;
+};
+
+// Fractions of the tick between which two boxes, offset apart at its start and
+// closing by move over it, are nearer than reach on one axis. Without relative
+// motion the interval is the whole line or empty.
+inline void sweptAxis(float offset, float move, float reach, float &enter, float &exit) {
+    const float INF = std::numeric_limits<float>::infinity();
+    if (move == 0.0f) {
+        enter = std::fabs(offset) < reach ? -INF : INF;
+        exit = INF;
+        return;
+    }
+    float a = (-reach - offset) / move, b = (reach - offset) / move;
+    enter = std::min(a, b);
+    exit = std::max(a, b);
+}
+
+// Part of the tick, [enter, exit) within [0, 1], in which the boxes overlap on both
+// axes at once; empty (enter >= exit) if they never do
+inline void sweptInterval(float offsetX, float offsetY, float moveX, float moveY, float reachX, float reachY,
+                          float &enter, float &exit) {
+    float enterX, exitX, enterY, exitY;
+    sweptAxis(offsetX, moveX, reachX, enterX, exitX);
+    sweptAxis(offsetY, moveY, reachY, enterY, exitY);
+    enter = std::max(std::max(enterX, enterY), 0.0f);
+    exit = std::min(std::min(exitX, exitY), 1.0f);
+}
+
+// Whether the boxes overlap on both axes at once at some moment of the tick
+inline bool sweptOverlap(float offsetX, float offsetY, float moveX, float moveY, float reachX, float reachY) {
+    float enter, exit;
+    sweptInterval(offsetX, offsetY, moveX, moveY, reachX, reachY, enter, exit);
+    return enter < exit;
+}
+
+// Finds the first swept box in [0, count) that meets the box starting at (bx, by)
+// and moving by (bmx, bmy); -1 if none. Dispatched like firstOverlap.
+typedef int (*FirstSweptOverlapFn)(SweptAabbSoA boxes, int count, float bx, float by, float bmx, float bmy, float bhw,
+                                   float bhh);
+
+inline int firstSweptOverlapScalar(SweptAabbSoA b, int count, float bx, float by, float bmx, float bmy, float bhw,
+                                   float bhh) {
+    for (int i = 0; i < count; i++) {
+        if (sweptOverlap(b.x[i] - bx, b.y[i] - by, b.moveX[i] - bmx, b.moveY[i] - bmy, b.halfW[i] + bhw, b.halfH[i] + bhh)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+// sweptAxis for four pairs at once
+inline void sweptAxisSse2(__m128 offset, __m128 move, __m128 reach, __m128 &enter, __m128 &exit) {
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 inf = _mm_set1_ps(std::numeric_limits<float>::infinity());
+    __m128 still = _mm_cmpeq_ps(move, _mm_setzero_ps());
+    __m128 a = _mm_div_ps(_mm_sub_ps(_mm_sub_ps(_mm_setzero_ps(), reach), offset), move);
+    __m128 b = _mm_div_ps(_mm_sub_ps(reach, offset), move);
+    __m128 touching = _mm_cmplt_ps(_mm_and_ps(offset, absMask), reach);
+    __m128 stillEnter = _mm_or_ps(_mm_and_ps(touching, _mm_sub_ps(_mm_setzero_ps(), inf)), _mm_andnot_ps(touching, inf));
+    enter = _mm_or_ps(_mm_and_ps(still, stillEnter), _mm_andnot_ps(still, _mm_min_ps(a, b)));
+    exit = _mm_or_ps(_mm_and_ps(still, inf), _mm_andnot_ps(still, _mm_max_ps(a, b)));
+}
+
+// sweptOverlap for four pairs at once, as a lane mask
+inline __m128 sweptOverlapSse2(__m128 offsetX, __m128 offsetY, __m128 moveX, __m128 moveY, __m128 reachX, __m128 reachY) {
+    __m128 enterX, exitX, enterY, exitY;
+    sweptAxisSse2(offsetX, moveX, reachX, enterX, exitX);
+    sweptAxisSse2(offsetY, moveY, reachY, enterY, exitY);
+    __m128 enter = _mm_max_ps(_mm_max_ps(enterX, enterY), _mm_setzero_ps());
+    __m128 exit = _mm_min_ps(_mm_min_ps(exitX, exitY), _mm_set1_ps(1.0f));
+    return _mm_cmplt_ps(enter, exit);
+}
+
+inline int firstSweptOverlapSse2(SweptAabbSoA b, int count, float bx, float by, float bmx, float bmy, float bhw,
+                                 float bhh) {
+    const __m128 vx = _mm_set1_ps(bx), vy = _mm_set1_ps(by), vmx = _mm_set1_ps(bmx), vmy = _mm_set1_ps(bmy);
+    const __m128 vhw = _mm_set1_ps(bhw), vhh = _mm_set1_ps(bhh);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 hit = sweptOverlapSse2(_mm_sub_ps(_mm_loadu_ps(b.x + i), vx), _mm_sub_ps(_mm_loadu_ps(b.y + i), vy),
+                                      _mm_sub_ps(_mm_loadu_ps(b.moveX + i), vmx), _mm_sub_ps(_mm_loadu_ps(b.moveY + i), vmy),
+                                      _mm_add_ps(_mm_loadu_ps(b.halfW + i), vhw), _mm_add_ps(_mm_loadu_ps(b.halfH + i), vhh));
+        int mask = _mm_movemask_ps(hit);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    SweptAabbSoA tail = {b.x + i, b.y + i, b.moveX + i, b.moveY + i, b.halfW + i, b.halfH + i};
+    int hit = firstSweptOverlapScalar(tail, count - i, bx, by, bmx, bmy, bhw, bhh);
+    return hit < 0 ? -1 : i + hit;
+}
+
+// sweptAxis for eight pairs at once
+__attribute__((target("avx")))
+inline void sweptAxisAvx(__m256 offset, __m256 move, __m256 reach, __m256 &enter, __m256 &exit) {
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 inf = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+    __m256 still = _mm256_cmp_ps(move, _mm256_setzero_ps(), _CMP_EQ_OQ);
+    __m256 a = _mm256_div_ps(_mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), reach), offset), move);
+    __m256 b = _mm256_div_ps(_mm256_sub_ps(reach, offset), move);
+    __m256 touching = _mm256_cmp_ps(_mm256_and_ps(offset, absMask), reach, _CMP_LT_OQ);
+    __m256 stillEnter = _mm256_or_ps(_mm256_and_ps(touching, _mm256_sub_ps(_mm256_setzero_ps(), inf)),
+                                     _mm256_andnot_ps(touching, inf));
+    enter = _mm256_or_ps(_mm256_and_ps(still, stillEnter), _mm256_andnot_ps(still, _mm256_min_ps(a, b)));
+    exit = _mm256_or_ps(_mm256_and_ps(still, inf), _mm256_andnot_ps(still, _mm256_max_ps(a, b)));
+}
+
+// sweptOverlap for eight pairs at once, as a lane mask
+__attribute__((target("avx")))
+inline __m256 sweptOverlapAvx(__m256 offsetX, __m256 offsetY, __m256 moveX, __m256 moveY, __m256 reachX, __m256 reachY) {
+    __m256 enterX, exitX, enterY, exitY;
+    sweptAxisAvx(offsetX, moveX, reachX, enterX, exitX);
+    sweptAxisAvx(offsetY, moveY, reachY, enterY, exitY);
+    __m256 enter = _mm256_max_ps(_mm256_max_ps(enterX, enterY), _mm256_setzero_ps());
+    __m256 exit = _mm256_min_ps(_mm256_min_ps(exitX, exitY), _mm256_set1_ps(1.0f));
+    return _mm256_cmp_ps(enter, exit, _CMP_LT_OQ);
+}
+
+__attribute__((target("avx")))
+inline int firstSweptOverlapAvx(SweptAabbSoA b, int count, float bx, float by, float bmx, float bmy, float bhw,
+                                float bhh) {
+    const __m256 vx = _mm256_set1_ps(bx), vy = _mm256_set1_ps(by), vmx = _mm256_set1_ps(bmx), vmy = _mm256_set1_ps(bmy);
+    const __m256 vhw = _mm256_set1_ps(bhw), vhh = _mm256_set1_ps(bhh);
+    int i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 hit = sweptOverlapAvx(_mm256_sub_ps(_mm256_loadu_ps(b.x + i), vx), _mm256_sub_ps(_mm256_loadu_ps(b.y + i), vy),
+                                     _mm256_sub_ps(_mm256_loadu_ps(b.moveX + i), vmx),
+                                     _mm256_sub_ps(_mm256_loadu_ps(b.moveY + i), vmy),
+                                     _mm256_add_ps(_mm256_loadu_ps(b.halfW + i), vhw),
+                                     _mm256_add_ps(_mm256_loadu_ps(b.halfH + i), vhh));
+        int mask = _mm256_movemask_ps(hit);
+        if (mask) {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    SweptAabbSoA tail = {b.x + i, b.y + i, b.moveX + i, b.moveY + i, b.halfW + i, b.halfH + i};
+    int hit = firstSweptOverlapSse2(tail, count - i, bx, by, bmx, bmy, bhw, bhh);
+    return hit < 0 ? -1 : i + hit;
+}
+#endif
+
+inline FirstSweptOverlapFn selectFirstSweptOverlap() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    if (__builtin_cpu_supports("avx")) {
+        return firstSweptOverlapAvx;
+    }
+    return firstSweptOverlapSse2;
+#else
+    return firstSweptOverlapScalar;
+#endif
+}
+
+inline int firstSweptOverlap(SweptAabbSoA boxes, int count, float bx, float by, float bmx, float bmy, float bhw,
+                             float bhh) {
+    static const FirstSweptOverlapFn impl = selectFirstSweptOverlap();
+    return impl(boxes, count, bx, by, bmx, bmy, bhw, bhh);
+}
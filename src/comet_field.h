@@ -0,0 +1,213 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "generational_handle.h"
+#include "geometry_cache.h"
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "render_backend.h"
+#include "shader_program.h"
+
+// Spawn parameters of one comet; its position at any time follows from them
+struct CometParams {
+    GLfloat spawnTime; // simulation seconds at which it left the spawn height
+    GLfloat lane;
+    GLfloat speed;     // fall speed in pixels per second
+    GLfloat live;      // 1 while the comet exists, 0 once its slot is free
+};
+
+// GPU-side record of every comet, indexed by its entity handle's slot. Each slot is written
+// once when its comet spawns and once when it despawns; the vertex shader derives
+// the position from the spawn parameters and a per-frame time uniform, so nothing
+// is streamed per frame. The simulation records changes from its own thread and
+// the renderer uploads them before drawing.
+//
+// With culling on, the CPU does no visibility work at all, however many comets
+// there are. Each frame a GPU pass tests every slot against the playfield at the
+// frame's clock and appends the survivors, slot in w, to a compacted buffer that the
+// CULLED program draws. On GL 4.3 that is a compute pass, whose append counter is
+// the instance count of an indirect draw command. On GL 4.0 it is a transform
+// feedback pass whose geometry stage drops what is off screen. Its captured count
+// can only be drawn as vertices, so the survivors are drawn as points, and the
+// POINTS program's geometry stage expands each one to the quad; outlines are lost
+// on that path.
+struct CometField {
+    enum Cull { CULL_NONE, CULL_COMPUTE, CULL_FEEDBACK };
+
+    // GL's layout of one glDrawArraysIndirect command
+    struct DrawArraysIndirectCommand {
+        GLuint count, instanceCount, first, baseInstance;
+    };
+
+    // A pending write of one slot
+    struct Change {
+        uint32_t slot;
+        CometParams params;
+    };
+
+    static const GLuint PARAMS_ATTRIB = 2;
+    static const GLuint CULL_GROUP = 256; // comet_cull.comp.glsl's local size
+
+    bool enabled = false;
+    GLuint VAO = 0, buffer = 0;
+    GLint firstVertex = 0;   // the comets' strip in the quad's buffer: the quad itself, or
+    GLsizei vertexCount = 0; // the comet outline the GeometryCache holds
+    uint32_t capacity = 0;
+    uint32_t slotsUsed = 0; // one past the highest slot ever written; the draw covers [0, slotsUsed)
+    std::mutex changeLock;
+    std::vector<Change> pending, draining; // written by the simulation, drained by the renderer
+    int uploads = 0; // slot writes issued by the last upload()
+    Cull cull = CULL_NONE;
+    GLuint cullProgram = 0;
+    GLint slotCountLocation = -1;
+    GLuint survivors = 0;       // compacted CometParams, slot in w
+    GLuint survivorVAO = 0;     // the quad with survivors per instance, or survivors as points
+    GLuint cullVAO = 0;         // slots as points, for the feedback pass
+    GLuint command = 0;         // the compute path's DrawArraysIndirectCommand
+    GLuint feedback = 0;        // the feedback path's transform feedback object
+
+    // Create the slot buffer (all slots free) and a VAO pairing it with the shared quad
+    void setup(const Mesh &quad, uint32_t slots) {
+        enabled = true;
+        capacity = slots;
+        vertexCount = quad.vertexCount;
+        pending.reserve(slots);
+        draining.reserve(slots);
+
+        VAO = renderBackend.createVertexArray();
+        quad.bindAttribs(VAO);
+
+        std::vector<CometParams> empty(capacity, CometParams{0.0f, 0.0f, 0.0f, 0.0f});
+        buffer = renderBackend.createBuffer(GL_ARRAY_BUFFER, capacity * sizeof(CometParams), empty.data(), GL_DYNAMIC_DRAW);
+        vertexAttrib(VAO, PARAMS_ATTRIB, 4, buffer, sizeof(CometParams), 0, 1);
+        glMarkers.label(GL_BUFFER, buffer, "comet field");
+        glMarkers.label(GL_VERTEX_ARRAY, VAO, "comet field");
+    }
+
+    // Cull every frame with program, a linked comet_cull compute program or a
+    // comet_cull vertex and geometry program capturing "survivor"; mode picks which.
+    // Its size and field uniforms are the caller's to set, as on the comet program.
+    void setupCulling(const Mesh &quad, Cull mode, GLuint program) {
+        cull = mode;
+        cullProgram = program;
+        survivors = renderBackend.createBuffer(GL_ARRAY_BUFFER, capacity * sizeof(CometParams), nullptr, GL_DYNAMIC_COPY);
+        survivorVAO = renderBackend.createVertexArray();
+        if (cull == CULL_COMPUTE) {
+            slotCountLocation = glGetUniformLocation(cullProgram, "slotCount");
+            quad.bindAttribs(survivorVAO);
+            vertexAttrib(survivorVAO, PARAMS_ATTRIB, 4, survivors, sizeof(CometParams), 0, 1);
+            command = renderBackend.createBuffer(GL_DRAW_INDIRECT_BUFFER, sizeof(DrawArraysIndirectCommand), nullptr, GL_DYNAMIC_DRAW);
+        } else {
+            vertexAttrib(survivorVAO, PARAMS_ATTRIB, 4, survivors, sizeof(CometParams), 0, 0);
+            cullVAO = renderBackend.createVertexArray();
+            vertexAttrib(cullVAO, 0, 4, buffer, sizeof(CometParams), 0, 0);
+            glGenTransformFeedbacks(1, &feedback);
+        }
+        glMarkers.label(GL_BUFFER, survivors, "comet survivors");
+        glMarkers.label(GL_BUFFER, command, "comet draw command");
+    }
+
+    // Simulation side: queue a slot write; a no-op unless the field is in use
+    void record(uint32_t handle, const CometParams &params) {
+        uint32_t slot = handleIndex(handle);
+        if (!enabled || slot >= capacity) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(changeLock);
+        pending.push_back({slot, params});
+    }
+
+    // Render side: write every queued change into the slot buffer, in order
+    void upload() {
+        {
+            std::lock_guard<std::mutex> guard(changeLock);
+            draining.swap(pending);
+        }
+        uploads = (int)draining.size();
+        if (draining.empty()) {
+            return;
+        }
+        for (const Change &c : draining) {
+            renderBackend.updateBuffer(GL_ARRAY_BUFFER, buffer, c.slot * sizeof(CometParams), sizeof(CometParams), &c.params);
+            slotsUsed = std::max(slotsUsed, c.slot + 1);
+        }
+        draining.clear();
+    }
+
+    // Compact the comets visible at the View block's clock into the survivor buffer,
+    // once a frame before draw(); a no-op without culling
+    void cullVisible() {
+        if (cull == CULL_COMPUTE) {
+            DrawArraysIndirectCommand reset = {(GLuint)vertexCount, 0, (GLuint)firstVertex, 0};
+            renderBackend.updateBuffer(GL_DRAW_INDIRECT_BUFFER, command, 0, sizeof(reset), &reset);
+            if (slotsUsed == 0) {
+                return;
+            }
+            glState.useProgram(cullProgram);
+            glUniform1i(slotCountLocation, (GLint)slotsUsed);
+            glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffer);
+            glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, survivors);
+            glState.bindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, command);
+            glExt.DispatchCompute((slotsUsed + CULL_GROUP - 1) / CULL_GROUP, 1, 1);
+            glExt.MemoryBarrierGl(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+        } else if (cull == CULL_FEEDBACK) {
+            // Capture even with no slots, so the count the draw reads is this frame's
+            glState.useProgram(cullProgram);
+            glState.enable(GL_RASTERIZER_DISCARD);
+            glState.bindVertexArray(cullVAO);
+            glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, feedback);
+            glState.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, survivors);
+            glBeginTransformFeedback(GL_POINTS);
+            glDrawArrays(GL_POINTS, 0, (GLsizei)slotsUsed);
+            glEndTransformFeedback();
+            glState.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0); // the draw reads it as vertices
+            glBindTransformFeedback(GL_TRANSFORM_FEEDBACK, 0);
+            glState.disable(GL_RASTERIZER_DISCARD);
+        }
+    }
+
+    // Draw every live comet as it stands at the View block's clock, or the survivors of
+    // this frame's cullVisible(); the comet pipeline must be bound
+    void draw(GLuint texID, GLuint sampler, GLenum target = GL_TEXTURE_2D) {
+        if (cull == CULL_COMPUTE) {
+            renderBackend.drawIndirect(survivorVAO, texID, sampler, target, command);
+            return;
+        }
+        if (cull == CULL_FEEDBACK) {
+            renderBackend.drawCaptured(survivorVAO, texID, sampler, target, feedback);
+            return;
+        }
+        if (slotsUsed == 0) {
+            return;
+        }
+        renderBackend.draw(VAO, texID, sampler, target, firstVertex, vertexCount, (GLsizei)slotsUsed);
+    }
+
+    // Delete the field's GL objects; must run while the context is still current
+    void release() {
+        renderBackend.destroyVertexArray(VAO);
+        renderBackend.destroyBuffer(buffer);
+        if (cull != CULL_NONE) {
+            renderBackend.destroyVertexArray(survivorVAO);
+            renderBackend.destroyBuffer(survivors);
+            if (cull == CULL_COMPUTE) {
+                renderBackend.destroyBuffer(command);
+            } else {
+                renderBackend.destroyVertexArray(cullVAO);
+                glDeleteTransformFeedbacks(1, &feedback);
+                feedback = 0;
+            }
+            glDeleteProgram(cullProgram);
+            cullProgram = 0;
+            cull = CULL_NONE;
+        }
+        enabled = false;
+    }
+};
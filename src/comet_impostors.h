@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "draw_list.h"
+#include "game_rules.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "sprite_batch.h"
+#include "view_transform.h"
+
+// Level of detail for dense comet fields. Once more than ENGAGE comets are on screen
+// above LINE, far from the ship, they stop being drawn as full sprites: they are
+// drawn into a texture of the band above the line at 1 / DIVISOR of the playfield's
+// resolution, with the cheapest sprite variant (no rotation, flipbook or alpha
+// test), and the band is composited into the scene as one translucent quad in the
+// comet layer. Fragment work for the far field is then bounded by the band's area,
+// however many comets overlap in it. Comets are promoted back to full sprites as
+// they fall below the line, and the whole field returns to sprites once fewer than
+// RELEASE remain above it. The band starts half a comet below the line, so every
+// aggregated comet fits in it whole. The texture is sized from the playfield rather
+// than the window, so it is allocated once.
+struct CometImpostors {
+    static const int DIVISOR = 4; // playfield units per impostor texel, on each axis
+    static constexpr float LINE = HEIGHT * 0.6f;
+    static const uint32_t ENGAGE = 48, RELEASE = 32; // comets above the line
+
+    bool enabled = false;
+    bool active = false; // aggregating this frame
+    GLuint fbo = 0, texture = 0;
+    int width = 0, height = 0; // texels
+    float bandBottom = 0.0f;
+    DrawList list;         // the aggregated comets, drawn into the texture
+    uint8_t sceneShader = 0; // keys of the composite quad in the scene's list
+    uint16_t sceneTexture = 0;
+    uint32_t farComets = 0;     // counted this frame, decides the next
+    uint64_t framesActive = 0;
+    uint32_t peakAggregated = 0;
+
+    // program is the cheap sprite variant, also registered in scene for the composite
+    void setup(ShaderProgram *program, GLuint sampler, DrawList &scene, size_t capacity) {
+        bandBottom = LINE - COMET_SIZE / 2;
+        width = (int)std::ceil(WIDTH / (float)DIVISOR);
+        height = (int)std::ceil((HEIGHT - bandBottom) / DIVISOR);
+        texture = createTexture2D();
+        textureStorage2D(texture, 1, GL_RGBA8, width, height);
+        memoryStats.trackGl(GL_TEXTURE, texture, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glGenFramebuffers(1, &fbo);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glMarkers.label(GL_TEXTURE, texture, "comet impostors");
+        glMarkers.label(GL_FRAMEBUFFER, fbo, "comet impostors");
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        list.shader(program);
+        list.texture(0);
+        list.reserve(capacity);
+        sceneShader = scene.shader(program);
+        sceneTexture = scene.texture(texture, sampler);
+        enabled = true;
+    }
+
+    // Start recording a frame; the texture the comets are drawn with may change between
+    // frames, and a texture array needs the ARRAY variant of the cheap program
+    void begin(const DrawList::TextureBinding &comets, ShaderProgram *cometProgram) {
+        list.clear();
+        list.shaders[0] = cometProgram;
+        list.textures[0] = comets;
+        farComets = 0;
+    }
+
+    // Whether a visible comet centred at y is above the line: counted towards the
+    // next frame's mode, and aggregated while active. Safe from recording jobs.
+    bool far(float y) const {
+        return enabled && y >= LINE;
+    }
+
+    void countFar(uint32_t comets) {
+        farComets += comets;
+    }
+
+    // Instance of an aggregated comet, with the first frame of its flipbook; safe from recording jobs
+    static SpriteInstance instance(const glm::vec2 &position, const glm::vec2 &size, const glm::vec4 &texRect,
+                                   const Flipbook &flipbook, float layer = 0.0f) {
+        float rows = std::ceil(flipbook.frames / flipbook.columns);
+        glm::vec4 frame(texRect.x, texRect.y, texRect.z / flipbook.columns, texRect.w / rows);
+        return makeSpriteInstance(position, size, 0.0f, frame, 0.0f, Flipbook().instance(), 0.0f, layer);
+    }
+
+    // Record an aggregated comet; render thread, in entity order
+    void add(const SpriteInstance &comet) {
+        list.add(DrawList::makeKey(DrawList::TRANSLUCENT, 0, 0, (uint32_t)list.commands.size()), comet);
+    }
+
+    // Draw the aggregated comets into the texture and add the composite quad to the
+    // scene with the given key layer and depth. Leaves target bound with the view's
+    // viewport.
+    void draw(SpriteBatch &batch, const ViewTransform &view, GLuint target, DrawList &scene, uint8_t layer, float depth) {
+        if (active) {
+            framesActive++;
+            peakAggregated = std::max(peakAggregated, (uint32_t)list.commands.size());
+        }
+        if (list.empty()) {
+            return;
+        }
+        float scale = 1.0f / DIVISOR;
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.setViewport(glm::vec4(0.0f, -bandBottom * scale, WIDTH * scale, HEIGHT * scale));
+        glClear(GL_COLOR_BUFFER_BIT);
+        batch.submit(list);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, target);
+        view.apply();
+
+        // Texture rows run bottom up, sprite rects top down: flip the rect
+        glm::vec2 centre(WIDTH * 0.5f, (bandBottom + HEIGHT) * 0.5f);
+        scene.add(DrawList::makeKey(layer, sceneShader, sceneTexture, 0),
+                  makeSpriteInstance(centre, glm::vec2(WIDTH, HEIGHT - bandBottom), 0.0f, glm::vec4(0.0f, 1.0f, 1.0f, -1.0f), depth));
+    }
+
+    // Pick next frame's mode from this frame's count, with hysteresis
+    void settle() {
+        active = enabled && (active ? farComets >= RELEASE : farComets > ENGAGE);
+    }
+
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        memoryStats.untrackGl(GL_TEXTURE, texture);
+        glState.deleteTextures(1, &texture);
+        glState.deleteFramebuffers(1, &fbo);
+        texture = fbo = 0;
+        enabled = active = false;
+    }
+};
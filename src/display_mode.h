@@ -0,0 +1,148 @@
+#pragma once
+
+#include <cstdlib>
+#include <cstring>
+#include <GLFW/glfw3.h>
+
+enum class WindowMode {
+    Windowed,   // a decorated window, composited with the desktop
+    Borderless, // an undecorated window covering one monitor at the desktop's mode
+    Fullscreen  // the monitor itself, at the chosen refresh rate
+};
+
+// Parses "windowed", "borderless" or "fullscreen"; returns false for anything else
+inline bool parseWindowMode(const char *name, WindowMode &mode) {
+    if (strcmp(name, "windowed") == 0) mode = WindowMode::Windowed;
+    else if (strcmp(name, "borderless") == 0) mode = WindowMode::Borderless;
+    else if (strcmp(name, "fullscreen") == 0) mode = WindowMode::Fullscreen;
+    else return false;
+    return true;
+}
+
+// Where the game window sits and how it reaches the screen. A windowed game is
+// composited: the desktop compositor copies each frame into its own, a refresh
+// later. Covering a whole monitor without decorations or transparency lets the OS
+// scan the game's buffers out directly (independent flip on Windows, unredirected
+// on X11 and Wayland compositors), and exclusive fullscreen owns the monitor
+// outright, at refreshRate where the monitor has a mode for it at its current
+// resolution. Both keep the desktop's resolution, so switching costs no mode
+// change beyond the refresh rate; the view letterboxes the playfield into it.
+// toggle() moves between windowed and the chosen fullscreen mode at runtime,
+// restoring the window where it was.
+struct DisplayMode {
+    WindowMode mode = WindowMode::Windowed;
+    WindowMode fullscreen = WindowMode::Borderless; // what toggle() switches to from windowed
+    int monitorIndex = 0; // into glfwGetMonitors(); the primary one if out of range
+    int refreshRate = 0;  // Hz asked of exclusive fullscreen, 0 = the monitor's current
+    int windowedX = 0, windowedY = 0, windowedWidth = 0, windowedHeight = 0; // restored by toggle()
+
+    void setup(WindowMode requested, int monitor, int refresh) {
+        mode = requested;
+        fullscreen = requested == WindowMode::Windowed ? WindowMode::Borderless : requested;
+        monitorIndex = monitor;
+        refreshRate = refresh;
+    }
+
+    GLFWmonitor *monitor() const {
+        int count = 0;
+        GLFWmonitor **monitors = glfwGetMonitors(&count);
+        return monitorIndex >= 0 && monitorIndex < count ? monitors[monitorIndex] : glfwGetPrimaryMonitor();
+    }
+
+    // The monitor's mode at its current resolution with the refresh rate closest to
+    // refreshRate, or its current mode
+    const GLFWvidmode *videoMode(GLFWmonitor *m) const {
+        const GLFWvidmode *current = glfwGetVideoMode(m);
+        if (!current || refreshRate <= 0) {
+            return current;
+        }
+        int count = 0;
+        const GLFWvidmode *modes = glfwGetVideoModes(m, &count);
+        const GLFWvidmode *best = current;
+        for (int i = 0; i < count; i++) {
+            const GLFWvidmode &v = modes[i];
+            if (v.width == current->width && v.height == current->height &&
+                std::abs(v.refreshRate - refreshRate) < std::abs(best->refreshRate - refreshRate)) {
+                best = &v;
+            }
+        }
+        return best;
+    }
+
+    // Hints for glfwCreateWindow, after the caller's own
+    void hint() const {
+        if (mode == WindowMode::Windowed) {
+            return;
+        }
+        glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_FALSE); // the monitor's pixels exactly
+        if (mode == WindowMode::Borderless) {
+            glfwWindowHint(GLFW_DECORATED, GLFW_FALSE);
+        } else if (const GLFWvidmode *v = videoMode(monitor())) {
+            glfwWindowHint(GLFW_RED_BITS, v->redBits);
+            glfwWindowHint(GLFW_GREEN_BITS, v->greenBits);
+            glfwWindowHint(GLFW_BLUE_BITS, v->blueBits);
+            glfwWindowHint(GLFW_REFRESH_RATE, v->refreshRate);
+        }
+    }
+
+    // The window, width by height when windowed, covering the monitor otherwise
+    GLFWwindow *create(int width, int height, const char *title) const {
+        GLFWmonitor *m = monitor();
+        const GLFWvidmode *v = mode == WindowMode::Windowed ? nullptr : videoMode(m);
+        if (!v) {
+            return glfwCreateWindow(width, height, title, nullptr, nullptr);
+        }
+        if (mode == WindowMode::Fullscreen) {
+            return glfwCreateWindow(v->width, v->height, title, m, nullptr);
+        }
+        GLFWwindow *window = glfwCreateWindow(v->width, v->height, title, nullptr, nullptr);
+        if (window) {
+            int x, y;
+            glfwGetMonitorPos(m, &x, &y);
+            glfwSetWindowPos(window, x, y);
+        }
+        return window;
+    }
+
+    // Between windowed and the fullscreen mode; the swap interval is the caller's to
+    // apply again, as some platforms drop it with the switch
+    void toggle(GLFWwindow *window) {
+        GLFWmonitor *m = monitor();
+        const GLFWvidmode *v = videoMode(m);
+        if (!v) {
+            return;
+        }
+        if (mode == WindowMode::Windowed) {
+            glfwGetWindowPos(window, &windowedX, &windowedY);
+            glfwGetWindowSize(window, &windowedWidth, &windowedHeight);
+            mode = fullscreen;
+            if (mode == WindowMode::Fullscreen) {
+                glfwSetWindowMonitor(window, m, 0, 0, v->width, v->height, v->refreshRate);
+            } else {
+                int x, y;
+                glfwGetMonitorPos(m, &x, &y);
+                glfwSetWindowAttrib(window, GLFW_DECORATED, GLFW_FALSE);
+                glfwSetWindowMonitor(window, nullptr, x, y, v->width, v->height, GLFW_DONT_CARE);
+            }
+            return;
+        }
+        if (windowedWidth <= 0) {
+            // Started fullscreen: come back as a centred window three fifths of the monitor each way
+            windowedWidth = v->width * 3 / 5;
+            windowedHeight = v->height * 3 / 5;
+            glfwGetMonitorPos(m, &windowedX, &windowedY);
+            windowedX += (v->width - windowedWidth) / 2;
+            windowedY += (v->height - windowedHeight) / 2;
+        }
+        mode = WindowMode::Windowed;
+        glfwSetWindowAttrib(window, GLFW_DECORATED, GLFW_TRUE);
+        glfwSetWindowMonitor(window, nullptr, windowedX, windowedY, windowedWidth, windowedHeight, GLFW_DONT_CARE);
+    }
+
+    // Refresh rate of the monitor the game is shown on, 60 if it does not say
+    double refresh(GLFWwindow *window) const {
+        GLFWmonitor *m = window ? glfwGetWindowMonitor(window) : nullptr;
+        const GLFWvidmode *v = glfwGetVideoMode(m ? m : monitor());
+        return v && v->refreshRate > 0 ? v->refreshRate : 60.0;
+    }
+};
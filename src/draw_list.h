@@ -0,0 +1,194 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "frame_arena.h"
+#include "shader_program.h"
+
+// Sprite-sheet animation played on the GPU: the texture rect holds a grid of frames,
+// columns per row, left to right and top to bottom, and the vertex shader picks the
+// frame from its time uniform. A one-frame flipbook is a still sprite.
+struct Flipbook {
+    float frames = 1.0f;  // frames in the sheet
+    float columns = 1.0f; // frames per row
+    float fps = 0.0f;     // 0 holds the first frame
+
+    // Instance attribute for a sprite whose loop started at start (simulated seconds)
+    glm::vec4 instance(float start = 0.0f) const {
+        return glm::vec4(frames, columns, fps, start);
+    }
+
+    // Instance attribute started a seed-dependent fraction of a loop early, so sprites
+    // sharing a sheet do not animate in lockstep
+    glm::vec4 staggered(uint32_t seed) const {
+        float loop = fps > 0.0f ? frames / fps : 0.0f;
+        return instance(-loop * (float)((seed * 2654435761u) >> 8) / 16777216.0f);
+    }
+};
+
+// Per-instance vertex data: a 2D affine transform (centre, size, rotation as an angle
+// and the spin the vertex shader turns it by)
+// plus the UV rect sampled from the texture, a depth, the array layer, the flipbook
+// it plays and, for bindless programs, the texture handle; 72 bytes instead of a full mat4
+struct SpriteInstance {
+    glm::vec4 placement; // xy = centre, zw = size
+    glm::vec2 rotation;  // radians at simulated time 0, radians per second
+    glm::vec4 texRect;   // xy = offset, zw = scale; the whole sheet when animated
+    float depth;         // view-space z in [-1, 1]; larger is nearer
+    float layer;         // layer of a texture array, the first frame's when animated; only the ARRAY variant reads it
+    glm::vec4 animation; // Flipbook::instance(): frames, columns, frames per second, start
+    glm::uvec2 texture;  // low, high half of the bindless handle; SpriteBatch fills it in
+};
+
+// Instance for a sprite centred at centre, angle degrees counter-clockwise at
+// simulated time 0 and turning spin degrees per second; only the ROTATION variant
+// reads them, and does the trigonometry itself
+inline SpriteInstance makeSpriteInstance(const glm::vec2 &centre, const glm::vec2 &size, float angle, const glm::vec4 &texRect,
+                                         float depth = 0.0f, const glm::vec4 &animation = Flipbook().instance(),
+                                         float spin = 0.0f, float layer = 0.0f) {
+    return {glm::vec4(centre, size), glm::radians(glm::vec2(angle, spin)), texRect, depth, layer, animation, glm::uvec2(0u)};
+}
+
+// Draw commands recorded by game code without touching GL. Each command carries a
+// 64-bit sort key, from most to least significant: layer (8 bits), shader (8),
+// texture (16), depth (32). sort() orders the frame with an LSD radix sort, which is
+// stable, so commands with equal keys keep their recording order; the renderer then
+// submits runs of equal state as single instanced draws.
+//
+// The layer byte puts opaque commands first, nearest layer first, so the depth test
+// rejects what they hide before it is shaded; translucent commands follow with the
+// TRANSLUCENT bit set, farthest layer first, so they blend over what is behind them.
+struct DrawList {
+    struct Command {
+        uint64_t key;
+        uint32_t instance; // index into instances
+    };
+
+    // A texture, the sampler it is read through and the outline its sprites are drawn
+    // over; the same texture can be registered several times with different samplers
+    // or outlines
+    struct TextureBinding {
+        GLuint texture;
+        GLuint sampler; // 0 uses the texture's own parameters
+        GLenum target = GL_TEXTURE_2D; // or GL_TEXTURE_2D_ARRAY, for the ARRAY variant
+        GLint firstVertex = 0;   // strip in the sprite batch's vertex buffer: a GeometryCache outline slot,
+        GLsizei vertexCount = 0; // or with no vertices the batch's own quad
+    };
+
+    FrameVector<Command> commands, scratch; // frame memory: clear() every frame
+    FrameVector<SpriteInstance> instances;
+    std::vector<ShaderProgram *> shaders;  // key shader field -> program
+    std::vector<TextureBinding> textures;  // key texture field -> texture and sampler
+
+    static const uint8_t TRANSLUCENT = 0x80; // layer bit of blended commands
+    static const uint8_t MAX_LAYER = 0x7F;
+
+    // Key layer byte for a scene layer (0 = farthest) drawn opaque or translucent
+    static uint8_t sortLayer(uint8_t layer, bool opaque) {
+        return opaque ? (uint8_t)(MAX_LAYER - layer) : (uint8_t)(TRANSLUCENT | layer);
+    }
+
+    static bool translucentOf(uint64_t key) {
+        return (key >> 56) & TRANSLUCENT;
+    }
+
+    static uint64_t makeKey(uint8_t layer, uint8_t shader, uint16_t texture, uint32_t depth) {
+        return ((uint64_t)layer << 56) | ((uint64_t)shader << 48) | ((uint64_t)texture << 32) | depth;
+    }
+
+    // Everything above depth; commands sharing it can go in one draw
+    static uint64_t stateOf(uint64_t key) {
+        return key >> 32;
+    }
+
+    // Layer and shader only: all a bindless program's draw has to split on
+    static uint64_t programStateOf(uint64_t key) {
+        return key >> 48;
+    }
+
+    static uint8_t shaderOf(uint64_t key) {
+        return (uint8_t)(key >> 48);
+    }
+
+    static uint16_t textureOf(uint64_t key) {
+        return (uint16_t)(key >> 32);
+    }
+
+    // Register a program or texture and return the id to put in keys; setup code only
+    uint8_t shader(ShaderProgram *program) {
+        for (size_t i = 0; i < shaders.size(); i++) {
+            if (shaders[i] == program) {
+                return (uint8_t)i;
+            }
+        }
+        shaders.push_back(program);
+        return (uint8_t)(shaders.size() - 1);
+    }
+
+    uint16_t texture(GLuint texID, GLuint sampler = 0, GLenum target = GL_TEXTURE_2D, GLint firstVertex = 0) {
+        for (size_t i = 0; i < textures.size(); i++) {
+            if (textures[i].texture == texID && textures[i].sampler == sampler && textures[i].firstVertex == firstVertex) {
+                return (uint16_t)i;
+            }
+        }
+        textures.push_back({texID, sampler, target, firstVertex});
+        return (uint16_t)(textures.size() - 1);
+    }
+
+    void reserve(size_t capacity) {
+        commands.reserve(capacity);
+        scratch.reserve(capacity);
+        instances.reserve(capacity);
+    }
+
+    void clear() {
+        commands.clear();
+        instances.clear();
+    }
+
+    void add(uint64_t key, const SpriteInstance &instance) {
+        commands.push_back({key, (uint32_t)instances.size()});
+        instances.push_back(instance);
+    }
+
+    bool empty() const {
+        return commands.empty();
+    }
+
+    // LSD radix sort of the commands by key, one byte per pass. All eight histograms
+    // are built in a single read, and passes whose byte is the same for every
+    // command (typically most of them) are skipped.
+    void sort() {
+        const size_t count = commands.size();
+        if (count < 2) {
+            return;
+        }
+        uint32_t histograms[8][256] = {};
+        for (const Command &c : commands) {
+            for (int b = 0; b < 8; b++) {
+                histograms[b][(c.key >> (b * 8)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(count);
+        for (int b = 0; b < 8; b++) {
+            uint32_t *h = histograms[b];
+            if (h[(commands[0].key >> (b * 8)) & 0xFF] == count) {
+                continue; // every key has the same byte here
+            }
+            uint32_t offset = 0;
+            for (int v = 0; v < 256; v++) {
+                uint32_t n = h[v];
+                h[v] = offset;
+                offset += n;
+            }
+            for (const Command &c : commands) {
+                scratch[h[(c.key >> (b * 8)) & 0xFF]++] = c;
+            }
+            commands.swap(scratch);
+        }
+    }
+};
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <glad/glad.h>
+#include "gl_markers.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "view_transform.h"
+
+// Renders the scene into an offscreen colour buffer at a fraction of the letterboxed
+// viewport and upscales it with one linear blit. The buffer is allocated at full
+// size, so changing the scale only changes the region drawn: nothing is reallocated
+// until the window itself is resized. The scale follows the GPU timer: it drops
+// quickly when the draw section runs over its share of the frame budget and creeps
+// back once there is headroom, waiting a few frames after each change because
+// timer results arrive late.
+struct DynamicResolution {
+    static constexpr float STEP_DOWN = 0.9f, STEP_UP = 1.05f;
+    static constexpr double HIGH_WATER = 0.85, LOW_WATER = 0.6; // fractions of the budget
+    static const int SETTLE_FRAMES = 12; // frames to wait after a change before judging again
+
+    bool enabled = false;
+    float minScale = 0.5f, maxScale = 1.0f, scale = 1.0f; // maxScale is lowered by the power policy on battery
+    GLuint fbo = 0, color = 0, depth = 0;
+    int width = 0, height = 0; // allocated size: the full viewport
+    int settle = 0;
+    int changes = 0;
+
+    void setup(float minimum) {
+        enabled = true;
+        minScale = std::min(std::max(minimum, 0.1f), 1.0f);
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glGenRenderbuffers(1, &depth);
+    }
+
+    // Reallocate for a viewport of the given size; a no-op when it is unchanged
+    void resize(int viewportWidth, int viewportHeight) {
+        if (!enabled || (viewportWidth == width && viewportHeight == height)) {
+            return;
+        }
+        width = viewportWidth;
+        height = viewportHeight;
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, color, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, depth, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glMarkers.label(GL_FRAMEBUFFER, fbo, "dynamic resolution");
+    }
+
+    int scaledWidth() const {
+        return std::max(1, (int)std::lround(width * scale));
+    }
+
+    int scaledHeight() const {
+        return std::max(1, (int)std::lround(height * scale));
+    }
+
+    // Redirect drawing into the scaled region of the offscreen buffer
+    void begin(const ViewTransform &view) {
+        if (!enabled) {
+            return;
+        }
+        resize(view.width, view.height);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.drawInto(scaledWidth(), scaledHeight());
+    }
+
+    // Upscale what was drawn into the letterboxed viewport of the default framebuffer
+    void end(const ViewTransform &view) {
+        if (!enabled) {
+            return;
+        }
+        glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glClear(GL_COLOR_BUFFER_BIT); // the letterbox bars
+        glBlitFramebuffer(0, 0, scaledWidth(), scaledHeight(), view.x, view.y, view.x + view.width,
+                          view.y + view.height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        view.apply();
+    }
+
+    // Pick the scale for the next frame from the latest GPU time of the draw section;
+    // gpuMs < 0 means no new measurement
+    void update(double gpuMs, double budgetMs) {
+        if (!enabled || gpuMs < 0.0 || --settle > 0) {
+            return;
+        }
+        float next = scale;
+        if (gpuMs > budgetMs * HIGH_WATER) {
+            next = std::max(scale * STEP_DOWN, minScale);
+        } else if (gpuMs < budgetMs * LOW_WATER) {
+            next = std::min(scale * STEP_UP, maxScale);
+        }
+        if (next != scale) {
+            scale = next;
+            settle = SETTLE_FRAMES;
+            changes++;
+        }
+    }
+
+    // Cap the scale, clamping the current one straight away
+    void limit(float maximum) {
+        if (!enabled) {
+            return;
+        }
+        maxScale = std::min(std::max(maximum, minScale), 1.0f);
+        if (scale > maxScale) {
+            scale = maxScale;
+            settle = SETTLE_FRAMES;
+            changes++;
+        }
+    }
+
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        memoryStats.untrackGl(GL_RENDERBUFFER, color);
+        memoryStats.untrackGl(GL_RENDERBUFFER, depth);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glState.deleteFramebuffers(1, &fbo);
+        fbo = color = depth = 0;
+        enabled = false;
+    }
+};
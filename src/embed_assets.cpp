@@ -0,0 +1,57 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Build step that turns files into constexpr byte arrays in a generated header,
+// read back through embedded_assets.h. Typical use, from src/:
+//   bake_textures ../textures && embed_assets generated/embedded_data.h ../textures/atlas.stex
+// Each asset is looked up by its file name; arrays are 16-byte aligned so containers
+// can be read in place.
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "Usage: embed_assets <output.h> <file>..." << endl;
+        return 1;
+    }
+
+    FILE *out = fopen(argv[1], "w");
+    if (!out) {
+        cout << "Cannot write " << argv[1] << endl;
+        return 1;
+    }
+    fprintf(out, "#pragma once\n\n// Generated by embed_assets; do not edit\n\n");
+
+    vector<pair<string, size_t>> assets; // file name and size of each array
+    for (int i = 2; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        if (!in) {
+            cout << "Cannot read " << argv[i] << endl;
+            fclose(out);
+            return 1;
+        }
+        vector<unsigned char> bytes((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        string path = argv[i];
+        assets.push_back({path.substr(path.find_last_of("/\\") + 1), bytes.size()});
+
+        fprintf(out, "alignas(16) constexpr unsigned char EMBEDDED_%d[] = {", i - 2);
+        for (size_t b = 0; b < bytes.size(); b++) {
+            fprintf(out, "%s%u,", b % 32 == 0 ? "\n    " : "", bytes[b]);
+        }
+        if (bytes.empty()) {
+            fprintf(out, "0"); // a zero-length array is not allowed; the size below stays 0
+        }
+        fprintf(out, "\n};\n\n");
+        cout << "Embedded " << path << " (" << bytes.size() << " bytes)" << endl;
+    }
+
+    fprintf(out, "constexpr EmbeddedAsset EMBEDDED_ASSETS[] = {\n");
+    for (size_t i = 0; i < assets.size(); i++) {
+        fprintf(out, "    {\"%s\", EMBEDDED_%zu, %zu},\n", assets[i].first.c_str(), i, assets[i].second);
+    }
+    fprintf(out, "};\n");
+    return fclose(out) == 0 ? 0 : 1;
+}
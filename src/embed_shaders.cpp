@@ -0,0 +1,96 @@
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+using namespace std;
+
+// Reads a GLSL file, replacing every #include "file" line with that file's
+// expanded text, resolved next to the including file. stack guards against cycles.
+bool expand(const string &path, string &out, set<string> &stack) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        cout << "Cannot read " << path << endl;
+        return false;
+    }
+    if (!stack.insert(path).second) {
+        cout << path << " includes itself" << endl;
+        return false;
+    }
+    string directory = path.substr(0, path.find_last_of("/\\") + 1);
+    string line;
+    while (getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        size_t open = line.find('"');
+        if (line.compare(0, 8, "#include") == 0 && open != string::npos) {
+            string included = directory + line.substr(open + 1, line.find('"', open + 1) - open - 1);
+            if (!expand(included, out, stack)) {
+                return false;
+            }
+        } else {
+            out += line + "\n";
+        }
+    }
+    stack.erase(path);
+    return true;
+}
+
+// SHADER_SPRITE_VERT for .../sprite.vert.glsl
+string symbolOf(const string &path) {
+    string name = path.substr(path.find_last_of("/\\") + 1);
+    name = name.substr(0, name.rfind(".glsl"));
+    string symbol = "SHADER_";
+    for (char c : name) {
+        symbol += isalnum((unsigned char)c) ? (char)toupper((unsigned char)c) : '_';
+    }
+    return symbol;
+}
+
+// Build step that embeds GLSL stages as constexpr ShaderSources in a generated
+// header, read back through embedded_shaders.h. Each source is written as a raw
+// string literal and hashed by the compiler (fnv1a is constexpr), so the hash always
+// matches the text and the game never hashes sources at startup. Typical use, from src/:
+//   embed_shaders generated/shader_sources.h shaders/sprite.vert.glsl shaders/sprite.frag.glsl ...
+// Files that are only #included need not be listed.
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        cout << "Usage: embed_shaders <output.h> <file.glsl>..." << endl;
+        return 1;
+    }
+
+    error_code ec;
+    filesystem::path parent = filesystem::path(argv[1]).parent_path();
+    if (!parent.empty()) {
+        filesystem::create_directories(parent, ec); // generated/ is not checked in
+    }
+    FILE *out = fopen(argv[1], "wb");
+    if (!out) {
+        cout << "Cannot write " << argv[1] << endl;
+        return 1;
+    }
+    fprintf(out, "#pragma once\n\n// Generated by embed_shaders; do not edit\n");
+    for (int i = 2; i < argc; i++) {
+        string path = argv[i], text;
+        set<string> stack;
+        if (!expand(path, text, stack)) {
+            fclose(out);
+            return 1;
+        }
+        if (text.find(")glsl\"") != string::npos) {
+            cout << path << " contains the raw string delimiter )glsl\"" << endl;
+            fclose(out);
+            return 1;
+        }
+        string symbol = symbolOf(path), name = path.substr(path.find_last_of("/\\") + 1);
+        fprintf(out, "\nconstexpr char %s_TEXT[] = R\"glsl(%s)glsl\";\n", symbol.c_str(), text.c_str());
+        fprintf(out, "constexpr ShaderSource %s = {\"%s\", %s_TEXT, fnv1a(%s_TEXT)};\n", symbol.c_str(), name.c_str(),
+                symbol.c_str(), symbol.c_str());
+        cout << "Embedded " << path << " as " << symbol << " (" << text.size() << " bytes)" << endl;
+    }
+    return fclose(out) == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+
+// A file compiled into the executable by the embed_assets build step
+struct EmbeddedAsset {
+    const char *name; // file name it was embedded from, e.g. "atlas.stex"
+    const unsigned char *data;
+    size_t size;
+};
+
+// The generated table is optional: without it the game loads everything from disk
+#if __has_include("generated/embedded_data.h")
+#include "generated/embedded_data.h"
+#define SPACE_TRAVEL_EMBEDDED 1
+#endif
+
+// The embedded copy of a file, or nullptr if it was not embedded
+inline const EmbeddedAsset *findEmbeddedAsset(const char *name) {
+#ifdef SPACE_TRAVEL_EMBEDDED
+    for (const EmbeddedAsset &asset : EMBEDDED_ASSETS) {
+        if (std::strcmp(asset.name, name) == 0) {
+            return &asset;
+        }
+    }
+#endif
+    (void)name;
+    return nullptr;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "shader_source.h"
+
+// The GLSL of src/shaders/ as constexpr ShaderSources (SHADER_SPRITE_VERT for
+// sprite.vert.glsl, ...), generated by the Embed Shaders build task. Unlike the
+// embedded assets it is required: there is no on-disk fallback for shaders.
+#if __has_include("generated/shader_sources.h")
+#include "generated/shader_sources.h"
+#else
+#error "src/generated/shader_sources.h is missing: run the Embed Shaders task (embed_shaders) first"
+#endif
@@ -0,0 +1,352 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <vector>
+#include "generational_handle.h"
+#include "large_pages.h"
+
+// Stable reference to an entity; survives other entities being destroyed, and is
+// told apart from a later entity in the same slot by its generation
+typedef uint32_t EntityHandle;
+static const EntityHandle INVALID_ENTITY = 0xFFFFFFFFu;
+
+// Structure-of-arrays storage for every game object. Live entities are packed
+// densely at [0, size()) so update loops stream linearly through each field;
+// handles map to dense indices through an indirection table that is patched
+// whenever an entity moves. Handles are generational (generational_handle.h): each
+// indexOf entry carries its slot's generation beside the dense index, so alive()
+// catches a handle kept past destroy(). Freed slots are chained through their own
+// indexOf entries, and once reserve() has run nothing allocates while size() stays within
+// capacity.
+//
+// Entities are grouped by archetype: each archetype's entities are contiguous, in
+// archetype order, and carry a component mask saying which systems process them.
+// A system walks only the ranges of the archetypes whose mask it matches, so adding
+// a kind of entity never puts foreign entities into another system's hot loop.
+// Keeping the ranges contiguous costs at most one moved entity per later archetype
+// on create() and destroy(). An entity only ever moves from a higher index to a
+// lower one at or above the one destroyed, so walking indices downwards while
+// destroying stays safe; setArchetype() moves entities both ways, so walks that
+// change archetypes collect handles first. Without setArchetypes() there is one
+// archetype matching every mask.
+//
+// The per-entity arrays come from large_pages.h, so a pool reserved for a stress
+// run sits in large pages when they are enabled.
+struct EntityPool {
+    // Hot simulation fields, one array per field
+    LargePageVector<float> x, y;         // centre position
+    LargePageVector<float> prevX, prevY; // position at the previous tick, for interpolation
+    LargePageVector<float> vy;           // vertical velocity in pixels per second
+    LargePageVector<float> width, height;
+    LargePageVector<float> angle;        // degrees at simulated time 0
+    LargePageVector<float> spin;         // degrees per second; the vertex shader turns the sprite, the CPU never does
+    LargePageVector<int8_t> lane;        // lane index, -1 if not lane-bound
+    LargePageVector<uint8_t> material;   // index into the renderer's material table
+
+    LargePageVector<EntityHandle> handleOf; // dense index -> handle
+    LargePageVector<uint32_t> indexOf;      // handle's slot -> generation and dense index, or next free slot
+    EntityHandle freeHead = INVALID_ENTITY; // first free slot
+    size_t capacity = 0;
+
+    std::vector<uint32_t> archetypeMask = {~0u};     // component bits per archetype
+    std::vector<uint32_t> archetypeStart = {0u, 0u}; // first index per archetype, then size()
+
+    size_t size() const {
+        return x.size();
+    }
+
+    bool full() const {
+        return size() >= capacity;
+    }
+
+    // Declare the archetypes by their component masks; only while the pool is empty
+    void setArchetypes(const std::vector<uint32_t> &masks) {
+        archetypeMask = masks;
+        archetypeStart.assign(masks.size() + 1, 0u);
+    }
+
+    size_t archetypeCount() const {
+        return archetypeMask.size();
+    }
+
+    // The archetype owning dense index i
+    uint8_t archetypeOf(uint32_t i) const {
+        uint8_t a = 0;
+        while (archetypeStart[a + 1] <= i) {
+            a++;
+        }
+        return a;
+    }
+
+    bool has(uint32_t i, uint32_t components) const {
+        return (archetypeMask[archetypeOf(i)] & components) == components;
+    }
+
+    // Call fn(begin, end) for the index range of every archetype with all the given
+    // components, in index order
+    template <typename Fn>
+    void forEachRange(uint32_t components, const Fn &fn) const {
+        for (size_t a = 0; a < archetypeCount(); a++) {
+            if ((archetypeMask[a] & components) == components && archetypeStart[a] < archetypeStart[a + 1]) {
+                fn(archetypeStart[a], archetypeStart[a + 1]);
+            }
+        }
+    }
+
+    // forEachRange() from the last archetype to the first, for systems that destroy
+    // entities of the range they are given (walking each range downwards)
+    template <typename Fn>
+    void forEachRangeBackwards(uint32_t components, const Fn &fn) const {
+        for (size_t a = archetypeCount(); a-- > 0;) {
+            if ((archetypeMask[a] & components) == components && archetypeStart[a] < archetypeStart[a + 1]) {
+                fn(archetypeStart[a], archetypeStart[a + 1]);
+            }
+        }
+    }
+
+    void reserve(size_t newCapacity) {
+        capacity = newCapacity;
+        size_t slots = capacity + 1; // and setArchetype()'s spare
+        x.reserve(slots); y.reserve(slots);
+        prevX.reserve(slots); prevY.reserve(slots);
+        vy.reserve(slots);
+        width.reserve(slots); height.reserve(slots);
+        angle.reserve(slots);
+        spin.reserve(slots);
+        lane.reserve(slots);
+        material.reserve(slots);
+        handleOf.reserve(slots);
+        indexOf.reserve(capacity);
+    }
+
+    EntityHandle create(float px, float py, float w, float h, float velocityY, int8_t entityLane, uint8_t entityMaterial,
+                        uint8_t archetype = 0) {
+        uint32_t s;
+        if (freeHead != INVALID_ENTITY) {
+            s = freeHead;
+            uint32_t next = handleIndex(indexOf[s]);
+            freeHead = next == HANDLE_INDEX_MASK ? INVALID_ENTITY : next;
+        } else {
+            s = (uint32_t)indexOf.size();
+            indexOf.push_back(0);
+        }
+        EntityHandle handle = withIndex(indexOf[s], s);
+
+        // Open a slot at the end, then walk it down to the end of the archetype's range
+        pushSlot();
+        uint32_t slot = openSlot(archetype);
+
+        x[slot] = px; y[slot] = py;
+        prevX[slot] = px; prevY[slot] = py;
+        vy[slot] = velocityY;
+        width[slot] = w; height[slot] = h;
+        angle[slot] = 0.0f;
+        spin[slot] = 0.0f;
+        lane[slot] = entityLane;
+        material[slot] = entityMaterial;
+        handleOf[slot] = handle;
+        indexOf[s] = withIndex(handle, slot);
+        return handle;
+    }
+
+    // Remove an entity: the last of its archetype fills its slot, and the hole that
+    // leaves moves up through the later archetypes to the end
+    void destroy(EntityHandle handle) {
+        uint32_t s = handleIndex(handle);
+        closeSlot(handleIndex(indexOf[s]));
+        popSlot();
+        indexOf[s] = retiredEntry(indexOf[s], handleIndex(freeHead));
+        freeHead = s;
+    }
+
+    // Move a live entity into another archetype's range, keeping its handle and
+    // fields: it waits in a spare slot past the end while its hole is closed as
+    // destroy() would, then goes into a slot opened as create() would
+    void setArchetype(EntityHandle handle, uint8_t archetype) {
+        uint32_t from = index(handle);
+        pushSlot();
+        uint32_t spare = (uint32_t)size() - 1;
+        move(from, spare);
+        closeSlot(from);
+        move(spare, openSlot(archetype));
+        popSlot();
+    }
+
+    // The last entity of the hole's archetype fills it, and the hole that leaves moves
+    // up through the later archetypes to the last counted slot, which is then uncounted
+    void closeSlot(uint32_t hole) {
+        for (size_t a = archetypeOf(hole); a < archetypeCount(); a++) {
+            uint32_t last = --archetypeStart[a + 1];
+            if (last != hole) {
+                move(last, hole);
+            }
+            hole = last;
+        }
+    }
+
+    // Count the slot after the last counted one and walk it down to the end of the
+    // archetype's range, moving the first entity of every later archetype into it
+    uint32_t openSlot(uint8_t archetype) {
+        uint32_t slot = archetypeStart.back()++;
+        for (size_t a = archetypeCount() - 1; a > archetype; a--) {
+            if (archetypeStart[a] != slot) {
+                move(archetypeStart[a], slot);
+            }
+            slot = archetypeStart[a]++;
+        }
+        return slot;
+    }
+
+    void pushSlot() {
+        x.push_back(0.0f); y.push_back(0.0f);
+        prevX.push_back(0.0f); prevY.push_back(0.0f);
+        vy.push_back(0.0f);
+        width.push_back(0.0f); height.push_back(0.0f);
+        angle.push_back(0.0f);
+        spin.push_back(0.0f);
+        lane.push_back(0);
+        material.push_back(0);
+        handleOf.push_back(INVALID_ENTITY);
+    }
+
+    void popSlot() {
+        x.pop_back(); y.pop_back();
+        prevX.pop_back(); prevY.pop_back();
+        vy.pop_back();
+        width.pop_back(); height.pop_back();
+        angle.pop_back();
+        spin.pop_back();
+        lane.pop_back();
+        material.pop_back();
+        handleOf.pop_back();
+    }
+
+    // Copy every field of the entity at from into slot to and repoint its handle
+    void move(uint32_t from, uint32_t to) {
+        x[to] = x[from]; y[to] = y[from];
+        prevX[to] = prevX[from]; prevY[to] = prevY[from];
+        vy[to] = vy[from];
+        width[to] = width[from]; height[to] = height[from];
+        angle[to] = angle[from];
+        spin[to] = spin[from];
+        lane[to] = lane[from];
+        material[to] = material[from];
+        handleOf[to] = handleOf[from];
+        uint32_t s = handleIndex(handleOf[to]);
+        indexOf[s] = withIndex(indexOf[s], to);
+    }
+
+    // Dense index of a live entity
+    uint32_t index(EntityHandle handle) const {
+        return handleIndex(indexOf[handleIndex(handle)]);
+    }
+
+    // False once the entity is destroyed, even after its slot went to another
+    bool alive(EntityHandle handle) const {
+        uint32_t s = handleIndex(handle);
+        return s < indexOf.size() && sameGeneration(indexOf[s], handle) && index(handle) < size() &&
+               handleOf[index(handle)] == handle;
+    }
+
+    // Copy current positions to the previous-tick arrays, of the first count entities
+    void storePrevious(size_t count = SIZE_MAX) {
+        count = std::min(count, size());
+        std::copy_n(x.begin(), count, prevX.begin());
+        std::copy_n(y.begin(), count, prevY.begin());
+    }
+
+    // Counts at the head of save()'s bytes; the arrays follow in member order
+    struct SavedHead {
+        uint32_t size, handles, archetypes;
+        EntityHandle freeHead;
+    };
+
+    // Append everything but the archetype masks and capacity, which setup fixes, as
+    // raw arrays: the state a replay keyframe needs to put the pool back
+    void save(std::vector<uint8_t> &out) const {
+        SavedHead head = {(uint32_t)size(), (uint32_t)indexOf.size(), (uint32_t)archetypeCount(), freeHead};
+        append(out, &head, sizeof(head));
+        for (const LargePageVector<float> *field : {&x, &y, &prevX, &prevY, &vy, &width, &height, &angle, &spin}) {
+            append(out, field->data(), field->size() * sizeof(float));
+        }
+        append(out, lane.data(), lane.size());
+        append(out, material.data(), material.size());
+        append(out, handleOf.data(), handleOf.size() * sizeof(EntityHandle));
+        append(out, indexOf.data(), indexOf.size() * sizeof(uint32_t));
+        append(out, archetypeStart.data(), archetypeStart.size() * sizeof(uint32_t));
+    }
+
+    // Whether save()'s bytes at p fit this pool, without touching it: the counts
+    // within its archetypes and capacity, every array there, each material below
+    // materials, and the archetype ranges in order from 0 to the size
+    bool fits(const uint8_t *p, const uint8_t *end, size_t materials) const {
+        SavedHead head;
+        if (!take(p, end, &head, sizeof(head)) || head.archetypes != archetypeCount() || head.size > capacity ||
+            head.handles > capacity) {
+            return false;
+        }
+        size_t size = head.size, starts = archetypeStart.size() * sizeof(uint32_t);
+        size_t bytes = size * (9 * sizeof(float) + 2 + sizeof(EntityHandle)) + head.handles * sizeof(uint32_t) + starts;
+        if ((size_t)(end - p) < bytes) {
+            return false;
+        }
+        const uint8_t *materialBytes = p + size * (9 * sizeof(float) + 1);
+        for (size_t i = 0; i < size; i++) {
+            if (materialBytes[i] >= materials) {
+                return false;
+            }
+        }
+        uint32_t previous = 0, start = 0;
+        for (size_t a = 0; a < archetypeStart.size(); a++) {
+            std::memcpy(&start, p + bytes - starts + a * sizeof(uint32_t), sizeof(start));
+            if ((a == 0 && start != 0) || start < previous || start > size) {
+                return false;
+            }
+            previous = start;
+        }
+        return start == size;
+    }
+
+    // Put back what save() wrote, advancing p past it: each array is resized within
+    // the capacity reserve() gave it and filled with one memcpy. False, changing
+    // nothing, unless fits() holds.
+    bool load(const uint8_t *&p, const uint8_t *end, size_t materials) {
+        if (!fits(p, end, materials)) {
+            return false;
+        }
+        SavedHead head;
+        take(p, end, &head, sizeof(head));
+        for (LargePageVector<float> *field : {&x, &y, &prevX, &prevY, &vy, &width, &height, &angle, &spin}) {
+            field->resize(head.size);
+            take(p, end, field->data(), head.size * sizeof(float));
+        }
+        lane.resize(head.size);
+        material.resize(head.size);
+        handleOf.resize(head.size);
+        indexOf.resize(head.handles);
+        freeHead = head.freeHead;
+        take(p, end, lane.data(), head.size);
+        take(p, end, material.data(), head.size);
+        take(p, end, handleOf.data(), head.size * sizeof(EntityHandle));
+        take(p, end, indexOf.data(), head.handles * sizeof(uint32_t));
+        take(p, end, archetypeStart.data(), archetypeStart.size() * sizeof(uint32_t));
+        return true;
+    }
+
+    static bool take(const uint8_t *&p, const uint8_t *end, void *data, size_t bytes) {
+        if ((size_t)(end - p) < bytes) {
+            return false;
+        }
+        std::memcpy(data, p, bytes);
+        p += bytes;
+        return true;
+    }
+
+    static void append(std::vector<uint8_t> &out, const void *data, size_t bytes) {
+        out.insert(out.end(), (const uint8_t *)data, (const uint8_t *)data + bytes);
+    }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+#include "lockfree_queue.h"
+#include "small_function.h"
+
+// Gameplay events raised by the simulation
+enum GameEventType : uint8_t {
+    EVENT_SPAWN,       // a comet entered; lane
+    EVENT_LANE_CHANGE, // the ship started moving; lane it heads for
+    EVENT_COLLISION,   // the ship hit a comet; x, y of the ship
+    EVENT_GAME_OVER,   // the run ended; x, y of the ship
+    EVENT_TYPE_COUNT
+};
+
+struct GameEvent {
+    GameEventType type;
+    int8_t lane;
+    uint32_t tick; // simulation tick it happened on
+    float x, y;
+};
+
+// Decouples what the simulation does from who reacts to it. The simulation
+// publishes events into a per-tick batch and hands the whole batch over at the end
+// of the tick through an SpscQueue; the render thread dispatches what has arrived
+// once per frame, so listeners only ever see complete ticks and run on the thread
+// that owns audio, particles and the overlay. Listeners are SmallFunctions in fixed
+// tables: subscribing never allocates and dispatching an event is one indirect call
+// per listener. Subscribe before the simulation starts; events of a type nobody
+// listens to are dropped at publish.
+struct EventBus {
+    static const int MAX_LISTENERS = 4; // per event type
+    static const uint32_t TICK_CAPACITY = 64, RING_CAPACITY = 1024;
+
+    using Listener = SmallFunction<void(const GameEvent &), 32>;
+
+    Listener listeners[EVENT_TYPE_COUNT][MAX_LISTENERS];
+    int listenerCount[EVENT_TYPE_COUNT] = {};
+    GameEvent batch[TICK_CAPACITY];
+    uint32_t batched = 0;
+    SpscQueue<GameEvent, RING_CAPACITY> ring; // simulation to render thread
+    std::atomic<uint32_t> dropped{0};         // batch or ring full
+    uint64_t dispatched = 0;
+    bool muted = false; // while ticks run that nobody watches, such as a replay seek's catch-up
+
+    template <typename F>
+    bool subscribe(GameEventType type, F &&listener) {
+        if (listenerCount[type] == MAX_LISTENERS) {
+            return false;
+        }
+        listeners[type][listenerCount[type]++] = Listener(std::forward<F>(listener));
+        return true;
+    }
+
+    // Simulation: queue an event for the end of the tick
+    void publish(GameEventType type, uint32_t tick, int lane = 0, float x = 0.0f, float y = 0.0f) {
+        if (listenerCount[type] == 0 || muted) {
+            return;
+        }
+        if (batched == TICK_CAPACITY) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        batch[batched++] = {type, (int8_t)lane, tick, x, y};
+    }
+
+    // Simulation: hand the tick's batch to the render thread
+    void endTick() {
+        for (uint32_t i = 0; i < batched; i++) {
+            if (!ring.push(batch[i])) {
+                dropped.fetch_add(batched - i, std::memory_order_relaxed);
+                break;
+            }
+        }
+        batched = 0;
+    }
+
+    // Render thread: deliver every event handed over so far, in order
+    void dispatch() {
+        GameEvent event;
+        while (ring.pop(event)) {
+            for (int i = 0; i < listenerCount[event.type]; i++) {
+                listeners[event.type][i](event);
+            }
+            dispatched++;
+        }
+    }
+};
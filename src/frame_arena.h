@@ -0,0 +1,183 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "memory_stats.h"
+
+// Bump allocator for render data that only lives for the frame it was recorded in:
+// draw lists, their sort scratch and the batch's staging copy. beginFrame() moves to
+// the next of FRAMES regions and rewinds it in O(1), so whatever the previous
+// FRAMES - 1 frames allocated stays valid while those frames may still be in flight.
+// A frame that outgrows its region takes the rest from the heap and the region is
+// regrown to the high-water mark the next time it comes round, so once the scene has
+// been seen the frame loop makes no general-purpose allocations. Nothing is freed
+// individually and no destructors run. Render thread only.
+struct FrameArena {
+    static const int FRAMES = 3;
+    static const size_t ALIGNMENT = 16;
+
+    struct Region {
+        unsigned char *data = nullptr;
+        size_t size = 0;
+        std::vector<unsigned char *> spills; // heap blocks taken when data ran out
+    };
+
+    Region regions[FRAMES];
+    int current = 0;
+    uint64_t frame = 0;   // frames begun, for FrameVector's staleness check
+    size_t used = 0;      // bytes handed out this frame, spills included
+    size_t peak = 0;      // most bytes any frame has needed
+    uint64_t spilled = 0; // allocations that did not fit their region
+
+    FrameArena() = default;
+    FrameArena(const FrameArena &) = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    ~FrameArena() {
+        for (Region &r : regions) {
+            releaseSpills(r);
+            delete[] r.data;
+        }
+    }
+
+    static size_t align(size_t n) {
+        return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    // Allocate every region up front, before the frame loop starts
+    void setup(size_t bytesPerFrame) {
+        peak = std::max(peak, align(bytesPerFrame));
+        for (Region &r : regions) {
+            grow(r, peak);
+        }
+    }
+
+    // Rewind the region of the frame FRAMES - 1 frames back and make it current
+    void beginFrame() {
+        current = (current + 1) % FRAMES;
+        frame++;
+        used = 0;
+        Region &r = regions[current];
+        releaseSpills(r);
+        if (r.size < peak) {
+            grow(r, peak);
+        }
+    }
+
+    void *allocate(size_t bytes) {
+        bytes = align(bytes ? bytes : 1);
+        Region &r = regions[current];
+        size_t offset = used;
+        used += bytes;
+        peak = std::max(peak, used);
+        if (used <= r.size) {
+            return r.data + offset;
+        }
+        spilled++;
+        MemoryScope memory(MEM_CPU_RENDERER);
+        unsigned char *block = new unsigned char[bytes];
+        r.spills.push_back(block);
+        return block;
+    }
+
+    template <typename T>
+    T *allocate(size_t count) {
+        static_assert(std::is_trivially_copyable<T>::value, "frame memory is never destroyed");
+        return (T *)allocate(count * sizeof(T));
+    }
+
+    static void releaseSpills(Region &r) {
+        for (unsigned char *block : r.spills) {
+            delete[] block;
+        }
+        r.spills.clear();
+    }
+
+    static void grow(Region &r, size_t size) {
+        MemoryScope memory(MEM_CPU_RENDERER);
+        delete[] r.data;
+        r.data = new unsigned char[size];
+        r.size = size;
+        r.spills.reserve(8);
+    }
+};
+
+inline FrameArena frameArena;
+
+// Growable array of trivially copyable elements in frameArena. Growing copies into a
+// larger allocation, so pointers into it do not survive push_back, and an array kept
+// from an earlier frame is moved into the current one before it is written again, so
+// it never writes into a region that may be rewound under it; contents older than
+// FRAMES - 1 frames are gone. reserve() only sizes the first allocation of each frame.
+template <typename T>
+struct FrameVector {
+    T *items = nullptr;
+    size_t count = 0, capacity = 0;
+    size_t hint = 16;
+    uint64_t frame = 0; // FrameArena::frame when items was allocated
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    T *data() { return items; }
+    const T *data() const { return items; }
+    T &operator[](size_t i) { return items[i]; }
+    const T &operator[](size_t i) const { return items[i]; }
+    T *begin() { return items; }
+    T *end() { return items + count; }
+    const T *begin() const { return items; }
+    const T *end() const { return items + count; }
+
+    void reserve(size_t n) {
+        hint = std::max(hint, n);
+        if (items && n > capacity) {
+            regrow(n);
+        }
+    }
+
+    // Drop the contents; the memory goes back with its frame
+    void clear() {
+        items = nullptr;
+        count = capacity = 0;
+    }
+
+    void push_back(const T &value) {
+        if (count == capacity || frame != frameArena.frame) {
+            regrow(std::max(std::max(capacity * 2, hint), count + 1));
+        }
+        items[count++] = value;
+    }
+
+    // Grow or shrink without initializing new elements
+    void resize(size_t n) {
+        if (n > capacity || frame != frameArena.frame) {
+            regrow(std::max(std::max(n, hint), capacity));
+        }
+        count = n;
+    }
+
+    void swap(FrameVector &other) {
+        std::swap(items, other.items);
+        std::swap(count, other.count);
+        std::swap(capacity, other.capacity);
+        std::swap(hint, other.hint);
+        std::swap(frame, other.frame);
+    }
+
+    void regrow(size_t n) {
+        T *moved = frameArena.allocate<T>(n);
+        if (frameArena.frame - frame >= (uint64_t)FrameArena::FRAMES) {
+            count = 0; // its region has been rewound since: nothing left to keep
+        }
+        if (count) {
+            std::memcpy((void *)moved, (const void *)items, count * sizeof(T));
+        }
+        items = moved;
+        capacity = n;
+        frame = frameArena.frame;
+    }
+};
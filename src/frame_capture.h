@@ -0,0 +1,296 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_state.h"
+#include "lockfree_queue.h"
+#include "memory_stats.h"
+#include "thread_config.h"
+#include "video_pipe.h"
+
+// Screenshots and frame-sequence recordings that never stall the GPU. A capture is
+// a glReadPixels into one of SLOTS pixel-pack buffers, which returns as soon as the
+// copy is queued; the buffer is fenced and only mapped once the fence has signalled,
+// LATENCY or more frames later, so the CPU never waits for the GPU to catch up. The
+// mapped pixels are copied out and RLE-compressed into TGA files on a worker thread,
+// reached (and their buffers recycled) through SpscQueues, as in VideoPipe.
+// When every buffer is still in flight, or the worker is QUEUE_LIMIT frames behind,
+// the frame is dropped rather than waited for. A video recording reads back every
+// frame through the same ring and hands it to a VideoPipe instead.
+struct FrameCapture {
+    static const int SLOTS = 4;
+    static const int LATENCY = 2;      // frames between a readback and mapping its buffer
+    static const uint32_t QUEUE_LIMIT = 8; // frames waiting to be encoded; power of two
+
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr; // set while a readback is in flight
+        GLsizeiptr size = 0;    // allocated bytes
+        int width = 0, height = 0;
+        uint64_t frame = 0; // frame the readback was issued on
+        std::string path;   // TGA to write, if any
+        bool video = false; // also a frame of the video
+    };
+
+    struct Job {
+        std::vector<uint8_t> pixels; // BGRA, bottom row first
+        int width = 0, height = 0;
+        std::string path;
+    };
+
+    bool enabled = false;
+    std::string directory;
+    Slot slots[SLOTS];
+    uint64_t frame = 0;
+    bool screenshotRequested = false;
+    bool recording = false;
+    int clip = 0;          // recordings started, for file names
+    uint64_t clipFrame = 0; // frames captured into the current recording
+
+    std::thread worker;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    SpscQueue<Job, QUEUE_LIMIT> queue;                    // render thread to worker
+    SpscQueue<std::vector<uint8_t>, 2 * QUEUE_LIMIT> spare; // encoded jobs' pixel buffers back, for reuse
+    std::atomic<bool> running{false};
+    VideoPipe video;
+
+    // Statistics
+    uint64_t captured = 0, dropped = 0;
+    std::atomic<uint64_t> written{0}, failed{0}; // by the worker
+
+    // Create the buffers and start the encoder; files go into dir, created on the first capture
+    void setup(const std::string &dir) {
+        directory = dir;
+        for (Slot &s : slots) {
+            glGenBuffers(1, &s.pbo);
+        }
+        running = true;
+        worker = std::thread([this] { workerLoop(); });
+        enabled = true;
+    }
+
+    void screenshot() {
+        screenshotRequested = true;
+    }
+
+    // Stream every frame from now on into an encoder writing output
+    void startVideo(const std::string &encoder, const std::string &output, double fps) {
+        if (enabled && !video.active()) {
+            video.start(encoder, output, fps);
+        }
+    }
+
+    void toggleRecording() {
+        recording = !recording;
+        if (recording) {
+            clip++;
+            clipFrame = 0;
+        }
+    }
+
+    // Once per frame, after the scene is drawn: retire finished readbacks, then read
+    // region of framebuffer back if a capture is due
+    void endFrame(GLuint framebuffer, const glm::vec4 &region) {
+        if (!enabled) {
+            return;
+        }
+        frame++;
+        collect(false);
+        bool still = screenshotRequested || recording;
+        if (!still && !video.active()) {
+            return;
+        }
+        char name[64] = "";
+        if (screenshotRequested) {
+            std::snprintf(name, sizeof(name), "screenshot-%06llu.tga", (unsigned long long)frame);
+        } else if (recording) {
+            std::snprintf(name, sizeof(name), "clip%02d-%06llu.tga", clip, (unsigned long long)clipFrame++);
+        }
+        screenshotRequested = false;
+
+        Slot *slot = nullptr;
+        for (Slot &s : slots) {
+            if (!s.fence) {
+                slot = &s;
+                break;
+            }
+        }
+        if (!slot) {
+            dropped++; // every buffer is still on its way back from the GPU
+            return;
+        }
+        slot->width = (int)region.z;
+        slot->height = (int)region.w;
+        slot->frame = frame;
+        slot->path = still ? directory + "/" + name : std::string();
+        slot->video = video.active();
+        if (still && captured == 0) {
+            std::error_code ec;
+            std::filesystem::create_directories(directory, ec);
+        }
+        GLsizeiptr bytes = (GLsizeiptr)slot->width * slot->height * 4;
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+        if (bytes > slot->size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            memoryStats.trackGl(GL_BUFFER, slot->pbo, MEM_BUFFERS, bytes);
+            slot->size = bytes;
+        }
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+        glReadPixels((GLint)region.x, (GLint)region.y, slot->width, slot->height, GL_BGRA, GL_UNSIGNED_BYTE, nullptr);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        captured++;
+    }
+
+    // Hand every readback whose fence has signalled to the encoder. Readbacks younger
+    // than LATENCY frames are not even polled unless waiting is allowed.
+    void collect(bool wait) {
+        for (Slot &s : slots) {
+            if (!s.fence || (!wait && frame - s.frame < (uint64_t)LATENCY)) {
+                continue;
+            }
+            GLenum status = glClientWaitSync(s.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+            if (status == GL_TIMEOUT_EXPIRED) {
+                continue; // still in flight; looked at again next frame
+            }
+            glDeleteSync(s.fence);
+            s.fence = nullptr;
+            if (status == GL_WAIT_FAILED) {
+                dropped++;
+                continue;
+            }
+            size_t bytes = (size_t)s.width * s.height * 4;
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+            if (mapped) {
+                if (s.video) {
+                    video.submit(mapped, s.width, s.height);
+                }
+                if (!s.path.empty()) {
+                    queueStill(s, mapped, bytes);
+                }
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            } else {
+                dropped++;
+            }
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    // Copy a mapped readback for the TGA worker, unless it is already QUEUE_LIMIT behind
+    void queueStill(const Slot &s, const void *mapped, size_t bytes) {
+        if (queue.full()) {
+            dropped++; // never let the backlog grow
+            return;
+        }
+        std::vector<uint8_t> pixels;
+        spare.pop(pixels); // a recycled buffer if there is one
+        {
+            MemoryScope memory(MEM_CPU_TOOLS);
+            pixels.resize(bytes);
+        }
+        std::memcpy(pixels.data(), mapped, bytes);
+        queue.push({std::move(pixels), s.width, s.height, s.path});
+        wake.notify_one();
+    }
+
+    // Write out what is still in flight, then stop the encoder
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        collect(true);
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        worker.join();
+        video.stop();
+        for (Slot &s : slots) {
+            memoryStats.untrackGl(GL_BUFFER, s.pbo);
+            glState.deleteBuffers(1, &s.pbo);
+            s = Slot();
+        }
+        enabled = false;
+        std::printf("capture: %llu frames written to %s, %llu dropped, %llu failed\n", (unsigned long long)written.load(),
+                    directory.c_str(), (unsigned long long)dropped, (unsigned long long)failed.load());
+    }
+
+    void workerLoop() {
+        configureThread(THREAD_IO, "frame capture");
+        std::vector<uint8_t> encoded;
+        for (;;) {
+            Job job;
+            bool stopping = !running; // read first: everything queued before release() is then visible
+            if (!queue.pop(job)) {
+                if (stopping) {
+                    return; // stopped, and everything queued has been written
+                }
+                // A notify can slip in between the check and the wait; the timeout bounds the delay
+                std::unique_lock<std::mutex> guard(wakeLock);
+                wake.wait_for(guard, std::chrono::milliseconds(20), [this] { return queue.size() > 0 || !running; });
+                continue;
+            }
+            encodeTga(job, encoded);
+            FILE *out = std::fopen(job.path.c_str(), "wb");
+            bool ok = out && std::fwrite(encoded.data(), 1, encoded.size(), out) == encoded.size();
+            ok = out && std::fclose(out) == 0 && ok;
+            (ok ? written : failed)++;
+            spare.push(std::move(job.pixels)); // freed here instead if the spares are full
+        }
+    }
+
+    // Run-length encoded 24-bit TGA (image type 10). The rows are already bottom-up
+    // and BGR(A), as TGA stores them, so encoding only drops alpha and packs runs.
+    static void encodeTga(const Job &job, std::vector<uint8_t> &out) {
+        out.clear();
+        const uint8_t header[18] = {0, 0, 10, 0, 0, 0, 0, 0, 0, 0, 0, 0, (uint8_t)job.width, (uint8_t)(job.width >> 8),
+                                    (uint8_t)job.height, (uint8_t)(job.height >> 8), 24, 0};
+        out.insert(out.end(), header, header + sizeof(header));
+        for (int y = 0; y < job.height; y++) {
+            const uint8_t *row = job.pixels.data() + (size_t)y * job.width * 4;
+            int x = 0;
+            while (x < job.width) {
+                // A repeat packet for two or more equal pixels, else a raw packet up to the next run
+                int run = 1;
+                while (x + run < job.width && run < 128 && samePixel(row + x * 4, row + (x + run) * 4)) {
+                    run++;
+                }
+                if (run > 1) {
+                    out.push_back((uint8_t)(0x80 | (run - 1)));
+                    out.insert(out.end(), row + x * 4, row + x * 4 + 3);
+                    x += run;
+                    continue;
+                }
+                int raw = 1;
+                while (x + raw < job.width && raw < 128 &&
+                       !(x + raw + 1 < job.width && samePixel(row + (x + raw) * 4, row + (x + raw + 1) * 4))) {
+                    raw++;
+                }
+                out.push_back((uint8_t)(raw - 1));
+                for (int i = 0; i < raw; i++) {
+                    out.insert(out.end(), row + (x + i) * 4, row + (x + i) * 4 + 3);
+                }
+                x += raw;
+            }
+        }
+    }
+
+    static bool samePixel(const uint8_t *a, const uint8_t *b) {
+        return a[0] == b[0] && a[1] == b[1] && a[2] == b[2];
+    }
+};
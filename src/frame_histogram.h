@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Log-linear histogram of durations in the style of HdrHistogram: values below
+// SUB_BUCKETS microseconds are counted exactly, and every power-of-two range above
+// is split into SUB_BUCKETS / 2 equal buckets, so any percentile is accurate to
+// within 1 / (SUB_BUCKETS / 2) relative error (1.6%) from 1 us up to over an hour,
+// in a fixed 14 KB table. Recording is a couple of shifts and an increment.
+struct FrameHistogram {
+    static const int SUB_BITS = 7;
+    static const uint64_t SUB_BUCKETS = 1 << SUB_BITS;
+    static const uint64_t HALF = SUB_BUCKETS / 2;
+    static const int MAX_SHIFT = 26; // top range starts at 2^(SUB_BITS + MAX_SHIFT - 1) us
+    static const int BUCKETS = (int)(SUB_BUCKETS + MAX_SHIFT * HALF);
+
+    uint64_t counts[BUCKETS];
+    uint64_t count = 0;
+    double maxMs = 0.0, sumMs = 0.0;
+
+    FrameHistogram() {
+        clear();
+    }
+
+    void clear() {
+        std::memset(counts, 0, sizeof(counts));
+        count = 0;
+        maxMs = sumMs = 0.0;
+    }
+
+    static int bucketOf(uint64_t us) {
+        if (us < SUB_BUCKETS) {
+            return (int)us;
+        }
+        int msb = 63 - __builtin_clzll(us);
+        int shift = msb - (SUB_BITS - 1);
+        if (shift > MAX_SHIFT) {
+            return BUCKETS - 1;
+        }
+        return (int)(SUB_BUCKETS + (shift - 1) * HALF + ((us >> shift) - HALF));
+    }
+
+    // Lowest value, in microseconds, counted by a bucket, and the bucket's width
+    static void bucketRange(int bucket, uint64_t &lowUs, uint64_t &widthUs) {
+        if (bucket < (int)SUB_BUCKETS) {
+            lowUs = (uint64_t)bucket;
+            widthUs = 1;
+            return;
+        }
+        uint64_t k = (uint64_t)bucket - SUB_BUCKETS;
+        int shift = (int)(k / HALF) + 1;
+        lowUs = (k % HALF + HALF) << shift;
+        widthUs = (uint64_t)1 << shift;
+    }
+
+    void record(double ms) {
+        if (ms < 0.0) {
+            return;
+        }
+        counts[bucketOf((uint64_t)(ms * 1000.0))]++;
+        count++;
+        sumMs += ms;
+        maxMs = ms > maxMs ? ms : maxMs;
+    }
+
+    // Value at or below which the given fraction (0..1) of samples fall, in ms;
+    // reports the middle of the bucket holding that rank, capped at the true maximum
+    double percentile(double fraction) const {
+        if (count == 0) {
+            return 0.0;
+        }
+        uint64_t rank = (uint64_t)(fraction * (double)count + 0.5);
+        rank = rank < 1 ? 1 : (rank > count ? count : rank);
+        uint64_t seen = 0;
+        for (int b = 0; b < BUCKETS; b++) {
+            seen += counts[b];
+            if (seen >= rank) {
+                uint64_t low, width;
+                bucketRange(b, low, width);
+                double ms = (low + (width - 1) / 2.0) / 1000.0;
+                return ms < maxMs ? ms : maxMs;
+            }
+        }
+        return maxMs;
+    }
+
+    double mean() const {
+        return count ? sumMs / count : 0.0;
+    }
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <algorithm>
+#include <glad/glad.h>
+
+// Caps how many frames the driver may queue ahead of the GPU. A fence follows each
+// swap, and before the CPU starts a frame (and samples input for it) it waits for
+// the fence of the frame maxInFlight back, so a key press is on screen at most
+// maxInFlight frames after it is read instead of however deep the driver's queue is.
+// Finish mode instead calls glFinish after every frame: nothing is ever queued, so
+// CPU frame times include the GPU's, at the cost of all CPU/GPU overlap.
+struct FrameLatencyLimiter {
+    static const int MAX_FRAMES = 4;
+    static const int FINISH = -1; // setup() value selecting finish mode
+
+    int maxInFlight = 2; // 0 leaves queueing to the driver
+    bool finish = false;
+    GLsync fences[MAX_FRAMES] = {};
+    int next = 0;      // slot of the frame being recorded
+    int waits = 0;     // frames that had to wait for the GPU
+
+    void setup(int frames) {
+        finish = frames == FINISH;
+        maxInFlight = finish ? 0 : std::min(std::max(frames, 0), MAX_FRAMES);
+    }
+
+    // Before sampling input for a new frame: wait until the GPU has finished the
+    // frame that would otherwise put more than maxInFlight in the queue
+    void wait() {
+        if (maxInFlight == 0 || !fences[next]) {
+            return;
+        }
+        if (glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 0) == GL_TIMEOUT_EXPIRED) {
+            waits++;
+            while (glClientWaitSync(fences[next], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+            }
+        }
+        glDeleteSync(fences[next]);
+        fences[next] = nullptr;
+    }
+
+    // After the swap: fence the frame just submitted, or drain it in finish mode
+    void frameSubmitted() {
+        if (finish) {
+            glFinish();
+            return;
+        }
+        if (maxInFlight == 0) {
+            return;
+        }
+        if (fences[next]) {
+            glDeleteSync(fences[next]);
+        }
+        fences[next] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        next = (next + 1) % maxInFlight;
+    }
+
+    void release() {
+        for (GLsync &fence : fences) {
+            if (fence) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <GLFW/glfw3.h>
+
+// How the main loop is paced against the display
+enum class PacingMode {
+    Vsync,    // wait for every vertical blank
+    Adaptive, // vsync, but tear instead of waiting a whole extra refresh when late
+    Capped,   // no vsync, CPU limiter holds a target frame rate
+    Vrr,      // variable refresh: present when ready, limited just under the top of the range
+    Uncapped  // no vsync and no limiter, for benchmarking
+};
+
+// Parses "vsync", "adaptive", "capped", "vrr" or "uncapped"; returns false for anything else
+inline bool parsePacingMode(const char *name, PacingMode &mode) {
+    if (strcmp(name, "vsync") == 0) mode = PacingMode::Vsync;
+    else if (strcmp(name, "adaptive") == 0) mode = PacingMode::Adaptive;
+    else if (strcmp(name, "capped") == 0) mode = PacingMode::Capped;
+    else if (strcmp(name, "vrr") == 0) mode = PacingMode::Vrr;
+    else if (strcmp(name, "uncapped") == 0) mode = PacingMode::Uncapped;
+    else return false;
+    return true;
+}
+
+// Selects the swap interval for the chosen mode and, in capped mode,
+// holds each frame to the target period with a hybrid sleep/spin wait. A limit
+// set on top (the power policy's on battery) runs the same wait in every mode.
+// A divisor (the frame-rate controller's) presents every nth refresh in the vsync
+// modes and divides the target in capped mode.
+//
+// On a G-Sync or FreeSync display the monitor refreshes when a frame arrives, as long
+// as frames come at a rate inside its range, so waiting for a vertical blank only
+// adds latency. VRR mode swaps without vsync and runs the limiter at VRR_HEADROOM of
+// the top of the range, so frames never come faster than the panel can refresh and
+// tear or back up into the vsync queue. A limit that puts the pace below the bottom
+// of the range turns vsync back on: there the driver repeats frames, and tears
+// between them without it. GL cannot ask whether VRR is on, so the range is the
+// player's (--vrr-range), or the display's refresh with no known bottom.
+struct FramePacer {
+    static constexpr double VRR_HEADROOM = 0.97; // of the top of the range: 144 Hz -> 139.7 fps
+
+    PacingMode mode = PacingMode::Vsync;
+    double targetFps = 60.0;
+    double limitFps = 0.0; // extra cap whatever the mode, 0 = none
+    double vrrMin = 0.0, vrrMax = 0.0; // the display's variable refresh range, Hz
+    int divisor = 1;
+    double nextDeadline = 0.0;
+
+    // Running estimate of how long a 1 ms sleep really takes (Welford mean/variance)
+    double sleepMean = 0.002, sleepM2 = 0.0;
+    long long sleepSamples = 1;
+
+    // Apply the swap interval; must be called with the window's context current
+    void setup(PacingMode requested, double fps) {
+        mode = requested;
+        targetFps = fps > 0.0 ? fps : 60.0;
+
+        if (mode == PacingMode::Adaptive &&
+            !glfwExtensionSupported("WGL_EXT_swap_control_tear") &&
+            !glfwExtensionSupported("GLX_EXT_swap_control_tear")) {
+            mode = PacingMode::Vsync; // negative intervals need the tear extension
+        }
+
+        applyInterval();
+    }
+
+    void applyInterval() {
+        switch (mode) {
+            case PacingMode::Vsync:    glfwSwapInterval(divisor); break;
+            case PacingMode::Adaptive: glfwSwapInterval(-divisor); break;
+            case PacingMode::Vrr:      glfwSwapInterval(pacedFps() < vrrMin ? 1 : 0); break;
+            case PacingMode::Capped:
+            case PacingMode::Uncapped: glfwSwapInterval(0); break;
+        }
+        nextDeadline = glfwGetTime();
+    }
+
+    // The range VRR mode paces within; maxHz is the display's refresh when the range
+    // is not known, minHz 0 then. Other modes keep it for the overlay only.
+    void setRefreshRange(double minHz, double maxHz) {
+        vrrMax = maxHz > 0.0 ? maxHz : 60.0;
+        vrrMin = std::clamp(minHz, 0.0, vrrMax);
+        if (mode == PacingMode::Vrr) {
+            targetFps = vrrMax * VRR_HEADROOM;
+            applyInterval();
+        }
+    }
+
+    // Present at 1 / n of the base rate: the refresh rate, or the target when capped
+    void divide(int n) {
+        divisor = std::max(n, 1);
+        applyInterval();
+    }
+
+    // Cap the frame rate at fps on top of the mode; 0 lifts the cap. In VRR mode the
+    // swap interval may change, so the context must be current.
+    void limit(double fps) {
+        limitFps = fps > 0.0 ? fps : 0.0;
+        if (mode == PacingMode::Vrr) {
+            applyInterval();
+        }
+        nextDeadline = glfwGetTime();
+    }
+
+    // The rate the limiter holds, 0 when it does not run
+    double pacedFps() const {
+        bool limited = mode == PacingMode::Capped || mode == PacingMode::Vrr;
+        double fps = limited ? targetFps / divisor : limitFps;
+        if (limited && limitFps > 0.0) {
+            fps = std::min(fps, limitFps);
+        }
+        return fps;
+    }
+
+    // Call once per frame before swapping; only blocks in the capped and VRR modes or
+    // under a limit
+    void wait() {
+        double fps = pacedFps();
+        if (fps <= 0.0) {
+            return;
+        }
+        double period = 1.0 / fps;
+        nextDeadline += period;
+        double now = glfwGetTime();
+        if (now > nextDeadline) {
+            nextDeadline = now; // missed the slot, don't try to catch up with short frames
+            return;
+        }
+
+        // Sleep while the deadline is further away than a pessimistic sleep estimate
+        while (nextDeadline - now > sleepMean + std::sqrt(sleepM2 / sleepSamples)) {
+            double before = glfwGetTime();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            now = glfwGetTime();
+            recordSleep(now - before);
+        }
+
+        // Spin for the remainder
+        while (glfwGetTime() < nextDeadline) {
+            std::this_thread::yield();
+        }
+    }
+
+    void recordSleep(double observed) {
+        sleepSamples++;
+        double delta = observed - sleepMean;
+        sleepMean += delta / sleepSamples;
+        sleepM2 += delta * (observed - sleepMean);
+        if (sleepSamples > 1000) {
+            // Keep adapting to timer resolution changes instead of converging forever
+            sleepSamples = 100;
+            sleepM2 = sleepM2 / 10.0;
+        }
+    }
+};
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include "frame_stats.h"
+
+// Closed-loop choice of presentation rate. Instead of alternating between frames
+// that make the refresh and frames that miss it, the game presents at the highest
+// rate it can hold: the base rate (the display refresh, or the cap) divided by 1 to
+// MAX_DIVISOR, as in 144 -> 72 -> 48 Hz. Every EVALUATE_FRAMES it takes the 95th
+// percentile of the CPU work and GPU time of the last WINDOW frames; the worse one
+// going above HIGH_WATER of the current period steps down to the next divisor at
+// once, while a faster rate is only picked back after RAISE_HOLD evaluations in a
+// row below LOW_WATER of its shorter period. The window restarts after a change so
+// the next judgement only sees frames paced at the new rate.
+struct FrameRateController {
+    static const int WINDOW = 120; // frames in the moving percentile
+    static const int EVALUATE_FRAMES = 30;
+    static const int MAX_DIVISOR = 4;
+    static const int RAISE_HOLD = 4;
+    static constexpr double PERCENTILE = 0.95;
+    static constexpr double HIGH_WATER = 0.95, LOW_WATER = 0.75; // fractions of the period
+
+    bool enabled = false;
+    double baseRate = 60.0; // Hz
+    int divisor = 1;
+    double cpu[WINDOW] = {}, gpu[WINDOW] = {}, scratch[WINDOW];
+    int next = 0, filled = 0;
+    int sinceEvaluation = 0, headroom = 0;
+    unsigned long long lastFrame = ~0ull;
+    int changes = 0;
+
+    void setup(double rate) {
+        enabled = rate > 0.0;
+        baseRate = rate;
+    }
+
+    double rate() const {
+        return baseRate / divisor;
+    }
+
+    double periodMs(int d) const {
+        return 1000.0 * d / baseRate;
+    }
+
+    // Feed the latest completed frame, once per loop iteration; true when the divisor
+    // changed and should be handed to the pacer
+    bool update(const FrameRecord &record) {
+        if (!enabled || record.frame == lastFrame) {
+            return false;
+        }
+        lastFrame = record.frame;
+        // The poll and swap phases wait for the display and the driver queue
+        cpu[next] = record.cpu[PHASE_UPDATE] + record.cpu[PHASE_DRAW];
+        gpu[next] = record.gpu;
+        next = (next + 1) % WINDOW;
+        if (filled < WINDOW) {
+            filled++;
+        }
+        if (filled < WINDOW || ++sinceEvaluation < EVALUATE_FRAMES) {
+            return false;
+        }
+        sinceEvaluation = 0;
+
+        double cost = std::max(percentile(cpu), percentile(gpu));
+        int chosen = divisor;
+        if (cost > periodMs(divisor) * HIGH_WATER && divisor < MAX_DIVISOR) {
+            chosen = divisor + 1;
+        } else if (divisor > 1 && cost < periodMs(divisor - 1) * LOW_WATER) {
+            chosen = ++headroom >= RAISE_HOLD ? divisor - 1 : divisor;
+        } else {
+            headroom = 0;
+        }
+        if (chosen == divisor) {
+            return false;
+        }
+        divisor = chosen;
+        headroom = 0;
+        filled = 0;
+        changes++;
+        return true;
+    }
+
+    // PERCENTILE of the window's samples, ignoring frames without a measurement
+    double percentile(const double *samples) {
+        int n = 0;
+        for (int i = 0; i < WINDOW; i++) {
+            if (samples[i] >= 0.0) {
+                scratch[n++] = samples[i];
+            }
+        }
+        if (n == 0) {
+            return 0.0;
+        }
+        int rank = std::min((int)(PERCENTILE * n), n - 1);
+        std::nth_element(scratch, scratch + rank, scratch + n);
+        return scratch[rank];
+    }
+};
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <glad/glad.h>
+#include "frame_histogram.h"
+#include "profiler.h"
+#include "small_function.h"
+
+// Phases of one iteration of the main loop
+enum FramePhase {
+    PHASE_POLL,
+    PHASE_UPDATE,
+    PHASE_DRAW,
+    PHASE_SWAP,
+    PHASE_COUNT
+};
+
+static const char *const FRAME_PHASE_NAMES[PHASE_COUNT] = {"poll", "update", "draw", "swap"};
+
+// Timings of one completed frame, in milliseconds
+struct FrameRecord {
+    unsigned long long frame;
+    double cpu[PHASE_COUNT];
+    double cpuTotal;
+    double gpu; // GL_TIME_ELAPSED of the draw section, -1 if it was not measured
+    double resolve; // GPU time of the MSAA resolve within it, -1 if there was none
+    uint64_t start, end; // profileTicks() at beginFrame and endFrame, to match profiler zones
+};
+
+// Per-phase CPU timers plus GL_TIME_ELAPSED queries around the draw section, and a
+// pair of timestamps around the MSAA resolve inside it (elapsed queries cannot nest).
+// Queries are read back a few frames later and only once available, so they never stall.
+// Every completed frame also lands in CPU and GPU histograms for percentile reporting,
+// and goes to onComplete if one is set.
+struct FrameStats {
+    static const int QUERY_RING = 4;
+
+    GLuint queries[QUERY_RING] = {};
+    GLuint resolveQueries[QUERY_RING][2] = {}; // GL_TIMESTAMP before and after the resolve
+    bool resolveQueued[QUERY_RING] = {};
+    bool pending[QUERY_RING] = {};
+    FrameRecord waiting[QUERY_RING] = {}; // frames whose GPU time is still in flight
+    FrameRecord current = {};
+    FrameRecord latest = {}; // most recent frame with all timings resolved
+    unsigned long long frame = 0;
+    std::chrono::steady_clock::time_point frameStart;
+    bool gpuQueued = false;
+    bool gpuActive = false; // inside beginGpu/endGpu
+    FILE *csv = nullptr;
+    FrameHistogram cpuHistogram, gpuHistogram; // cpuTotal and gpu of every completed frame
+    FrameHistogram resolveHistogram;
+    double budgetMs = 1000.0 / 60.0;
+    uint64_t cpuOverBudget = 0, gpuOverBudget = 0; // frames whose time exceeded budgetMs
+    SmallFunction<void(const FrameRecord &), 16> onComplete; // the hitch log's watchdog
+
+    // Create the query objects and optionally open a per-frame CSV dump; frames taking
+    // longer than budget milliseconds are counted as over budget
+    void setup(const char *csvPath, double budget = 1000.0 / 60.0) {
+        glGenQueries(QUERY_RING, queries);
+        glGenQueries(2 * QUERY_RING, &resolveQueries[0][0]);
+        budgetMs = budget;
+        latest.gpu = -1.0;
+        if (csvPath && *csvPath) {
+            csv = fopen(csvPath, "w");
+            if (csv) {
+                fprintf(csv, "frame");
+                for (int p = 0; p < PHASE_COUNT; p++) {
+                    fprintf(csv, ",%s_ms", FRAME_PHASE_NAMES[p]);
+                }
+                fprintf(csv, ",cpu_ms,gpu_ms,resolve_ms\n");
+            }
+        }
+    }
+
+    void beginFrame() {
+        current = {};
+        current.frame = frame;
+        current.gpu = -1.0;
+        current.resolve = -1.0;
+        gpuQueued = false;
+        frameStart = std::chrono::steady_clock::now();
+        current.start = profileTicks();
+    }
+
+    // Collect any GPU results that have landed since last frame. Part of beginGpu(),
+    // so beginFrame() makes no GL call: with a present thread the context is not
+    // current on this thread at the start of a frame.
+    void collectGpu() {
+        for (int i = 0; i < QUERY_RING; i++) {
+            if (!pending[i]) {
+                continue;
+            }
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &ns);
+                waiting[i].gpu = ns / 1.0e6;
+                if (resolveQueued[i]) {
+                    // Issued before the elapsed query ended, so already available
+                    GLuint64 before = 0, after = 0;
+                    glGetQueryObjectui64v(resolveQueries[i][0], GL_QUERY_RESULT, &before);
+                    glGetQueryObjectui64v(resolveQueries[i][1], GL_QUERY_RESULT, &after);
+                    waiting[i].resolve = (after - before) / 1.0e6;
+                    resolveQueued[i] = false;
+                }
+                pending[i] = false;
+                complete(waiting[i]);
+            }
+        }
+    }
+
+    void beginGpu() {
+        collectGpu();
+        int slot = (int)(frame % QUERY_RING);
+        if (pending[slot]) {
+            // Result still not back after QUERY_RING frames: give up on it rather than wait
+            pending[slot] = false;
+            complete(waiting[slot]);
+        }
+        resolveQueued[slot] = false;
+        glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+        gpuActive = true;
+    }
+
+    void endGpu() {
+        glEndQuery(GL_TIME_ELAPSED);
+        gpuQueued = true;
+        gpuActive = false;
+    }
+
+    // Timestamps around the MSAA resolve; ignored outside a timed draw section
+    void beginResolve() {
+        if (gpuActive) {
+            glQueryCounter(resolveQueries[frame % QUERY_RING][0], GL_TIMESTAMP);
+        }
+    }
+
+    void endResolve() {
+        if (gpuActive) {
+            glQueryCounter(resolveQueries[frame % QUERY_RING][1], GL_TIMESTAMP);
+            resolveQueued[frame % QUERY_RING] = true;
+        }
+    }
+
+    void endFrame() {
+        current.cpuTotal = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+        current.end = profileTicks();
+        if (gpuQueued) {
+            int slot = (int)(frame % QUERY_RING);
+            waiting[slot] = current;
+            pending[slot] = true;
+        } else {
+            complete(current);
+        }
+        frame++;
+    }
+
+    // A frame has all its timings; publish it
+    void complete(const FrameRecord &record) {
+        latest = record;
+        cpuHistogram.record(record.cpuTotal);
+        cpuOverBudget += record.cpuTotal > budgetMs;
+        if (record.gpu >= 0.0) {
+            gpuHistogram.record(record.gpu);
+            gpuOverBudget += record.gpu > budgetMs;
+        }
+        if (record.resolve >= 0.0) {
+            resolveHistogram.record(record.resolve);
+        }
+        if (csv) {
+            fprintf(csv, "%llu", record.frame);
+            for (int p = 0; p < PHASE_COUNT; p++) {
+                fprintf(csv, ",%.4f", record.cpu[p]);
+            }
+            fprintf(csv, ",%.4f,%.4f,%.4f\n", record.cpuTotal, record.gpu, record.resolve);
+        }
+        if (onComplete) {
+            onComplete(record);
+        }
+    }
+
+    // Print p50/p90/p99/p99.9/max and the over-budget count of CPU and GPU frame times
+    void printSummary() const {
+        printf("frame times over %llu frames, budget %.2f ms\n", (unsigned long long)cpuHistogram.count, budgetMs);
+        printf("       p50      p90      p99    p99.9      max  over budget\n");
+        printRow("cpu", cpuHistogram, cpuOverBudget);
+        printRow("gpu", gpuHistogram, gpuOverBudget);
+        if (resolveHistogram.count > 0) {
+            printRow("msaa", resolveHistogram, 0); // resolve share of the gpu time
+        }
+    }
+
+    static void printRow(const char *name, const FrameHistogram &h, uint64_t over) {
+        if (h.count == 0) {
+            printf("%s    not measured\n", name);
+            return;
+        }
+        printf("%s %8.3f %8.3f %8.3f %8.3f %8.3f  %llu\n", name, h.percentile(0.5), h.percentile(0.9),
+               h.percentile(0.99), h.percentile(0.999), h.maxMs, (unsigned long long)over);
+    }
+
+    void release() {
+        glDeleteQueries(QUERY_RING, queries);
+        glDeleteQueries(2 * QUERY_RING, &resolveQueries[0][0]);
+        if (csv) {
+            fclose(csv);
+            csv = nullptr;
+        }
+    }
+};
+
+// Adds the lifetime of the scope to one phase of the current frame
+struct ScopedPhaseTimer {
+    FrameStats &stats;
+    FramePhase phase;
+    std::chrono::steady_clock::time_point start;
+
+    ScopedPhaseTimer(FrameStats &s, FramePhase p)
+        : stats(s), phase(p), start(std::chrono::steady_clock::now()) {}
+
+    ~ScopedPhaseTimer() {
+        stats.current.cpu[phase] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+};
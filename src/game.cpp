@@ -1,241 +1,4165 @@
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <cstring>
+#include <functional>
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <stb_image.h>
+#include "allocation_guard.h"
+#include "alpha_mask.h"
+#include "archetype.h"
+#include "asset_pack.h"
+#include "asteroid_variants.h"
+#include "asset_manager.h"
+#include "audio_mixer.h"
+#include "bloom.h"
+#include "broadphase.h"
+#include "comet_field.h"
+#include "comet_impostors.h"
+#include "display_mode.h"
+#include "draw_list.h"
+#include "dynamic_resolution.h"
+#include "embedded_assets.h"
+#include "embedded_shaders.h"
+#include "entity_pool.h"
+#include "event_bus.h"
+#include "frame_arena.h"
+#include "frame_capture.h"
+#include "frame_latency.h"
+#include "frame_pacer.h"
+#include "frame_rate_controller.h"
+#include "frame_stats.h"
+#include "game_clock.h"
+#include "game_rules.h"
+#include "game_settings.h"
+#include "gamepad_input.h"
+#include "geometry_cache.h"
+#include "gl_call_stats.h"
+#include "gl_debug_log.h"
+#include "gl_extensions.h"
+#include "gl_loader.h"
+#include "gl_markers.h"
+#include "gl_name_pool.h"
+#include "gl_state.h"
+#include "gpu_calibration.h"
+#include "gpu_tier.h"
+#include "hang_detector.h"
+#include "hitch_log.h"
+#include "hud_text.h"
+#include "image_decoder.h"
+#include "input_queue.h"
+#include "input_script.h"
+#include "job_system.h"
+#include "lane_ring.h"
+#include "leaderboard_client.h"
+#include "level_file.h"
+#include "memory_stats.h"
+#include "metrics_server.h"
+#include "monte_carlo.h"
+#include "monte_carlo_cluster.h"
+#include "msaa_target.h"
+#include "net_session.h"
+#include "overdraw_view.h"
+#include "particle_system.h"
+#include "perf_budget.h"
+#include "perf_overlay.h"
+#include "power_policy.h"
+#include "present_thread.h"
+#include "profiler.h"
+#include "program_cache.h"
+#include "random.h"
+#include "render_backend.h"
+#include "render_graph.h"
+#include "replay_file.h"
+#include "sampler_cache.h"
+#include "sampling_profiler.h"
+#include "score_store.h"
+#include "shader_builder.h"
+#include "shader_variants.h"
+#include "shader_program.h"
+#include "simulation_lod.h"
+#include "sprite_batch.h"
+#include "sprite_kernel.h"
+#include "starfield.h"
+#include "state_hash.h"
+#include "telemetry.h"
+#include "thread_config.h"
+#include "texture_atlas.h"
+#include "texture_format.h"
+#include "texture_handles.h"
+#include "texture_loader.h"
+#include "texture_streamer.h"
+#include "trace_recorder.h"
+#include "transform_hierarchy.h"
+#include "triple_buffer.h"
+#include "ui_tree.h"
+#include "view_transform.h"
+#include "wave_script.h"
+#include "wave_stream.h"
 
 using namespace std;
 using namespace glm;
 
-// Window dimensions and lane width
-const GLuint WIDTH = 800, HEIGHT = 600;
-const float LANE_WIDTH = WIDTH / 3.0f;
+// Entities per job for the parallel motion pass
+const uint32_t MOTION_GRAIN = 8192;
 
-// Sprite structure for objects like spaceship and comet
-struct Sprite {
-    GLuint VAO;
+// Entities per job when recording the scene's draw list; a smaller field is recorded
+// on the render thread alone
+const uint32_t RECORD_GRAIN = 1024;
+
+// Comet tumbling speeds, degrees per second either way
+const float COMET_SPIN_MIN = 20.0f, COMET_SPIN_MAX = 90.0f;
+
+// Particle effects: pool size, trail particles per comet per second, and the game-over explosion
+const uint32_t MAX_PARTICLES = 16384;
+const float TRAIL_RATE = 60.0f, TRAIL_LIFETIME = 0.35f, TRAIL_SPEED = 30.0f;
+const float THRUSTER_RATE = 120.0f, THRUSTER_LIFETIME = 0.2f, THRUSTER_SPEED = 40.0f; // the ship's exhaust, per second
+const uint32_t EXPLOSION_PARTICLES = 2000;
+const float EXPLOSION_LIFETIME = 1.2f, EXPLOSION_SPEED = 220.0f;
+
+// Wreckage of the ship: pieces cut from its sprite, flung out with the explosion
+const uint32_t DEBRIS_PARTICLES = 8000;
+const float DEBRIS_SPEED = 160.0f;
+
+// Longest frame the simulation will catch up on; longer stalls are dropped
+const double MAX_FRAME_TIME = 0.25;
+
+// Wall time the inline simulation spends ticking per frame in max-speed mode
+const double MAX_SPEED_SLICE = 1.0 / 30.0;
+
+// Longest the idle loop sleeps between checks, with and without window focus
+const double IDLE_WAIT = 0.1, UNFOCUSED_WAIT = 0.5;
+
+// Shortest interval between loading-screen frames while shaders and the atlas load
+const double LOADING_FRAME_INTERVAL = 1.0 / 60.0;
+
+// Networked races: ticks of rival state kept to roll back into, comet hashes kept
+// to check the rival's against, and seconds to wait for it to connect and to load
+const uint64_t RIVAL_HISTORY = 512;
+const uint64_t WORLD_HASH_HISTORY = 16;
+const double CONNECT_TIMEOUT = 60.0, READY_TIMEOUT = 30.0;
+
+// Stress benchmark: comets at the first step, growth per step while the budget holds,
+// frames per step (the first ones settling, untimed) and halvings of the last bracket
+const uint32_t STRESS_START = 1000;
+const double STRESS_GROWTH = 1.25;
+const int STRESS_STEP_FRAMES = 120, STRESS_SETTLE_FRAMES = 30, STRESS_REFINE_STEPS = 3;
+
+// Upload benchmark: frames timed per strategy and sprite count, after as many settling
+// ones, and how many times the median submit counts as a stall
+const int UPLOAD_BENCH_FRAMES = 300, UPLOAD_BENCH_SETTLE = 60;
+const double UPLOAD_BENCH_SPIKE = 4.0;
+
+// Runtime options taken from the command line
+struct GameOptions {
+    float simRate = 120.0f; // fixed simulation ticks per second (--sim-rate=N)
+    PacingMode pacing = PacingMode::Vsync; // --pacing=vsync|adaptive|capped|vrr|uncapped
+    double fpsCap = 60.0; // target frame rate in capped mode (--fps-cap=N)
+    double vrrMin = 0.0, vrrMax = 0.0; // the display's variable refresh range; the top defaults to its refresh (--vrr-range=MIN-MAX)
+    WindowMode windowMode = WindowMode::Windowed; // --window=windowed|borderless|fullscreen; F11 toggles in game
+    int refreshRate = 0; // Hz asked of exclusive fullscreen, 0 = the monitor's current (--refresh=N)
+    int monitor = 0; // index of the monitor to go fullscreen on; 0 is the primary (--monitor=N)
+    bool adaptiveRate = true; // present at the highest refresh divisor the frame times sustain (--adaptive-rate=0|1)
+    bool powerSaving = true; // cap the frame rate and render scale while on battery (--power-saving=0|1)
+    double batteryFps = 30.0; // frame rate cap on battery (--battery-fps=N)
+    float batteryResScale = 0.75f; // highest render scale on battery, with dynamic resolution (--battery-res-scale=X)
+    int framesInFlight = 2; // frames queued ahead of the GPU before the CPU waits, 0 = driver default (--frames-in-flight=N|finish)
+    bool lateLatch = true; // re-read input just before the sprites are submitted (--late-latch=0|1)
+    double frameBudget = 1000.0 / 60.0; // frame-time budget in ms for the exit report (--frame-budget=MS)
+    string frameCsv; // per-frame timing dump (--frame-csv=path)
+    string hitchLog; // log frames over budget with their phases, zones and driver warnings (--hitch-log=path)
+    double hitchThreshold = 4.0; // ms over the frame budget a frame must run to be logged (--hitch-threshold=MS)
+#ifdef SPACE_TRAVEL_BENCH
+    bool bench = true; // the space-travel-bench build always benchmarks
+#else
+    bool bench = false; // run the headless benchmark instead of the game (--bench)
+#endif
+    int benchFrames = 10000; // frames rendered by the benchmark (--frames=N)
+    bool simulationLod = true; // move --stress comets that cannot reach the ship or leave the field within a few ticks once every SimulationLod::PERIOD ticks, placing them in closed form in between (--sim-lod=0|1)
+    uint32_t stress = 0; // benchmark ramping free-falling comets up to this many until the frame budget is exceeded, reporting the most it sustained (--stress=N)
+    double pgoTrain = 0.0; // autopilot this many simulated seconds through the benchmark's offscreen loop, then exit: the training run of a profile-guided build (--pgo-train=SECONDS)
+    string inputScript; // benchmark replays these key presses instead of its built-in pattern (--input-script=path)
+    string budgets; // benchmark fails if its frame times exceed these limits (--budgets=path)
+    string recordInput; // save the session's key presses as an input script (--record-input=path)
+    string record; // save a binary replay of the session: seed, rate, ticks and presses (--record=path)
+    string replay; // play a recorded session back instead of reading input (--replay=path)
+    double seek = 0.0; // start the replay this many simulated seconds in, from the keyframe before it plus a headless catch-up (--seek=S)
+    bool replayFast = false; // replay offscreen as fast as possible rather than in real time (--replay-fast)
+    double keyframeInterval = 10.0; // simulated seconds between keyframes of the whole simulation in --record's replay, to seek by; 0 records none (--keyframe-interval=S)
+    bool stateHash = false; // hash the simulation state every tick, into --record's replay (--state-hash); replays carrying hashes are always checked
+    string level; // spawn the waves of this level file, then random ones once it runs out (--level=path)
+    string waveScript; // also run this built-in spawn script, or "list" to name them (--wave-script=NAME)
+    string exportLevel; // write ten minutes of the seed's random waves as a level file and exit (--export-level=path)
+    uint32_t monteCarlo = 0; // play this many headless bot runs on every core and report instead of the game (--monte-carlo=RUNS)
+    uint32_t monteCarloTicks = 0; // longest headless run in ticks, 0 = ten simulated minutes (--mc-ticks=N)
+    int monteCarloServe = 0; // coordinate the --monte-carlo batch across workers connecting to this TCP port instead of playing it here (--mc-serve=PORT)
+    string monteCarloWorker; // play shards of that coordinator's batch on every core, then exit (--mc-worker=HOST:PORT)
+    BotSkill bot; // the headless bot's reaction time, lookahead and mistake rate (--bot-reaction=S, --bot-lookahead=PX, --bot-mistakes=P)
+    int threads = -1; // simulation worker threads, -1 = one per spare core (--threads=N)
+    string affinity = "auto"; // thread placement by role: auto gives render, audio and simulation a core each on four or more cores, 0 leaves threads to the OS, or role:cores pairs over auto (--affinity=auto|0|render:0,worker:3-7)
+    bool threadPriority = true; // raise render, simulation and audio priority (MMCSS tasks on Windows) and lower I/O threads' (--thread-priority=0|1)
+    bool simThread = true; // simulate on a dedicated thread (--sim-thread=0|1)
+    bool presentThread = false; // swap buffers on a dedicated thread while the next frame's input and simulation run (--present-thread=0|1)
+    int metricsPort = 0; // serve frame times, hitches, memory and entity counts to Prometheus on this port, 0 = off (--metrics-port=N)
+    bool warmUp = true; // draw every program and state combination once behind the loading screen, so none compiles mid-game (--warm-up=0|1)
+    double timeScale = 1.0; // simulated seconds per wall-clock second; < 1 is slow motion (--time-scale=X)
+    bool maxSpeed = false; // tick as fast as the CPU allows instead of in real time (--max-speed)
+    bool render = true; // draw frames; 0 measures the simulation alone (--render=0|1)
+    bool dynamicRes = true; // scale the game's render resolution to hold the GPU budget (--dynamic-res=0|1)
+    float minResScale = 0.5f; // lowest resolution scale dynamic resolution may pick (--min-res-scale=X)
+    int msaa = 0; // samples per pixel of the multisampled scene target, 0 = off (--msaa=N)
+    bool overdraw = false; // debug view colouring each pixel by how often the scene draws it, with the average and maximum in the overlay; turns MSAA and bloom off (--overdraw)
+    int bloom = -1; // glow around bright sprites: 0 off, 1 on with both levels, -1 by GPU tier in the game only (--bloom=auto|0|1)
+    string calibrationFile = GpuCalibration::FILE_NAME; // GPU tier measured on the first run and whenever the driver changes; empty guesses it from the GPU's name (--calibration=PATH)
+    bool recalibrate = false; // measure the GPU tier again even though the calibration file matches the driver (--recalibrate)
+    bool gpuMotion = false; // evaluate comet motion in the vertex shader (--gpu-motion)
+    bool gpuCull = false; // cull and compact those comets on the GPU too; implies --gpu-motion (--gpu-cull)
+    bool largePages = false; // back the entity arrays with large pages where the OS grants them (--large-pages=0|1)
+    bool impostors = true; // draw dense fields of far comets as one low-resolution impostor (--impostors=0|1)
+    bool hud = true; // score, time survived and best score on screen (--hud=0|1)
+    bool hudSdf = true; // draw the HUD and screens from a distance-field font, sharp at any window size; 0 uses the bitmap (--hud-sdf=0|1)
+    bool ui = true; // pause and game-over screens with the leaderboard (--ui=0|1)
+    bool overlay = false; // start with the performance overlay shown (--overlay); F3 toggles it
+    string textureDir; // load textures from this directory instead of the embedded atlas (--textures=DIR)
+    string pack; // asset pack to map at startup instead of assets.pak in the texture directory (--pack=PATH)
+    ImageDecoderKind imageDecoder = IMAGE_DECODER_FAST; // PNG decoder for loose and packed images (--image-decoder=fast|stb)
+    string profile; // write the zone profile here at exit (--profile=path); F9 writes it at any time
+    string startupTrace; // Chrome trace of startup up to the first swap (--startup-trace=path)
+    bool proceduralComets = false; // comets from asteroid variants baked on the GPU, not the atlas image (--procedural-comets)
+    string cometVariants; // comets from every PNG in this directory, a texture-array layer each (--comet-variants=DIR)
+    bool exitAfterFirstFrame = false; // quit once the first frame is presented, for bench_startup (--exit-after-first-frame)
+    string captureDir = "captures"; // where F12 screenshots and F10 recordings are written (--capture-dir=DIR)
+    bool recordFrames = false; // record every frame from the first one, as with F10 (--record-frames)
+    string video; // stream every frame into an encoder writing this file (--video=path.mp4)
+    string encoder = "ffmpeg"; // encoder executable fed raw frames on stdin (--encoder=path)
+    double videoFps = 60.0; // frame rate the video is encoded at (--video-fps=N)
+    bool glErrors = false; // GL call trace builds: check glGetError after every call (--gl-errors)
+    bool glCore = true; // request a 4.x core profile; 0 keeps the driver's default, compatibility, context (--gl-core=0|1)
+#ifdef NDEBUG
+    bool glNoError = true; // release builds skip driver validation with a KHR_no_error context (--gl-no-error=0|1)
+#else
+    bool glNoError = false; // debug builds keep GL errors defined (--gl-no-error=0|1)
+#endif
+    bool glDebug = false; // debug context printing KHR_debug messages; no no-error context then (--gl-debug)
+    bool glPerfLog = false; // collect the driver's KHR_debug performance warnings into the profile and overlay (--gl-perf-log); on with --gl-debug
+    bool glNamePool = true; // reserve buffer, vertex array and texture names in blocks and batch their deletes (--gl-name-pool=0|1)
+    bool glMarkers = false; // KHR_debug groups around passes and batches, and labels on GL objects, for RenderDoc and Nsight captures (--gl-markers)
+    bool dsa = true; // create and edit GL objects by name where ARB_direct_state_access allows; 0 forces bind-to-edit (--dsa=0|1)
+    bool indirect = true; // stream the sprite runs as indirect commands, multi-drawn where supported (--indirect=0|1)
+    UploadStrategy uploadStrategy = UPLOAD_AUTO; // how sprite instances reach the GPU: persistent mapping if available, else unsynchronized maps (--upload-strategy=auto|persistent|unsynchronized|orphan|subdata)
+    vector<uint32_t> uploadBench; // benchmark every upload strategy streaming these sprite counts, reporting CPU and GPU time and stalls (--upload-bench=N[,N...])
+    bool packedInstances = false; // stream sprite instances as half floats and 16-bit texture rects, under half the bytes, at up to a quarter pixel of placement error (--packed-instances=0|1)
+    bool uploadContext = true; // create and upload textures on the loader thread's own shared context (--upload-context=0|1)
+    bool lowTextureMemory = false; // store uncompressed textures as RGB565/RGBA4 instead of RGBA8 (--texture-memory=full|low)
+    int64_t textureBudget = 0; // stream the baked atlas's mips within this many bytes of VRAM; 0 uploads it whole (--texture-budget=MB)
+    bool vertexId = true; // sprite quads from gl_VertexID instead of a vertex buffer (--vertex-id=0|1)
+    bool splitScreen = false; // two views of the playfield side by side, each with its own projection (--split-screen=0|1)
+    bool spriteOutlines = true; // draw sprites over tight convex outlines instead of whole quads; needs the vertex buffer, so wins over --vertex-id (--sprite-outlines=0|1)
+    bool cutout = true; // draw soft-edged sprites' opaque interiors unblended with depth writes, and blend only their edges (--cutout=0|1)
+    bool bindless = true; // draw sprites of different textures together through ARB_bindless_texture handles (--bindless=0|1)
+    string shaderCache = "shader_cache"; // linked program binaries; empty disables the cache (--shader-cache=DIR)
+    string scoreFile = "scores.dat"; // memory-mapped leaderboard and play totals; empty disables it (--scores=PATH)
+    string settingsFile; // per-cabinet tuning read once at startup; empty reads settings.ini when there is one (--settings=PATH)
+    string leaderboard; // online leaderboard server the runs are also sent to; empty keeps them local (--leaderboard=HOST:PORT)
+    string telemetryDir; // binary session telemetry written under this directory; empty disables it (--telemetry=DIR)
+    double hangTimeout = 0.0; // dump every thread's stack, the profiler zones and the game state when the main loop stalls this long; 0 = off (--hang-timeout=SECONDS)
+    bool hangRestart = false; // start the game again after a hang dump (--hang-restart=0|1)
+    string sampleProfile; // sample the --sample-threads' stacks through the run and write them here, folded for flame graphs; empty = off (--sample-profile=PATH)
+    double sampleRate = 1000.0; // stack samples per second and thread (--sample-rate=HZ)
+    string sampleThreads = "render,simulation"; // the threads sampled, by name (--sample-threads=NAME,NAME)
+    uint64_t seed = 0; // spawn sequence seed; 0 picks one from the clock (--seed=N)
+    int hostPort = 0; // host a two-player race on this UDP port (--host=PORT)
+    string connect; // join the race hosted there (--connect=HOST:PORT)
+    bool audio = true; // play sound effects through the mixer thread (--audio=0|1)
+    float volume = 0.8f; // master volume from 0 to 1 (--volume=X)
+#ifdef NDEBUG
+    bool hotReload = false; // rebuild the atlas when a texture changes on disk (--hot-reload=0|1)
+#else
+    bool hotReload = true; // dev builds watch textures/ by default
+#endif
+#ifdef NDEBUG
+    AllocationGuardMode allocGuard = AllocationGuardMode::Off; // catch heap allocations in frames after warm-up (--alloc-guard=off|report|abort)
+#else
+    AllocationGuardMode allocGuard = AllocationGuardMode::Report; // dev builds report them by default
+#endif
+    int allocWarmup = 120; // frames before the allocation guard arms (--alloc-warmup=N)
+};
+
+// Scene layers, back to front; each is drawn at its own depth (layerDepth)
+enum DrawLayer : uint8_t {
+    LAYER_BACKGROUND,
+    LAYER_COMETS,
+    LAYER_SHIP,
+    LAYER_OVERLAY,
+    LAYER_COUNT
+};
+
+// Render resources shared by every entity drawn with them
+struct Material {
+    const Mesh *mesh;
     GLuint texID;
-    vec3 position;
-    vec3 dimensions;
-    float angle;
-
-    // Initialize sprite with texture, position, and size
-    void setupSprite(GLuint textureID, vec3 pos, vec3 dim) {
-        this->texID = textureID;
-        this->dimensions = dim;
-        this->position = pos;
-
-        // Define vertex data (position and texture coordinates)
-        GLfloat vertices[] = {
-            -0.5, -0.5, 0.0, 0.0, 0.0, // V0
-            -0.5,  0.5, 0.0, 0.0, 1.0, // V1
-             0.5, -0.5, 0.0, 1.0, 0.0, // V2
-             0.5,  0.5, 0.0, 1.0, 1.0  // V3
-        };
-
-        GLuint VBO;
-        glGenBuffers(1, &VBO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
-
-        glGenVertexArrays(1, &VAO);
-        glBindVertexArray(VAO);
-
-        // Setup position attribute
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-        glEnableVertexAttribArray(0);
-
-        // Setup texture coordinate attribute
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        glEnableVertexAttribArray(1);
-
-        // Unbind buffers
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        glBindVertexArray(0);
+    vec4 texRect; // region of the texture to sample: xy = offset, zw = scale
+    GLuint sampler = 0; // filtering and wrapping applied when texID is sampled
+    uint8_t shaderKey = 0;   // DrawList ids of the program and texture
+    uint8_t edgeShaderKey = 0; // program of a cutout's blended edge pass
+    uint16_t textureKey = 0;
+    Flipbook flipbook{}; // frames of texRect, played by the vertex shader
+    DrawLayer layer = LAYER_COMETS;
+    bool opaque = false; // texels are fully opaque or fully clear: drawn front to back, unblended, clear texels discarded
+    bool cutout = false; // soft edges around an opaque interior: the interior is drawn as if opaque, then the edge blended over what it did not cover
+    bool rotates = false; // entities may have an angle or spin: the ROTATION variant, which the others skip
+    bool layered = false; // texID is AsteroidVariants' texture array; each entity shows the layer its handle picks
+
+    GLenum target() const {
+        return layered ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    }
+};
+
+// The part of a material that recording a sprite reads, packed apart from the GL
+// names and mesh that only setup and the batch's bindings touch: the sort key above
+// the entity index, and an instance with everything but the entity's own placement,
+// rotation, array layer and flipbook start already in place. refreshSpriteTemplates()
+// rebuilds them whenever a material changes.
+struct SpriteTemplate {
+    uint64_t keyBase;
+    uint64_t edgeKeyBase; // the blended edge pass's, for cutouts; 0 for none
+    SpriteInstance instance;
+    Flipbook flipbook;
+    bool layered;
+};
+
+// Systems an entity takes part in, as EntityPool component bits
+enum Component : uint32_t {
+    COMPONENT_MOTION = 1u << 0,   // moved along vy every tick
+    COMPONENT_COLLIDER = 1u << 1, // ends the game when it touches the ship
+    COMPONENT_LIFETIME = 1u << 2  // despawned once it has fallen past settings.despawnY
+};
+
+// Kinds of entity, in pool storage order, with the components each one has; a new
+// kind is one more entry here and its entities never enter other kinds' loops
+enum Archetype : uint8_t {
+    ARCHETYPE_SHIP,
+    ARCHETYPE_COMET,
+    ARCHETYPE_RIVAL,
+    ARCHETYPE_STRESS,
+    ARCHETYPE_DORMANT, // right after the stress comets, so the two are one range
+    ARCHETYPE_COUNT
+};
+
+// The components as archetype.h tags: the pool's bits, then traits only the renderer
+// specializes on
+struct Motion { static constexpr uint32_t BIT = COMPONENT_MOTION; };
+struct Collider { static constexpr uint32_t BIT = COMPONENT_COLLIDER; };
+struct Lifetime { static constexpr uint32_t BIT = COMPONENT_LIFETIME; };
+struct Rotates { static constexpr uint32_t BIT = 0; };  // drawn at its angle, turning at its spin
+struct Animated { static constexpr uint32_t BIT = 0; }; // plays its material's flipbook from a start staggered by handle
+struct Falling { static constexpr uint32_t BIT = 0; };  // a comet: drawn by the comet field with --gpu-motion, else may join the impostor
+struct Latched { static constexpr uint32_t BIT = 0; };  // the ship: recorded even offscreen, as latchShip moves it
+
+using ShipArchetype = ArchetypeDef<ARCHETYPE_SHIP, Latched>; // moved by its lane transition
+using CometArchetype = ArchetypeDef<ARCHETYPE_COMET, Motion, Collider, Lifetime, Falling, Rotates, Animated>;
+using RivalArchetype = ArchetypeDef<ARCHETYPE_RIVAL>; // placed from its presses; collides on its own cabinet
+using StressArchetype = ArchetypeDef<ARCHETYPE_STRESS, Motion, Falling, Rotates, Animated>; // --stress comets: in the broadphase grid, but never hit the ship; updateStress recycles them
+using DormantArchetype = ArchetypeDef<ARCHETYPE_DORMANT, Falling, Rotates, Animated>; // --stress comets asleep under the simulation LOD, moved on anchor ticks only
+using Archetypes = ArchetypeList<ShipArchetype, CometArchetype, RivalArchetype, StressArchetype, DormantArchetype>;
+static_assert(Archetypes::COUNT == ARCHETYPE_COUNT, "every archetype needs a definition");
+const vector<uint32_t> ARCHETYPE_COMPONENTS = Archetypes::masks();
+
+// Indices into the material table, stored per entity in EntityPool::material
+enum MaterialId : uint8_t {
+    MATERIAL_SPACESHIP,
+    MATERIAL_COMET,
+    MATERIAL_RIVAL,
+    MATERIAL_COUNT
+};
+
+// Particle kinds understood by the particle shaders (Particle::life.z)
+enum ParticleKind {
+    PARTICLE_TRAIL,
+    PARTICLE_EXPLOSION,
+    PARTICLE_DEBRIS
+};
+
+// The other player's ship in a networked race: everything its presses decide.
+// The rival's comets are ours, so this is all that is ever rolled back.
+struct RivalShip {
+    int lane = LANES.MIDDLE;
+    float x = LANES.center(LANES.MIDDLE);
+    LaneTransition transition;
+};
+
+// Every spawn of a session in time order, for the wave stream's worker: the
+// level's spawns, then seeded random waves every settings.waveInterval. The worker is
+// the only user of the level cursor and spawnRandom once the stream has started.
+struct WaveSource {
+    double waveTime = 0.0; // when the next random wave is released
+    int lanes[2] = {0, 0};
+    CometType types[2] = {COMET_NORMAL, COMET_NORMAL};
+    int count = 0, next = 0; // lanes of the current wave, and the next one to hand out
+
+    bool operator()(WaveSpawn &spawn);
+};
+
+// Immutable copy of what the renderer needs from one simulation tick
+struct RenderSnapshot {
+    vector<float> x, y, prevX, prevY, width, height, angle, spin;
+    vector<uint8_t> material;
+    vector<EntityHandle> handle; // stable per entity, e.g. to stagger flipbooks
+    uint64_t tickTime = 0; // gameClock reading when the tick finished
+    uint32_t ship = 0; // index of the spaceship
+    int shipLane = 0;  // lane the ship is in or moving to
+    double simTime = 0.0, prevSimTime = 0.0; // simulated seconds at this tick and the one before
+    unsigned long long tick = 0;
+    uint32_t archetypeStart[ARCHETYPE_COUNT + 1] = {}; // the pool's, so each archetype is recorded by its own loop
+
+    size_t size() const {
+        return x.size();
+    }
+
+    SpriteSoA sprites() const {
+        return {x.data(), y.data(), prevX.data(), prevY.data(), width.data(), height.data(), angle.data(), spin.data()};
+    }
+
+    // Copy the render fields of every entity; no allocation once capacity is reached
+    void capture(const EntityPool &pool, uint32_t shipIndex, uint64_t time, unsigned long long tickIndex, double simulated,
+                 double prevSimulated) {
+        x.assign(pool.x.begin(), pool.x.end());
+        y.assign(pool.y.begin(), pool.y.end());
+        prevX.assign(pool.prevX.begin(), pool.prevX.end());
+        prevY.assign(pool.prevY.begin(), pool.prevY.end());
+        width.assign(pool.width.begin(), pool.width.end());
+        height.assign(pool.height.begin(), pool.height.end());
+        angle.assign(pool.angle.begin(), pool.angle.end());
+        spin.assign(pool.spin.begin(), pool.spin.end());
+        material.assign(pool.material.begin(), pool.material.end());
+        handle.assign(pool.handleOf.begin(), pool.handleOf.end());
+        std::copy(pool.archetypeStart.begin(), pool.archetypeStart.end(), archetypeStart);
+
+        // Sleepers are stored as of their anchor tick: place them in closed form
+        float step = (float)(simulated - prevSimulated), slept = SimulationLod::sinceAnchor(tickIndex) * step;
+        for (uint32_t i = pool.archetypeStart[ARCHETYPE_DORMANT]; i < pool.size(); i++) {
+            y[i] = pool.y[i] + pool.vy[i] * slept;
+            prevY[i] = y[i] - pool.vy[i] * step;
+        }
+        ship = shipIndex;
+        shipLane = pool.lane[shipIndex];
+        tickTime = time;
+        tick = tickIndex;
+        simTime = simulated;
+        prevSimTime = prevSimulated;
     }
 };
 
-// Shader source code
-const GLchar *vertexShaderSource = "#version 400\n"
-    "layout (location = 0) in vec3 position;\n"
-    "layout (location = 1) in vec2 texc;\n"
-    "uniform mat4 projection;\n"
-    "uniform mat4 model;\n"
-    "out vec2 texCoord;\n"
-    "void main() { gl_Position = projection * model * vec4(position, 1.0); texCoord = vec2(texc.s, 1.0 - texc.t); }\0";
-
-const GLchar *fragmentShaderSource = "#version 400\n"
-    "in vec2 texCoord;\n"
-    "uniform sampler2D texBuffer;\n"
-    "uniform vec2 offsetTex;\n"
-    "out vec4 color;\n"
-    "void main() { color = texture(texBuffer, texCoord + offsetTex); }\n\0";
-
-// Global variables for spaceship, comet, and game state
-Sprite spaceship, comet;
-bool gameOver = false;
-int spaceshipLane = 1; // 0 = left, 1 = middle, 2 = right
+// Global variables for render resources, entities, and game state
+GeometryCache geometryCache;
+TextureAtlas atlas;
+string textureDir = "../textures"; // PNG sources and baked atlas on disk
+TextureLoader textureLoader;
+AssetManager assets;
+ProgramCache programCache; // skips shader compilation when the driver accepts a cached binary
+ShaderBuilder shaderBuilder;
+string profilePath = "profile.json"; // where F9 writes the zone profile
+InputScript recordedInput; // key presses of this session, with --record-input
+bool recordingInput = false;
+ReplayFile replay;           // session being played back, with --replay
+bool replaying = false;
+size_t replayCursor = 0;     // next replay event to apply
+bool hashingState = false;   // with --state-hash, or replaying a recording that has hashes
+bool recordingHashes = false; // --state-hash with --record
+vector<uint32_t> stateHashes; // after every tick, for --record
+ReplayFile recording;        // keyframes of --record's replay, added as the session runs
+uint64_t keyframeTicks = 0;  // ticks between them; 0 records none
+vector<uint8_t> keyframeScratch; // one keyframe being captured
+uint64_t spawnsTaken = 0;    // spawns released from the wave stream so far
+uint64_t desyncTick = UINT64_MAX; // first tick whose hash differs from the replay's
+SamplerCache samplers;
+TextureAtlas pendingAtlas; // packed by the loader thread when there is no current bake
+int atlasLoad = -1;        // loader handle of pendingAtlas while it is in flight
+TextureStreamer textureStreamer; // VRAM-budgeted textures, with --texture-budget
+int atlasStream = -1;      // the baked atlas' streamer handle while it is streamed
+bool atlasStale = false;   // an image changed while the atlas was being packed
+bool atlasFromPack = false; // the atlas' PNGs come from the asset pack, not textureDir
+Material materials[MATERIAL_COUNT];
+SpriteTemplate spriteTemplates[MATERIAL_COUNT]; // from materials, by refreshSpriteTemplates()
+AlphaMask collisionMasks[MATERIAL_COUNT]; // opaque pixels of each material's sprite at its entities' size
+SpriteOutline outlines[MATERIAL_COUNT];   // each material's sprite outline, empty where it keeps the quad
+bool spriteOutlines = false;              // from --sprite-outlines
+EntityPool entities;
+EntityHandle spaceship;
+GameSettings settings; // tuning from the settings file, fixed once main has read it
+LaneTransition shipTransition;
+NetSession net; // with --host or --connect
+LeaderboardClient leaderboard; // with --leaderboard; its I/O thread never holds up a frame
+EntityHandle rival;
+RivalShip rivalShip;                       // predicted from the presses that have arrived
+RivalShip rivalHistory[RIVAL_HISTORY];     // rival before each tick, by tick % RIVAL_HISTORY
+uint32_t worldHashes[WORLD_HASH_HISTORY];  // comet state every HASH_INTERVAL ticks
+uint64_t rivalHashChecked = 0;             // tick of the last rival hash compared
+bool rivalGone = false;                    // crashed or disconnected; no longer moved
+WaveStream waves; // comets to release, generated ahead on a worker
+Pcg32 spawnRandom; // seeded in main; the same seed replays the same waves
+WaveTables waveTables; // settings.waves as alias tables, built once main has read them
+LevelFile level;   // designed waves, with --level
+WaveScheduler waveScripts; // scripted spawn patterns, with --wave-script
+Broadphase broadphase; // free movers only; lane-bound comets are in cometLanes
+vector<uint32_t> collisionCandidates;
+
+// The comets of one lane, lowest first. Waves and levels can give comets of a lane
+// different speeds; a faster one may then overtake, so a lane that has seen two
+// speeds since it was last empty is reordered after motion.
+struct CometLane {
+    LaneRing<EntityHandle, MAX_COMETS> ring;
+    float speed = 0.0f;
+    bool mixed = false;
+};
+CometLane cometLanes[LANE_COUNT];
+uint32_t cometCapacity = MAX_COMETS; // comets the pool, draw lists and batches are sized for; --stress adds its own
+Pcg32 stressRandom;       // lanes, heights and speeds of --stress comets
+uint32_t stressTarget = 0; // --stress comets updateStress keeps falling
+SimulationLod simulationLod; // puts --stress comets far from the ship to sleep
+vector<EntityHandle> lodChanges; // scratch: stress comets falling asleep or waking this anchor tick
+vector<uint32_t> expiredComets; // scratch: dense indices despawned this tick
+EntityPool initialEntities; // the pool as a run starts; a restart copies it back over entities
+JobSystem jobs;
+DrawList drawList;
+SpriteBatch spriteBatch;
+PerfOverlay overlay;
+Hud hud; // score and time, unless --hud=0; not in the benchmark
+SdfFont sdfFont; // the HUD's font, unless --hud-sdf=0
+UiTree ui; // pause and game-over screens, unless --ui=0; not in the benchmark
+struct {
+    int pause = -1, gameOver = -1, score = -1, online = -1, restart = -1;
+    int leaders[5] = {-1, -1, -1, -1, -1};
+} screens; // nodes of ui
+CometField cometField; // only set up with --gpu-motion
+CometImpostors impostors; // dense far comet fields at low resolution, unless --impostors=0
+AsteroidVariants asteroids; // the comets' sprites, with --procedural-comets or --comet-variants
+ParticleSystem particles;
+ShaderProgram cometShader, particleShader, starfieldShader;
+Pipeline cometPipeline; // translucent like the batched comets: depth-tested, blended, no depth writes
+ShaderVariants spriteShaders; // every ShaderFeature combination, built at startup
+uint64_t framesRendered = 0; // renderScene calls, for the View block's frame index
+Starfield starfield;
+ViewTransform view;
+DynamicResolution dynamicRes; // the game only; the benchmark always renders at full size
+MsaaTarget msaa;
+OverdrawView overdraw; // in place of msaa and bloom when on
+Bloom bloom; // between the scene and its target, resolved MSAA included
+RenderGraph renderGraph; // the resolve, bloom and upscale passes from the scene's buffer to its target, declared every frame
+FrameCapture capture; // screenshots and recordings, read back without stalling
+GLuint sceneFramebuffer = 0; // where the scene ends up without dynamic resolution: the window, or the benchmark's target
+atomic<bool> viewStale(false); // the framebuffer was resized since the view was fitted
+DisplayMode display; // windowed, borderless or exclusive fullscreen
+bool displayChanged = false; // F11 switched the display mode; the pacing follows the new refresh
+float trailBudget = 0.0f; // trail particles owed to each comet
+uint32_t trailCursor = 0; // first comet to get a trail burst next frame
+TransformHierarchy attachments; // what the ship carries, placed relative to it
+uint32_t shipNode = TransformHierarchy::INVALID, thrusterNode = TransformHierarchy::INVALID;
+float thrusterBudget = 0.0f; // exhaust particles owed
+FrameStats frameStats;
+HitchLog hitchLog;
+MetricsServer metrics;
+uint64_t hitchFrames = 0; // frames over twice the budget, for the metrics
+HangDetector hangDetector;
+SamplingProfiler samplingProfiler;
+FrameLatencyLimiter frameLatency;
+bool lateLatch = false; // set from --late-latch for the interactive game
+bool shipWrecked = false; // the ship burst into debris at game over and is no longer drawn
+AudioMixer audio;
+uint16_t laneSound = 0, explosionSound = 0; // clips synthesized by loadSounds()
+double timeScale = 1.0; // from --time-scale; read by the simulation thread
+bool maxSpeed = false;  // from --max-speed
+TripleBuffer<RenderSnapshot> snapshots; // simulation -> render
+unsigned long long simTick = 0;
+double simTime = 0.0, prevSimTime = 0.0; // simulated seconds
+InputQueue inputQueue; // key presses, consumed by the tick they fall on
+GamepadInput gamepads; // stick and d-pad edges, pushed into inputQueue
+EventBus events; // gameplay events, simulation to render thread
+atomic<bool> gameOver(false);
+atomic<bool> paused(false);  // P, or losing focus; the simulation holds still
+atomic<bool> windowHidden(false); // minimized or zero-sized: nothing is drawn or simulated
+bool windowFocused = true;
+bool redrawRequested = true; // something changed that an idle window has to show
+bool restartRequested = false; // R or Enter on the game-over screen
+double loadingFrameTime = -1.0; // glfwGetTime() of the last loading-screen swap, -1 before the first
 
 // Function prototypes
+GameOptions parseOptions(int argc, char **argv);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode);
-int setupShader();
-int loadTexture(const string &filePath);
-void drawSprite(Sprite spr, GLuint shaderID);
+void focus_callback(GLFWwindow *window, int focused);
+void refresh_callback(GLFWwindow *window);
+void iconify_callback(GLFWwindow *window, int iconified);
+void framebuffer_size_callback(GLFWwindow *window, int width, int height);
+void setPaused(GLFWwindow *window, bool pause);
+void resizeView(GLFWwindow *window);
+ShaderProgram linkedShader(int build);
+uint32_t spriteBaseFeatures();
+uint32_t materialFeatures(const Material &mat);
+template <typename Archetype>
+void drawSprite(const RenderSnapshot &snap, uint32_t i, const aligned_vec4 &placement, DrawList::Command &command, SpriteInstance &instance);
+float entityLayer(bool layered, EntityHandle handle);
+void refreshSpriteTemplates();
+uint32_t recordScene(const RenderSnapshot &snap, float alpha, uint32_t &culled);
+float layerDepth(DrawLayer layer);
+void latchShip(const RenderSnapshot &snap, SpriteInstance &ship);
 void moveSpaceship(int lane);
-void resetComet();
+void advanceSpaceship(float deltaTime);
+void spawnComet(int lane, float speed = settings.cometSpeed);
+bool exportLevel(const string &path, Pcg32 random);
+bool startWaveScript(const string &name);
+void despawnComet(uint32_t i);
 void updateGame(float deltaTime);
+void runGame(GLFWwindow *window, const GameOptions &options);
+void tickSimulation(float deltaTime, uint64_t inputUntil);
+uint64_t stateHash();
+void checkStateHash(uint64_t tick);
+void captureKeyframe();
+bool restoreKeyframe(const ReplayKeyframe &keyframe);
+void seekReplay(double seconds, float simRate);
+int laneAfter(int lane, int key);
+int autopilotLane(HeadlessGame &pilot, const BotSkill &skill, float deltaTime);
+void tickRival(float deltaTime);
+void stepRival(RivalShip &ship, uint64_t tick, float deltaTime);
+void syncRace();
+uint32_t worldHash();
+uint32_t shipHash(uint32_t world, int lane, float x);
+void reportRace();
+void publishSnapshot();
+void simulationThread(double simStep);
+void renderScene(const RenderSnapshot &snap, float alpha);
+void beginViews();
+void endViews();
+template <typename Draw>
+void drawSpriteViews(Draw draw);
+void updateHud(const RenderSnapshot &snap);
+void setupScreens(GLuint panelSampler, ShaderProgram *textProgram, GLuint fontTexture, GLuint fontSampler, bool sdf);
+void updateScreens(const RenderSnapshot &snap);
+void resetRun();
+void applyAtlas();
+void loadSounds();
+void subscribeEvents(const GameOptions &options);
+void buildCollisionMasks();
+void applyOutlines();
+bool fitsMask(const AlphaMask &mask, float width, float height);
+void pollTextures();
+void streamTextures();
+bool streamAtlas(const EmbeddedAsset *embedded);
+void finishStartupTrace(double firstFrameStart);
+void presentLoadingFrame(GLFWwindow *window);
+void warmPipelines();
+void publishMetrics();
+void dumpGameState(FILE *out);
+GLFWwindow *createGameWindow(const GameOptions &options);
+void requestAtlas();
+void updateEffects(const RenderSnapshot &snap, float alpha, float frameTime);
+int runBenchmark(GLFWwindow *window, const GameOptions &options);
+int runStress(GLFWwindow *window, const GameOptions &options);
+int runUploadBench(const GameOptions &options);
+void updateStress();
+void wakeAndSleep(float deltaTime);
+void endGuardedFrame(uint64_t frame, const GameOptions &options);
+void printLeaderboard();
+void recordScore(uint64_t ticks, uint64_t frames, const GameOptions &options);
+int runMonteCarlo(const GameOptions &options);
+
+// Every heap allocation carries its size and MemoryScope tag in a header, so
+// memoryStats can attribute live bytes to subsystems; array and nothrow forms
+// forward to these
+struct alignas(16) HeapHeader {
+    uint64_t size;
+    MemoryTag tag;
+};
+
+void *operator new(size_t size) {
+    HeapHeader *header = (HeapHeader *)malloc(sizeof(HeapHeader) + size);
+    if (!header) {
+        throw bad_alloc();
+    }
+    header->size = size;
+    header->tag = memoryTag;
+    memoryStats.add(header->tag, (int64_t)size, 1);
+    allocationGuard.record(size);
+    return header + 1;
+}
+
+void operator delete(void *p) noexcept {
+    if (p) {
+        HeapHeader *header = (HeapHeader *)p - 1;
+        memoryStats.add(header->tag, -(int64_t)header->size, -1);
+        free(header);
+    }
+}
+
+void operator delete(void *p, size_t) noexcept {
+    operator delete(p);
+}
+
+int main(int argc, char **argv) {
+    GameOptions options = parseOptions(argc, argv);
+    {
+        string path = options.settingsFile.empty() ? "settings.ini" : options.settingsFile, error;
+        std::error_code ec;
+        if ((!options.settingsFile.empty() || filesystem::exists(path, ec)) && !settings.load(path, error)) {
+            cout << "Failed to read settings: " << error << endl;
+            return 1;
+        }
+        shipTransition.elapsed = rivalShip.transition.elapsed = settings.laneTransitionTime; // both settled
+        waveTables = WaveTables(settings.waves);
+    }
+    cometCapacity = MAX_COMETS + options.stress;
+    if (options.affinity != "0") {
+        threadConfig.setup(std::thread::hardware_concurrency(), options.threadPriority);
+        if (options.affinity != "auto" && !threadConfig.parse(options.affinity.c_str())) {
+            cout << "Bad thread placement " << options.affinity << endl;
+            return 1;
+        }
+        cout << "Threads: " << threadConfig.describe() << endl;
+    }
+    if (!options.replay.empty()) {
+        // The recording decides everything that shapes the session
+        if (!replay.load(options.replay)) {
+            cout << "Failed to read replay " << options.replay << endl;
+            return 1;
+        }
+        if (replay.settings != 0 && replay.settings != settings.fingerprint()) {
+            cout << "Replay " << options.replay << " was recorded with different settings (fingerprint " << hex
+                 << replay.settings << ", these are " << settings.fingerprint() << dec
+                 << "); run it with the settings file it was recorded with" << endl;
+            return 1;
+        }
+        replaying = true;
+        options.seed = replay.seed;
+        options.simRate = replay.simRate;
+        hashingState = !replay.hashes.empty();
+        if (options.replayFast) {
+            options.bench = true;
+            options.benchFrames = (int)replay.ticks; // the benchmark runs one tick per frame
+            options.inputScript.clear();
+        }
+    }
+    if (options.pgoTrain > 0.0) {
+        // Train on the real update and draw paths, steered like a player rather than
+        // by the fixed pattern, for a run length that does not depend on the machine
+        options.bench = true;
+        options.benchFrames = std::max(1, (int)(options.pgoTrain * options.simRate));
+        options.inputScript.clear();
+    }
+    bool racing = options.hostPort > 0 || !options.connect.empty();
+    if (racing && (options.bench || replaying)) {
+        cout << "Races are live only; ignoring --host and --connect" << endl;
+        racing = false;
+    }
+    if (racing) {
+        // The host's seed and tick rate decide both cabinets' waves
+        if (options.seed == 0) {
+            options.seed = (uint64_t)time(nullptr);
+        }
+        bool opened = options.hostPort > 0 ? net.host((uint16_t)options.hostPort) : net.connect(options.connect);
+        cout << (options.hostPort > 0 ? "Waiting for a rival on port " + to_string(options.hostPort)
+                                      : "Joining the race at " + options.connect) << endl;
+        if (!opened || !net.handshake(options.seed, options.simRate, LANE_COUNT, settings.fingerprint(), CONNECT_TIMEOUT)) {
+            cout << "Failed to start the race" << (net.refusal.empty() ? "" : ": " + net.refusal) << endl;
+            return 1;
+        }
+    }
+    if (options.seed == 0) {
+        options.seed = options.bench ? 1 : (uint64_t)time(nullptr); // benchmarks are reproducible by default
+    }
+    spawnRandom.seed(options.seed, STREAM_SPAWN);
+    cout << "Seed: " << options.seed << endl;
+    if (!options.exportLevel.empty()) {
+        bool written = exportLevel(options.exportLevel, spawnRandom);
+        cout << (written ? "Wrote level " : "Failed to write level ") << options.exportLevel << endl;
+        return written ? 0 : 1;
+    }
+    if (options.monteCarlo > 0 || !options.monteCarloWorker.empty()) {
+        return runMonteCarlo(options);
+    }
+    if (!options.level.empty()) {
+        if (!level.open(options.level)) {
+            cout << "Failed to read level " << options.level << endl;
+            return 1;
+        }
+        cout << "Level: " << level.header->spawnCount << " spawns" << endl;
+    }
+    if (!options.waveScript.empty() && !startWaveScript(options.waveScript)) {
+        return options.waveScript == "list" ? 0 : 1;
+    }
+    startupTrace.start(options.startupTrace);
+    profiler.nameThread("main");
+    if (!options.profile.empty()) {
+        profilePath = options.profile;
+    }
+    startupTrace.span("process start", 0.0, startupTrace.now());
 
-int main() {
-    glfwInit(); // Initialize GLFW
-    GLFWwindow *window = glfwCreateWindow(WIDTH, HEIGHT, "Space Travel", nullptr, nullptr);
-    glfwMakeContextCurrent(window);
+    {
+        TraceScope trace("glfwInit");
+        glfwInit(); // Initialize GLFW
+        gameClock.setup();
+    }
+    GLFWwindow *window;
+    display.setup(options.bench ? WindowMode::Windowed : options.windowMode, options.monitor, options.refreshRate); // benchmarks render offscreen
+    {
+        TraceScope trace("glfwCreateWindow");
+        window = createGameWindow(options);
+        if (!window) {
+            cout << "Failed to create a window" << endl;
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+    }
     glfwSetKeyCallback(window, key_callback); // Register key input callback
 
-    // Initialize OpenGL (GLAD)
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "Failed to initialize GLAD" << std::endl;
+    // Initialize OpenGL: only the entry points the game calls (gl_loader.h)
+    bool glLoaded;
+    {
+        TraceScope trace("loadUsedGl");
+        glLoaded = loadUsedGl((GLADloadproc)glfwGetProcAddress);
+    }
+    if (!glLoaded) {
+        std::cout << "Failed to load OpenGL 4.0" << std::endl;
         return -1;
     }
+#ifdef SPACE_TRAVEL_GL_TRACE
+    glCalls.install(options.glErrors);
+#endif
+    // First pixels before any asset work; the loading loops below keep it drawn
+    if (!options.bench) {
+        presentLoadingFrame(window);
+    }
+    {
+        TraceScope trace("GL extensions");
+        glExt.load(); // Entry points newer than the glad profile
+        glExt.directStateAccess &= options.dsa; // gl_objects.h falls back to binding through glState
+        glNames.enabled = options.glNamePool;
+        textureHandles.enabled = glExt.bindlessTexture && options.bindless; // else one draw per texture
+        textureFormat.lowMemory = options.lowTextureMemory;
+        if ((options.glDebug || options.glPerfLog) && !glDebugLog.install(options.glDebug)) {
+            cout << "No KHR_debug: GL debug messages are unavailable" << endl;
+        }
+        if (options.glMarkers && !glMarkers.enable()) {
+            cout << "No KHR_debug: GL debug groups and labels are unavailable" << endl;
+        }
+        GLint profile = 0;
+        glGetIntegerv(GL_CONTEXT_PROFILE_MASK, &profile);
+        cout << "OpenGL " << GLVersion.major << "." << GLVersion.minor
+             << (profile & GL_CONTEXT_CORE_PROFILE_BIT ? " core" : " compatibility")
+             << (glExt.noError ? ", no-error" : "") << (glExt.debugContext ? ", debug" : "")
+             << (glExt.directStateAccess ? ", direct state access" : "") << (textureHandles.enabled ? ", bindless" : "")
+             << endl;
+        programCache.setup(options.shaderCache);
+    }
+    // The only blend state: every texture is premultiplied at load or bake time
+    // (premultiplied_alpha.h) and the particles write zero alpha to add
+    glState.blendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
-    // Set up shader program
-    GLuint shaderID = setupShader();
-    glUseProgram(shaderID);
+    // Setup materials and the spaceship (it starts in the middle lane); comets come from the spawner.
+    // Materials show the loader's placeholder until applyAtlas() points them at the atlas.
+    {
+        TraceScope trace("texture loader start");
+        MemoryScope memory(MEM_CPU_ASSETS);
+        // A hidden window sharing the game's objects, with the same context hints;
+        // without one the loader streams through pixel buffers on this thread
+        GLFWwindow *uploadContext = nullptr;
+        if (options.uploadContext) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            uploadContext = glfwCreateWindow(1, 1, "Space Travel loader", nullptr, window);
+            if (!uploadContext) {
+                cout << "No shared upload context; streaming textures through pixel buffers" << endl;
+            }
+        }
+        textureLoader.start(uploadContext);
+    }
+    const Mesh &quad = geometryCache.unitQuad();
+    GLuint pixelSampler = samplers.get(SamplerState());
+    materials[MATERIAL_SPACESHIP] = {&quad, textureLoader.placeholder, vec4(0.0f, 0.0f, 1.0f, 1.0f), pixelSampler};
+    materials[MATERIAL_COMET] = {&quad, textureLoader.placeholder, vec4(0.0f, 0.0f, 1.0f, 1.0f), pixelSampler};
+    materials[MATERIAL_RIVAL] = {&quad, textureLoader.placeholder, vec4(0.0f, 0.0f, 1.0f, 1.0f), pixelSampler};
+    materials[MATERIAL_SPACESHIP].layer = LAYER_SHIP; // both sprites have soft alpha edges, so neither is opaque
+    materials[MATERIAL_COMET].layer = LAYER_COMETS;
+    materials[MATERIAL_COMET].rotates = true; // tumbling asteroids
+    materials[MATERIAL_RIVAL].layer = LAYER_COMETS; // under the player's own ship when they share a lane
+    for (Material &mat : materials) {
+        mat.cutout = options.cutout && !mat.opaque;
+    }
 
-    // Projection matrix
-    mat4 projection = ortho(0.0f, 800.0f, 0.0f, 600.0f, -1.0f, 1.0f);
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, value_ptr(projection));
+    // Comet variants on disk are decoded up front, so a bad directory fails before any
+    // program is built for them; the texture array is made once the GL setup below is done
+    TextureArrayImages cometImages;
+    if (!options.cometVariants.empty() && !options.proceduralComets) {
+        vector<string> paths;
+        error_code ec;
+        for (const auto &entry : filesystem::directory_iterator(options.cometVariants, ec)) {
+            if (entry.path().extension() == ".png") {
+                paths.push_back(entry.path().string());
+            }
+        }
+        sort(paths.begin(), paths.end()); // layer order, and so each comet's look, by file name
+        if (!cometImages.decode(paths)) {
+            cout << "Failed to load comet variants from " << options.cometVariants << ": " << cometImages.error << endl;
+            return -1;
+        }
+    }
 
-    // Load textures
-    int spaceshipTexture = loadTexture("../textures/spaceship.png");
-    int cometTexture = loadTexture("../textures/asteroid.png");
+    // The GPU's tier, from the calibration file when it was measured on this driver,
+    // else measured now, before the other programs keep the driver busy. Benchmarks
+    // go by the GPU's name, so they start the same on a fresh checkout.
+    shaderBuilder.cache = &programCache;
+    GpuTier gpuTier = currentGpuTier();
+    if (!options.calibrationFile.empty() && !options.bench) {
+        double calibrationStart = startupTrace.now();
+        GpuCalibration calibration;
+        if (options.recalibrate || !calibration.load(options.calibrationFile) || !calibration.matchesDriver()) {
+            int build = shaderBuilder.submit("calibrate", SHADER_CALIBRATE_VERT, &SHADER_CALIBRATE_FRAG);
+            while (!shaderBuilder.poll()) {
+            }
+            if (shaderBuilder.ready(build)) {
+                calibration.measure(linkedShader(build));
+                if (!calibration.save(options.calibrationFile)) {
+                    cout << "Failed to write GPU calibration to " << options.calibrationFile << endl;
+                }
+            }
+        }
+        if (calibration.valid) {
+            gpuTier = calibration.tier;
+            cout << "GPU calibration: " << calibration.describe() << endl;
+        }
+        startupTrace.span("gpu calibration", calibrationStart, startupTrace.now());
+    }
 
-    // Setup spaceship and comet
-    spaceship.setupSprite(spaceshipTexture, vec3(WIDTH / 2, 50, 0), vec3(50, 50, 1));
-    comet.setupSprite(cometTexture, vec3(WIDTH / 2, 50, 0), vec3(50, 50, 1));
-    resetComet(); // Initial comet setup
+    // Submit every program up front; the driver compiles them (in parallel where it
+    // can) while the atlas loads below
+    spriteBatch.vertexId = options.vertexId && !options.spriteOutlines; // picks the variants as well as the batch's VAO layout
+    spriteOutlines = options.spriteOutlines;
+    view.views = options.splitScreen ? 2 : 1;
+    view.singlePass = view.views > 1 && glExt.viewportLayerArray; // picks the variants as well
+    double submitStart = startupTrace.now();
+    vector<uint32_t> spriteVariants = ShaderVariants::allOf(FEATURE_BITS, spriteBaseFeatures());
+    bool layeredComets = options.proceduralComets || !cometImages.pixels.empty();
+    if (layeredComets) {
+        vector<uint32_t> arrayVariants = ShaderVariants::allOf(FEATURE_BITS, spriteBaseFeatures() | FEATURE_ARRAY);
+        spriteVariants.insert(spriteVariants.end(), arrayVariants.begin(), arrayVariants.end());
+    }
+    if (options.cutout) {
+        for (size_t v = 0, n = spriteVariants.size(); v < n; v++) {
+            if (spriteVariants[v] & FEATURE_ALPHA_TEST) {
+                spriteVariants.push_back(spriteVariants[v] | FEATURE_CUTOUT);
+            }
+        }
+    }
+    spriteVariants.push_back(spriteBaseFeatures() | FEATURE_SDF); // distance-field text
+    spriteShaders.submit(shaderBuilder, "sprite", SHADER_SPRITE_VERT, SHADER_SPRITE_FRAG, spriteVariants);
+    int particleBuild = shaderBuilder.submit("particle", SHADER_PARTICLE_VERT, &SHADER_PARTICLE_FRAG);
+    int particleUpdateBuild = shaderBuilder.submit("particle update", SHADER_PARTICLE_UPDATE_VERT, nullptr,
+                                                   {begin(ParticleSystem::UPDATE_VARYINGS), end(ParticleSystem::UPDATE_VARYINGS)});
+    int starfieldBuild = shaderBuilder.submit("starfield", SHADER_STARFIELD_VERT, &SHADER_STARFIELD_FRAG);
+    // Culled comets come from a compute pass on GL 4.3, from transform feedback before it
+    CometField::Cull cometCull = !options.gpuCull      ? CometField::CULL_NONE
+                                 : glExt.computeShader ? CometField::CULL_COMPUTE
+                                                       : CometField::CULL_FEEDBACK;
+    uint32_t cometFeatures = (layeredComets ? FEATURE_ARRAY : 0u) | (cometCull != CometField::CULL_NONE ? FEATURE_CULLED : 0u) |
+                             (cometCull == CometField::CULL_FEEDBACK ? FEATURE_POINTS : 0u);
+    int cometBuild = options.gpuMotion ? ShaderVariants::submitVariant(shaderBuilder, "comet", SHADER_COMET_VERT, SHADER_SPRITE_FRAG,
+                                                                       cometFeatures,
+                                                                       cometFeatures & FEATURE_POINTS ? &SHADER_COMET_GEOM : nullptr)
+                                       : -1;
+    int cometCullBuild = -1;
+    if (cometCull == CometField::CULL_COMPUTE) {
+        cometCullBuild = shaderBuilder.submitStages("comet cull", {{GL_COMPUTE_SHADER, SHADER_COMET_CULL_COMP.text}},
+                                                    SHADER_COMET_CULL_COMP.hash);
+    } else if (cometCull == CometField::CULL_FEEDBACK) {
+        cometCullBuild = shaderBuilder.submitStages(
+            "comet cull", {{GL_VERTEX_SHADER, SHADER_COMET_CULL_VERT.text}, {GL_GEOMETRY_SHADER, SHADER_COMET_CULL_GEOM.text}},
+            hashMix(SHADER_COMET_CULL_VERT.hash, SHADER_COMET_CULL_GEOM.hash), {"survivor"});
+    }
+    int asteroidBuild = options.proceduralComets ? shaderBuilder.submit("asteroid", SHADER_STARFIELD_VERT, &SHADER_ASTEROID_FRAG) : -1;
+    // Bloom by GPU tier: none on a software rasterizer, the quarter level alone on an
+    // integrated GPU, both levels on a discrete one
+    bool bloomWanted = !options.overdraw &&
+                       (options.bloom > 0 || (options.bloom < 0 && !options.bench && gpuTier != GPU_TIER_SOFTWARE));
+    int bloomBuilds[3] = {-1, -1, -1};
+    if (bloomWanted) {
+        bloomBuilds[0] = shaderBuilder.submit("bloom down", SHADER_STARFIELD_VERT, &SHADER_BLOOM_DOWN_FRAG);
+        bloomBuilds[1] = shaderBuilder.submit("bloom blur", SHADER_STARFIELD_VERT, &SHADER_BLOOM_BLUR_FRAG);
+        bloomBuilds[2] = shaderBuilder.submit("bloom composite", SHADER_STARFIELD_VERT, &SHADER_BLOOM_COMPOSITE_FRAG);
+    }
+    int overdrawBuild = options.overdraw ? shaderBuilder.submit("overdraw", SHADER_STARFIELD_VERT, &SHADER_OVERDRAW_FRAG) : -1;
+    startupTrace.span("submit shaders", submitStart, startupTrace.now());
 
-    // Main game loop
-    while (!glfwWindowShouldClose(window) && !gameOver) {
-        glfwPollEvents(); // Handle input events
-        float currentFrame = glfwGetTime(); // Track time
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear screen
+    // Use the embedded atlas, else the asset pack's bake, else map the baked one if it
+    // is current, else pack the PNGs (the pack's, if it has them) on the loader thread
+    // and stream the result in over the first frames. An explicit --textures directory
+    // overrides the atlas embedded at build time.
+    const EmbeddedAsset *bakedAtlas = options.textureDir.empty() ? findEmbeddedAsset(TextureAtlas::BAKED_ATLAS) : nullptr;
+    if (!options.textureDir.empty()) {
+        textureDir = options.textureDir;
+    }
+    double atlasStart = startupTrace.now();
+    bool atlasLoaded;
+    imageDecoder = options.imageDecoder;
+    {
+        MemoryScope memory(MEM_CPU_ASSETS);
+        string packPath = options.pack.empty() ? textureDir + "/" + AssetPack::FILE_NAME : options.pack;
+        if (assetPack.open(packPath)) {
+            cout << "Mapped asset pack " << packPath << " (" << assetPack.count() << " entries)" << endl;
+        } else if (!options.pack.empty()) {
+            cout << "Cannot open asset pack " << packPath << endl;
+        }
+        EmbeddedAsset packedAtlas = {};
+        const PackEntry *packed = bakedAtlas ? nullptr : assetPack.find(TextureAtlas::BAKED_ATLAS);
+        if (packed && (packedAtlas.data = assetPack.read(*packed, packedAtlas.size))) {
+            packedAtlas.name = packed->name;
+            bakedAtlas = &packedAtlas;
+        }
+        atlasFromPack = assetPack.holds(".png");
+        textureStreamer.budget = options.textureBudget;
+        atlasLoaded = (options.textureBudget > 0 && streamAtlas(bakedAtlas)) ||
+                      (bakedAtlas && atlas.loadEmbedded(bakedAtlas->data, bakedAtlas->size)) ||
+                      atlas.loadBaked(textureDir);
+        if (!atlasLoaded) {
+            requestAtlas();
+        }
+    }
+    startupTrace.span(atlasLoaded ? "upload baked atlas" : "request atlas", atlasStart, startupTrace.now());
 
-        updateGame(currentFrame); // Update game logic
-        drawSprite(spaceship, shaderID); // Draw spaceship
-        drawSprite(comet, shaderID);     // Draw comet
+    double sceneStart = startupTrace.now();
+    {
+        MemoryScope memory(MEM_CPU_ENTITIES);
+        entities.setArchetypes(ARCHETYPE_COMPONENTS);
+        if (options.largePages) {
+            largePages.enable();
+        }
+        entities.reserve(cometCapacity + 2); // no allocation once the game loop runs
+        spaceship = entities.create(LANES.center(LANES.MIDDLE), settings.shipY, settings.shipSize, settings.shipSize, 0.0f, LANES.MIDDLE, MATERIAL_SPACESHIP,
+                                    ARCHETYPE_SHIP);
+        if (net.active) {
+            rival = entities.create(rivalShip.x, settings.shipY, settings.shipSize, settings.shipSize, 0.0f, LANES.MIDDLE, MATERIAL_RIVAL, ARCHETYPE_RIVAL);
+        }
+        broadphase.setup(LANE_COUNT, WIDTH, HEIGHT, 64.0f);
+        simulationLod.enabled = options.simulationLod;
+        lodChanges.reserve(options.stress);
+        collisionCandidates.reserve(cometCapacity + 1);
+        expiredComets.reserve(MAX_COMETS);
+        drawList.reserve(cometCapacity + 1);
+        initialEntities = entities;
+        attachments.reserve(2);
+        shipNode = attachments.create(TransformHierarchy::INVALID, Transform2D());
+        thrusterNode = attachments.create(shipNode, {vec2(0.0f, -settings.shipSize / 2), 0.0f, 1.0f});
+    }
+    spriteBatch.indirect = options.indirect;
+    spriteBatch.packed = options.packedInstances;
+    spriteBatch.instanceStream.strategy = options.uploadStrategy;
+    if (spriteBatch.packed && cometImages.layers > MAX_PACKED_LAYER + 1) {
+        cout << cometImages.layers << " comet variants are more than packed instances can index; streaming them whole" << endl;
+        spriteBatch.packed = false;
+    }
+    spriteBatch.setup(quad, cometCapacity + 1 + PerfOverlay::MAX_QUADS);
+    // Per frame: commands, sort scratch and instances of every list, plus the sorted copy
+    // and the far comets, placements and visibility staged by the recording jobs
+    frameArena.setup((2 * cometCapacity + 2 + PerfOverlay::MAX_QUADS + Hud::LABELS * TextLabel::MAX_CHARS) *
+                         (3 * sizeof(DrawList::Command) + 2 * sizeof(SpriteInstance) + (spriteBatch.packed ? spriteBatch.stride() : 0)) +
+                     (cometCapacity + 2) * (sizeof(SpriteInstance) + sizeof(aligned_vec4) + 1) + FrameArena::ALIGNMENT);
+    startupTrace.span("scene setup", sceneStart, startupTrace.now());
 
-        glfwSwapBuffers(window); // Swap buffers
+    // Wait for the programs, streaming the atlas in meanwhile
+    double shaderWaitStart = startupTrace.now();
+    while (!shaderBuilder.poll()) {
+        textureLoader.update();
+        if (!options.bench) {
+            presentLoadingFrame(window);
+        }
+    }
+    startupTrace.span("wait for shaders", shaderWaitStart, startupTrace.now());
+    if (shaderBuilder.anyFailed()) {
+        return -1;
+    }
+    if (programCache.enabled) {
+        cout << "Shader cache: " << programCache.hits << " hits, " << programCache.misses << " misses" << endl;
     }
 
-    glfwTerminate(); // Clean up
-    return 0;
-}
+    double configureStart = startupTrace.now();
 
-// Handles keyboard input for moving spaceship between lanes
-void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode) {
-    if (action == GLFW_PRESS) {
-        if (key == GLFW_KEY_LEFT && spaceshipLane > 0) {
-            moveSpaceship(spaceshipLane - 1); // Move left
-        } else if (key == GLFW_KEY_RIGHT && spaceshipLane < 2) {
-            moveSpaceship(spaceshipLane + 1); // Move right
+    // Projection and letterboxed viewport, shared by every program through the View block
+    view.setup(WIDTH, HEIGHT);
+    resizeView(window);
+    if (view.views > 1) {
+        cout << "Split screen: " << (view.singlePass ? "both views in one instanced pass" : "one pass per view") << endl;
+    }
+    if (options.dynamicRes && !options.bench) {
+        dynamicRes.setup(options.minResScale);
+    }
+    if (options.overdraw) {
+        overdraw.setup(linkedShader(overdrawBuild));
+        overlay.visible = true;
+        cout << "Overdraw view: scene draws per pixel, black none to white 8 or more" << endl;
+    } else if (options.msaa > 0) {
+        msaa.setup(options.msaa);
+        cout << "MSAA: " << (msaa.enabled ? to_string(msaa.samples) + "x" : string("unsupported")) << endl;
+    }
+    renderGraph.setup();
+    if (bloomWanted) {
+        SamplerState linear;
+        linear.minFilter = linear.magFilter = GL_LINEAR;
+        bool halfLevel = options.bloom > 0 || gpuTier == GPU_TIER_DISCRETE;
+        bloom.setup(linkedShader(bloomBuilds[0]), linkedShader(bloomBuilds[1]), linkedShader(bloomBuilds[2]), samplers.get(linear),
+                    halfLevel);
+        msaa.colorFormat = Bloom::FORMAT; // resolved straight into the bloom scene buffer
+        cout << "Bloom: " << (halfLevel ? "1/2 and 1/4" : "1/4") << " resolution, " << GPU_TIER_NAMES[gpuTier] << " GPU" << endl;
+    }
+
+    // With --gpu-motion comets are written once per spawn/despawn and moved by their own shader
+    if (options.gpuMotion) {
+        cometShader = linkedShader(cometBuild);
+        cometShader.use();
+        cometShader.set(cometShader.find("size"), vec2(settings.cometSize));
+        cometShader.set(cometShader.find("field"), vec2(LANE_WIDTH, settings.spawnY));
+        cometShader.set(cometShader.find("depth"), layerDepth(LAYER_COMETS));
+        cometPipeline = {cometShader.id, true, false, true};
+        cometField.setup(quad, cometCapacity + 1);
+        if (cometCull != CometField::CULL_NONE) {
+            ShaderProgram cull = linkedShader(cometCullBuild);
+            cull.use();
+            cull.set(cull.find("size"), vec2(settings.cometSize));
+            cull.set(cull.find("field"), vec2(LANE_WIDTH, settings.spawnY));
+            cometField.setupCulling(quad, cometCull, cull.id);
+            cout << "Comet culling: " << (cometCull == CometField::CULL_COMPUTE ? "compute" : "transform feedback") << endl;
         }
     }
-}
 
-// Sets up shaders (vertex and fragment shaders)
-int setupShader() {
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
+    // Procedural background, drawn first every frame
+    starfieldShader = linkedShader(starfieldBuild);
+    starfield.setup();
 
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    // Comet sprites from a texture array instead of the atlas: drawn by a noise shader
+    // over the starfield's fullscreen triangle, or the images decoded above. Filtered
+    // across their mips, which no atlas neighbour can bleed into.
+    if (layeredComets) {
+        if (options.proceduralComets) {
+            ShaderProgram asteroidShader = linkedShader(asteroidBuild);
+            asteroids.bake(asteroidShader, starfield.VAO, (int)settings.cometSize);
+            view.apply();
+        } else {
+            asteroids.load(cometImages, (int)settings.cometSize);
+            vector<unsigned char>().swap(cometImages.pixels);
+        }
+        SamplerState trilinear;
+        trilinear.minFilter = GL_LINEAR_MIPMAP_LINEAR;
+        trilinear.magFilter = GL_LINEAR;
+        Material &comet = materials[MATERIAL_COMET];
+        comet.texID = asteroids.texture;
+        comet.texRect = vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        comet.sampler = samplers.get(trilinear);
+        comet.flipbook = Flipbook();
+        comet.layered = true;
+    }
 
-    GLuint shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    // GPU particles for comet trails and the ship explosion
+    particleShader = linkedShader(particleBuild);
+    particleShader.use();
+    particleShader.set(particleShader.find("debrisSize"), settings.shipSize / 8);
+    particles.setup(quad, MAX_PARTICLES, shaderBuilder.program(particleUpdateBuild));
 
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
-    return shaderProgram;
-}
+    // Set up shader program
+    spriteShaders.link(linkedShader);
+    for (Material &mat : materials) {
+        mat.shaderKey = drawList.shader(spriteShaders.find(materialFeatures(mat)));
+        if (mat.cutout) {
+            Material edge = mat;
+            edge.cutout = false;
+            mat.edgeShaderKey = drawList.shader(spriteShaders.find(materialFeatures(edge)));
+        }
+        GLint firstVertex = spriteOutlines ? GeometryCache::outlineFirst((int)(&mat - materials)) : 0;
+        mat.textureKey = drawList.texture(mat.texID, mat.sampler, mat.target(), firstVertex);
+    }
+    refreshSpriteTemplates();
+    overlay.setup(spriteShaders.find(spriteBaseFeatures()), pixelSampler); // unrotated, still and blended
+    if (options.impostors && !options.gpuMotion) {
+        SamplerState linear;
+        linear.minFilter = linear.magFilter = GL_LINEAR;
+        impostors.setup(spriteShaders.find(spriteBaseFeatures()), samplers.get(linear), drawList, cometCapacity);
+    }
+    overlay.visible = options.overlay;
+    bool text = (options.hud || options.ui) && !options.bench;
+    ShaderProgram *textProgram = spriteShaders.find(spriteBaseFeatures());
+    GLuint fontTexture = overlay.texture, fontSampler = pixelSampler; // the overlay's font
+    if (text && options.hudSdf) {
+        SamplerState linear;
+        linear.minFilter = linear.magFilter = GL_LINEAR;
+        sdfFont.setup();
+        textProgram = spriteShaders.find(spriteBaseFeatures() | FEATURE_SDF);
+        fontTexture = sdfFont.texture;
+        fontSampler = samplers.get(linear);
+    }
+    if (options.hud && !options.bench) {
+        hud.setup(textProgram, fontTexture, fontSampler, options.hudSdf);
+    }
+    if (options.ui && !options.bench) {
+        setupScreens(pixelSampler, textProgram, fontTexture, fontSampler, options.hudSdf);
+    }
+    startupTrace.span("configure shaders", configureStart, startupTrace.now());
 
-// Loads texture from file using stb_image
-int loadTexture(const std::string &filePath) {
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
+    if (atlasLoaded) {
+        applyAtlas();
+        streamTextures(); // the coarsest levels, so there is something to draw from the first frame
+    } else if (options.bench) {
+        textureLoader.finish(); // measure with the real textures
+        pollTextures();
+    } else {
+        // Play starts once the atlas and its collision masks are resident
+        double atlasWaitStart = startupTrace.now();
+        while (atlasLoad >= 0 && !glfwWindowShouldClose(window)) {
+            pollTextures();
+            presentLoadingFrame(window);
+        }
+        startupTrace.span("wait for atlas", atlasWaitStart, startupTrace.now());
+    }
+    if (options.warmUp && options.render) {
+        warmPipelines(); // the loading screen's last frame stays up meanwhile
+    }
+
+    // Repack the atlas whenever one of its images changes on disk; packed images do not
+    if (options.hotReload && !options.bench && !atlasFromPack) {
+        error_code ec;
+        for (const auto &entry : filesystem::directory_iterator(textureDir, ec)) {
+            if (entry.path().extension() == ".png") {
+                assets.watch(entry.path().string(), INVALID_TEXTURE, requestAtlas);
+            }
+        }
+    }
+
+    // Worker threads for the simulation passes
+    {
+        TraceScope trace("start workers");
+        unsigned spareCores = std::max(1u, std::thread::hardware_concurrency()) - 1;
+        if (uint64_t workerCores = threadConfig.roles[THREAD_WORKER].cores) {
+            spareCores = (unsigned)std::popcount(workerCores); // one per core the workers have to themselves
+        }
+        jobs.start(options.threads < 0 ? spareCores : (unsigned)options.threads);
+        waves.start(WaveSource()); // from here on only the stream's worker rolls spawnRandom
+    }
+
+    frameLatency.setup(options.framesInFlight);
+    lateLatch = options.lateLatch && !options.bench && !replaying; // the latch predicts from live input
+    timeScale = std::max(options.timeScale, 0.001);
+    maxSpeed = options.maxSpeed;
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    // Sound effects, mixed on their own thread; the benchmark stays silent
+    if (options.audio && !options.bench) {
+        loadSounds();
+        if (audio.start()) {
+            audio.setMaster(options.volume);
+        }
+    }
+    subscribeEvents(options);
 
-    int imgWidth, imgHeight, nrChannels;
-    unsigned char *data = stbi_load(filePath.c_str(), &imgWidth, &imgHeight, &nrChannels, 0);
+    // Leaderboard and play totals; benchmarks and replays leave them alone
+    if (!options.scoreFile.empty() && !options.bench && !replaying) {
+        if (scores.open(options.scoreFile)) {
+            printLeaderboard();
+        } else {
+            cout << "Failed to open score file " << options.scoreFile << endl;
+        }
+    }
+    if (!options.leaderboard.empty() && !options.bench && !replaying) {
+        if (leaderboard.start(options.leaderboard)) {
+            leaderboard.fetch(); // so the game-over screen has a ranking before the first run ends
+        } else {
+            cout << "Leaderboard address needs HOST:PORT: " << options.leaderboard << endl;
+        }
+    }
 
-    if (data) {
-        if (nrChannels == 3) {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, imgWidth, imgHeight, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+    // Stats for fleet dashboards, served from a low-priority thread
+    if (options.metricsPort > 0 && !options.bench) {
+        if (metrics.start(options.metricsPort, (const char *)glGetString(GL_VENDOR), (const char *)glGetString(GL_RENDERER),
+                          (const char *)glGetString(GL_VERSION))) {
+            cout << "Metrics on port " << options.metricsPort << endl;
         } else {
-            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imgWidth, imgHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+            cout << "Cannot serve metrics on port " << options.metricsPort << endl;
+        }
+    }
+
+    // Session telemetry for operations, drained to disk on its own thread
+    if (!options.telemetryDir.empty() && !options.bench && !telemetry.start(options.telemetryDir)) {
+        cout << "Failed to write telemetry to " << options.telemetryDir << endl;
+    }
+
+    // Per-phase CPU timers and GPU draw timer
+    {
+        MemoryScope memory(MEM_CPU_TOOLS);
+        frameStats.setup(options.frameCsv.c_str(), options.frameBudget);
+        if (!options.hitchLog.empty()) {
+            if (hitchLog.open(options.hitchLog.c_str(), options.hitchThreshold, options.frameBudget)) {
+                frameStats.onComplete = [](const FrameRecord &record) { hitchLog.check(record, frameStats.budgetMs); };
+            } else {
+                cout << "Failed to open hitch log " << options.hitchLog << endl;
+            }
         }
-        glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    capture.setup(options.captureDir);
+    if (options.recordFrames) {
+        capture.toggleRecording();
+    }
+    if (!options.video.empty()) {
+        capture.startVideo(options.encoder, options.video, options.videoFps);
+    }
+
+    allocationGuard.mode = options.allocGuard;
+    int result = 0;
+    if (options.bench) {
+        result = runBenchmark(window, options);
     } else {
-        std::cout << "Failed to load texture " << filePath << std::endl;
+        recordingInput = !options.recordInput.empty() || !options.record.empty();
+        if (options.keyframeInterval > 0.0 && !options.record.empty()) {
+            keyframeTicks = std::max<uint64_t>(1, (uint64_t)(options.keyframeInterval * options.simRate + 0.5));
+            recording.keyframeInterval = (uint32_t)keyframeTicks;
+            keyframeScratch.reserve(64 * 1024);
+            recording.keyframeData.reserve(64 * 1024 * (size_t)(600.0 / options.keyframeInterval)); // ten minutes before it grows
+        }
+        if (options.stateHash && !options.record.empty()) {
+            hashingState = recordingHashes = true;
+            stateHashes.reserve((size_t)(options.simRate * 600)); // ten minutes before it grows
+        }
+        if (net.active && !net.waitReady(READY_TIMEOUT)) {
+            cout << "The rival never finished loading" << endl;
+            gameOver = true;
+        }
+        if (replaying && options.seek > 0.0) {
+            seekReplay(options.seek, options.simRate);
+        }
+        if (options.hangTimeout > 0.0) {
+            // Into the telemetry directory when there is one, since operations collect that
+            hangDetector.dumpState = [](FILE *out) { dumpGameState(out); };
+            hangDetector.start(options.hangTimeout, options.telemetryDir, options.hangRestart, argc, argv);
+        }
+        if (!options.sampleProfile.empty()) {
+            samplingProfiler.start(options.sampleRate, options.sampleProfile, options.sampleThreads);
+        }
+        runGame(window, options);
+        samplingProfiler.stop();
+        hangDetector.stop();
+        if (net.active) {
+            reportRace();
+        }
+        if (!options.recordInput.empty() && !recordedInput.save(options.recordInput)) {
+            cout << "Failed to write input script " << options.recordInput << endl;
+        }
+        if (!options.record.empty()) {
+            ReplayFile &session = recording;
+            session.seed = options.seed;
+            session.simRate = options.simRate;
+            session.settings = settings.fingerprint();
+            session.ticks = simTick;
+            session.input = recordedInput;
+            session.hashes = stateHashes;
+            if (!session.save(options.record)) {
+                cout << "Failed to write replay " << options.record << endl;
+            }
+        }
+    }
+    if (replaying && !replay.hashes.empty() && desyncTick == UINT64_MAX) {
+        cout << "State hashes match the recording through tick " << std::min<uint64_t>(simTick, replay.hashes.size()) << endl;
+    } else if (desyncTick != UINT64_MAX && result == 0) {
+        result = 2; // for scripted determinism checks
+    }
+
+    memoryStats.print();
+    largePages.print();
+    if (atlasStream >= 0) {
+        textureStreamer.print();
+    }
+    glCalls.print();
+    glNames.print();
+    audio.stop();
+    jobs.stop();
+    waves.stop();
+    waveScripts.clear();
+    if (events.dropped > 0) {
+        cout << "Events: " << events.dropped << " dropped" << endl;
+    }
+    scores.close();
+    leaderboard.stop();
+    metrics.stop();
+    if (leaderboard.dropped > 0) {
+        cout << "Leaderboard: " << leaderboard.dropped << " requests dropped" << endl;
+    }
+    telemetry.stop();
+    if (!options.profile.empty()) {
+        profiler.flush(profilePath);
+    }
+    capture.release();
+    frameStats.release();
+    hitchLog.close();
+    frameLatency.release();
+    overlay.release();
+    sdfFont.release();
+    ui.release();
+    spriteBatch.release();
+    particles.release();
+    starfield.release();
+    view.release();
+    dynamicRes.release();
+    msaa.release();
+    overdraw.release();
+    bloom.release();
+    renderGraph.release();
+    if (cometField.enabled) {
+        cometField.release();
+    }
+    impostors.release();
+    asteroids.release();
+    geometryCache.release();
+    textureLoader.stop();
+    assets.releaseAll();
+    if (atlasStream >= 0) {
+        atlas.texID = 0; // the streamer's
+    }
+    textureStreamer.releaseAll();
+    atlas.release();
+    assetPack.close(); // nothing points into the mapping any more
+    samplers.release();
+    glNames.release(); // everything above in one delete per kind
+    glfwTerminate(); // Clean up
+    return result;
+}
+
+// Interactive game loop, until the window closes or the game is over
+void runGame(GLFWwindow *window, const GameOptions &options) {
+    // Swap interval / frame limiter
+    FramePacer pacer;
+    pacer.setup(options.pacing, options.fpsCap);
+    pacer.setRefreshRange(options.vrrMin, options.vrrMax > 0.0 ? options.vrrMax : display.refresh(window));
+    if (pacer.mode == PacingMode::Vrr) {
+        cout << "VRR pacing: " << pacer.targetFps << " fps cap in a " << pacer.vrrMin << "-" << pacer.vrrMax << " Hz range" << endl;
+    }
+    FrameRateController rateController;
+    if (options.adaptiveRate && pacer.mode != PacingMode::Uncapped && pacer.mode != PacingMode::Vrr) {
+        // The divisor applies to the display's refresh, or to the cap when there is no
+        // vsync; with VRR the display follows the frame rate and there is none to divide
+        rateController.setup(pacer.mode == PacingMode::Capped ? pacer.targetFps : display.refresh(window));
+    }
+    PowerPolicy power;
+    if (options.powerSaving) {
+        power.setup(options.batteryFps, options.batteryResScale);
+    }
+
+    // Only the interactive game pauses; a benchmark runs through focus changes
+    glfwSetWindowFocusCallback(window, focus_callback);
+    glfwSetWindowRefreshCallback(window, refresh_callback);
+    glfwSetWindowIconifyCallback(window, iconify_callback);
+    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+
+    // Fixed-step simulation, either on its own thread or inline before each frame.
+    // Rendering interpolates the latest published tick against the one before it.
+    const double simStep = 1.0 / options.simRate;
+    publishSnapshot();
+    thread simulation;
+    if (options.simThread) {
+        simulation = thread(simulationThread, simStep);
+    }
+
+    // The accumulator counts simulated time in timer ticks: wall time times timeScale
+    const uint64_t stepTicks = gameClock.ticks(simStep);
+    const uint64_t maxFrameTicks = gameClock.ticks(MAX_FRAME_TIME);
+    const uint64_t sliceTicks = gameClock.ticks(MAX_SPEED_SLICE);
+    const uint64_t runStart = gameClock.now();
+    unsigned long long firstTick = simTick; // of the current run
+    uint64_t previousTime = runStart;
+    uint64_t accumulator = 0; // simulated timer ticks not yet ticked
+    bool ended = false;
+    uint64_t gameOverTime = 0; // the window stays up while the explosion plays
+    double firstFrameStart = startupTrace.now();
+    uint64_t frame = 0; // frames run, for the allocation guard's warm-up
+    hud.firstTick = firstTick;
+    telemetry.event(TELEMETRY_SESSION_START, (uint32_t)options.simRate, (double)options.seed);
+    // A recording, a replay or a race is one run from start to end
+    const bool restartable = !recordingInput && !replaying && !net.active && !options.bench;
+    if (ui.buffer && restartable) {
+        ui.setText(screens.restart, "PRESS R TO PLAY AGAIN");
+    }
+    configureThread(THREAD_RENDER, "render"); // once the long-lived threads exist, so none inherits the render core
+    // With a present thread, frame N swaps there while frame N+1's input and
+    // simulation run here; the GL-side polling moves after the context comes back
+    PresentThread presenter;
+    if (options.presentThread && options.render) {
+        presenter.start(window);
+    }
+    while (!glfwWindowShouldClose(window)) {
+        hangDetector.beat();
+        // Restart in place: the window, context, programs and textures stay; only
+        // the simulation goes back to where the first run started
+        if (restartRequested) {
+            restartRequested = false;
+            if (ended && restartable) {
+                uint64_t restartStart = gameClock.now();
+                if (simulation.joinable()) {
+                    simulation.join(); // it left its loop at game over
+                }
+                resetRun();
+                firstTick = simTick;
+                hud.firstTick = firstTick;
+                ended = false;
+                previousTime = gameClock.now();
+                accumulator = 0;
+                publishSnapshot();
+                if (options.simThread) {
+                    simulation = thread(simulationThread, simStep);
+                }
+                telemetry.event(TELEMETRY_SESSION_START, (uint32_t)options.simRate, (double)options.seed);
+                cout << "Restarted in " << gameClock.seconds(gameClock.now() - restartStart) * 1000.0 << " ms" << endl;
+            }
+        }
+
+        // Idle while paused, hidden or once the explosion has played out: sleep until
+        // an event arrives, and draw only when one changed what the window shows.
+        // A hidden window draws and submits nothing at all.
+        bool finished = ended && gameClock.seconds(gameClock.now() - gameOverTime) > EXPLOSION_LIFETIME;
+        if (paused || windowHidden || finished) {
+            PROFILE_SCOPE("idle");
+            glfwWaitEventsTimeout(windowFocused && !windowHidden ? IDLE_WAIT : UNFOCUSED_WAIT);
+            previousTime = gameClock.now(); // resume without a catch-up burst
+            accumulator = 0;
+            if (!redrawRequested || windowHidden) {
+                continue;
+            }
+        }
+        redrawRequested = false;
+
+        frameStats.beginFrame();
+        {
+            ScopedPhaseTimer timer(frameStats, PHASE_POLL);
+            if (!presenter.enabled) {
+                frameLatency.wait(); // Keep the driver's queue short so input is fresh
+            }
+            glfwPollEvents();    // Handle input events
+            gamepads.poll(inputQueue);
+            if (!presenter.enabled) {
+                pollTextures(); // Continue background texture uploads
+            }
+            leaderboard.poll(); // Pick up online rankings
+        }
+
+        float alpha;
+        double frameTime;
+        {
+            ScopedPhaseTimer timer(frameStats, PHASE_UPDATE);
+            uint64_t currentTime = gameClock.now(); // Track time
+            uint64_t elapsed = std::min(currentTime - previousTime, maxFrameTicks);
+            frameTime = gameClock.seconds(elapsed);
+            previousTime = currentTime;
+            if (!options.simThread && maxSpeed) {
+                // Max speed: tick for a slice of wall time, then draw the latest tick
+                while (gameClock.now() - currentTime < sliceTicks && !gameOver && !paused && !windowHidden) {
+                    tickSimulation((float)simStep, gameClock.now());
+                    publishSnapshot();
+                }
+            } else if (!options.simThread) {
+                accumulator += (uint64_t)(elapsed * timeScale + 0.5);
+                while (accumulator >= stepTicks && !gameOver && !paused && !windowHidden) {
+                    // Wall instant the tick stands for, so input lands on the right tick at any scale
+                    uint64_t wallAhead = (uint64_t)((accumulator - stepTicks) / timeScale);
+                    tickSimulation((float)simStep, currentTime - wallAhead); // Update game logic
+                    publishSnapshot();
+                    accumulator -= stepTicks;
+                }
+            }
+            snapshots.acquire();
+            double sinceTick = gameClock.secondsBetween(snapshots.readSlot().tickTime, currentTime) * timeScale;
+            alpha = maxSpeed ? 1.0f : (float)std::min(std::max(sinceTick / simStep, 0.0), 1.0);
+            if (replaying && !gameOver && snapshots.readSlot().tick >= replay.ticks) {
+                glfwSetWindowShouldClose(window, GLFW_TRUE); // the recorded session is over
+            }
+            if (gameOver && !ended) {
+                ended = true;
+                gameOverTime = currentTime;
+                shipWrecked = true;
+                recordScore(simTick - firstTick, frame, options); // a few stores; the disk write is the flusher's
+            }
+            events.dispatch(); // sounds, explosions and counters for the ticks run since the last frame
+        }
+
+        if (!options.render) {
+            // Nothing to draw: keep the window responsive without spinning a core
+            // when the simulation has its own thread
+            if (options.simThread) {
+                glfwWaitEventsTimeout(IDLE_WAIT);
+            }
+            frameStats.endFrame();
+            endGuardedFrame(frame++, options);
+            continue;
+        }
+
+        if (presenter.enabled) {
+            {
+                ScopedPhaseTimer timer(frameStats, PHASE_SWAP);
+                PROFILE_SCOPE("wait for present");
+                presenter.acquire();
+            }
+            ScopedPhaseTimer timer(frameStats, PHASE_POLL);
+            frameLatency.wait();
+            pollTextures();
+        }
+
+        {
+            ScopedPhaseTimer timer(frameStats, PHASE_DRAW);
+            frameStats.beginGpu();
+            if (viewStale.exchange(false)) {
+                resizeView(window); // however many resize events arrived, one update
+            }
+            updateEffects(snapshots.readSlot(), alpha, (float)frameTime);
+            renderScene(snapshots.readSlot(), alpha);
+            frameStats.endGpu();
+        }
+
+        {
+            ScopedPhaseTimer timer(frameStats, PHASE_SWAP);
+            PROFILE_SCOPE("swap");
+            pacer.wait();            // Hold the frame rate in capped mode
+            if (presenter.enabled) {
+                frameLatency.frameSubmitted(); // the fence needs the context, which goes with the frame
+                presenter.present();
+            } else {
+                renderBackend.present(window); // Swap buffers
+                frameLatency.frameSubmitted();
+            }
+        }
+        frameStats.endFrame();
+        dynamicRes.update(frameStats.latest.gpu, frameStats.budgetMs);
+        if (rateController.update(frameStats.latest)) {
+            presenter.acquire(); // the swap interval belongs to the context
+            pacer.divide(rateController.divisor);
+            cout << "Frame rate: " << rateController.rate() << " Hz" << endl;
+        }
+        if (displayChanged) {
+            displayChanged = false;
+            presenter.acquire(); // the swap interval belongs to the context, and may not survive the switch
+            pacer.applyInterval();
+            if (options.vrrMax <= 0.0) {
+                pacer.setRefreshRange(options.vrrMin, display.refresh(window));
+            }
+            if (rateController.enabled && pacer.mode != PacingMode::Capped) {
+                rateController.setup(display.refresh(window));
+            }
+        }
+        if (power.poll(glfwGetTime())) {
+            presenter.acquire(); // under VRR a limit below the range turns vsync back on
+            pacer.limit(power.fpsLimit());
+            dynamicRes.limit(power.scaleLimit());
+            if (power.onBattery()) {
+                cout << "On battery: frame rate capped at " << power.batteryFps << " fps";
+                if (dynamicRes.enabled) {
+                    cout << ", render scale at " << dynamicRes.maxScale;
+                }
+                cout << endl;
+            } else {
+                cout << "On mains power: frame rate and render scale restored" << endl;
+            }
+        }
+        renderBackend.endFrame();
+        overlay.record(frameTime * 1000.0);
+        telemetry.event(TELEMETRY_FRAME, (uint32_t)frame, frameTime * 1000.0, frameStats.latest.gpu);
+        if (frameTime * 1000.0 > 2.0 * frameStats.budgetMs) {
+            telemetry.event(TELEMETRY_HITCH, (uint32_t)frame, frameTime * 1000.0, frameStats.budgetMs);
+            hitchFrames++;
+        }
+        if (metrics.due(glfwGetTime())) {
+            publishMetrics();
+        }
+        if (startupTrace.enabled) {
+            finishStartupTrace(firstFrameStart);
+        }
+        endGuardedFrame(frame++, options);
+        if (options.exitAfterFirstFrame) {
+            // On the clock every process shares, so a launcher can subtract its own start
+            long long ns = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+            cout << "First frame presented at " << ns << " ns" << endl;
+            break;
+        }
+    }
+    presenter.stop(); // the context comes back for shutdown
+    allocationGuard.disarm(); // shutdown is free to allocate
+    if (!ended && !options.exitAfterFirstFrame) {
+        recordScore(simTick - firstTick, frame, options); // closed mid-run: still a session
+    }
+    telemetry.event(TELEMETRY_SESSION_END, (uint32_t)frame, gameClock.seconds(gameClock.now() - runStart),
+                    (double)(simTick - firstTick));
+
+    if (simulation.joinable()) {
+        gameOver = true; // also stops the simulation thread when the window closes
+        simulation.join();
+    }
+    frameStats.printSummary(); // on game over or window close
+    renderGraph.printSummary();
+    if (options.allocGuard != AllocationGuardMode::Off) {
+        allocationGuard.printSummary();
+    }
+    if (impostors.framesActive > 0) {
+        cout << "Comet impostors: " << impostors.framesActive << " frames, up to " << impostors.peakAggregated << " comets" << endl;
+    }
+    if (hud.enabled) {
+        cout << "HUD: " << hud.rewrites() << " glyphs rebuilt over " << frame << " frames" << endl;
+    }
+    if (ui.buffer) {
+        cout << "UI: " << ui.uploads << " uploads, " << ui.uploadedBytes / 1024 << " KB over " << frame << " frames" << endl;
+    }
+    if (rateController.changes > 0) {
+        cout << "Frame rate controller: " << rateController.rate() << " Hz at exit, " << rateController.changes
+             << " changes" << endl;
+    }
+    if (dynamicRes.enabled) {
+        cout << "Dynamic resolution: scale " << dynamicRes.scale << " at exit, " << dynamicRes.changes << " changes" << endl;
+    }
+    if (maxSpeed || timeScale != 1.0 || !options.render) {
+        double wall = gameClock.seconds(gameClock.now() - runStart);
+        unsigned long long ticks = simTick - firstTick;
+        cout << "simulation: " << ticks << " ticks, " << ticks * simStep << " s simulated in " << wall << " s ("
+             << ticks / wall << " ticks/s, " << ticks * simStep / wall << "x real time)" << endl;
     }
-    stbi_image_free(data);
-    return texID;
 }
 
-// Draws a sprite using its position, size, and texture
-void drawSprite(Sprite spr, GLuint shaderID) {
-    glUniform2f(glGetUniformLocation(shaderID, "offsetTex"), 0.0f, 0.0f);
-    glBindVertexArray(spr.VAO);
-    glBindTexture(GL_TEXTURE_2D, spr.texID);
+// Close a frame of the game loop for the allocation guard, arming it once the
+// warm-up frames have filled every cache and pool
+void endGuardedFrame(uint64_t frame, const GameOptions &options) {
+    allocationGuard.endFrame(frame);
+    if (frame + 1 == (uint64_t)options.allocWarmup && options.allocGuard != AllocationGuardMode::Off) {
+        allocationGuard.arm();
+    }
+}
 
-    mat4 model = mat4(1.0f);
-    model = translate(model, spr.position);
-    model = rotate(model, radians(spr.angle), vec3(0.0f, 0.0f, 1.0f));
-    model = scale(model, spr.dimensions);
+// Best runs and totals, read from the mapped score file at startup
+void printLeaderboard() {
+    const ScoreTable &table = *scores.table();
+    if (table.sessions == 0) {
+        return;
+    }
+    cout << "Played " << table.sessions << " runs, " << table.totalFrames << " frames. Best:" << endl;
+    for (uint32_t i = 0; i < std::min(table.count, 5u); i++) {
+        const ScoreEntry &entry = table.best[i];
+        cout << "  " << i + 1 << ". " << (double)entry.ticks / std::max(entry.simRate, 1u) << " s (seed " << entry.seed << ")" << endl;
+    }
+}
 
-    glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, value_ptr(model));
-    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-    glBindVertexArray(0);
+// Add the run to the score file, when one is open, and queue it for the online leaderboard
+void recordScore(uint64_t ticks, uint64_t frames, const GameOptions &options) {
+    leaderboard.submit(ticks, (uint32_t)options.simRate, options.seed);
+    int rank = scores.record(ticks, frames, options.seed, (uint32_t)options.simRate);
+    if (rank > 0) {
+        cout << "Survived " << ticks / options.simRate << " s: #" << rank << " on the leaderboard" << endl;
+    }
 }
 
-// Moves spaceship to the specified lane
-void moveSpaceship(int lane) {
-    spaceshipLane = lane;
-    spaceship.position.x = LANE_WIDTH / 2 + lane * LANE_WIDTH;
+// Simulation thread body: ticks at a fixed rate and publishes a snapshot after each tick
+void simulationThread(double simStep) {
+    profiler.nameThread("simulation");
+    configureThread(THREAD_SIMULATION, "simulation");
+    const uint64_t stepTicks = gameClock.ticks(simStep / timeScale); // wall time per tick
+    const uint64_t maxBacklog = gameClock.ticks(MAX_FRAME_TIME);
+    uint64_t nextTick = gameClock.now() + stepTicks;
+    while (!gameOver) {
+        if (paused || windowHidden) {
+            this_thread::sleep_for(chrono::duration<double>(IDLE_WAIT));
+            nextTick = gameClock.now() + stepTicks; // pick up from now on resume
+            continue;
+        }
+        if (maxSpeed) {
+            tickSimulation((float)simStep, gameClock.now()); // no schedule: presses apply on the next tick
+            publishSnapshot();
+            continue;
+        }
+        uint64_t now = gameClock.now();
+        if (now > nextTick + maxBacklog) {
+            nextTick = now; // fell too far behind; drop the backlog
+        }
+        while (nextTick <= now && !gameOver) {
+            tickSimulation((float)simStep, nextTick);
+            publishSnapshot();
+            nextTick += stepTicks;
+        }
+        now = gameClock.now();
+        if (nextTick > now) {
+            this_thread::sleep_for(chrono::duration<double>(gameClock.seconds(nextTick - now)));
+        }
+    }
 }
 
-// Resets comet to a random lane and off-screen position
-void resetComet() {
-    int lane = rand() % 3;
-    comet.position = vec3(LANE_WIDTH / 2 + lane * LANE_WIDTH, HEIGHT + 50, 0);
+// Lane after applying one key press to another lane
+int laneAfter(int lane, int key) {
+    return LANES.step(lane, key == GLFW_KEY_LEFT ? -1 : 1);
 }
 
-// Updates game logic (comet movement, collision detection)
-void updateGame(float deltaTime) {
-    comet.position.y -= 0.3f * deltaTime; // Move comet down
+// Lane the PGO training autopilot steers to this tick: the Monte Carlo bot's choice,
+// made on a copy of the live comets so the trained paths see dodges and near misses
+int autopilotLane(HeadlessGame &pilot, const BotSkill &skill, float deltaTime) {
+    // Each lane up to its first comet not yet behind the ship, all the bot looks at
+    for (int l = 0; l < LANE_COUNT; l++) {
+        const LaneRing<EntityHandle, MAX_COMETS> &ring = cometLanes[l].ring;
+        pilot.comets[l].clear();
+        for (uint32_t k = 0; k < ring.size(); k++) {
+            float y = entities.y[entities.index(ring[k])];
+            pilot.comets[l].push(y);
+            if (y > HeadlessGame::PASSED) {
+                break;
+            }
+        }
+    }
+    pilot.scan(deltaTime);
+    pilot.lane = entities.lane[entities.index(spaceship)];
+    pilot.simTime = simTime;
+    return pilot.press(skill);
+}
+
+// Runs one fixed simulation tick, keeping the previous positions for interpolation.
+// inputUntil is the timer value the tick stands for; presses up to it are applied.
+void tickSimulation(float deltaTime, uint64_t inputUntil) {
+    PROFILE_SCOPE("tickSimulation");
+    entities.storePrevious(entities.archetypeStart[ARCHETYPE_DORMANT]); // sleepers get theirs on anchor ticks
+
+    int lane = entities.lane[entities.index(spaceship)];
+    int target = lane;
+    InputEvent event;
+    while (inputQueue.popUntil(inputUntil, event)) {
+        if (replaying) {
+            continue; // live presses are ignored while a recording drives the ship
+        }
+        if (recordingInput) {
+            recordedInput.record(simTick, event.key); // replays on exactly this tick
+        }
+        if (net.active) {
+            net.pressed(simTick, event.key); // the rival applies it on this tick too
+        }
+        target = laneAfter(target, event.key);
+    }
+    for (; replaying && replayCursor < replay.input.events.size() && replay.input.events[replayCursor].tick <= simTick; replayCursor++) {
+        int key = replay.input.events[replayCursor].key;
+        if (recordingInput) {
+            recordedInput.record(simTick, key);
+        }
+        target = laneAfter(target, key);
+    }
+    if (target != lane) {
+        moveSpaceship(target);
+    }
+    advanceSpaceship(deltaTime);
+    if (net.active) {
+        tickRival(deltaTime);
+    }
 
-    // Check for collision with spaceship
-    if (comet.position.y < spaceship.position.y + spaceship.dimensions.y &&
-        comet.position.y > spaceship.position.y - comet.dimensions.y &&
-        comet.position.x == spaceship.position.x) {
-        gameOver = true;
-        cout << "Game Over!" << endl;
+    updateGame(deltaTime);
+    events.endTick();
+    if (hashingState) {
+        checkStateHash(simTick);
     }
+    simTick++;
+    prevSimTime = simTime;
+    simTime += deltaTime;
+    if (keyframeTicks > 0 && simTick % keyframeTicks == 0) {
+        captureKeyframe();
+    }
+    if (net.active) {
+        syncRace();
+    }
+}
 
-    // Reset comet if it moves off the screen
-    if (comet.position.y < -50) {
-        resetComet();
+// Everything a tick leaves behind that the next one depends on: every entity field
+// in dense order, the ship's glide, the tick and the clock. The spawn generator is
+// left out: the wave stream draws from it ahead of the simulation on its own thread,
+// so its state at a tick is not a function of the tick; the comets it spawned are in.
+uint64_t stateHash() {
+    const EntityPool &e = entities;
+    StateHash hash;
+    for (const LargePageVector<float> *field : {&e.x, &e.y, &e.prevX, &e.prevY, &e.vy, &e.width, &e.height, &e.angle, &e.spin}) {
+        hash.add(field->data(), field->size() * sizeof(float));
     }
-}
\ No newline at end of file
+    hash.add(e.lane.data(), e.lane.size());
+    hash.add(e.material.data(), e.material.size());
+    hash.add(e.handleOf.data(), e.handleOf.size() * sizeof(EntityHandle));
+    hash.add(shipTransition);
+    hash.add(simTick);
+    hash.add(simTime);
+    return hash.value;
+}
+
+// Head of a replay keyframe: what the simulation needs besides the entity pool to
+// carry on from the start of tick. The lanes' rings and the pool's arrays follow.
+// The wave stream is put back by replaying spawnsTaken spawns from the seed, since
+// its generator runs ahead of the tick; wave scripts are coroutines and cannot be
+// captured, so a keyframe taken while they run says so.
+struct SimKeyframe {
+    uint64_t tick, spawnsTaken;
+    double simTime, prevSimTime;
+    LaneTransition shipTransition;
+    uint8_t gameOver, shipWrecked, scripted;
+};
+
+// Add a keyframe of the state before tick simTick to the replay being recorded
+void captureKeyframe() {
+    PROFILE_SCOPE("captureKeyframe");
+    SimKeyframe head{}; // zeroed padding, so equal states give equal bytes
+    head = {simTick, spawnsTaken, simTime, prevSimTime, shipTransition, gameOver, shipWrecked, waveScripts.count > 0};
+    keyframeScratch.clear();
+    EntityPool::append(keyframeScratch, &head, sizeof(head));
+    EntityPool::append(keyframeScratch, cometLanes, sizeof(cometLanes));
+    entities.save(keyframeScratch);
+    recording.addKeyframe(simTick, (uint32_t)recordedInput.events.size(), keyframeScratch.data(), keyframeScratch.size());
+}
+
+// Put the simulation back to a keyframe of the replay: plain copies of its head,
+// the lane rings and the pool's arrays, then the wave stream restarted from the
+// seed and moved on past the spawns already taken. Every part is checked before any
+// is copied, so a keyframe taken while wave scripts ran, or one that does not fit
+// this build's lanes and pool, returns false and changes nothing. Only while no
+// simulation thread is running.
+bool restoreKeyframe(const ReplayKeyframe &keyframe) {
+    const uint8_t *p = replay.keyframeBlob(keyframe), *end = p + keyframe.size;
+    SimKeyframe head;
+    static CometLane lanes[LANE_COUNT]; // too big for the stack with a large MAX_COMETS
+    if (!EntityPool::take(p, end, &head, sizeof(head)) || head.scripted || head.tick != keyframe.tick ||
+        !EntityPool::take(p, end, lanes, sizeof(lanes)) || !entities.fits(p, end, MATERIAL_COUNT)) {
+        return false;
+    }
+    for (const CometLane &lane : lanes) {
+        if (lane.ring.size() > MAX_COMETS) {
+            return false;
+        }
+    }
+    std::copy(std::begin(lanes), std::end(lanes), cometLanes);
+    entities.load(p, end, MATERIAL_COUNT);
+    simTick = head.tick;
+    simTime = head.simTime;
+    prevSimTime = head.prevSimTime;
+    shipTransition = head.shipTransition;
+    gameOver = head.gameOver;
+    shipWrecked = head.shipWrecked;
+    replayCursor = keyframe.event;
+    waveScripts.clear(); // a keyframe without them comes after any the session ran
+
+    waves.stop();
+    spawnRandom.seed(replay.seed, STREAM_SPAWN);
+    level.cursor = 0;
+    WaveSource source;
+    WaveSpawn skipped;
+    for (spawnsTaken = 0; spawnsTaken < head.spawnsTaken && source(skipped); spawnsTaken++) {
+    }
+    waves.start(source);
+
+    // --gpu-motion moves comets from their spawn time, which follows from the height
+    entities.forEachRange(COMPONENT_LIFETIME, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            float speed = -entities.vy[i];
+            float spawnTime = (float)simTime - (settings.spawnY - entities.y[i]) / std::max(speed, 1.0f);
+            cometField.record(entities.handleOf[i], {spawnTime, (float)entities.lane[i], speed, 1.0f});
+        }
+    });
+    return true;
+}
+
+// Jump a replay seconds in before its first frame: restore the last keyframe at or
+// before the target, then run the ticks from there to it headless, as fast as they
+// go, with events muted so no sound or particle fires for a tick nobody saw. The
+// recording's state hashes are checked on the way as on any tick. A keyframe that
+// cannot be restored leaves the replay where it was.
+void seekReplay(double seconds, float simRate) {
+    uint64_t target = std::min<uint64_t>((uint64_t)(seconds * simRate + 0.5), replay.ticks);
+    auto start = std::chrono::steady_clock::now();
+    const ReplayKeyframe *keyframe = replay.keyframeBefore(target);
+    bool restored = keyframe && keyframe->tick > simTick;
+    if (restored && !restoreKeyframe(*keyframe)) {
+        cout << "Seek: keyframe at tick " << keyframe->tick << " is unusable in this build; not seeking" << endl;
+        return;
+    }
+    uint64_t from = simTick;
+    events.muted = true;
+    while (simTick < target && !gameOver) {
+        tickSimulation(1.0f / simRate, 0);
+    }
+    events.muted = false;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    cout << "Seek: " << (restored ? "keyframe at tick " : "no keyframe before it, from tick ") << from << ", caught up "
+         << simTick - from << " ticks to tick " << simTick << " in " << ms << " ms" << endl;
+}
+
+// Record the hash after tick for the replay being saved, and compare it with the one
+// being played back; the first mismatch is the tick the runs diverged on
+void checkStateHash(uint64_t tick) {
+    PROFILE_SCOPE("stateHash");
+    uint32_t hash = StateHash{stateHash()}.folded();
+    if (recordingHashes) {
+        stateHashes.push_back(hash);
+    }
+    if (replaying && tick < replay.hashes.size() && replay.hashes[tick] != hash && desyncTick == UINT64_MAX) {
+        desyncTick = tick;
+        cout << "Desync at tick " << tick << ": state hash " << hex << hash << ", recorded " << replay.hashes[tick] << dec
+             << endl;
+    }
+}
+
+// Moves the rival's ship one tick. Ticks it was predicted through without a press
+// that has since arrived are simulated again first, from its state before the
+// earliest such press.
+void tickRival(float deltaTime) {
+    PROFILE_SCOPE("tickRival");
+    uint64_t late = net.poll();
+    if (late < simTick) {
+        uint64_t from = late;
+        if (late + RIVAL_HISTORY < simTick) {
+            net.desyncs++; // older than the history: the best we can do is the oldest state kept
+            from = simTick - RIVAL_HISTORY;
+            cout << "Rival press for tick " << late << " arrived too late to roll back" << endl;
+        }
+        rivalShip = rivalHistory[from % RIVAL_HISTORY];
+        for (uint64_t tick = from; tick < simTick; tick++) {
+            rivalHistory[tick % RIVAL_HISTORY] = rivalShip;
+            stepRival(rivalShip, tick, deltaTime);
+        }
+        net.rollbacks++;
+        net.rolledBackTicks += simTick - from;
+    }
+    rivalHistory[simTick % RIVAL_HISTORY] = rivalShip;
+    stepRival(rivalShip, simTick, deltaTime);
+
+    if (rivalGone) {
+        return;
+    }
+    if ((net.remoteEnd && simTick + 1 >= net.remoteEnd) || net.timedOut()) {
+        cout << (net.remoteEnd ? "Rival crashed" : "Rival disconnected") << endl;
+        entities.destroy(rival);
+        rivalGone = true;
+        return;
+    }
+    uint32_t i = entities.index(rival);
+    entities.x[i] = rivalShip.x;
+    entities.lane[i] = (int8_t)rivalShip.lane;
+}
+
+// Applies the rival's presses on one tick and advances its glide, exactly as
+// moveSpaceship and advanceSpaceship do for the player's ship on its own cabinet
+void stepRival(RivalShip &ship, uint64_t tick, float deltaTime) {
+    auto press = std::lower_bound(net.inbox.begin(), net.inbox.end(), tick,
+                                  [](const NetSession::Event &e, uint64_t t) { return e.tick < t; });
+    int target = ship.lane;
+    for (; press != net.inbox.end() && press->tick == tick; ++press) {
+        target = laneAfter(target, press->key);
+    }
+    if (target != ship.lane) {
+        ship.lane = target;
+        ship.transition = {ship.x, LANES.center(target), 0.0f};
+    }
+    if (ship.transition.elapsed < settings.laneTransitionTime) {
+        ship.transition.elapsed += deltaTime;
+        ship.x = laneTransitionX(ship.transition.fromX, ship.transition.toX, ship.transition.elapsed, settings.laneTransitionTime);
+    }
+}
+
+// After each tick: hash the state every HASH_INTERVAL ticks, compare the rival's
+// latest hash once its presses up to that tick are in, and send
+void syncRace() {
+    const uint64_t interval = NetSession::HASH_INTERVAL;
+    if (simTick % interval == 0) {
+        uint32_t world = worldHash();
+        worldHashes[(simTick / interval) % WORLD_HASH_HISTORY] = world;
+        uint32_t ship = entities.index(spaceship);
+        net.hashed(simTick, shipHash(world, entities.lane[ship], entities.x[ship]));
+    }
+
+    // The rival hashed its own ship over the comets both cabinets share
+    uint64_t h = net.remoteHashTick;
+    if (h && h != rivalHashChecked && net.remoteThrough >= h && h <= simTick && h + RIVAL_HISTORY > simTick &&
+        h + WORLD_HASH_HISTORY * interval > simTick) {
+        rivalHashChecked = h;
+        const RivalShip &then = h == simTick ? rivalShip : rivalHistory[h % RIVAL_HISTORY];
+        if (shipHash(worldHashes[(h / interval) % WORLD_HASH_HISTORY], then.lane, then.x) != net.remoteHash) {
+            if (net.desyncs++ == 0) {
+                cout << "Desync with the rival at tick " << h << endl;
+            }
+        }
+    }
+
+    net.ticked(simTick);
+    if (gameOver && !net.localEnd) {
+        net.finished(simTick - 1);
+    }
+}
+
+// Order-independent hash of where every comet is
+uint32_t worldHash() {
+    uint32_t hash = 0;
+    entities.forEachRange(COMPONENT_COLLIDER, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            float position[2] = {entities.x[i], entities.y[i]};
+            hash += NetSession::hashBytes(NetSession::HASH_SEED, position, sizeof(position));
+        }
+    });
+    return hash;
+}
+
+uint32_t shipHash(uint32_t world, int lane, float x) {
+    uint32_t hash = NetSession::hashBytes(NetSession::HASH_SEED, &world, sizeof(world));
+    hash = NetSession::hashBytes(hash, &lane, sizeof(lane));
+    return NetSession::hashBytes(hash, &x, sizeof(x));
+}
+
+// Who lasted longer, once the rival's side is known or has had a moment to arrive
+void reportRace() {
+    uint64_t ended = net.localEnd ? net.localEnd - 1 : simTick;
+    net.settle(ended, 1.0);
+    if (!net.localEnd) {
+        cout << "Race: left at tick " << ended << endl;
+    } else if (net.remoteEnd) {
+        uint64_t rivalEnded = net.remoteEnd - 1;
+        cout << "Race: " << (rivalEnded < ended ? "won" : rivalEnded > ended ? "lost" : "draw") << " (crashed at tick "
+             << ended << ", rival at " << rivalEnded << ")" << endl;
+    } else if (net.remoteThrough > ended) {
+        cout << "Race: lost (crashed at tick " << ended << ", rival still flying at " << net.remoteThrough << ")" << endl;
+    } else {
+        cout << "Race: no result from the rival" << endl;
+    }
+    net.print();
+}
+
+// Hands the current entity state to the renderer
+void publishSnapshot() {
+    PROFILE_SCOPE("publishSnapshot");
+    snapshots.writeSlot().capture(entities, entities.index(spaceship), gameClock.now(), simTick, simTime, prevSimTime);
+    snapshots.publish();
+}
+
+// Clears the target and draws every sprite of a snapshot at the given interpolation factor
+void renderScene(const RenderSnapshot &snap, float alpha) {
+    GPU_ZONE("renderScene");
+    frameArena.beginFrame(); // Draw lists and batch staging of FRAMES - 1 frames ago are done with
+    view.setClock(mix(snap.prevSimTime, snap.simTime, (double)alpha), framesRendered++); // Shared by every program
+
+    // Record every visible entity; far comets of a dense field go to the impostor
+    uint32_t culled = 0;
+    uint32_t shipInstance = recordScene(snap, alpha, culled);
+    spriteBatch.begin();
+    if (impostors.enabled) {
+        // Into the impostor texture at low resolution, then one quad in the comet layer
+        GPU_ZONE("impostors");
+        impostors.draw(spriteBatch, view, sceneFramebuffer, drawList, DrawList::sortLayer(LAYER_COMETS, false),
+                       layerDepth(LAYER_COMETS));
+        impostors.settle();
+    }
+    {
+        PROFILE_SCOPE("sortDrawList");
+        drawList.sort();
+    }
+
+    dynamicRes.begin(view); // Scaled offscreen target, when enabled
+    GLuint target = dynamicRes.enabled ? dynamicRes.fbo : sceneFramebuffer;
+    vec4 region = dynamicRes.enabled ? vec4(0, 0, dynamicRes.scaledWidth(), dynamicRes.scaledHeight())
+                                     : vec4(view.x, view.y, view.width, view.height);
+    bloom.begin(view, region); // Float scene buffer, composited back into the target
+    if (msaa.enabled) {
+        msaa.begin(view, bloom.enabled ? bloom.fbo : target, bloom.enabled ? vec4(0, 0, region.z, region.w) : region);
+    }
+    overdraw.begin(view, target, region); // Counts every fragment from here to its resolve
+    renderBackend.beginFrame(); // Clear screen
+
+    beginViews(); // Split-screen: everything up to the post passes reaches each view
+    view.eachView([] {
+        {
+            GPU_ZONE("starfield");
+            starfieldShader.use();
+            starfield.draw(); // Stars behind everything
+        }
+        GPU_ZONE("particles");
+        particleShader.use();
+        particles.draw(materials[MATERIAL_SPACESHIP].texID, materials[MATERIAL_SPACESHIP].sampler); // Trails, explosions and debris go under the sprites
+    });
+
+    latchShip(snap, drawList.instances[shipInstance]); // Newest input, right before the upload
+    if (shipWrecked) {
+        drawList.instances[shipInstance].placement.z = drawList.instances[shipInstance].placement.w = 0.0f;
+    }
+
+    // Depth-tested sprites: opaque layers front to back, so early-Z skips what they
+    // cover, then translucent layers back to front, blended over the stars
+    glState.enable(GL_DEPTH_TEST);
+    drawSpriteViews([] {
+        GPU_ZONE("sprites");
+        spriteBatch.submit(drawList); // One instanced draw per run of equal state
+    });
+
+    if (cometField.enabled) {
+        cometField.upload(); // Only slots that spawned or despawned since the last frame
+        cometField.cullVisible(); // Survivors and their count stay on the GPU
+        const Material &comet = materials[MATERIAL_COMET];
+        view.eachView([&comet] {
+            GPU_ZONE("comets");
+            renderBackend.bindPipeline(cometPipeline);
+            cometField.draw(comet.texID, comet.sampler, comet.target());
+        });
+        glState.depthMask(GL_TRUE); // what the sprite batch expects to find
+    }
+    glState.disable(GL_DEPTH_TEST); // the overlay is drawn over everything
+    endViews();
+
+    // From the buffer the scene was drawn into to the window, each pass timed
+    renderGraph.reset();
+    int targetId = renderGraph.import(dynamicRes.enabled ? "dynamic resolution" : "scene target", target);
+    int sceneId = bloom.enabled ? bloom.importScene(renderGraph) : targetId;
+    if (msaa.enabled) {
+        int msaaId = renderGraph.import("msaa", msaa.fbo);
+        renderGraph.pass("msaa resolve", {msaaId}, {sceneId}, [](RenderGraph &) {
+            frameStats.beginResolve();
+            msaa.resolve(view); // Into the target the scene would have been drawn to
+            frameStats.endResolve();
+        });
+    }
+    if (overdraw.enabled) {
+        int overdrawId = renderGraph.import("overdraw", overdraw.fbo);
+        renderGraph.pass("overdraw ramp", {overdrawId}, {sceneId}, [](RenderGraph &) {
+            overdraw.resolve(view); // The counts, coloured, where the scene would have gone
+        });
+    }
+    if (bloom.enabled) {
+        bloom.addPasses(renderGraph, targetId); // Bright pass, blurs and composite
+    }
+    if (dynamicRes.enabled) {
+        int windowId = renderGraph.import("window", sceneFramebuffer);
+        renderGraph.pass("upscale", {targetId}, {windowId}, [](RenderGraph &) {
+            dynamicRes.end(view); // Into the window; the overlay stays at native resolution
+        });
+    }
+    renderGraph.compile();
+    renderGraph.execute();
+    beginViews(); // each view gets its own HUD and overlay
+    if (hud.enabled) {
+        updateHud(snap);
+        drawSpriteViews([] {
+            GPU_ZONE("hud");
+            hud.draw(spriteBatch); // Part of the game's picture: captured, unlike the overlay
+        });
+    }
+    if (ui.buffer) {
+        updateScreens(snap);
+        drawSpriteViews([] {
+            GPU_ZONE("ui");
+            ui.draw(spriteBatch); // Uploads only what changed since the last frame
+        });
+    }
+    capture.endFrame(sceneFramebuffer, vec4(view.x, view.y, view.width, view.height)); // Scene only, no overlay
+
+    int draws = spriteBatch.drawCalls + 3 + (cometField.enabled ? 1 : 0) + bloom.passes + // + starfield, particle update and draw, comets
+                (overdraw.enabled ? OverdrawView::LEVELS : 0);
+    counters.add(COUNTER_DRAWS, draws);
+
+    // Performance overlay on top of everything, as one more batched draw
+    if (overlay.visible) {
+        OverlayStats stats;
+        stats.cpuMs = frameStats.latest.cpuTotal;
+        stats.gpuMs = frameStats.latest.gpu;
+        stats.budgetMs = frameStats.budgetMs;
+        stats.drawCalls = draws;
+        stats.glCounted = glCalls.enabled;
+        stats.glCalls = glCalls.last.calls;
+        stats.glRedundant = glCalls.last.redundant;
+        stats.stateIssued = glState.last.issued;
+        stats.stateSkipped = glState.last.skipped;
+        stats.glPerfLogged = glDebugLog.enabled;
+        stats.glPerfWarnings = glDebugLog.lastFrameWarnings;
+        stats.glPerfTotal = glDebugLog.warnings;
+        if (glDebugLog.lastZone) {
+            stats.glPerfZone = glDebugLog.lastZone;
+            stats.glPerfLast = glDebugLog.last;
+        }
+        stats.entities = snap.size();
+        stats.culled = culled;
+        stats.overdrawShown = overdraw.enabled;
+        stats.overdrawAverage = overdraw.average;
+        stats.overdrawMax = overdraw.maximum;
+        drawSpriteViews([&stats] {
+            GPU_ZONE("overlay");
+            overlay.draw(spriteBatch, stats);
+        });
+    }
+    endViews();
+    glState.disable(GL_BLEND);
+    glNames.flush(); // the frame's deletes so far, one call per kind, while the context is still here
+}
+
+// Split-screen views on and off, with the sprite batch's copies per instance to match
+void beginViews() {
+    view.beginViews();
+    spriteBatch.views = view.instancedViews();
+}
+
+void endViews() {
+    view.endViews();
+    spriteBatch.views = 1;
+}
+
+// Sprites reach every view in one pass where the VIEWS variants route their copies,
+// and are drawn once per view otherwise
+template <typename Draw>
+void drawSpriteViews(Draw draw) {
+    if (spriteBatch.views > 1) {
+        draw();
+    } else {
+        view.eachView(draw);
+    }
+}
+
+// Emits a trail burst behind every comet of the snapshot and the ship's exhaust (until
+// the game is over) and advances all particles on the GPU. Comets beyond the burst table wait for the next frame.
+void updateEffects(const RenderSnapshot &snap, float alpha, float frameTime) {
+    PROFILE_SCOPE("updateEffects");
+    trailBudget += TRAIL_RATE * frameTime;
+    uint32_t count = (uint32_t)trailBudget;
+    trailBudget -= count;
+    if (count > 0 && !gameOver && snap.size() > 0) {
+        uint32_t k = 0;
+        for (; k < snap.size(); k++) {
+            uint32_t i = (trailCursor + k) % snap.size();
+            if (snap.material[i] != MATERIAL_COMET) {
+                continue;
+            }
+            float x = mix(snap.prevX[i], snap.x[i], alpha);
+            float y = mix(snap.prevY[i], snap.y[i], alpha) + snap.height[i] * 0.3f;
+            if (!particles.emit(x, y, count, TRAIL_SPEED, TRAIL_LIFETIME, PARTICLE_TRAIL)) {
+                break;
+            }
+        }
+        trailCursor += k;
+    }
+
+    // Exhaust from the thruster under the ship. The ship's node takes its interpolated
+    // placement, so the thruster's is recomputed only on frames the ship moved.
+    if (snap.size() > 0) {
+        uint32_t ship = snap.ship;
+        attachments.setLocal(shipNode, {vec2(mix(snap.prevX[ship], snap.x[ship], alpha), mix(snap.prevY[ship], snap.y[ship], alpha)),
+                                        snap.angle[ship], 1.0f});
+    }
+    attachments.update();
+    thrusterBudget += THRUSTER_RATE * frameTime;
+    uint32_t puffs = (uint32_t)thrusterBudget;
+    thrusterBudget -= puffs;
+    if (puffs > 0 && !gameOver && !shipWrecked) {
+        Transform2D thruster = attachments.world(thrusterNode);
+        particles.emit(thruster.position.x, thruster.position.y, puffs, THRUSTER_SPEED, THRUSTER_LIFETIME, PARTICLE_TRAIL);
+    }
+    particles.update(frameTime);
+}
+
+// Synthesizes the sound effects into the mixer: a swish as long as the lane glide and
+// a rumbling blast as long as the explosion. Both are made up front, so the mixer
+// thread only ever reads finished samples.
+void loadSounds() {
+    const float RATE = (float)AudioMixer::RATE, TWO_PI = 6.2831853f;
+    Pcg32 noise(1, 0);
+
+    // Band of noise sweeping up in pitch, faded in and out
+    SoundClip swish;
+    swish.samples.resize((size_t)(settings.laneTransitionTime * 2.0f * RATE));
+    float low = 0.0f, band = 0.0f;
+    for (size_t i = 0; i < swish.samples.size(); i++) {
+        float t = (float)i / swish.samples.size();
+        float cutoff = 0.05f + 0.25f * t; // one-pole low pass rising through the sweep
+        low += cutoff * (noise.nextFloat() * 2.0f - 1.0f - low);
+        band += cutoff * (low - band);
+        swish.samples[i] = (low - band) * sin(3.14159265f * t) * 2.5f;
+    }
+    laneSound = audio.addClip(move(swish));
+
+    // Low-passed noise and a falling thump, decaying over the explosion
+    SoundClip blast;
+    blast.samples.resize((size_t)(EXPLOSION_LIFETIME * RATE));
+    float rumble = 0.0f, phase = 0.0f;
+    for (size_t i = 0; i < blast.samples.size(); i++) {
+        float seconds = i / RATE;
+        rumble += 0.08f * (noise.nextFloat() * 2.0f - 1.0f - rumble);
+        phase += TWO_PI * (40.0f + 80.0f * exp(-seconds * 8.0f)) / RATE;
+        float thump = sin(phase) * exp(-seconds * 5.0f);
+        blast.samples[i] = (rumble * 2.0f * exp(-seconds * 3.0f) + thump * 0.6f) * std::min(seconds * 400.0f, 1.0f);
+    }
+    explosionSound = audio.addClip(move(blast));
+}
+
+// Formats the HUD's lines for the snapshot; labels rebuild only the glyphs that changed
+void updateHud(const RenderSnapshot &snap) {
+    char line[TextLabel::MAX_CHARS + 1];
+    unsigned long long ticks = snap.tick - hud.firstTick;
+    snprintf(line, sizeof(line), "SCORE %llu", ticks);
+    hud.score.set(line);
+    snprintf(line, sizeof(line), "TIME %.1f", snap.simTime);
+    hud.time.set(line);
+    const ScoreTable *table = scores.table();
+    unsigned long long best = table && table->count > 0 ? std::max<unsigned long long>(table->best[0].ticks, ticks) : ticks;
+    snprintf(line, sizeof(line), "BEST %llu", best);
+    hud.best.set(line);
+}
+
+// Pause screen, and game over with the run's time and the leaderboard, centred on
+// the playfield; hidden until updateScreens shows them
+void setupScreens(GLuint panelSampler, ShaderProgram *textProgram, GLuint fontTexture, GLuint fontSampler, bool sdf) {
+    const float scale = 2.0f, line = (PerfOverlay::CELL + 4) * scale;
+    ui.setup(spriteShaders.find(spriteBaseFeatures()), overlay.texture, panelSampler, textProgram, fontTexture, fontSampler, sdf);
+
+    screens.pause = ui.panel(-1, vec2(WIDTH / 2 - 100.0f, HEIGHT / 2 - 30.0f), vec2(200.0f, 60.0f), PerfOverlay::SWATCH_PANEL);
+    ui.text(screens.pause, vec2(100.0f - 3 * PerfOverlay::GLYPH_WIDTH * scale, 30.0f - PerfOverlay::CELL * scale / 2), scale, "PAUSED");
+    ui.setVisible(screens.pause, false);
+
+    float width = 320.0f, height = 3 * line + 5 * line + 2 * line + 28.0f;
+    screens.gameOver = ui.panel(-1, vec2(WIDTH / 2 - width / 2, HEIGHT / 2 - height / 2), vec2(width, height), PerfOverlay::SWATCH_PANEL);
+    ui.text(screens.gameOver, vec2(16.0f, 12.0f), scale * 1.5f, "GAME OVER");
+    screens.score = ui.text(screens.gameOver, vec2(16.0f, 12.0f + 1.5f * line), scale);
+    int leaders = ui.panel(screens.gameOver, vec2(16.0f, 12.0f + 3 * line), vec2(width - 32.0f, 5 * line), PerfOverlay::SWATCH_PANEL);
+    for (int i = 0; i < 5; i++) {
+        screens.leaders[i] = ui.text(leaders, vec2(8.0f, 4.0f + i * line), scale);
+    }
+    screens.online = ui.text(screens.gameOver, vec2(16.0f, 16.0f + 8 * line), scale);
+    screens.restart = ui.text(screens.gameOver, vec2(16.0f, 16.0f + 9 * line), scale); // set by runGame when it can restart
+    ui.setVisible(screens.gameOver, false);
+}
+
+// Show the screen for the game's state and refresh its text; nodes whose text
+// comes out the same are left alone, so a screen that sits still uploads nothing
+void updateScreens(const RenderSnapshot &snap) {
+    ui.setVisible(screens.pause, paused && !gameOver);
+    ui.setVisible(screens.gameOver, gameOver);
+    if (!gameOver) {
+        return;
+    }
+    char line[UiTree::MAX_TEXT + 1];
+    snprintf(line, sizeof(line), "SURVIVED %.1f S", snap.simTime);
+    ui.setText(screens.score, line);
+    const ScoreTable *table = scores.table();
+    for (uint32_t i = 0; i < 5; i++) {
+        if (table && i < table->count) {
+            const ScoreEntry &entry = table->best[i];
+            snprintf(line, sizeof(line), "%u. %.1f S", i + 1, (double)entry.ticks / std::max(entry.simRate, 1u));
+        } else {
+            line[0] = 0;
+        }
+        ui.setText(screens.leaders[i], line);
+    }
+    const LeaderboardResult &online = leaderboard.latest;
+    if (!leaderboard.enabled) {
+        line[0] = 0;
+    } else if (!leaderboard.received) {
+        snprintf(line, sizeof(line), "ONLINE: CONNECTING");
+    } else if (!online.ok) {
+        snprintf(line, sizeof(line), "ONLINE: UNAVAILABLE");
+    } else if (leaderboard.sending > 0) {
+        snprintf(line, sizeof(line), "ONLINE: SENDING");
+    } else if (online.rank > 0) {
+        snprintf(line, sizeof(line), "ONLINE #%u OF %u", online.rank, online.total);
+    } else if (online.count > 0) {
+        snprintf(line, sizeof(line), "ONLINE BEST %.1f S", (double)online.top[0].ticks / std::max(online.top[0].simRate, 1u));
+    } else {
+        snprintf(line, sizeof(line), "ONLINE: NO RUNS YET");
+    }
+    ui.setText(screens.online, line);
+}
+
+// Hooks audio, particles, telemetry and the overlay up to the gameplay events
+void subscribeEvents(const GameOptions &options) {
+    // A swish panned towards the lane the ship heads for, and the blast when it explodes
+    events.subscribe(EVENT_LANE_CHANGE, [](const GameEvent &event) {
+        float pan = LANES.MIDDLE > 0 ? (float)(event.lane - LANES.MIDDLE) / LANES.MIDDLE : 0.0f;
+        audio.play(laneSound, 0.5f, pan * 0.7f);
+    });
+    events.subscribe(EVENT_GAME_OVER, [](const GameEvent &) { audio.play(explosionSound); });
+    if (options.render) {
+        // The explosion and the ship's debris, where the ship was on the tick it was hit
+        events.subscribe(EVENT_GAME_OVER, [](const GameEvent &event) {
+            particles.emit(event.x, event.y, EXPLOSION_PARTICLES, EXPLOSION_SPEED, EXPLOSION_LIFETIME, PARTICLE_EXPLOSION);
+            particles.emit(event.x, event.y, DEBRIS_PARTICLES, DEBRIS_SPEED, EXPLOSION_LIFETIME, PARTICLE_DEBRIS);
+        });
+    }
+    events.subscribe(EVENT_COLLISION, [](const GameEvent &event) {
+        counters.add(COUNTER_COLLISIONS);
+        telemetry.event(TELEMETRY_COLLISION, event.tick);
+    });
+    events.subscribe(EVENT_SPAWN, [](const GameEvent &) { counters.add(COUNTER_SPAWNS); });
+    events.subscribe(EVENT_LANE_CHANGE, [](const GameEvent &) { counters.add(COUNTER_LANE_CHANGES); });
+}
+
+// Points the materials, the draw list's texture table and the comet shader at the atlas
+void applyAtlas() {
+    GLuint sampler = samplers.get(atlas.samplerState());
+    materials[MATERIAL_SPACESHIP].texID = atlas.texID;
+    materials[MATERIAL_SPACESHIP].texRect = atlas.region("spaceship");
+    if (!materials[MATERIAL_COMET].layered) {
+        materials[MATERIAL_COMET].texID = atlas.texID;
+        materials[MATERIAL_COMET].texRect = atlas.region("asteroid");
+    }
+    materials[MATERIAL_RIVAL].texID = atlas.texID;
+    materials[MATERIAL_RIVAL].texRect = atlas.region("spaceship");
+    buildCollisionMasks();
+    for (Material &mat : materials) {
+        if (!mat.layered) {
+            mat.sampler = sampler;
+        }
+        DrawList::TextureBinding &binding = drawList.textures[mat.textureKey];
+        binding.texture = mat.texID;
+        binding.sampler = mat.sampler;
+    }
+    applyOutlines();
+    particleShader.use();
+    particleShader.set(particleShader.find("debrisRect"),
+                       collisionMasks[MATERIAL_SPACESHIP].opaqueBounds(materials[MATERIAL_SPACESHIP].texRect));
+    if (cometField.enabled) {
+        cometShader.use();
+        cometShader.set(cometShader.find("texRect"), materials[MATERIAL_COMET].texRect);
+        cometShader.set(cometShader.find("animation"), materials[MATERIAL_COMET].flipbook.instance());
+        if (materials[MATERIAL_COMET].layered) {
+            cometShader.set(cometShader.find("layers"), (float)asteroids.layers);
+        }
+    }
+    refreshSpriteTemplates();
+}
+
+// Rebuild every material's SpriteTemplate after its region, keys or flipbook changed
+void refreshSpriteTemplates() {
+    for (int m = 0; m < MATERIAL_COUNT; m++) {
+        const Material &mat = materials[m];
+        SpriteTemplate &t = spriteTemplates[m];
+        t.keyBase = DrawList::makeKey(DrawList::sortLayer(mat.layer, mat.opaque || mat.cutout), mat.shaderKey, mat.textureKey, 0);
+        t.edgeKeyBase = mat.cutout ? DrawList::makeKey(DrawList::sortLayer(mat.layer, false), mat.edgeShaderKey, mat.textureKey, 0) : 0;
+        t.instance = makeSpriteInstance(vec2(0.0f), vec2(0.0f), 0.0f, mat.texRect, layerDepth(mat.layer), mat.flipbook.instance());
+        t.flipbook = mat.flipbook;
+        t.layered = mat.layered;
+    }
+}
+
+// Uploads each material's outline into its GeometryCache slot and points its texture
+// binding, and the comet field, at it; a material without one keeps the quad
+void applyOutlines() {
+    if (!spriteOutlines) {
+        return;
+    }
+    for (int m = 0; m < MATERIAL_COUNT; m++) {
+        const SpriteOutline &outline = materials[m].layered ? asteroids.outline : outlines[m];
+        GLsizei vertices = geometryCache.setOutline(m, outline);
+        drawList.textures[materials[m].textureKey].vertexCount = vertices;
+        if (m == MATERIAL_COMET && cometField.enabled) {
+            cometField.firstVertex = GeometryCache::outlineFirst(m); // holds the quad when there is no outline
+            cometField.vertexCount = vertices;
+        }
+    }
+}
+
+// Rebuilds the collision masks and sprite outlines from the alpha the atlas kept, at
+// the size each material's entities are created with, then drops that alpha. Animated
+// sprites collide with the first frame of their sheet, and are outlined around all of
+// them.
+void buildCollisionMasks() {
+    if (atlas.alpha.empty()) {
+        return; // the masks already match this atlas, or it has no alpha to give
+    }
+    const float SIZE[MATERIAL_COUNT] = {settings.shipSize, settings.cometSize, settings.shipSize};
+    for (int m = 0; m < MATERIAL_COUNT; m++) {
+        if (materials[m].layered) {
+            continue; // collides with AsteroidVariants' masks
+        }
+        const Flipbook &book = materials[m].flipbook;
+        float rows = ceil(book.frames / book.columns);
+        vec4 frame(materials[m].texRect.x, materials[m].texRect.y, materials[m].texRect.z / book.columns,
+                   materials[m].texRect.w / rows);
+        collisionMasks[m] = atlas.alphaMask(frame, (int)SIZE[m], (int)SIZE[m]);
+        outlines[m] = SpriteOutline();
+        for (int f = 0; f < (int)book.frames; f++) {
+            int column = f % (int)book.columns, row = f / (int)book.columns;
+            atlas.addOutline(vec4(frame.x + column * frame.z, frame.y + row * frame.w, frame.z, frame.w), outlines[m]);
+        }
+        outlines[m].finish();
+    }
+    vector<unsigned char>().swap(atlas.alpha);
+}
+
+// Whether an entity of this size can be tested against the mask pixel for pixel
+bool fitsMask(const AlphaMask &mask, float width, float height) {
+    return !mask.empty() && mask.width == (int)lround(width) && mask.height == (int)lround(height);
+}
+
+// Packs the atlas on the loader thread; pollTextures() swaps it in when it is uploaded
+void requestAtlas() {
+    if (atlasLoad >= 0) {
+        atlasStale = true; // one pack at a time; repack once this one lands
+        return;
+    }
+    atlasLoad = textureLoader.request([](vector<unsigned char> &pixels, int &width, int &height) {
+        startupTrace.nameThread("texture loader");
+        TraceScope trace("pack atlas");
+        if (!(atlasFromPack ? pendingAtlas.compose(assetPack, pixels) : pendingAtlas.compose(textureDir, pixels))) {
+            return false;
+        }
+        width = pendingAtlas.width;
+        height = pendingAtlas.height;
+        return true;
+    });
+}
+
+// Checks watched files, advances the background atlas upload and swaps it in once complete
+void pollTextures() {
+    GPU_ZONE("pollTextures");
+    assets.pollChanges();
+    streamTextures();
+    if (atlasLoad < 0) {
+        return;
+    }
+    textureLoader.update();
+    if (textureLoader.ready(atlasLoad)) {
+        if (atlasStream >= 0) {
+            textureStreamer.release(atlasStream); // a hot reload replaces the bake with the PNGs
+            atlasStream = -1;
+            atlas.texID = 0;
+        }
+        if (atlas.texID) {
+            atlas.release(); // replaced by a hot reload
+        }
+        atlas.texID = textureLoader.texture(atlasLoad); // the atlas owns it from here
+        atlas.width = pendingAtlas.width;
+        atlas.height = pendingAtlas.height;
+        atlas.levels = 1; // streamed uploads carry level 0 only
+        atlas.regions = pendingAtlas.regions;
+        atlas.alpha = move(pendingAtlas.alpha);
+        applyAtlas();
+        atlasLoad = -1;
+        if (atlasStale) {
+            atlasStale = false;
+            requestAtlas();
+        }
+    } else if (textureLoader.failed(atlasLoad)) {
+        cout << "Failed to load textures from " << (atlasFromPack ? "the asset pack" : textureDir) << endl;
+        atlasLoad = -1;
+    }
+}
+
+// Hands the baked atlas to the streamer instead of uploading it whole: the embedded
+// (or packed) one if given, else the bake in textureDir if it is current. Takes its regions and
+// alpha now; the texture follows in streamTextures().
+bool streamAtlas(const EmbeddedAsset *embedded) {
+    string baked = textureDir + "/" + TextureAtlas::BAKED_ATLAS;
+    atlasStream = embedded ? textureStreamer.addMemory(embedded->data, embedded->size, TextureAtlas::BAKED_ATLAS)
+                  : TextureAtlas::bakeIsCurrent(textureDir, baked) ? textureStreamer.add(baked)
+                                                                   : -1;
+    if (atlasStream >= 0 && !atlas.describe(textureStreamer.baked(atlasStream))) {
+        textureStreamer.release(atlasStream);
+        atlasStream = -1;
+    }
+    return atlasStream >= 0;
+}
+
+// Marks the streamed atlas used this frame, lets the streamer refine or evict, and
+// repoints the materials whenever that replaced the atlas texture
+void streamTextures() {
+    if (atlasStream < 0) {
+        return;
+    }
+    textureStreamer.use(atlasStream);
+    textureStreamer.update();
+    GLuint texture = textureStreamer.texture(atlasStream);
+    if (texture != atlas.texID) {
+        atlas.texID = texture;
+        atlas.levels = textureStreamer.levels(atlasStream);
+        applyAtlas();
+    }
+}
+
+// Creates the window and its context: a 4.0+ core profile, without error checking
+// in release builds or as a debug context with --gl-debug. If the driver turns those
+// hints down, falls back to its default context, which the renderer also runs on.
+GLFWwindow *createGameWindow(const GameOptions &options) {
+    auto baseHints = [&] {
+        glfwDefaultWindowHints();
+        if (options.bench) {
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE); // Benchmark renders offscreen
+        }
+        glfwWindowHint(GLFW_SCALE_TO_MONITOR, GLFW_TRUE); // Size the window in screen units on hi-DPI monitors
+        glfwWindowHint(GLFW_DEPTH_BITS, 24); // Sprite layers are depth tested
+        display.hint();
+    };
+    baseHints();
+    bool configured = options.glCore || options.glDebug || options.glNoError;
+    if (options.glCore) {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4); // the driver's newest compatible version, at least 4.0
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 0);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GLFW_TRUE);
+    }
+    if (options.glDebug) {
+        glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE);
+    } else if (options.glNoError && !options.glErrors && !options.glPerfLog) {
+        glfwWindowHint(GLFW_CONTEXT_NO_ERROR, GLFW_TRUE); // --gl-errors needs glGetError to mean something, --gl-perf-log debug output
+    }
+    GLFWwindow *window = display.create(WIDTH, HEIGHT, "Space Travel");
+    if (!window && configured) {
+        cout << "The requested GL context is unavailable; using the driver's default" << endl;
+        baseHints();
+        window = display.create(WIDTH, HEIGHT, "Space Travel");
+    }
+    return window;
+}
+
+// Loading screen: a bar of finished shader programs and atlas, drawn with scissored
+// clears so it needs no program of its own. Presents at most every
+// LOADING_FRAME_INTERVAL and handles window events, so the window answers (and can
+// be closed) while assets load; the first call's swap is the launch's first pixels.
+void presentLoadingFrame(GLFWwindow *window) {
+    double now = glfwGetTime();
+    if (loadingFrameTime >= 0.0 && now - loadingFrameTime < LOADING_FRAME_INTERVAL) {
+        return;
+    }
+    bool first = loadingFrameTime < 0.0;
+    loadingFrameTime = now;
+    size_t done = atlasLoad < 0 ? 1 : 0;
+    for (const ShaderBuilder::Build &b : shaderBuilder.builds) {
+        done += b.state == ShaderBuilder::READY || b.state == ShaderBuilder::FAILED;
+    }
+    float progress = (float)done / (shaderBuilder.builds.size() + 1);
+
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    int barWidth = width / 2, barHeight = std::max(height / 60, 2);
+    int barX = (width - barWidth) / 2, barY = height / 3;
+    glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, width, height);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glState.enable(GL_SCISSOR_TEST);
+    glScissor(barX, barY, barWidth, barHeight);
+    glClearColor(0.15f, 0.15f, 0.2f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glScissor(barX, barY, (int)(barWidth * progress), barHeight);
+    glClearColor(0.85f, 0.85f, 0.9f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClearColor(0.0f, 0.0f, 0.0f, 0.0f); // GL's default, which the game's clears rely on
+    glState.disable(GL_SCISSOR_TEST);
+    glfwSwapBuffers(window);
+    glfwPollEvents();
+    if (first) {
+        startupTrace.instant("first pixels");
+    }
+}
+
+// The hang report's view of the game: its clock, the last frame's timings and every
+// entity of the snapshot the renderer last drew, which a stalled render thread
+// leaves alone. Runs on the hang detector's thread.
+void dumpGameState(FILE *out) {
+    const RenderSnapshot &snap = snapshots.readSlot();
+    fprintf(out, "tick %llu, %.3f s simulated, game over %d, paused %d\n", simTick, simTime, (int)gameOver.load(),
+            (int)paused.load());
+    const FrameRecord &f = frameStats.latest;
+    fprintf(out, "last frame %llu: cpu %.2f ms, gpu %.2f ms\n", f.frame, f.cpuTotal, f.gpu);
+    fprintf(out, "snapshot of tick %llu, ship in lane %d, %zu entities\n", snap.tick, snap.shipLane, snap.size());
+    for (size_t i = 0; i < snap.size(); i++) {
+        fprintf(out, "  %4zu material %u at %.1f, %.1f size %.0f x %.0f\n", i, snap.material[i], snap.x[i], snap.y[i],
+                snap.width[i], snap.height[i]);
+    }
+}
+
+// Copies the stats layer into the metrics server's next snapshot; a few hundred
+// stores and the histogram walks, once per MetricsServer::PUBLISH_INTERVAL
+void publishMetrics() {
+    MetricsSnapshot &m = metrics.writeSlot();
+    MetricsServer::fill(m, frameStats);
+    m.hitches = hitchFrames;
+    m.hitchesLogged = hitchLog.hitches;
+    m.entities = snapshots.readSlot().size();
+    m.glWarnings = glDebugLog.warnings;
+    m.drawCalls = spriteBatch.drawCalls;
+    metrics.publish();
+}
+
+// Drivers finish compiling a program, or recompile it, at its first draw under a
+// given blend, depth and target format, which mid-game is a hitch: the first
+// explosion, the first translucent run of a material, the overlay's first frame.
+// So every sprite variant is drawn once opaque and once blended, with the depth
+// test on and off, into the scene's target and the window, along with the
+// starfield, particle and comet programs; then one whole frame of the starting
+// scene goes through bloom, MSAA resolve and upscaling without being presented.
+// glFinish() keeps the driver's work in the loading screen; the next frame clears
+// whatever was drawn.
+void warmPipelines() {
+    GPU_ZONE("warmPipelines");
+    TraceScope trace("warm pipelines");
+    double start = glfwGetTime();
+    frameArena.beginFrame();
+    spriteBatch.begin();
+    drawList.clear();
+    int draws = 0;
+    for (auto &variant : spriteShaders.programs) {
+        uint32_t features = variant.first;
+        const Material &mat = materials[features & FEATURE_ARRAY ? MATERIAL_COMET : MATERIAL_SPACESHIP];
+        uint16_t texture = mat.textureKey;
+        if (features & FEATURE_SDF) {
+            texture = drawList.texture(sdfFont.texture ? sdfFont.texture : mat.texID, mat.sampler);
+        }
+        if (variant.second.bindless && !drawList.textures[texture].texture) {
+            continue; // no handle to read
+        }
+        SpriteInstance instance = spriteTemplates[MATERIAL_SPACESHIP].instance;
+        instance.placement = vec4(WIDTH / 2.0f, HEIGHT / 2.0f, 8.0f, 8.0f);
+        for (bool opaque : {true, false}) {
+            drawList.add(DrawList::makeKey(DrawList::sortLayer(LAYER_SHIP, opaque), drawList.shader(&variant.second), texture, 0),
+                         instance);
+        }
+    }
+    drawList.sort();
+    GLuint sceneTarget = msaa.enabled ? msaa.fbo : bloom.enabled ? bloom.fbo : dynamicRes.enabled ? dynamicRes.fbo : sceneFramebuffer;
+    for (GLuint target : {sceneTarget, sceneFramebuffer}) {
+        glState.bindFramebuffer(GL_FRAMEBUFFER, target);
+        glViewport(0, 0, 16, 16);
+        renderBackend.beginFrame();
+        starfieldShader.use();
+        starfield.draw();
+        particleShader.use();
+        particles.draw(materials[MATERIAL_SPACESHIP].texID, materials[MATERIAL_SPACESHIP].sampler);
+        draws += 2;
+        if (cometField.enabled) {
+            const Material &comet = materials[MATERIAL_COMET];
+            if (cometField.cull != CometField::CULL_NONE) {
+                cometField.cullVisible();
+                renderBackend.bindPipeline(cometPipeline);
+                cometField.draw(comet.texID, comet.sampler, comet.target());
+            } else {
+                renderBackend.bindPipeline(cometPipeline);
+                renderBackend.draw(cometField.VAO, comet.texID, comet.sampler, comet.target(), cometField.firstVertex,
+                                   cometField.vertexCount, 1);
+            }
+            glState.depthMask(GL_TRUE);
+            draws++;
+        }
+        for (bool depthTest : {true, false}) {
+            glState.set(GL_DEPTH_TEST, depthTest);
+            spriteBatch.submit(drawList);
+            draws += spriteBatch.drawCalls;
+        }
+    }
+    glState.disable(GL_BLEND);
+    drawList.clear();
+    view.apply();
+
+    publishSnapshot();
+    snapshots.acquire();
+    renderScene(snapshots.readSlot(), 1.0f);
+    renderBackend.endFrame();
+    glFinish();
+    cout << "Warmed " << spriteShaders.programs.size() << " sprite variants in " << draws << " draws and a hidden frame, "
+         << (glfwGetTime() - start) * 1000.0 << " ms" << endl;
+}
+
+// Closes the startup timeline at the end of the first frame and writes the trace
+void finishStartupTrace(double firstFrameStart) {
+    startupTrace.span("first frame", firstFrameStart, startupTrace.now());
+    startupTrace.instant("first swap");
+    string path = startupTrace.path;
+    if (startupTrace.write()) {
+        cout << "Wrote startup trace to " << path << endl;
+    } else {
+        cout << "Failed to write startup trace to " << path << endl;
+    }
+}
+
+// The benchmarks' lane changes, one every half second of simulated time
+const int BENCH_KEYS[] = {GLFW_KEY_RIGHT, GLFW_KEY_RIGHT, GLFW_KEY_LEFT, GLFW_KEY_LEFT};
+
+// Drives the simulation and draw path offscreen for a fixed number of frames with
+// scripted lane changes, then prints frames/sec and the frame-time distribution;
+// with --upload-bench or --stress, runUploadBench or runStress drives it instead
+int runBenchmark(GLFWwindow *window, const GameOptions &options) {
+    GLuint fbo, colorBuffer, depthBuffer;
+    glGenFramebuffers(1, &fbo);
+    glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, WIDTH, HEIGHT);
+    memoryStats.trackGl(GL_RENDERBUFFER, colorBuffer, MEM_RENDER_TARGETS, textureBytes(WIDTH, HEIGHT, 4));
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, WIDTH, HEIGHT);
+    memoryStats.trackGl(GL_RENDERBUFFER, depthBuffer, MEM_RENDER_TARGETS, textureBytes(WIDTH, HEIGHT, 4));
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        cout << "Benchmark framebuffer is incomplete" << endl;
+        return 1;
+    }
+    view.resize(WIDTH, HEIGHT);
+    sceneFramebuffer = fbo;
+    auto releaseTarget = [&] {
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        sceneFramebuffer = 0;
+        memoryStats.untrackGl(GL_RENDERBUFFER, colorBuffer);
+        memoryStats.untrackGl(GL_RENDERBUFFER, depthBuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        glState.deleteFramebuffers(1, &fbo);
+    };
+    if (!options.uploadBench.empty()) {
+        int result = runUploadBench(options);
+        releaseTarget();
+        return result;
+    }
+    if (options.stress > 0) {
+        int result = runStress(window, options);
+        releaseTarget();
+        return result;
+    }
+
+    // Lane changes from the input script, else BENCH_KEYS over and over
+    const int inputInterval = std::max(1, (int)(options.simRate / 2));
+    const float simStep = 1.0f / options.simRate;
+    InputScript script;
+    bool scripted = !options.inputScript.empty() || replaying;
+    bool autopilot = options.pgoTrain > 0.0 && !scripted;
+    HeadlessGame pilot(Pcg32(), Pcg32(options.seed, STREAM_AUTOPILOT)); // it only looks, so its waves go unused
+    if (replaying) {
+        script = replay.input;
+        replaying = false; // presses reach tickSimulation through the queue, like a script's
+    } else if (!options.inputScript.empty() && !script.load(options.inputScript)) {
+        cout << "Failed to read input script " << options.inputScript << endl;
+        return 1;
+    }
+    PerfBudget budget;
+    if (!options.budgets.empty() && !budget.load(options.budgets)) {
+        cout << "Failed to read budgets " << options.budgets << endl;
+        return 1;
+    }
+    size_t nextEvent = 0;
+
+    vector<double> frameMs;
+    frameMs.reserve(options.benchFrames);
+    int collisions = 0;
+    double start = glfwGetTime();
+    double firstFrameStart = startupTrace.now();
+    // The heap is watched in every mode after warm-up, so the allocs budget can fail
+    // a run; the mode only decides whether frames are printed or abort
+    const int warmup = std::min(options.allocWarmup, options.benchFrames / 2);
+    for (int frame = 0; frame < options.benchFrames; frame++) {
+        if (frame == warmup) {
+            allocationGuard.arm();
+        }
+        frameLatency.wait(); // the same queue bound as the game; finish mode times GPU work per frame
+        double frameStart = glfwGetTime();
+        if (scripted) {
+            for (; nextEvent < script.events.size() && script.events[nextEvent].tick <= (uint64_t)frame; nextEvent++) {
+                key_callback(window, script.events[nextEvent].key, 0, GLFW_PRESS, 0);
+            }
+        } else if (autopilot) {
+            int lane = entities.lane[entities.index(spaceship)];
+            int target = autopilotLane(pilot, options.bot, simStep);
+            for (; lane != target; lane += target > lane ? 1 : -1) {
+                key_callback(window, target > lane ? GLFW_KEY_RIGHT : GLFW_KEY_LEFT, 0, GLFW_PRESS, 0);
+            }
+        } else if (frame % inputInterval == 0) {
+            int key = BENCH_KEYS[(frame / inputInterval) % 4];
+            key_callback(window, key, 0, GLFW_PRESS, 0);
+        }
+
+        tickSimulation(simStep, glfwGetTimerValue()); // replayed presses land on this tick
+        bool collided = gameOver;
+        if (collided) { // keep going; the benchmark measures a fixed frame count
+            gameOver = false;
+            collisions++;
+        }
+        publishSnapshot();
+        snapshots.acquire();
+        events.dispatch();
+        if (options.render) { // --render=0 times the simulation and snapshot alone
+            streamTextures();
+            updateEffects(snapshots.readSlot(), 1.0f, simStep);
+            renderScene(snapshots.readSlot(), 1.0f);
+        }
+        frameLatency.frameSubmitted();
+        frameMs.push_back((glfwGetTime() - frameStart) * 1000.0);
+        renderBackend.endFrame();
+        overlay.record(frameMs.back());
+        if (startupTrace.enabled) {
+            finishStartupTrace(firstFrameStart); // no swap offscreen; the first frame ends here
+        }
+        allocationGuard.endFrame(frame);
+    }
+    allocationGuard.disarm();
+    glFinish(); // include the GPU work still queued
+    double total = glfwGetTime() - start;
+
+    std::sort(frameMs.begin(), frameMs.end());
+    auto percentile = [&](double p) { return frameMs[std::min(frameMs.size() - 1, (size_t)(p * frameMs.size()))]; };
+    double sum = 0.0;
+    for (double ms : frameMs) {
+        sum += ms;
+    }
+
+    cout << "frames:     " << frameMs.size() << "\n"
+         << "total:      " << total << " s\n"
+         << "fps:        " << frameMs.size() / total << "\n"
+         << "collisions: " << collisions << "\n"
+         << "gpu waits:  " << frameLatency.waits << "\n"
+         << "gl state:   " << glState.total.issued << " set, " << glState.total.skipped << " skipped as current\n"
+         << "frame heap: " << frameArena.peak << " bytes peak, " << frameArena.spilled << " spills\n"
+         << "frame ms:   mean " << sum / frameMs.size()
+         << " min " << frameMs.front()
+         << " p50 " << percentile(0.50)
+         << " p90 " << percentile(0.90)
+         << " p99 " << percentile(0.99)
+         << " p99.9 " << percentile(0.999)
+         << " max " << frameMs.back() << endl;
+    allocationGuard.printSummary();
+    releaseTarget();
+
+    // Regression gate: non-zero exit if any budgeted metric got slower
+    if (!options.budgets.empty()) {
+        bool pass = budget.check([&](const string &metric, double &ms) {
+            if (metric == "mean") {
+                ms = sum / frameMs.size();
+            } else if (metric == "p50" || metric == "p90" || metric == "p99" || metric == "p99.9") {
+                ms = percentile(atof(metric.c_str() + 1) / 100.0);
+            } else if (metric == "max") {
+                ms = frameMs.back();
+            } else if (metric == "allocs") {
+                ms = (double)allocationGuard.totalCount;
+            } else {
+                return false;
+            }
+            return true;
+        });
+        return pass ? 0 : 1;
+    }
+    return 0;
+}
+
+// Ramps --stress comets on top of the waves, offscreen, holding each count for
+// STRESS_STEP_FRAMES frames, until a step's p90 frame time exceeds the frame budget;
+// then halves the bracket between the last count that held and the first that did
+// not STRESS_REFINE_STEPS times. The count that held is the machine's score. Every
+// hot path runs as in the game, with the overlay shown: pool spawns and despawns,
+// the parallel motion pass, the broadphase grid and narrow phase around the ship,
+// the snapshot, the parallel recording and impostor, and the instanced draws.
+int runStress(GLFWwindow *window, const GameOptions &options) {
+    stressRandom.seed(options.seed, STREAM_STRESS);
+    overlay.visible = true;
+    const int inputInterval = std::max(1, (int)(options.simRate / 2));
+    const float simStep = 1.0f / options.simRate;
+    vector<double> frameMs;
+    frameMs.reserve(STRESS_STEP_FRAMES);
+    int frame = 0, collisions = 0;
+
+    // p90 frame time in ms with count comets falling
+    auto step = [&](uint32_t count) {
+        stressTarget = count;
+        frameMs.clear();
+        uint64_t uploadedBefore = spriteBatch.uploadedBytes;
+        for (int f = 0; f < STRESS_STEP_FRAMES; f++, frame++) {
+            frameLatency.wait();
+            double frameStart = glfwGetTime();
+            if (frame % inputInterval == 0) {
+                key_callback(window, BENCH_KEYS[(frame / inputInterval) % 4], 0, GLFW_PRESS, 0);
+            }
+            tickSimulation(simStep, glfwGetTimerValue());
+            if (gameOver) { // a wave comet; the stress ones pass through the ship
+                gameOver = false;
+                collisions++;
+            }
+            updateStress();
+            publishSnapshot();
+            snapshots.acquire();
+            events.dispatch();
+            if (options.render) {
+                updateEffects(snapshots.readSlot(), 1.0f, simStep);
+                renderScene(snapshots.readSlot(), 1.0f);
+            }
+            frameLatency.frameSubmitted();
+            double ms = (glfwGetTime() - frameStart) * 1000.0;
+            renderBackend.endFrame();
+            overlay.record(ms);
+            if (f >= STRESS_SETTLE_FRAMES) { // the count just changed: pool, snapshot and arena growth
+                frameMs.push_back(ms);
+            }
+        }
+        std::sort(frameMs.begin(), frameMs.end());
+        double p90 = frameMs[(size_t)(0.9 * frameMs.size())];
+        uint32_t asleep = entities.archetypeStart[ARCHETYPE_DORMANT + 1] - entities.archetypeStart[ARCHETYPE_DORMANT];
+        cout << "stress " << count << " comets (" << asleep << " asleep): p90 " << p90 << " ms, "
+             << (spriteBatch.uploadedBytes - uploadedBefore) / STRESS_STEP_FRAMES / 1024 << " KB of instances per frame"
+             << (p90 > options.frameBudget ? ", over budget" : "") << endl;
+        return p90;
+    };
+
+    uint32_t held = 0, failed = 0; // failed stays 0 if the --stress limit held
+    double heldMs = 0.0;
+    for (uint32_t count = std::min(STRESS_START, options.stress);;) {
+        double p90 = step(count);
+        if (p90 > options.frameBudget) {
+            failed = count;
+            break;
+        }
+        held = count;
+        heldMs = p90;
+        if (count == options.stress) {
+            break;
+        }
+        count = std::min(options.stress, std::max(count + 1, (uint32_t)(count * STRESS_GROWTH)));
+    }
+    for (int r = 0; r < STRESS_REFINE_STEPS && failed > held + 1; r++) {
+        uint32_t count = held + (failed - held) / 2;
+        double p90 = step(count);
+        if (p90 > options.frameBudget) {
+            failed = count;
+        } else {
+            held = count;
+            heldMs = p90;
+        }
+    }
+    glFinish();
+    stressTarget = 0;
+    updateStress();
+
+    const char *renderer = (const char *)glGetString(GL_RENDERER);
+    cout << "collisions: " << collisions << "\n"
+         << "machine:    " << (renderer ? renderer : "unknown GPU") << ", " << std::thread::hardware_concurrency() << " threads\n"
+         << "stress score: " << held << " comets at p90 " << heldMs << " ms of a " << options.frameBudget << " ms budget"
+         << (failed == 0 ? " (the --stress limit; raise it for a higher score)" : "") << endl;
+    return 0;
+}
+
+// Streams each of options.uploadBench comet sprite counts through the sprite batch
+// and its real programs with every instance upload strategy in turn, the sprites at
+// new places each frame so every byte changes, and reports per strategy and count:
+//   cpu     the submit's upload and draw calls, p50 and p99
+//   gpu     GL_TIME_ELAPSED around the same calls, p50
+//   stalls  frames that waited on a ring region's fence, plus submits over
+//           UPLOAD_BENCH_SPIKE times the median, as a driver's own wait for a
+//           buffer still in use shows up
+// headed by the driver's strings, so runs on different machines can be compared and
+// the default picked per vendor. Recording and sorting the list are not timed.
+int runUploadBench(const GameOptions &options) {
+    const SpriteTemplate &t = spriteTemplates[MATERIAL_COMET];
+    cout << "upload bench: " << GpuCalibration::driverString(GL_VENDOR) << ", " << GpuCalibration::driverString(GL_RENDERER)
+         << ", " << GpuCalibration::driverString(GL_VERSION) << "\n"
+         << "  strategy          sprites   cpu p50   cpu p99   gpu p50  stalls  MB/frame" << endl;
+    char line[128];
+    GLuint queries[UPLOAD_BENCH_FRAMES];
+    glGenQueries(UPLOAD_BENCH_FRAMES, queries);
+    vector<double> cpuMs, gpuMs;
+    glState.bindFramebuffer(GL_FRAMEBUFFER, sceneFramebuffer);
+    glViewport(0, 0, WIDTH, HEIGHT);
+    glState.enable(GL_DEPTH_TEST);
+    for (int s = UPLOAD_PERSISTENT; s < UPLOAD_STRATEGIES; s++) {
+        if (s == UPLOAD_PERSISTENT && !glExt.bufferStorage) {
+            cout << "  " << UPLOAD_STRATEGY_NAMES[s] << ": needs ARB_buffer_storage" << endl;
+            continue;
+        }
+        spriteBatch.setUploadStrategy((UploadStrategy)s);
+        for (uint32_t count : options.uploadBench) {
+            cpuMs.clear();
+            gpuMs.clear();
+            int fenceStalls = 0;
+            for (int f = -UPLOAD_BENCH_SETTLE; f < UPLOAD_BENCH_FRAMES; f++) {
+                frameLatency.wait();
+                frameArena.beginFrame();
+                int stallsBefore = spriteBatch.instanceStream.stalls;
+                spriteBatch.begin();
+                drawList.clear();
+                for (uint32_t i = 0; i < count; i++) {
+                    SpriteInstance instance = t.instance;
+                    uint32_t cell = i * 7919u + (uint32_t)(f + UPLOAD_BENCH_SETTLE) * 13u;
+                    instance.placement = vec4((float)(cell % WIDTH), (float)(cell / WIDTH % HEIGHT), 16.0f, 16.0f);
+                    drawList.add(t.keyBase | i, instance);
+                }
+                drawList.sort();
+                renderBackend.beginFrame();
+                if (f >= 0) {
+                    glBeginQuery(GL_TIME_ELAPSED, queries[f]);
+                }
+                double start = glfwGetTime();
+                spriteBatch.submit(drawList);
+                double ms = (glfwGetTime() - start) * 1000.0;
+                if (f >= 0) {
+                    glEndQuery(GL_TIME_ELAPSED);
+                    cpuMs.push_back(ms);
+                    fenceStalls += spriteBatch.instanceStream.stalls != stallsBefore;
+                }
+                frameLatency.frameSubmitted();
+                renderBackend.endFrame();
+            }
+            for (GLuint query : queries) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+                gpuMs.push_back(ns * 1e-6);
+            }
+            std::sort(gpuMs.begin(), gpuMs.end());
+            vector<double> sorted = cpuMs;
+            std::sort(sorted.begin(), sorted.end());
+            double median = sorted[sorted.size() / 2];
+            int spikes = 0;
+            for (double ms : cpuMs) {
+                spikes += ms > UPLOAD_BENCH_SPIKE * median;
+            }
+            snprintf(line, sizeof(line), "  %-16s %8u %9.3f %9.3f %9.3f %7d %9.2f", UPLOAD_STRATEGY_NAMES[s], count, median,
+                     sorted[(size_t)(0.99 * sorted.size())], gpuMs[gpuMs.size() / 2], fenceStalls + spikes,
+                     count * spriteBatch.stride() / 1e6);
+            cout << line << endl;
+        }
+    }
+    glDeleteQueries(UPLOAD_BENCH_FRAMES, queries);
+    glState.disable(GL_DEPTH_TEST);
+    spriteBatch.setUploadStrategy(options.uploadStrategy);
+    return 0;
+}
+
+// Plays options.monteCarlo headless bot runs from the seed on every core, without
+// a window or GL, then prints runs/sec and the survival distribution. With
+// --mc-serve the runs are played by --mc-worker processes instead, which take the
+// seed, rate and bot from the coordinator.
+int runMonteCarlo(const GameOptions &options) {
+    MemoryScope memory(MEM_CPU_TOOLS);
+    uint32_t maxTicks = options.monteCarloTicks > 0 ? options.monteCarloTicks : (uint32_t)(600.0f * options.simRate);
+    MonteCarlo batch;
+    if (options.monteCarloServe > 0) {
+        ClusterJob job = {{CLUSTER_MAGIC[0], CLUSTER_MAGIC[1], CLUSTER_MAGIC[2], CLUSTER_MAGIC[3]}, CLUSTER_VERSION, options.seed,
+                          options.simRate, maxTicks, options.bot.reaction, options.bot.lookahead, options.bot.mistakes};
+        MonteCarloCoordinator coordinator;
+        if (!coordinator.run(batch, (uint16_t)options.monteCarloServe, job, options.monteCarlo)) {
+            return 1;
+        }
+        batch.print();
+        return 0;
+    }
+    unsigned threads = options.threads < 0 ? std::max(1u, std::thread::hardware_concurrency()) - 1 : (unsigned)options.threads;
+    jobs.start(threads); // the calling thread runs jobs too
+    if (!options.monteCarloWorker.empty()) {
+        bool played = runMonteCarloWorker(jobs, options.monteCarloWorker);
+        jobs.stop();
+        return played ? 0 : 1;
+    }
+    cout << "Monte Carlo: " << options.monteCarlo << " runs of up to " << maxTicks << " ticks on " << threads + 1
+         << " threads" << endl;
+    batch.run(jobs, options.seed, options.monteCarlo, options.simRate, maxTicks, options.bot);
+    jobs.stop();
+    batch.print();
+    return 0;
+}
+
+// Reads --name=value options; unknown arguments are reported and ignored
+GameOptions parseOptions(int argc, char **argv) {
+    GameOptions options;
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (strncmp(arg, "--sim-rate=", 11) == 0) {
+            options.simRate = std::max(1.0f, (float)atof(arg + 11));
+        } else if (strncmp(arg, "--pacing=", 9) == 0) {
+            if (!parsePacingMode(arg + 9, options.pacing)) {
+                cout << "Unknown pacing mode " << arg + 9 << endl;
+            }
+        } else if (strncmp(arg, "--fps-cap=", 10) == 0) {
+            options.fpsCap = atof(arg + 10);
+        } else if (strncmp(arg, "--vrr-range=", 12) == 0) {
+            if (sscanf(arg + 12, "%lf-%lf", &options.vrrMin, &options.vrrMax) != 2 || options.vrrMax < options.vrrMin) {
+                cout << "Expected --vrr-range=MIN-MAX in Hz, as in --vrr-range=48-144" << endl;
+                options.vrrMin = options.vrrMax = 0.0;
+            }
+        } else if (strncmp(arg, "--window=", 9) == 0) {
+            if (!parseWindowMode(arg + 9, options.windowMode)) {
+                cout << "Unknown window mode " << arg + 9 << endl;
+            }
+        } else if (strncmp(arg, "--refresh=", 10) == 0) {
+            options.refreshRate = std::max(0, atoi(arg + 10));
+        } else if (strncmp(arg, "--monitor=", 10) == 0) {
+            options.monitor = atoi(arg + 10);
+        } else if (strncmp(arg, "--adaptive-rate=", 16) == 0) {
+            options.adaptiveRate = atoi(arg + 16) != 0;
+        } else if (strncmp(arg, "--power-saving=", 15) == 0) {
+            options.powerSaving = atoi(arg + 15) != 0;
+        } else if (strncmp(arg, "--battery-fps=", 14) == 0) {
+            options.batteryFps = std::max(1.0, atof(arg + 14));
+        } else if (strncmp(arg, "--battery-res-scale=", 20) == 0) {
+            options.batteryResScale = (float)atof(arg + 20);
+        } else if (strncmp(arg, "--frame-budget=", 15) == 0) {
+            options.frameBudget = std::max(0.1, atof(arg + 15));
+        } else if (strncmp(arg, "--frame-csv=", 12) == 0) {
+            options.frameCsv = arg + 12;
+        } else if (strncmp(arg, "--hitch-log=", 12) == 0) {
+            options.hitchLog = arg + 12;
+        } else if (strncmp(arg, "--hitch-threshold=", 18) == 0) {
+            options.hitchThreshold = std::max(0.0, atof(arg + 18));
+        } else if (strcmp(arg, "--bench") == 0) {
+            options.bench = true;
+        } else if (strncmp(arg, "--pgo-train=", 12) == 0) {
+            options.pgoTrain = std::max(0.0, atof(arg + 12));
+        } else if (strcmp(arg, "--gl-errors") == 0) {
+            options.glErrors = true;
+        } else if (strncmp(arg, "--gl-core=", 10) == 0) {
+            options.glCore = atoi(arg + 10) != 0;
+        } else if (strncmp(arg, "--gl-no-error=", 14) == 0) {
+            options.glNoError = atoi(arg + 14) != 0;
+        } else if (strcmp(arg, "--gl-debug") == 0) {
+            options.glDebug = true;
+        } else if (strcmp(arg, "--gl-perf-log") == 0) {
+            options.glPerfLog = true;
+        } else if (strncmp(arg, "--gl-name-pool=", 15) == 0) {
+            options.glNamePool = atoi(arg + 15) != 0;
+        } else if (strcmp(arg, "--gl-markers") == 0) {
+            options.glMarkers = true;
+        } else if (strncmp(arg, "--dsa=", 6) == 0) {
+            options.dsa = atoi(arg + 6) != 0;
+        } else if (strncmp(arg, "--indirect=", 11) == 0) {
+            options.indirect = atoi(arg + 11) != 0;
+        } else if (strncmp(arg, "--upload-strategy=", 18) == 0) {
+            UploadStrategy strategy = findUploadStrategy(arg + 18);
+            if (strategy == UPLOAD_STRATEGIES) {
+                cout << "Unknown upload strategy " << arg + 18 << endl;
+            } else {
+                options.uploadStrategy = strategy;
+            }
+        } else if (strncmp(arg, "--upload-bench=", 15) == 0) {
+            options.uploadBench.clear();
+            for (const char *p = arg + 15; *p;) {
+                char *end;
+                unsigned long count = strtoul(p, &end, 10);
+                if (end == p || count == 0) {
+                    cout << "Expected --upload-bench=N[,N...], as in --upload-bench=1000,10000,100000" << endl;
+                    options.uploadBench.clear();
+                    break;
+                }
+                options.uploadBench.push_back((uint32_t)count);
+                p = *end == ',' ? end + 1 : end;
+            }
+            options.bench |= !options.uploadBench.empty();
+        } else if (strncmp(arg, "--packed-instances=", 19) == 0) {
+            options.packedInstances = atoi(arg + 19) != 0;
+        } else if (strncmp(arg, "--upload-context=", 17) == 0) {
+            options.uploadContext = atoi(arg + 17) != 0;
+        } else if (strncmp(arg, "--texture-memory=", 17) == 0) {
+            options.lowTextureMemory = strcmp(arg + 17, "low") == 0;
+        } else if (strncmp(arg, "--texture-budget=", 17) == 0) {
+            options.textureBudget = (int64_t)(atof(arg + 17) * 1048576.0);
+        } else if (strncmp(arg, "--vertex-id=", 12) == 0) {
+            options.vertexId = atoi(arg + 12) != 0;
+        } else if (strncmp(arg, "--split-screen=", 15) == 0) {
+            options.splitScreen = atoi(arg + 15) != 0;
+        } else if (strncmp(arg, "--sprite-outlines=", 18) == 0) {
+            options.spriteOutlines = atoi(arg + 18) != 0;
+        } else if (strncmp(arg, "--cutout=", 9) == 0) {
+            options.cutout = atoi(arg + 9) != 0;
+        } else if (strncmp(arg, "--bindless=", 11) == 0) {
+            options.bindless = atoi(arg + 11) != 0;
+        } else if (strncmp(arg, "--scores=", 9) == 0) {
+            options.scoreFile = arg + 9;
+        } else if (strncmp(arg, "--affinity=", 11) == 0) {
+            options.affinity = arg + 11;
+        } else if (strncmp(arg, "--thread-priority=", 18) == 0) {
+            options.threadPriority = atoi(arg + 18) != 0;
+        } else if (strncmp(arg, "--settings=", 11) == 0) {
+            options.settingsFile = arg + 11;
+        } else if (strncmp(arg, "--leaderboard=", 14) == 0) {
+            options.leaderboard = arg + 14;
+        } else if (strncmp(arg, "--telemetry=", 12) == 0) {
+            options.telemetryDir = arg + 12;
+        } else if (strncmp(arg, "--alloc-guard=", 14) == 0) {
+            if (!parseAllocationGuardMode(arg + 14, options.allocGuard)) {
+                cout << "Unknown allocation guard mode " << arg + 14 << endl;
+            }
+        } else if (strncmp(arg, "--alloc-warmup=", 15) == 0) {
+            options.allocWarmup = std::max(0, atoi(arg + 15));
+        } else if (strncmp(arg, "--frames-in-flight=", 19) == 0) {
+            options.framesInFlight = strcmp(arg + 19, "finish") == 0 ? FrameLatencyLimiter::FINISH : atoi(arg + 19);
+        } else if (strncmp(arg, "--late-latch=", 13) == 0) {
+            options.lateLatch = atoi(arg + 13) != 0;
+        } else if (strncmp(arg, "--input-script=", 15) == 0) {
+            options.inputScript = arg + 15;
+        } else if (strncmp(arg, "--budgets=", 10) == 0) {
+            options.budgets = arg + 10;
+        } else if (strncmp(arg, "--record-input=", 15) == 0) {
+            options.recordInput = arg + 15;
+        } else if (strncmp(arg, "--record=", 9) == 0) {
+            options.record = arg + 9;
+        } else if (strncmp(arg, "--seek=", 7) == 0) {
+            options.seek = atof(arg + 7);
+        } else if (strncmp(arg, "--replay=", 9) == 0) {
+            options.replay = arg + 9;
+        } else if (strcmp(arg, "--replay-fast") == 0) {
+            options.replayFast = true;
+        } else if (strncmp(arg, "--keyframe-interval=", 20) == 0) {
+            options.keyframeInterval = atof(arg + 20);
+        } else if (strcmp(arg, "--state-hash") == 0) {
+            options.stateHash = true;
+        } else if (strncmp(arg, "--level=", 8) == 0) {
+            options.level = arg + 8;
+        } else if (strncmp(arg, "--wave-script=", 14) == 0) {
+            options.waveScript = arg + 14;
+        } else if (strncmp(arg, "--export-level=", 15) == 0) {
+            options.exportLevel = arg + 15;
+        } else if (strncmp(arg, "--monte-carlo=", 14) == 0) {
+            options.monteCarlo = (uint32_t)strtoul(arg + 14, nullptr, 10);
+        } else if (strncmp(arg, "--mc-serve=", 11) == 0) {
+            options.monteCarloServe = atoi(arg + 11);
+        } else if (strncmp(arg, "--mc-worker=", 12) == 0) {
+            options.monteCarloWorker = arg + 12;
+        } else if (strncmp(arg, "--mc-ticks=", 11) == 0) {
+            options.monteCarloTicks = (uint32_t)strtoul(arg + 11, nullptr, 10);
+        } else if (strncmp(arg, "--bot-reaction=", 15) == 0) {
+            options.bot.reaction = std::max(0.0f, (float)atof(arg + 15));
+        } else if (strncmp(arg, "--bot-lookahead=", 16) == 0) {
+            options.bot.lookahead = std::max(0.0f, (float)atof(arg + 16));
+        } else if (strncmp(arg, "--bot-mistakes=", 15) == 0) {
+            options.bot.mistakes = (float)atof(arg + 15);
+        } else if (strncmp(arg, "--frames=", 9) == 0) {
+            options.benchFrames = std::max(1, atoi(arg + 9));
+        } else if (strncmp(arg, "--stress=", 9) == 0) {
+            options.stress = (uint32_t)std::max(0, atoi(arg + 9));
+            options.bench |= options.stress > 0;
+        } else if (strncmp(arg, "--sim-lod=", 10) == 0) {
+            options.simulationLod = atoi(arg + 10) != 0;
+        } else if (strncmp(arg, "--threads=", 10) == 0) {
+            options.threads = std::max(0, atoi(arg + 10));
+        } else if (strncmp(arg, "--sim-thread=", 13) == 0) {
+            options.simThread = atoi(arg + 13) != 0;
+        } else if (strncmp(arg, "--present-thread=", 17) == 0) {
+            options.presentThread = atoi(arg + 17) != 0;
+        } else if (strncmp(arg, "--metrics-port=", 15) == 0) {
+            options.metricsPort = std::max(0, atoi(arg + 15));
+        } else if (strncmp(arg, "--hang-timeout=", 15) == 0) {
+            options.hangTimeout = std::max(0.0, atof(arg + 15));
+        } else if (strncmp(arg, "--hang-restart=", 15) == 0) {
+            options.hangRestart = atoi(arg + 15) != 0;
+        } else if (strncmp(arg, "--sample-profile=", 17) == 0) {
+            options.sampleProfile = arg + 17;
+        } else if (strncmp(arg, "--sample-rate=", 14) == 0) {
+            options.sampleRate = std::max(1.0, atof(arg + 14));
+        } else if (strncmp(arg, "--sample-threads=", 17) == 0) {
+            options.sampleThreads = arg + 17;
+        } else if (strncmp(arg, "--warm-up=", 10) == 0) {
+            options.warmUp = atoi(arg + 10) != 0;
+        } else if (strncmp(arg, "--time-scale=", 13) == 0) {
+            options.timeScale = atof(arg + 13);
+        } else if (strcmp(arg, "--max-speed") == 0) {
+            options.maxSpeed = true;
+        } else if (strncmp(arg, "--dynamic-res=", 14) == 0) {
+            options.dynamicRes = atoi(arg + 14) != 0;
+        } else if (strncmp(arg, "--min-res-scale=", 16) == 0) {
+            options.minResScale = (float)atof(arg + 16);
+        } else if (strcmp(arg, "--overdraw") == 0) {
+            options.overdraw = true;
+        } else if (strncmp(arg, "--msaa=", 7) == 0) {
+            options.msaa = atoi(arg + 7);
+        } else if (strncmp(arg, "--bloom=", 8) == 0) {
+            options.bloom = strcmp(arg + 8, "auto") == 0 ? -1 : atoi(arg + 8) != 0;
+        } else if (strncmp(arg, "--calibration=", 14) == 0) {
+            options.calibrationFile = arg + 14;
+        } else if (strcmp(arg, "--recalibrate") == 0) {
+            options.recalibrate = true;
+        } else if (strncmp(arg, "--render=", 9) == 0) {
+            options.render = atoi(arg + 9) != 0;
+        } else if (strncmp(arg, "--hud=", 6) == 0) {
+            options.hud = atoi(arg + 6) != 0;
+        } else if (strncmp(arg, "--hud-sdf=", 10) == 0) {
+            options.hudSdf = atoi(arg + 10) != 0;
+        } else if (strncmp(arg, "--ui=", 5) == 0) {
+            options.ui = atoi(arg + 5) != 0;
+        } else if (strcmp(arg, "--overlay") == 0) {
+            options.overlay = true;
+        } else if (strcmp(arg, "--gpu-motion") == 0) {
+            options.gpuMotion = true;
+        } else if (strcmp(arg, "--gpu-cull") == 0) {
+            options.gpuMotion = options.gpuCull = true;
+        } else if (strncmp(arg, "--large-pages=", 14) == 0) {
+            options.largePages = atoi(arg + 14) != 0;
+        } else if (strncmp(arg, "--impostors=", 12) == 0) {
+            options.impostors = atoi(arg + 12) != 0;
+        } else if (strncmp(arg, "--audio=", 8) == 0) {
+            options.audio = atoi(arg + 8) != 0;
+        } else if (strncmp(arg, "--volume=", 9) == 0) {
+            options.volume = std::max(0.0f, std::min((float)atof(arg + 9), 1.0f));
+        } else if (strncmp(arg, "--hot-reload=", 13) == 0) {
+            options.hotReload = atoi(arg + 13) != 0;
+        } else if (strncmp(arg, "--textures=", 11) == 0) {
+            options.textureDir = arg + 11;
+        } else if (strncmp(arg, "--pack=", 7) == 0) {
+            options.pack = arg + 7;
+        } else if (strncmp(arg, "--image-decoder=", 16) == 0) {
+            ImageDecoderKind kind = findImageDecoder(arg + 16);
+            if (kind == IMAGE_DECODERS) {
+                cout << "Unknown image decoder " << arg + 16 << endl;
+            } else {
+                options.imageDecoder = kind;
+            }
+        } else if (strncmp(arg, "--profile=", 10) == 0) {
+            options.profile = arg + 10;
+        } else if (strncmp(arg, "--startup-trace=", 16) == 0) {
+            options.startupTrace = arg + 16;
+        } else if (strcmp(arg, "--procedural-comets") == 0) {
+            options.proceduralComets = true;
+        } else if (strncmp(arg, "--comet-variants=", 17) == 0) {
+            options.cometVariants = arg + 17;
+        } else if (strcmp(arg, "--exit-after-first-frame") == 0) {
+            options.exitAfterFirstFrame = true;
+        } else if (strncmp(arg, "--shader-cache=", 15) == 0) {
+            options.shaderCache = arg + 15;
+        } else if (strncmp(arg, "--capture-dir=", 14) == 0) {
+            options.captureDir = arg + 14;
+        } else if (strcmp(arg, "--record-frames") == 0) {
+            options.recordFrames = true;
+        } else if (strncmp(arg, "--video=", 8) == 0) {
+            options.video = arg + 8;
+        } else if (strncmp(arg, "--encoder=", 10) == 0) {
+            options.encoder = arg + 10;
+        } else if (strncmp(arg, "--video-fps=", 12) == 0) {
+            options.videoFps = std::max(atof(arg + 12), 1.0);
+        } else if (strncmp(arg, "--host=", 7) == 0) {
+            options.hostPort = atoi(arg + 7);
+        } else if (strncmp(arg, "--connect=", 10) == 0) {
+            options.connect = arg + 10;
+        } else if (strncmp(arg, "--seed=", 7) == 0) {
+            options.seed = strtoull(arg + 7, nullptr, 10);
+        } else {
+            cout << "Ignoring unknown option " << arg << endl;
+        }
+    }
+    return options;
+}
+
+// Handles keyboard input for moving spaceship between lanes; the simulation applies it next tick
+void key_callback(GLFWwindow *window, int key, int scancode, int action, int mode) {
+    if (action == GLFW_PRESS) {
+        redrawRequested = true;
+        if ((key == GLFW_KEY_LEFT || key == GLFW_KEY_RIGHT) && !paused) {
+            inputQueue.push({glfwGetTimerValue(), key}); // Lane change, applied by the simulation
+        } else if (key == GLFW_KEY_P || key == GLFW_KEY_PAUSE) {
+            setPaused(window, !paused);
+        } else if (key == GLFW_KEY_ESCAPE) {
+            glfwSetWindowShouldClose(window, GLFW_TRUE);
+        } else if ((key == GLFW_KEY_R || key == GLFW_KEY_ENTER) && gameOver) {
+            restartRequested = true; // runGame restarts once it has seen the game end
+        } else if (key == GLFW_KEY_F3) {
+            overlay.visible = !overlay.visible; // Toggle the performance overlay
+        } else if (key == GLFW_KEY_F12) {
+            capture.screenshot(); // Written a few frames later by the capture worker
+        } else if (key == GLFW_KEY_F10) {
+            capture.toggleRecording();
+            cout << (capture.recording ? "Recording frames to " : "Stopped recording to ") << capture.directory << endl;
+        } else if (key == GLFW_KEY_F11) {
+            display.toggle(window); // resizes the framebuffer, which refits the view
+            displayChanged = true;
+        } else if (key == GLFW_KEY_F9) {
+            bool written = profiler.flush(profilePath); // Dump the zone profile
+            cout << (written ? "Wrote profile to " : "Failed to write profile to ") << profilePath << endl;
+        }
+    }
+}
+
+// Losing focus pauses the game; it stays paused until the player resumes it
+void focus_callback(GLFWwindow *window, int focused) {
+    windowFocused = focused == GLFW_TRUE;
+    if (!windowFocused) {
+        setPaused(window, true);
+    }
+    redrawRequested = true;
+}
+
+// The window's contents were damaged while nothing was being drawn
+void refresh_callback(GLFWwindow *window) {
+    redrawRequested = true;
+}
+
+// Minimizing hides the window until it is restored; the simulation holds meanwhile
+void iconify_callback(GLFWwindow *window, int iconified) {
+    windowHidden = iconified == GLFW_TRUE;
+    redrawRequested = true;
+}
+
+// Some platforms report a zero-sized framebuffer instead of, or as well as, iconifying
+void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
+    windowHidden = width == 0 || height == 0 || glfwGetWindowAttrib(window, GLFW_ICONIFIED);
+    viewStale = true; // applied once, before the next frame draws
+    redrawRequested = true;
+}
+
+// Fits the playfield to the window's current framebuffer
+void resizeView(GLFWwindow *window) {
+    int width, height;
+    glfwGetFramebufferSize(window, &width, &height);
+    if (width > 0 && height > 0) {
+        view.resize(width, height);
+        memoryStats.trackGl(GL_FRAMEBUFFER, 0, MEM_RENDER_TARGETS, 2 * textureBytes(width, height, 4)); // front + back buffer
+    }
+}
+
+// Holds or resumes the simulation and shows the state in the title bar
+void setPaused(GLFWwindow *window, bool pause) {
+    if (net.active) {
+        return; // a race does not wait for either player
+    }
+    paused = pause;
+    glfwSetWindowTitle(window, pause ? "Space Travel (paused)" : "Space Travel");
+}
+
+// Wraps a finished shader build and reflects its uniforms
+ShaderProgram linkedShader(int build) {
+    ShaderProgram program;
+    program.id = shaderBuilder.program(build);
+    program.reflect();
+    ViewTransform::bindProgram(program.id);
+    return program;
+}
+
+// Features every sprite variant is built with: how instances get their texture and
+// their quad corners, and whether they route copies to split-screen views, fixed at
+// startup
+uint32_t spriteBaseFeatures() {
+    return (textureHandles.enabled ? (uint32_t)FEATURE_BINDLESS : 0u) | (spriteBatch.vertexId ? (uint32_t)FEATURE_VERTEX_ID : 0u) |
+           (view.singlePass ? (uint32_t)FEATURE_VIEWS : 0u);
+}
+
+// Sprite program variant a material is drawn with; flipbooks and cutouts only pay
+// for the shader work they use
+uint32_t materialFeatures(const Material &mat) {
+    uint32_t features = spriteBaseFeatures();
+    if (mat.rotates) {
+        features |= FEATURE_ROTATION;
+    }
+    if (mat.flipbook.frames > 1.0f) {
+        features |= FEATURE_ANIMATED;
+    }
+    if (mat.opaque) {
+        features |= FEATURE_ALPHA_TEST;
+    } else if (mat.cutout) {
+        features |= FEATURE_ALPHA_TEST | FEATURE_CUTOUT;
+    }
+    if (mat.layered) {
+        features |= FEATURE_ARRAY;
+    }
+    return features;
+}
+
+// Records entity i of a snapshot, of the given archetype, as a draw command and
+// instance: its material's SpriteTemplate, referenced rather than rebuilt, with the
+// entity's placement and layer written over it, and its rotation and flipbook start
+// for archetypes that rotate or animate. The material's layer gives the depth, and
+// entity order breaks ties within a layer.
+template <typename Archetype>
+void drawSprite(const RenderSnapshot &snap, uint32_t i, const aligned_vec4 &placement, DrawList::Command &command, SpriteInstance &instance) {
+    const SpriteTemplate &t = spriteTemplates[snap.material[i]];
+    command.key = t.keyBase | i;
+    instance = t.instance;
+    instance.placement = vec4(placement.x, placement.y, placement.z, placement.w);
+    instance.layer = entityLayer(t.layered, snap.handle[i]);
+    if constexpr (Archetype::template has<Rotates>) {
+        instance.rotation = radians(vec2(snap.angle[i], snap.spin[i]));
+    }
+    if constexpr (Archetype::template has<Animated>) {
+        instance.animation = t.flipbook.staggered(snap.handle[i]);
+    }
+}
+
+// Texture-array layer an entity shows: the variant its handle picks, for layered materials
+float entityLayer(bool layered, EntityHandle handle) {
+    return layered ? (float)asteroids.variantOf(handle) : 0.0f;
+}
+
+// Fill drawList and the impostor's list from the snapshot and return the ship's
+// instance. Jobs of RECORD_GRAIN entities record in parallel, each into the slots of
+// its own entities: the draw list's arrays are sized for every entity up front and
+// far comets go to a staging array of the same size, so no job allocates or shares a
+// counter. The render thread then packs the slices down in entity order and hands
+// the aggregated comets to the impostor, leaving the lists exactly as recording on
+// one thread would, before the sort merges everything by key. Each slice first runs
+// placeSprites over its entities, which interpolates and culls them all in one SIMD
+// pass, so the per-entity loop only picks materials and copies placements. Cutout
+// sprites get a second command for their blended edge, sharing their instance and
+// appended after every sprite's own.
+uint32_t recordScene(const RenderSnapshot &snap, float alpha, uint32_t &culled) {
+    struct Slice {
+        uint32_t sprites, edges, aggregated, far, culled;
+        uint32_t ship; // sprite of the ship within the slice, or UINT32_MAX
+    };
+    const uint32_t count = snap.size();
+    const uint32_t slices = (count + RECORD_GRAIN - 1) / RECORD_GRAIN;
+    Slice *recorded = frameArena.allocate<Slice>(slices);
+    SpriteInstance *aggregated = frameArena.allocate<SpriteInstance>(count);
+    DrawList::Command *edges = frameArena.allocate<DrawList::Command>(count); // instances within the slice until merged
+    aligned_vec4 *placement = frameArena.allocate<aligned_vec4>(count);
+    uint8_t *visible = frameArena.allocate<uint8_t>(count);
+    drawList.clear();
+    drawList.commands.resize(count);
+    drawList.instances.resize(count);
+    const Material &cometMaterial = materials[MATERIAL_COMET];
+    impostors.begin(drawList.textures[cometMaterial.textureKey],
+                    spriteShaders.find(spriteBaseFeatures() | (cometMaterial.layered ? (uint32_t)FEATURE_ARRAY : 0u)));
+
+    auto recordSlice = [&](uint32_t begin, uint32_t end) {
+        Slice slice = {0, 0, 0, 0, 0, UINT32_MAX};
+        placeSprites(snap.sprites(), begin, end, alpha, (float)WIDTH, (float)HEIGHT, placement, visible);
+        Archetypes::forEach([&]<typename A>() {
+            uint32_t first = std::max(begin, snap.archetypeStart[A::ID]), last = std::min(end, snap.archetypeStart[A::ID + 1]);
+            if constexpr (A::template has<Falling>) {
+                if (cometField.enabled) {
+                    return; // drawn by the comet field
+                }
+            }
+            for (uint32_t i = first; i < last; i++) {
+                if constexpr (A::template has<Latched>) {
+                    slice.ship = slice.sprites; // always recorded: latchShip moves it
+                } else if (!visible[i]) {
+                    slice.culled++; // Spawning above or leaving below the screen
+                    continue;
+                }
+                if constexpr (A::template has<Falling>) {
+                    vec2 position(placement[i].x, placement[i].y);
+                    if (impostors.far(position.y)) {
+                        slice.far++;
+                        if (impostors.active) {
+                            const SpriteTemplate &t = spriteTemplates[MATERIAL_COMET];
+                            aggregated[begin + slice.aggregated++] =
+                                CometImpostors::instance(position, vec2(snap.width[i], snap.height[i]), t.instance.texRect, t.flipbook,
+                                                         entityLayer(t.layered, snap.handle[i]));
+                            continue;
+                        }
+                    }
+                }
+                drawSprite<A>(snap, i, placement[i], drawList.commands[begin + slice.sprites], drawList.instances[begin + slice.sprites]);
+                if (uint64_t edgeKeyBase = spriteTemplates[snap.material[i]].edgeKeyBase) {
+                    edges[begin + slice.edges++] = {edgeKeyBase | i, slice.sprites};
+                }
+                slice.sprites++;
+            }
+        });
+        recorded[begin / RECORD_GRAIN] = slice;
+    };
+    jobs.parallelFor(count, RECORD_GRAIN, [&](uint32_t begin, uint32_t end) {
+        PROFILE_SCOPE("recordSprites");
+        for (uint32_t b = begin; b < end; b += RECORD_GRAIN) {
+            recordSlice(b, std::min(b + RECORD_GRAIN, end)); // the inline path gets the whole range
+        }
+    });
+
+    // Pack the slices together; a slice never moves past its own start, so in place
+    PROFILE_SCOPE("mergeDrawLists");
+    uint32_t sprites = 0, shipInstance = 0;
+    for (uint32_t s = 0; s < slices; s++) {
+        const Slice &slice = recorded[s];
+        uint32_t begin = s * RECORD_GRAIN;
+        if (slice.ship != UINT32_MAX) {
+            shipInstance = sprites + slice.ship;
+        }
+        for (uint32_t k = 0; k < slice.edges; k++) {
+            edges[begin + k].instance += sprites;
+        }
+        for (uint32_t k = 0; k < slice.sprites; k++, sprites++) {
+            drawList.commands[sprites] = {drawList.commands[begin + k].key, sprites};
+            drawList.instances[sprites] = drawList.instances[begin + k];
+        }
+        for (uint32_t k = 0; k < slice.aggregated; k++) {
+            impostors.add(aggregated[begin + k]);
+        }
+        impostors.countFar(slice.far);
+        culled += slice.culled;
+    }
+    drawList.commands.resize(sprites);
+    drawList.instances.resize(sprites);
+    for (uint32_t s = 0; s < slices; s++) {
+        for (uint32_t k = 0; k < recorded[s].edges; k++) {
+            drawList.commands.push_back(edges[s * RECORD_GRAIN + k]);
+        }
+    }
+    return shipInstance;
+}
+
+// View-space z of a layer; the projection maps larger z nearer
+float layerDepth(DrawLayer layer) {
+    return (float)layer / (float)LAYER_COUNT;
+}
+
+// Late latch: poll input once more and start the ship towards the lane the pending
+// moves will take it to, instead of a frame later
+void latchShip(const RenderSnapshot &snap, SpriteInstance &ship) {
+    if (!lateLatch) {
+        return;
+    }
+    PROFILE_SCOPE("latchShip");
+    glfwPollEvents();
+    gamepads.poll(inputQueue);
+    int lane = snap.shipLane;
+    inputQueue.forEachPending([&](const InputEvent &event) { lane = laneAfter(lane, event.key); });
+    if (lane != snap.shipLane) {
+        // Where the next tick will have moved it: its first step towards the new lane
+        ship.placement.x = laneTransitionX(ship.placement.x, LANES.center(lane),
+                                           (float)(snap.simTime - snap.prevSimTime));
+    }
+}
+
+// Sends the spaceship to the specified lane; it glides there from wherever it is
+void moveSpaceship(int lane) {
+    uint32_t ship = entities.index(spaceship);
+    entities.lane[ship] = (int8_t)lane;
+    shipTransition.fromX = entities.x[ship];
+    shipTransition.toX = LANES.center(lane);
+    shipTransition.elapsed = 0.0f;
+    events.publish(EVENT_LANE_CHANGE, (uint32_t)simTick, lane, shipTransition.toX, entities.y[ship]);
+}
+
+// Advances the ship's lane change by one tick; rendering interpolates between ticks
+void advanceSpaceship(float deltaTime) {
+    if (shipTransition.elapsed >= settings.laneTransitionTime) {
+        return;
+    }
+    shipTransition.elapsed += deltaTime;
+    entities.x[entities.index(spaceship)] =
+        laneTransitionX(shipTransition.fromX, shipTransition.toX, shipTransition.elapsed, settings.laneTransitionTime);
+}
+
+// Takes a comet from the pool and drops it into the given lane from above the screen
+void spawnComet(int lane, float speed) {
+    if (entities.full() || cometLanes[lane].ring.full()) {
+        return; // pool or lane exhausted; skip rather than allocate
+    }
+    EntityHandle comet = entities.create(LANES.center(lane), settings.spawnY, settings.cometSize, settings.cometSize, -speed, (int8_t)lane, MATERIAL_COMET,
+                                         ARCHETYPE_COMET);
+    cometField.record(comet, {(float)simTime, (float)lane, speed, 1.0f});
+    CometLane &cometLane = cometLanes[lane];
+    if (cometLane.ring.empty()) {
+        cometLane.speed = speed;
+        cometLane.mixed = false;
+    }
+    cometLane.mixed |= speed != cometLane.speed;
+    cometLane.ring.push(comet); // at the spawn height, above everything already falling
+
+    // Tumble from a start angle and spin picked by hashing the handle and tick, which
+    // replays reproduce without drawing from spawnRandom; stored as the angle at
+    // time 0, so the renderer needs no spawn time and nothing updates it
+    uint32_t seed = (comet * 2654435761u) ^ ((uint32_t)simTick * 0x9E3779B9u);
+    float spin = COMET_SPIN_MIN + (COMET_SPIN_MAX - COMET_SPIN_MIN) * (float)(seed >> 8 & 0xFFFF) / 65535.0f;
+    spin = seed & 1 ? spin : -spin;
+    uint32_t i = entities.index(comet);
+    entities.spin[i] = spin;
+    entities.angle[i] = (float)fmod((seed >> 24) * (360.0 / 256.0) - spin * simTime, 360.0);
+    events.publish(EVENT_SPAWN, (uint32_t)simTick, lane, LANES.center(lane), settings.spawnY);
+}
+
+// Returns the comet at dense index i to the pool and frees its comet field slot
+void despawnComet(uint32_t i) {
+    EntityHandle comet = entities.handleOf[i];
+    LaneRing<EntityHandle, MAX_COMETS> &ring = cometLanes[entities.lane[i]].ring;
+    for (uint32_t k = 0; k < ring.size(); k++) {
+        if (ring[k] == comet) {
+            ring.erase(k); // the front, unless a hit took one behind it
+            break;
+        }
+    }
+    entities.destroy(comet);
+    cometField.record(comet, {0.0f, 0.0f, 0.0f, 0.0f});
+}
+
+// Put the simulation back to the start of a run without touching the renderer: free
+// the comets' field slots, then copy the pool as setup left it (only the ship) over
+// the live one. Every vector already has the capacity, so nothing is allocated. The
+// tick and simulated time run on, and the waves with them. Only while no simulation
+// thread is running.
+void resetRun() {
+    entities.forEachRange(COMPONENT_LIFETIME, [&](uint32_t first, uint32_t last) {
+        for (uint32_t i = first; i < last; i++) {
+            cometField.record(entities.handleOf[i], {0.0f, 0.0f, 0.0f, 0.0f});
+        }
+    });
+    for (CometLane &cometLane : cometLanes) {
+        cometLane.ring.clear();
+    }
+    entities = initialEntities;
+    shipTransition = LaneTransition();
+    shipTransition.elapsed = settings.laneTransitionTime;
+    shipWrecked = false;
+    gameOver = false;
+}
+
+// Drops a --stress comet into lane at height y, at a random speed around
+// settings.cometSpeed. It is not lane-bound, so the broadphase grids it like any free
+// mover; the comet field gets the spawn time that puts it at y now.
+void spawnStressComet(int lane, float y) {
+    float speed = settings.cometSpeed * (0.5f + stressRandom.nextFloat());
+    EntityHandle comet = entities.create(LANES.center(lane), y, settings.cometSize, settings.cometSize, -speed, -1, MATERIAL_COMET,
+                                         ARCHETYPE_STRESS);
+    cometField.record(comet, {(float)(simTime - (settings.spawnY - y) / speed), (float)lane, speed, 1.0f});
+    uint32_t i = entities.index(comet);
+    float spin = COMET_SPIN_MIN + (COMET_SPIN_MAX - COMET_SPIN_MIN) * stressRandom.nextFloat();
+    entities.spin[i] = stressRandom.next() & 1 ? spin : -spin;
+    entities.angle[i] = 360.0f * stressRandom.nextFloat();
+}
+
+// Keeps stressTarget --stress comets falling: those past settings.despawnY go back to
+// the pool and as many come in at the top, and the count is trimmed or topped up to
+// the target. Top-ups land anywhere down the field, so a new count is at full density
+// on its first frame. Walks the range of the awake and sleeping ones downwards, as
+// destroy() refills a hole from its end; a sleeper is above the floor even as stored,
+// so only trimming takes one, and takes them first.
+void updateStress() {
+    PROFILE_SCOPE("updateStress");
+    EntityPool &e = entities;
+    const uint32_t first = e.archetypeStart[ARCHETYPE_STRESS];
+    uint32_t fallen = 0;
+    for (uint32_t i = e.archetypeStart[ARCHETYPE_DORMANT + 1]; i-- > first;) {
+        bool surplus = i - first >= stressTarget;
+        if (surplus || e.y[i] < settings.despawnY) {
+            fallen += !surplus;
+            cometField.record(e.handleOf[i], {0.0f, 0.0f, 0.0f, 0.0f});
+            e.destroy(e.handleOf[i]);
+        }
+    }
+    // Lanes by the wave mix, drawn a batch at a time: a top-up can be thousands
+    const uint32_t BATCH = 64;
+    uint32_t raw[BATCH], lanes[BATCH];
+    for (uint32_t n = e.archetypeStart[ARCHETYPE_DORMANT + 1] - first; n < stressTarget && !e.full();) {
+        uint32_t batch = std::min(stressTarget - n, BATCH);
+        stressRandom.fill(raw, batch);
+        waveTables.lanes.sample(raw, lanes, batch);
+        for (uint32_t k = 0; k < batch && !e.full(); k++, n++, fallen -= fallen > 0) {
+            spawnStressComet((int)lanes[k], fallen > 0 ? settings.spawnY : mix(settings.despawnY, settings.spawnY, stressRandom.nextFloat()));
+        }
+    }
+}
+
+// An anchor tick of the simulation LOD, after motion: the sleepers make up the
+// period they skipped in one step, then every stress comet that stays clear of the
+// ship's reach and the floor for the next period sleeps, and every other one wakes.
+// The moves are collected first, as setArchetype() shifts indices both ways.
+void wakeAndSleep(float deltaTime) {
+    PROFILE_SCOPE("simulationLod");
+    EntityPool &e = entities;
+    const uint32_t dormant = e.archetypeStart[ARCHETYPE_DORMANT], last = e.archetypeStart[ARCHETYPE_DORMANT + 1];
+    const float period = deltaTime * SimulationLod::PERIOD;
+    jobs.parallelFor(last - dormant, MOTION_GRAIN, [&](uint32_t begin, uint32_t end) {
+        PROFILE_SCOPE("motion");
+        for (uint32_t i = dormant + begin; i < dormant + end; i++) {
+            e.y[i] += e.vy[i] * period;
+            e.prevY[i] = e.y[i] - e.vy[i] * deltaTime;
+        }
+    });
+
+    uint32_t ship = e.index(spaceship);
+    simulationLod.reach(e.x[ship], e.y[ship], e.width[ship] / 2, e.height[ship] / 2, LANES.center(LANE_COUNT - 1) - LANES.center(0),
+                        settings.laneTransitionTime, deltaTime, settings.despawnY);
+    lodChanges.clear();
+    for (uint32_t i = e.archetypeStart[ARCHETYPE_STRESS]; i < last; i++) {
+        if (simulationLod.canSleep(e.x[i], e.y[i], e.vy[i], e.width[i] / 2, e.height[i] / 2, deltaTime) != (i >= dormant)) {
+            lodChanges.push_back(e.handleOf[i]);
+        }
+    }
+    for (EntityHandle handle : lodChanges) {
+        e.setArchetype(handle, e.index(handle) >= e.archetypeStart[ARCHETYPE_DORMANT] ? ARCHETYPE_STRESS : ARCHETYPE_DORMANT);
+    }
+}
+
+bool WaveSource::operator()(WaveSpawn &spawn) {
+    while (const LevelSpawn *s = level.next(UINT64_MAX)) {
+        if (s->type == LEVEL_COMET && s->lane < LANE_COUNT) {
+            spawn = {(double)s->tick / level.header->tickRate, s->speed > 0 ? (float)s->speed : settings.cometSpeed, s->lane};
+            waveTime = spawn.time + settings.waveInterval; // random waves take over after the last one
+            return true;
+        }
+    }
+    if (next == count) {
+        count = waveLanes(spawnRandom, lanes, waveTables);
+        for (int i = 0; i < count; i++) {
+            types[i] = waveType(spawnRandom, waveTables);
+        }
+        next = 0;
+        spawn.time = waveTime;
+        waveTime += settings.waveInterval;
+    } else {
+        spawn.time = waveTime - settings.waveInterval; // the rest of the current wave
+    }
+    spawn.speed = settings.cometSpeed * COMET_TYPE_SPEED[types[next]];
+    spawn.lane = (uint8_t)lanes[next++];
+    return true;
+}
+
+// Built-in wave scripts, resumed by updateGame alongside the level or random waves.
+// Each runs on the simulated clock from the start of the session.
+
+// A comet down the left lane, then all the others together, with the gap shrinking
+WaveScript scriptOpening() {
+    for (double gap = 2.0; gap > 0.6; gap *= 0.85) {
+        spawnComet(0);
+        co_await waitFor(0.5);
+        for (int lane = 1; lane < LANE_COUNT; lane++) {
+            spawnComet(lane);
+        }
+        co_await waitFor(gap);
+    }
+}
+
+// Lanes in order, back and forth, a little faster on every pass
+WaveScript scriptStaircase() {
+    float speed = settings.cometSpeed;
+    for (int pass = 0; pass < 12; pass++) {
+        for (int step = 0; step < LANE_COUNT; step++) {
+            spawnComet(pass % 2 == 0 ? step : LANE_COUNT - 1 - step, speed);
+            co_await waitFor(0.35);
+        }
+        speed *= 1.05f;
+        co_await waitFor(1.0);
+    }
+}
+
+// The outer lanes closing together, leaving the middle one open a moment longer each time
+WaveScript scriptPincer() {
+    for (int round = 0; round < 10; round++) {
+        spawnComet(0);
+        spawnComet(LANE_COUNT - 1);
+        co_await waitFor(0.4 + 0.05 * round);
+        spawnComet(LANE_COUNT / 2);
+        co_await waitFor(2.5);
+    }
+}
+
+const struct {
+    const char *name;
+    WaveScript (*make)();
+} WAVE_SCRIPTS[] = {{"opening", scriptOpening}, {"staircase", scriptStaircase}, {"pincer", scriptPincer}};
+
+// Start the named script; false, listing the names, when there is none or it could not be started
+bool startWaveScript(const string &name) {
+    for (const auto &script : WAVE_SCRIPTS) {
+        if (name == script.name) {
+            if (waveScripts.start(script.make())) {
+                return true;
+            }
+            cout << "Failed to start wave script " << name << " (" << waveScriptPool.failures << " frames not allocated)" << endl;
+            return false;
+        }
+    }
+    if (name != "list") {
+        cout << "Unknown wave script " << name << endl;
+    }
+    cout << "Wave scripts:";
+    for (const auto &script : WAVE_SCRIPTS) {
+        cout << " " << script.name;
+    }
+    cout << endl;
+    return false;
+}
+
+// Writes the random waves a seed produces over ten minutes as a level, at
+// millisecond ticks, as a starting point for designed levels
+bool exportLevel(const string &path, Pcg32 random) {
+    const uint32_t TICK_RATE = 1000;
+    vector<LevelSpawn> spawns;
+    for (double time = 0.0; time < 600.0; time += settings.waveInterval) {
+        int lanes[2];
+        int count = waveLanes(random, lanes, waveTables);
+        for (int i = 0; i < count; i++) {
+            float speed = settings.cometSpeed * COMET_TYPE_SPEED[waveType(random, waveTables)];
+            spawns.push_back({(uint32_t)(time * TICK_RATE + 0.5), (uint8_t)lanes[i], LEVEL_COMET, (uint16_t)speed});
+        }
+    }
+    return writeLevelFile(path, TICK_RATE, spawns);
+}
+
+// Advances game logic by one fixed tick of deltaTime seconds (spawning, comet movement, collision detection)
+void updateGame(float deltaTime) {
+    PROFILE_SCOPE("updateGame");
+    EntityPool &e = entities;
+
+    // Release every prefetched spawn due by the end of this tick
+    WaveSpawn wave;
+    while (waves.popUntil(simTime + deltaTime, wave)) {
+        spawnComet(wave.lane, wave.speed);
+        spawnsTaken++;
+    }
+    waveScripts.resume(simTime + deltaTime);
+
+    // Motion: move every moving archetype along its velocity, split across the job system
+    Archetypes::forEach([&]<typename A>() {
+        if constexpr (A::template has<Motion>) {
+            uint32_t first = e.archetypeStart[A::ID], last = e.archetypeStart[A::ID + 1];
+            jobs.parallelFor(last - first, MOTION_GRAIN, [&](uint32_t begin, uint32_t end) {
+                PROFILE_SCOPE("motion");
+                for (uint32_t i = first + begin; i < first + end; i++) {
+                    e.y[i] += e.vy[i] * deltaTime;
+                }
+            });
+        }
+    });
+    if (simulationLod.enabled && SimulationLod::anchorTick(simTick)) {
+        wakeAndSleep(deltaTime);
+    }
+    for (CometLane &cometLane : cometLanes) {
+        if (cometLane.mixed) {
+            cometLane.ring.reorder([&](EntityHandle comet) { return e.y[e.index(comet)]; });
+        }
+    }
+
+    // Broadphase: the lanes the ship passed through are walked from the bottom up to
+    // the first comet still above it, so each costs O(1) however full it is; free
+    // movers from nearby grid cells get the scalar test. Both are swept: the
+    // ship and every entity move in a straight line from last tick's position, and
+    // a hit is any moment of the tick their boxes overlap, so neither a lane change
+    // nor a comet falling further than its height in one tick can skip a collision.
+    uint32_t ship = e.index(spaceship);
+    float shipMoveX = e.x[ship] - e.prevX[ship], shipMoveY = e.y[ship] - e.prevY[ship];
+    float shipHalfW = e.width[ship] / 2, shipHalfH = e.height[ship] / 2;
+    int laneMin = LANES.laneAt(std::min(e.prevX[ship], e.x[ship]) - shipHalfW);
+    int laneMax = LANES.laneAt(std::max(e.prevX[ship], e.x[ship]) + shipHalfW);
+    broadphase.build(e, false, e.archetypeStart[ARCHETYPE_DORMANT]);
+    collisionCandidates.clear();
+    broadphase.queryCells(e.prevX[ship] + shipMoveX / 2, e.prevY[ship] + shipMoveY / 2, shipHalfW + fabs(shipMoveX) / 2,
+                          shipHalfH + fabs(shipMoveY) / 2, collisionCandidates);
+    collisionCandidates.erase(std::remove_if(collisionCandidates.begin(), collisionCandidates.end(), [&](uint32_t i) {
+        return !sweptOverlap(e.prevX[i] - e.prevX[ship], e.prevY[i] - e.prevY[ship],
+                             (e.x[i] - e.prevX[i]) - shipMoveX, (e.y[i] - e.prevY[i]) - shipMoveY,
+                             e.width[i] / 2 + shipHalfW, e.height[i] / 2 + shipHalfH);
+    }), collisionCandidates.end());
+    float shipTop = std::max(e.prevY[ship], e.y[ship]) + shipHalfH;
+    for (int l = std::max(laneMin, 0); l <= std::min(laneMax, LANE_COUNT - 1); l++) {
+        const LaneRing<EntityHandle, MAX_COMETS> &ring = cometLanes[l].ring;
+        for (uint32_t k = 0; k < ring.size(); k++) {
+            uint32_t i = e.index(ring[k]);
+            if (std::min(e.prevY[i], e.y[i]) - e.height[i] / 2 > shipTop) {
+                break; // this and every comet above it stayed clear of the ship all tick
+            }
+            if (sweptOverlap(e.prevX[i] - e.prevX[ship], e.prevY[i] - e.prevY[ship], (e.x[i] - e.prevX[i]) - shipMoveX,
+                             (e.y[i] - e.prevY[i]) - shipMoveY, e.width[i] / 2 + shipHalfW, e.height[i] / 2 + shipHalfH)) {
+                collisionCandidates.push_back(i);
+            }
+        }
+    }
+
+    // Narrow phase: of the pairs whose boxes met, keep those whose sprites share an
+    // opaque pixel at some moment of the tick, so transparent corners never touch
+    const AlphaMask &shipMask = collisionMasks[e.material[ship]];
+    collisionCandidates.erase(std::remove_if(collisionCandidates.begin(), collisionCandidates.end(), [&](uint32_t i) {
+        const AlphaMask &mask = materials[e.material[i]].layered ? asteroids.masks[asteroids.variantOf(e.handleOf[i])]
+                                                                 : collisionMasks[e.material[i]];
+        if (i == ship || !fitsMask(shipMask, e.width[ship], e.height[ship]) || !fitsMask(mask, e.width[i], e.height[i])) {
+            return false; // no mask at this size: the boxes decide
+        }
+        return !sweptMasksOverlap(shipMask, mask, e.prevX[i] - e.prevX[ship], e.prevY[i] - e.prevY[ship],
+                                  (e.x[i] - e.prevX[i]) - shipMoveX, (e.y[i] - e.prevY[i]) - shipMoveY);
+    }), collisionCandidates.end());
+
+    // Every hit is consumed. Highest index first so swap-removal never moves an unhandled hit.
+    std::sort(collisionCandidates.begin(), collisionCandidates.end(), std::greater<uint32_t>());
+    for (uint32_t i : collisionCandidates) {
+        if (i != ship && e.has(i, COMPONENT_COLLIDER)) {
+            events.publish(EVENT_COLLISION, (uint32_t)simTick, e.lane[ship], e.x[ship], e.y[ship]);
+            if (!gameOver) {
+                events.publish(EVENT_GAME_OVER, (uint32_t)simTick, e.lane[ship], e.x[ship], e.y[ship]);
+            }
+            gameOver = true;
+            cout << "Game Over!" << endl;
+            despawnComet(i);
+            ship = e.index(spaceship);
+        }
+    }
+
+    // Lifetime: return comets that left the screen to the pool. They are at the front
+    // of their lanes; highest index first, so removal never moves one still to go.
+    expiredComets.clear();
+    for (CometLane &cometLane : cometLanes) {
+        for (uint32_t k = 0; k < cometLane.ring.size() && e.y[e.index(cometLane.ring[k])] < settings.despawnY; k++) {
+            expiredComets.push_back(e.index(cometLane.ring[k]));
+        }
+    }
+    std::sort(expiredComets.begin(), expiredComets.end(), std::greater<uint32_t>());
+    for (uint32_t i : expiredComets) {
+        despawnComet(i);
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <GLFW/glfw3.h>
+
+// Game time as raw glfwGetTimerValue() ticks. Instants and durations stay 64-bit
+// integers, so their resolution is the timer's however long the process has been
+// up; only short durations are ever turned into seconds.
+struct GameClock {
+    uint64_t frequency = 1; // ticks per second
+    uint64_t start = 0;     // timer value at setup()
+
+    void setup() {
+        frequency = glfwGetTimerFrequency();
+        start = glfwGetTimerValue();
+    }
+
+    uint64_t now() const {
+        return glfwGetTimerValue();
+    }
+
+    // Duration in ticks, rounded to the nearest tick
+    uint64_t ticks(double seconds) const {
+        return (uint64_t)(seconds * frequency + 0.5);
+    }
+
+    // Seconds in a duration; pass differences, not absolute timer values
+    double seconds(uint64_t duration) const {
+        return (double)duration / frequency;
+    }
+
+    // Signed seconds from one instant to another, for instants that may be out of order
+    double secondsBetween(uint64_t from, uint64_t to) const {
+        return (double)(int64_t)(to - from) / frequency;
+    }
+};
+
+inline GameClock gameClock;
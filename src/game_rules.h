@@ -0,0 +1,110 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include "alias_table.h"
+#include "lane_layout.h"
+#include "random.h"
+
+// The rules of a run, shared by the interactive game and the headless runners:
+// playfield and lane geometry, ship and comet boxes and speeds, the lane glide and
+// the random wave pattern. Anything that changes how a run plays out belongs here,
+// so every mode simulates the same game.
+
+// Number of lanes; build with -DSPACE_TRAVEL_LANES=5 (or 7) for a wider road
+#ifndef SPACE_TRAVEL_LANES
+#define SPACE_TRAVEL_LANES 3
+#endif
+
+// Window dimensions and the lane tables across them
+constexpr unsigned WIDTH = 800, HEIGHT = 600;
+constexpr LaneLayout<SPACE_TRAVEL_LANES> LANES(WIDTH);
+constexpr int LANE_COUNT = LANES.COUNT;
+constexpr float LANE_WIDTH = LANES.width;
+
+// Seconds the ship takes to glide from one lane centre to the next
+constexpr float LANE_TRANSITION_TIME = 0.12f;
+
+// Comet fall speed in pixels per second
+constexpr float COMET_SPEED = 300.0f;
+
+// Comet spawning: pool capacity, seconds between waves, and spawn/despawn heights
+constexpr int MAX_COMETS = 256;
+constexpr float WAVE_INTERVAL = 0.6f;
+constexpr float SPAWN_Y = HEIGHT + 50;
+constexpr float DESPAWN_Y = -50;
+
+// Ship height above the bottom edge, and the square boxes of ship and comets
+constexpr float SHIP_Y = 50.0f, SHIP_SIZE = 50.0f, COMET_SIZE = 50.0f;
+
+// The ship's glide towards its lane centre, advanced by the simulation each tick
+struct LaneTransition {
+    float fromX = 0.0f, toX = 0.0f;
+    float elapsed = LANE_TRANSITION_TIME; // seconds since the move started; settled once it reaches the duration
+};
+
+// Position along a lane change of duration seconds after elapsed, eased in and out
+inline float laneTransitionX(float fromX, float toX, float elapsed, float duration = LANE_TRANSITION_TIME) {
+    float t = std::min(elapsed / duration, 1.0f);
+    return fromX + t * t * (3.0f - 2.0f * t) * (toX - fromX);
+}
+
+// Kinds of comet a random wave releases, told apart by how fast they fall
+enum CometType { COMET_SLOW, COMET_NORMAL, COMET_FAST, COMET_TYPE_COUNT };
+constexpr float COMET_TYPE_SPEED[COMET_TYPE_COUNT] = {0.7f, 1.0f, 1.4f}; // of the comet speed
+
+// How random waves spread over lanes and comet types, as relative weights. The
+// default is the original game: every lane alike and only normal comets.
+struct WaveMix {
+    float lanes[LANE_COUNT];
+    float types[COMET_TYPE_COUNT] = {0.0f, 1.0f, 0.0f};
+
+    WaveMix() {
+        for (float &w : lanes) {
+            w = 1.0f;
+        }
+    }
+};
+
+// A WaveMix as alias tables, built once per mix so a wave costs a lookup per draw
+// however the weights are skewed. The second comet of a pair comes from the table of
+// the lanes other than the first, by offset from it, so the pair is always two
+// distinct lanes and a uniform mix draws exactly what the unweighted waves did. A
+// one-lane build has no other lane: its tables have a single unused outcome.
+struct WaveTables {
+    static constexpr int OTHERS = LANE_COUNT > 1 ? LANE_COUNT - 1 : 1;
+
+    AliasTable<LANE_COUNT> lanes;
+    AliasTable<OTHERS> others[LANE_COUNT]; // by first lane: lane first + 1 + outcome, wrapped
+    AliasTable<COMET_TYPE_COUNT> types;
+
+    explicit WaveTables(const WaveMix &mix = WaveMix()) : lanes(mix.lanes), types(mix.types) {
+        for (int first = 0; first < LANE_COUNT; first++) {
+            float weights[OTHERS];
+            for (int k = 0; k < OTHERS; k++) {
+                weights[k] = mix.lanes[(first + 1 + k) % LANE_COUNT];
+            }
+            others[first].build(weights);
+        }
+    }
+};
+
+inline const WaveTables UNIFORM_WAVES; // the compiled rules, which the headless runners keep
+
+// Picks one or two distinct random lanes for a wave, always leaving a lane open when
+// there is more than one, by tables' weights; returns how many it wrote to lanes
+inline int waveLanes(Pcg32 &random, int lanes[2], const WaveTables &tables = UNIFORM_WAVES) {
+    uint32_t rolls[3]; // first lane, whether there is a second comet, which other lane
+    random.fill(rolls, 3);
+    lanes[0] = (int)tables.lanes.sample(rolls[0]);
+    if (LANE_COUNT < 2 || !Pcg32::below(rolls[1], 2)) {
+        return 1;
+    }
+    lanes[1] = (lanes[0] + 1 + (int)tables.others[lanes[0]].sample(rolls[2])) % LANE_COUNT;
+    return 2;
+}
+
+// The type of a wave's comet; draws nothing when the mix allows only one
+inline CometType waveType(Pcg32 &random, const WaveTables &tables) {
+    return (CometType)(tables.types.certain() ? tables.types.sample(0u) : tables.types.sample(random.next()));
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include "game_rules.h"
+#include "state_hash.h"
+
+// Per-cabinet tuning of the run, read once at startup from an INI file so operators
+// can retune without a rebuild. Flat POD whose defaults are game_rules.h's constants;
+// the game reads plain fields on its hot paths and never goes back to the file.
+// Format, '#' or ';' starts a comment, keys outside the table are errors:
+//
+//   [ship]
+//   y = 50               ; height above the bottom edge
+//   size = 50
+//   lane_transition = 0.12
+//   [comets]
+//   speed = 300          ; pixels per second
+//   size = 50
+//   wave_interval = 0.6
+//   spawn_y = 650
+//   despawn_y = -50
+//   [waves]
+//   lane_0 = 1           ; relative weight of each lane in random waves
+//   lane_1 = 2
+//   slow = 1             ; and of each comet type: slow, normal, fast
+//   normal = 3
+//
+// The window size, lane count and pool capacities stay compile-time: lane tables
+// and pools are sized from them. The headless runners (batch_env.h, monte_carlo.h)
+// keep the compiled rules. Replays and races carry fingerprint() and refuse a
+// recording or a rival whose settings differ.
+struct GameSettings {
+    float shipY = SHIP_Y, shipSize = SHIP_SIZE, laneTransitionTime = LANE_TRANSITION_TIME;
+    float cometSpeed = COMET_SPEED, cometSize = COMET_SIZE, waveInterval = WAVE_INTERVAL;
+    float spawnY = SPAWN_Y, despawnY = DESPAWN_Y;
+    WaveMix waves; // weights of the random waves' lanes and comet types
+
+    struct Key {
+        const char *section, *name;
+        float GameSettings::*field;
+        float min; // smallest value accepted
+    };
+    static constexpr Key KEYS[] = {
+        {"ship", "y", &GameSettings::shipY, 0.0f},
+        {"ship", "size", &GameSettings::shipSize, 1.0f},
+        {"ship", "lane_transition", &GameSettings::laneTransitionTime, 0.001f},
+        {"comets", "speed", &GameSettings::cometSpeed, 1.0f},
+        {"comets", "size", &GameSettings::cometSize, 1.0f},
+        {"comets", "wave_interval", &GameSettings::waveInterval, 0.05f},
+        {"comets", "spawn_y", &GameSettings::spawnY, (float)HEIGHT},
+        {"comets", "despawn_y", &GameSettings::despawnY, -1e6f},
+    };
+
+    // Apply the file's values over the current ones. False if it cannot be read or a
+    // line is malformed, with error naming the line; values before it are kept.
+    bool load(const std::string &path, std::string &error) {
+        FILE *in = std::fopen(path.c_str(), "r");
+        if (!in) {
+            error = "cannot read " + path;
+            return false;
+        }
+        char line[256], section[32] = "";
+        bool ok = true;
+        for (int number = 1; ok && std::fgets(line, sizeof(line), in); number++) {
+            line[std::strcspn(line, "#;\r\n")] = '\0';
+            char *text = line + std::strspn(line, " \t");
+            if (*text == '\0') {
+                continue;
+            }
+            char name[32], rest[2];
+            float value;
+            if (std::sscanf(text, "[%31[^]]]%1s", section, rest) == 1) {
+                continue;
+            }
+            ok = std::sscanf(text, "%31[a-z0-9_] = %f%1s", name, &value, rest) == 2 && set(section, name, value);
+            if (!ok) {
+                error = path + ":" + std::to_string(number) + ": bad setting '" + text + "'";
+            }
+        }
+        std::fclose(in);
+        if (ok && despawnY >= spawnY) {
+            error = path + ": comets.despawn_y must be below comets.spawn_y";
+            ok = false;
+        }
+        return ok;
+    }
+
+    bool set(const char *section, const char *name, float value) {
+        if (std::strcmp(section, "waves") == 0) {
+            return setWave(name, value);
+        }
+        for (const Key &key : KEYS) {
+            if (std::strcmp(section, key.section) == 0 && std::strcmp(name, key.name) == 0) {
+                if (value < key.min) {
+                    return false;
+                }
+                this->*key.field = value;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Hash of every field, so two sessions can tell whether they simulate alike
+    uint32_t fingerprint() const {
+        StateHash hash;
+        for (const Key &key : KEYS) {
+            hash.add(this->*key.field);
+        }
+        hash.add(waves.lanes);
+        hash.add(waves.types);
+        return hash.folded();
+    }
+
+    // lane_N for the lanes this build has, or a comet type's name
+    bool setWave(const char *name, float value) {
+        static const char *const TYPES[COMET_TYPE_COUNT] = {"slow", "normal", "fast"};
+        int lane;
+        char rest[2];
+        if (value < 0.0f) {
+            return false;
+        }
+        if (std::sscanf(name, "lane_%d%1s", &lane, rest) == 1 && lane >= 0 && lane < LANE_COUNT) {
+            waves.lanes[lane] = value;
+            return true;
+        }
+        for (int t = 0; t < COMET_TYPE_COUNT; t++) {
+            if (std::strcmp(name, TYPES[t]) == 0) {
+                waves.types[t] = value;
+                return true;
+            }
+        }
+        return false;
+    }
+};
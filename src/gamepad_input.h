@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <GLFW/glfw3.h>
+#include "input_queue.h"
+
+// Turns connected gamepads into the same lane-change presses as the arrow keys.
+// Each pad's d-pad or left stick is reduced to a direction (left, right or none),
+// and only a change into left or right pushes an event, so holding the stick does
+// not repeat. The stick uses hysteresis so noise around the threshold cannot
+// chatter. State is a fixed array sized for every GLFW joystick slot; polling
+// allocates nothing.
+struct GamepadInput {
+    static constexpr float PRESS_THRESHOLD = 0.5f;   // stick deflection that counts as a press
+    static constexpr float RELEASE_THRESHOLD = 0.3f; // deflection it must fall under to release
+
+    int direction[GLFW_JOYSTICK_LAST + 1] = {}; // GLFW_KEY_LEFT, GLFW_KEY_RIGHT or 0, per slot
+
+    // Sample every pad and queue its new presses. GLFW only allows joystick
+    // functions on the main thread, so this runs there, next to glfwPollEvents.
+    void poll(InputQueue &queue) {
+        uint64_t now = glfwGetTimerValue();
+        for (int jid = GLFW_JOYSTICK_1; jid <= GLFW_JOYSTICK_LAST; jid++) {
+            GLFWgamepadstate state;
+            if (!glfwJoystickIsGamepad(jid) || !glfwGetGamepadState(jid, &state)) {
+                direction[jid] = 0;
+                continue;
+            }
+            int held = heldDirection(state, direction[jid]);
+            if (held != direction[jid] && held != 0) {
+                queue.push({now, held});
+            }
+            direction[jid] = held;
+        }
+    }
+
+    // Direction the pad is held in, given the one it was held in last poll
+    static int heldDirection(const GLFWgamepadstate &state, int previous) {
+        bool left = state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_LEFT] == GLFW_PRESS;
+        bool right = state.buttons[GLFW_GAMEPAD_BUTTON_DPAD_RIGHT] == GLFW_PRESS;
+        if (left != right) {
+            return left ? GLFW_KEY_LEFT : GLFW_KEY_RIGHT;
+        }
+        float x = state.axes[GLFW_GAMEPAD_AXIS_LEFT_X];
+        if (x <= -PRESS_THRESHOLD || (previous == GLFW_KEY_LEFT && x < -RELEASE_THRESHOLD)) {
+            return GLFW_KEY_LEFT;
+        }
+        if (x >= PRESS_THRESHOLD || (previous == GLFW_KEY_RIGHT && x > RELEASE_THRESHOLD)) {
+            return GLFW_KEY_RIGHT;
+        }
+        return 0;
+    }
+};
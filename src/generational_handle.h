@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+
+// 32-bit generational handles, shared by the pools that hand out stable names for
+// things that move or are recycled: entities, transform nodes, asset textures. The
+// low HANDLE_INDEX_BITS are the slot in the pool's indirection array and the top
+// bits the slot's generation, bumped each time the slot is freed. Each pool stores
+// the live generation in the same 32-bit entry as whatever the slot resolves to (a
+// dense index, a free-list link), so a lookup is one load and a stale handle, kept
+// past its object's end, is caught by one compare of the high bits rather than
+// silently resolving to whatever took the slot next. With 8 generation bits a slot
+// has to be reused 256 times before a handle that old could pass. Generation 0 is
+// the first, so pools saved before handles had generations load unchanged.
+constexpr uint32_t HANDLE_INDEX_BITS = 24;
+constexpr uint32_t HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1; // also the "no slot" link
+constexpr uint32_t HANDLE_GENERATION_ONE = 1u << HANDLE_INDEX_BITS;
+
+constexpr uint32_t makeHandle(uint32_t index, uint32_t generation) {
+    return generation << HANDLE_INDEX_BITS | index;
+}
+
+constexpr uint32_t handleIndex(uint32_t handle) {
+    return handle & HANDLE_INDEX_MASK;
+}
+
+constexpr uint32_t handleGeneration(uint32_t handle) {
+    return handle >> HANDLE_INDEX_BITS;
+}
+
+// entry with its low bits replaced by index, keeping its generation
+constexpr uint32_t withIndex(uint32_t entry, uint32_t index) {
+    return (entry & ~HANDLE_INDEX_MASK) | index;
+}
+
+// True when entry and handle are of the same generation; their index bits are ignored
+constexpr bool sameGeneration(uint32_t entry, uint32_t handle) {
+    return ((entry ^ handle) >> HANDLE_INDEX_BITS) == 0;
+}
+
+// A freed slot's entry: the next generation, linked to next (HANDLE_INDEX_MASK for none)
+constexpr uint32_t retiredEntry(uint32_t entry, uint32_t next) {
+    return withIndex(entry + HANDLE_GENERATION_ONE, next);
+}
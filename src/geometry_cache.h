@@ -0,0 +1,104 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <glad/glad.h>
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "sprite_outline.h"
+
+// Vertex buffer plus vertex array for one piece of static geometry.
+// Owns its GL objects and deletes them when destroyed.
+struct Mesh {
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLsizei vertexCount = 0;
+
+    Mesh() = default;
+    Mesh(const Mesh &) = delete;
+    Mesh &operator=(const Mesh &) = delete;
+
+    ~Mesh() {
+        if (VAO) {
+            memoryStats.untrackGl(GL_VERTEX_ARRAY, VAO);
+            glState.deleteVertexArrays(1, &VAO);
+        }
+        if (VBO) {
+            memoryStats.untrackGl(GL_BUFFER, VBO);
+            glState.deleteBuffers(1, &VBO);
+        }
+    }
+
+    // Upload interleaved position (xyz) + texture coordinate (st) vertices
+    void upload(const GLfloat *vertices, GLsizei count) {
+        vertexCount = count;
+
+        VBO = createBuffer(GL_ARRAY_BUFFER, count * 5 * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+        memoryStats.trackGl(GL_BUFFER, VBO, MEM_BUFFERS, count * 5 * sizeof(GLfloat));
+
+        VAO = createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, VAO, MEM_BUFFERS, 0);
+        bindAttribs(VAO);
+    }
+
+    // Point attributes 0 (position) and 1 (texture coordinates) of a vertex array at this mesh's VBO
+    void bindAttribs(GLuint array) const {
+        vertexAttrib(array, 0, 3, VBO, 5 * sizeof(GLfloat), 0);
+        vertexAttrib(array, 1, 2, VBO, 5 * sizeof(GLfloat), 3 * sizeof(GLfloat));
+    }
+};
+
+// Builds shared geometry once on first use and hands out references to it
+struct GeometryCache {
+    // Sprite outlines kept after the quad in its buffer, so every VAO built on the quad
+    // can draw them too, by first vertex and count
+    static const int OUTLINE_SLOTS = 8;
+
+    // Unit quad centred on the origin, as a 4-vertex triangle strip
+    static constexpr GLfloat QUAD[20] = {
+        -0.5, -0.5, 0.0, 0.0, 0.0, // V0
+        -0.5,  0.5, 0.0, 0.0, 1.0, // V1
+         0.5, -0.5, 0.0, 1.0, 0.0, // V2
+         0.5,  0.5, 0.0, 1.0, 1.0  // V3
+    };
+
+    std::unique_ptr<Mesh> quad;
+
+    // The unit quad; its buffer goes on with OUTLINE_SLOTS strips of up to
+    // SpriteOutline::MAX_VERTICES vertices, each a copy of the quad until setOutline()
+    const Mesh &unitQuad() {
+        if (!quad) {
+            std::vector<GLfloat> vertices((size_t)outlineFirst(OUTLINE_SLOTS) * 5);
+            std::copy(QUAD, QUAD + 20, vertices.begin());
+            for (int slot = 0; slot < OUTLINE_SLOTS; slot++) {
+                std::copy(QUAD, QUAD + 20, vertices.begin() + outlineFirst(slot) * 5);
+            }
+            quad.reset(new Mesh());
+            quad->upload(vertices.data(), (GLsizei)(vertices.size() / 5));
+            quad->vertexCount = 4;
+        }
+        return *quad;
+    }
+
+    // First vertex of an outline slot in the quad's buffer
+    static GLint outlineFirst(int slot) {
+        return 4 + slot * SpriteOutline::MAX_VERTICES;
+    }
+
+    // Store an outline in its slot, or the quad again if it is empty; returns the
+    // strip's vertex count
+    GLsizei setOutline(int slot, const SpriteOutline &outline) {
+        GLfloat vertices[SpriteOutline::MAX_VERTICES * 5];
+        int count = outline.stripVertices(vertices);
+        const Mesh &mesh = unitQuad();
+        bufferSubData(GL_ARRAY_BUFFER, mesh.VBO, outlineFirst(slot) * 5 * sizeof(GLfloat), (count ? count : 4) * 5 * sizeof(GLfloat),
+                      count ? vertices : QUAD);
+        return count ? count : 4;
+    }
+
+    // Delete every cached GL object; must run while the context is still current
+    void release() {
+        quad.reset();
+    }
+};
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+#include <glad/glad.h>
+#include "shard_counters.h"
+
+// GL call counter for trace builds (-DSPACE_TRAVEL_GL_TRACE). The vendored glad is
+// generated without debug callbacks, so install() does what glad's debug mode would:
+// it swaps each glad_gl* function pointer the game uses for a wrapper that counts
+// the call, then forwards to the driver. Bind calls are checked against a shadow of
+// the current bindings and counted as redundant when they rebind what is already
+// bound. With checkErrors every call is followed by glGetError.
+struct GlCallStats {
+    struct Function {
+        const char *name;
+        uint64_t frameCalls = 0, totalCalls = 0;
+        uint64_t redundant = 0; // total redundant binds
+        uint64_t errors = 0;
+    };
+
+    // Counts of one completed frame, for the overlay
+    struct Frame {
+        uint64_t calls = 0, redundant = 0;
+    };
+
+    static const GLuint UNITS = 32;
+
+    bool enabled = false, checkErrors = false;
+    std::vector<Function> functions;
+    Frame current, last;
+    uint64_t frames = 0;
+
+    // Shadow of the bindings the hooks can see
+    GLuint vertexArray = 0, program = 0, framebuffer = 0, activeUnit = 0;
+    GLuint textures[UNITS] = {}, samplers[UNITS] = {}; // GL_TEXTURE_2D per unit
+    std::unordered_map<GLenum, GLuint> buffers; // by target
+
+    int add(const char *name) {
+        functions.push_back({name});
+        return (int)functions.size() - 1;
+    }
+
+    void count(int id) {
+        functions[id].frameCalls++;
+        current.calls++;
+        counters.add(COUNTER_GL_CALLS);
+    }
+
+    void afterCall(int id) {
+        if (!checkErrors) {
+            return;
+        }
+        for (GLenum error = glad_glGetError(); error != GL_NO_ERROR; error = glad_glGetError()) {
+            if (functions[id].errors++ < 4) {
+                printf("GL error 0x%04x after %s\n", error, functions[id].name);
+            }
+        }
+    }
+
+    // Record a bind to the shadowed slot; true if it was already bound
+    bool bind(int id, GLuint &slot, GLuint name) {
+        bool same = slot == name;
+        slot = name;
+        if (same) {
+            functions[id].redundant++;
+            current.redundant++;
+        }
+        return same;
+    }
+
+    // Deleted names revert their bindings to 0, as GL does
+    static void forget(GLuint &slot, GLsizei count, const GLuint *names) {
+        for (GLsizei i = 0; i < count; i++) {
+            if (slot == names[i]) {
+                slot = 0;
+            }
+        }
+    }
+
+    // Close the frame: keep its totals for the overlay and reset the frame counters
+    void endFrame() {
+        if (!enabled) {
+            return;
+        }
+        last = current;
+        current = {};
+        frames++;
+        for (Function &f : functions) {
+            f.totalCalls += f.frameCalls;
+            f.frameCalls = 0;
+        }
+    }
+
+    // Most called functions, per frame on average, with their redundant binds
+    void print(size_t top = 20) const {
+        if (!enabled || frames == 0) {
+            return;
+        }
+        std::vector<const Function *> order;
+        for (const Function &f : functions) {
+            if (f.totalCalls) {
+                order.push_back(&f);
+            }
+        }
+        std::sort(order.begin(), order.end(),
+                  [](const Function *a, const Function *b) { return a->totalCalls > b->totalCalls; });
+        printf("%-28s %10s %10s %10s %6s\n", "gl call", "calls", "per frame", "redundant", "errors");
+        for (size_t i = 0; i < order.size() && i < top; i++) {
+            const Function &f = *order[i];
+            printf("%-28s %10llu %10.1f %10llu %6llu\n", f.name, (unsigned long long)f.totalCalls,
+                   (double)f.totalCalls / frames, (unsigned long long)f.redundant, (unsigned long long)f.errors);
+        }
+    }
+
+    void install(bool checkGlErrors);
+};
+
+inline GlCallStats glCalls;
+
+// Counting wrapper for one glad function pointer; real holds the driver's entry point
+template <auto *Slot, typename F = std::remove_pointer_t<decltype(Slot)>>
+struct GlHook;
+
+template <auto *Slot, typename R, typename... Args>
+struct GlHook<Slot, R (APIENTRYP)(Args...)> {
+    static inline R (APIENTRYP real)(Args...) = nullptr;
+    static inline int id = -1;
+
+    static R APIENTRY call(Args... args) {
+        glCalls.count(id);
+        if constexpr (std::is_void_v<R>) {
+            real(args...);
+            glCalls.afterCall(id);
+        } else {
+            R result = real(args...);
+            glCalls.afterCall(id);
+            return result;
+        }
+    }
+
+    static void install(const char *name) {
+        if (*Slot && !real) {
+            real = *Slot;
+            id = glCalls.add(name);
+            *Slot = call;
+        }
+    }
+};
+
+#define GL_HOOK(function) GlHook<&glad_##function>::install(#function)
+#define GL_FORWARD(function, ...) GlHook<&glad_##function>::call(__VA_ARGS__)
+#define GL_HOOK_ID(function) GlHook<&glad_##function>::id
+
+// Bind and delete wrappers that keep the shadow bindings up to date
+inline void APIENTRY hookBindVertexArray(GLuint array) {
+    glCalls.bind(GL_HOOK_ID(glBindVertexArray), glCalls.vertexArray, array);
+    glCalls.buffers.erase(GL_ELEMENT_ARRAY_BUFFER); // part of the vertex array's state
+    GL_FORWARD(glBindVertexArray, array);
+}
+
+inline void APIENTRY hookUseProgram(GLuint program) {
+    glCalls.bind(GL_HOOK_ID(glUseProgram), glCalls.program, program);
+    GL_FORWARD(glUseProgram, program);
+}
+
+inline void APIENTRY hookBindFramebuffer(GLenum target, GLuint framebuffer) {
+    if (target == GL_FRAMEBUFFER) {
+        glCalls.bind(GL_HOOK_ID(glBindFramebuffer), glCalls.framebuffer, framebuffer);
+    } else {
+        glCalls.framebuffer = ~0u; // read and draw bindings differ until both are set again
+    }
+    GL_FORWARD(glBindFramebuffer, target, framebuffer);
+}
+
+inline void APIENTRY hookActiveTexture(GLenum unit) {
+    glCalls.activeUnit = std::min<GLuint>(unit - GL_TEXTURE0, GlCallStats::UNITS - 1);
+    GL_FORWARD(glActiveTexture, unit);
+}
+
+inline void APIENTRY hookBindTexture(GLenum target, GLuint texture) {
+    if (target == GL_TEXTURE_2D) {
+        glCalls.bind(GL_HOOK_ID(glBindTexture), glCalls.textures[glCalls.activeUnit], texture);
+    }
+    GL_FORWARD(glBindTexture, target, texture);
+}
+
+inline void APIENTRY hookBindSampler(GLuint unit, GLuint sampler) {
+    glCalls.bind(GL_HOOK_ID(glBindSampler), glCalls.samplers[std::min(unit, GlCallStats::UNITS - 1)], sampler);
+    GL_FORWARD(glBindSampler, unit, sampler);
+}
+
+inline void APIENTRY hookBindBuffer(GLenum target, GLuint buffer) {
+    glCalls.bind(GL_HOOK_ID(glBindBuffer), glCalls.buffers[target], buffer);
+    GL_FORWARD(glBindBuffer, target, buffer);
+}
+
+inline void APIENTRY hookBindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+    glCalls.buffers[target] = buffer; // also binds the generic target; never redundant itself
+    GL_FORWARD(glBindBufferBase, target, index, buffer);
+}
+
+inline void APIENTRY hookDeleteVertexArrays(GLsizei n, const GLuint *arrays) {
+    GlCallStats::forget(glCalls.vertexArray, n, arrays);
+    GL_FORWARD(glDeleteVertexArrays, n, arrays);
+}
+
+inline void APIENTRY hookDeleteTextures(GLsizei n, const GLuint *textures) {
+    for (GLuint &slot : glCalls.textures) {
+        GlCallStats::forget(slot, n, textures);
+    }
+    GL_FORWARD(glDeleteTextures, n, textures);
+}
+
+inline void APIENTRY hookDeleteBuffers(GLsizei n, const GLuint *buffers) {
+    for (auto &binding : glCalls.buffers) {
+        GlCallStats::forget(binding.second, n, buffers);
+    }
+    GL_FORWARD(glDeleteBuffers, n, buffers);
+}
+
+inline void APIENTRY hookDeleteSamplers(GLsizei n, const GLuint *samplers) {
+    for (GLuint &slot : glCalls.samplers) {
+        GlCallStats::forget(slot, n, samplers);
+    }
+    GL_FORWARD(glDeleteSamplers, n, samplers);
+}
+
+inline void APIENTRY hookDeleteFramebuffers(GLsizei n, const GLuint *framebuffers) {
+    GlCallStats::forget(glCalls.framebuffer, n, framebuffers);
+    GL_FORWARD(glDeleteFramebuffers, n, framebuffers);
+}
+
+// Hook every GL function the game calls; after loadUsedGl, before any GL use
+inline void GlCallStats::install(bool checkGlErrors) {
+    enabled = true;
+    checkErrors = checkGlErrors;
+
+    // State and binds, checked for redundancy
+    GL_HOOK(glBindVertexArray);
+    GL_HOOK(glUseProgram);
+    GL_HOOK(glBindFramebuffer);
+    GL_HOOK(glActiveTexture);
+    GL_HOOK(glBindTexture);
+    GL_HOOK(glBindSampler);
+    GL_HOOK(glBindBuffer);
+    GL_HOOK(glBindBufferBase);
+    GL_HOOK(glDeleteVertexArrays);
+    GL_HOOK(glDeleteTextures);
+    GL_HOOK(glDeleteBuffers);
+    GL_HOOK(glDeleteSamplers);
+    GL_HOOK(glDeleteFramebuffers);
+    glad_glBindVertexArray = hookBindVertexArray;
+    glad_glUseProgram = hookUseProgram;
+    glad_glBindFramebuffer = hookBindFramebuffer;
+    glad_glActiveTexture = hookActiveTexture;
+    glad_glBindTexture = hookBindTexture;
+    glad_glBindSampler = hookBindSampler;
+    glad_glBindBuffer = hookBindBuffer;
+    glad_glBindBufferBase = hookBindBufferBase;
+    glad_glDeleteVertexArrays = hookDeleteVertexArrays;
+    glad_glDeleteTextures = hookDeleteTextures;
+    glad_glDeleteBuffers = hookDeleteBuffers;
+    glad_glDeleteSamplers = hookDeleteSamplers;
+    glad_glDeleteFramebuffers = hookDeleteFramebuffers;
+
+    // Draws and per-frame work
+    GL_HOOK(glDrawArrays);
+    GL_HOOK(glDrawArraysInstanced);
+    GL_HOOK(glDrawArraysIndirect);
+    GL_HOOK(glDrawTransformFeedback);
+    GL_HOOK(glClear);
+    GL_HOOK(glViewport);
+    GL_HOOK(glEnable);
+    GL_HOOK(glDisable);
+    GL_HOOK(glBlendFunc);
+    GL_HOOK(glDepthMask);
+    GL_HOOK(glBlitFramebuffer);
+    GL_HOOK(glQueryCounter);
+    GL_HOOK(glUniform1i);
+    GL_HOOK(glUniform1f);
+    GL_HOOK(glUniform2fv);
+    GL_HOOK(glUniform4fv);
+    GL_HOOK(glUniform4iv);
+    GL_HOOK(glUniformMatrix4fv);
+    GL_HOOK(glBufferData);
+    GL_HOOK(glBufferSubData);
+    GL_HOOK(glMapBufferRange);
+    GL_HOOK(glUnmapBuffer);
+    GL_HOOK(glFenceSync);
+    GL_HOOK(glClientWaitSync);
+    GL_HOOK(glDeleteSync);
+    GL_HOOK(glBeginTransformFeedback);
+    GL_HOOK(glEndTransformFeedback);
+    GL_HOOK(glBindTransformFeedback);
+    GL_HOOK(glBeginQuery);
+    GL_HOOK(glEndQuery);
+    GL_HOOK(glGetQueryObjectuiv);
+    GL_HOOK(glGetQueryObjectui64v);
+    GL_HOOK(glTexSubImage2D);
+    GL_HOOK(glTexSubImage3D);
+    GL_HOOK(glPixelStorei);
+    GL_HOOK(glFinish);
+    GL_HOOK(glFlush);
+
+    // Resource creation and setup
+    GL_HOOK(glGenVertexArrays);
+    GL_HOOK(glGenBuffers);
+    GL_HOOK(glGenTextures);
+    GL_HOOK(glGenSamplers);
+    GL_HOOK(glGenQueries);
+    GL_HOOK(glGenTransformFeedbacks);
+    GL_HOOK(glDeleteTransformFeedbacks);
+    GL_HOOK(glGenFramebuffers);
+    GL_HOOK(glGenRenderbuffers);
+    GL_HOOK(glBindRenderbuffer);
+    GL_HOOK(glRenderbufferStorage);
+    GL_HOOK(glRenderbufferStorageMultisample);
+    GL_HOOK(glFramebufferRenderbuffer);
+    GL_HOOK(glFramebufferTexture2D);
+    GL_HOOK(glFramebufferTextureLayer);
+    GL_HOOK(glCheckFramebufferStatus);
+    GL_HOOK(glDeleteRenderbuffers);
+    GL_HOOK(glDeleteQueries);
+    GL_HOOK(glTexImage2D);
+    GL_HOOK(glTexImage3D);
+    GL_HOOK(glCompressedTexSubImage2D);
+    GL_HOOK(glTexParameteri);
+    GL_HOOK(glGenerateMipmap);
+    GL_HOOK(glSamplerParameteri);
+    GL_HOOK(glVertexAttribPointer);
+    GL_HOOK(glVertexAttribDivisor);
+    GL_HOOK(glVertexAttribIPointer);
+    GL_HOOK(glEnableVertexAttribArray);
+    GL_HOOK(glCreateShader);
+    GL_HOOK(glShaderSource);
+    GL_HOOK(glCompileShader);
+    GL_HOOK(glGetShaderiv);
+    GL_HOOK(glGetShaderInfoLog);
+    GL_HOOK(glCreateProgram);
+    GL_HOOK(glAttachShader);
+    GL_HOOK(glDetachShader);
+    GL_HOOK(glTransformFeedbackVaryings);
+    GL_HOOK(glLinkProgram);
+    GL_HOOK(glGetProgramiv);
+    GL_HOOK(glGetProgramInfoLog);
+    GL_HOOK(glGetActiveUniform);
+    GL_HOOK(glGetUniformLocation);
+    GL_HOOK(glGetUniformBlockIndex);
+    GL_HOOK(glUniformBlockBinding);
+    GL_HOOK(glDeleteShader);
+    GL_HOOK(glDeleteProgram);
+    GL_HOOK(glGetIntegerv);
+    GL_HOOK(glGetString);
+}
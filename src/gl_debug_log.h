@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "profiler.h"
+
+#ifndef GL_DEBUG_TYPE_PERFORMANCE
+#define GL_DEBUG_TYPE_PERFORMANCE 0x8250
+#endif
+
+// Driver performance warnings (shader recompiles, buffer migrations, implicit syncs)
+// caught through KHR_debug. Output is synchronous, so the callback runs inside the GL
+// call that raised the message, on the thread that made it: each warning is tagged
+// with that thread's active profiler zone and the frame number, marked in the
+// profiler's trace and counted for the overlay. The first few are also printed. With
+// printOthers (--gl-debug) every other message but notifications is printed as well;
+// otherwise the driver is asked for performance messages alone. The latest few are
+// kept whole, with when they came, for the hitch log.
+struct GlDebugLog {
+    static const uint64_t PRINT_LIMIT = 8; // warnings echoed to stdout; the trace keeps them all
+    static constexpr int RECENT = 8;       // warnings kept for the hitch log
+
+    struct Warning {
+        uint64_t time; // profileTicks()
+        const char *zone;
+        GLuint id;
+        char text[160];
+    };
+
+    bool enabled = false, printOthers = false;
+    uint64_t frame = 0;     // frames ended so far
+    uint64_t warnings = 0;  // performance warnings ever
+    uint32_t frameWarnings = 0, lastFrameWarnings = 0;
+    const char *lastZone = nullptr; // zone of the latest warning
+    char last[64] = {};             // start of the latest warning, for the overlay
+    Warning recent[RECENT] = {};    // the latest warnings, warnings % RECENT the next written
+
+    // Route the context's debug output here; false without KHR_debug. Synchronous
+    // output costs driver parallelism, so this stays off unless asked for.
+    bool install(bool printAll) {
+        if (!glExt.debugMessages) {
+            return false;
+        }
+        printOthers = printAll;
+        glEnable(GL_DEBUG_OUTPUT);
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+        if (printAll) {
+            glExt.DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr, GL_FALSE);
+        } else {
+            glExt.DebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_FALSE);
+            glExt.DebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_PERFORMANCE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+        }
+        glExt.DebugMessageCallback(callback, this);
+        enabled = true;
+        return true;
+    }
+
+    static void APIENTRY callback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                  const GLchar *message, const void *userParam) {
+        GlDebugLog &log = *(GlDebugLog *)userParam;
+        if (type == GL_DEBUG_TYPE_PERFORMANCE) {
+            log.record(id, length, message);
+        } else if (log.printOthers) {
+            printGlDebugMessage(source, type, id, severity, length, message, userParam);
+        }
+    }
+
+    void record(GLuint id, GLsizei length, const GLchar *message) {
+        const char *zone = profiler.activeZone();
+        lastZone = zone ? zone : "no zone";
+        Warning &w = recent[warnings % RECENT];
+        w.time = profileTicks();
+        w.zone = lastZone;
+        w.id = id;
+        std::snprintf(w.text, sizeof(w.text), "%.*s", (int)length, message);
+        warnings++;
+        frameWarnings++;
+        std::snprintf(last, sizeof(last), "%.*s", (int)length, message);
+        char header[128];
+        std::snprintf(header, sizeof(header), "frame %llu, %s, id %u: ", (unsigned long long)frame, lastZone, id);
+        profiler.mark("GL performance warning", header + std::string(message, length));
+        if (warnings <= PRINT_LIMIT) {
+            std::printf("GL performance warning, %s%.*s\n", header, (int)length, message);
+        }
+    }
+
+    // Close the frame: its count goes to the overlay
+    void endFrame() {
+        lastFrameWarnings = frameWarnings;
+        frameWarnings = 0;
+        frame++;
+    }
+};
+
+inline GlDebugLog glDebugLog;
@@ -0,0 +1,306 @@
+#pragma once
+
+#include <cstdio>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+
+// Entry points and enums newer than the GL 4.0 profile the bundled glad was
+// generated for. They are resolved through GLFW after loadUsedGl, and each
+// feature flag is set only when the driver version or extension string offers it.
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+#ifndef GL_DYNAMIC_STORAGE_BIT
+#define GL_DYNAMIC_STORAGE_BIT 0x0100
+#endif
+
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPUTE_SHADER
+#define GL_COMPUTE_SHADER 0x91B9
+#endif
+#ifndef GL_SHADER_STORAGE_BUFFER
+#define GL_SHADER_STORAGE_BUFFER 0x90D2
+#endif
+#ifndef GL_COMMAND_BARRIER_BIT
+#define GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT 0x00000001
+#define GL_COMMAND_BARRIER_BIT 0x00000040
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef GL_DEBUG_OUTPUT
+#define GL_DEBUG_OUTPUT 0x92E0
+#endif
+#ifndef GL_DEBUG_OUTPUT_SYNCHRONOUS
+#define GL_DEBUG_OUTPUT_SYNCHRONOUS 0x8242
+#endif
+#ifndef GL_DEBUG_SOURCE_APPLICATION
+#define GL_DEBUG_SOURCE_APPLICATION 0x824A
+#endif
+#ifndef GL_PROGRAM
+#define GL_PROGRAM 0x82E2
+#endif
+#ifndef GL_DEBUG_SEVERITY_HIGH
+#define GL_DEBUG_SEVERITY_HIGH 0x9146
+#define GL_DEBUG_SEVERITY_MEDIUM 0x9147
+#define GL_DEBUG_SEVERITY_LOW 0x9148
+#define GL_DEBUG_SEVERITY_NOTIFICATION 0x826B
+#endif
+#ifndef GL_CONTEXT_FLAG_DEBUG_BIT
+#define GL_CONTEXT_FLAG_DEBUG_BIT 0x00000002
+#endif
+#ifndef GL_CONTEXT_FLAG_NO_ERROR_BIT
+#define GL_CONTEXT_FLAG_NO_ERROR_BIT 0x00000008
+#endif
+
+// GL 4.5 / ARB_direct_state_access: the subset gl_objects.h edits objects with
+#define GL_DSA_FUNCTIONS(X) \
+    X(CreateBuffers, PFNGLCREATEBUFFERSPROC_EXT) \
+    X(NamedBufferData, PFNGLNAMEDBUFFERDATAPROC_EXT) \
+    X(NamedBufferStorage, PFNGLNAMEDBUFFERSTORAGEPROC_EXT) \
+    X(NamedBufferSubData, PFNGLNAMEDBUFFERSUBDATAPROC_EXT) \
+    X(MapNamedBufferRange, PFNGLMAPNAMEDBUFFERRANGEPROC_EXT) \
+    X(UnmapNamedBuffer, PFNGLUNMAPNAMEDBUFFERPROC_EXT) \
+    X(CreateVertexArrays, PFNGLCREATEVERTEXARRAYSPROC_EXT) \
+    X(VertexArrayVertexBuffer, PFNGLVERTEXARRAYVERTEXBUFFERPROC_EXT) \
+    X(VertexArrayAttribFormat, PFNGLVERTEXARRAYATTRIBFORMATPROC_EXT) \
+    X(VertexArrayAttribIFormat, PFNGLVERTEXARRAYATTRIBIFORMATPROC_EXT) \
+    X(VertexArrayAttribBinding, PFNGLVERTEXARRAYATTRIBBINDINGPROC_EXT) \
+    X(VertexArrayBindingDivisor, PFNGLVERTEXARRAYBINDINGDIVISORPROC_EXT) \
+    X(EnableVertexArrayAttrib, PFNGLENABLEVERTEXARRAYATTRIBPROC_EXT) \
+    X(CreateTextures, PFNGLCREATETEXTURESPROC_EXT) \
+    X(TextureStorage2D, PFNGLTEXTURESTORAGE2DPROC_EXT) \
+    X(TextureStorage3D, PFNGLTEXTURESTORAGE3DPROC_EXT) \
+    X(TextureSubImage2D, PFNGLTEXTURESUBIMAGE2DPROC_EXT) \
+    X(TextureSubImage3D, PFNGLTEXTURESUBIMAGE3DPROC_EXT) \
+    X(CompressedTextureSubImage2D, PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC_EXT) \
+    X(TextureParameteri, PFNGLTEXTUREPARAMETERIPROC_EXT) \
+    X(GenerateTextureMipmap, PFNGLGENERATETEXTUREMIPMAPPROC_EXT)
+
+typedef void (APIENTRYP PFNGLCREATEBUFFERSPROC_EXT)(GLsizei n, GLuint *buffers);
+typedef void (APIENTRYP PFNGLNAMEDBUFFERDATAPROC_EXT)(GLuint buffer, GLsizeiptr size, const void *data, GLenum usage);
+typedef void (APIENTRYP PFNGLNAMEDBUFFERSTORAGEPROC_EXT)(GLuint buffer, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLNAMEDBUFFERSUBDATAPROC_EXT)(GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data);
+typedef void *(APIENTRYP PFNGLMAPNAMEDBUFFERRANGEPROC_EXT)(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean (APIENTRYP PFNGLUNMAPNAMEDBUFFERPROC_EXT)(GLuint buffer);
+typedef void (APIENTRYP PFNGLCREATEVERTEXARRAYSPROC_EXT)(GLsizei n, GLuint *arrays);
+typedef void (APIENTRYP PFNGLVERTEXARRAYVERTEXBUFFERPROC_EXT)(GLuint vaobj, GLuint bindingindex, GLuint buffer, GLintptr offset,
+                                                             GLsizei stride);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBFORMATPROC_EXT)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type,
+                                                             GLboolean normalized, GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBIFORMATPROC_EXT)(GLuint vaobj, GLuint attribindex, GLint size, GLenum type,
+                                                              GLuint relativeoffset);
+typedef void (APIENTRYP PFNGLVERTEXARRAYATTRIBBINDINGPROC_EXT)(GLuint vaobj, GLuint attribindex, GLuint bindingindex);
+typedef void (APIENTRYP PFNGLVERTEXARRAYBINDINGDIVISORPROC_EXT)(GLuint vaobj, GLuint bindingindex, GLuint divisor);
+typedef void (APIENTRYP PFNGLENABLEVERTEXARRAYATTRIBPROC_EXT)(GLuint vaobj, GLuint index);
+typedef void (APIENTRYP PFNGLCREATETEXTURESPROC_EXT)(GLenum target, GLsizei n, GLuint *textures);
+typedef void (APIENTRYP PFNGLTEXTURESTORAGE2DPROC_EXT)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width,
+                                                      GLsizei height);
+typedef void (APIENTRYP PFNGLTEXTURESTORAGE3DPROC_EXT)(GLuint texture, GLsizei levels, GLenum internalformat, GLsizei width,
+                                                      GLsizei height, GLsizei depth);
+typedef void (APIENTRYP PFNGLTEXTURESUBIMAGE2DPROC_EXT)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLsizei width,
+                                                       GLsizei height, GLenum format, GLenum type, const void *pixels);
+typedef void (APIENTRYP PFNGLTEXTURESUBIMAGE3DPROC_EXT)(GLuint texture, GLint level, GLint xoffset, GLint yoffset, GLint zoffset,
+                                                       GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type,
+                                                       const void *pixels);
+typedef void (APIENTRYP PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC_EXT)(GLuint texture, GLint level, GLint xoffset, GLint yoffset,
+                                                                 GLsizei width, GLsizei height, GLenum format, GLsizei imageSize,
+                                                                 const void *data);
+typedef void (APIENTRYP PFNGLTEXTUREPARAMETERIPROC_EXT)(GLuint texture, GLenum pname, GLint param);
+typedef void (APIENTRYP PFNGLGENERATETEXTUREMIPMAPPROC_EXT)(GLuint texture);
+
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC_EXT)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width,
+                                                  GLsizei height);
+typedef void (APIENTRYP PFNGLTEXSTORAGE3DPROC_EXT)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width,
+                                                  GLsizei height, GLsizei depth);
+
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTUREHANDLEARBPROC_EXT)(GLuint texture);
+typedef GLuint64 (APIENTRYP PFNGLGETTEXTURESAMPLERHANDLEARBPROC_EXT)(GLuint texture, GLuint sampler);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLERESIDENTARBPROC_EXT)(GLuint64 handle);
+typedef void (APIENTRYP PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC_EXT)(GLuint64 handle);
+
+typedef void (APIENTRYP PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_EXT)(GLenum mode, GLint first, GLsizei count, GLsizei instancecount,
+                                                                      GLuint baseinstance);
+typedef void (APIENTRYP PFNGLMULTIDRAWARRAYSINDIRECTPROC_EXT)(GLenum mode, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC_EXT)(GLuint x, GLuint y, GLuint z);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC_EXT)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLVIEWPORTINDEXEDFPROC_EXT)(GLuint index, GLfloat x, GLfloat y, GLfloat w, GLfloat h);
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC_EXT)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC_EXT)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC_EXT)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC_EXT)(GLuint program, GLenum pname, GLint value);
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)(GLuint count);
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECALLBACKPROC_EXT)(GLDEBUGPROC callback, const void *userParam);
+typedef void (APIENTRYP PFNGLDEBUGMESSAGECONTROLPROC_EXT)(GLenum source, GLenum type, GLenum severity, GLsizei count,
+                                                          const GLuint *ids, GLboolean enabled);
+typedef void (APIENTRYP PFNGLPUSHDEBUGGROUPPROC_EXT)(GLenum source, GLuint id, GLsizei length, const GLchar *message);
+typedef void (APIENTRYP PFNGLPOPDEBUGGROUPPROC_EXT)(void);
+typedef void (APIENTRYP PFNGLOBJECTLABELPROC_EXT)(GLenum identifier, GLuint name, GLsizei length, const GLchar *label);
+
+// Prints one KHR_debug message with its severity; --gl-debug's sink (gl_debug_log.h)
+inline void APIENTRY printGlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length,
+                                         const GLchar *message, const void *userParam) {
+    const char *level = severity == GL_DEBUG_SEVERITY_HIGH     ? "high"
+                        : severity == GL_DEBUG_SEVERITY_MEDIUM ? "medium"
+                                                               : "low";
+    std::printf("GL debug (%s, type 0x%04x, id %u): %.*s\n", level, type, id, (int)length, message);
+}
+
+struct GLExtensions {
+    bool bufferStorage = false; // GL 4.4 / ARB_buffer_storage
+    PFNGLBUFFERSTORAGEPROC_EXT BufferStorage = nullptr;
+    bool programBinary = false; // GL 4.1 / ARB_get_program_binary, with at least one binary format
+    PFNGLGETPROGRAMBINARYPROC_EXT GetProgramBinary = nullptr;
+    PFNGLPROGRAMBINARYPROC_EXT ProgramBinary = nullptr;
+    PFNGLPROGRAMPARAMETERIPROC_EXT ProgramParameteri = nullptr;
+    bool parallelShaderCompile = false; // KHR_parallel_shader_compile (or its ARB twin)
+    PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT MaxShaderCompilerThreads = nullptr;
+    bool textureStorage = false; // GL 4.2 / ARB_texture_storage: immutable levels without DSA
+    PFNGLTEXSTORAGE2DPROC_EXT TexStorage2D = nullptr;
+    PFNGLTEXSTORAGE3DPROC_EXT TexStorage3D = nullptr;
+    bool textureCompressionS3tc = false;  // EXT_texture_compression_s3tc (never core)
+    bool textureCompressionBptc = false;  // GL 4.2 / ARB_texture_compression_bptc
+    bool debugMessages = false; // GL 4.3 / KHR_debug, outside a no-error context; gl_debug_log.h turns it on
+    bool debugContext = false;  // created with GLFW_OPENGL_DEBUG_CONTEXT: the driver reports everything it checks
+    PFNGLDEBUGMESSAGECALLBACKPROC_EXT DebugMessageCallback = nullptr;
+    PFNGLDEBUGMESSAGECONTROLPROC_EXT DebugMessageControl = nullptr;
+    bool debugGroups = false; // GL 4.3 / KHR_debug: debug groups and object labels; gl_markers.h uses them
+    PFNGLPUSHDEBUGGROUPPROC_EXT PushDebugGroup = nullptr;
+    PFNGLPOPDEBUGGROUPPROC_EXT PopDebugGroup = nullptr;
+    PFNGLOBJECTLABELPROC_EXT ObjectLabel = nullptr;
+    bool noError = false; // the context was created with KHR_no_error: GL errors are undefined behaviour
+    bool directStateAccess = false; // GL 4.5 / ARB_direct_state_access: gl_objects.h edits objects by name
+    bool baseInstance = false; // GL 4.2 / ARB_base_instance: draws and indirect commands may name their first instance
+    PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_EXT DrawArraysInstancedBaseInstance = nullptr;
+    bool multiDrawIndirect = false; // GL 4.3 / ARB_multi_draw_indirect
+    PFNGLMULTIDRAWARRAYSINDIRECTPROC_EXT MultiDrawArraysIndirect = nullptr;
+    bool computeShader = false; // GL 4.3: compute shaders writing shader storage buffers
+    PFNGLDISPATCHCOMPUTEPROC_EXT DispatchCompute = nullptr;
+    PFNGLMEMORYBARRIERPROC_EXT MemoryBarrierGl = nullptr; // MemoryBarrier is a macro in windows.h
+    bool viewportLayerArray = false; // GL 4.1 / ARB_viewport_array, plus ARB_shader_viewport_layer_array: vertex shaders pick the viewport
+    PFNGLVIEWPORTINDEXEDFPROC_EXT ViewportIndexedf = nullptr;
+    bool bindlessTexture = false; // ARB_bindless_texture (never core): texture_handles.h
+    PFNGLGETTEXTUREHANDLEARBPROC_EXT GetTextureHandle = nullptr;
+    PFNGLGETTEXTURESAMPLERHANDLEARBPROC_EXT GetTextureSamplerHandle = nullptr;
+    PFNGLMAKETEXTUREHANDLERESIDENTARBPROC_EXT MakeTextureHandleResident = nullptr;
+    PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC_EXT MakeTextureHandleNonResident = nullptr;
+#define GL_DSA_FIELD(name, type) type name = nullptr;
+    GL_DSA_FUNCTIONS(GL_DSA_FIELD)
+#undef GL_DSA_FIELD
+
+    // True if the context is at least major.minor
+    static bool hasVersion(int major, int minor) {
+        return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+    }
+
+    // True if the feature is core in this context version or advertised as an extension
+    static bool supports(int major, int minor, const char *extension) {
+        return hasVersion(major, minor) || glfwExtensionSupported(extension);
+    }
+
+    // Resolve everything; must run with the context current, after loadUsedGl
+    void load() {
+        if (supports(4, 4, "GL_ARB_buffer_storage")) {
+            BufferStorage = (PFNGLBUFFERSTORAGEPROC_EXT)glfwGetProcAddress("glBufferStorage");
+            bufferStorage = BufferStorage != nullptr;
+        }
+        if (supports(4, 1, "GL_ARB_get_program_binary")) {
+            GetProgramBinary = (PFNGLGETPROGRAMBINARYPROC_EXT)glfwGetProcAddress("glGetProgramBinary");
+            ProgramBinary = (PFNGLPROGRAMBINARYPROC_EXT)glfwGetProcAddress("glProgramBinary");
+            ProgramParameteri = (PFNGLPROGRAMPARAMETERIPROC_EXT)glfwGetProcAddress("glProgramParameteri");
+            GLint formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+            programBinary = GetProgramBinary && ProgramBinary && ProgramParameteri && formats > 0;
+        }
+        if (glfwExtensionSupported("GL_KHR_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)glfwGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        } else if (glfwExtensionSupported("GL_ARB_parallel_shader_compile")) {
+            MaxShaderCompilerThreads = (PFNGLMAXSHADERCOMPILERTHREADSPROC_EXT)glfwGetProcAddress("glMaxShaderCompilerThreadsARB");
+        }
+        parallelShaderCompile = MaxShaderCompilerThreads != nullptr;
+        if (parallelShaderCompile) {
+            MaxShaderCompilerThreads(0xFFFFFFFFu); // let the driver pick the thread count
+        }
+        if (supports(4, 2, "GL_ARB_texture_storage")) {
+            TexStorage2D = (PFNGLTEXSTORAGE2DPROC_EXT)glfwGetProcAddress("glTexStorage2D");
+            TexStorage3D = (PFNGLTEXSTORAGE3DPROC_EXT)glfwGetProcAddress("glTexStorage3D");
+            textureStorage = TexStorage2D && TexStorage3D;
+        }
+        textureCompressionS3tc = glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+        textureCompressionBptc = supports(4, 2, "GL_ARB_texture_compression_bptc");
+        GLint flags = 0;
+        glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+        noError = (flags & GL_CONTEXT_FLAG_NO_ERROR_BIT) != 0;
+        debugContext = (flags & GL_CONTEXT_FLAG_DEBUG_BIT) != 0;
+        if (!noError && supports(4, 3, "GL_KHR_debug")) {
+            DebugMessageCallback = (PFNGLDEBUGMESSAGECALLBACKPROC_EXT)glfwGetProcAddress("glDebugMessageCallback");
+            DebugMessageControl = (PFNGLDEBUGMESSAGECONTROLPROC_EXT)glfwGetProcAddress("glDebugMessageControl");
+            debugMessages = DebugMessageCallback && DebugMessageControl;
+        }
+        if (supports(4, 3, "GL_KHR_debug")) {
+            PushDebugGroup = (PFNGLPUSHDEBUGGROUPPROC_EXT)glfwGetProcAddress("glPushDebugGroup");
+            PopDebugGroup = (PFNGLPOPDEBUGGROUPPROC_EXT)glfwGetProcAddress("glPopDebugGroup");
+            ObjectLabel = (PFNGLOBJECTLABELPROC_EXT)glfwGetProcAddress("glObjectLabel");
+            debugGroups = PushDebugGroup && PopDebugGroup && ObjectLabel;
+        }
+        if (supports(4, 2, "GL_ARB_base_instance")) {
+            DrawArraysInstancedBaseInstance =
+                (PFNGLDRAWARRAYSINSTANCEDBASEINSTANCEPROC_EXT)glfwGetProcAddress("glDrawArraysInstancedBaseInstance");
+            baseInstance = DrawArraysInstancedBaseInstance != nullptr;
+        }
+        if (supports(4, 3, "GL_ARB_multi_draw_indirect")) {
+            MultiDrawArraysIndirect = (PFNGLMULTIDRAWARRAYSINDIRECTPROC_EXT)glfwGetProcAddress("glMultiDrawArraysIndirect");
+            multiDrawIndirect = MultiDrawArraysIndirect != nullptr;
+        }
+        if (hasVersion(4, 3)) {
+            DispatchCompute = (PFNGLDISPATCHCOMPUTEPROC_EXT)glfwGetProcAddress("glDispatchCompute");
+            MemoryBarrierGl = (PFNGLMEMORYBARRIERPROC_EXT)glfwGetProcAddress("glMemoryBarrier");
+            computeShader = DispatchCompute && MemoryBarrierGl;
+        }
+        if (supports(4, 1, "GL_ARB_viewport_array") && glfwExtensionSupported("GL_ARB_shader_viewport_layer_array")) {
+            ViewportIndexedf = (PFNGLVIEWPORTINDEXEDFPROC_EXT)glfwGetProcAddress("glViewportIndexedf");
+            viewportLayerArray = ViewportIndexedf != nullptr;
+        }
+        if (glfwExtensionSupported("GL_ARB_bindless_texture")) {
+            GetTextureHandle = (PFNGLGETTEXTUREHANDLEARBPROC_EXT)glfwGetProcAddress("glGetTextureHandleARB");
+            GetTextureSamplerHandle = (PFNGLGETTEXTURESAMPLERHANDLEARBPROC_EXT)glfwGetProcAddress("glGetTextureSamplerHandleARB");
+            MakeTextureHandleResident = (PFNGLMAKETEXTUREHANDLERESIDENTARBPROC_EXT)glfwGetProcAddress("glMakeTextureHandleResidentARB");
+            MakeTextureHandleNonResident =
+                (PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC_EXT)glfwGetProcAddress("glMakeTextureHandleNonResidentARB");
+            bindlessTexture = GetTextureHandle && GetTextureSamplerHandle && MakeTextureHandleResident && MakeTextureHandleNonResident;
+        }
+        if (supports(4, 5, "GL_ARB_direct_state_access")) {
+            directStateAccess = true;
+#define GL_DSA_LOAD(name, type) \
+    name = (type)glfwGetProcAddress("gl" #name); \
+    directStateAccess &= name != nullptr;
+            GL_DSA_FUNCTIONS(GL_DSA_LOAD)
+#undef GL_DSA_LOAD
+        }
+    }
+};
+
+inline GLExtensions glExt;
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <cstdio>
+#include <glad/glad.h>
+
+// Every glad entry point the game calls, and nothing else. gladLoadGLLoader resolves
+// all ~700 functions of the GL 4.0 compatibility profile at startup; loading this
+// list instead costs one lookup per function actually used. GL 4.1+ entry points
+// and extensions are not here: GLExtensions still checks the version and extension
+// string for those and resolves them itself. A GL call added anywhere must be added
+// here too, or its pointer stays null; the list is what
+//   grep -ohE '\bgl(ad_gl)?[A-Z][A-Za-z0-9]*\b' src/*.cpp src/*.h
+// finds, less glad.c and the names glad.h does not declare.
+#define GL_USED_FUNCTIONS(X) \
+    X(glActiveTexture, PFNGLACTIVETEXTUREPROC) \
+    X(glAttachShader, PFNGLATTACHSHADERPROC) \
+    X(glBeginQuery, PFNGLBEGINQUERYPROC) \
+    X(glBeginTransformFeedback, PFNGLBEGINTRANSFORMFEEDBACKPROC) \
+    X(glBindBuffer, PFNGLBINDBUFFERPROC) \
+    X(glBindBufferBase, PFNGLBINDBUFFERBASEPROC) \
+    X(glBindFramebuffer, PFNGLBINDFRAMEBUFFERPROC) \
+    X(glBindRenderbuffer, PFNGLBINDRENDERBUFFERPROC) \
+    X(glBindSampler, PFNGLBINDSAMPLERPROC) \
+    X(glBindTransformFeedback, PFNGLBINDTRANSFORMFEEDBACKPROC) \
+    X(glBindTexture, PFNGLBINDTEXTUREPROC) \
+    X(glBindVertexArray, PFNGLBINDVERTEXARRAYPROC) \
+    X(glBlendFunc, PFNGLBLENDFUNCPROC) \
+    X(glBlitFramebuffer, PFNGLBLITFRAMEBUFFERPROC) \
+    X(glBufferData, PFNGLBUFFERDATAPROC) \
+    X(glBufferSubData, PFNGLBUFFERSUBDATAPROC) \
+    X(glCheckFramebufferStatus, PFNGLCHECKFRAMEBUFFERSTATUSPROC) \
+    X(glClear, PFNGLCLEARPROC) \
+    X(glClearColor, PFNGLCLEARCOLORPROC) \
+    X(glClientWaitSync, PFNGLCLIENTWAITSYNCPROC) \
+    X(glCompileShader, PFNGLCOMPILESHADERPROC) \
+    X(glCompressedTexSubImage2D, PFNGLCOMPRESSEDTEXSUBIMAGE2DPROC) \
+    X(glCreateProgram, PFNGLCREATEPROGRAMPROC) \
+    X(glCreateShader, PFNGLCREATESHADERPROC) \
+    X(glDeleteBuffers, PFNGLDELETEBUFFERSPROC) \
+    X(glDeleteFramebuffers, PFNGLDELETEFRAMEBUFFERSPROC) \
+    X(glDeleteProgram, PFNGLDELETEPROGRAMPROC) \
+    X(glDeleteQueries, PFNGLDELETEQUERIESPROC) \
+    X(glDeleteRenderbuffers, PFNGLDELETERENDERBUFFERSPROC) \
+    X(glDeleteSamplers, PFNGLDELETESAMPLERSPROC) \
+    X(glDeleteShader, PFNGLDELETESHADERPROC) \
+    X(glDeleteSync, PFNGLDELETESYNCPROC) \
+    X(glDeleteTextures, PFNGLDELETETEXTURESPROC) \
+    X(glDeleteTransformFeedbacks, PFNGLDELETETRANSFORMFEEDBACKSPROC) \
+    X(glDeleteVertexArrays, PFNGLDELETEVERTEXARRAYSPROC) \
+    X(glDepthMask, PFNGLDEPTHMASKPROC) \
+    X(glDetachShader, PFNGLDETACHSHADERPROC) \
+    X(glDisable, PFNGLDISABLEPROC) \
+    X(glDrawArrays, PFNGLDRAWARRAYSPROC) \
+    X(glDrawArraysIndirect, PFNGLDRAWARRAYSINDIRECTPROC) \
+    X(glDrawArraysInstanced, PFNGLDRAWARRAYSINSTANCEDPROC) \
+    X(glDrawTransformFeedback, PFNGLDRAWTRANSFORMFEEDBACKPROC) \
+    X(glEnable, PFNGLENABLEPROC) \
+    X(glEnableVertexAttribArray, PFNGLENABLEVERTEXATTRIBARRAYPROC) \
+    X(glEndQuery, PFNGLENDQUERYPROC) \
+    X(glEndTransformFeedback, PFNGLENDTRANSFORMFEEDBACKPROC) \
+    X(glFenceSync, PFNGLFENCESYNCPROC) \
+    X(glFinish, PFNGLFINISHPROC) \
+    X(glFlush, PFNGLFLUSHPROC) \
+    X(glFramebufferRenderbuffer, PFNGLFRAMEBUFFERRENDERBUFFERPROC) \
+    X(glFramebufferTexture2D, PFNGLFRAMEBUFFERTEXTURE2DPROC) \
+    X(glFramebufferTextureLayer, PFNGLFRAMEBUFFERTEXTURELAYERPROC) \
+    X(glGenBuffers, PFNGLGENBUFFERSPROC) \
+    X(glGenFramebuffers, PFNGLGENFRAMEBUFFERSPROC) \
+    X(glGenQueries, PFNGLGENQUERIESPROC) \
+    X(glGenRenderbuffers, PFNGLGENRENDERBUFFERSPROC) \
+    X(glGenSamplers, PFNGLGENSAMPLERSPROC) \
+    X(glGenTextures, PFNGLGENTEXTURESPROC) \
+    X(glGenTransformFeedbacks, PFNGLGENTRANSFORMFEEDBACKSPROC) \
+    X(glGenVertexArrays, PFNGLGENVERTEXARRAYSPROC) \
+    X(glGenerateMipmap, PFNGLGENERATEMIPMAPPROC) \
+    X(glGetActiveUniform, PFNGLGETACTIVEUNIFORMPROC) \
+    X(glGetError, PFNGLGETERRORPROC) \
+    X(glGetIntegerv, PFNGLGETINTEGERVPROC) \
+    X(glGetProgramInfoLog, PFNGLGETPROGRAMINFOLOGPROC) \
+    X(glGetProgramiv, PFNGLGETPROGRAMIVPROC) \
+    X(glGetQueryObjectui64v, PFNGLGETQUERYOBJECTUI64VPROC) \
+    X(glGetQueryObjectuiv, PFNGLGETQUERYOBJECTUIVPROC) \
+    X(glGetShaderInfoLog, PFNGLGETSHADERINFOLOGPROC) \
+    X(glGetShaderiv, PFNGLGETSHADERIVPROC) \
+    X(glGetString, PFNGLGETSTRINGPROC) \
+    X(glGetUniformBlockIndex, PFNGLGETUNIFORMBLOCKINDEXPROC) \
+    X(glGetUniformLocation, PFNGLGETUNIFORMLOCATIONPROC) \
+    X(glLinkProgram, PFNGLLINKPROGRAMPROC) \
+    X(glMapBufferRange, PFNGLMAPBUFFERRANGEPROC) \
+    X(glPixelStorei, PFNGLPIXELSTOREIPROC) \
+    X(glQueryCounter, PFNGLQUERYCOUNTERPROC) \
+    X(glReadPixels, PFNGLREADPIXELSPROC) \
+    X(glRenderbufferStorage, PFNGLRENDERBUFFERSTORAGEPROC) \
+    X(glRenderbufferStorageMultisample, PFNGLRENDERBUFFERSTORAGEMULTISAMPLEPROC) \
+    X(glSamplerParameteri, PFNGLSAMPLERPARAMETERIPROC) \
+    X(glScissor, PFNGLSCISSORPROC) \
+    X(glShaderSource, PFNGLSHADERSOURCEPROC) \
+    X(glTexImage2D, PFNGLTEXIMAGE2DPROC) \
+    X(glTexImage3D, PFNGLTEXIMAGE3DPROC) \
+    X(glTexParameteri, PFNGLTEXPARAMETERIPROC) \
+    X(glTexSubImage2D, PFNGLTEXSUBIMAGE2DPROC) \
+    X(glTexSubImage3D, PFNGLTEXSUBIMAGE3DPROC) \
+    X(glTransformFeedbackVaryings, PFNGLTRANSFORMFEEDBACKVARYINGSPROC) \
+    X(glUniform1f, PFNGLUNIFORM1FPROC) \
+    X(glUniform1i, PFNGLUNIFORM1IPROC) \
+    X(glUniform2fv, PFNGLUNIFORM2FVPROC) \
+    X(glUniform4fv, PFNGLUNIFORM4FVPROC) \
+    X(glUniform4iv, PFNGLUNIFORM4IVPROC) \
+    X(glUniformBlockBinding, PFNGLUNIFORMBLOCKBINDINGPROC) \
+    X(glUniformMatrix4fv, PFNGLUNIFORMMATRIX4FVPROC) \
+    X(glUnmapBuffer, PFNGLUNMAPBUFFERPROC) \
+    X(glUseProgram, PFNGLUSEPROGRAMPROC) \
+    X(glVertexAttribDivisor, PFNGLVERTEXATTRIBDIVISORPROC) \
+    X(glVertexAttribIPointer, PFNGLVERTEXATTRIBIPOINTERPROC) \
+    X(glVertexAttribPointer, PFNGLVERTEXATTRIBPOINTERPROC) \
+    X(glViewport, PFNGLVIEWPORTPROC)
+
+// Resolve the used functions and read the context version into GLVersion, as
+// gladLoadGLLoader would; false if the context is older than 4.0 or lacks one of them
+inline bool loadUsedGl(GLADloadproc load) {
+    GLVersion.major = 0;
+    GLVersion.minor = 0;
+    const char *missing = nullptr;
+#define GL_LOAD_USED(name, type) \
+    glad_##name = (type)load(#name); \
+    if (!glad_##name && !missing) { \
+        missing = #name; \
+    }
+    GL_USED_FUNCTIONS(GL_LOAD_USED)
+#undef GL_LOAD_USED
+    const char *version = glad_glGetString ? (const char *)glad_glGetString(GL_VERSION) : nullptr;
+    if (!version || std::sscanf(version, "%d.%d", &GLVersion.major, &GLVersion.minor) != 2) {
+        return false;
+    }
+    if (missing) {
+        std::printf("GL %d.%d driver has no %s\n", GLVersion.major, GLVersion.minor, missing);
+        return false;
+    }
+    return GLVersion.major >= 4;
+}
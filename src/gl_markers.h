@@ -0,0 +1,59 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "profiler.h"
+
+// Structure for frame debuggers (RenderDoc, Nsight): KHR_debug groups around the
+// passes and batches of a frame, and labels on the textures, buffers, framebuffers,
+// vertex arrays and programs they use, so a capture reads as the frame's parts
+// rather than a run of anonymous draws. Off unless --gl-markers is given; every call
+// is then one branch. GpuZone opens a profiler zone and a group of the same name, so
+// a capture and a profile of the same frame line up name for name.
+struct GlMarkers {
+    bool enabled = false;
+
+    // False without KHR_debug
+    bool enable() {
+        enabled = glExt.debugGroups;
+        return enabled;
+    }
+
+    void push(const char *name) {
+        if (enabled) {
+            glExt.PushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+        }
+    }
+
+    void pop() {
+        if (enabled) {
+            glExt.PopDebugGroup();
+        }
+    }
+
+    // kind is the object's namespace: GL_TEXTURE, GL_BUFFER, GL_FRAMEBUFFER,
+    // GL_RENDERBUFFER, GL_VERTEX_ARRAY or GL_PROGRAM. The object must exist, so a
+    // vertex array made without DSA is labelled after its first bind.
+    void label(GLenum kind, GLuint name, const char *text) {
+        if (enabled && name) {
+            glExt.ObjectLabel(kind, name, -1, text);
+        }
+    }
+};
+
+inline GlMarkers glMarkers;
+
+// A profiler zone and a GPU debug group of the same name, over one scope
+struct GpuZone {
+    ProfileScope zone;
+
+    explicit GpuZone(const char *name) : zone(name) {
+        glMarkers.push(name);
+    }
+
+    ~GpuZone() {
+        glMarkers.pop();
+    }
+};
+
+#define GPU_ZONE(name) GpuZone PROFILE_JOIN(gpuZone, __LINE__)(name)
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+
+// The object kinds whose names are pooled: the ones the game makes most of
+enum GlNameKind { GL_NAMES_BUFFERS, GL_NAMES_VERTEX_ARRAYS, GL_NAMES_TEXTURES, GL_NAME_KINDS };
+
+// Names for buffers, vertex arrays and 2D textures, reserved BLOCK at a time with
+// one glGen* (or, under direct state access, glCreate*) call, so creating an object
+// is a pop off a free list rather than a driver round trip. Deletes that go through
+// glState are queued instead and flush() retires each kind in one glDelete* call,
+// at the end of the frame and once more at shutdown, with the names never handed
+// out. A name is only handed out again by GL once its object is deleted, and the
+// objects carry state a reuse would inherit (immutable storage, attribute formats),
+// so deleted names return to GL through the batched delete rather than to the free
+// lists. Render thread only, on the main context: vertex arrays are not shared with
+// the loader's context, which keeps creating its own textures.
+struct GlNamePool {
+    static const int BLOCK = 64;
+
+    struct Names {
+        std::vector<GLuint> free, retired;
+        uint64_t blocks = 0, acquired = 0, deleted = 0, deletes = 0; // glDelete* calls
+    };
+
+    bool enabled = false;
+    Names names[GL_NAME_KINDS];
+
+    GLuint acquire(GlNameKind kind) {
+        Names &n = names[kind];
+        if (n.free.empty()) {
+            GLuint block[BLOCK];
+            create(kind, BLOCK, block);
+            for (int i = BLOCK; i-- > 0;) {
+                n.free.push_back(block[i]); // lowest name first
+            }
+            n.blocks++;
+        }
+        GLuint name = n.free.back();
+        n.free.pop_back();
+        n.acquired++;
+        return name;
+    }
+
+    // Queue count names for the next flush; false when pooling is off and the caller
+    // should delete them itself
+    bool retire(GlNameKind kind, GLsizei count, const GLuint *deleted) {
+        if (!enabled) {
+            return false;
+        }
+        for (GLsizei i = 0; i < count; i++) {
+            if (deleted[i]) {
+                names[kind].retired.push_back(deleted[i]);
+            }
+        }
+        return true;
+    }
+
+    void flush() {
+        for (int k = 0; k < GL_NAME_KINDS; k++) {
+            Names &n = names[k];
+            if (!n.retired.empty()) {
+                destroy((GlNameKind)k, (GLsizei)n.retired.size(), n.retired.data());
+                n.deleted += n.retired.size();
+                n.deletes++;
+                n.retired.clear();
+            }
+        }
+    }
+
+    // Deletes whatever is queued and the names never used; the context must still be current
+    void release() {
+        flush();
+        for (int k = 0; k < GL_NAME_KINDS; k++) {
+            std::vector<GLuint> &unused = names[k].free;
+            if (!unused.empty()) {
+                destroy((GlNameKind)k, (GLsizei)unused.size(), unused.data());
+                unused.clear();
+            }
+        }
+        enabled = false;
+    }
+
+    static void create(GlNameKind kind, GLsizei count, GLuint *out) {
+        bool dsa = glExt.directStateAccess;
+        switch (kind) {
+            case GL_NAMES_BUFFERS:       dsa ? glExt.CreateBuffers(count, out) : glGenBuffers(count, out); break;
+            case GL_NAMES_VERTEX_ARRAYS: dsa ? glExt.CreateVertexArrays(count, out) : glGenVertexArrays(count, out); break;
+            case GL_NAMES_TEXTURES:      dsa ? glExt.CreateTextures(GL_TEXTURE_2D, count, out) : glGenTextures(count, out); break;
+            default: break;
+        }
+    }
+
+    static void destroy(GlNameKind kind, GLsizei count, const GLuint *names) {
+        switch (kind) {
+            case GL_NAMES_BUFFERS:       glDeleteBuffers(count, names); break;
+            case GL_NAMES_VERTEX_ARRAYS: glDeleteVertexArrays(count, names); break;
+            case GL_NAMES_TEXTURES:      glDeleteTextures(count, names); break;
+            default: break;
+        }
+    }
+
+    void print() const {
+        if (!enabled) {
+            return;
+        }
+        static const char *const KINDS[GL_NAME_KINDS] = {"buffers", "vertex arrays", "textures"};
+        std::printf("GL names:");
+        for (int k = 0; k < GL_NAME_KINDS; k++) {
+            const Names &n = names[k];
+            std::printf("%s %llu %s in %llu blocks, %llu deleted in %llu calls", k ? ";" : "", (unsigned long long)n.acquired,
+                        KINDS[k], (unsigned long long)n.blocks, (unsigned long long)n.deleted, (unsigned long long)n.deletes);
+        }
+        std::printf("\n");
+    }
+};
+
+inline GlNamePool glNames;
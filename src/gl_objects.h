@@ -0,0 +1,221 @@
+#pragma once
+
+#include <algorithm>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "gl_name_pool.h"
+#include "gl_state.h"
+
+// Buffer, vertex array and texture setup on two backends. With direct state access
+// (glExt.directStateAccess) objects are created and edited by name, so loading and
+// streaming never touch the bindings the draws rely on; without it each edit first
+// binds the object through glState, as GL 4.0 requires, and leaves it bound. Both
+// backends build the same objects, so callers never branch on which one is in use.
+// Buffer, vertex array and 2D texture names come from glNames's blocks when it is
+// enabled.
+
+// A name for a new object of kind, pooled or on its own
+inline GLuint genName(GlNameKind kind) {
+    if (glNames.enabled) {
+        return glNames.acquire(kind);
+    }
+    GLuint name = 0;
+    GlNamePool::create(kind, 1, &name);
+    return name;
+}
+
+// New buffer of size bytes, filled from data unless it is nullptr
+inline GLuint createBuffer(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+    GLuint buffer = genName(GL_NAMES_BUFFERS);
+    if (glExt.directStateAccess) {
+        glExt.NamedBufferData(buffer, size, data, usage);
+    } else {
+        glState.bindBuffer(target, buffer);
+        glBufferData(target, size, data, usage);
+    }
+    return buffer;
+}
+
+// New immutable buffer; needs glExt.bufferStorage
+inline GLuint createBufferStorage(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags) {
+    GLuint buffer = genName(GL_NAMES_BUFFERS);
+    if (glExt.directStateAccess) {
+        glExt.NamedBufferStorage(buffer, size, data, flags);
+    } else {
+        glState.bindBuffer(target, buffer);
+        glExt.BufferStorage(target, size, data, flags);
+    }
+    return buffer;
+}
+
+// Replace a buffer's storage; with data nullptr this orphans the old storage to the driver
+inline void bufferData(GLenum target, GLuint buffer, GLsizeiptr size, const void *data, GLenum usage) {
+    if (glExt.directStateAccess) {
+        glExt.NamedBufferData(buffer, size, data, usage);
+    } else {
+        glState.bindBuffer(target, buffer);
+        glBufferData(target, size, data, usage);
+    }
+}
+
+inline void bufferSubData(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data) {
+    if (glExt.directStateAccess) {
+        glExt.NamedBufferSubData(buffer, offset, size, data);
+    } else {
+        glState.bindBuffer(target, buffer);
+        glBufferSubData(target, offset, size, data);
+    }
+}
+
+inline void *mapBufferRange(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield access) {
+    if (glExt.directStateAccess) {
+        return glExt.MapNamedBufferRange(buffer, offset, length, access);
+    }
+    glState.bindBuffer(target, buffer);
+    return glMapBufferRange(target, offset, length, access);
+}
+
+inline void unmapBuffer(GLenum target, GLuint buffer) {
+    if (glExt.directStateAccess) {
+        glExt.UnmapNamedBuffer(buffer);
+    } else {
+        glState.bindBuffer(target, buffer);
+        glUnmapBuffer(target);
+    }
+}
+
+// New vertex array; under the fallback it only comes into being at its first bind
+inline GLuint createVertexArray() {
+    return genName(GL_NAMES_VERTEX_ARRAYS);
+}
+
+// Feed attribute attrib of the vertex array with size floats read every stride bytes
+// of buffer from offset, advancing per vertex or, with a divisor, per divisor
+// instances. Under DSA the attribute gets the vertex buffer binding of the same index.
+inline void vertexAttrib(GLuint array, GLuint attrib, GLint size, GLuint buffer, GLsizei stride, GLintptr offset,
+                         GLuint divisor = 0) {
+    if (glExt.directStateAccess) {
+        glExt.VertexArrayAttribFormat(array, attrib, size, GL_FLOAT, GL_FALSE, 0);
+        glExt.VertexArrayAttribBinding(array, attrib, attrib);
+        glExt.VertexArrayVertexBuffer(array, attrib, buffer, offset, stride);
+        glExt.VertexArrayBindingDivisor(array, attrib, divisor);
+        glExt.EnableVertexArrayAttrib(array, attrib);
+    } else {
+        glState.bindVertexArray(array);
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        glVertexAttribPointer(attrib, size, GL_FLOAT, GL_FALSE, stride, (GLvoid*)offset);
+        glVertexAttribDivisor(attrib, divisor);
+        glEnableVertexAttribArray(attrib);
+    }
+}
+
+// New GL_TEXTURE_2D, or another target; the fallback binds it to unit 0 so it exists
+inline GLuint createTexture2D(GLenum target = GL_TEXTURE_2D) {
+    GLuint texture = 0;
+    if (target == GL_TEXTURE_2D) {
+        texture = genName(GL_NAMES_TEXTURES);
+    } else if (glExt.directStateAccess) {
+        glExt.CreateTextures(target, 1, &texture);
+    } else {
+        glGenTextures(1, &texture);
+    }
+    if (!glExt.directStateAccess) {
+        glState.bindTexture(0, texture, target);
+    }
+    return texture;
+}
+
+// Texture parameters and mipmaps below take the texture's target for the fallback's
+// bind; under DSA the name alone says which it is
+inline void textureParameter(GLuint texture, GLenum name, GLint value, GLenum target = GL_TEXTURE_2D) {
+    if (glExt.directStateAccess) {
+        glExt.TextureParameteri(texture, name, value);
+    } else {
+        glState.bindTexture(0, texture, target);
+        glTexParameteri(target, name, value);
+    }
+}
+
+// Allocate exactly levels mip levels of a texture from createTexture2D() in a sized
+// internal format, contents undefined. With DSA or ARB_texture_storage the storage is
+// immutable, so the driver never has to revalidate the level chain; otherwise the
+// same levels are defined with glTexImage2D and GL_TEXTURE_MAX_LEVEL capped to match,
+// which the S3TC and BPTC formats accept as well. Either way a texture is allocated
+// once: a different size or format needs a new name.
+inline void textureStorage2D(GLuint texture, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) {
+    if (glExt.directStateAccess) {
+        glExt.TextureStorage2D(texture, levels, internalFormat, width, height);
+        return;
+    }
+    glState.bindTexture(0, texture);
+    if (glExt.textureStorage) {
+        glExt.TexStorage2D(GL_TEXTURE_2D, levels, internalFormat, width, height);
+        return;
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (GLsizei level = 0; level < levels; level++) {
+        glTexImage2D(GL_TEXTURE_2D, level, internalFormat, std::max(1, width >> level), std::max(1, height >> level), 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+// textureStorage2D() for a GL_TEXTURE_2D_ARRAY of layers images, each width x height
+inline void textureStorage2DArray(GLuint texture, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height,
+                                  GLsizei layers) {
+    if (glExt.directStateAccess) {
+        glExt.TextureStorage3D(texture, levels, internalFormat, width, height, layers);
+        return;
+    }
+    glState.bindTexture(0, texture, GL_TEXTURE_2D_ARRAY);
+    if (glExt.textureStorage) {
+        glExt.TexStorage3D(GL_TEXTURE_2D_ARRAY, levels, internalFormat, width, height, layers);
+        return;
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (GLsizei level = 0; level < levels; level++) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, level, internalFormat, std::max(1, width >> level), std::max(1, height >> level),
+                     layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+}
+
+// Replace a rectangle of one level; pixels is an offset when a GL_PIXEL_UNPACK_BUFFER is bound
+inline void textureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format,
+                              GLenum type, const void *pixels) {
+    if (glExt.directStateAccess) {
+        glExt.TextureSubImage2D(texture, level, x, y, width, height, format, type, pixels);
+    } else {
+        glState.bindTexture(0, texture);
+        glTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, type, pixels);
+    }
+}
+
+// textureSubImage2D() into one layer of a GL_TEXTURE_2D_ARRAY
+inline void textureSubImage2DArray(GLuint texture, GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height,
+                                   GLenum format, GLenum type, const void *pixels) {
+    if (glExt.directStateAccess) {
+        glExt.TextureSubImage3D(texture, level, x, y, layer, width, height, 1, format, type, pixels);
+    } else {
+        glState.bindTexture(0, texture, GL_TEXTURE_2D_ARRAY);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, x, y, layer, width, height, 1, format, type, pixels);
+    }
+}
+
+inline void compressedTextureSubImage2D(GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height,
+                                        GLenum format, GLsizei bytes, const void *data) {
+    if (glExt.directStateAccess) {
+        glExt.CompressedTextureSubImage2D(texture, level, x, y, width, height, format, bytes, data);
+    } else {
+        glState.bindTexture(0, texture);
+        glCompressedTexSubImage2D(GL_TEXTURE_2D, level, x, y, width, height, format, bytes, data);
+    }
+}
+
+// Fill every level below the base from level 0
+inline void generateMipmap(GLuint texture, GLenum target = GL_TEXTURE_2D) {
+    if (glExt.directStateAccess) {
+        glExt.GenerateTextureMipmap(texture);
+    } else {
+        glState.bindTexture(0, texture, target);
+        glGenerateMipmap(target);
+    }
+}
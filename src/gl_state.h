@@ -0,0 +1,261 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include "gl_name_pool.h"
+#include "texture_handles.h"
+
+// Shadow of the GL state the renderer changes per draw: program, vertex array,
+// texture and sampler per unit, generic buffer bindings, framebuffers, the enable
+// caps it toggles, blend function and depth mask. Every such change in the tree goes
+// through glState, which issues the GL call only when the requested state is not
+// already current, so draws no longer need to unbind after themselves. The shadow
+// starts as GL's defaults for a fresh context; deletes go through it too, since GL
+// reverts a deleted object's bindings to 0 and the name may be handed out again;
+// texture and sampler deletes also drop the names' bindless handles. Buffer, vertex
+// array and texture deletes are then batched by glNames when it is enabled.
+// Calls issued and skipped are counted per frame for the overlay.
+struct GlState {
+    static const GLuint UNITS = 16;
+
+    // Buffer targets with a shadowed generic binding; GL_ELEMENT_ARRAY_BUFFER is part
+    // of the vertex array, so it is never cached
+    enum BufferSlot { BUFFER_ARRAY, BUFFER_UNIFORM, BUFFER_PIXEL_PACK, BUFFER_PIXEL_UNPACK, BUFFER_TRANSFORM_FEEDBACK,
+                      BUFFER_DRAW_INDIRECT, BUFFER_SLOTS, BUFFER_UNCACHED = BUFFER_SLOTS };
+
+    // Capabilities glState tracks; others pass straight through
+    enum CapSlot { CAP_BLEND, CAP_DEPTH_TEST, CAP_SCISSOR_TEST, CAP_RASTERIZER_DISCARD, CAP_SLOTS,
+                   CAP_UNCACHED = CAP_SLOTS };
+
+    struct Frame {
+        uint64_t issued = 0, skipped = 0;
+    };
+
+    GLuint program = 0, vertexArray = 0, activeUnit = 0;
+    GLuint textures[UNITS] = {}, samplers[UNITS] = {}; // GL_TEXTURE_2D per unit
+    GLuint arrayTextures[UNITS] = {};                  // GL_TEXTURE_2D_ARRAY per unit
+    GLuint buffers[BUFFER_SLOTS] = {};
+    GLuint drawFramebuffer = 0, readFramebuffer = 0;
+    bool caps[CAP_SLOTS] = {}; // every tracked cap starts disabled
+    GLenum blendSource = GL_ONE, blendDestination = GL_ZERO;
+    bool depthWrites = true;
+    Frame current, last, total;
+
+    // Count a request; true if it needs the GL call
+    bool change(bool needed) {
+        if (needed) {
+            current.issued++;
+        } else {
+            current.skipped++;
+        }
+        return needed;
+    }
+
+    void useProgram(GLuint id) {
+        if (change(program != id)) {
+            program = id;
+            glUseProgram(id);
+        }
+    }
+
+    void bindVertexArray(GLuint array) {
+        if (change(vertexArray != array)) {
+            vertexArray = array;
+            glBindVertexArray(array);
+        }
+    }
+
+    // Bind a GL_TEXTURE_2D, or a GL_TEXTURE_2D_ARRAY, to a unit, switching the active
+    // unit only if it differs. A unit holds one of each; the program decides which it samples.
+    void bindTexture(GLuint unit, GLuint texture, GLenum target = GL_TEXTURE_2D) {
+        GLuint &slot = target == GL_TEXTURE_2D_ARRAY ? arrayTextures[unit] : textures[unit];
+        if (change(slot != texture)) {
+            activate(unit);
+            slot = texture;
+            glBindTexture(target, texture);
+        }
+    }
+
+    void bindSampler(GLuint unit, GLuint sampler) {
+        if (change(samplers[unit] != sampler)) {
+            samplers[unit] = sampler;
+            glBindSampler(unit, sampler);
+        }
+    }
+
+    void bindBuffer(GLenum target, GLuint buffer) {
+        BufferSlot slot = bufferSlot(target);
+        if (slot == BUFFER_UNCACHED) {
+            change(true);
+            glBindBuffer(target, buffer);
+        } else if (change(buffers[slot] != buffer)) {
+            buffers[slot] = buffer;
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    // Indexed binds are not shadowed, but they also bind the generic target
+    void bindBufferBase(GLenum target, GLuint index, GLuint buffer) {
+        change(true);
+        BufferSlot slot = bufferSlot(target);
+        if (slot != BUFFER_UNCACHED) {
+            buffers[slot] = buffer;
+        }
+        glBindBufferBase(target, index, buffer);
+    }
+
+    void bindFramebuffer(GLenum target, GLuint framebuffer) {
+        bool draw = target != GL_READ_FRAMEBUFFER, read = target != GL_DRAW_FRAMEBUFFER;
+        if (change((draw && drawFramebuffer != framebuffer) || (read && readFramebuffer != framebuffer))) {
+            if (draw) {
+                drawFramebuffer = framebuffer;
+            }
+            if (read) {
+                readFramebuffer = framebuffer;
+            }
+            glBindFramebuffer(target, framebuffer);
+        }
+    }
+
+    void enable(GLenum cap) {
+        set(cap, true);
+    }
+
+    void disable(GLenum cap) {
+        set(cap, false);
+    }
+
+    void set(GLenum cap, bool on) {
+        CapSlot slot = capSlot(cap);
+        if (slot == CAP_UNCACHED) {
+            change(true);
+        } else if (change(caps[slot] != on)) {
+            caps[slot] = on;
+        } else {
+            return;
+        }
+        if (on) {
+            glEnable(cap);
+        } else {
+            glDisable(cap);
+        }
+    }
+
+    void blendFunc(GLenum source, GLenum destination) {
+        if (change(blendSource != source || blendDestination != destination)) {
+            blendSource = source;
+            blendDestination = destination;
+            glBlendFunc(source, destination);
+        }
+    }
+
+    void depthMask(bool writes) {
+        if (change(depthWrites != writes)) {
+            depthWrites = writes;
+            glDepthMask(writes ? GL_TRUE : GL_FALSE);
+        }
+    }
+
+    // Deletes that drop the names from the shadow along with GL's own bindings
+    void deleteVertexArrays(GLsizei n, const GLuint *arrays) {
+        forget(vertexArray, n, arrays);
+        if (!glNames.retire(GL_NAMES_VERTEX_ARRAYS, n, arrays)) {
+            glDeleteVertexArrays(n, arrays);
+        }
+    }
+
+    void deleteTextures(GLsizei n, const GLuint *names) {
+        textureHandles.forgetTextures(n, names);
+        for (GLuint &slot : textures) {
+            forget(slot, n, names);
+        }
+        for (GLuint &slot : arrayTextures) {
+            forget(slot, n, names);
+        }
+        if (!glNames.retire(GL_NAMES_TEXTURES, n, names)) {
+            glDeleteTextures(n, names);
+        }
+    }
+
+    void deleteSamplers(GLsizei n, const GLuint *names) {
+        textureHandles.forgetSamplers(n, names);
+        for (GLuint &slot : samplers) {
+            forget(slot, n, names);
+        }
+        glDeleteSamplers(n, names);
+    }
+
+    void deleteBuffers(GLsizei n, const GLuint *names) {
+        for (GLuint &slot : buffers) {
+            forget(slot, n, names);
+        }
+        if (!glNames.retire(GL_NAMES_BUFFERS, n, names)) {
+            glDeleteBuffers(n, names);
+        }
+    }
+
+    void deleteFramebuffers(GLsizei n, const GLuint *names) {
+        forget(drawFramebuffer, n, names);
+        forget(readFramebuffer, n, names);
+        glDeleteFramebuffers(n, names);
+    }
+
+    // Close the frame: keep its counts for the overlay and add them to the totals
+    void endFrame() {
+        last = current;
+        total.issued += current.issued;
+        total.skipped += current.skipped;
+        current = {};
+    }
+
+    void activate(GLuint unit) {
+        if (activeUnit != unit) {
+            activeUnit = unit;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+    }
+
+    static void forget(GLuint &slot, GLsizei n, const GLuint *names) {
+        for (GLsizei i = 0; i < n; i++) {
+            if (slot == names[i]) {
+                slot = 0;
+            }
+        }
+    }
+
+    static BufferSlot bufferSlot(GLenum target) {
+        switch (target) {
+        case GL_ARRAY_BUFFER:
+            return BUFFER_ARRAY;
+        case GL_UNIFORM_BUFFER:
+            return BUFFER_UNIFORM;
+        case GL_PIXEL_PACK_BUFFER:
+            return BUFFER_PIXEL_PACK;
+        case GL_PIXEL_UNPACK_BUFFER:
+            return BUFFER_PIXEL_UNPACK;
+        case GL_TRANSFORM_FEEDBACK_BUFFER:
+            return BUFFER_TRANSFORM_FEEDBACK;
+        case GL_DRAW_INDIRECT_BUFFER:
+            return BUFFER_DRAW_INDIRECT;
+        default:
+            return BUFFER_UNCACHED;
+        }
+    }
+
+    static CapSlot capSlot(GLenum cap) {
+        switch (cap) {
+        case GL_BLEND:
+            return CAP_BLEND;
+        case GL_DEPTH_TEST:
+            return CAP_DEPTH_TEST;
+        case GL_SCISSOR_TEST:
+            return CAP_SCISSOR_TEST;
+        case GL_RASTERIZER_DISCARD:
+            return CAP_RASTERIZER_DISCARD;
+        default:
+            return CAP_UNCACHED;
+        }
+    }
+};
+
+inline GlState glState;
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "gpu_tier.h"
+#include "shader_program.h"
+
+// The GPU's tier measured instead of guessed from its name (classifyGpu), on the
+// first run and again whenever the driver's vendor, renderer or version string
+// changes. Three micro-scenes are drawn offscreen into a TARGET_SIZE square with
+// calibrate.*.glsl, each timed with GL_TIME_ELAPSED, best of REPEATS after a warm-up:
+//   sprites  SPRITES two-pixel quads scattered over the target: vertex and setup work
+//   fill     FILL_LAYERS quads covering the whole target, blended
+//   upload   UPLOAD_BYTES into a buffer, to glFinish on the wall clock, as the copy
+//            into driver memory happens before any GPU timer could start
+// The machine is the lowest tier any of the three puts it in. The result is kept in
+// a small text file with the driver strings it was measured on; deleting the file
+// or --recalibrate measures again. The whole run takes well under a second on
+// anything but a software rasterizer.
+struct GpuCalibration {
+    static constexpr const char *FILE_NAME = "gpu_calibration.ini";
+    static const int TARGET_SIZE = 1024;
+    static const int SPRITES = 200000;
+    static const int FILL_LAYERS = 32;
+    static const size_t UPLOAD_BYTES = 32u << 20;
+    static const int REPEATS = 3;
+
+    // Tier boundaries: below the first a measurement says software, below the second integrated
+    static constexpr double SPRITE_TIERS[2] = {20.0, 250.0}; // million sprites per second
+    static constexpr double FILL_TIERS[2] = {1.0, 15.0};     // gigapixels blended per second
+    static constexpr double UPLOAD_TIERS[2] = {0.5, 2.0};    // GB per second
+
+    std::string vendor, renderer, version; // driver strings the results were measured on
+    double spriteRate = 0.0, fillRate = 0.0, uploadRate = 0.0; // in the units above
+    GpuTier tier = GPU_TIER_DISCRETE;
+    bool valid = false; // loaded or measured
+
+    static std::string driverString(GLenum name) {
+        const GLubyte *s = glGetString(name);
+        return s ? (const char *)s : "";
+    }
+
+    // True if the results were measured on the current context's driver
+    bool matchesDriver() const {
+        return valid && vendor == driverString(GL_VENDOR) && renderer == driverString(GL_RENDERER) &&
+               version == driverString(GL_VERSION);
+    }
+
+    static GpuTier tierOf(double value, const double (&bounds)[2]) {
+        return value < bounds[0] ? GPU_TIER_SOFTWARE : value < bounds[1] ? GPU_TIER_INTEGRATED : GPU_TIER_DISCRETE;
+    }
+
+    static GpuTier classify(double sprites, double fill, double upload) {
+        return std::min({tierOf(sprites, SPRITE_TIERS), tierOf(fill, FILL_TIERS), tierOf(upload, UPLOAD_TIERS)});
+    }
+
+    // Run the micro-scenes with program, built from calibrate.*.glsl, which is deleted
+    // afterwards. Leaves the default framebuffer bound and blending off; the caller
+    // sets its own viewport.
+    void measure(ShaderProgram program) {
+        vendor = driverString(GL_VENDOR);
+        renderer = driverString(GL_RENDERER);
+        version = driverString(GL_VERSION);
+
+        GLuint fbo = 0, color = 0;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+        GLuint vertexArray = createVertexArray(); // the quads need no attributes
+        glState.bindVertexArray(vertexArray);
+        glState.disable(GL_DEPTH_TEST);
+        program.use();
+        int size = program.find("size");
+
+        // Seconds of GPU time of the fastest of REPEATS draws, after one untimed
+        auto gpuSeconds = [&](glm::vec2 quad, GLsizei instances, bool blend) {
+            program.set(size, quad);
+            if (blend) {
+                glState.enable(GL_BLEND);
+            } else {
+                glState.disable(GL_BLEND);
+            }
+            GLuint queries[REPEATS];
+            glGenQueries(REPEATS, queries);
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances);
+            for (GLuint query : queries) {
+                glBeginQuery(GL_TIME_ELAPSED, query);
+                glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances);
+                glEndQuery(GL_TIME_ELAPSED);
+            }
+            GLuint64 best = UINT64_MAX;
+            for (GLuint query : queries) {
+                GLuint64 ns = 0;
+                glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns); // waits for the draw
+                best = std::min(best, ns);
+            }
+            glDeleteQueries(REPEATS, queries);
+            return std::max(best, (GLuint64)1) * 1e-9;
+        };
+        spriteRate = SPRITES / gpuSeconds(glm::vec2(4.0f / TARGET_SIZE), SPRITES, false) * 1e-6;
+        fillRate = (double)FILL_LAYERS * TARGET_SIZE * TARGET_SIZE / gpuSeconds(glm::vec2(2.0f), FILL_LAYERS, true) * 1e-9;
+
+        std::vector<unsigned char> bytes(UPLOAD_BYTES, 0x5A);
+        GLuint buffer = createBuffer(GL_ARRAY_BUFFER, (GLsizeiptr)UPLOAD_BYTES, nullptr, GL_STREAM_DRAW);
+        double best = 1e9;
+        for (int r = 0; r <= REPEATS; r++) {
+            auto start = std::chrono::steady_clock::now();
+            bufferSubData(GL_ARRAY_BUFFER, buffer, 0, (GLsizeiptr)UPLOAD_BYTES, bytes.data());
+            glFinish();
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (r > 0) { // the first pays for the buffer's allocation
+                best = std::min(best, seconds);
+            }
+        }
+        uploadRate = UPLOAD_BYTES / std::max(best, 1e-9) * 1e-9;
+
+        glState.disable(GL_BLEND);
+        glState.deleteBuffers(1, &buffer);
+        glState.deleteVertexArrays(1, &vertexArray);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+        glState.deleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &color);
+        glState.useProgram(0);
+        glDeleteProgram(program.id);
+        tier = classify(spriteRate, fillRate, uploadRate);
+        valid = true;
+    }
+
+    // Read a file save() wrote; false if it is missing or malformed
+    bool load(const std::string &path) {
+        valid = false;
+        FILE *in = std::fopen(path.c_str(), "r");
+        if (!in) {
+            return false;
+        }
+        char line[512];
+        int fields = 0;
+        while (std::fgets(line, sizeof(line), in)) {
+            line[std::strcspn(line, "\r\n")] = '\0';
+            char name[32];
+            int value = 0;
+            if (line[0] == '#' || std::sscanf(line, "%31[a-z] = %n", name, &value) != 1 || value == 0) {
+                continue;
+            }
+            const char *text = line + value;
+            std::string *driver = std::strcmp(name, "vendor") == 0     ? &vendor
+                                  : std::strcmp(name, "renderer") == 0 ? &renderer
+                                  : std::strcmp(name, "version") == 0  ? &version
+                                                                       : nullptr;
+            double *rate = std::strcmp(name, "sprites") == 0  ? &spriteRate
+                           : std::strcmp(name, "fill") == 0   ? &fillRate
+                           : std::strcmp(name, "upload") == 0 ? &uploadRate
+                                                              : nullptr;
+            if (driver) {
+                *driver = text;
+                fields++;
+            } else if (rate && std::sscanf(text, "%lf", rate) == 1 && *rate > 0.0) {
+                fields++;
+            }
+        }
+        std::fclose(in);
+        if (fields != 6) {
+            return false;
+        }
+        tier = classify(spriteRate, fillRate, uploadRate); // so new boundaries apply without measuring again
+        valid = true;
+        return true;
+    }
+
+    bool save(const std::string &path) const {
+        FILE *out = std::fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::fprintf(out,
+                     "# GPU calibration, measured on the driver below; delete this file to measure again\n"
+                     "vendor = %s\nrenderer = %s\nversion = %s\n"
+                     "sprites = %.1f # million per second\nfill = %.2f # gigapixels blended per second\n"
+                     "upload = %.2f # GB per second\n# tier: %s\n",
+                     vendor.c_str(), renderer.c_str(), version.c_str(), spriteRate, fillRate, uploadRate, GPU_TIER_NAMES[tier]);
+        return std::fclose(out) == 0;
+    }
+
+    std::string describe() const {
+        char text[160];
+        std::snprintf(text, sizeof(text), "%s (%.0f M sprites/s, %.1f Gpixels/s blended, %.1f GB/s upload)", GPU_TIER_NAMES[tier],
+                      spriteRate, fillRate, uploadRate);
+        return text;
+    }
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstring>
+#include <glad/glad.h>
+
+// Rough class of the GPU, for effects that are only worth their cost on some of them
+enum GpuTier {
+    GPU_TIER_SOFTWARE,   // a CPU rasterizer: nothing optional is affordable
+    GPU_TIER_INTEGRATED, // shares memory bandwidth with the CPU
+    GPU_TIER_DISCRETE
+};
+
+static const char *const GPU_TIER_NAMES[] = {"software", "integrated", "discrete"};
+
+// Guessed from the driver's vendor and renderer strings; anything unrecognised is
+// taken to be discrete, so new hardware is not held back
+inline GpuTier classifyGpu(const char *vendor, const char *renderer) {
+    vendor = vendor ? vendor : "";
+    renderer = renderer ? renderer : "";
+    for (const char *software : {"llvmpipe", "softpipe", "SwiftShader", "GDI Generic", "Microsoft Basic Render"}) {
+        if (std::strstr(renderer, software)) {
+            return GPU_TIER_SOFTWARE;
+        }
+    }
+    if (std::strstr(vendor, "Intel") || std::strstr(renderer, "Intel")) {
+        return GPU_TIER_INTEGRATED;
+    }
+    for (const char *integrated : {"Apple", "Adreno", "Mali", "PowerVR", "Radeon(TM) Graphics", "Radeon Graphics", "Vega 3",
+                                   "Vega 6", "Vega 8", "Vega 10", "Vega 11"}) {
+        if (std::strstr(renderer, integrated)) {
+            return GPU_TIER_INTEGRATED;
+        }
+    }
+    return GPU_TIER_DISCRETE;
+}
+
+// Tier of the GPU behind the current context
+inline GpuTier currentGpuTier() {
+    return classifyGpu((const char *)glGetString(GL_VENDOR), (const char *)glGetString(GL_RENDERER));
+}
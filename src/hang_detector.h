@@ -0,0 +1,194 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "allocation_guard.h"
+#include "profiler.h"
+#include "small_function.h"
+#include "thread_config.h"
+#include "thread_stacks.h"
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+// Watchdog for a main loop that stops coming round: stuck in a driver wait, or
+// deadlocked against one of its threads, which on a cabinet is a frozen screen and
+// nothing else. The loop calls beat() once per iteration, a single relaxed store of
+// its own count. A thread of its own checks the count every SLICE; once it has not
+// moved for timeout seconds, it writes hang-<time>.txt into the dump directory:
+//
+//   - the stack of every thread configureThread registered (ThreadStacks), as
+//     module+offset return addresses (addr2line resolves them; see
+//     AllocationGuard::printSite). A thread that does not answer within
+//     SIGNAL_WAIT has no stack.
+//   - each profiler ring's open zone and its latest finished ones;
+//   - whatever the game's dumpState writes: its clock and the entities it last drew.
+//
+// It reports a hang once; if the loop comes round again it is armed anew. With
+// restart set it then starts the game afresh with the same arguments and ends this
+// process without running its destructors, which may be what is stuck.
+struct HangDetector {
+    static constexpr double SLICE = 0.1;        // seconds between checks of the heartbeat
+    static constexpr double SIGNAL_WAIT = 0.2;  // seconds a thread has to record its stack
+    static const int STACK_DEPTH = 32;
+    static const int RECENT_ZONES = 8;          // finished zones shown per ring
+
+    bool enabled = false;
+    std::atomic<uint64_t> heartbeat{0};
+    uint64_t beats = 0; // the loop's own count; only it writes
+    double timeout = 10.0;
+    std::string directory;
+    bool restart = false;
+    std::vector<std::string> arguments; // this process's, for restarting
+    std::vector<char *> argumentList;   // into arguments, NUL-terminated: built at start, as a hung thread may hold the allocator's lock
+    SmallFunction<void(FILE *), 16> dumpState;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    uint64_t hangs = 0;
+
+    // Main loop: one relaxed store
+    void beat() {
+        heartbeat.store(++beats, std::memory_order_relaxed);
+    }
+
+    void start(double seconds, const std::string &dumpDirectory, bool restartAfter, int argc, char **argv) {
+        timeout = seconds;
+        directory = dumpDirectory.empty() ? "." : dumpDirectory;
+        restart = restartAfter;
+        arguments.assign(argv, argv + argc);
+        argumentList.clear();
+        for (std::string &a : arguments) {
+            argumentList.push_back(&a[0]);
+        }
+        argumentList.push_back(nullptr);
+        ThreadStacks::install();
+        enabled = running = true;
+        worker = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        running = false;
+        worker.join();
+        enabled = false;
+    }
+
+    void run() {
+        configureThread(THREAD_IO, "hang detector");
+        uint64_t last = heartbeat.load(std::memory_order_relaxed);
+        auto lastChange = std::chrono::steady_clock::now();
+        bool reported = false;
+        while (running) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(SLICE));
+            uint64_t now = heartbeat.load(std::memory_order_relaxed);
+            auto time = std::chrono::steady_clock::now();
+            if (now != last) {
+                last = now;
+                lastChange = time;
+                reported = false;
+                continue;
+            }
+            double stalled = std::chrono::duration<double>(time - lastChange).count();
+            if (!reported && stalled >= timeout) {
+                reported = true;
+                hangs++;
+                dump(now, stalled);
+                if (restart) {
+                    relaunch();
+                }
+            }
+        }
+    }
+
+    // Write the report; the path is printed too, in case stdout is all that is kept
+    void dump(uint64_t beat, double stalled) {
+        char path[512];
+        std::snprintf(path, sizeof(path), "%s/hang-%lld.txt", directory.c_str(), (long long)std::time(nullptr));
+        FILE *out = std::fopen(path, "w");
+        if (!out) {
+            std::fprintf(stderr, "Main loop stalled for %.1f s; cannot write %s\n", stalled, path);
+            return;
+        }
+        std::fprintf(out, "main loop stalled for %.1f s after iteration %llu\n", stalled, (unsigned long long)beat);
+
+        std::fprintf(out, "\nthreads\n");
+        uint32_t count = threadConfig.registered.load(std::memory_order_acquire);
+        for (uint32_t i = count > ThreadConfig::MAX_THREADS ? count - ThreadConfig::MAX_THREADS : 0; i < count; i++) {
+            const ThreadConfig::Registered &r = threadConfig.threads[i % ThreadConfig::MAX_THREADS];
+            void *frames[STACK_DEPTH];
+            int depth = ThreadStacks::capture(r, frames, STACK_DEPTH, SIGNAL_WAIT);
+            std::fprintf(out, "  %s:", r.name ? r.name : "?");
+            if (depth < 0) {
+                std::fprintf(out, " no stack: exited, not answering, or this thread");
+            }
+            for (int f = 0; f < depth; f++) {
+                AllocationGuard::printFrame(frames[f], out);
+            }
+            std::fprintf(out, "\n");
+        }
+
+        // Rings are only written by their threads; a stalled one holds still, and a
+        // zone a live one overwrites meanwhile is at worst shown torn
+        std::fprintf(out, "\nprofiler zones, latest first\n");
+        std::unique_lock<std::mutex> guard(profiler.lock, std::try_to_lock); // a stuck thread may hold it
+        if (!guard) {
+            std::fprintf(out, "  profiler locked\n");
+        } else {
+            double ticksPerMs = profiler.ticksPerMicro() * 1000.0;
+            uint64_t now = profileTicks();
+            for (const auto &ring : profiler.rings) {
+                const char *active = ring->active;
+                std::fprintf(out, "  %s: in %s\n", ring->name.c_str(), active ? active : "no zone");
+                uint64_t head = ring->head.load(std::memory_order_acquire);
+                for (uint64_t k = 0; k < (uint64_t)RECENT_ZONES && k < head && k < Profiler::RING_CAPACITY; k++) {
+                    Profiler::Zone z = ring->zones[(head - 1 - k) % Profiler::RING_CAPACITY];
+                    std::fprintf(out, "    %-24s %8.2f ms, ended %.1f ms ago\n", z.name, (z.end - z.start) / ticksPerMs,
+                                 (now - z.end) / ticksPerMs);
+                }
+            }
+            guard.unlock();
+        }
+
+        if (dumpState) {
+            std::fprintf(out, "\ngame state\n");
+            dumpState(out);
+        }
+        std::fclose(out);
+        std::fprintf(stderr, "Main loop stalled for %.1f s; state written to %s\n", stalled, path);
+    }
+
+    // Start the game again with this process's arguments and end this one. The
+    // child of a multithreaded fork only execs or exits: nothing there may allocate.
+    void relaunch() {
+        std::fflush(nullptr);
+#ifdef _WIN32
+        STARTUPINFOA startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION process = {};
+        char path[MAX_PATH];
+        GetModuleFileNameA(nullptr, path, MAX_PATH);
+        if (CreateProcessA(path, GetCommandLineA(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startup, &process)) {
+            CloseHandle(process.hThread);
+            CloseHandle(process.hProcess);
+        }
+        TerminateProcess(GetCurrentProcess(), 3);
+#else
+        char **argv = argumentList.data();
+        if (fork() == 0) {
+            execv("/proc/self/exe", argv);
+            execvp(argv[0], argv);
+            _exit(127);
+        }
+        _exit(3);
+#endif
+    }
+};
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include "frame_stats.h"
+#include "gl_debug_log.h"
+#include "profiler.h"
+
+// Frame-budget watchdog. Every completed frame, CPU and GPU timings both in, is held
+// against the budget; one that overruns it by more than thresholdMs is written to a
+// text log with what it was doing: its per-phase CPU times and GPU time, the longest
+// profiler zones on any thread that ran through it, and the driver's performance
+// warnings (--gl-perf-log) raised since it began. GPU times come back a few frames
+// late, but the profiler rings and the warning list still hold that frame by then.
+// Nothing here allocates once the file is open, and each hitch is flushed, so a
+// log from a stuttering session in the field survives the game being killed.
+struct HitchLog {
+    static constexpr int ZONES = 8; // longest zones reported per hitch
+
+    FILE *out = nullptr;
+    double thresholdMs = 0.0;
+    uint64_t hitches = 0;
+
+    bool open(const char *path, double threshold, double budgetMs) {
+        out = fopen(path, "w");
+        if (!out) {
+            return false;
+        }
+        thresholdMs = threshold;
+        fprintf(out, "Frames over the %.2f ms budget by more than %.2f ms%s\n", budgetMs, thresholdMs,
+                glDebugLog.enabled ? "" : "; driver warnings need --gl-perf-log");
+        fflush(out);
+        return true;
+    }
+
+    void check(const FrameRecord &record, double budgetMs) {
+        double worst = std::max(record.cpuTotal, record.gpu);
+        if (!out || worst - budgetMs <= thresholdMs) {
+            return;
+        }
+        hitches++;
+        double ticksPerMs = profiler.ticksPerMicro() * 1000.0;
+        fprintf(out, "\nframe %llu: %.2f ms over, cpu %.2f ms", (unsigned long long)record.frame, worst - budgetMs,
+                record.cpuTotal);
+        if (record.gpu >= 0.0) {
+            fprintf(out, ", gpu %.2f ms", record.gpu);
+        }
+        fprintf(out, "\n  phases:");
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            fprintf(out, " %s %.2f", FRAME_PHASE_NAMES[p], record.cpu[p]);
+        }
+        if (record.gpu >= 0.0) {
+            fprintf(out, " gpu %.2f", record.gpu);
+        }
+        if (record.resolve >= 0.0) {
+            fprintf(out, " (msaa resolve %.2f)", record.resolve);
+        }
+        fprintf(out, "\n");
+
+        Profiler::ZoneHit zones[ZONES];
+        int count = profiler.longest(record.start, record.end, zones, ZONES);
+        for (int i = 0; i < count; i++) {
+            const Profiler::Zone &z = zones[i].zone;
+            fprintf(out, "  zone %-24s %8.2f ms from %+.2f ms on %s\n", z.name, (z.end - z.start) / ticksPerMs,
+                    ((double)z.start - (double)record.start) / ticksPerMs, zones[i].ring->name.c_str());
+        }
+
+        // Oldest first, from the frame's start on
+        uint64_t total = glDebugLog.warnings;
+        for (uint64_t i = total > GlDebugLog::RECENT ? total - GlDebugLog::RECENT : 0; i < total; i++) {
+            const GlDebugLog::Warning &w = glDebugLog.recent[i % GlDebugLog::RECENT];
+            if (w.time >= record.start) {
+                fprintf(out, "  gl warning at %+.2f ms in %s, id %u: %s\n",
+                        ((double)w.time - (double)record.start) / ticksPerMs, w.zone, w.id, w.text);
+            }
+        }
+        fflush(out);
+    }
+
+    void close() {
+        if (out) {
+            fclose(out);
+            out = nullptr;
+            if (hitches > 0) {
+                printf("%llu hitches logged\n", (unsigned long long)hitches);
+            }
+        }
+    }
+};
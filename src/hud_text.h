@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "draw_list.h"
+#include "game_rules.h"
+#include "perf_overlay.h"
+#include "sdf_font.h"
+#include "sprite_batch.h"
+
+// One line of text whose glyph quads are kept between frames. set() compares the
+// new string with the cached one and rebuilds only the instances of characters
+// that changed, so a score ticking up every frame rewrites the digits that moved
+// and nothing else. Glyphs come from the overlay's baked font texture, or from its
+// distance field (sdf_font.h) when drawn with the SDF variant.
+struct TextLabel {
+    static const int MAX_CHARS = 24;
+
+    glm::vec2 origin = glm::vec2(0.0f); // top-left corner of the first glyph
+    float scale = 2.0f;                 // playfield units per font pixel
+    bool sdf = false;                   // rects into SdfFont's texture instead of the overlay's
+    char text[MAX_CHARS + 1] = {};      // as drawn: glyphOf() of each character
+    int length = 0;
+    SpriteInstance glyphs[MAX_CHARS];
+    uint64_t rewrites = 0; // glyph instances rebuilt since setup
+
+    void setup(float x, float y, float pixelScale, bool distanceField) {
+        origin = glm::vec2(x, y);
+        scale = pixelScale;
+        sdf = distanceField;
+        std::memset(text, 0, sizeof(text));
+        length = 0;
+    }
+
+    // Show s, truncated to MAX_CHARS
+    void set(const char *s) {
+        int n = 0;
+        for (; n < MAX_CHARS && s[n]; n++) {
+            char c = PerfOverlay::glyphOf(s[n]);
+            if (c != text[n]) {
+                text[n] = c;
+                glyphs[n] = glyph(n, c);
+                rewrites++;
+            }
+        }
+        for (int i = n; i < length; i++) {
+            text[i] = 0; // rebuilt if a longer string comes back
+        }
+        length = n;
+    }
+
+    SpriteInstance glyph(int i, char c) const {
+        float w = PerfOverlay::GLYPH_WIDTH * scale, h = PerfOverlay::CELL * scale;
+        glm::vec2 centre(origin.x + i * w + w / 2, origin.y - h / 2);
+        return makeSpriteInstance(centre, glm::vec2(w, h), 0.0f, sdf ? SdfFont::glyphRect(c) : PerfOverlay::glyphRect(c));
+    }
+
+    // Add the cached glyphs to a list, blanks left out
+    void record(DrawList &list, uint8_t layer) const {
+        for (int i = 0; i < length; i++) {
+            if (text[i] != ' ') {
+                list.add(DrawList::makeKey(layer, 0, 0, (uint32_t)list.commands.size()), glyphs[i]);
+            }
+        }
+    }
+};
+
+// In-game heads-up display: score, time survived and the best score, top right of
+// the playfield. With the distance-field font the text stays sharp however far the
+// view scales the playfield up. Labels cache their glyphs; each frame only copies them into the
+// list and draws it through the sprite batch in one call.
+struct Hud {
+    static const int LABELS = 3;
+    static constexpr float SCALE = 2.0f;
+
+    bool enabled = false;
+    DrawList list;
+    TextLabel score, time, best;
+    unsigned long long firstTick = 0; // of the run being scored
+
+    // fontTexture is the overlay's with a nearest sampler, or SdfFont's with a linear
+    // one and the SDF program variant
+    void setup(ShaderProgram *program, GLuint fontTexture, GLuint sampler, bool sdf) {
+        float lineHeight = (PerfOverlay::CELL + 2) * SCALE;
+        float left = WIDTH - 8.0f - 12 * PerfOverlay::GLYPH_WIDTH * SCALE; // room for 12 characters
+        float top = HEIGHT - 8.0f;
+        score.setup(left, top, SCALE, sdf);
+        time.setup(left, top - lineHeight, SCALE, sdf);
+        best.setup(left, top - 2 * lineHeight, SCALE, sdf);
+        list.shader(program);
+        list.texture(fontTexture, sampler);
+        list.reserve(LABELS * TextLabel::MAX_CHARS);
+        enabled = true;
+    }
+
+    uint64_t rewrites() const {
+        return score.rewrites + time.rewrites + best.rewrites;
+    }
+
+    void draw(SpriteBatch &batch) {
+        if (!enabled) {
+            return;
+        }
+        list.clear();
+        for (const TextLabel *label : {&score, &time, &best}) {
+            label->record(list, DrawList::TRANSLUCENT);
+        }
+        batch.submit(list);
+    }
+};
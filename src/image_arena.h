@@ -0,0 +1,143 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <vector>
+#include "allocation_guard.h"
+
+// Bump allocator behind stb_image's STBI_MALLOC / STBI_REALLOC_SIZED / STBI_FREE
+// (see include/stb_image/stb_image.cpp). Decoding a PNG allocates and regrows a
+// handful of buffers; inside an ImageArenaScope they come out of a few large blocks
+// instead, the inflate buffer grows in place when it is the newest allocation, and
+// frees are no-ops until reset() drops everything at once after the upload. Blocks
+// are kept across resets, so steady-state bulk loading does not touch malloc. They
+// come from operator new so the heap accounting in memory_stats.h sees them.
+struct ImageArena {
+    static const size_t BLOCK_SIZE = 4 << 20;
+    static const size_t ALIGNMENT = 16;
+
+    struct Block {
+        unsigned char *data;
+        size_t size, used;
+    };
+
+    std::vector<Block> blocks;
+    size_t current = 0;           // block taking new allocations
+    unsigned char *last = nullptr; // newest allocation, which may grow in place
+    size_t peak = 0, used = 0;     // bytes handed out, for tuning BLOCK_SIZE
+
+    ImageArena() = default;
+    ImageArena(const ImageArena &) = delete;
+    ImageArena &operator=(const ImageArena &) = delete;
+
+    ~ImageArena() {
+        for (Block &b : blocks) {
+            delete[] b.data;
+        }
+    }
+
+    static size_t align(size_t n) {
+        return (n + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    void *allocate(size_t n) {
+        n = align(n ? n : 1);
+        while (current < blocks.size() && blocks[current].size - blocks[current].used < n) {
+            current++;
+        }
+        if (current == blocks.size()) {
+            size_t size = n > BLOCK_SIZE ? n : BLOCK_SIZE;
+            unsigned char *data = new (std::nothrow) unsigned char[size];
+            if (!data) {
+                return nullptr;
+            }
+            blocks.push_back({data, size, 0});
+        }
+        Block &b = blocks[current];
+        last = b.data + b.used;
+        b.used += n;
+        used += n;
+        peak = used > peak ? used : peak;
+        return last;
+    }
+
+    void *reallocate(void *p, size_t oldSize, size_t newSize) {
+        if (!p) {
+            return allocate(newSize);
+        }
+        if (p == last && current < blocks.size()) {
+            Block &b = blocks[current];
+            size_t start = (size_t)(last - b.data);
+            if (start + align(newSize) <= b.size) {
+                used += align(newSize) - (b.used - start);
+                peak = used > peak ? used : peak;
+                b.used = start + align(newSize);
+                return p;
+            }
+        }
+        void *moved = allocate(newSize);
+        if (moved) {
+            std::memcpy(moved, p, oldSize < newSize ? oldSize : newSize);
+        }
+        return moved;
+    }
+
+    bool owns(const void *p) const {
+        for (const Block &b : blocks) {
+            if (p >= b.data && p < b.data + b.size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Forget every allocation; nothing decoded before this may be used afterwards
+    void reset() {
+        for (Block &b : blocks) {
+            b.used = 0;
+        }
+        current = 0;
+        last = nullptr;
+        used = 0;
+    }
+};
+
+// Arena receiving this thread's stb_image allocations; null uses malloc
+inline thread_local ImageArena *imageArena = nullptr;
+
+// Routes stb_image allocations on this thread into an arena while in scope
+struct ImageArenaScope {
+    ImageArena *previous;
+
+    explicit ImageArenaScope(ImageArena &arena) : previous(imageArena) {
+        imageArena = &arena;
+    }
+
+    ~ImageArenaScope() {
+        imageArena = previous;
+    }
+};
+
+inline void *imageMalloc(size_t size) {
+    if (imageArena) {
+        return imageArena->allocate(size);
+    }
+    allocationGuard.record(size);
+    return std::malloc(size);
+}
+
+inline void *imageRealloc(void *p, size_t oldSize, size_t newSize) {
+    if (imageArena && (!p || imageArena->owns(p))) {
+        return imageArena->reallocate(p, oldSize, newSize);
+    }
+    allocationGuard.record(newSize);
+    return std::realloc(p, newSize);
+}
+
+inline void imageFree(void *p) {
+    if (!imageArena || !imageArena->owns(p)) {
+        std::free(p);
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <stb_image.h>
+#include "mapped_file.h"
+#include "png_decoder.h"
+
+// The decoders images can go through, picked per call or for the whole game with
+// --image-decoder. FAST is png_decoder.h, falling back to stb_image for any file it
+// does not take; STB is stb_image alone, kept for comparison (bench_decode) and as
+// the reference should the fast path ever decode something differently.
+enum ImageDecoderKind { IMAGE_DECODER_STB, IMAGE_DECODER_FAST, IMAGE_DECODERS };
+
+inline const char *const IMAGE_DECODER_NAMES[IMAGE_DECODERS] = {"stb", "fast"};
+
+inline ImageDecoderKind imageDecoder = IMAGE_DECODER_FAST;
+
+// The decoder named name, or IMAGE_DECODERS if there is none
+inline ImageDecoderKind findImageDecoder(const char *name) {
+    for (int k = 0; k < IMAGE_DECODERS; k++) {
+        if (std::strcmp(IMAGE_DECODER_NAMES[k], name) == 0) {
+            return (ImageDecoderKind)k;
+        }
+    }
+    return IMAGE_DECODERS;
+}
+
+// RGBA8 pixels of an image in memory, or nullptr; free with stbi_image_free
+inline unsigned char *decodeImage(const unsigned char *bytes, size_t size, int *width, int *height,
+                                  ImageDecoderKind kind = imageDecoder) {
+    if (kind == IMAGE_DECODER_FAST) {
+        if (unsigned char *pixels = decodePng(bytes, size, width, height)) {
+            return pixels;
+        }
+    }
+    int channels;
+    return stbi_load_from_memory(bytes, (int)size, width, height, &channels, 4);
+}
+
+// The same for a file, decoded from a mapping of it rather than a copy
+inline unsigned char *decodeImageFile(const std::string &path, int *width, int *height,
+                                      ImageDecoderKind kind = imageDecoder) {
+    MappedFile file;
+    return file.open(path) ? decodeImage(file.data, file.size, width, height, kind) : nullptr;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include "lockfree_queue.h"
+
+// One key press, stamped with glfwGetTimerValue() when GLFW delivered it
+struct InputEvent {
+    uint64_t time;
+    int key;
+};
+
+// Lock-free ring from the input callbacks (producer, main thread) to the fixed-step
+// simulation (consumer). Each tick takes the events stamped at or before the moment
+// the tick stands for, so input lands on a definite tick however the render and
+// simulation loops happen to interleave. Fixed capacity: nothing allocates, and
+// presses beyond it are dropped (counted), which only a stuck simulation can cause.
+struct InputQueue {
+    static const uint32_t CAPACITY = 256; // power of two
+
+    SpscQueue<InputEvent, CAPACITY> events;
+    uint32_t dropped = 0;
+
+    // Producer
+    bool push(const InputEvent &event) {
+        if (!events.push(event)) {
+            dropped++;
+            return false;
+        }
+        return true;
+    }
+
+    // Consumer: take the oldest event if it happened at or before until
+    bool popUntil(uint64_t until, InputEvent &event) {
+        const InputEvent *oldest = events.front();
+        if (!oldest || oldest->time > until) {
+            return false;
+        }
+        event = *oldest;
+        events.popFront();
+        return true;
+    }
+
+    // Producer: visit the events not yet consumed, oldest first
+    template <typename Visit>
+    void forEachPending(Visit visit) const {
+        events.forEachPending(visit);
+    }
+};
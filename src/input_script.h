@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GLFW/glfw3.h>
+
+// Key presses tagged with the simulation tick that applied them, so a play session
+// can be replayed tick for tick by the headless benchmark. Text format, one event
+// per line, '#' starts a comment:
+//
+//   <tick> LEFT|RIGHT
+struct InputScript {
+    struct Event {
+        uint64_t tick;
+        int key;
+    };
+
+    std::vector<Event> events;
+
+    static const char *keyName(int key) {
+        return key == GLFW_KEY_LEFT ? "LEFT" : key == GLFW_KEY_RIGHT ? "RIGHT" : nullptr;
+    }
+
+    static int keyFromName(const char *name) {
+        return strcmp(name, "LEFT") == 0 ? GLFW_KEY_LEFT : strcmp(name, "RIGHT") == 0 ? GLFW_KEY_RIGHT : GLFW_KEY_UNKNOWN;
+    }
+
+    // Keep a press if it is one the game reacts to
+    void record(uint64_t tick, int key) {
+        if (keyName(key)) {
+            events.push_back({tick, key});
+        }
+    }
+
+    // Parse a script; events must be in tick order. False if unreadable or malformed.
+    bool load(const std::string &path) {
+        events.clear();
+        FILE *in = std::fopen(path.c_str(), "r");
+        if (!in) {
+            return false;
+        }
+        char line[128];
+        bool ok = true;
+        while (ok && std::fgets(line, sizeof(line), in)) {
+            unsigned long long tick;
+            char name[16];
+            if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+                continue;
+            }
+            int key = GLFW_KEY_UNKNOWN;
+            if (std::sscanf(line, "%llu %15s", &tick, name) == 2) {
+                key = keyFromName(name);
+            }
+            ok = key != GLFW_KEY_UNKNOWN && (events.empty() || tick >= events.back().tick);
+            if (ok) {
+                events.push_back({tick, key});
+            }
+        }
+        std::fclose(in);
+        return ok;
+    }
+
+    bool save(const std::string &path) const {
+        FILE *out = std::fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::fprintf(out, "# space-travel input script: <tick> LEFT|RIGHT\n");
+        for (const Event &e : events) {
+            std::fprintf(out, "%llu %s\n", (unsigned long long)e.tick, keyName(e.key));
+        }
+        return std::fclose(out) == 0;
+    }
+};
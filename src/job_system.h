@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "thread_config.h"
+
+// Small work-stealing thread pool. Every worker owns a deque: it pops its own work
+// from the back and, when empty, steals from the front of the others. The thread
+// calling parallelFor helps run chunks until its range is done, so nested or
+// single-threaded use never deadlocks. The render and simulation threads may both
+// call parallelFor at once; each waits only for its own chunks.
+//
+// Chunk boundaries depend only on the range and grain, never on timing, so any pass
+// whose chunks write disjoint outputs produces the same result on every run.
+struct JobSystem {
+    // A contiguous index range of one parallelFor call
+    struct Job {
+        void (*run)(void *context, uint32_t begin, uint32_t end);
+        void *context;
+        uint32_t begin, end;
+        std::atomic<uint32_t> *remaining;
+    };
+
+    // Fixed-size ring used as a double-ended queue, so queuing never allocates
+    static const uint32_t DEQUE_CAPACITY = 1024;
+
+    struct Worker {
+        std::mutex lock;
+        Job jobs[DEQUE_CAPACITY];
+        uint32_t head = 0, tail = 0; // front at head, back at tail - 1
+        std::thread thread;
+
+        bool empty() const { return head == tail; }
+        bool full() const { return tail - head == DEQUE_CAPACITY; }
+        void pushBack(const Job &job) { jobs[tail++ % DEQUE_CAPACITY] = job; }
+        Job popBack() { return jobs[--tail % DEQUE_CAPACITY]; }
+        Job popFront() { return jobs[head++ % DEQUE_CAPACITY]; }
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::mutex sleepLock;
+    std::condition_variable wake;
+    std::atomic<int> queued{0};
+    std::atomic<bool> running{false};
+    std::atomic<uint32_t> nextWorker{0};
+
+    // Start the workers; 0 keeps everything on the calling thread
+    void start(unsigned threadCount) {
+        running = true;
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers.emplace_back(new Worker());
+        }
+        for (unsigned i = 0; i < threadCount; i++) {
+            workers[i]->thread = std::thread([this, i] { workerLoop(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(sleepLock);
+            running = false;
+        }
+        wake.notify_all();
+        for (auto &w : workers) {
+            w->thread.join();
+        }
+        workers.clear();
+    }
+
+    size_t threadCount() const {
+        return workers.size();
+    }
+
+    // Run fn(begin, end) over [0, count) in chunks of at most grain indices and wait for all of them
+    template <typename Fn>
+    void parallelFor(uint32_t count, uint32_t grain, const Fn &fn) {
+        if (grain == 0) {
+            grain = 1;
+        }
+        if (workers.empty() || count <= grain) {
+            if (count > 0) {
+                fn(0u, count);
+            }
+            return;
+        }
+
+        uint32_t chunks = (count + grain - 1) / grain;
+        std::atomic<uint32_t> remaining(chunks);
+        auto trampoline = [](void *context, uint32_t b, uint32_t e) { (*(const Fn *)context)(b, e); };
+        for (uint32_t c = 0; c < chunks; c++) {
+            uint32_t b = c * grain;
+            uint32_t e = b + grain < count ? b + grain : count;
+            Job job = {trampoline, (void *)&fn, b, e, &remaining};
+            Worker &w = *workers[nextWorker.fetch_add(1, std::memory_order_relaxed) % workers.size()];
+            std::unique_lock<std::mutex> guard(w.lock);
+            if (w.full()) {
+                guard.unlock();
+                execute(job); // deque full: run it here rather than grow
+                continue;
+            }
+            w.pushBack(job);
+            queued++;
+        }
+        {
+            // Taking the lock orders this wake-up after any worker's check of queued
+            std::lock_guard<std::mutex> guard(sleepLock);
+        }
+        wake.notify_all();
+
+        // Help out until every chunk of this call has finished
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            Job job;
+            if (steal(workers.size(), job)) {
+                execute(job);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    void execute(Job &job) {
+        job.run(job.context, job.begin, job.end);
+        job.remaining->fetch_sub(1, std::memory_order_release);
+    }
+
+    // Pop from our own deque (back), else steal from another (front)
+    bool steal(size_t self, Job &out) {
+        if (self < workers.size()) {
+            Worker &own = *workers[self];
+            std::lock_guard<std::mutex> guard(own.lock);
+            if (!own.empty()) {
+                out = own.popBack();
+                queued--;
+                return true;
+            }
+        }
+        for (size_t k = 1; k <= workers.size(); k++) {
+            Worker &victim = *workers[(self + k) % workers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.empty()) {
+                out = victim.popFront();
+                queued--;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(size_t index) {
+        configureThread(THREAD_WORKER, "job worker");
+        while (true) {
+            Job job;
+            if (steal(index, job)) {
+                execute(job);
+                continue;
+            }
+            std::unique_lock<std::mutex> guard(sleepLock);
+            wake.wait(guard, [this] { return !running || queued.load() > 0; });
+            if (!running) {
+                return;
+            }
+        }
+    }
+};
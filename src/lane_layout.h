@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+
+// Lane geometry of the playfield, fixed at compile time: Count equal lanes across
+// a playfield Width pixels wide. The centre and edge tables are built by the
+// constexpr constructor, so spawning, steering and collision read lane positions
+// from constant tables, and the lane count is a template argument rather than a
+// value checked at run time.
+template <int Count>
+struct LaneLayout {
+    static_assert(Count >= 1 && Count <= 127, "lanes are stored as int8_t");
+
+    static constexpr int COUNT = Count;
+    static constexpr int MIDDLE = Count / 2; // the ship's starting lane
+
+    float width = 0.0f;
+    float inverseWidth = 0.0f;
+    float centers[Count] = {};
+    float edges[Count + 1] = {}; // left edge of each lane, then the right edge of the last
+
+    constexpr explicit LaneLayout(float playfieldWidth)
+        : width(playfieldWidth / Count), inverseWidth(Count / playfieldWidth) {
+        for (int lane = 0; lane < Count; lane++) {
+            edges[lane] = lane * width;
+            centers[lane] = edges[lane] + width / 2;
+        }
+        edges[Count] = playfieldWidth;
+    }
+
+    constexpr float center(int lane) const {
+        return centers[lane];
+    }
+
+    // Lane under x, clamped to the playfield
+    constexpr int laneAt(float x) const {
+        int lane = (int)(x * inverseWidth);
+        return lane < 0 ? 0 : lane >= Count ? Count - 1 : lane;
+    }
+
+    // Neighbouring lane one step left or right, staying on the playfield
+    constexpr int step(int lane, int direction) const {
+        int next = lane + direction;
+        return next < 0 ? 0 : next >= Count ? Count - 1 : next;
+    }
+};
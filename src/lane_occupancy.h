@@ -0,0 +1,98 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include "lane_ring.h"
+
+// When each lane is blocked at the ship's height over the coming ticks, as
+// bitboards: bit t of a lane's words is set when some comet will be level with the
+// ship t ticks from now, 64 ticks to a word. Comets fall at one speed, so a spawn
+// knows its whole span up front and is written once, as a run of bits; advance()
+// shifts every lane down a tick. "Is lane L blocked within T ticks" is then a mask
+// and a test per word, and a planner can weigh a whole move with a few ANDs of
+// neighbouring lanes. Spans that start or run past the horizon wait in a short
+// per-lane queue and are shifted in as they come into view, so a low speed or a
+// high tick rate loses nothing. Despawning needs no update: a comet leaves long
+// after its span has shifted out.
+template <int Lanes, int Words>
+struct LaneOccupancy {
+    static constexpr uint32_t HORIZON = 64 * Words; // ticks the bitboards cover
+
+    // Ticks [enter, exit) a comet is level with the ship, absolute
+    struct Span {
+        uint64_t enter, exit;
+    };
+
+    uint64_t bits[Lanes][Words] = {};
+    LaneRing<Span, 16> beyond[Lanes]; // spans, or their tails, past the horizon, in order
+    uint64_t now = 0;
+
+    void reset() {
+        for (int l = 0; l < Lanes; l++) {
+            for (int w = 0; w < Words; w++) {
+                bits[l][w] = 0;
+            }
+            beyond[l].clear();
+        }
+        now = 0;
+    }
+
+    // A comet in lane l at height y, falling fall pixels a tick, level with the ship
+    // while strictly between low and high
+    void add(int l, float y, float fall, float low, float high) {
+        if (y <= low || fall <= 0.0f) {
+            return;
+        }
+        uint64_t enter = y < high ? 0 : (uint64_t)std::floor((y - high) / fall) + 1;
+        uint64_t exit = (uint64_t)std::ceil((y - low) / fall);
+        mark(l, {now + enter, now + exit});
+    }
+
+    void mark(int l, Span span) {
+        uint64_t end = now + HORIZON;
+        for (uint64_t t = span.enter; t < span.exit && t < end;) {
+            uint32_t bit = (uint32_t)(t - now);
+            uint32_t run = (uint32_t)std::min<uint64_t>({span.exit - t, end - t, 64 - bit % 64});
+            bits[l][bit / 64] |= (run == 64 ? ~0ull : (1ull << run) - 1) << (bit % 64);
+            t += run;
+        }
+        if (span.exit > end) {
+            beyond[l].push({std::max(span.enter, end), span.exit}); // 16 deep: far more than fit past any horizon
+        }
+    }
+
+    // Move on a tick: every lane shifts down a bit, and the tick coming into view
+    // takes its bit from the spans waiting past the horizon
+    void advance() {
+        now++;
+        uint64_t top = now + HORIZON - 1;
+        for (int l = 0; l < Lanes; l++) {
+            for (int w = 0; w < Words - 1; w++) {
+                bits[l][w] = bits[l][w] >> 1 | bits[l][w + 1] << 63;
+            }
+            bits[l][Words - 1] >>= 1;
+            LaneRing<Span, 16> &waiting = beyond[l];
+            while (!waiting.empty() && waiting.front().exit <= top) {
+                waiting.pop();
+            }
+            if (!waiting.empty() && waiting.front().enter <= top) {
+                bits[l][Words - 1] |= 1ull << 63;
+            }
+        }
+    }
+
+    // Some comet is level with the ship in lane l within ticks ticks from now
+    // (inclusive); ticks past the horizon are cut to it
+    bool blocked(int l, uint32_t ticks) const {
+        uint32_t count = std::min(ticks + 1, HORIZON);
+        for (int w = 0; count > 0; w++) {
+            uint64_t mask = count >= 64 ? ~0ull : (1ull << count) - 1;
+            if (bits[l][w] & mask) {
+                return true;
+            }
+            count -= std::min(count, 64u);
+        }
+        return false;
+    }
+};
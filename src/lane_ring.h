@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+// What is in one lane, ordered from the bottom of the screen up. Comets only ever
+// enter at the top and leave at the bottom, so with a common fall speed spawn order
+// is height order: spawning pushes at the back, despawning pops the front, and the
+// nearest hazard to the ship is always at or just behind the front. Queries walk
+// from the front and stop at the first element past what they are looking for,
+// which makes them O(1) per lane however dense the field is. Fixed capacity, a power
+// of two; push() on a full ring fails rather than grow.
+template <typename T, uint32_t Capacity>
+struct LaneRing {
+    static_assert((Capacity & (Capacity - 1)) == 0, "LaneRing capacity must be a power of two");
+
+    T items[Capacity];
+    uint32_t head = 0, tail = 0; // lowest at head, highest at tail - 1
+
+    uint32_t size() const { return tail - head; }
+    bool empty() const { return head == tail; }
+    bool full() const { return size() == Capacity; }
+    void clear() { head = tail = 0; }
+
+    // k-th element from the bottom
+    T &operator[](uint32_t k) { return items[(head + k) & (Capacity - 1)]; }
+    const T &operator[](uint32_t k) const { return items[(head + k) & (Capacity - 1)]; }
+    T &front() { return (*this)[0]; }
+
+    bool push(const T &item) {
+        if (full()) {
+            return false;
+        }
+        items[tail++ & (Capacity - 1)] = item;
+        return true;
+    }
+
+    void pop() {
+        head++;
+    }
+
+    // Remove the k-th element, closing the gap from whichever end is nearer
+    void erase(uint32_t k) {
+        if (k < size() / 2) {
+            for (; k > 0; k--) {
+                (*this)[k] = (*this)[k - 1];
+            }
+            head++;
+        } else {
+            for (; k + 1 < size(); k++) {
+                (*this)[k] = (*this)[k + 1];
+            }
+            tail--;
+        }
+    }
+
+    // Restore the order after elements overtook each other, by height(element);
+    // insertion sort, so linear when at most a few are out of place
+    template <typename Height>
+    void reorder(const Height &height) {
+        for (uint32_t k = 1; k < size(); k++) {
+            for (uint32_t j = k; j > 0 && height((*this)[j]) < height((*this)[j - 1]); j--) {
+                std::swap((*this)[j], (*this)[j - 1]);
+            }
+        }
+    }
+};
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <vector>
+#include "memory_stats.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+// Backing store for the big structure-of-arrays buffers: the entity pool's fields
+// and the batch environment's, which in stress and training runs span many
+// megabytes and are walked end to end every tick, so with 4 KB pages they cost a
+// TLB miss every few cache lines. Arrays of at least MIN_BYTES are carved one after
+// another out of chunks mapped straight from the OS, each a whole number of large
+// pages; smaller ones stay on the heap. Arrays reserved together therefore share
+// large pages even when each alone is smaller than one. A chunk is unmapped once
+// everything carved from it is freed; growth leaves a hole until then, which the
+// pool and the environment avoid by sizing their arrays once.
+//
+// With enable() on Windows, chunks are VirtualAlloc'ed with MEM_LARGE_PAGES, which
+// needs the "Lock pages in memory" right (SeLockMemoryPrivilege) and physically
+// contiguous memory; on Linux they are 2 MB aligned and madvise(MADV_HUGEPAGE)d,
+// which needs transparent huge pages set to "madvise" or "always". Wherever that is
+// refused the chunk is mapped with ordinary pages and counted as a fallback, so the
+// game runs the same either way. Bytes carved out are counted under the thread's
+// MemoryTag like heap bytes; chunks that got large pages are counted in
+// memoryStats.largePages.
+struct LargePages {
+    static constexpr size_t MIN_BYTES = 64 * 1024;   // arrays below this stay on the heap
+    static constexpr size_t CHUNK_BYTES = 16u << 20; // mapped at a time, at least
+    static constexpr size_t ALIGN = 64;              // of every array; also the header's size
+
+    struct Chunk {
+        uint8_t *base = nullptr; // null once unmapped; the slot is reused
+        size_t bytes = 0, used = 0;
+        int64_t live = 0; // arrays carved from it and not yet freed
+        bool large = false;
+    };
+
+    // In front of every array carved from a chunk
+    struct alignas(ALIGN) Header {
+        uint32_t chunk;
+        MemoryTag tag;
+    };
+
+    bool enabled = false;
+    size_t pageSize = 0; // large page size, once enabled
+    std::mutex lock;
+    std::vector<Chunk> chunks;
+    int current = -1; // chunk new arrays are carved from
+    uint64_t fallbacks = 0; // chunks that asked for large pages and did not get them
+
+    // Ask the OS for large pages; false, with the reason printed, where it will not
+    // give them. Must run before the arrays are sized.
+    bool enable() {
+#ifdef _WIN32
+        HANDLE token;
+        TOKEN_PRIVILEGES privileges = {};
+        privileges.PrivilegeCount = 1;
+        privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+        bool granted = false;
+        if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token)) {
+            if (LookupPrivilegeValueA(nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)) {
+                AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr);
+                granted = GetLastError() == ERROR_SUCCESS; // ERROR_NOT_ALL_ASSIGNED without the right
+            }
+            CloseHandle(token);
+        }
+        pageSize = GetLargePageMinimum();
+        if (!granted || pageSize == 0) {
+            std::printf("Large pages unavailable: %s\n",
+                        pageSize == 0 ? "not supported" : "this account lacks \"Lock pages in memory\"");
+            return false;
+        }
+#elif defined(__linux__)
+        char mode[128] = "";
+        if (FILE *f = std::fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r")) {
+            if (!std::fgets(mode, sizeof(mode), f)) {
+                mode[0] = '\0';
+            }
+            std::fclose(f);
+        }
+        if (!mode[0] || std::strstr(mode, "[never]")) {
+            std::printf("Large pages unavailable: transparent huge pages are %s\n", mode[0] ? "off" : "not supported");
+            return false;
+        }
+        pageSize = 2u << 20;
+        if (FILE *f = std::fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r")) {
+            unsigned long long size = 0;
+            if (std::fscanf(f, "%llu", &size) == 1 && size > 0) {
+                pageSize = (size_t)size;
+            }
+            std::fclose(f);
+        }
+#else
+        std::printf("Large pages unavailable on this platform\n");
+        return false;
+#endif
+        enabled = true;
+        return true;
+    }
+
+    void *allocate(size_t bytes) {
+        if (bytes < MIN_BYTES) {
+            return ::operator new(bytes);
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        size_t need = ALIGN + (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        if (current < 0 || chunks[current].used + need > chunks[current].bytes) {
+            current = map(need);
+        }
+        Chunk &c = chunks[current];
+        Header *header = (Header *)(c.base + c.used);
+        header->chunk = (uint32_t)current;
+        header->tag = memoryTag;
+        c.used += need;
+        c.live++;
+        memoryStats.add(header->tag, (int64_t)bytes, 1);
+        return header + 1;
+    }
+
+    // bytes must be what allocate() was given, as allocators guarantee
+    void deallocate(void *p, size_t bytes) {
+        if (bytes < MIN_BYTES) {
+            ::operator delete(p);
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        Header *header = (Header *)p - 1;
+        memoryStats.add(header->tag, -(int64_t)bytes, -1);
+        Chunk &c = chunks[header->chunk];
+        if (--c.live > 0) {
+            return;
+        }
+        if ((int)header->chunk == current) {
+            c.used = 0; // empty: carve from the start again
+        } else {
+            unmap(c);
+        }
+    }
+
+    // A chunk of at least need bytes, in a reused slot where one is free
+    int map(size_t need) {
+        size_t granule = enabled ? pageSize : 4096;
+        size_t bytes = (std::max(need, CHUNK_BYTES) + granule - 1) / granule * granule;
+        Chunk c;
+        c.bytes = bytes;
+#ifdef _WIN32
+        if (enabled) {
+            c.base = (uint8_t *)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            c.large = c.base != nullptr;
+            fallbacks += c.large ? 0 : 1; // fragmented physical memory, most likely
+        }
+        if (!c.base) {
+            c.base = (uint8_t *)VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        }
+#else
+        // Over-map by a page so a large-page-aligned run fits, then trim both ends
+        size_t slack = enabled ? pageSize : 0;
+        void *mapped = mmap(nullptr, bytes + slack, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (mapped != MAP_FAILED) {
+            uintptr_t start = (uintptr_t)mapped, aligned = slack ? (start + slack - 1) / slack * slack : start;
+            if (aligned > start) {
+                munmap(mapped, aligned - start);
+            }
+            if (start + slack > aligned) {
+                munmap((void *)(aligned + bytes), start + slack - aligned);
+            }
+            c.base = (uint8_t *)aligned;
+#ifdef MADV_HUGEPAGE
+            if (enabled) {
+                c.large = madvise(c.base, bytes, MADV_HUGEPAGE) == 0;
+                fallbacks += c.large ? 0 : 1;
+            }
+#endif
+        }
+#endif
+        if (!c.base) {
+            throw std::bad_alloc();
+        }
+        if (c.large) {
+            memoryStats.largePages.add((int64_t)bytes, 1);
+        }
+        for (size_t i = 0; i < chunks.size(); i++) {
+            if (!chunks[i].base) {
+                chunks[i] = c;
+                return (int)i;
+            }
+        }
+        chunks.push_back(c);
+        return (int)chunks.size() - 1;
+    }
+
+    void unmap(Chunk &c) {
+        if (c.large) {
+            memoryStats.largePages.add(-(int64_t)c.bytes, -1);
+        }
+#ifdef _WIN32
+        VirtualFree(c.base, 0, MEM_RELEASE);
+#else
+        munmap(c.base, c.bytes);
+#endif
+        c = Chunk();
+    }
+
+    // Bytes the kernel actually backs with huge pages, process-wide; -1 where it
+    // cannot say. madvise is advice: a chunk counted as large may still be waiting
+    // for khugepaged.
+    static int64_t residentBytes() {
+#ifdef __linux__
+        FILE *f = std::fopen("/proc/self/smaps_rollup", "r");
+        if (!f) {
+            return -1;
+        }
+        char line[256];
+        int64_t kb = -1;
+        while (std::fgets(line, sizeof(line), f)) {
+            long long value;
+            if (std::sscanf(line, "AnonHugePages: %lld kB", &value) == 1) {
+                kb = value;
+                break;
+            }
+        }
+        std::fclose(f);
+        return kb < 0 ? -1 : kb * 1024;
+#else
+        return -1;
+#endif
+    }
+
+    void print() const {
+        if (!enabled) {
+            return;
+        }
+        std::printf("large pages: %.2f MB peak in %lld-KB pages, %llu fallbacks", memoryStats.largePages.peak.load() / 1048576.0,
+                    (long long)(pageSize / 1024), (unsigned long long)fallbacks);
+        int64_t resident = residentBytes();
+        if (resident >= 0) {
+            std::printf(", %.2f MB resident in huge pages", resident / 1048576.0);
+        }
+        std::printf("\n");
+    }
+};
+
+inline LargePages largePages;
+
+// Allocator for the vectors that should sit in large pages
+template <typename T>
+struct LargePageAllocator {
+    using value_type = T;
+
+    LargePageAllocator() = default;
+    template <typename U>
+    LargePageAllocator(const LargePageAllocator<U> &) {}
+
+    T *allocate(size_t n) {
+        return (T *)largePages.allocate(n * sizeof(T));
+    }
+
+    void deallocate(T *p, size_t n) {
+        largePages.deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const LargePageAllocator<U> &) const {
+        return true;
+    }
+};
+
+template <typename T>
+using LargePageVector = std::vector<T, LargePageAllocator<T>>;
@@ -0,0 +1,348 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "lockfree_queue.h"
+#include "thread_config.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // Windows, which raises no SIGPIPE
+#endif
+
+// One reply of the leaderboard server, posted back to the game thread
+struct LeaderboardResult {
+    static const int TOP = 5;
+
+    struct Entry {
+        uint64_t ticks;
+        uint32_t simRate;
+    };
+
+    bool ok;
+    uint32_t submitted;   // runs this exchange delivered
+    uint32_t discarded;   // runs thrown away since the last result, the batch being full
+    uint32_t rank, total; // online rank of the latest run delivered, 0 if none; runs on the board
+    uint32_t count;       // entries of top
+    Entry top[TOP];
+    char error[64];       // why it failed
+};
+
+// Online leaderboard over plain HTTP/1.0, on an I/O thread of its own: the game
+// thread only pushes requests onto one SpscQueue and pops results off another, so
+// a slow or unreachable server costs it nothing. Requests that arrive within
+// BATCH_WINDOW of each other go out as one exchange, and a fetch rides along with
+// any submission, since every reply carries the rankings. Each exchange has
+// TIMEOUT seconds from connect to the last byte; runs it failed to deliver are
+// tried again with the next one, or after RETRY_INTERVAL, up to MAX_BATCH of them
+// (runs past that are dropped, and counted off sending all the same). The socket is polled in
+// short slices, so stop() returns promptly even mid-exchange; runs not yet
+// delivered by then are dropped (the local ScoreStore still has them). Protocol:
+//
+//   POST /scores HTTP/1.0, one run per body line:  <ticks> <simRate> <seed>
+//   200 reply body:  rank <rank> <total>, then up to TOP lines of  <ticks> <simRate>
+//
+// An empty body only fetches. Windows builds link ws2_32.
+struct LeaderboardClient {
+    static constexpr double BATCH_WINDOW = 0.25; // seconds to wait for more requests
+    static constexpr double TIMEOUT = 3.0;       // seconds per exchange
+    static constexpr double RETRY_INTERVAL = 10.0;
+    static constexpr double SLICE = 0.05;        // seconds per wait on the socket, between checks of running
+    static const int MAX_BATCH = 32;             // runs per exchange
+    static const size_t MAX_RESPONSE = 2048;
+
+    struct Request {
+        bool fetchOnly;
+        uint64_t ticks, seed;
+        uint32_t simRate;
+    };
+
+    bool enabled = false;
+    std::string host, port;
+    SpscQueue<Request, 64> requests;                 // game thread to I/O thread
+    SpscQueue<LeaderboardResult, 8> results;         // I/O thread to game thread
+    LeaderboardResult latest{};                      // last result the game polled
+    bool received = false;
+    uint32_t sending = 0;                            // runs submitted but not yet confirmed delivered
+    std::atomic<uint32_t> dropped{0};                // requests a full queue or batch turned away
+    std::thread worker;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+
+    // I/O thread only
+    Request unsent[MAX_BATCH];
+    int unsentCount = 0;
+    uint32_t discarded = 0; // runs not yet reported in a result's discarded
+
+    // Start the I/O thread for the server at "host:port"; false if the address has no port
+    bool start(const std::string &address) {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || colon + 1 == address.size()) {
+            return false;
+        }
+        host = address.substr(0, colon);
+        port = address.substr(colon + 1);
+        enabled = running = true;
+        worker = std::thread([this] { run(); });
+        return true;
+    }
+
+    // Game thread: queue a finished run; never waits
+    void submit(uint64_t ticks, uint32_t simRate, uint64_t seed) {
+        if (post({false, ticks, seed, simRate})) {
+            sending++;
+        }
+    }
+
+    // Game thread: ask for the rankings; never waits
+    void fetch() {
+        post({true, 0, 0, 0});
+    }
+
+    bool post(const Request &request) {
+        if (!enabled) {
+            return false;
+        }
+        if (!requests.push(request)) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock); // only ever held briefly: no I/O happens under it
+        }
+        wake.notify_one();
+        return true;
+    }
+
+    // Game thread: take every result that has arrived; true if latest changed
+    bool poll() {
+        bool changed = false;
+        while (results.pop(latest)) {
+            received = changed = true;
+            sending -= std::min(sending, latest.submitted + latest.discarded);
+        }
+        return changed;
+    }
+
+    void run() {
+        configureThread(THREAD_IO, "leaderboard");
+#ifdef _WIN32
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        auto retry = std::chrono::duration<double>(RETRY_INTERVAL);
+        auto batch = std::chrono::duration<double>(BATCH_WINDOW);
+        while (running) {
+            {
+                std::unique_lock<std::mutex> lock(wakeLock);
+                if (unsentCount > 0) {
+                    wake.wait_for(lock, retry, [this] { return !running || requests.size() > 0; });
+                } else {
+                    wake.wait(lock, [this] { return !running || requests.size() > 0; });
+                }
+                wake.wait_for(lock, batch, [this] { return !running; }); // let a burst of requests gather
+            }
+            if (!running) {
+                break;
+            }
+            Request request;
+            while (requests.pop(request)) {
+                if (request.fetchOnly) {
+                    continue;
+                }
+                if (unsentCount < MAX_BATCH) {
+                    unsent[unsentCount++] = request;
+                } else {
+                    discarded++; // a long outage: the local ScoreStore still has the run
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+            LeaderboardResult result{};
+            exchange(result);
+            result.discarded = discarded;
+            if (results.push(result)) {
+                discarded = 0;
+            } else {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    // One POST of every unsent run; they stay unsent unless the server took them
+    void exchange(LeaderboardResult &result) {
+        char body[MAX_BATCH * 48];
+        size_t bodyLength = 0;
+        for (int i = 0; i < unsentCount; i++) {
+            bodyLength += snprintf(body + bodyLength, sizeof(body) - bodyLength, "%llu %u %llu\n",
+                                   (unsigned long long)unsent[i].ticks, unsent[i].simRate, (unsigned long long)unsent[i].seed);
+        }
+        char request[sizeof(body) + 256];
+        int headerLength = snprintf(request, sizeof(request),
+                                    "POST /scores HTTP/1.0\r\nHost: %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\n\r\n",
+                                    host.c_str(), bodyLength);
+        std::memcpy(request + headerLength, body, bodyLength);
+
+        char response[MAX_RESPONSE + 1];
+        size_t received = 0;
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                                std::chrono::duration<double>(TIMEOUT));
+        if (!transfer(request, headerLength + bodyLength, response, MAX_RESPONSE, received, deadline, result)) {
+            return;
+        }
+        response[received] = 0;
+        int status = 0;
+        const char *separator = std::strstr(response, "\r\n\r\n");
+        if (std::sscanf(response, "HTTP/%*d.%*d %d", &status) != 1 || status != 200 || !separator) {
+            snprintf(result.error, sizeof(result.error), "server replied %d", status);
+            return;
+        }
+        const char *line = separator + 4;
+        if (std::sscanf(line, "rank %u %u", &result.rank, &result.total) != 2) {
+            snprintf(result.error, sizeof(result.error), "unreadable reply");
+            return;
+        }
+        while ((line = std::strchr(line, '\n')) && result.count < (uint32_t)LeaderboardResult::TOP) {
+            line++;
+            unsigned long long ticks;
+            unsigned simRate;
+            if (std::sscanf(line, "%llu %u", &ticks, &simRate) == 2) {
+                result.top[result.count++] = {ticks, simRate};
+            }
+        }
+        result.ok = true;
+        result.submitted = (uint32_t)unsentCount;
+        unsentCount = 0;
+    }
+
+#ifdef _WIN32
+    using Socket = SOCKET;
+    static bool valid(Socket s) {
+        return s != INVALID_SOCKET;
+    }
+    static void closeSocket(Socket s) {
+        closesocket(s);
+    }
+    static bool inProgress() {
+        return WSAGetLastError() == WSAEWOULDBLOCK;
+    }
+#else
+    using Socket = int;
+    static bool valid(Socket s) {
+        return s >= 0;
+    }
+    static void closeSocket(Socket s) {
+        ::close(s);
+    }
+    static bool inProgress() {
+        return errno == EINPROGRESS || errno == EWOULDBLOCK || errno == EAGAIN;
+    }
+#endif
+
+    // Wait in SLICE steps until s can be written (or read), the deadline passes or
+    // the client stops; false on the last two
+    bool waitFor(Socket s, bool write, std::chrono::steady_clock::time_point deadline) {
+        while (running && std::chrono::steady_clock::now() < deadline) {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(s, &set);
+            timeval slice = {0, (long)(SLICE * 1e6)};
+            int ready = select((int)s + 1, write ? nullptr : &set, write ? &set : nullptr, nullptr, &slice);
+            if (ready != 0) {
+                return ready > 0;
+            }
+        }
+        return false;
+    }
+
+    // Connect, send the whole request and read until the server closes
+    bool transfer(const char *request, size_t length, char *response, size_t capacity, size_t &received,
+                  std::chrono::steady_clock::time_point deadline, LeaderboardResult &result) {
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+            snprintf(result.error, sizeof(result.error), "cannot resolve %s", host.c_str());
+            return false;
+        }
+        Socket s = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        bool ok = valid(s);
+#ifdef _WIN32
+        u_long nonBlocking = 1;
+        ok = ok && ioctlsocket(s, FIONBIO, &nonBlocking) == 0;
+#else
+        ok = ok && fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+        ok = ok && (connect(s, found->ai_addr, (int)found->ai_addrlen) == 0 || inProgress());
+        freeaddrinfo(found);
+        if (ok && waitFor(s, true, deadline)) {
+            int error = 0;
+            socklen_t size = sizeof(error);
+            ok = getsockopt(s, SOL_SOCKET, SO_ERROR, (char *)&error, &size) == 0 && error == 0;
+        } else {
+            ok = false;
+        }
+        for (size_t sent = 0; ok && sent < length;) {
+            int n = ok && waitFor(s, true, deadline) ? (int)send(s, request + sent, (int)(length - sent), MSG_NOSIGNAL) : -1;
+            ok = n > 0;
+            sent += ok ? (size_t)n : 0;
+        }
+        while (ok && received < capacity) {
+            int n = waitFor(s, false, deadline) ? (int)recv(s, response + received, (int)(capacity - received), 0) : -1;
+            if (n == 0) {
+                break; // the server closed: the reply is complete
+            }
+            ok = n > 0;
+            received += ok ? (size_t)n : 0;
+        }
+        if (valid(s)) {
+            closeSocket(s);
+        }
+        if (!ok) {
+            snprintf(result.error, sizeof(result.error), running ? "no reply within %.0f s" : "stopped", TIMEOUT);
+        }
+        return ok;
+    }
+
+    // Stop the I/O thread, abandoning an exchange in flight within a SLICE
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        worker.join();
+        enabled = false;
+    }
+};
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "mapped_file.h"
+
+// Designed comet waves, memory-mapped at load and read in order by the spawner, so
+// a level costs no parsing and only the pages around the cursor are ever touched.
+// Layout, all little-endian:
+//
+//   LevelHeader
+//   LevelIndexEntry[indexCount]  every indexStride-th spawn's tick and position, for seeking
+//   LevelSpawn[spawnCount]       sorted by tick
+static const char LEVEL_MAGIC[4] = {'S', 'T', 'L', 'V'};
+static const uint32_t LEVEL_VERSION = 1;
+
+struct LevelHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t tickRate; // spawn ticks per simulated second
+    uint32_t spawnCount;
+    uint32_t indexCount;
+    uint32_t indexStride;
+};
+
+struct LevelIndexEntry {
+    uint32_t tick;
+    uint32_t spawn; // index of the first spawn at this tick
+};
+
+struct LevelSpawn {
+    uint32_t tick;
+    uint8_t lane;
+    uint8_t type;   // LevelSpawnType
+    uint16_t speed; // pixels per second
+};
+
+// What a spawn places; unknown types are skipped, so newer levels still load
+enum LevelSpawnType : uint8_t {
+    LEVEL_COMET = 0
+};
+
+// Read-only view of a level with a cursor over its spawns; pointers stay valid
+// while the view is open
+struct LevelFile {
+    static const uint32_t INDEX_STRIDE = 256; // spawns per index entry written
+
+    MappedFile file;
+    const LevelHeader *header = nullptr;
+    const LevelIndexEntry *index = nullptr;
+    const LevelSpawn *spawns = nullptr;
+    uint32_t cursor = 0; // next spawn to hand out
+
+    // Map the file and validate its tables; false if it is missing or malformed
+    bool open(const std::string &path) {
+        header = nullptr;
+        return file.open(path) && openMemory(file.data, file.size);
+    }
+
+    // Validate a level held in memory (at least 4-byte aligned) and point into it
+    bool openMemory(const unsigned char *bytes, size_t size) {
+        header = nullptr;
+        if (size < sizeof(LevelHeader)) {
+            return false;
+        }
+        const LevelHeader *h = (const LevelHeader *)bytes;
+        if (std::memcmp(h->magic, LEVEL_MAGIC, 4) != 0 || h->version != LEVEL_VERSION || h->tickRate == 0 ||
+            h->indexStride == 0) {
+            return false;
+        }
+        size_t tables = sizeof(LevelHeader) + (size_t)h->indexCount * sizeof(LevelIndexEntry) +
+                        (size_t)h->spawnCount * sizeof(LevelSpawn);
+        if (tables > size) {
+            return false;
+        }
+        index = (const LevelIndexEntry *)(bytes + sizeof(LevelHeader));
+        spawns = (const LevelSpawn *)(index + h->indexCount);
+        header = h;
+        cursor = 0;
+        return true;
+    }
+
+    bool isOpen() const {
+        return header != nullptr;
+    }
+
+    bool finished() const {
+        return !header || cursor >= header->spawnCount;
+    }
+
+    // Level tick reached after the given simulated seconds
+    uint64_t tickAt(double seconds) const {
+        return (uint64_t)(seconds * header->tickRate);
+    }
+
+    // Put the cursor on the first spawn at or after tick: a binary search of the
+    // index, then a scan of at most one stride
+    void seek(uint64_t tick) {
+        const LevelIndexEntry *end = index + header->indexCount;
+        const LevelIndexEntry *after = std::upper_bound(index, end, tick, [](uint64_t t, const LevelIndexEntry &e) {
+            return t < e.tick;
+        });
+        cursor = after == index ? 0 : (after - 1)->spawn;
+        while (cursor < header->spawnCount && spawns[cursor].tick < tick) {
+            cursor++;
+        }
+    }
+
+    // The next spawn due at or before tick, advancing the cursor; nullptr when none is due
+    const LevelSpawn *next(uint64_t tick) {
+        if (finished() || spawns[cursor].tick > tick) {
+            return nullptr;
+        }
+        return &spawns[cursor++];
+    }
+
+    void close() {
+        file.close();
+        header = nullptr;
+    }
+};
+
+// Write a level, sorting the spawns by tick and indexing every INDEX_STRIDE-th one
+inline bool writeLevelFile(const std::string &path, uint32_t tickRate, std::vector<LevelSpawn> spawns) {
+    std::stable_sort(spawns.begin(), spawns.end(), [](const LevelSpawn &a, const LevelSpawn &b) {
+        return a.tick < b.tick;
+    });
+    std::vector<LevelIndexEntry> table;
+    for (size_t i = 0; i < spawns.size(); i += LevelFile::INDEX_STRIDE) {
+        size_t first = i;
+        while (first > 0 && spawns[first - 1].tick == spawns[i].tick) {
+            first--; // seek() lands on the first spawn of a tick
+        }
+        table.push_back({spawns[i].tick, (uint32_t)first});
+    }
+
+    LevelHeader header = {};
+    std::memcpy(header.magic, LEVEL_MAGIC, 4);
+    header.version = LEVEL_VERSION;
+    header.tickRate = tickRate;
+    header.spawnCount = (uint32_t)spawns.size();
+    header.indexCount = (uint32_t)table.size();
+    header.indexStride = LevelFile::INDEX_STRIDE;
+
+    FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out) {
+        return false;
+    }
+    bool ok = std::fwrite(&header, sizeof(header), 1, out) == 1;
+    if (!table.empty()) {
+        ok = ok && std::fwrite(table.data(), sizeof(LevelIndexEntry), table.size(), out) == table.size();
+        ok = ok && std::fwrite(spawns.data(), sizeof(LevelSpawn), spawns.size(), out) == spawns.size();
+    }
+    return std::fclose(out) == 0 && ok;
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+// Bytes of a cache line. The producer's and the consumer's indices each get a line
+// of their own, so one side bumping its index never evicts the line the other side
+// is spinning on.
+constexpr size_t CACHE_LINE = 64;
+
+// Bounded lock-free ring from one producer thread to one consumer thread. Indices
+// run freely and wrap at 2^32, which CAPACITY (a power of two) divides, so a slot is
+// index % CAPACITY and the fill level is head - tail. Each side keeps its own copy
+// of the other's index and only reloads it when the copy says the ring is full (or
+// empty), so the common push and pop touch no shared line but the slot itself.
+// Nothing allocates after construction. Shared by every pipeline that hands data
+// from one thread to another: input, audio commands, wave prefetch, game events
+// and captures.
+template <typename T, uint32_t CAPACITY>
+struct SpscQueue {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    // Producer's line: its index and its last view of the consumer's
+    alignas(CACHE_LINE) std::atomic<uint32_t> head{0}; // next slot the producer writes
+    uint32_t tailCache = 0;
+
+    // Consumer's line: its index and its last view of the producer's
+    alignas(CACHE_LINE) std::atomic<uint32_t> tail{0}; // next slot the consumer reads
+    uint32_t headCache = 0;
+
+    alignas(CACHE_LINE) T slots[CAPACITY];
+
+    // Producer: whether a push would fail right now
+    bool full() {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        if (h - tailCache < CAPACITY) {
+            return false;
+        }
+        tailCache = tail.load(std::memory_order_acquire);
+        return h - tailCache == CAPACITY;
+    }
+
+    // Producer: append a copy or a moved value; false if the ring is full
+    bool push(const T &value) {
+        if (full()) {
+            return false;
+        }
+        uint32_t h = head.load(std::memory_order_relaxed);
+        slots[h % CAPACITY] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(T &&value) {
+        if (full()) {
+            return false;
+        }
+        uint32_t h = head.load(std::memory_order_relaxed);
+        slots[h % CAPACITY] = std::move(value);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer: the oldest value, or nullptr if the ring is empty. It stays in place
+    // until popFront(), so a consumer can look before deciding to take it.
+    T *front() {
+        uint32_t t = tail.load(std::memory_order_relaxed);
+        if (t == headCache) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t == headCache) {
+                return nullptr;
+            }
+        }
+        return &slots[t % CAPACITY];
+    }
+
+    // Consumer: release the slot front() returned to the producer
+    void popFront() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Consumer: move the oldest value out; false if the ring is empty
+    bool pop(T &value) {
+        T *oldest = front();
+        if (!oldest) {
+            return false;
+        }
+        value = std::move(*oldest);
+        popFront();
+        return true;
+    }
+
+    // Values queued, as seen from either side; exact only on a quiet ring
+    uint32_t size() const {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    // Producer: visit the values not yet consumed, oldest first. Slots are only
+    // rewritten by push(), so the producer can read them while the consumer runs.
+    template <typename Visit>
+    void forEachPending(Visit visit) const {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        for (uint32_t t = tail.load(std::memory_order_acquire); t != h; t++) {
+            visit(slots[t % CAPACITY]);
+        }
+    }
+};
+
+// Bounded lock-free ring from any number of producer threads to one consumer. Every
+// cell carries a sequence number saying whose turn it is: a producer claims the
+// next index with a compare-and-swap on head, fills the cell and publishes it by
+// advancing the sequence, so producers contend only on head and never wait for
+// each other's copies. Values from one producer come out in the order it pushed
+// them; the interleaving between producers is the order they claimed their slots.
+template <typename T, uint32_t CAPACITY>
+struct MpscQueue {
+    static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+    struct Cell {
+        std::atomic<uint32_t> sequence; // index + 1 once filled; index + CAPACITY once consumed
+        T value;
+    };
+
+    alignas(CACHE_LINE) std::atomic<uint32_t> head{0}; // next index a producer claims
+    alignas(CACHE_LINE) uint32_t tail = 0;             // next index the consumer reads
+    alignas(CACHE_LINE) Cell cells[CAPACITY];
+
+    MpscQueue() {
+        for (uint32_t i = 0; i < CAPACITY; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Any producer: append a copy; false if the ring is full
+    bool push(const T &value) {
+        uint32_t index = head.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell &cell = cells[index % CAPACITY];
+            int32_t turn = (int32_t)(cell.sequence.load(std::memory_order_acquire) - index);
+            if (turn == 0) {
+                if (head.compare_exchange_weak(index, index + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(index + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (turn < 0) {
+                return false; // the cell still holds a value from one lap ago
+            } else {
+                index = head.load(std::memory_order_relaxed); // another producer took it
+            }
+        }
+    }
+
+    // Consumer: move the oldest published value out; false if there is none yet
+    bool pop(T &value) {
+        Cell &cell = cells[tail % CAPACITY];
+        if (cell.sequence.load(std::memory_order_acquire) != tail + 1) {
+            return false;
+        }
+        value = std::move(cell.value);
+        cell.sequence.store(tail + CAPACITY, std::memory_order_release);
+        tail++;
+        return true;
+    }
+};
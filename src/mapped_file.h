@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Read-only memory mapping of a whole file. The OS pages data in on first touch,
+// so handing the mapped pointer straight to GL skips an intermediate read buffer.
+struct MappedFile {
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile() {
+        close();
+    }
+
+    bool open(const std::string &path) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER length;
+        if (!GetFileSizeEx(file, &length) || length.QuadPart == 0) {
+            close();
+            return false;
+        }
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        data = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        size = (size_t)length.QuadPart;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // the mapping keeps the file alive
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        data = (const unsigned char *)view;
+        size = (size_t)info.st_size;
+#endif
+        if (!data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) {
+            munmap((void *)data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
+
+// Read-write shared mapping of a fixed-size file, created or grown to size bytes
+// (new bytes read as zero). Stores to data reach the file whenever the OS writes
+// the pages back; flush() forces that, blocking until they are on disk, so it
+// belongs on a background thread.
+struct WritableMappedFile {
+    unsigned char *data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE, mapping = nullptr;
+#endif
+
+    WritableMappedFile() = default;
+    WritableMappedFile(const WritableMappedFile &) = delete;
+    WritableMappedFile &operator=(const WritableMappedFile &) = delete;
+
+    ~WritableMappedFile() {
+        close();
+    }
+
+    bool open(const std::string &path, size_t length) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                           FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            return false;
+        }
+        LARGE_INTEGER current;
+        if (!GetFileSizeEx(file, &current)) {
+            close();
+            return false;
+        }
+        // Mapping more than the file holds extends it, zero-filled
+        uint64_t mapped = std::max<uint64_t>((uint64_t)current.QuadPart, length);
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, (DWORD)(mapped >> 32), (DWORD)mapped, nullptr);
+        if (!mapping) {
+            close();
+            return false;
+        }
+        data = (unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, length);
+        size = length;
+#else
+        int fd = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || ((size_t)info.st_size < length && ftruncate(fd, (off_t)length) != 0)) {
+            ::close(fd);
+            return false;
+        }
+        void *view = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (view == MAP_FAILED) {
+            return false;
+        }
+        data = (unsigned char *)view;
+        size = length;
+#endif
+        if (!data) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Write the dirty pages back and wait for them to reach the disk
+    bool flush() {
+        if (!data) {
+            return false;
+        }
+#ifdef _WIN32
+        return FlushViewOfFile(data, size) && FlushFileBuffers(file);
+#else
+        return msync(data, size, MS_SYNC) == 0;
+#endif
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (data) {
+            UnmapViewOfFile(data);
+        }
+        if (mapping) {
+            CloseHandle(mapping);
+        }
+        if (file != INVALID_HANDLE_VALUE) {
+            CloseHandle(file);
+        }
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (data) {
+            munmap(data, size);
+        }
+#endif
+        data = nullptr;
+        size = 0;
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <glad/glad.h>
+
+// Object namespace enum from GL 4.3 / KHR_debug; only used here as a key
+#ifndef GL_BUFFER
+#define GL_BUFFER 0x82E0
+#endif
+
+// What a tracked byte belongs to: GPU object kinds first, then CPU subsystems
+enum MemoryTag {
+    MEM_TEXTURES,       // texture storage, every level
+    MEM_STREAMED,       // levels a TextureStreamer keeps resident, within its budget
+    MEM_BUFFERS,        // vertex, transform-feedback, streaming and unpack buffers; vertex arrays count as 0 bytes
+    MEM_RENDER_TARGETS, // default framebuffer and renderbuffers
+    MEM_CPU_OTHER,      // heap allocations outside any MemoryScope
+    MEM_CPU_ENTITIES,   // entity pool, snapshots and draw lists
+    MEM_CPU_ASSETS,     // decoded pixels, atlases and decoder arenas
+    MEM_CPU_RENDERER,   // shader sources, caches and batch staging
+    MEM_CPU_TOOLS,      // profiler rings, traces and frame statistics
+    MEMORY_TAG_COUNT
+};
+
+static const MemoryTag FIRST_CPU_TAG = MEM_CPU_OTHER;
+
+static const char *const MEMORY_TAG_NAMES[MEMORY_TAG_COUNT] = {
+    "textures", "streamed", "buffers", "targets", "other", "entities", "assets", "renderer", "tools"};
+
+// Live bytes and high-water mark of one category; safe to update from any thread
+struct MemoryCounter {
+    std::atomic<int64_t> live{0}, peak{0};
+    std::atomic<int64_t> objects{0};
+
+    void add(int64_t bytes, int64_t count) {
+        int64_t now = live.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        objects.fetch_add(count, std::memory_order_relaxed);
+        int64_t high = peak.load(std::memory_order_relaxed);
+        while (now > high && !peak.compare_exchange_weak(high, now, std::memory_order_relaxed)) {
+        }
+    }
+};
+
+// Estimated memory use by tag. GL objects are registered with their byte size when
+// their storage is (re)defined and dropped on delete; sizes are what the data needs,
+// not what the driver pads it to. CPU heap use is counted by the replaced global
+// operator new in game.cpp, under whichever MemoryScope is active on the thread.
+struct MemoryStats {
+    struct GlObject {
+        MemoryTag tag;
+        int64_t bytes;
+    };
+
+    // The counters are constant-initialised, so allocations made by other static
+    // constructors before this one runs are still counted; the map is kept static
+    // for the same reason
+    MemoryCounter tags[MEMORY_TAG_COUNT];
+    MemoryCounter gpu, cpu; // totals across the tags of each side
+    MemoryCounter largePages; // chunks large_pages.h mapped with large pages; the arrays in them count in cpu
+    static inline std::unordered_map<uint64_t, GlObject> glObjects; // by kind << 32 | name; render thread only
+
+    void add(MemoryTag tag, int64_t bytes, int64_t count = 0) {
+        tags[tag].add(bytes, count);
+        (tag < FIRST_CPU_TAG ? gpu : cpu).add(bytes, count);
+    }
+
+    // Record a GL object's storage, replacing any size recorded for it before.
+    // kind is the object's GL namespace: GL_TEXTURE, GL_BUFFER, GL_RENDERBUFFER, ...
+    void trackGl(GLenum kind, GLuint name, MemoryTag tag, int64_t bytes) {
+        uint64_t key = (uint64_t)kind << 32 | name;
+        auto it = glObjects.find(key);
+        if (it != glObjects.end()) {
+            add(it->second.tag, -it->second.bytes, -1);
+        }
+        glObjects[key] = {tag, bytes};
+        add(tag, bytes, 1);
+    }
+
+    // Forget a deleted GL object; names that were never tracked are ignored
+    void untrackGl(GLenum kind, GLuint name) {
+        auto it = glObjects.find((uint64_t)kind << 32 | name);
+        if (it != glObjects.end()) {
+            add(it->second.tag, -it->second.bytes, -1);
+            glObjects.erase(it);
+        }
+    }
+
+    void untrackGl(GLenum kind, GLsizei count, const GLuint *names) {
+        for (GLsizei i = 0; i < count; i++) {
+            untrackGl(kind, names[i]);
+        }
+    }
+
+    // Live and peak megabytes per tag, then the totals
+    void print() const {
+        printf("memory   %10s %10s %8s\n", "live MB", "peak MB", "objects");
+        for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+            if (t == FIRST_CPU_TAG) {
+                printRow("gpu", gpu);
+            }
+            printRow(MEMORY_TAG_NAMES[t], tags[t]);
+        }
+        printRow("cpu", cpu);
+        if (largePages.peak.load() > 0) {
+            printRow("large", largePages);
+        }
+    }
+
+    static void printRow(const char *name, const MemoryCounter &c) {
+        printf("%-8s %10.2f %10.2f %8lld\n", name, c.live.load() / 1048576.0, c.peak.load() / 1048576.0,
+               (long long)c.objects.load());
+    }
+};
+
+inline MemoryStats memoryStats;
+
+// Bytes of an uncompressed texture with the given number of mip levels
+inline int64_t textureBytes(int width, int height, int bytesPerTexel, int levels = 1) {
+    int64_t bytes = 0;
+    for (int level = 0; level < levels && (width > 0 || height > 0); level++) {
+        bytes += (int64_t)std::max(width, 1) * std::max(height, 1) * bytesPerTexel;
+        width /= 2;
+        height /= 2;
+    }
+    return bytes;
+}
+
+// Levels in a full mip chain down to 1x1
+inline int fullMipLevels(int width, int height) {
+    int levels = 1;
+    while ((width | height) >> levels) {
+        levels++;
+    }
+    return levels;
+}
+
+// Tag counted by heap allocations made on this thread
+inline thread_local MemoryTag memoryTag = MEM_CPU_OTHER;
+
+// Attributes heap allocations on this thread to a subsystem while in scope
+struct MemoryScope {
+    MemoryTag previous;
+
+    explicit MemoryScope(MemoryTag tag) : previous(memoryTag) {
+        memoryTag = tag;
+    }
+
+    ~MemoryScope() {
+        memoryTag = previous;
+    }
+};
@@ -0,0 +1,330 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include "frame_stats.h"
+#include "memory_stats.h"
+#include "shard_counters.h"
+#include "thread_config.h"
+#include "triple_buffer.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // Windows, which raises no SIGPIPE
+#endif
+
+// What the render loop hands the metrics thread: plain numbers, copied out of the
+// stats layer at most once per PUBLISH_INTERVAL
+struct MetricsSnapshot {
+    static const int QUANTILES = 4;
+
+    uint64_t frames, gpuFrames;
+    double cpu[QUANTILES], gpu[QUANTILES]; // ms at each of QUANTILE_FRACTIONS
+    double cpuMax, gpuMax;                 // gpu -1 if not measured
+    double cpuSum, gpuSum;
+    uint64_t cpuOverBudget, gpuOverBudget;
+    uint64_t hitches;     // frames over twice the budget, as the telemetry counts them
+    uint64_t hitchesLogged;
+    double budgetMs;
+    uint32_t entities;
+    uint64_t glWarnings;  // driver performance warnings, with --gl-perf-log
+    int drawCalls;
+};
+
+static const double QUANTILE_FRACTIONS[MetricsSnapshot::QUANTILES] = {0.5, 0.9, 0.99, 0.999};
+
+// Prometheus text exposition of the stats layer on GET /metrics, for dashboards
+// across a fleet of cabinets. The render loop only fills a MetricsSnapshot and
+// publishes it through a triple buffer, once a second at most; memory counters are
+// atomics already and, like the sharded event counters, are read directly.
+// Everything else, accepting, reading the request and formatting, happens on a
+// THREAD_IO thread, so a scrape cannot touch frame time. One connection is served
+// at a time, each within TIMEOUT; the listening socket is polled in SLICE steps so
+// stop() returns promptly. Driver strings are fixed at start. Windows builds link
+// ws2_32.
+struct MetricsServer {
+    static constexpr double PUBLISH_INTERVAL = 1.0; // seconds between snapshots
+    static constexpr double TIMEOUT = 2.0;          // seconds to read a request and write the reply
+    static constexpr double SLICE = 0.1;            // seconds per wait on a socket, between checks of running
+    static const size_t MAX_REQUEST = 1024;
+    static const size_t MAX_RESPONSE = 8192;
+
+#ifdef _WIN32
+    using Socket = SOCKET;
+    static constexpr Socket NO_SOCKET = INVALID_SOCKET;
+    static void closeSocket(Socket s) {
+        closesocket(s);
+    }
+#else
+    using Socket = int;
+    static constexpr Socket NO_SOCKET = -1;
+    static void closeSocket(Socket s) {
+        ::close(s);
+    }
+#endif
+
+    bool enabled = false;
+    TripleBuffer<MetricsSnapshot> snapshots;
+    double lastPublish = -1.0; // render thread's clock, seconds
+    std::string vendor, renderer, version;
+    Socket listener = NO_SOCKET;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<uint64_t> scrapes{0};
+
+    // Listen on every interface at port; false if the port cannot be bound
+    bool start(int port, const char *glVendor, const char *glRenderer, const char *glVersion) {
+#ifdef _WIN32
+        WSADATA data;
+        WSAStartup(MAKEWORD(2, 2), &data);
+#endif
+        listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        if (listener == NO_SOCKET) {
+            return false;
+        }
+        int reuse = 1;
+        setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse));
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons((uint16_t)port);
+        if (bind(listener, (sockaddr *)&address, sizeof(address)) != 0 || listen(listener, 4) != 0) {
+            closeSocket(listener);
+            listener = NO_SOCKET;
+            return false;
+        }
+        vendor = label(glVendor);
+        renderer = label(glRenderer);
+        version = label(glVersion);
+        snapshots.writeSlot() = {};
+        snapshots.publish();
+        enabled = running = true;
+        worker = std::thread([this] { run(); });
+        return true;
+    }
+
+    // A driver string as a label value: quotes, backslashes and line breaks would end it
+    static std::string label(const char *text) {
+        std::string value = text ? text : "unknown";
+        for (char &c : value) {
+            if (c == '"' || c == '\\' || c == '\n') {
+                c = '_';
+            }
+        }
+        return value;
+    }
+
+    // Render thread: due for a snapshot at now seconds?
+    bool due(double now) {
+        if (!enabled || (lastPublish >= 0.0 && now - lastPublish < PUBLISH_INTERVAL)) {
+            return false;
+        }
+        lastPublish = now;
+        return true;
+    }
+
+    // Render thread: the snapshot to fill before publish()
+    MetricsSnapshot &writeSlot() {
+        return snapshots.writeSlot();
+    }
+
+    void publish() {
+        snapshots.publish();
+    }
+
+    // Copy the frame-time distribution out of the histograms
+    static void fill(MetricsSnapshot &m, const FrameStats &stats) {
+        m.frames = stats.cpuHistogram.count;
+        m.gpuFrames = stats.gpuHistogram.count;
+        m.cpuSum = stats.cpuHistogram.sumMs;
+        m.gpuSum = stats.gpuHistogram.sumMs;
+        for (int q = 0; q < MetricsSnapshot::QUANTILES; q++) {
+            m.cpu[q] = stats.cpuHistogram.count ? stats.cpuHistogram.percentile(QUANTILE_FRACTIONS[q]) : 0.0;
+            m.gpu[q] = stats.gpuHistogram.count ? stats.gpuHistogram.percentile(QUANTILE_FRACTIONS[q]) : -1.0;
+        }
+        m.cpuMax = stats.cpuHistogram.maxMs;
+        m.gpuMax = stats.gpuHistogram.count ? stats.gpuHistogram.maxMs : -1.0;
+        m.cpuOverBudget = stats.cpuOverBudget;
+        m.gpuOverBudget = stats.gpuOverBudget;
+        m.budgetMs = stats.budgetMs;
+    }
+
+    void run() {
+        configureThread(THREAD_IO, "metrics");
+        while (running) {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(listener, &set);
+            timeval slice = {0, (long)(SLICE * 1e6)};
+            if (select((int)listener + 1, &set, nullptr, nullptr, &slice) <= 0) {
+                continue;
+            }
+            Socket client = accept(listener, nullptr, nullptr);
+            if (client != NO_SOCKET) {
+                serve(client);
+                closeSocket(client);
+            }
+        }
+    }
+
+    // Wait up to the deadline for s to be readable or writable
+    bool waitFor(Socket s, bool write, std::chrono::steady_clock::time_point deadline) {
+        while (running && std::chrono::steady_clock::now() < deadline) {
+            fd_set set;
+            FD_ZERO(&set);
+            FD_SET(s, &set);
+            timeval slice = {0, (long)(SLICE * 1e6)};
+            int ready = select((int)s + 1, write ? nullptr : &set, write ? &set : nullptr, nullptr, &slice);
+            if (ready != 0) {
+                return ready > 0;
+            }
+        }
+        return false;
+    }
+
+    // Read the request line and headers, then answer and close
+    void serve(Socket client) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                                std::chrono::duration<double>(TIMEOUT));
+        char request[MAX_REQUEST + 1];
+        size_t received = 0;
+        while (received < MAX_REQUEST && waitFor(client, false, deadline)) {
+            int n = (int)recv(client, request + received, (int)(MAX_REQUEST - received), 0);
+            if (n <= 0) {
+                return;
+            }
+            received += (size_t)n;
+            request[received] = 0;
+            if (std::strstr(request, "\r\n\r\n") || std::strstr(request, "\n\n")) {
+                break;
+            }
+        }
+        request[received] = 0;
+        char body[MAX_RESPONSE];
+        size_t bodyLength = 0;
+        const char *status = "404 Not Found";
+        if (std::strncmp(request, "GET /metrics ", 13) == 0 || std::strncmp(request, "GET /metrics?", 13) == 0) {
+            status = "200 OK";
+            bodyLength = format(body, sizeof(body));
+            scrapes.fetch_add(1, std::memory_order_relaxed);
+        }
+        char response[MAX_RESPONSE + 256];
+        int headerLength = snprintf(response, sizeof(response),
+                                    "HTTP/1.0 %s\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %zu\r\n"
+                                    "Connection: close\r\n\r\n",
+                                    status, bodyLength);
+        std::memcpy(response + headerLength, body, bodyLength);
+        size_t length = headerLength + bodyLength;
+        for (size_t sent = 0; sent < length && waitFor(client, true, deadline);) {
+            // A scraper that gave up and closed fails the send rather than raising SIGPIPE
+            int n = (int)send(client, response + sent, (int)(length - sent), MSG_NOSIGNAL);
+            if (n <= 0) {
+                return;
+            }
+            sent += (size_t)n;
+        }
+    }
+
+    // The latest snapshot, the memory counters and the event counters in the text exposition format
+    size_t format(char *out, size_t capacity) {
+        snapshots.acquire();
+        const MetricsSnapshot &m = snapshots.readSlot();
+        size_t n = 0;
+        auto put = [&](const char *fmt, auto... args) {
+            int written = snprintf(out + n, capacity - n, fmt, args...);
+            n += written > 0 ? std::min((size_t)written, capacity - n - 1) : 0;
+        };
+        put("# TYPE space_travel_info gauge\nspace_travel_info{gl_vendor=\"%s\",gl_renderer=\"%s\",gl_version=\"%s\"} 1\n",
+            vendor.c_str(), renderer.c_str(), version.c_str());
+        put("# TYPE space_travel_frame_budget_ms gauge\nspace_travel_frame_budget_ms %g\n", m.budgetMs);
+        const char *sides[2] = {"cpu", "gpu"};
+        const double *quantiles[2] = {m.cpu, m.gpu};
+        double maxima[2] = {m.cpuMax, m.gpuMax}, sums[2] = {m.cpuSum, m.gpuSum};
+        uint64_t counts[2] = {m.frames, m.gpuFrames};
+        put("# TYPE space_travel_frame_ms summary\n");
+        for (int side = 0; side < 2; side++) {
+            if (maxima[side] < 0.0) {
+                continue; // not measured
+            }
+            for (int q = 0; q < MetricsSnapshot::QUANTILES; q++) {
+                put("space_travel_frame_ms{side=\"%s\",quantile=\"%g\"} %.4f\n", sides[side], QUANTILE_FRACTIONS[q],
+                    quantiles[side][q]);
+            }
+            put("space_travel_frame_ms_sum{side=\"%s\"} %.4f\nspace_travel_frame_ms_count{side=\"%s\"} %llu\n", sides[side],
+                sums[side], sides[side], (unsigned long long)counts[side]);
+        }
+        put("# TYPE space_travel_frame_max_ms gauge\n");
+        for (int side = 0; side < 2; side++) {
+            if (maxima[side] >= 0.0) {
+                put("space_travel_frame_max_ms{side=\"%s\"} %.4f\n", sides[side], maxima[side]);
+            }
+        }
+        put("# TYPE space_travel_frames_total counter\nspace_travel_frames_total %llu\n", (unsigned long long)m.frames);
+        put("# TYPE space_travel_frames_over_budget_total counter\n"
+            "space_travel_frames_over_budget_total{side=\"cpu\"} %llu\nspace_travel_frames_over_budget_total{side=\"gpu\"} %llu\n",
+            (unsigned long long)m.cpuOverBudget, (unsigned long long)m.gpuOverBudget);
+        put("# TYPE space_travel_hitches_total counter\nspace_travel_hitches_total %llu\n", (unsigned long long)m.hitches);
+        put("# TYPE space_travel_hitches_logged_total counter\nspace_travel_hitches_logged_total %llu\n",
+            (unsigned long long)m.hitchesLogged);
+        put("# TYPE space_travel_entities gauge\nspace_travel_entities %u\n", m.entities);
+        put("# TYPE space_travel_draw_calls gauge\nspace_travel_draw_calls %d\n", m.drawCalls);
+        put("# TYPE space_travel_gl_performance_warnings_total counter\nspace_travel_gl_performance_warnings_total %llu\n",
+            (unsigned long long)m.glWarnings);
+        put("# TYPE space_travel_memory_bytes gauge\n");
+        for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+            put("space_travel_memory_bytes{tag=\"%s\",side=\"%s\"} %lld\n", MEMORY_TAG_NAMES[t], t < FIRST_CPU_TAG ? "gpu" : "cpu",
+                (long long)memoryStats.tags[t].live.load(std::memory_order_relaxed));
+        }
+        put("# TYPE space_travel_memory_peak_bytes gauge\n");
+        for (int t = 0; t < MEMORY_TAG_COUNT; t++) {
+            put("space_travel_memory_peak_bytes{tag=\"%s\"} %lld\n", MEMORY_TAG_NAMES[t],
+                (long long)memoryStats.tags[t].peak.load(std::memory_order_relaxed));
+        }
+        ShardedCounters::Totals totals = counters.totals();
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            put("# TYPE space_travel_%s_total counter\nspace_travel_%s_total %llu\n", COUNTER_NAMES[c], COUNTER_NAMES[c],
+                (unsigned long long)totals.values[c]);
+        }
+        put("# TYPE space_travel_memory_large_page_bytes gauge\n");
+        put("space_travel_memory_large_page_bytes %lld\n", (long long)memoryStats.largePages.live.load(std::memory_order_relaxed));
+        put("# TYPE space_travel_scrapes_total counter\nspace_travel_scrapes_total %llu\n",
+            (unsigned long long)scrapes.load(std::memory_order_relaxed) + 1);
+        return n;
+    }
+
+    // Stop serving; must not be called from the metrics thread
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        running = false;
+        worker.join();
+        closeSocket(listener);
+        listener = NO_SOCKET;
+        enabled = false;
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include "collision_kernel.h"
+#include "game_rules.h"
+#include "job_system.h"
+#include "lane_occupancy.h"
+#include "lane_ring.h"
+#include "random.h"
+
+// How the scripted bot plays: it looks at the ship's lane every reaction seconds,
+// and when a comet is within lookahead pixels of the ship it presses towards the
+// nearest clear lane, unless it makes a mistake (with probability mistakes) and
+// sits that look out.
+struct BotSkill {
+    float reaction = 0.2f;
+    float lookahead = 150.0f;
+    float mistakes = 0.02f;
+};
+
+// One run of the game without a window: the ship, its lane glide and the comets,
+// ticked by exactly the rules updateGame applies (game_rules.h). Comets are kept as
+// heights in a LaneRing per lane, since they never leave their lane and all fall at
+// COMET_SPEED: the collision test only visits the front of each ring. The bot
+// looks at lane-occupancy bitboards instead, written once per spawn. A run ends on
+// its first hit, as the game does.
+struct HeadlessGame {
+    static constexpr float PASSED = SHIP_Y - (SHIP_SIZE + COMET_SIZE) / 2; // comets at or below it are behind the ship
+    static constexpr float LEVEL = SHIP_Y + (SHIP_SIZE + COMET_SIZE) / 2;  // comets below it and above PASSED are level with it
+
+    LaneRing<float, MAX_COMETS> comets[LANE_COUNT]; // heights, lowest first
+    LaneOccupancy<LANE_COUNT, 4> occupancy; // ticks each lane has a comet level with the ship
+    float fall = 0.0f; // pixels a comet falls per tick, as of the last tick
+    int cometCount = 0;
+    int lane = LANES.MIDDLE;
+    float shipX = LANES.center(LANES.MIDDLE), prevShipX = LANES.center(LANES.MIDDLE);
+    LaneTransition transition;
+    Pcg32 waves, bot;
+    double simTime = 0.0, waveTime = 0.0, lookTime = 0.0;
+    uint32_t ticks = 0;
+    bool collided = false;
+
+    HeadlessGame(const Pcg32 &waveRandom, const Pcg32 &botRandom) : waves(waveRandom), bot(botRandom) {}
+
+    // A comet in lane l is level with the ship now or will be within the ticks it
+    // takes to fall lookahead pixels
+    bool threatened(int l, float lookahead) const {
+        return occupancy.blocked(l, fall > 0.0f ? (uint32_t)std::ceil(lookahead / fall) : 0);
+    }
+
+    // Rewrite the bitboards from the comets' heights as they stand, falling at
+    // deltaTime a tick: for a game whose rings were filled from outside
+    void scan(float deltaTime) {
+        fall = COMET_SPEED * deltaTime;
+        occupancy.reset();
+        for (int l = 0; l < LANE_COUNT; l++) {
+            for (uint32_t k = 0; k < comets[l].size(); k++) {
+                occupancy.add(l, comets[l][k], fall, PASSED, LEVEL);
+            }
+        }
+    }
+
+    // Lane the bot's presses this tick send the ship to. It goes for the nearest lane
+    // clear for lookahead pixels, pressing as often as it takes at once, but only
+    // across lanes no comet reaches during the glide.
+    int press(const BotSkill &skill) {
+        if (simTime < lookTime) {
+            return lane;
+        }
+        lookTime = simTime + skill.reaction;
+        if (!threatened(lane, skill.lookahead) || bot.nextFloat() < skill.mistakes) {
+            return lane;
+        }
+        const float crossing = COMET_SPEED * LANE_TRANSITION_TIME;
+        int first = bot.nextBelow(2) ? 1 : -1; // either way round when both sides are clear
+        for (int distance = 1; distance < LANE_COUNT; distance++) {
+            for (int direction : {first, -first}) {
+                int target = lane + direction * distance;
+                if (target < 0 || target >= LANE_COUNT || threatened(target, skill.lookahead)) {
+                    continue;
+                }
+                int crossed = lane + direction;
+                while (crossed != target && !threatened(crossed, crossing)) {
+                    crossed += direction;
+                }
+                if (crossed == target) {
+                    return target;
+                }
+            }
+        }
+        return lane; // boxed in
+    }
+
+    // One fixed tick with the ship sent to target, in tickSimulation's order: input,
+    // the ship's glide, spawns, comet motion, the swept collision test and despawning
+    void tick(float deltaTime, int target) {
+        prevShipX = shipX;
+        if (target != lane) {
+            lane = target;
+            transition = {shipX, LANES.center(lane), 0.0f};
+        }
+        if (transition.elapsed < LANE_TRANSITION_TIME) {
+            transition.elapsed += deltaTime;
+            shipX = laneTransitionX(transition.fromX, transition.toX, transition.elapsed);
+        }
+
+        fall = COMET_SPEED * deltaTime;
+        for (; waveTime <= simTime + deltaTime; waveTime += WAVE_INTERVAL) {
+            int lanes[2];
+            int count = waveLanes(waves, lanes);
+            for (int i = 0; i < count && cometCount < MAX_COMETS; i++) {
+                comets[lanes[i]].push(SPAWN_Y);
+                occupancy.add(lanes[i], SPAWN_Y, fall, PASSED, LEVEL);
+                cometCount++;
+            }
+        }
+        const float reach = (SHIP_SIZE + COMET_SIZE) / 2, shipMove = shipX - prevShipX;
+        for (int l = 0; l < LANE_COUNT; l++) {
+            LaneRing<float, MAX_COMETS> &ring = comets[l];
+            // Only comets ending the tick within reach above the ship can touch it
+            for (uint32_t k = 0; k < ring.size() && ring[k] - fall - SHIP_Y < reach; k++) {
+                float startY = ring[k];
+                if (sweptOverlap(LANES.center(l) - prevShipX, startY - SHIP_Y, 0.0f - shipMove, (startY - fall) - startY,
+                                 reach, reach)) {
+                    collided = true;
+                }
+            }
+            for (uint32_t k = 0; k < ring.size(); k++) {
+                ring[k] -= fall;
+            }
+            while (!ring.empty() && ring.front() < DESPAWN_Y) {
+                ring.pop();
+                cometCount--;
+            }
+        }
+        occupancy.advance();
+        ticks++;
+        simTime += deltaTime;
+    }
+};
+
+// Many independent headless runs spread over the job system, for tuning difficulty
+// against a scripted bot. Run i draws its waves and the bot's mistakes from streams
+// of its own, keyed by i rather than by the worker that happens to run it, so the
+// whole batch is reproducible from one seed on any number of threads.
+struct MonteCarlo {
+    static const uint32_t GRAIN = 64; // runs per job
+
+    struct Result {
+        uint32_t ticks;
+        bool collided;
+    };
+
+    std::vector<Result> results;
+    double seconds = 0.0; // wall time of the batch
+    float simRate = 120.0f;
+
+    // Play runs games of at most maxTicks ticks each at rate ticks per second
+    void run(JobSystem &jobs, uint64_t seed, uint32_t runs, float rate, uint32_t maxTicks, const BotSkill &skill) {
+        runRange(jobs, seed, 0, runs, rate, maxTicks, skill);
+    }
+
+    // Play runs first to first + count - 1 of the batch, into results[0, count): a
+    // shard of a batch split across processes (monte_carlo_cluster.h)
+    void runRange(JobSystem &jobs, uint64_t seed, uint32_t first, uint32_t count, float rate, uint32_t maxTicks,
+                  const BotSkill &skill) {
+        simRate = rate;
+        results.assign(count, Result{0, false});
+        float deltaTime = 1.0f / rate;
+        auto start = std::chrono::steady_clock::now();
+        jobs.parallelFor(count, GRAIN, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                uint64_t run = first + (uint64_t)i;
+                HeadlessGame game(Pcg32(seed, STREAM_WORKERS + 2 * run), Pcg32(seed, STREAM_WORKERS + 2 * run + 1));
+                while (!game.collided && game.ticks < maxTicks) {
+                    game.tick(deltaTime, game.press(skill));
+                }
+                results[i] = {game.ticks, game.collided};
+            }
+        });
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Throughput, then survival time and how many runs ended in a collision
+    void print() {
+        if (results.empty()) {
+            return;
+        }
+        std::vector<uint32_t> ticks(results.size());
+        uint64_t total = 0, collisions = 0;
+        for (size_t i = 0; i < results.size(); i++) {
+            ticks[i] = results[i].ticks;
+            total += results[i].ticks;
+            collisions += results[i].collided;
+        }
+        std::sort(ticks.begin(), ticks.end());
+        auto percentile = [&](double p) { return ticks[(size_t)(p * (ticks.size() - 1))] / simRate; };
+        std::printf("monte carlo: %zu runs in %.2f s, %.0f runs/s, %.3g ticks/s\n", results.size(), seconds,
+                    results.size() / seconds, total / seconds);
+        std::printf("survival: mean %.1f s, p10 %.1f s, median %.1f s, p90 %.1f s, p99 %.1f s\n",
+                    total / simRate / results.size(), percentile(0.1), percentile(0.5), percentile(0.9),
+                    percentile(0.99));
+        std::printf("collisions: %llu of %zu runs (%.1f%%), the rest reached the tick limit\n",
+                    (unsigned long long)collisions, results.size(), 100.0 * collisions / results.size());
+    }
+};
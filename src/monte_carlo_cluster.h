@@ -0,0 +1,440 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+#include "job_system.h"
+#include "monte_carlo.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // Windows, which raises no SIGPIPE
+#endif
+
+// Blocking TCP stream, for the cluster's few large messages. Windows builds link ws2_32.
+struct TcpStream {
+#ifdef _WIN32
+    SOCKET handle = INVALID_SOCKET;
+#else
+    int handle = -1;
+#endif
+
+    TcpStream() = default;
+    TcpStream(const TcpStream &) = delete;
+    TcpStream &operator=(const TcpStream &) = delete;
+
+    ~TcpStream() {
+        close();
+    }
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return handle != INVALID_SOCKET;
+#else
+        return handle >= 0;
+#endif
+    }
+
+    static bool startup() {
+#ifdef _WIN32
+        WSADATA data;
+        return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+        return true;
+#endif
+    }
+
+    // Connect to "host:port"
+    bool connect(const std::string &address) {
+        close();
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos || !startup()) {
+            return false;
+        }
+        std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+            cleanup();
+            return false;
+        }
+        handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        bool ok = isOpen() && ::connect(handle, found->ai_addr, (int)found->ai_addrlen) == 0;
+        freeaddrinfo(found);
+        if (!ok) {
+            close();
+            return false;
+        }
+        noDelay();
+        return true;
+    }
+
+    // Listen on port on every interface
+    bool listen(uint16_t port) {
+        close();
+        if (!startup()) {
+            return false;
+        }
+        handle = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+        int reuse = 1;
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (!isOpen() || setsockopt(handle, SOL_SOCKET, SO_REUSEADDR, (const char *)&reuse, sizeof(reuse)) != 0 ||
+            bind(handle, (const sockaddr *)&local, sizeof(local)) != 0 || ::listen(handle, 64) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Take the next connection off a listening stream
+    bool accept(TcpStream &from) {
+        close();
+        if (!startup()) {
+            return false;
+        }
+        handle = ::accept(from.handle, nullptr, nullptr);
+        if (!isOpen()) {
+            close();
+            return false;
+        }
+        noDelay();
+        return true;
+    }
+
+    void noDelay() {
+        int on = 1; // messages are written whole; do not hold the small ones back
+        setsockopt(handle, IPPROTO_TCP, TCP_NODELAY, (const char *)&on, sizeof(on));
+    }
+
+    bool sendAll(const void *data, size_t size) {
+        const char *bytes = (const char *)data;
+        while (size > 0) {
+            // A peer that went away fails the send rather than raising SIGPIPE
+            int n = (int)::send(handle, bytes, (int)std::min<size_t>(size, 1 << 20), MSG_NOSIGNAL);
+            if (n <= 0) {
+                return false;
+            }
+            bytes += n;
+            size -= (size_t)n;
+        }
+        return true;
+    }
+
+    // Whatever has arrived, waiting for at least one byte; 0 once the peer has closed
+    size_t receiveSome(void *data, size_t capacity) {
+        int n = (int)::recv(handle, (char *)data, (int)capacity, 0);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    bool receiveAll(void *data, size_t size) {
+        char *bytes = (char *)data;
+        while (size > 0) {
+            size_t n = receiveSome(bytes, size);
+            if (n == 0) {
+                return false;
+            }
+            bytes += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    void cleanup() {
+#ifdef _WIN32
+        WSACleanup();
+#endif
+    }
+
+    void close() {
+        if (!isOpen()) {
+            return;
+        }
+#ifdef _WIN32
+        closesocket(handle);
+        handle = INVALID_SOCKET;
+#else
+        ::close(handle);
+        handle = -1;
+#endif
+        cleanup();
+    }
+};
+
+// A Monte Carlo batch split across processes, on one machine or many. The
+// coordinator hands out shards of the run indices; every run draws only from
+// streams keyed by its index (MonteCarlo::runRange), so any split gives exactly the
+// batch one process would have played. Workers pull: each keeps IN_FLIGHT shards
+// queued, so it never idles on a round trip, and a fast node simply takes more of
+// them, which keeps throughput linear in the nodes added. A worker that drops has
+// its shards handed to the others. Results come back as one packed word per run.
+// Messages are fixed structs, little-endian like the level and replay files:
+//
+//   worker -> coordinator   ClusterHello, then per shard: ClusterShard + uint32_t[count]
+//   coordinator -> worker   ClusterJob, then ClusterShard per shard; count 0 ends the batch
+static const char CLUSTER_MAGIC[4] = {'S', 'T', 'M', 'C'};
+static const uint32_t CLUSTER_VERSION = 1;
+
+struct ClusterHello {
+    char magic[4];
+    uint32_t version;
+    uint32_t threads; // the worker's, for the coordinator's log
+};
+
+struct ClusterJob {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    float simRate;
+    uint32_t maxTicks;
+    float reaction, lookahead, mistakes; // BotSkill
+};
+
+struct ClusterShard {
+    uint32_t first, count;
+};
+
+// Run outcome in one word: ticks survived, top bit set if it ended in a collision
+inline uint32_t packRun(const MonteCarlo::Result &r) {
+    return (r.ticks & 0x7FFFFFFFu) | (r.collided ? 0x80000000u : 0u);
+}
+
+inline MonteCarlo::Result unpackRun(uint32_t word) {
+    return {word & 0x7FFFFFFFu, (word >> 31) != 0};
+}
+
+struct MonteCarloCoordinator {
+    static const uint32_t SHARD_RUNS = 4096; // most runs per shard
+    static const int IN_FLIGHT = 2; // shards queued per worker
+    static const int MAX_WORKERS = FD_SETSIZE - 1 < 256 ? FD_SETSIZE - 1 : 256; // the listener takes a slot of the set
+
+    struct Worker {
+        TcpStream stream;
+        std::vector<uint8_t> inbox; // bytes of the message being received
+        std::deque<ClusterShard> assigned;
+        bool greeted = false;
+        uint32_t threads = 0;
+        uint64_t runs = 0;
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::deque<ClusterShard> pending;
+    uint32_t done = 0, joined = 0;
+
+    // Play runs runs on whichever workers connect to port; results land in batch
+    bool run(MonteCarlo &batch, uint16_t port, const ClusterJob &job, uint32_t runs) {
+        TcpStream listener;
+        if (!listener.listen(port)) {
+            std::printf("monte carlo: cannot listen on port %u\n", port);
+            return false;
+        }
+        batch.simRate = job.simRate;
+        batch.results.assign(runs, MonteCarlo::Result{0, false});
+        uint32_t shardRuns = std::clamp(runs / 256, MonteCarlo::GRAIN, SHARD_RUNS); // small batches still spread out
+        for (uint32_t first = 0; first < runs; first += shardRuns) {
+            pending.push_back({first, std::min(shardRuns, runs - first)});
+        }
+        std::printf("monte carlo: coordinating %u runs in %zu shards on port %u\n", runs, pending.size(), port);
+        auto start = std::chrono::steady_clock::now(), lastReport = start;
+        while (done < runs) {
+            fd_set readable;
+            FD_ZERO(&readable);
+            FD_SET(listener.handle, &readable);
+            int top = (int)listener.handle;
+            for (auto &w : workers) {
+                FD_SET(w->stream.handle, &readable);
+                top = std::max(top, (int)w->stream.handle);
+            }
+            timeval second = {1, 0};
+            if (select(top + 1, &readable, nullptr, nullptr, &second) < 0) {
+                return false;
+            }
+            if (FD_ISSET(listener.handle, &readable) && workers.size() < (size_t)MAX_WORKERS) {
+                std::unique_ptr<Worker> w(new Worker());
+                if (w->stream.accept(listener)) {
+                    workers.push_back(std::move(w));
+                }
+            }
+            for (size_t i = 0; i < workers.size();) {
+                Worker &w = *workers[i];
+                if (FD_ISSET(w.stream.handle, &readable) && !receive(w, batch, job)) {
+                    drop(i); // its shards go back to the front of the queue
+                    continue;
+                }
+                i++;
+            }
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastReport > std::chrono::seconds(5)) {
+                lastReport = now;
+                std::printf("monte carlo: %u of %u runs, %zu workers\n", done, runs, workers.size());
+            }
+        }
+        batch.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ClusterShard end = {0, 0};
+        for (auto &w : workers) {
+            w->stream.sendAll(&end, sizeof(end));
+            std::printf("monte carlo: worker of %u threads played %llu runs\n", w->threads, (unsigned long long)w->runs);
+        }
+        workers.clear();
+        return true;
+    }
+
+    // Read what has arrived from w and act on every whole message; false if it is gone or misbehaved
+    bool receive(Worker &w, MonteCarlo &batch, const ClusterJob &job) {
+        uint8_t chunk[65536];
+        size_t n = w.stream.receiveSome(chunk, sizeof(chunk));
+        if (n == 0) {
+            return false;
+        }
+        w.inbox.insert(w.inbox.end(), chunk, chunk + n);
+        size_t used = 0;
+        for (;;) {
+            const uint8_t *message = w.inbox.data() + used;
+            size_t available = w.inbox.size() - used;
+            if (!w.greeted) {
+                ClusterHello hello;
+                if (available < sizeof(hello)) {
+                    break;
+                }
+                std::memcpy(&hello, message, sizeof(hello));
+                if (std::memcmp(hello.magic, CLUSTER_MAGIC, 4) != 0 || hello.version != CLUSTER_VERSION ||
+                    !w.stream.sendAll(&job, sizeof(job))) {
+                    return false;
+                }
+                w.greeted = true;
+                w.threads = hello.threads;
+                joined++;
+                used += sizeof(hello);
+                if (!assign(w)) {
+                    return false;
+                }
+                continue;
+            }
+            ClusterShard shard;
+            if (available < sizeof(shard)) {
+                break;
+            }
+            std::memcpy(&shard, message, sizeof(shard));
+            size_t size = sizeof(shard) + (size_t)shard.count * sizeof(uint32_t);
+            if (w.assigned.empty() || shard.first != w.assigned.front().first || shard.count != w.assigned.front().count) {
+                return false; // results come back in the order the shards went out
+            }
+            if (available < size) {
+                break;
+            }
+            const uint8_t *words = message + sizeof(shard);
+            for (uint32_t i = 0; i < shard.count; i++) {
+                uint32_t word;
+                std::memcpy(&word, words + 4 * (size_t)i, sizeof(word));
+                batch.results[shard.first + i] = unpackRun(word);
+            }
+            w.assigned.pop_front();
+            w.runs += shard.count;
+            done += shard.count;
+            used += size;
+            if (!assign(w)) {
+                return false;
+            }
+        }
+        w.inbox.erase(w.inbox.begin(), w.inbox.begin() + used);
+        return true;
+    }
+
+    // Top w's queue up to IN_FLIGHT shards
+    bool assign(Worker &w) {
+        while ((int)w.assigned.size() < IN_FLIGHT && !pending.empty()) {
+            if (!w.stream.sendAll(&pending.front(), sizeof(ClusterShard))) {
+                return false;
+            }
+            w.assigned.push_back(pending.front());
+            pending.pop_front();
+        }
+        return true;
+    }
+
+    void drop(size_t i) {
+        Worker &w = *workers[i];
+        for (auto shard = w.assigned.rbegin(); shard != w.assigned.rend(); ++shard) {
+            pending.push_front(*shard);
+        }
+        w.assigned.clear();
+        workers.erase(workers.begin() + i);
+        for (auto &other : workers) {
+            if (other->greeted) {
+                assign(*other); // a failed send shows up as that worker dropping on its next read
+            }
+        }
+    }
+};
+
+// Connect to a coordinator and play the shards it sends on this machine's job
+// system until it ends the batch; false if it could not be reached or went away
+inline bool runMonteCarloWorker(JobSystem &jobs, const std::string &address) {
+    TcpStream stream;
+    if (!stream.connect(address)) {
+        std::printf("monte carlo: cannot reach coordinator %s\n", address.c_str());
+        return false;
+    }
+    ClusterHello hello = {{CLUSTER_MAGIC[0], CLUSTER_MAGIC[1], CLUSTER_MAGIC[2], CLUSTER_MAGIC[3]},
+                          CLUSTER_VERSION, (uint32_t)jobs.threadCount() + 1};
+    ClusterJob job;
+    if (!stream.sendAll(&hello, sizeof(hello)) || !stream.receiveAll(&job, sizeof(job)) ||
+        std::memcmp(job.magic, CLUSTER_MAGIC, 4) != 0 || job.version != CLUSTER_VERSION) {
+        std::printf("monte carlo: no job from coordinator %s\n", address.c_str());
+        return false;
+    }
+    BotSkill skill;
+    skill.reaction = job.reaction;
+    skill.lookahead = job.lookahead;
+    skill.mistakes = job.mistakes;
+    MonteCarlo batch;
+    std::vector<uint8_t> message;
+    uint64_t played = 0;
+    for (;;) {
+        ClusterShard shard;
+        if (!stream.receiveAll(&shard, sizeof(shard))) {
+            return false;
+        }
+        if (shard.count == 0) {
+            break;
+        }
+        batch.runRange(jobs, job.seed, shard.first, shard.count, job.simRate, job.maxTicks, skill);
+        message.resize(sizeof(shard) + (size_t)shard.count * sizeof(uint32_t));
+        std::memcpy(message.data(), &shard, sizeof(shard));
+        for (uint32_t i = 0; i < shard.count; i++) {
+            uint32_t word = packRun(batch.results[i]);
+            std::memcpy(message.data() + sizeof(shard) + 4 * (size_t)i, &word, sizeof(word));
+        }
+        if (!stream.sendAll(message.data(), message.size())) {
+            return false;
+        }
+        played += shard.count;
+    }
+    std::printf("monte carlo: played %llu runs for %s\n", (unsigned long long)played, address.c_str());
+    return true;
+}
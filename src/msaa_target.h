@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_markers.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "view_transform.h"
+
+// Multisampled colour buffer the scene is drawn into, resolved with one blit into
+// whichever target would otherwise have been drawn to (the window, the dynamic
+// resolution buffer or the benchmark's framebuffer). The sample count is chosen on
+// the command line rather than left to the driver, and the buffer is sized for the
+// full viewport so only a window resize reallocates it.
+struct MsaaTarget {
+    bool enabled = false;
+    int samples = 0;
+    GLuint fbo = 0, color = 0, depth = 0;
+    GLenum colorFormat = GL_RGBA8; // the destination's: a resolving blit cannot convert
+    int width = 0, height = 0; // allocated size
+    GLuint destination = 0;    // framebuffer the resolve writes to
+    glm::vec4 region;          // where in it: xy = origin, zw = size
+
+    // Request a sample count; it is clamped to what the implementation supports
+    void setup(int requested) {
+        GLint maxSamples = 0;
+        glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+        samples = std::min(requested, (int)maxSamples);
+        if (samples < 2) {
+            samples = 0;
+            return;
+        }
+        enabled = true;
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glGenRenderbuffers(1, &depth);
+    }
+
+    void resize(int w, int h) {
+        if (w == width && h == height) {
+            return;
+        }
+        width = w;
+        height = h;
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, colorFormat, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, color, MEM_RENDER_TARGETS, textureBytes(width, height, 4) * samples);
+        glBindRenderbuffer(GL_RENDERBUFFER, depth);
+        glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH_COMPONENT24, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, depth, MEM_RENDER_TARGETS, textureBytes(width, height, 4) * samples);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+        glMarkers.label(GL_FRAMEBUFFER, fbo, "msaa");
+    }
+
+    // Redirect drawing meant for the given region of target into the multisampled buffer
+    void begin(const ViewTransform &view, GLuint target, const glm::vec4 &targetRegion) {
+        if (!enabled) {
+            return;
+        }
+        destination = target;
+        region = targetRegion;
+        resize(view.width, view.height);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.drawInto((int)region.z, (int)region.w);
+    }
+
+    // Average the samples into the destination region and draw there again afterwards
+    void resolve(const ViewTransform &view) {
+        if (!enabled) {
+            return;
+        }
+        int w = (int)region.z, h = (int)region.w;
+        int x = (int)region.x, y = (int)region.y;
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, destination);
+        glBlitFramebuffer(0, 0, w, h, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, destination);
+        view.setViewport(region);
+    }
+
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        memoryStats.untrackGl(GL_RENDERBUFFER, color);
+        memoryStats.untrackGl(GL_RENDERBUFFER, depth);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depth);
+        glState.deleteFramebuffers(1, &fbo);
+        fbo = color = depth = 0;
+        enabled = false;
+    }
+};
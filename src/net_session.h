@@ -0,0 +1,569 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GLFW/glfw3.h>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Non-blocking UDP socket talking to one peer. Windows builds link ws2_32.
+struct UdpSocket {
+#ifdef _WIN32
+    SOCKET handle = INVALID_SOCKET;
+#else
+    int handle = -1;
+#endif
+    sockaddr_in peer{};
+    bool hasPeer = false;
+
+    UdpSocket() = default;
+    UdpSocket(const UdpSocket &) = delete;
+    UdpSocket &operator=(const UdpSocket &) = delete;
+
+    ~UdpSocket() {
+        close();
+    }
+
+    bool isOpen() const {
+#ifdef _WIN32
+        return handle != INVALID_SOCKET;
+#else
+        return handle >= 0;
+#endif
+    }
+
+    // Bind to port on every interface; 0 lets the OS pick one
+    bool open(uint16_t port) {
+        close();
+#ifdef _WIN32
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            return false;
+        }
+        handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        u_long nonBlocking = 1;
+        if (!isOpen() || ioctlsocket(handle, FIONBIO, &nonBlocking) != 0) {
+            close();
+            return false;
+        }
+#else
+        handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (!isOpen() || fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) != 0) {
+            close();
+            return false;
+        }
+#endif
+        sockaddr_in local{};
+        local.sin_family = AF_INET;
+        local.sin_addr.s_addr = htonl(INADDR_ANY);
+        local.sin_port = htons(port);
+        if (bind(handle, (const sockaddr *)&local, sizeof(local)) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    // Resolve "host:port" as the address to send to
+    bool setPeer(const std::string &address) {
+        size_t colon = address.rfind(':');
+        if (colon == std::string::npos) {
+            return false;
+        }
+        std::string host = address.substr(0, colon), port = address.substr(colon + 1);
+        addrinfo hints{};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        addrinfo *found = nullptr;
+        if (getaddrinfo(host.c_str(), port.c_str(), &hints, &found) != 0 || !found) {
+            return false;
+        }
+        std::memcpy(&peer, found->ai_addr, sizeof(peer));
+        freeaddrinfo(found);
+        hasPeer = true;
+        return true;
+    }
+
+    bool send(const uint8_t *data, size_t size) {
+        return hasPeer && sendto(handle, (const char *)data, (int)size, 0, (const sockaddr *)&peer, sizeof(peer)) == (int)size;
+    }
+
+    // One datagram, or 0 when none is waiting; from is where it came from
+    size_t receive(uint8_t *data, size_t capacity, sockaddr_in &from) {
+        socklen_t fromSize = sizeof(from);
+        int n = (int)recvfrom(handle, (char *)data, (int)capacity, 0, (sockaddr *)&from, &fromSize);
+        return n > 0 ? (size_t)n : 0;
+    }
+
+    bool fromPeer(const sockaddr_in &from) const {
+        return hasPeer && from.sin_addr.s_addr == peer.sin_addr.s_addr && from.sin_port == peer.sin_port;
+    }
+
+    void close() {
+        if (!isOpen()) {
+            return;
+        }
+#ifdef _WIN32
+        closesocket(handle);
+        handle = INVALID_SOCKET;
+        WSACleanup();
+#else
+        ::close(handle);
+        handle = -1;
+#endif
+    }
+};
+
+// Two-player race over UDP. Both cabinets run the same deterministic simulation
+// from the same seed, so the only things on the wire are key presses, each tagged
+// with the tick that applied it, and a periodic hash of the state to catch a
+// desync. Every packet carries all presses the peer has not acknowledged yet, so
+// a lost packet costs nothing once the next one arrives, and a peer that has not
+// pressed anything sends a few bytes SEND_INTERVAL apart: a few hundred bytes per
+// second each way. The caller predicts the rival from the presses it has and rolls
+// back to the earliest one that arrives late (see poll). Packets, little-endian:
+//
+//   "ST" u8 type, then
+//   HELLO    u16 protocol  u8 lanes  u32 simRate*1000  u32 settings
+//   WELCOME  u16 protocol  u8 lanes  u32 simRate*1000  u32 settings  u64 seed
+//   READY
+//   STATE    varint through  varint ack  varint end  varint hashTick  u32 hash
+//            varint count, per press: varint ticks since the previous one (the
+//            first: ticks before through), u8 key (0 LEFT, 1 RIGHT)
+//
+// through: the sender has simulated every tick before it, so the receiver has all
+// its presses before through. ack: the same for the other direction. end: 1 + the
+// tick the sender's game ended on, 0 while it is racing. hashTick: the tick of the
+// latest state hash, 0 for none. settings: the GameSettings fingerprint; a rival
+// whose build or settings differ is refused, with refusal saying why.
+struct NetSession {
+    static const uint16_t PROTOCOL = 2;
+    static const uint64_t HASH_INTERVAL = 60; // ticks between state hashes
+    static constexpr double SEND_INTERVAL = 0.1; // seconds between packets when nothing was pressed
+    static constexpr double TIMEOUT = 5.0; // seconds of silence before the peer counts as gone
+    static constexpr size_t MAX_PACKET = 512;
+    static constexpr size_t MAX_EVENTS = 64; // unacknowledged presses sent per packet
+
+    enum PacketType : uint8_t { PACKET_HELLO = 1, PACKET_WELCOME, PACKET_READY, PACKET_STATE };
+
+    struct Event {
+        uint64_t tick;
+        int key;
+    };
+
+    bool active = false, hosting = false, connected = false;
+    UdpSocket socket;
+    int lanes = 0;
+    uint32_t settings = 0;
+    uint64_t seed = 0;
+    float simRate = 0.0f;
+    std::string refusal; // why the handshake turned the rival away, if it did
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    // Local side
+    std::vector<Event> outbox; // presses the peer has not acknowledged, in tick order
+    uint64_t localThrough = 0; // ticks simulated here
+    uint64_t peerAck = 0;      // the peer has every local press before this tick
+    uint64_t localHashTick = 0;
+    uint32_t localHash = 0;
+    uint64_t localEnd = 0; // 1 + the tick the local game ended on
+    bool dirty = false;    // a press has not been sent yet
+    double lastSend = -1.0;
+
+    // Remote side
+    std::vector<Event> inbox;   // every press of the rival, in tick order
+    uint64_t remoteThrough = 0; // every rival press before this tick has arrived
+    uint64_t remoteHashTick = 0;
+    uint32_t remoteHash = 0;
+    uint64_t remoteEnd = 0;
+    double lastReceive = 0.0;
+
+    // Statistics
+    uint64_t bytesSent = 0, bytesReceived = 0, packetsSent = 0, packetsReceived = 0;
+    uint64_t desyncs = 0;
+    uint64_t rollbacks = 0, rolledBackTicks = 0; // kept by the caller, which does the rolling back
+
+    double now() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Wait on port for a rival to connect
+    bool host(uint16_t port) {
+        hosting = true;
+        reserve();
+        return socket.open(port);
+    }
+
+    // Join a race hosted at "host:port"
+    bool connect(const std::string &address) {
+        hosting = false;
+        reserve();
+        return socket.open(0) && socket.setPeer(address);
+    }
+
+    // Room for a long race's presses before the first tick
+    void reserve() {
+        outbox.reserve(MAX_EVENTS * 4);
+        inbox.reserve(16384);
+    }
+
+    // Agree on everything that shapes the simulation: the host's seed and tick rate
+    // win, and both builds must have the same lane count and settings fingerprint.
+    // Blocks up to timeout seconds, or until the rival is refused.
+    bool handshake(uint64_t &sessionSeed, float &sessionRate, int laneCount, uint32_t settingsFingerprint, double timeout) {
+        lanes = laneCount;
+        settings = settingsFingerprint;
+        seed = sessionSeed;
+        simRate = sessionRate;
+        double deadline = now() + timeout, nextHello = 0.0;
+        while (now() < deadline && refusal.empty()) {
+            if (!hosting && now() >= nextHello) {
+                uint8_t packet[16];
+                size_t size = writeHeader(packet, PACKET_HELLO);
+                size = writeSettings(packet, size);
+                sendPacket(packet, size);
+                nextHello = now() + SEND_INTERVAL * 2;
+            }
+            receiveAll();
+            if (connected) {
+                sessionSeed = seed;
+                sessionRate = simRate;
+                active = true;
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+
+    // Block until the rival has loaded too, so both start racing together
+    bool waitReady(double timeout) {
+        double deadline = now() + timeout, nextReady = 0.0;
+        uint8_t ready[3];
+        writeHeader(ready, PACKET_READY);
+        peerReady = false;
+        while (now() < deadline) {
+            if (now() >= nextReady) {
+                sendPacket(ready, sizeof(ready));
+                nextReady = now() + SEND_INTERVAL;
+            }
+            receiveAll();
+            if (peerReady) {
+                for (int i = 0; i < 3; i++) {
+                    sendPacket(ready, sizeof(ready)); // the rival may still be waiting on ours
+                }
+                lastReceive = now();
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+        return false;
+    }
+
+    // A local press, applied on tick
+    void pressed(uint64_t tick, int key) {
+        outbox.push_back({tick, key});
+        dirty = true;
+    }
+
+    // Every local tick before through has been simulated; sends when a press is
+    // waiting or the keepalive is due
+    void ticked(uint64_t through) {
+        localThrough = through;
+        double t = now();
+        if (dirty || t - lastSend >= SEND_INTERVAL) {
+            sendState();
+            lastSend = t;
+            dirty = false;
+        }
+    }
+
+    // Hash of the local state after tick ticks
+    void hashed(uint64_t tick, uint32_t hash) {
+        localHashTick = tick;
+        localHash = hash;
+    }
+
+    // The local game ended on tick; told several times since nothing follows it
+    void finished(uint64_t tick) {
+        localEnd = tick + 1;
+        for (int i = 0; i < 3; i++) {
+            sendState();
+        }
+    }
+
+    // Take in whatever has arrived. Returns the earliest tick of a rival press that
+    // was not known before, or UINT64_MAX if there is none: anything simulated from
+    // that tick on used a wrong prediction.
+    uint64_t poll() {
+        earliestNew = UINT64_MAX;
+        receiveAll();
+        return earliestNew;
+    }
+
+    // The rival has not been heard from for TIMEOUT seconds
+    bool timedOut() const {
+        return now() - lastReceive > TIMEOUT;
+    }
+
+    // Wait up to timeout seconds to learn how the rival's race compares with one
+    // that ended on tick: until it ends too or is known to have outlasted it
+    void settle(uint64_t tick, double timeout) {
+        double deadline = now() + timeout;
+        while (!remoteEnd && remoteThrough <= tick && now() < deadline && !timedOut()) {
+            receiveAll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+
+    // FNV-1a, for the state hashes
+    static uint32_t hashBytes(uint32_t hash, const void *data, size_t size) {
+        const uint8_t *bytes = (const uint8_t *)data;
+        for (size_t i = 0; i < size; i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    static const uint32_t HASH_SEED = 2166136261u;
+
+    void print() const {
+        double seconds = std::max(now(), 1e-3);
+        std::printf("net: %llu packets / %llu bytes sent (%.0f B/s), %llu / %llu received, %llu rollbacks of %.1f ticks, "
+                    "%llu desyncs\n",
+                    (unsigned long long)packetsSent, (unsigned long long)bytesSent, bytesSent / seconds,
+                    (unsigned long long)packetsReceived, (unsigned long long)bytesReceived, (unsigned long long)rollbacks,
+                    rollbacks ? (double)rolledBackTicks / rollbacks : 0.0, (unsigned long long)desyncs);
+    }
+
+    // Internals
+    bool peerReady = false;
+    uint64_t earliestNew = UINT64_MAX;
+
+    static size_t writeHeader(uint8_t *packet, PacketType type) {
+        packet[0] = 'S';
+        packet[1] = 'T';
+        packet[2] = type;
+        return 3;
+    }
+
+    size_t writeSettings(uint8_t *packet, size_t size) const {
+        size = putFixed(packet, size, PROTOCOL, 2);
+        size = putFixed(packet, size, (uint64_t)lanes, 1);
+        size = putFixed(packet, size, (uint64_t)(simRate * 1000.0f + 0.5f), 4);
+        return putFixed(packet, size, settings, 4);
+    }
+
+    // Read the peer's writeSettings; false if it is truncated or differs from ours,
+    // setting refusal in the latter case
+    bool readSettings(const uint8_t *packet, size_t size, size_t &at, uint64_t &rate) {
+        uint64_t protocol = 0, laneCount = 0, fingerprint = 0;
+        if (!getFixed(packet, size, at, protocol, 2)) {
+            return false;
+        }
+        if (protocol != PROTOCOL) {
+            refusal = "the rival runs protocol " + std::to_string(protocol) + ", this build " + std::to_string(PROTOCOL);
+            return false;
+        }
+        if (!getFixed(packet, size, at, laneCount, 1) || !getFixed(packet, size, at, rate, 4) ||
+            !getFixed(packet, size, at, fingerprint, 4)) {
+            return false;
+        }
+        if ((int)laneCount != lanes) {
+            refusal = "the rival has " + std::to_string(laneCount) + " lanes, this build " + std::to_string(lanes);
+        } else if (fingerprint != settings) {
+            refusal = "the rival's settings file differs from this one";
+        }
+        return refusal.empty();
+    }
+
+    void sendPacket(const uint8_t *data, size_t size) {
+        if (socket.send(data, size)) {
+            packetsSent++;
+            bytesSent += size;
+        }
+    }
+
+    void sendState() {
+        // With more presses waiting than fit, claim only the ticks before the first one
+        // left out, so the peer keeps waiting for the rest: they go once these are acked
+        size_t count = std::min(outbox.size(), MAX_EVENTS);
+        while (count > 0 && count < outbox.size() && outbox[count - 1].tick == outbox[count].tick) {
+            count--;
+        }
+        uint64_t through = count < outbox.size() ? outbox[count].tick : localThrough;
+        uint8_t packet[MAX_PACKET];
+        size_t size = writeHeader(packet, PACKET_STATE);
+        size = putVarint(packet, size, through);
+        size = putVarint(packet, size, remoteThrough);
+        size = putVarint(packet, size, localEnd);
+        size = putVarint(packet, size, localHashTick);
+        size = putFixed(packet, size, localHash, 4);
+        size = putVarint(packet, size, count);
+        uint64_t previous = through;
+        for (size_t i = 0; i < count; i++) {
+            size = putVarint(packet, size, i == 0 ? previous - outbox[i].tick : outbox[i].tick - previous);
+            packet[size++] = outbox[i].key == GLFW_KEY_RIGHT ? 1 : 0;
+            previous = outbox[i].tick;
+        }
+        sendPacket(packet, size);
+    }
+
+    void receiveAll() {
+        uint8_t packet[MAX_PACKET];
+        sockaddr_in from{};
+        size_t size;
+        while ((size = socket.receive(packet, sizeof(packet), from)) > 0) {
+            if (size < 3 || packet[0] != 'S' || packet[1] != 'T') {
+                continue;
+            }
+            if (hosting && !socket.hasPeer && packet[2] == PACKET_HELLO) {
+                socket.peer = from; // the first rival to say hello gets the race
+                socket.hasPeer = true;
+            }
+            if (!socket.fromPeer(from)) {
+                continue;
+            }
+            packetsReceived++;
+            bytesReceived += size;
+            lastReceive = now();
+            handle(packet, size);
+        }
+    }
+
+    void handle(const uint8_t *packet, size_t size) {
+        size_t at = 3;
+        uint64_t rate = 0;
+        switch (packet[2]) {
+        case PACKET_HELLO:
+            if (hosting && (connected || readSettings(packet, size, at, rate) || !refusal.empty())) {
+                uint8_t reply[32];
+                size_t n = writeHeader(reply, PACKET_WELCOME);
+                n = writeSettings(reply, n);
+                n = putFixed(reply, n, seed, 8);
+                // Answered every time: a lost WELCOME brings another HELLO, and a refused
+                // rival finds the mismatch in ours
+                sendPacket(reply, n);
+                connected = refusal.empty();
+            }
+            break;
+        case PACKET_WELCOME:
+            if (!hosting && readSettings(packet, size, at, rate) && getFixed(packet, size, at, seed, 8)) {
+                simRate = rate / 1000.0f;
+                connected = true;
+            }
+            break;
+        case PACKET_READY:
+            peerReady = true;
+            break;
+        case PACKET_STATE:
+            peerReady = true; // it started racing already
+            handleState(packet, size, at);
+            break;
+        }
+    }
+
+    void handleState(const uint8_t *packet, size_t size, size_t at) {
+        uint64_t through, ack, end, hashTick, hash, count;
+        if (!getVarint(packet, size, at, through) || !getVarint(packet, size, at, ack) || !getVarint(packet, size, at, end) ||
+            !getVarint(packet, size, at, hashTick) || !getFixed(packet, size, at, hash, 4) ||
+            !getVarint(packet, size, at, count) || count > MAX_EVENTS) {
+            return;
+        }
+        Event events[MAX_EVENTS];
+        uint64_t tick = through;
+        for (uint64_t i = 0; i < count; i++) {
+            uint64_t delta;
+            if (!getVarint(packet, size, at, delta) || at >= size || packet[at] > 1 || (i == 0 && delta > through)) {
+                return; // truncated or corrupt: use none of it
+            }
+            tick = i == 0 ? tick - delta : tick + delta;
+            events[i] = {tick, packet[at++] == 1 ? GLFW_KEY_RIGHT : GLFW_KEY_LEFT};
+        }
+
+        // Acknowledged presses are never sent again
+        if (ack > peerAck) {
+            peerAck = ack;
+            outbox.erase(outbox.begin(), std::find_if(outbox.begin(), outbox.end(), [&](const Event &e) { return e.tick >= ack; }));
+        }
+        // Presses before remoteThrough arrived with an earlier packet; a reordered
+        // older packet has nothing new at all
+        if (through > remoteThrough) {
+            for (uint64_t i = 0; i < count; i++) {
+                if (events[i].tick >= remoteThrough) {
+                    inbox.push_back(events[i]);
+                    earliestNew = std::min(earliestNew, events[i].tick);
+                }
+            }
+            remoteThrough = through;
+        }
+        if (hashTick > remoteHashTick) {
+            remoteHashTick = hashTick;
+            remoteHash = (uint32_t)hash;
+        }
+        if (end && !remoteEnd) {
+            remoteEnd = end;
+        }
+    }
+
+    static size_t putFixed(uint8_t *packet, size_t size, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            packet[size++] = (uint8_t)(value >> (8 * i));
+        }
+        return size;
+    }
+
+    static bool getFixed(const uint8_t *packet, size_t size, size_t &at, uint64_t &value, int bytes) {
+        if (at + bytes > size) {
+            return false;
+        }
+        value = 0;
+        for (int i = 0; i < bytes; i++) {
+            value |= (uint64_t)packet[at++] << (8 * i);
+        }
+        return true;
+    }
+
+    // LEB128, as in ReplayFile
+    static size_t putVarint(uint8_t *packet, size_t size, uint64_t value) {
+        while (value >= 0x80) {
+            packet[size++] = (uint8_t)((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        packet[size++] = (uint8_t)value;
+        return size;
+    }
+
+    static bool getVarint(const uint8_t *packet, size_t size, size_t &at, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && at < size; shift += 7) {
+            uint8_t c = packet[at++];
+            value |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
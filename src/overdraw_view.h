@@ -0,0 +1,217 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "shader_program.h"
+#include "view_transform.h"
+
+// Debug view of fill: how many times each pixel of the scene is drawn, so the
+// hot spots tight-fit meshes, depth layering and impostors are meant to cut show
+// up. The scene is drawn into a buffer of its own with a stencil attachment, and
+// every fragment that survives its discard and depth test adds one to the pixel's
+// stencil (saturating at 255), whatever program and blend drew it: an integer
+// target counting without a single shader changed. The resolve draws the ramp over
+// the scene's colour, one fullscreen triangle per level with the stencil
+// test keeping the pixels covered exactly that often (the last level: at least
+// that often), then blits the result to where the scene would have gone. The
+// counts are also read back through pixel-pack buffers, a frame or two late, for
+// the overlay's average and maximum. It takes the place of MSAA and bloom, whose
+// extra passes are not scene fill.
+struct OverdrawView {
+    static const int LEVELS = 9; // ramp entries: none, then 1 to 7 times, then 8 or more
+    static const int SLOTS = 2;  // readbacks in flight
+
+    struct Slot {
+        GLuint pbo = 0;
+        GLsync fence = nullptr;
+        GLsizeiptr size = 0;
+        int width = 0, height = 0;
+    };
+
+    bool enabled = false;
+    GLuint fbo = 0, color = 0, depthStencil = 0;
+    GLuint vertexArray = 0; // the fullscreen triangle needs no attributes
+    ShaderProgram ramp;
+    int tint = -1;
+    int width = 0, height = 0; // allocated size
+    GLuint destination = 0;    // framebuffer the resolve writes to
+    glm::vec4 region;          // where in it: xy = origin, zw = size
+    Slot slots[SLOTS];
+    int nextSlot = 0;
+    double average = 0.0; // draws per pixel of the region, latest readback
+    int maximum = 0;
+
+    // rampProgram runs overdraw.frag.glsl over the fullscreen triangle
+    void setup(const ShaderProgram &rampProgram) {
+        enabled = true;
+        ramp = rampProgram;
+        tint = ramp.find("tint");
+        vertexArray = createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, vertexArray, MEM_BUFFERS, 0);
+        glGenFramebuffers(1, &fbo);
+        glGenRenderbuffers(1, &color);
+        glGenRenderbuffers(1, &depthStencil);
+        for (Slot &s : slots) {
+            glGenBuffers(1, &s.pbo);
+        }
+    }
+
+    void resize(int w, int h) {
+        if (w == width && h == height) {
+            return;
+        }
+        width = w;
+        height = h;
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, color, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+        memoryStats.trackGl(GL_RENDERBUFFER, depthStencil, MEM_RENDER_TARGETS, textureBytes(width, height, 4));
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+        glMarkers.label(GL_FRAMEBUFFER, fbo, "overdraw");
+    }
+
+    // Redirect drawing meant for the given region of target into the counting buffer,
+    // its counts cleared; every draw until resolve() counts
+    void begin(const ViewTransform &view, GLuint target, const glm::vec4 &targetRegion) {
+        if (!enabled) {
+            return;
+        }
+        destination = target;
+        region = targetRegion;
+        resize(view.width, view.height);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.drawInto((int)region.z, (int)region.w);
+        glClearStencil(0);
+        glClear(GL_STENCIL_BUFFER_BIT);
+        glState.enable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+    }
+
+    // Colour the counts into the destination region, read them back for the
+    // averages, and draw there again afterwards
+    void resolve(const ViewTransform &view) {
+        if (!enabled) {
+            return;
+        }
+        static const glm::vec4 RAMP[LEVELS] = {
+            {0.0f, 0.0f, 0.0f, 1.0f}, {0.05f, 0.1f, 0.45f, 1.0f}, {0.1f, 0.35f, 0.9f, 1.0f},
+            {0.0f, 0.75f, 0.85f, 1.0f}, {0.2f, 0.8f, 0.25f, 1.0f}, {0.95f, 0.9f, 0.15f, 1.0f},
+            {1.0f, 0.55f, 0.05f, 1.0f}, {0.9f, 0.1f, 0.05f, 1.0f}, {1.0f, 1.0f, 1.0f, 1.0f}};
+        int w = (int)region.z, h = (int)region.w;
+        collect();
+        readBack(w, h);
+
+        glState.bindFramebuffer(GL_FRAMEBUFFER, fbo);
+        view.drawInto(w, h);
+        glState.disable(GL_SCISSOR_TEST);
+        glState.disable(GL_DEPTH_TEST);
+        glState.disable(GL_BLEND);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        ramp.use();
+        glState.bindVertexArray(vertexArray);
+        for (int level = 0; level < LEVELS; level++) {
+            glStencilFunc(level == LEVELS - 1 ? GL_LEQUAL : GL_EQUAL, level, 0xFF); // the last: level <= count
+            ramp.set(tint, RAMP[level]);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glState.disable(GL_STENCIL_TEST);
+
+        int x = (int)region.x, y = (int)region.y;
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glState.bindFramebuffer(GL_DRAW_FRAMEBUFFER, destination);
+        glBlitFramebuffer(0, 0, w, h, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glState.bindFramebuffer(GL_FRAMEBUFFER, destination);
+        view.setViewport(region);
+    }
+
+    // Start reading this frame's counts into a free pixel-pack buffer, if there is one
+    void readBack(int w, int h) {
+        Slot &s = slots[nextSlot];
+        if (s.fence) {
+            return; // both still on their way back
+        }
+        nextSlot = (nextSlot + 1) % SLOTS;
+        s.width = w;
+        s.height = h;
+        GLsizeiptr bytes = (GLsizeiptr)stride(w) * h;
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        if (bytes > s.size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, bytes, nullptr, GL_STREAM_READ);
+            memoryStats.trackGl(GL_BUFFER, s.pbo, MEM_BUFFERS, bytes);
+            s.size = bytes;
+        }
+        glState.bindFramebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glReadPixels(0, 0, w, h, GL_STENCIL_INDEX, GL_UNSIGNED_BYTE, nullptr);
+        glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Average and maximum of every readback that has arrived, without waiting
+    void collect() {
+        for (Slot &s : slots) {
+            if (!s.fence || glClientWaitSync(s.fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                continue;
+            }
+            glDeleteSync(s.fence);
+            s.fence = nullptr;
+            size_t rowBytes = stride(s.width);
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+            const uint8_t *counts = (const uint8_t *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)rowBytes * s.height,
+                                                                      GL_MAP_READ_BIT);
+            if (counts) {
+                uint64_t sum = 0;
+                uint8_t most = 0;
+                for (int y = 0; y < s.height; y++) {
+                    const uint8_t *row = counts + y * rowBytes;
+                    for (int x = 0; x < s.width; x++) {
+                        sum += row[x];
+                        most = std::max(most, row[x]);
+                    }
+                }
+                average = s.width * s.height > 0 ? (double)sum / ((double)s.width * s.height) : 0.0;
+                maximum = most;
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glState.bindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        }
+    }
+
+    // Bytes per row of a readback, at GL's default pack alignment of 4
+    static size_t stride(int w) {
+        return ((size_t)w + 3) & ~(size_t)3;
+    }
+
+    void release() {
+        if (!enabled) {
+            return;
+        }
+        for (Slot &s : slots) {
+            if (s.fence) {
+                glDeleteSync(s.fence);
+            }
+            memoryStats.untrackGl(GL_BUFFER, s.pbo);
+            glState.deleteBuffers(1, &s.pbo);
+            s = Slot();
+        }
+        memoryStats.untrackGl(GL_RENDERBUFFER, color);
+        memoryStats.untrackGl(GL_RENDERBUFFER, depthStencil);
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, vertexArray);
+        glDeleteRenderbuffers(1, &color);
+        glDeleteRenderbuffers(1, &depthStencil);
+        glState.deleteVertexArrays(1, &vertexArray);
+        glState.deleteFramebuffers(1, &fbo);
+        fbo = color = depthStencil = vertexArray = 0;
+        enabled = false;
+    }
+};
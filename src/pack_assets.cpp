@@ -0,0 +1,64 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "asset_pack.h"
+
+using namespace std;
+
+// Build step that gathers files into one asset pack, read back through asset_pack.h.
+// Typical use, from src/:
+//   bake_textures ../textures && pack_assets --compress ../textures/assets.pak ../textures/atlas.stex ../textures/*.png
+// Each file is looked up by its file name. With --compress an entry is stored
+// compressed when that saves at least an eighth of it, as a raw RGBA8 bake usually
+// does; it then costs the game one inflate into memory of its own instead of a
+// read in place.
+int main(int argc, char **argv) {
+    bool compress = argc > 1 && string(argv[1]) == "--compress";
+    int first = compress ? 2 : 1;
+    if (argc < first + 2) {
+        cout << "Usage: pack_assets [--compress] <output.pak> <file>..." << endl;
+        return 1;
+    }
+
+    vector<PackFile> files;
+    uint64_t original = 0, stored = 0;
+    for (int i = first + 1; i < argc; i++) {
+        ifstream in(argv[i], ios::binary);
+        if (!in) {
+            cout << "Cannot read " << argv[i] << endl;
+            return 1;
+        }
+        PackFile file;
+        string path = argv[i];
+        file.name = path.substr(path.find_last_of("/\\") + 1);
+        if (file.name.size() >= sizeof(PackEntry::name)) {
+            cout << "File name too long for the pack: " << file.name << endl;
+            return 1;
+        }
+        file.bytes.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        file.size = file.bytes.size();
+        if (compress && !file.bytes.empty()) {
+            vector<unsigned char> packed = compressLz(file.bytes.data(), file.bytes.size());
+            if (packed.size() <= file.bytes.size() - file.bytes.size() / 8) {
+                file.bytes = move(packed);
+                file.compression = PACK_LZ;
+            }
+        }
+        cout << "Packed " << file.name << " (" << file.size << " bytes"
+             << (file.compression == PACK_LZ ? ", compressed to " + to_string(file.bytes.size()) : string()) << ")"
+             << endl;
+        original += file.size;
+        stored += file.bytes.size();
+        files.push_back(move(file));
+    }
+
+    if (!writeAssetPack(argv[first], files)) {
+        cout << "Cannot write " << argv[first] << endl;
+        return 1;
+    }
+    cout << "Wrote " << argv[first] << ": " << files.size() << " files, " << stored << " of " << original << " bytes"
+         << endl;
+    return 0;
+}
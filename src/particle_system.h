@@ -0,0 +1,153 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "geometry_cache.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+
+// One particle as stored on the GPU
+struct Particle {
+    glm::vec4 state; // xy = position, zw = velocity
+    glm::vec4 life;  // x = age, y = lifetime (dead once age >= lifetime), z = kind, w = random in [0, 1)
+};
+
+// GPU particle system. Particles live in two buffers that a vertex-only program
+// ping-pongs between with transform feedback, so they are never read back or
+// touched per particle on the CPU. Emitting only records a burst (a slot range of
+// the ring plus its origin); the update shader respawns those slots itself, so a
+// burst of any size costs one table entry and no allocation. Every kind, glowing or
+// cut from a sprite, is drawn by one instanced call over the shared sprite quad.
+struct ParticleSystem {
+    static const int MAX_BURSTS = 32; // bursts per update; must match the update shader
+    static const GLuint STATE_ATTRIB = 2, LIFE_ATTRIB = 3; // per-instance attributes when drawing
+    static constexpr const GLchar *UPDATE_VARYINGS[2] = {"outState", "outLife"}; // captured interleaved, in Particle order
+
+    GLuint buffers[2] = {};
+    GLuint updateVAO[2] = {}, drawVAO[2] = {};
+    int source = 0; // buffer holding the current particles
+    GLuint updateProgram = 0;
+    GLint dtLocation = -1, seedLocation = -1, capacityLocation = -1;
+    GLint burstCountLocation = -1, burstRangeLocation = -1, burstSourceLocation = -1;
+    GLsizei vertexCount = 0;
+    uint32_t capacity = 0;
+    uint32_t cursor = 0; // next ring slot handed to a burst
+    int frame = 0;
+
+    // Bursts queued for the next update: (first slot, count, kind, 0) and (origin xy, speed, lifetime)
+    int burstCount = 0;
+    GLint burstRange[MAX_BURSTS * 4];
+    GLfloat burstSource[MAX_BURSTS * 4];
+
+    // Take ownership of the linked update program (built with UPDATE_VARYINGS captured)
+    // and create both particle buffers, all particles dead
+    void setup(const Mesh &quad, uint32_t particles, GLuint program) {
+        capacity = particles;
+        vertexCount = quad.vertexCount;
+        updateProgram = program;
+        dtLocation = glGetUniformLocation(updateProgram, "dt");
+        seedLocation = glGetUniformLocation(updateProgram, "seed");
+        capacityLocation = glGetUniformLocation(updateProgram, "capacity");
+        burstCountLocation = glGetUniformLocation(updateProgram, "burstCount");
+        burstRangeLocation = glGetUniformLocation(updateProgram, "burstRange");
+        burstSourceLocation = glGetUniformLocation(updateProgram, "burstSource");
+
+        std::vector<Particle> dead(capacity, Particle{glm::vec4(0.0f), glm::vec4(1.0f, 0.0f, 0.0f, 0.0f)});
+        for (int i = 0; i < 2; i++) {
+            buffers[i] = createBuffer(GL_ARRAY_BUFFER, capacity * sizeof(Particle), dead.data(), GL_DYNAMIC_COPY);
+            updateVAO[i] = createVertexArray();
+            drawVAO[i] = createVertexArray();
+            memoryStats.trackGl(GL_BUFFER, buffers[i], MEM_BUFFERS, capacity * sizeof(Particle));
+            glMarkers.label(GL_BUFFER, buffers[i], i == 0 ? "particles 0" : "particles 1");
+            memoryStats.trackGl(GL_VERTEX_ARRAY, updateVAO[i], MEM_BUFFERS, 0);
+            memoryStats.trackGl(GL_VERTEX_ARRAY, drawVAO[i], MEM_BUFFERS, 0);
+
+            // Update: one point per particle, read from attributes 0 and 1
+            pointParticleAttribs(updateVAO[i], buffers[i], 0, 1, 0);
+
+            // Draw: the shared quad, instanced once per particle
+            quad.bindAttribs(drawVAO[i]);
+            pointParticleAttribs(drawVAO[i], buffers[i], STATE_ATTRIB, LIFE_ATTRIB, 1);
+        }
+    }
+
+    // Queue count particles from (x, y) flying out at up to speed pixels per second.
+    // Returns false if this update's burst table is already full.
+    bool emit(float x, float y, uint32_t count, float speed, float lifetime, int kind) {
+        if (burstCount == MAX_BURSTS) {
+            return false;
+        }
+        if (count == 0) {
+            return true;
+        }
+        count = count < capacity ? count : capacity;
+        GLint *range = &burstRange[burstCount * 4];
+        GLfloat *src = &burstSource[burstCount * 4];
+        range[0] = (GLint)cursor; range[1] = (GLint)count; range[2] = kind; range[3] = 0;
+        src[0] = x; src[1] = y; src[2] = speed; src[3] = lifetime;
+        cursor = (cursor + count) % capacity;
+        burstCount++;
+        return true;
+    }
+
+    // Advance every particle by dt seconds on the GPU and swap buffers
+    void update(float dt) {
+        int target = 1 - source;
+        glState.useProgram(updateProgram);
+        glUniform1f(dtLocation, dt);
+        glUniform1i(seedLocation, frame++);
+        glUniform1i(capacityLocation, (GLint)capacity);
+        glUniform1i(burstCountLocation, burstCount);
+        if (burstCount > 0) {
+            glUniform4iv(burstRangeLocation, burstCount, burstRange);
+            glUniform4fv(burstSourceLocation, burstCount, burstSource);
+        }
+        burstCount = 0;
+
+        glState.enable(GL_RASTERIZER_DISCARD);
+        glState.bindVertexArray(updateVAO[source]);
+        glState.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, buffers[target]);
+        glBeginTransformFeedback(GL_POINTS);
+        glDrawArrays(GL_POINTS, 0, (GLsizei)capacity);
+        glEndTransformFeedback();
+        glState.bindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0); // the next draw reads it as vertices
+        glState.disable(GL_RASTERIZER_DISCARD);
+        source = target;
+    }
+
+    // Draw every particle; the draw program must be in use. Glowing kinds write zero
+    // alpha, so the premultiplied blend adds their colour; textured kinds sample texID
+    // and blend over like sprites.
+    void draw(GLuint texID, GLuint sampler) {
+        glState.enable(GL_BLEND);
+        glState.bindTexture(0, texID);
+        glState.bindSampler(0, sampler);
+        glState.bindVertexArray(drawVAO[source]);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, vertexCount, (GLsizei)capacity);
+        glState.disable(GL_BLEND);
+    }
+
+    // Delete the system's GL objects; must run while the context is still current
+    void release() {
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, 2, updateVAO);
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, 2, drawVAO);
+        memoryStats.untrackGl(GL_BUFFER, 2, buffers);
+        glState.deleteVertexArrays(2, updateVAO);
+        glState.deleteVertexArrays(2, drawVAO);
+        glState.deleteBuffers(2, buffers);
+        glDeleteProgram(updateProgram);
+        updateProgram = 0;
+    }
+
+    // Point two attributes of a vertex array at the interleaved particle fields of a buffer
+    static void pointParticleAttribs(GLuint array, GLuint buffer, GLuint stateAttrib, GLuint lifeAttrib, GLuint divisor) {
+        vertexAttrib(array, stateAttrib, 4, buffer, sizeof(Particle), offsetof(Particle, state), divisor);
+        vertexAttrib(array, lifeAttrib, 4, buffer, sizeof(Particle), offsetof(Particle, life), divisor);
+    }
+};
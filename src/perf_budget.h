@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Limits a benchmark run must stay within. Text format, one limit per line, '#'
+// starts a comment:
+//
+//   <metric> <milliseconds>    metric: mean, p50, p90, p99, p99.9 or max
+//   allocs <count>             heap allocations in the frames after warm-up
+struct PerfBudget {
+    struct Limit {
+        std::string metric;
+        double ms;
+    };
+
+    std::vector<Limit> limits;
+
+    bool load(const std::string &path) {
+        limits.clear();
+        FILE *in = std::fopen(path.c_str(), "r");
+        if (!in) {
+            return false;
+        }
+        char line[128];
+        bool ok = true;
+        while (ok && std::fgets(line, sizeof(line), in)) {
+            if (line[0] == '#' || line[strspn(line, " \t\r\n")] == '\0') {
+                continue;
+            }
+            char metric[16];
+            double ms;
+            ok = std::sscanf(line, "%15s %lf", metric, &ms) == 2;
+            if (ok) {
+                limits.push_back({metric, ms});
+            }
+        }
+        std::fclose(in);
+        return ok && !limits.empty();
+    }
+
+    // Compare measured values against every limit, printing each; false on any regression.
+    // value(metric, ms) must look a metric up and return false if it is unknown.
+    template <typename Lookup>
+    bool check(const Lookup &value) const {
+        bool pass = true;
+        for (const Limit &l : limits) {
+            double ms;
+            if (!value(l.metric, ms)) {
+                std::printf("budget %-6s unknown metric\n", l.metric.c_str());
+                pass = false;
+                continue;
+            }
+            bool ok = ms <= l.ms;
+            const char *unit = l.metric == "allocs" ? "   " : " ms";
+            std::printf("budget %-6s %8.3f%s <= %8.3f%s  %s\n", l.metric.c_str(), ms, unit, l.ms, unit, ok ? "ok" : "REGRESSION");
+            pass &= ok;
+        }
+        return pass;
+    }
+};
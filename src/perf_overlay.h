@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "draw_list.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "shader_program.h"
+#include "shard_counters.h"
+#include "sprite_batch.h"
+
+// Numbers shown by the overlay, gathered by the game once per frame
+struct OverlayStats {
+    double cpuMs = 0.0, gpuMs = -1.0; // latest resolved frame; gpu -1 if not measured
+    double budgetMs = 1000.0 / 60.0;
+    int drawCalls = 0;                // scene draws of the last frame, without the overlay's own
+    bool glCounted = false;           // GL call trace build
+    uint64_t glCalls = 0, glRedundant = 0;
+    uint64_t stateIssued = 0, stateSkipped = 0; // state changes glState made and skipped as already current
+    uint32_t entities = 0;
+    uint32_t culled = 0;              // entities left out of the draw list as off-screen
+    bool glPerfLogged = false;        // driver performance warnings are collected (gl_debug_log.h)
+    uint32_t glPerfWarnings = 0;      // in the last frame
+    uint64_t glPerfTotal = 0;
+    const char *glPerfZone = "", *glPerfLast = ""; // where the latest one was raised, and its start
+    bool overdrawShown = false;       // the overdraw view is on (overdraw_view.h)
+    double overdrawAverage = 0.0;     // scene draws per pixel
+    int overdrawMax = 0;
+};
+
+// Toggleable performance readout: FPS, frame times, a frame-time graph, draw and GL
+// call counts, entity count, spawns and lane changes, memory and, when collected, driver performance warnings
+// and overdraw. Text comes from a built-in 5x8 bitmap font
+// baked at setup into one small texture that also holds the solid colours used by
+// the panel and the graph, so the whole overlay is one list of sprite instances
+// with a single state and SpriteBatch draws it in one call.
+struct PerfOverlay {
+    static const int TEX_WIDTH = 128, TEX_HEIGHT = 64;
+    static const int CELL = 8;              // texels per font cell side
+    static const int GLYPH_WIDTH = 6;       // 5 columns plus spacing
+    static const int SCALE = 2;             // screen pixels per texel
+    static const int HISTORY = 120;         // frames in the graph
+    static const int MAX_QUADS = 512;       // glyphs + panel + graph bars
+    static const char FIRST_GLYPH = ' ', LAST_GLYPH = '_';
+    static const int SWATCH_CELL = 64;      // first cell after the glyphs
+
+    // Solid colour cells in the texture's last row
+    enum Swatch { SWATCH_PANEL, SWATCH_WHITE, SWATCH_GREEN, SWATCH_YELLOW, SWATCH_RED, SWATCH_COUNT };
+
+    bool visible = false;
+    GLuint texture = 0;
+    DrawList list;
+    float history[HISTORY] = {}; // frame intervals in ms, oldest first from head
+    int head = 0, recorded = 0;
+
+    // Bake the font texture and register it with the sprite program
+    void setup(ShaderProgram *program, GLuint sampler) {
+        MemoryScope memory(MEM_CPU_TOOLS);
+        std::vector<unsigned char> pixels(TEX_WIDTH * TEX_HEIGHT * 4, 0);
+        static const unsigned char swatches[SWATCH_COUNT][4] = {
+            {16, 18, 28, 255}, {235, 235, 235, 255}, {80, 200, 90, 255}, {230, 200, 60, 255}, {220, 60, 50, 255}};
+        auto fill = [&](int cell, const unsigned char *rgba) {
+            int cx = (cell % 16) * CELL, cy = (cell / 16) * CELL;
+            for (int y = 0; y < CELL; y++) {
+                for (int x = 0; x < CELL; x++) {
+                    std::copy(rgba, rgba + 4, &pixels[((cy + y) * TEX_WIDTH + cx + x) * 4]);
+                }
+            }
+        };
+        for (int g = 0; g <= LAST_GLYPH - FIRST_GLYPH; g++) {
+            fill(g, swatches[SWATCH_PANEL]);
+            int cx = (g % 16) * CELL, cy = (g / 16) * CELL;
+            for (int column = 0; column < 5; column++) {
+                for (int row = 0; row < CELL; row++) {
+                    if (FONT[g][column] >> row & 1) {
+                        std::copy(swatches[SWATCH_WHITE], swatches[SWATCH_WHITE] + 4,
+                                  &pixels[((cy + row) * TEX_WIDTH + cx + column) * 4]);
+                    }
+                }
+            }
+        }
+        for (int s = 0; s < SWATCH_COUNT; s++) {
+            fill(SWATCH_CELL + s, swatches[s]);
+        }
+
+        texture = createTexture2D();
+        textureStorage2D(texture, 1, GL_RGBA8, TEX_WIDTH, TEX_HEIGHT);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        textureSubImage2D(texture, 0, 0, 0, TEX_WIDTH, TEX_HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        memoryStats.trackGl(GL_TEXTURE, texture, MEM_TEXTURES, TEX_WIDTH * TEX_HEIGHT * 4);
+        glMarkers.label(GL_TEXTURE, texture, "overlay font");
+
+        list.shader(program);
+        list.texture(texture, sampler);
+        list.reserve(MAX_QUADS);
+    }
+
+    // Add one frame interval to the graph; call every frame, shown or not
+    void record(double frameMs) {
+        history[head] = (float)frameMs;
+        head = (head + 1) % HISTORY;
+        recorded = std::min(recorded + 1, HISTORY);
+    }
+
+    // Lay out the overlay and draw it through the batch: one draw call
+    void draw(SpriteBatch &batch, const OverlayStats &stats) {
+        list.clear();
+        const float left = 8.0f, top = 592.0f;
+        const float lineHeight = (CELL + 2) * SCALE;
+        const float graphHeight = 60.0f;
+        const int lines = 6 + (stats.glPerfLogged ? 2 : 0) + (stats.overdrawShown ? 1 : 0);
+        quad(left - 4, top + 4, HISTORY * 3 + 8, lines * lineHeight + graphHeight + 14, cellRect(SWATCH_CELL + SWATCH_PANEL));
+
+        double sum = 0.0;
+        for (int i = 0; i < recorded; i++) {
+            sum += history[i];
+        }
+        double fps = sum > 0.0 ? 1000.0 * recorded / sum : 0.0;
+
+        char line[64], gpu[16] = "-";
+        if (stats.gpuMs >= 0.0) {
+            std::snprintf(gpu, sizeof(gpu), "%.2f", stats.gpuMs);
+        }
+        float y = top;
+        std::snprintf(line, sizeof(line), "FPS %.1f CPU %.2f GPU %s MS", fps, stats.cpuMs, gpu);
+        text(left, y, line);
+        y -= lineHeight;
+        if (stats.glCounted) {
+            std::snprintf(line, sizeof(line), "DRAWS %d GL %llu (%llu REDUNDANT)", stats.drawCalls,
+                          (unsigned long long)stats.glCalls, (unsigned long long)stats.glRedundant);
+        } else {
+            std::snprintf(line, sizeof(line), "DRAWS %d GL -", stats.drawCalls);
+        }
+        text(left, y, line);
+        y -= lineHeight;
+        std::snprintf(line, sizeof(line), "STATE %llu SET %llu SKIPPED", (unsigned long long)stats.stateIssued,
+                      (unsigned long long)stats.stateSkipped);
+        text(left, y, line);
+        y -= lineHeight;
+        std::snprintf(line, sizeof(line), "ENTITIES %u (%u CULLED)", stats.entities, stats.culled);
+        text(left, y, line);
+        y -= lineHeight;
+        std::snprintf(line, sizeof(line), "SPAWNS %llu LANES %llu", (unsigned long long)counters.total(COUNTER_SPAWNS),
+                      (unsigned long long)counters.total(COUNTER_LANE_CHANGES));
+        text(left, y, line);
+        y -= lineHeight;
+        std::snprintf(line, sizeof(line), "MEM GPU %.1f MB CPU %.1f MB", memoryStats.gpu.live.load() / 1048576.0,
+                      memoryStats.cpu.live.load() / 1048576.0);
+        text(left, y, line);
+        y -= lineHeight;
+        if (stats.glPerfLogged) {
+            std::snprintf(line, sizeof(line), "GL PERF %u (%llu TOTAL)", stats.glPerfWarnings,
+                          (unsigned long long)stats.glPerfTotal);
+            text(left, y, line);
+            y -= lineHeight;
+            std::snprintf(line, sizeof(line), "%.*s %.*s", 14, stats.glPerfZone, 15, stats.glPerfLast); // fits the panel
+            text(left, y, line);
+            y -= lineHeight;
+        }
+        if (stats.overdrawShown) {
+            std::snprintf(line, sizeof(line), "OVERDRAW AVG %.2f MAX %d", stats.overdrawAverage, stats.overdrawMax);
+            text(left, y, line);
+            y -= lineHeight;
+        }
+
+        // Frame-time graph scaled to twice the budget, with the budget as a white line
+        float bottom = y - graphHeight - 2.0f;
+        for (int i = 0; i < recorded; i++) {
+            float ms = history[(head - recorded + i + HISTORY) % HISTORY];
+            float h = std::min(ms / (float)(2.0 * stats.budgetMs), 1.0f) * graphHeight;
+            int swatch = ms <= stats.budgetMs ? SWATCH_GREEN : ms <= 1.5 * stats.budgetMs ? SWATCH_YELLOW : SWATCH_RED;
+            quad(left + i * 3, bottom + std::max(h, 1.0f), 2, std::max(h, 1.0f), cellRect(SWATCH_CELL + swatch));
+        }
+        quad(left, bottom + graphHeight / 2 + 1, HISTORY * 3, 1, cellRect(SWATCH_CELL + SWATCH_WHITE));
+
+        batch.submit(list); // every command shares one state: a single draw
+    }
+
+    // Delete the font texture; must run while the context is still current
+    void release() {
+        memoryStats.untrackGl(GL_TEXTURE, texture);
+        glState.deleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    // Text left-aligned at x with its top at y; lowercase is drawn as uppercase
+    void text(float x, float y, const char *s) {
+        for (; *s; s++, x += GLYPH_WIDTH * SCALE) {
+            char c = glyphOf(*s);
+            if (c != ' ') {
+                quad(x, y, GLYPH_WIDTH * SCALE, CELL * SCALE, glyphRect(c));
+            }
+        }
+    }
+
+    // The glyph a character is drawn with: uppercase for lowercase, a space for anything the font lacks
+    static char glyphOf(char c) {
+        c = c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c;
+        return c < FIRST_GLYPH || c > LAST_GLYPH ? ' ' : c;
+    }
+
+    // UV rect of a glyph's columns, without the spacing; c as returned by glyphOf
+    static glm::vec4 glyphRect(char c) {
+        glm::vec4 rect = cellRect(c - FIRST_GLYPH);
+        rect.z = (float)GLYPH_WIDTH / TEX_WIDTH;
+        return rect;
+    }
+
+    // UV rect of a whole cell
+    static glm::vec4 cellRect(int cell) {
+        return glm::vec4((float)(cell % 16 * CELL) / TEX_WIDTH, (float)(cell / 16 * CELL) / TEX_HEIGHT,
+                         (float)CELL / TEX_WIDTH, (float)CELL / TEX_HEIGHT);
+    }
+
+    // Axis-aligned rect with its top-left corner at (x, y); recording order is the depth
+    void quad(float x, float y, float w, float h, const glm::vec4 &rect) {
+        if (list.commands.size() < MAX_QUADS) {
+            list.add(DrawList::makeKey(DrawList::TRANSLUCENT, 0, 0, (uint32_t)list.commands.size()),
+                     makeSpriteInstance(glm::vec2(x + w / 2, y - h / 2), glm::vec2(w, h), 0.0f, rect));
+        }
+    }
+
+    // 5x8 font for ' ' to '_', one byte per column, bit 0 at the top
+    static constexpr unsigned char FONT[LAST_GLYPH - FIRST_GLYPH + 1][5] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5F, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00}, // space ! "
+        {0x14, 0x7F, 0x14, 0x7F, 0x14}, {0x24, 0x2A, 0x7F, 0x2A, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62}, // # $ %
+        {0x36, 0x49, 0x56, 0x20, 0x50}, {0x00, 0x08, 0x07, 0x03, 0x00}, {0x00, 0x1C, 0x22, 0x41, 0x00}, // & ' (
+        {0x00, 0x41, 0x22, 0x1C, 0x00}, {0x2A, 0x1C, 0x7F, 0x1C, 0x2A}, {0x08, 0x08, 0x3E, 0x08, 0x08}, // ) * +
+        {0x00, 0x80, 0x70, 0x30, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x00, 0x60, 0x60, 0x00}, // , - .
+        {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3E, 0x51, 0x49, 0x45, 0x3E}, {0x00, 0x42, 0x7F, 0x40, 0x00}, // / 0 1
+        {0x72, 0x49, 0x49, 0x49, 0x46}, {0x21, 0x41, 0x49, 0x4D, 0x33}, {0x18, 0x14, 0x12, 0x7F, 0x10}, // 2 3 4
+        {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3C, 0x4A, 0x49, 0x49, 0x31}, {0x41, 0x21, 0x11, 0x09, 0x07}, // 5 6 7
+        {0x36, 0x49, 0x49, 0x49, 0x36}, {0x46, 0x49, 0x49, 0x29, 0x1E}, {0x00, 0x00, 0x14, 0x00, 0x00}, // 8 9 :
+        {0x00, 0x40, 0x34, 0x00, 0x00}, {0x00, 0x08, 0x14, 0x22, 0x41}, {0x14, 0x14, 0x14, 0x14, 0x14}, // ; < =
+        {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x59, 0x09, 0x06}, {0x3E, 0x41, 0x5D, 0x59, 0x4E}, // > ? @
+        {0x7C, 0x12, 0x11, 0x12, 0x7C}, {0x7F, 0x49, 0x49, 0x49, 0x36}, {0x3E, 0x41, 0x41, 0x41, 0x22}, // A B C
+        {0x7F, 0x41, 0x41, 0x41, 0x3E}, {0x7F, 0x49, 0x49, 0x49, 0x41}, {0x7F, 0x09, 0x09, 0x09, 0x01}, // D E F
+        {0x3E, 0x41, 0x41, 0x51, 0x73}, {0x7F, 0x08, 0x08, 0x08, 0x7F}, {0x00, 0x41, 0x7F, 0x41, 0x00}, // G H I
+        {0x20, 0x40, 0x41, 0x3F, 0x01}, {0x7F, 0x08, 0x14, 0x22, 0x41}, {0x7F, 0x40, 0x40, 0x40, 0x40}, // J K L
+        {0x7F, 0x02, 0x1C, 0x02, 0x7F}, {0x7F, 0x04, 0x08, 0x10, 0x7F}, {0x3E, 0x41, 0x41, 0x41, 0x3E}, // M N O
+        {0x7F, 0x09, 0x09, 0x09, 0x06}, {0x3E, 0x41, 0x51, 0x21, 0x5E}, {0x7F, 0x09, 0x19, 0x29, 0x46}, // P Q R
+        {0x26, 0x49, 0x49, 0x49, 0x32}, {0x03, 0x01, 0x7F, 0x01, 0x03}, {0x3F, 0x40, 0x40, 0x40, 0x3F}, // S T U
+        {0x1F, 0x20, 0x40, 0x20, 0x1F}, {0x3F, 0x40, 0x38, 0x40, 0x3F}, {0x63, 0x14, 0x08, 0x14, 0x63}, // V W X
+        {0x03, 0x04, 0x78, 0x04, 0x03}, {0x61, 0x59, 0x49, 0x4D, 0x43}, {0x00, 0x7F, 0x41, 0x41, 0x41}, // Y Z [
+        {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x41, 0x7F}, {0x04, 0x02, 0x01, 0x02, 0x04}, // \ ] ^
+        {0x40, 0x40, 0x40, 0x40, 0x40}                                                                  // _
+    };
+};
@@ -0,0 +1,567 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include "image_arena.h"
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SPACE_TRAVEL_PNG_SSE2 1
+#endif
+
+// PNG decoder for the images the game ships and the skins players drop in: 8-bit
+// grey, grey+alpha, RGB, RGBA and palette images without interlacing, to RGBA8.
+// Anything else (16-bit or sub-byte samples, Adam7, colour-key transparency) or
+// anything malformed returns nullptr, and image_decoder.h hands the file to
+// stb_image instead. It is faster than stb_image where that spends its time:
+//   - inflate refills a 64-bit bit buffer a word at a time, so one refill covers a
+//     whole literal/length + distance pair;
+//   - codes decode through 10-bit tables whose entries already carry the length or
+//     distance base and its extra-bit count;
+//   - matches copy 8 bytes at a time;
+//   - the zlib stream is read in place when one IDAT chunk holds it;
+//   - rows are unfiltered with SSE2 for 3- and 4-byte pixels, the Paeth predictor
+//     branch-free as in libpng, and expanded to RGBA in the same pass.
+// Like stb_image it checks neither the chunk CRCs nor the Adler-32. Allocations go
+// through imageMalloc, so the result is freed with stbi_image_free and an
+// ImageArenaScope covers it.
+struct PngInflater {
+    static const int FAST_BITS = 10; // codes up to this long decode in one lookup
+    static const uint32_t FAST_MASK = (1u << FAST_BITS) - 1;
+
+    // Table entry: bits 0-3 the code length (0 in the fast table: a longer code),
+    // 4-7 the extra bits to read, 8-9 the kind, 16-31 the literal, symbol or base
+    enum Kind : uint32_t { LITERAL = 0, MATCH = 1, END = 2, INVALID = 3 };
+    enum Alphabet { LITERAL_LENGTH, DISTANCE, CODE_LENGTH };
+
+    struct Huffman {
+        uint32_t fast[1 << FAST_BITS];
+        uint32_t entries[288]; // by symbol, without the length
+        uint16_t counts[16];   // codes of each length
+        uint16_t symbols[288]; // in canonical order
+
+        // Canonical codes from code lengths; false if they are over-subscribed
+        bool build(const uint8_t *lengths, int n, Alphabet alphabet) {
+            static const uint16_t LENGTH_BASE[29] = {3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+                                                     31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+            static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2,
+                                                     2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+            static const uint16_t DIST_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                   193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+            static const uint8_t DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                                   6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+            std::memset(fast, 0, sizeof(fast));
+            std::memset(counts, 0, sizeof(counts));
+            for (int s = 0; s < n; s++) {
+                counts[lengths[s]]++;
+            }
+            counts[0] = 0;
+            int left = 1;
+            uint16_t offsets[16] = {};
+            uint32_t next[16] = {};
+            for (int len = 1; len < 16; len++) {
+                left = (left << 1) - counts[len];
+                if (left < 0) {
+                    return false;
+                }
+                offsets[len] = (uint16_t)(len > 1 ? offsets[len - 1] + counts[len - 1] : 0);
+                next[len] = (next[len - 1] + counts[len - 1]) << 1;
+            }
+            for (int s = 0; s < n; s++) {
+                int len = lengths[s];
+                uint32_t e = INVALID << 8;
+                if (alphabet == CODE_LENGTH || (alphabet == LITERAL_LENGTH && s < 256)) {
+                    e = (uint32_t)s << 16 | LITERAL << 8;
+                } else if (alphabet == LITERAL_LENGTH && s == 256) {
+                    e = END << 8;
+                } else if (alphabet == LITERAL_LENGTH && s < 286) {
+                    e = (uint32_t)LENGTH_BASE[s - 257] << 16 | MATCH << 8 | (uint32_t)LENGTH_EXTRA[s - 257] << 4;
+                } else if (alphabet == DISTANCE && s < 30) {
+                    e = (uint32_t)DIST_BASE[s] << 16 | MATCH << 8 | (uint32_t)DIST_EXTRA[s] << 4;
+                }
+                entries[s] = e;
+                if (!len) {
+                    continue;
+                }
+                symbols[offsets[len]++] = (uint16_t)s;
+                uint32_t code = next[len]++, reversed = 0;
+                for (int b = 0; b < len; b++) {
+                    reversed |= (code >> b & 1) << (len - 1 - b); // deflate sends codes high bit first
+                }
+                for (uint32_t slot = reversed; len <= FAST_BITS && slot <= FAST_MASK; slot += 1u << len) {
+                    fast[slot] = e | (uint32_t)len;
+                }
+            }
+            return true;
+        }
+    };
+
+    const uint8_t *in = nullptr, *end = nullptr;
+    uint64_t bits = 0;  // unread bits, oldest lowest; those above count mirror the next input bytes
+    int count = 0;      // valid bits in bits
+    size_t overrun = 0; // zero bytes fed in past the end of the input
+    Huffman lit, dist, codeLengths;
+
+    // Top the bit buffer up to at least 56 bits
+    void refill() {
+        if (end - in >= 8) {
+            uint64_t word;
+            std::memcpy(&word, in, 8); // little-endian, as the stream is
+            bits |= word << count;
+            in += (63 - count) >> 3;
+            count |= 56;
+            return;
+        }
+        while (count <= 56) {
+            uint64_t byte = in < end ? *in++ : (overrun++, 0);
+            bits |= byte << count;
+            count += 8;
+        }
+    }
+
+    uint32_t take(int n) {
+        uint32_t v = (uint32_t)(bits & ((1ull << n) - 1));
+        bits >>= n;
+        count -= n;
+        return v;
+    }
+
+    // The next symbol's entry: one lookup, or a code longer than FAST_BITS bit by bit
+    uint32_t decode(const Huffman &h) {
+        uint32_t e = h.fast[bits & FAST_MASK];
+        if (e & 15) {
+            take((int)(e & 15));
+            return e;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len < 16; len++) {
+            code |= (int)take(1);
+            int n = h.counts[len];
+            if (code - n < first) {
+                return h.entries[h.symbols[index + (code - first)]];
+            }
+            index += n;
+            first = (first + n) << 1;
+            code <<= 1;
+        }
+        return INVALID << 8;
+    }
+
+    // Inflate a zlib stream into exactly size bytes at dst
+    bool inflate(const uint8_t *src, size_t srcSize, uint8_t *dst, size_t size) {
+        if (srcSize < 2 || (src[0] & 15) != 8 || (src[0] << 8 | src[1]) % 31 != 0 || (src[1] & 32)) {
+            return false; // not deflate, or a preset dictionary
+        }
+        in = src + 2;
+        end = src + srcSize;
+        bits = 0;
+        count = 0;
+        overrun = 0;
+        uint8_t *out = dst, *outEnd = dst + size;
+        bool final;
+        do {
+            refill();
+            final = take(1) != 0;
+            uint32_t type = take(2);
+            bool ok;
+            if (type == 0) {
+                ok = stored(out, outEnd);
+            } else if (type == 1) {
+                ok = block(fixedLiterals(), fixedDistances(), dst, out, outEnd);
+            } else if (type == 2) {
+                ok = dynamicTables() && block(lit, dist, dst, out, outEnd);
+            } else {
+                ok = false;
+            }
+            if (!ok || (size_t)count < overrun * 8) {
+                return false; // malformed, or it read past the end
+            }
+        } while (!final);
+        return out == outEnd;
+    }
+
+    bool stored(uint8_t *&out, uint8_t *outEnd) {
+        take(count & 7);
+        size_t held = (size_t)count >> 3; // whole bytes already in the buffer go back
+        if (held < overrun) {
+            return false;
+        }
+        in -= held - overrun;
+        overrun = 0;
+        bits = 0;
+        count = 0;
+        if (end - in < 4) {
+            return false;
+        }
+        size_t len = (size_t)in[0] | (size_t)in[1] << 8, inverse = (size_t)in[2] | (size_t)in[3] << 8;
+        in += 4;
+        if ((len ^ 0xFFFF) != inverse || (size_t)(end - in) < len || (size_t)(outEnd - out) < len) {
+            return false;
+        }
+        std::memcpy(out, in, len);
+        in += len;
+        out += len;
+        return true;
+    }
+
+    bool dynamicTables() {
+        static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+        refill();
+        int literals = (int)take(5) + 257, distances = (int)take(5) + 1, codes = (int)take(4) + 4;
+        uint8_t lengths[286 + 30] = {};
+        for (int i = 0; i < codes; i++) {
+            refill();
+            lengths[ORDER[i]] = (uint8_t)take(3);
+        }
+        if (literals > 286 || distances > 30 || !codeLengths.build(lengths, 19, CODE_LENGTH)) {
+            return false; // HLIT and HDIST can name more codes than deflate has, as zlib rejects
+        }
+        std::memset(lengths, 0, 19);
+        for (int n = 0, total = literals + distances; n < total;) {
+            refill();
+            uint32_t e = decode(codeLengths);
+            uint32_t symbol = e >> 16;
+            if ((e >> 8 & 3) != LITERAL) {
+                return false;
+            }
+            if (symbol < 16) {
+                lengths[n++] = (uint8_t)symbol;
+                continue;
+            }
+            int repeat;
+            uint8_t value = 0;
+            if (symbol == 16) {
+                if (n == 0) {
+                    return false;
+                }
+                value = lengths[n - 1];
+                repeat = 3 + (int)take(2);
+            } else {
+                repeat = symbol == 17 ? 3 + (int)take(3) : 11 + (int)take(7);
+            }
+            if (n + repeat > total) {
+                return false;
+            }
+            std::memset(lengths + n, value, (size_t)repeat);
+            n += repeat;
+        }
+        return lengths[256] != 0 && lit.build(lengths, literals, LITERAL_LENGTH) &&
+               dist.build(lengths + literals, distances, DISTANCE);
+    }
+
+    static const Huffman &fixedLiterals() {
+        static const Huffman table = [] {
+            Huffman h;
+            uint8_t lengths[288];
+            std::memset(lengths, 8, 144);
+            std::memset(lengths + 144, 9, 112);
+            std::memset(lengths + 256, 7, 24);
+            std::memset(lengths + 280, 8, 8);
+            h.build(lengths, 288, LITERAL_LENGTH);
+            return h;
+        }();
+        return table;
+    }
+
+    static const Huffman &fixedDistances() {
+        static const Huffman table = [] {
+            Huffman h;
+            uint8_t lengths[30];
+            std::memset(lengths, 5, 30);
+            h.build(lengths, 30, DISTANCE);
+            return h;
+        }();
+        return table;
+    }
+
+    // Symbols up to the end-of-block code
+    bool block(const Huffman &literals, const Huffman &distances, const uint8_t *dst, uint8_t *&out, uint8_t *outEnd) {
+        for (;;) {
+            refill(); // 56 bits: enough for a length code, its extra bits, a distance code and its extra bits
+            uint32_t e = decode(literals);
+            uint32_t kind = e >> 8 & 3;
+            if (kind == LITERAL) {
+                if (out == outEnd) {
+                    return false;
+                }
+                *out++ = (uint8_t)(e >> 16);
+                continue;
+            }
+            if (kind != MATCH) {
+                return kind == END;
+            }
+            size_t length = (e >> 16) + take((int)(e >> 4 & 15));
+            e = decode(distances);
+            if ((e >> 8 & 3) != MATCH) {
+                return false;
+            }
+            size_t distance = (e >> 16) + take((int)(e >> 4 & 15));
+            if (distance > (size_t)(out - dst) || length > (size_t)(outEnd - out)) {
+                return false;
+            }
+            const uint8_t *from = out - distance;
+            if (distance >= 8 && (size_t)(outEnd - out) >= length + 8) {
+                uint8_t *stop = out + length; // may write up to 7 bytes past it, all rewritten later
+                do {
+                    std::memcpy(out, from, 8);
+                    out += 8;
+                    from += 8;
+                } while (out < stop);
+                out = stop;
+            } else if (distance == 1) {
+                std::memset(out, *from, length);
+                out += length;
+            } else {
+                // A short pattern repeated: each copy doubles the span already written
+                uint8_t *stop = out + length;
+                while (out < stop) {
+                    size_t span = (size_t)(out - from) < (size_t)(stop - out) ? (size_t)(out - from) : (size_t)(stop - out);
+                    std::memcpy(out, from, span);
+                    out += span;
+                }
+            }
+        }
+    }
+};
+
+#ifdef SPACE_TRAVEL_PNG_SSE2
+template <int BPP>
+inline __m128i pngLoadPixel(const uint8_t *p) {
+    uint32_t v = 0;
+    std::memcpy(&v, p, BPP);
+    return _mm_cvtsi32_si128((int)v);
+}
+
+template <int BPP>
+inline void pngStorePixel(uint8_t *p, __m128i v) {
+    uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+    std::memcpy(p, &x, BPP);
+}
+
+inline __m128i pngAbs16(__m128i x) {
+    return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+inline __m128i pngSelect(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+// Sub, Average or Paeth for 3- or 4-byte pixels, one pixel per step: each depends
+// on the one to its left
+template <int BPP>
+inline void pngUnfilterPixels(uint8_t *row, const uint8_t *prev, size_t stride, int filter) {
+    const __m128i zero = _mm_setzero_si128(), ones = _mm_set1_epi8(1);
+    __m128i a = zero; // the pixel to the left
+    if (filter == 1) {
+        for (size_t i = 0; i < stride; i += BPP) {
+            a = _mm_add_epi8(pngLoadPixel<BPP>(row + i), a);
+            pngStorePixel<BPP>(row + i, a);
+        }
+    } else if (filter == 3) {
+        for (size_t i = 0; i < stride; i += BPP) {
+            __m128i b = pngLoadPixel<BPP>(prev + i);
+            __m128i average = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), ones)); // rounded down
+            a = _mm_add_epi8(pngLoadPixel<BPP>(row + i), average);
+            pngStorePixel<BPP>(row + i, a);
+        }
+    } else {
+        __m128i c = zero; // 16-bit lanes from here: left, above and upper left
+        for (size_t i = 0; i < stride; i += BPP) {
+            __m128i b = _mm_unpacklo_epi8(pngLoadPixel<BPP>(prev + i), zero);
+            __m128i pa = _mm_sub_epi16(b, c), pb = _mm_sub_epi16(a, c);
+            __m128i pc = pngAbs16(_mm_add_epi16(pa, pb));
+            pa = pngAbs16(pa);
+            pb = pngAbs16(pb);
+            __m128i smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+            __m128i nearest = pngSelect(_mm_cmpeq_epi16(pa, smallest), a, pngSelect(_mm_cmpeq_epi16(pb, smallest), b, c));
+            __m128i x = _mm_add_epi8(pngLoadPixel<BPP>(row + i), _mm_packus_epi16(nearest, nearest));
+            pngStorePixel<BPP>(row + i, x);
+            a = _mm_unpacklo_epi8(x, zero);
+            c = b;
+        }
+    }
+}
+#endif
+
+// Undo one row's filter in place; prev is the row above, unfiltered (zeros for the first)
+inline bool pngUnfilterRow(uint8_t *row, const uint8_t *prev, size_t stride, int bpp, int filter) {
+    switch (filter) {
+        case 0: return true;
+        case 2:
+            for (size_t i = 0; i < stride; i++) {
+                row[i] = (uint8_t)(row[i] + prev[i]); // vectorized by the compiler
+            }
+            return true;
+        default: break;
+    }
+    if (filter > 4) {
+        return false;
+    }
+#ifdef SPACE_TRAVEL_PNG_SSE2
+    if (bpp == 4) {
+        pngUnfilterPixels<4>(row, prev, stride, filter);
+        return true;
+    }
+    if (bpp == 3) {
+        pngUnfilterPixels<3>(row, prev, stride, filter);
+        return true;
+    }
+#endif
+    for (size_t i = 0; i < stride; i++) {
+        int a = i >= (size_t)bpp ? row[i - bpp] : 0, b = prev[i], c = i >= (size_t)bpp ? prev[i - bpp] : 0;
+        int predicted;
+        if (filter == 1) {
+            predicted = a;
+        } else if (filter == 3) {
+            predicted = (a + b) >> 1;
+        } else {
+            int p = a + b - c, pa = p > a ? p - a : a - p, pb = p > b ? p - b : b - p, pc = p > c ? p - c : c - p;
+            predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+        }
+        row[i] = (uint8_t)(row[i] + predicted);
+    }
+    return true;
+}
+
+inline uint32_t pngBigEndian(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+// RGBA8 pixels of a PNG in memory, or nullptr if it is not one this decoder handles
+inline unsigned char *decodePng(const unsigned char *bytes, size_t size, int *width, int *height) {
+    static const uint8_t SIGNATURE[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+    if (size < 8 || std::memcmp(bytes, SIGNATURE, 8) != 0) {
+        return nullptr;
+    }
+    uint32_t w = 0, h = 0;
+    int colorType = -1;
+    uint8_t palette[256 * 4];
+    for (int i = 0; i < 256; i++) {
+        std::memcpy(palette + i * 4, "\0\0\0\xff", 4);
+    }
+    int paletteSize = 0;
+    const uint8_t *firstData = nullptr; // the first IDAT's data
+    size_t dataBytes = 0, dataChunks = 0;
+    const uint8_t *p = bytes + 8, *end = bytes + size;
+    while (end - p >= 12) {
+        uint32_t len = pngBigEndian(p);
+        const uint8_t *type = p + 4, *data = p + 8;
+        if (len > (size_t)(end - p) - 12) {
+            return nullptr;
+        }
+        if (std::memcmp(type, "IHDR", 4) == 0) {
+            if (len != 13 || data[8] != 8 || data[10] != 0 || data[11] != 0 || data[12] != 0) {
+                return nullptr; // only 8-bit samples, not interlaced
+            }
+            w = pngBigEndian(data);
+            h = pngBigEndian(data + 4);
+            colorType = data[9];
+        } else if (std::memcmp(type, "PLTE", 4) == 0) {
+            paletteSize = (int)(len / 3 < 256 ? len / 3 : 256);
+            for (int i = 0; i < paletteSize; i++) {
+                std::memcpy(palette + i * 4, data + i * 3, 3);
+            }
+        } else if (std::memcmp(type, "tRNS", 4) == 0) {
+            if (colorType != 3) {
+                return nullptr; // a colour key: left to stb_image
+            }
+            for (uint32_t i = 0; i < len && i < 256; i++) {
+                palette[i * 4 + 3] = data[i];
+            }
+        } else if (std::memcmp(type, "IDAT", 4) == 0) {
+            firstData = firstData ? firstData : data;
+            dataBytes += len;
+            dataChunks++;
+        } else if (std::memcmp(type, "IEND", 4) == 0) {
+            break;
+        }
+        p += 12 + (size_t)len;
+    }
+    static const int CHANNELS[7] = {1, 0, 3, 1, 2, 0, 4};
+    if (colorType < 0 || colorType > 6 || !CHANNELS[colorType] || (colorType == 3 && !paletteSize) || !w || !h ||
+        w > (1u << 24) || h > (1u << 24) || (uint64_t)w * h > (1u << 28) || !dataChunks) {
+        return nullptr;
+    }
+    int bpp = CHANNELS[colorType];
+    size_t stride = (size_t)w * bpp, rawSize = (stride + 1) * h;
+
+    // Several IDATs are one stream split up: join them only then
+    const uint8_t *stream = firstData;
+    uint8_t *joined = nullptr;
+    if (dataChunks > 1) {
+        joined = (uint8_t *)imageMalloc(dataBytes);
+        if (!joined) {
+            return nullptr;
+        }
+        size_t at = 0;
+        for (p = bytes + 8; end - p >= 12; p += 12 + (size_t)pngBigEndian(p)) {
+            if (std::memcmp(p + 4, "IDAT", 4) == 0) {
+                std::memcpy(joined + at, p + 8, pngBigEndian(p));
+                at += pngBigEndian(p);
+            } else if (std::memcmp(p + 4, "IEND", 4) == 0) {
+                break;
+            }
+        }
+        stream = joined;
+    }
+
+    uint8_t *raw = (uint8_t *)imageMalloc(rawSize + stride); // the filtered rows, then a zero row
+    uint8_t *pixels = raw ? (uint8_t *)imageMalloc((size_t)w * h * 4) : nullptr;
+    PngInflater *inflater = pixels ? new (std::nothrow) PngInflater() : nullptr; // ~13 KB of tables
+    bool ok = inflater && inflater->inflate(stream, dataBytes, raw, rawSize);
+    delete inflater;
+    imageFree(joined);
+    if (!ok) {
+        imageFree(pixels);
+        imageFree(raw);
+        return nullptr;
+    }
+
+    uint8_t *zero = raw + rawSize;
+    std::memset(zero, 0, stride);
+    const uint8_t *prev = zero;
+    for (uint32_t y = 0; y < h && ok; y++) {
+        uint8_t *row = raw + y * (stride + 1);
+        ok = pngUnfilterRow(row + 1, prev, stride, bpp, row[0]);
+        const uint8_t *src = row + 1;
+        uint8_t *dst = pixels + (size_t)y * w * 4;
+        switch (colorType) {
+            case 6: std::memcpy(dst, src, stride); break;
+            case 2:
+                for (uint32_t x = 0; x < w; x++, src += 3, dst += 4) {
+                    dst[0] = src[0];
+                    dst[1] = src[1];
+                    dst[2] = src[2];
+                    dst[3] = 255;
+                }
+                break;
+            case 0:
+                for (uint32_t x = 0; x < w; x++, dst += 4) {
+                    dst[0] = dst[1] = dst[2] = src[x];
+                    dst[3] = 255;
+                }
+                break;
+            case 4:
+                for (uint32_t x = 0; x < w; x++, src += 2, dst += 4) {
+                    dst[0] = dst[1] = dst[2] = src[0];
+                    dst[3] = src[1];
+                }
+                break;
+            default:
+                for (uint32_t x = 0; x < w; x++, dst += 4) {
+                    std::memcpy(dst, palette + src[x] * 4, 4);
+                }
+                break;
+        }
+        prev = row + 1;
+    }
+    imageFree(raw);
+    if (!ok) {
+        imageFree(pixels);
+        return nullptr;
+    }
+    *width = (int)w;
+    *height = (int)h;
+    return pixels;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstdio>
+#include <string>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#endif
+
+// Where the machine is drawing power from
+enum class PowerSource { Unknown, Mains, Battery };
+
+// Lowers the frame rate and render scale while a laptop runs on battery and restores
+// them on mains power. The source is polled every POLL_INTERVAL rather than every
+// frame; poll() reports a change once, and the caller applies limits() to the frame
+// pacer and dynamic resolution. An unknown source, such as a desktop without a
+// battery, counts as mains.
+struct PowerPolicy {
+    static constexpr double POLL_INTERVAL = 5.0; // seconds
+
+    bool enabled = false;
+    double batteryFps = 30.0;
+    float batteryScale = 0.75f;
+    PowerSource source = PowerSource::Unknown;
+    double nextPoll = 0.0;
+    int switches = 0;
+
+    void setup(double fps, float scale) {
+        enabled = true;
+        batteryFps = fps;
+        batteryScale = scale;
+    }
+
+    bool onBattery() const {
+        return source == PowerSource::Battery;
+    }
+
+    // Query the source if the interval has passed; true when it changed since the last poll
+    bool poll(double now) {
+        if (!enabled || now < nextPoll) {
+            return false;
+        }
+        nextPoll = now + POLL_INTERVAL;
+        PowerSource current = query();
+        if (current == source) {
+            return false;
+        }
+        bool first = source == PowerSource::Unknown && current == PowerSource::Mains;
+        source = current;
+        if (!first) {
+            switches++;
+        }
+        return !first; // starting on mains changes nothing
+    }
+
+    // Frame rate and render scale caps for the current source; 0 and 1 lift them
+    double fpsLimit() const {
+        return onBattery() ? batteryFps : 0.0;
+    }
+
+    float scaleLimit() const {
+        return onBattery() ? batteryScale : 1.0f;
+    }
+
+    static PowerSource query() {
+#ifdef _WIN32
+        SYSTEM_POWER_STATUS status;
+        if (!GetSystemPowerStatus(&status)) {
+            return PowerSource::Unknown;
+        }
+        if (status.ACLineStatus == 0) {
+            return PowerSource::Battery;
+        }
+        return status.ACLineStatus == 1 ? PowerSource::Mains : PowerSource::Unknown;
+#else
+        // Any online mains supply wins; otherwise a discharging battery means battery
+        DIR *dir = opendir("/sys/class/power_supply");
+        if (!dir) {
+            return PowerSource::Unknown;
+        }
+        PowerSource found = PowerSource::Unknown;
+        while (dirent *entry = readdir(dir)) {
+            if (entry->d_name[0] == '.') {
+                continue;
+            }
+            std::string base = std::string("/sys/class/power_supply/") + entry->d_name + "/";
+            std::string type = readLine(base + "type");
+            if (type == "Mains") {
+                if (readLine(base + "online") == "1") {
+                    found = PowerSource::Mains;
+                    break;
+                }
+            } else if (type == "Battery" && readLine(base + "status") == "Discharging") {
+                found = PowerSource::Battery;
+            }
+        }
+        closedir(dir);
+        return found;
+#endif
+    }
+
+#ifndef _WIN32
+    static std::string readLine(const std::string &path) {
+        char line[64] = {};
+        FILE *file = std::fopen(path.c_str(), "r");
+        if (!file) {
+            return {};
+        }
+        if (!std::fgets(line, sizeof(line), file)) {
+            line[0] = 0;
+        }
+        std::fclose(file);
+        std::string text = line;
+        while (!text.empty() && (text.back() == '\n' || text.back() == '\r')) {
+            text.pop_back();
+        }
+        return text;
+    }
+#endif
+};
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstddef>
+
+// Every sprite texture is stored with its colour already multiplied by its alpha, and
+// everything is blended with glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA). Filtering
+// and mip averaging then never bleed the colour of transparent texels into the edges,
+// and a fragment with zero alpha adds its colour, so additive effects need no blend
+// state of their own.
+
+// Multiply the colour of RGBA8 pixels by their alpha in place, rounding to nearest
+inline void premultiplyAlpha(unsigned char *rgba, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++, rgba += 4) {
+        unsigned a = rgba[3];
+        for (int c = 0; c < 3; c++) {
+            unsigned v = rgba[c] * a + 128;
+            rgba[c] = (unsigned char)((v + (v >> 8)) >> 8);
+        }
+    }
+}
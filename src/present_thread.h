@@ -0,0 +1,91 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "thread_config.h"
+
+// Swaps the window's buffers on a thread of its own, so a swap that blocks until
+// vsync overlaps the next frame's input and simulation instead of stalling them.
+// The context can be current on one thread at a time, so it changes hands twice a
+// frame: present() flushes the frame and releases the context for this thread to
+// make current, swap and release again; acquire() waits for that and takes it back
+// before the render thread's next GL call. Between the two the render thread must
+// not touch GL: the game loop runs input and simulation there, and moves its
+// GL-side polling (fences, texture uploads) after acquire().
+struct PresentThread {
+    bool enabled = false;
+    GLFWwindow *window = nullptr;
+    std::thread worker;
+    std::mutex lock;
+    std::condition_variable wake;
+    bool pending = false; // a frame was handed over and not yet swapped
+    bool running = false;
+
+    // Start the thread; the render thread keeps the context until its first present()
+    void start(GLFWwindow *presentWindow) {
+        window = presentWindow;
+        enabled = running = true;
+        worker = std::thread([this] { run(); });
+    }
+
+    // Render thread: hand the finished frame over and give up the context
+    void present() {
+        glFlush(); // submitted before another thread's swap
+        glfwMakeContextCurrent(nullptr);
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending = true;
+        }
+        wake.notify_all();
+    }
+
+    // Render thread: wait for the last frame's swap and take the context back; a
+    // no-op while it still holds it
+    void acquire() {
+        if (glfwGetCurrentContext() == window) {
+            return;
+        }
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this] { return !pending; });
+        }
+        glfwMakeContextCurrent(window);
+    }
+
+    void run() {
+        configureThread(THREAD_IO, "present");
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return pending || !running; });
+            if (!pending) {
+                break;
+            }
+            guard.unlock();
+            glfwMakeContextCurrent(window);
+            glfwSwapBuffers(window);
+            glfwMakeContextCurrent(nullptr);
+            guard.lock();
+            pending = false;
+            wake.notify_all();
+        }
+    }
+
+    // Present anything still pending, end the thread and leave the context current
+    // on the render thread
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        wake.notify_all();
+        worker.join();
+        acquire();
+        enabled = false;
+    }
+};
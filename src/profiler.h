@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "memory_stats.h"
+
+// In-process zone profiler. PROFILE_SCOPE("name") times the enclosing scope and
+// appends it to the calling thread's ring buffer, which only that thread writes:
+// an entry is stored, then the ring's head is published with a release store. No
+// locks or allocation on that path, so a zone costs two timestamp reads and a few
+// stores and the profiler stays compiled into release builds. New zones overwrite
+// the oldest once a ring is full. flush() snapshots every ring, from any thread,
+// and writes the zones as Chrome trace JSON (chrome://tracing, ui.perfetto.dev).
+// Zone names must be string literals or otherwise live for the whole run. Each ring
+// also knows its thread's innermost open zone, so an event raised inside a call
+// (a driver warning, say) can say where it happened, and mark() adds such events to
+// the trace as instants with a line of detail. longest() finds the zones that ran
+// through a span of time, for a hitch report, without allocating.
+
+// Raw timestamp: the TSC on x86, else the steady clock
+inline uint64_t profileTicks() {
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+struct Profiler {
+    static const uint32_t RING_CAPACITY = 1 << 14; // zones kept per thread
+
+    struct Zone {
+        const char *name;
+        uint64_t start, end; // profileTicks()
+    };
+
+    struct Ring {
+        Zone zones[RING_CAPACITY];
+        std::atomic<uint64_t> head{0}; // zones ever written
+        uint32_t thread;
+        std::string name;
+        const char *active = nullptr; // innermost open zone; the owning thread's only
+    };
+
+    // One instant event; rare, so it may lock and allocate
+    struct Marker {
+        const char *name;
+        uint64_t time; // profileTicks()
+        uint32_t thread;
+        std::string detail;
+    };
+
+    static const size_t MAX_MARKERS = 4096; // later markers are counted, not kept
+
+    std::vector<std::unique_ptr<Ring>> rings;
+    std::vector<Marker> markers;
+    uint64_t markersDropped = 0;
+    std::mutex lock; // guards rings, names and markers, never taken per zone
+    uint64_t originTicks = profileTicks();
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+    // The calling thread's ring, registered on its first zone
+    Ring &threadRing() {
+        static thread_local Ring *ring = nullptr;
+        if (!ring) {
+            std::lock_guard<std::mutex> guard(lock);
+            MemoryScope memory(MEM_CPU_TOOLS);
+            rings.emplace_back(new Ring());
+            ring = rings.back().get();
+            ring->thread = (uint32_t)rings.size() - 1;
+            ring->name = ring->thread == 0 ? "main" : "thread " + std::to_string(ring->thread);
+        }
+        return *ring;
+    }
+
+    void record(const char *name, uint64_t start, uint64_t end) {
+        record(threadRing(), name, start, end);
+    }
+
+    void record(Ring &ring, const char *name, uint64_t start, uint64_t end) {
+        uint64_t head = ring.head.load(std::memory_order_relaxed);
+        ring.zones[head % RING_CAPACITY] = {name, start, end};
+        ring.head.store(head + 1, std::memory_order_release);
+    }
+
+    // Label the calling thread in the trace viewer
+    void nameThread(const char *name) {
+        Ring &ring = threadRing();
+        std::lock_guard<std::mutex> guard(lock);
+        ring.name = name;
+    }
+
+    // The calling thread's innermost open zone, or nullptr outside every zone
+    const char *activeZone() {
+        return threadRing().active;
+    }
+
+    // Add an instant event on the calling thread to the trace
+    void mark(const char *name, std::string detail) {
+        uint64_t now = profileTicks();
+        uint32_t thread = threadRing().thread;
+        std::lock_guard<std::mutex> guard(lock);
+        if (markers.size() == MAX_MARKERS) {
+            markersDropped++;
+            return;
+        }
+        MemoryScope memory(MEM_CPU_TOOLS);
+        markers.push_back({name, now, thread, std::move(detail)});
+    }
+
+    // Tick rate from the span since construction; exact for the steady clock fallback
+    double ticksPerMicro() const {
+        uint64_t ticks = profileTicks();
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+        return micros > 0.0 && ticks > originTicks ? (ticks - originTicks) / micros : 1.0;
+    }
+
+    // A zone and the ring it came from
+    struct ZoneHit {
+        Zone zone;
+        const Ring *ring;
+    };
+
+    // Up to max zones on any thread that overlap [start, end) in profileTicks(),
+    // longest first; returns how many. Zones overwritten while being read are skipped.
+    int longest(uint64_t start, uint64_t end, ZoneHit *out, int max) {
+        std::lock_guard<std::mutex> guard(lock);
+        int count = 0;
+        for (const auto &ring : rings) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            for (uint64_t i = head > RING_CAPACITY ? head - RING_CAPACITY : 0; i < head; i++) {
+                Zone z = ring->zones[i % RING_CAPACITY];
+                uint64_t length = z.end - z.start;
+                if (ring->head.load(std::memory_order_acquire) >= i + RING_CAPACITY || z.end <= start || z.start >= end ||
+                    (count == max && out[max - 1].zone.end - out[max - 1].zone.start >= length)) {
+                    continue;
+                }
+                // Insert into the list, kept sorted by length; a full one drops its shortest
+                int at = count < max ? count++ : max - 1;
+                for (; at > 0 && out[at - 1].zone.end - out[at - 1].zone.start < length; at--) {
+                    out[at] = out[at - 1];
+                }
+                out[at] = {z, ring.get()};
+            }
+        }
+        return count;
+    }
+
+    // Write every zone still held in the rings; callable from any thread at any time
+    bool flush(const std::string &path) {
+        double ticksPerMicro = this->ticksPerMicro();
+
+        FILE *out = std::fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        std::fprintf(out, "{\"traceEvents\":[\n");
+        bool first = true;
+        std::vector<Zone> copy;
+        for (const auto &ring : rings) {
+            std::fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}",
+                         first ? "" : ",\n", ring->thread, ring->name.c_str());
+            first = false;
+
+            // Copy, then drop whatever the owner may have overwritten meanwhile
+            uint64_t end = ring->head.load(std::memory_order_acquire);
+            uint64_t begin = end > RING_CAPACITY ? end - RING_CAPACITY : 0;
+            copy.clear();
+            for (uint64_t i = begin; i < end; i++) {
+                copy.push_back(ring->zones[i % RING_CAPACITY]);
+            }
+            uint64_t after = ring->head.load(std::memory_order_acquire);
+            uint64_t valid = after >= RING_CAPACITY ? after - RING_CAPACITY + 1 : 0;
+            for (uint64_t i = std::max(begin, valid); i < end; i++) {
+                const Zone &z = copy[i - begin];
+                std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}", z.name,
+                             (double)(int64_t)(z.start - originTicks) / ticksPerMicro,
+                             (double)(z.end - z.start) / ticksPerMicro, ring->thread);
+            }
+        }
+        for (const Marker &m : markers) {
+            std::fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"detail\":\"",
+                         m.name, (double)(int64_t)(m.time - originTicks) / ticksPerMicro, m.thread);
+            for (char c : m.detail) {
+                if (c == '"' || c == '\\') {
+                    std::fprintf(out, "\\%c", c);
+                } else if ((unsigned char)c < 0x20) {
+                    std::fprintf(out, "\\u%04x", c);
+                } else {
+                    std::fputc(c, out);
+                }
+            }
+            std::fprintf(out, "\"}}");
+        }
+        std::fprintf(out, "\n],\"displayTimeUnit\":\"ms\"}\n");
+        return std::fclose(out) == 0;
+    }
+};
+
+inline Profiler profiler;
+
+// Times its own lifetime as one zone, and is its thread's active zone meanwhile
+struct ProfileScope {
+    Profiler::Ring &ring;
+    const char *name, *parent;
+    uint64_t start;
+
+    explicit ProfileScope(const char *zoneName)
+        : ring(profiler.threadRing()), name(zoneName), parent(ring.active), start(profileTicks()) {
+        ring.active = name;
+    }
+
+    ~ProfileScope() {
+        ring.active = parent;
+        profiler.record(ring, name, start, profileTicks());
+    }
+};
+
+#define PROFILE_JOIN_(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_JOIN(profileScope, __LINE__)(name)
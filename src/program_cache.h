@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "shader_source.h"
+
+// On-disk cache of linked program binaries (ARB_get_program_binary). Entries are
+// keyed by the program's source hash, computed at build time for embedded shaders
+// (shader_source.h), mixed with a hash of the driver's vendor, renderer and version
+// strings taken once at setup, so a driver update or shader edit simply misses. A binary the
+// driver rejects is treated as a miss too and the caller compiles from source.
+struct ProgramCache {
+    std::string directory;
+    bool enabled = false;
+    std::string driver; // vendor, renderer and version, part of every key
+    uint64_t driverHash = 0;
+    int hits = 0, misses = 0;
+
+    // Needs a current context; does nothing without program binary support
+    void setup(const std::string &cacheDirectory) {
+        directory = cacheDirectory;
+        enabled = glExt.programBinary && !directory.empty();
+        if (!enabled) {
+            return;
+        }
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte *s = glGetString(name);
+            driver += s ? (const char *)s : "";
+            driver += '\n';
+        }
+        driverHash = fnv1a(driver.c_str());
+        std::error_code ec;
+        std::filesystem::create_directories(directory, ec);
+    }
+
+    // Entry of a program whose sources hash to sourceHash on this driver
+    uint64_t key(uint64_t sourceHash) const {
+        return hashMix(sourceHash, driverHash);
+    }
+
+    std::string pathOf(uint64_t k) const {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin", (unsigned long long)k);
+        return directory + "/" + name;
+    }
+
+    // Create a program from a cached binary; 0 on a miss or if the driver rejects it
+    GLuint load(uint64_t k) {
+        if (!enabled) {
+            return 0;
+        }
+        std::vector<unsigned char> data;
+        FILE *in = std::fopen(pathOf(k).c_str(), "rb");
+        if (in) {
+            std::fseek(in, 0, SEEK_END);
+            long size = std::ftell(in);
+            std::fseek(in, 0, SEEK_SET);
+            if (size > (long)sizeof(GLenum)) {
+                data.resize(size);
+                if (std::fread(data.data(), 1, size, in) != (size_t)size) {
+                    data.clear();
+                }
+            }
+            std::fclose(in);
+        }
+        if (data.empty()) {
+            misses++;
+            return 0;
+        }
+
+        GLenum format;
+        std::memcpy(&format, data.data(), sizeof(format));
+        GLuint program = glCreateProgram();
+        glExt.ProgramBinary(program, format, data.data() + sizeof(format), (GLsizei)(data.size() - sizeof(format)));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            glDeleteProgram(program);
+            misses++;
+            return 0;
+        }
+        hits++;
+        return program;
+    }
+
+    // Call on a program before linking it, so its binary can be retrieved afterwards
+    void prepare(GLuint program) const {
+        if (enabled) {
+            glExt.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+    }
+
+    // Write a freshly linked program's binary under the key
+    void store(uint64_t k, GLuint program) const {
+        if (!enabled) {
+            return;
+        }
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+        std::vector<unsigned char> data(sizeof(GLenum) + length);
+        GLenum format = 0;
+        GLsizei written = 0;
+        glExt.GetProgramBinary(program, length, &written, &format, data.data() + sizeof(GLenum));
+        std::memcpy(data.data(), &format, sizeof(format));
+        FILE *out = std::fopen(pathOf(k).c_str(), "wb");
+        if (out) {
+            std::fwrite(data.data(), 1, sizeof(GLenum) + written, out);
+            std::fclose(out);
+        }
+    }
+};
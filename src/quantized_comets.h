@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+
+// Compact lane-bound entities for the high-count stress modes, where the float
+// EntityPool spends most of each tick moving bytes. Per entity there is only a
+// 16-bit fixed-point height and fall per tick, an 8-bit lane and an 8-bit type: 6
+// bytes where the pool keeps eight floats. The horizontal centre follows from the
+// lane and the size from the type, so neither is stored. Motion and the collision
+// test run on the fixed-point values directly, eight (SSE2) or sixteen (AVX2)
+// heights per register, and floats are only rebuilt by placement() when instances
+// are extracted for drawing. Heights have 1/FIXED_ONE pixel steps and must stay
+// within +-2047 px.
+struct QuantizedComets {
+    static constexpr int FIXED_ONE = 16;
+
+    // Size shared by every entity of a type, in pixels
+    struct Type {
+        float width, height;
+    };
+
+    float laneWidth = 1.0f;
+    int16_t despawnY = 0, wrapSpan = 0; // a fixed-point height below despawnY moves up by wrapSpan
+    std::vector<Type> types;
+
+    std::vector<int16_t> y;     // fixed-point centre height
+    std::vector<int16_t> fall;  // fixed-point height change per tick
+    std::vector<int8_t> lane;
+    std::vector<uint8_t> type;
+
+    static int16_t toFixed(float pixels) {
+        return (int16_t)std::lround(pixels * FIXED_ONE);
+    }
+
+    static float toPixels(int32_t fixed) {
+        return (float)fixed / FIXED_ONE;
+    }
+
+    size_t size() const {
+        return y.size();
+    }
+
+    // Entities below despawn height reappear wrap pixels higher, as the stress
+    // scenario respawns them
+    void setup(float lanePitch, float despawn, float wrap, const std::vector<Type> &entityTypes) {
+        laneWidth = lanePitch;
+        despawnY = toFixed(despawn);
+        wrapSpan = toFixed(wrap);
+        types = entityTypes;
+    }
+
+    void reserve(size_t capacity) {
+        y.reserve(capacity);
+        fall.reserve(capacity);
+        lane.reserve(capacity);
+        type.reserve(capacity);
+    }
+
+    // Add an entity at height py moving vy pixels per second, ticking every step seconds
+    void create(float py, float vy, float step, int8_t entityLane, uint8_t entityType) {
+        y.push_back(toFixed(py));
+        fall.push_back(toFixed(vy * step));
+        lane.push_back(entityLane);
+        type.push_back(entityType);
+    }
+
+    float laneX(int l) const {
+        return laneWidth / 2 + l * laneWidth;
+    }
+
+    // Centre and size in pixels, for the instance data
+    glm::vec4 placement(uint32_t i) const {
+        const Type &t = types[type[i]];
+        return glm::vec4(laneX(lane[i]), toPixels(y[i]), t.width, t.height);
+    }
+
+    // Advance [begin, end) by one tick and wrap the ones that fell past despawn height
+    void move(uint32_t begin, uint32_t end) {
+        static const MoveFn impl = selectMove();
+        impl(*this, begin, end);
+    }
+
+    // Append to out every entity of [begin, end) in lanes [laneMin, laneMax] whose box
+    // overlaps the box centred at (px, py). SIMD tests lane and height against the
+    // largest type; the rare candidates are then checked exactly in floats.
+    void overlap(uint32_t begin, uint32_t end, int laneMin, int laneMax, float px, float py, float halfW, float halfH,
+                 std::vector<uint32_t> &out) const {
+        static const OverlapFn impl = selectOverlap();
+        float tallest = 0.0f;
+        for (const Type &t : types) {
+            tallest = std::max(tallest, t.height);
+        }
+        int16_t sy = toFixed(py), reach = (int16_t)std::ceil((halfH + tallest / 2) * FIXED_ONE);
+        size_t first = out.size();
+        impl(*this, begin, end, (int8_t)laneMin, (int8_t)laneMax, sy, reach, out);
+        size_t kept = first;
+        for (size_t c = first; c < out.size(); c++) {
+            uint32_t i = out[c];
+            const Type &t = types[type[i]];
+            if (std::fabs(laneX(lane[i]) - px) < halfW + t.width / 2 && std::fabs(toPixels(y[i]) - py) < halfH + t.height / 2) {
+                out[kept++] = i;
+            }
+        }
+        out.resize(kept);
+    }
+
+    typedef void (*MoveFn)(QuantizedComets &c, uint32_t begin, uint32_t end);
+    typedef void (*OverlapFn)(const QuantizedComets &c, uint32_t begin, uint32_t end, int8_t laneMin, int8_t laneMax,
+                              int16_t sy, int16_t reach, std::vector<uint32_t> &out);
+
+    static void moveScalar(QuantizedComets &c, uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            int16_t next = (int16_t)(c.y[i] + c.fall[i]);
+            c.y[i] = next < c.despawnY ? (int16_t)(next + c.wrapSpan) : next;
+        }
+    }
+
+    static void overlapScalar(const QuantizedComets &c, uint32_t begin, uint32_t end, int8_t laneMin, int8_t laneMax,
+                              int16_t sy, int16_t reach, std::vector<uint32_t> &out) {
+        for (uint32_t i = begin; i < end; i++) {
+            int d = c.y[i] - sy;
+            if (c.lane[i] >= laneMin && c.lane[i] <= laneMax && d < reach && d > -reach) {
+                out.push_back(i);
+            }
+        }
+    }
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    static void moveSse2(QuantizedComets &c, uint32_t begin, uint32_t end) {
+        const __m128i despawn = _mm_set1_epi16(c.despawnY), wrap = _mm_set1_epi16(c.wrapSpan);
+        int16_t *y = c.y.data();
+        const int16_t *fall = c.fall.data();
+        uint32_t i = begin;
+        for (; i + 8 <= end; i += 8) {
+            __m128i next = _mm_add_epi16(_mm_loadu_si128((const __m128i*)(y + i)), _mm_loadu_si128((const __m128i*)(fall + i)));
+            __m128i below = _mm_cmplt_epi16(next, despawn);
+            _mm_storeu_si128((__m128i*)(y + i), _mm_add_epi16(next, _mm_and_si128(below, wrap)));
+        }
+        moveScalar(c, i, end);
+    }
+
+    // Sixteen entities per step: two registers of heights, one of lanes, with the
+    // height masks narrowed to bytes so one movemask covers all sixteen
+    static void overlapSse2(const QuantizedComets &c, uint32_t begin, uint32_t end, int8_t laneMin, int8_t laneMax,
+                            int16_t sy, int16_t reach, std::vector<uint32_t> &out) {
+        const __m128i vy = _mm_set1_epi16(sy), above = _mm_set1_epi16(reach), below = _mm_set1_epi16((int16_t)-reach);
+        const __m128i lo = _mm_set1_epi8((char)(laneMin - 1)), hi = _mm_set1_epi8((char)(laneMax + 1));
+        const int16_t *y = c.y.data();
+        const int8_t *lane = c.lane.data();
+        uint32_t i = begin;
+        for (; i + 16 <= end; i += 16) {
+            __m128i d0 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(y + i)), vy);
+            __m128i d1 = _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(y + i + 8)), vy);
+            __m128i near0 = _mm_and_si128(_mm_cmplt_epi16(d0, above), _mm_cmpgt_epi16(d0, below));
+            __m128i near1 = _mm_and_si128(_mm_cmplt_epi16(d1, above), _mm_cmpgt_epi16(d1, below));
+            __m128i l = _mm_loadu_si128((const __m128i*)(lane + i));
+            __m128i inLane = _mm_and_si128(_mm_cmpgt_epi8(l, lo), _mm_cmplt_epi8(l, hi));
+            int mask = _mm_movemask_epi8(_mm_and_si128(_mm_packs_epi16(near0, near1), inLane));
+            while (mask) {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        overlapScalar(c, i, end, laneMin, laneMax, sy, reach, out);
+    }
+
+    __attribute__((target("avx2")))
+    static void moveAvx2(QuantizedComets &c, uint32_t begin, uint32_t end) {
+        const __m256i despawn = _mm256_set1_epi16(c.despawnY), wrap = _mm256_set1_epi16(c.wrapSpan);
+        int16_t *y = c.y.data();
+        const int16_t *fall = c.fall.data();
+        uint32_t i = begin;
+        for (; i + 16 <= end; i += 16) {
+            __m256i next = _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(y + i)),
+                                            _mm256_loadu_si256((const __m256i*)(fall + i)));
+            __m256i below = _mm256_cmpgt_epi16(despawn, next);
+            _mm256_storeu_si256((__m256i*)(y + i), _mm256_add_epi16(next, _mm256_and_si256(below, wrap)));
+        }
+        moveSse2(c, i, end);
+    }
+
+    // overlapSse2 at thirty-two entities per step; the pack interleaves 128-bit
+    // halves, so the result is permuted back into entity order
+    __attribute__((target("avx2")))
+    static void overlapAvx2(const QuantizedComets &c, uint32_t begin, uint32_t end, int8_t laneMin, int8_t laneMax,
+                            int16_t sy, int16_t reach, std::vector<uint32_t> &out) {
+        const __m256i vy = _mm256_set1_epi16(sy), above = _mm256_set1_epi16(reach), below = _mm256_set1_epi16((int16_t)-reach);
+        const __m256i lo = _mm256_set1_epi8((char)(laneMin - 1)), hi = _mm256_set1_epi8((char)(laneMax + 1));
+        const int16_t *y = c.y.data();
+        const int8_t *lane = c.lane.data();
+        uint32_t i = begin;
+        for (; i + 32 <= end; i += 32) {
+            __m256i d0 = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(y + i)), vy);
+            __m256i d1 = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(y + i + 16)), vy);
+            __m256i near0 = _mm256_and_si256(_mm256_cmpgt_epi16(above, d0), _mm256_cmpgt_epi16(d0, below));
+            __m256i near1 = _mm256_and_si256(_mm256_cmpgt_epi16(above, d1), _mm256_cmpgt_epi16(d1, below));
+            __m256i near = _mm256_permute4x64_epi64(_mm256_packs_epi16(near0, near1), 0xD8);
+            __m256i l = _mm256_loadu_si256((const __m256i*)(lane + i));
+            __m256i inLane = _mm256_and_si256(_mm256_cmpgt_epi8(l, lo), _mm256_cmpgt_epi8(hi, l));
+            uint32_t mask = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(near, inLane));
+            while (mask) {
+                out.push_back(i + __builtin_ctz(mask));
+                mask &= mask - 1;
+            }
+        }
+        overlapSse2(c, i, end, laneMin, laneMax, sy, reach, out);
+    }
+#endif
+
+    static MoveFn selectMove() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        if (__builtin_cpu_supports("avx2")) {
+            return moveAvx2;
+        }
+        return moveSse2;
+#else
+        return moveScalar;
+#endif
+    }
+
+    static OverlapFn selectOverlap() {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+        if (__builtin_cpu_supports("avx2")) {
+            return overlapAvx2;
+        }
+        return overlapSse2;
+#else
+        return overlapScalar;
+#endif
+    }
+};
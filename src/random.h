@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// PCG32 (O'Neill): 64-bit LCG state with a permuted 32-bit output. The increment
+// selects one of 2^63 independent streams, so every thread or job can own its own
+// generator derived from a single seed and runs stay reproducible from that seed.
+// For results that do not depend on scheduling, key streams by job or chunk index
+// rather than by whichever worker happens to run it.
+struct Pcg32 {
+    uint64_t state = 0x853C49E6748FEA9Bull;
+    uint64_t inc = 0xDA3E39CB94B95BDBull; // always odd
+
+    Pcg32() = default;
+
+    Pcg32(uint64_t seed, uint64_t stream) {
+        this->seed(seed, stream);
+    }
+
+    void seed(uint64_t seed, uint64_t stream) {
+        state = 0;
+        inc = (stream << 1) | 1;
+        next();
+        state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        uint64_t old = state;
+        state = old * 6364136223846793005ull + inc;
+        uint32_t xorshifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+        uint32_t rot = (uint32_t)(old >> 59);
+        return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+    }
+
+    // Uniform in [0, bound), by multiply-shift range reduction
+    static uint32_t below(uint32_t raw, uint32_t bound) {
+        return (uint32_t)(((uint64_t)raw * bound) >> 32);
+    }
+
+    uint32_t nextBelow(uint32_t bound) {
+        return below(next(), bound);
+    }
+
+    // Uniform in [0, 1)
+    float nextFloat() {
+        return (next() >> 8) * (1.0f / 16777216.0f);
+    }
+
+    // Fill out with count raw values in one tight loop
+    void fill(uint32_t *out, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = next();
+        }
+    }
+
+    // Fill out with count values in [0, bound)
+    void fillBelow(uint32_t *out, size_t count, uint32_t bound) {
+        for (size_t i = 0; i < count; i++) {
+            out[i] = below(next(), bound);
+        }
+    }
+};
+
+// Stream indices handed out from one seed; each subsystem or job draws from its own
+enum RandomStream : uint64_t {
+    STREAM_SPAWN,
+    STREAM_WORKERS, // first of the per-job streams
+    STREAM_AUTOPILOT = 1ull << 62, // the PGO training bot's mistakes; far above any job's stream
+    STREAM_STRESS                  // the stress benchmark's extra comets
+};
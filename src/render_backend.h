@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstdint>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include "gl_call_stats.h"
+#include "gl_debug_log.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+
+// The state a draw runs under: its program and the fixed-function state that goes
+// with it, set together so a pass states everything it relies on
+struct Pipeline {
+    GLuint program = 0;
+    bool depthTest = false;
+    bool depthWrite = true;
+    bool blend = false; // premultiplied alpha, the one blend function the game uses
+};
+
+// The graphics API seen as the handful of things a frame is made of: buffers,
+// textures, pipelines, draw submission, and beginning, ending and presenting a frame.
+// GlBackend goes through gl_objects.h, so it picks direct state access or
+// bind-to-edit itself, and through glState, so redundant state changes are still
+// skipped; objects it creates are registered with memoryStats and dropped on
+// destroy. Passes written against it (the comet field, the frame loop) carry no GL
+// of their own. Passes built on GL-only machinery (transform feedback particles,
+// bindless sprite batches, the render graph's framebuffers) still call GL directly.
+//
+// Another API would be another struct with the same members, chosen by the
+// RenderBackend alias at build time, so calls stay direct and inlinable rather than
+// going through a table of virtual functions on every draw.
+struct GlBackend {
+    // A buffer of size bytes, filled from data unless it is nullptr
+    GLuint createBuffer(GLenum target, GLsizeiptr size, const void *data, GLenum usage) {
+        GLuint buffer = ::createBuffer(target, size, data, usage);
+        memoryStats.trackGl(GL_BUFFER, buffer, MEM_BUFFERS, size);
+        return buffer;
+    }
+
+    void updateBuffer(GLenum target, GLuint buffer, GLintptr offset, GLsizeiptr size, const void *data) {
+        bufferSubData(target, buffer, offset, size, data);
+    }
+
+    void destroyBuffer(GLuint &buffer) {
+        memoryStats.untrackGl(GL_BUFFER, buffer);
+        glState.deleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+
+    // A vertex array; a buffer's layout in it is set with vertexAttrib()
+    GLuint createVertexArray() {
+        GLuint array = ::createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, array, MEM_BUFFERS, 0);
+        return array;
+    }
+
+    void destroyVertexArray(GLuint &array) {
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, array);
+        glState.deleteVertexArrays(1, &array);
+        array = 0;
+    }
+
+    // An immutable 2D texture of levels mip levels, contents undefined
+    GLuint createTexture(GLsizei levels, GLenum format, GLsizei width, GLsizei height, int bytesPerTexel,
+                         MemoryTag tag = MEM_TEXTURES) {
+        GLuint texture = createTexture2D();
+        textureStorage2D(texture, levels, format, width, height);
+        memoryStats.trackGl(GL_TEXTURE, texture, tag, textureBytes(width, height, bytesPerTexel, levels));
+        return texture;
+    }
+
+    // Replace one whole level from RGBA8 pixels
+    void uploadTexture(GLuint texture, GLint level, GLsizei width, GLsizei height, const void *rgba) {
+        textureSubImage2D(texture, level, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    }
+
+    void destroyTexture(GLuint &texture) {
+        memoryStats.untrackGl(GL_TEXTURE, texture);
+        glState.deleteTextures(1, &texture);
+        texture = 0;
+    }
+
+    void bindPipeline(const Pipeline &pipeline) {
+        glState.useProgram(pipeline.program);
+        glState.set(GL_DEPTH_TEST, pipeline.depthTest);
+        glState.depthMask(pipeline.depthWrite);
+        glState.set(GL_BLEND, pipeline.blend);
+    }
+
+    // instances copies of count vertices from first, as a triangle strip, sampling
+    // texture through sampler on unit 0
+    void draw(GLuint vertexArray, GLuint texture, GLuint sampler, GLenum textureTarget, GLint first, GLsizei count,
+              GLsizei instances) {
+        glState.bindVertexArray(vertexArray);
+        glState.bindTexture(0, texture, textureTarget);
+        glState.bindSampler(0, sampler);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, first, count, instances);
+    }
+
+    // The same, with the strip and instance count read from a DrawArraysIndirectCommand
+    // at the start of commands, which the GPU may have written
+    void drawIndirect(GLuint vertexArray, GLuint texture, GLuint sampler, GLenum textureTarget, GLuint commands) {
+        glState.bindVertexArray(vertexArray);
+        glState.bindTexture(0, texture, textureTarget);
+        glState.bindSampler(0, sampler);
+        glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commands);
+        glDrawArraysIndirect(GL_TRIANGLE_STRIP, nullptr);
+    }
+
+    // The points a transform feedback object last captured, as many as it captured
+    void drawCaptured(GLuint vertexArray, GLuint texture, GLuint sampler, GLenum textureTarget, GLuint feedback) {
+        glState.bindVertexArray(vertexArray);
+        glState.bindTexture(0, texture, textureTarget);
+        glState.bindSampler(0, sampler);
+        glDrawTransformFeedback(GL_POINTS, feedback);
+    }
+
+    // Clear the bound target's colour and depth to start the scene
+    void beginFrame() {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Close the frame's GL call, driver warning and state change counts
+    void endFrame() {
+        glCalls.endFrame();
+        glDebugLog.endFrame();
+        glState.endFrame();
+    }
+
+    void present(GLFWwindow *window) {
+        glfwSwapBuffers(window);
+    }
+};
+
+using RenderBackend = GlBackend;
+
+inline RenderBackend renderBackend;
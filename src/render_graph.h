@@ -0,0 +1,367 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <initializer_list>
+#include <glad/glad.h>
+#include "frame_histogram.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "small_function.h"
+
+// The offscreen passes between the scene and the window, declared afresh every
+// frame: the targets they use (transient ones by size and format, or framebuffers
+// the caller owns, imported) and which of them each pass reads and writes. compile()
+// keeps only the passes an imported target depends on, orders them so every pass
+// runs after the writers of what it reads, and gives each transient target a
+// texture, shared between targets of the same size and format whose lifetimes do
+// not overlap. The textures outlive the frame: a graph declared the same way every
+// frame gets the same ones back and allocates nothing, and one no compile asks for
+// any more (after a resize, say) is deleted. execute() runs the passes in order,
+// each bracketed by GPU timestamps that are read back a few frames later, and each
+// a profiler zone and GPU debug group of its name (gl_markers.h).
+struct RenderGraph {
+    static const int MAX_TARGETS = 16, MAX_PASSES = 16, MAX_IO = 4;
+    static const int QUERY_RING = 4;
+
+    struct TargetDesc {
+        GLenum format;
+        int width, height;
+
+        bool operator==(const TargetDesc &o) const {
+            return format == o.format && width == o.width && height == o.height;
+        }
+    };
+
+    struct Target {
+        const char *name;
+        TargetDesc desc;
+        bool imported;
+        GLuint framebuffer; // imported: the caller's; transient: its texture's, once compiled
+        GLuint texture;     // 0 for an imported framebuffer that cannot be sampled
+        int writer;         // the one pass that writes it, -1 if none does
+        int first, last;    // positions in the order of its writer and last reader
+    };
+
+    using Execute = SmallFunction<void(RenderGraph &), 32>;
+
+    struct Pass {
+        const char *name;
+        int reads[MAX_IO], writes[MAX_IO];
+        int readCount, writeCount;
+        Execute execute;
+        bool live;
+    };
+
+    // A texture and framebuffer that transient targets are given in turn
+    struct Physical {
+        TargetDesc desc;
+        GLuint texture, framebuffer;
+        int busyUntil; // position of the last pass using it this frame
+        bool used;
+    };
+
+    Target targets[MAX_TARGETS];
+    int targetCount = 0;
+    Pass passes[MAX_PASSES];
+    int passCount = 0;
+    int order[MAX_PASSES]; // live passes, in the order execute() runs them
+    int orderCount = 0;
+    Physical physicals[MAX_TARGETS];
+    int physicalCount = 0;
+    int64_t bytes = 0, unaliasedBytes = 0; // of the transient textures, shared and as if none were
+
+    GLuint queries[QUERY_RING][MAX_PASSES + 1] = {}; // GL_TIMESTAMP before each pass and after the last
+    int timedPasses[QUERY_RING][MAX_PASSES] = {};     // which declared pass each stamp opened
+    int timedCount[QUERY_RING] = {};
+    bool queued[QUERY_RING] = {};
+    unsigned long long frame = 0;
+    double gpuMs[MAX_PASSES] = {}; // by declaration index, of the latest measured frame
+    FrameHistogram histograms[MAX_PASSES];
+    const char *timedNames[MAX_PASSES] = {};
+
+    void setup() {
+        glGenQueries(QUERY_RING * (MAX_PASSES + 1), &queries[0][0]);
+    }
+
+    // Forget last frame's declarations; the textures stay for compile() to hand out again
+    void reset() {
+        for (int p = 0; p < passCount; p++) {
+            passes[p].execute.reset();
+        }
+        targetCount = passCount = orderCount = 0;
+    }
+
+    // A target the graph allocates; it lives from its writer to its last reader
+    int create(const char *name, const TargetDesc &desc) {
+        return addTarget({name, desc, false, 0, 0, -1, -1, -1});
+    }
+
+    // A framebuffer the caller keeps, and its colour texture if passes sample it;
+    // passes writing one always run
+    int import(const char *name, GLuint framebuffer, GLuint texture = 0, const TargetDesc &desc = {GL_RGBA8, 0, 0}) {
+        return addTarget({name, desc, true, framebuffer, texture, -1, -1, -1});
+    }
+
+    int addTarget(const Target &target) {
+        if (targetCount == MAX_TARGETS) {
+            fprintf(stderr, "RenderGraph: more than %d targets\n", MAX_TARGETS);
+            return -1;
+        }
+        targets[targetCount] = target;
+        return targetCount++;
+    }
+
+    int pass(const char *name, std::initializer_list<int> reads, std::initializer_list<int> writes, Execute execute) {
+        if (passCount == MAX_PASSES || reads.size() > (size_t)MAX_IO || writes.size() > (size_t)MAX_IO) {
+            fprintf(stderr, "RenderGraph: pass %s does not fit\n", name);
+            return -1;
+        }
+        Pass &p = passes[passCount];
+        p.name = name;
+        p.readCount = (int)reads.size();
+        p.writeCount = (int)writes.size();
+        std::copy(reads.begin(), reads.end(), p.reads);
+        std::copy(writes.begin(), writes.end(), p.writes);
+        p.execute = std::move(execute);
+        p.live = false;
+        for (int t : writes) {
+            if (targets[t].writer >= 0 && !targets[t].imported) {
+                fprintf(stderr, "RenderGraph: %s is written by both %s and %s\n", targets[t].name, passes[targets[t].writer].name, name);
+            }
+            targets[t].writer = passCount;
+        }
+        return passCount++;
+    }
+
+    GLuint texture(int target) const {
+        return targets[target].texture;
+    }
+
+    GLuint framebuffer(int target) const {
+        return targets[target].framebuffer;
+    }
+
+    const TargetDesc &desc(int target) const {
+        return targets[target].desc;
+    }
+
+    // Cull, order, and hand the transient targets their textures
+    void compile() {
+        // Everything an imported target's writers read, transitively
+        int stack[MAX_PASSES * MAX_IO + MAX_TARGETS];
+        int depth = 0;
+        for (int t = 0; t < targetCount; t++) {
+            if (targets[t].imported && targets[t].writer >= 0) {
+                stack[depth++] = targets[t].writer;
+            }
+        }
+        while (depth > 0) {
+            Pass &p = passes[stack[--depth]];
+            if (p.live) {
+                continue;
+            }
+            p.live = true;
+            for (int i = 0; i < p.readCount; i++) {
+                if (targets[p.reads[i]].writer >= 0) {
+                    stack[depth++] = targets[p.reads[i]].writer;
+                }
+            }
+        }
+
+        // Live passes once their inputs' writers have run, earliest declared first
+        bool scheduled[MAX_PASSES] = {};
+        int position[MAX_PASSES];
+        for (bool progress = true; progress;) {
+            progress = false;
+            for (int p = 0; p < passCount; p++) {
+                if (!passes[p].live || scheduled[p] || !ready(p, scheduled)) {
+                    continue;
+                }
+                scheduled[p] = true;
+                position[p] = orderCount;
+                order[orderCount++] = p;
+                progress = true;
+                break;
+            }
+        }
+
+        // Lifetimes, then textures in order of first use
+        for (int t = 0; t < targetCount; t++) {
+            Target &target = targets[t];
+            target.first = target.writer >= 0 && passes[target.writer].live ? position[target.writer] : -1;
+            target.last = target.first;
+        }
+        for (int i = 0; i < orderCount; i++) {
+            const Pass &p = passes[order[i]];
+            for (int r = 0; r < p.readCount; r++) {
+                targets[p.reads[r]].last = std::max(targets[p.reads[r]].last, i);
+            }
+        }
+        for (int i = 0; i < physicalCount; i++) {
+            physicals[i].busyUntil = -1;
+            physicals[i].used = false;
+        }
+        bytes = unaliasedBytes = 0;
+        for (int i = 0; i < orderCount; i++) {
+            for (int t = 0; t < targetCount; t++) {
+                if (!targets[t].imported && targets[t].first == i) {
+                    assign(targets[t]);
+                }
+            }
+        }
+        for (int i = physicalCount - 1; i >= 0; i--) {
+            if (!physicals[i].used) {
+                release(physicals[i]);
+                physicals[i] = physicals[--physicalCount];
+            }
+        }
+    }
+
+    bool ready(int p, const bool *scheduled) const {
+        for (int i = 0; i < passes[p].readCount; i++) {
+            int writer = targets[passes[p].reads[i]].writer;
+            if (writer >= 0 && writer != p && !scheduled[writer]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // A free texture of the target's size and format, or a new one
+    void assign(Target &target) {
+        int64_t size = textureBytes(target.desc.width, target.desc.height, formatBytes(target.desc.format));
+        unaliasedBytes += size;
+        int found = -1;
+        for (int i = 0; i < physicalCount && found < 0; i++) {
+            if (physicals[i].desc == target.desc && physicals[i].busyUntil < target.first) {
+                found = i;
+            }
+        }
+        if (found < 0) {
+            if (physicalCount == MAX_TARGETS) {
+                fprintf(stderr, "RenderGraph: more than %d textures\n", MAX_TARGETS);
+                return;
+            }
+            found = physicalCount++;
+            Physical &p = physicals[found];
+            p.desc = target.desc;
+            p.texture = createTexture2D();
+            textureStorage2D(p.texture, 1, p.desc.format, p.desc.width, p.desc.height);
+            memoryStats.trackGl(GL_TEXTURE, p.texture, MEM_RENDER_TARGETS, size);
+            glGenFramebuffers(1, &p.framebuffer);
+            glState.bindFramebuffer(GL_FRAMEBUFFER, p.framebuffer);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, p.texture, 0);
+            glState.bindFramebuffer(GL_FRAMEBUFFER, 0);
+            glMarkers.label(GL_TEXTURE, p.texture, target.name); // the target it was made for; others may share it
+            glMarkers.label(GL_FRAMEBUFFER, p.framebuffer, target.name);
+        }
+        Physical &p = physicals[found];
+        if (!p.used) {
+            bytes += size;
+        }
+        p.used = true;
+        p.busyUntil = target.last;
+        target.texture = p.texture;
+        target.framebuffer = p.framebuffer;
+    }
+
+    static int formatBytes(GLenum format) {
+        switch (format) {
+        case GL_RGBA16F:
+        case GL_RG32F:
+            return 8;
+        case GL_RGBA32F:
+            return 16;
+        default:
+            return 4; // RGBA8, R11F_G11F_B10F, RGB10_A2, R32F...
+        }
+    }
+
+    // Run the live passes in order, timing each
+    void execute() {
+        collect();
+        const int slot = (int)(frame % QUERY_RING);
+        for (int i = 0; i < orderCount; i++) {
+            glQueryCounter(queries[slot][i], GL_TIMESTAMP);
+            timedPasses[slot][i] = order[i];
+            GpuZone zone(passes[order[i]].name);
+            passes[order[i]].execute(*this);
+        }
+        if (orderCount > 0) {
+            glQueryCounter(queries[slot][orderCount], GL_TIMESTAMP);
+            timedCount[slot] = orderCount;
+            queued[slot] = true;
+        }
+        frame++;
+    }
+
+    // Read back every frame whose timestamps have landed; never waits
+    void collect() {
+        for (int i = 0; i < QUERY_RING; i++) {
+            if (!queued[i]) {
+                continue;
+            }
+            const int count = timedCount[i];
+            GLuint available = 0;
+            glGetQueryObjectuiv(queries[i][count], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available) {
+                if (i == (int)(frame % QUERY_RING)) {
+                    queued[i] = false; // still not back after QUERY_RING frames: drop it rather than wait
+                }
+                continue;
+            }
+            GLuint64 stamps[MAX_PASSES + 1];
+            for (int s = 0; s <= count; s++) {
+                glGetQueryObjectui64v(queries[i][s], GL_QUERY_RESULT, &stamps[s]);
+            }
+            for (int s = 0; s < count; s++) {
+                int p = timedPasses[i][s];
+                gpuMs[p] = (stamps[s + 1] - stamps[s]) / 1.0e6;
+                histograms[p].record(gpuMs[p]);
+                timedNames[p] = passes[p].name;
+            }
+            queued[i] = false;
+        }
+    }
+
+    // Print p50/p99/max of each pass's GPU time, by the pass declared at that index
+    void printSummary() const {
+        bool any = false;
+        for (int p = 0; p < MAX_PASSES; p++) {
+            if (histograms[p].count == 0) {
+                continue;
+            }
+            if (!any) {
+                printf("render passes, gpu ms\n");
+                printf("                        p50      p99      max\n");
+                any = true;
+            }
+            printf("%-20s %8.3f %8.3f %8.3f\n", timedNames[p], histograms[p].percentile(0.5), histograms[p].percentile(0.99),
+                   histograms[p].maxMs);
+        }
+        if (any) {
+            printf("transient targets: %.1f MB, %.1f MB without aliasing\n", bytes / 1048576.0, unaliasedBytes / 1048576.0);
+        }
+    }
+
+    static void release(Physical &p) {
+        memoryStats.untrackGl(GL_TEXTURE, p.texture);
+        glState.deleteTextures(1, &p.texture);
+        glState.deleteFramebuffers(1, &p.framebuffer);
+        p.texture = p.framebuffer = 0;
+    }
+
+    // Delete every texture and query; must run while the context is still current
+    void release() {
+        reset();
+        for (int i = 0; i < physicalCount; i++) {
+            release(physicals[i]);
+        }
+        physicalCount = 0;
+        glDeleteQueries(QUERY_RING * (MAX_PASSES + 1), &queries[0][0]);
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <GLFW/glfw3.h>
+#include "input_script.h"
+#include "mapped_file.h"
+
+// Where a keyframe of the simulation sits in a replay: the state just before tick
+// runs, the first input event at or after that tick, and the blob's place in the file
+struct ReplayKeyframe {
+    uint64_t tick;
+    uint64_t offset; // from the start of the file; from the start of keyframeData while recording
+    uint32_t size;
+    uint32_t event;
+};
+
+// Everything needed to play a session again tick for tick: the spawn seed, the
+// simulation rate, how many ticks it ran and the key presses with the tick that
+// applied each one, optionally the state hash after every tick, and keyframes of
+// the whole simulation every keyframeInterval ticks to seek by. Binary,
+// little-endian:
+//
+//   "STRP" u8 version  u64 seed  u32 simRate*1000  u64 ticks  u32 events
+//   per event: varint ticks since the previous event, u8 key (0 LEFT, 1 RIGHT)
+//   version 2: u32 hashes, then a u32 StateHash per tick from the first
+//   version 3: u32 keyframeInterval, the keyframe blobs each 8-byte aligned, the
+//              ReplayKeyframe index in tick order, then a footer of u32 keyframes,
+//              u32 0, u64 index offset, "STRK"
+//   version 4: u32 settings after simRate*1000, the GameSettings fingerprint
+//
+// A typical event is two bytes, so even long sessions stay a few kilobytes; hashes
+// add four bytes a tick, which is why they are only recorded with --state-hash.
+// Keyframes are whatever the game captured (opaque here). A loaded replay stays
+// mapped: the index and the blobs are read in place, so finding the keyframe before
+// a tick is a binary search and restoring it touches only its own pages. Versions 1
+// to 3 still load, without hashes, keyframes or the settings fingerprint respectively.
+struct ReplayFile {
+    static const uint8_t VERSION = 4;
+    static const size_t FOOTER_SIZE = 20;
+
+    uint64_t seed = 0;
+    float simRate = 0.0f;
+    uint32_t settings = 0; // GameSettings::fingerprint() of the session; 0 before version 4
+    uint64_t ticks = 0;
+    InputScript input;
+    std::vector<uint32_t> hashes; // state after tick i, or empty
+    uint32_t keyframeInterval = 0; // ticks between keyframes; 0 if there are none
+
+    // Recording: blobs back to back in keyframeData, entries in tick order
+    std::vector<uint8_t> keyframeData;
+    std::vector<ReplayKeyframe> recordedKeyframes;
+
+    // Playback: the mapped file and its index
+    MappedFile file;
+    const ReplayKeyframe *keyframes = nullptr;
+    uint32_t keyframeCount = 0;
+
+    ReplayFile() = default;
+    ReplayFile(const ReplayFile &) = delete;
+    ReplayFile &operator=(const ReplayFile &) = delete;
+
+    // Recording: append a keyframe of the state before tick, event being the index of
+    // the first input event at or after it
+    void addKeyframe(uint64_t tick, uint32_t event, const uint8_t *blob, size_t size) {
+        recordedKeyframes.push_back({tick, keyframeData.size(), (uint32_t)size, event});
+        keyframeData.insert(keyframeData.end(), blob, blob + size);
+        keyframeData.resize((keyframeData.size() + 7) & ~(size_t)7);
+    }
+
+    bool save(const std::string &path) const {
+        std::vector<uint8_t> out;
+        out.insert(out.end(), {'S', 'T', 'R', 'P', VERSION});
+        putFixed(out, seed, 8);
+        putFixed(out, (uint64_t)(simRate * 1000.0f + 0.5f), 4);
+        putFixed(out, settings, 4);
+        putFixed(out, ticks, 8);
+        putFixed(out, input.events.size(), 4);
+        uint64_t previous = 0;
+        for (const InputScript::Event &e : input.events) {
+            putVarint(out, e.tick - previous);
+            out.push_back(e.key == GLFW_KEY_RIGHT ? 1 : 0);
+            previous = e.tick;
+        }
+        putFixed(out, hashes.size(), 4);
+        for (uint32_t hash : hashes) {
+            putFixed(out, hash, 4);
+        }
+        putFixed(out, keyframeInterval, 4);
+        out.resize((out.size() + 7) & ~(size_t)7);
+        uint64_t blobs = out.size();
+        out.insert(out.end(), keyframeData.begin(), keyframeData.end());
+        uint64_t indexOffset = out.size();
+        for (ReplayKeyframe k : recordedKeyframes) {
+            k.offset += blobs;
+            const uint8_t *bytes = (const uint8_t *)&k;
+            out.insert(out.end(), bytes, bytes + sizeof(k));
+        }
+        putFixed(out, recordedKeyframes.size(), 4);
+        putFixed(out, 0, 4);
+        putFixed(out, indexOffset, 8);
+        out.insert(out.end(), {'S', 'T', 'R', 'K'});
+
+        FILE *file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        bool written = std::fwrite(out.data(), 1, out.size(), file) == out.size();
+        return std::fclose(file) == 0 && written;
+    }
+
+    // False if the file is unreadable, truncated or not a replay of a known version
+    bool load(const std::string &path) {
+        input.events.clear();
+        hashes.clear();
+        keyframes = nullptr;
+        keyframeCount = keyframeInterval = 0;
+        if (!file.open(path)) {
+            return false;
+        }
+        const uint8_t *p = file.data, *end = file.data + file.size;
+        uint64_t rate = 0, fingerprint = 0, count = 0, interval = 0;
+        int version = 0;
+        bool ok = end - p >= 5 && memcmp(p, "STRP", 4) == 0 && (version = p[4]) >= 1 && version <= VERSION;
+        p += 5;
+        ok = ok && getFixed(p, end, seed, 8) && getFixed(p, end, rate, 4) &&
+             (version < 4 || getFixed(p, end, fingerprint, 4)) && getFixed(p, end, ticks, 8) && getFixed(p, end, count, 4);
+        simRate = rate / 1000.0f;
+        settings = (uint32_t)fingerprint;
+        uint64_t tick = 0;
+        for (uint64_t i = 0; ok && i < count; i++) {
+            uint64_t delta;
+            ok = getVarint(p, end, delta) && p < end && *p <= 1;
+            tick += delta;
+            if (ok) {
+                input.events.push_back({tick, *p++ == 1 ? GLFW_KEY_RIGHT : GLFW_KEY_LEFT});
+            }
+        }
+        if (ok && version >= 2) {
+            ok = getFixed(p, end, count, 4) && (uint64_t)(end - p) >= count * 4;
+            for (uint64_t i = 0, hash; ok && i < count; i++) {
+                getFixed(p, end, hash, 4);
+                hashes.push_back((uint32_t)hash);
+            }
+        }
+        if (ok && version >= 3) {
+            ok = getFixed(p, end, interval, 4) && openIndex();
+            keyframeInterval = (uint32_t)interval;
+        }
+        return ok;
+    }
+
+    // Point keyframes at the mapped index the footer names; false if it is malformed
+    bool openIndex() {
+        if (file.size < FOOTER_SIZE || memcmp(file.data + file.size - 4, "STRK", 4) != 0) {
+            return false;
+        }
+        const uint8_t *footer = file.data + file.size - FOOTER_SIZE, *end = file.data + file.size;
+        uint64_t count = 0, reserved = 0, offset = 0;
+        getFixed(footer, end, count, 4);
+        getFixed(footer, end, reserved, 4);
+        getFixed(footer, end, offset, 8);
+        // Subtractions only: the file's u64s could make a sum wrap past the checks
+        uint64_t indexEnd = file.size - FOOTER_SIZE;
+        if (offset % 8 != 0 || offset > indexEnd || count > indexEnd / sizeof(ReplayKeyframe) ||
+            indexEnd - offset != count * sizeof(ReplayKeyframe)) {
+            return false;
+        }
+        keyframes = (const ReplayKeyframe *)(file.data + offset);
+        keyframeCount = (uint32_t)count;
+        for (uint32_t i = 0; i < keyframeCount; i++) {
+            const ReplayKeyframe &k = keyframes[i];
+            if (k.size > offset || k.offset > offset - k.size || (i > 0 && k.tick <= keyframes[i - 1].tick) ||
+                k.event > input.events.size()) {
+                keyframes = nullptr;
+                keyframeCount = 0;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // The last keyframe at or before tick, or nullptr if the replay has none that early
+    const ReplayKeyframe *keyframeBefore(uint64_t tick) const {
+        const ReplayKeyframe *end = keyframes + keyframeCount;
+        const ReplayKeyframe *after =
+            std::upper_bound(keyframes, end, tick, [](uint64_t t, const ReplayKeyframe &k) { return t < k.tick; });
+        return after == keyframes ? nullptr : after - 1;
+    }
+
+    const uint8_t *keyframeBlob(const ReplayKeyframe &k) const {
+        return file.data + k.offset;
+    }
+
+    static void putFixed(std::vector<uint8_t> &out, uint64_t value, int bytes) {
+        for (int i = 0; i < bytes; i++) {
+            out.push_back((uint8_t)(value >> (8 * i) & 0xFF));
+        }
+    }
+
+    static bool getFixed(const uint8_t *&p, const uint8_t *end, uint64_t &value, int bytes) {
+        value = 0;
+        if (end - p < bytes) {
+            return false;
+        }
+        for (int i = 0; i < bytes; i++) {
+            value |= (uint64_t)*p++ << (8 * i);
+        }
+        return true;
+    }
+
+    // LEB128: seven bits per byte, high bit set on all but the last
+    static void putVarint(std::vector<uint8_t> &out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((uint8_t)((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((uint8_t)value);
+    }
+
+    static bool getVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+        value = 0;
+        for (int shift = 0; shift < 64 && p < end; shift += 7) {
+            uint8_t c = *p++;
+            value |= (uint64_t)(c & 0x7F) << shift;
+            if (!(c & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <glad/glad.h>
+#include "gl_state.h"
+
+// Whether a texture gets a mip chain. Mips cost a third more memory plus the
+// generation pass, so they are only worth it for assets a mipmapped filter samples.
+enum MipPolicy {
+    MIPS_NONE,     // level 0 only
+    MIPS_GENERATE  // full chain from glGenerateMipmap
+};
+
+// How a texture is filtered and addressed when sampled
+struct SamplerState {
+    GLenum minFilter = GL_NEAREST;
+    GLenum magFilter = GL_NEAREST;
+    GLenum wrap = GL_CLAMP_TO_EDGE; // both S and T
+
+    bool operator==(const SamplerState &o) const {
+        return minFilter == o.minFilter && magFilter == o.magFilter && wrap == o.wrap;
+    }
+};
+
+// True if the minification filter reads levels below 0
+inline bool usesMips(GLenum minFilter) {
+    return minFilter != GL_NEAREST && minFilter != GL_LINEAR;
+}
+
+// The policy a texture needs to be sampled with the given state
+inline MipPolicy mipPolicyFor(const SamplerState &state) {
+    return usesMips(state.minFilter) ? MIPS_GENERATE : MIPS_NONE;
+}
+
+// Sampler objects (GL 3.3) shared by every use with the same state. Binding one over
+// a texture unit overrides the texture's own parameters, so filtering is chosen per
+// draw rather than baked into the texture and one atlas can be sampled several ways.
+struct SamplerCache {
+    struct Entry {
+        SamplerState state;
+        GLuint sampler;
+    };
+
+    std::vector<Entry> entries;
+
+    // The sampler for a state, created on first use; setup code only
+    GLuint get(const SamplerState &state) {
+        for (const Entry &e : entries) {
+            if (e.state == state) {
+                return e.sampler;
+            }
+        }
+        GLuint sampler;
+        glGenSamplers(1, &sampler);
+        glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, state.minFilter);
+        glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, state.magFilter);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, state.wrap);
+        glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, state.wrap);
+        entries.push_back({state, sampler});
+        return sampler;
+    }
+
+    // Delete every sampler; must run while the context is still current
+    void release() {
+        for (const Entry &e : entries) {
+            glState.deleteSamplers(1, &e.sampler);
+        }
+        entries.clear();
+    }
+};
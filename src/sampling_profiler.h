@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "allocation_guard.h"
+#include "thread_config.h"
+#include "thread_stacks.h"
+#ifndef _WIN32
+#include <cxxabi.h>
+#include <dlfcn.h>
+#endif
+
+// Statistical profiler for what the zones do not cover: a thread of its own reads
+// the stacks of the named threads (by default the render and simulation threads)
+// rate times a second through ThreadStacks, and counts each distinct stack. At exit
+// the counts are written in the folded format flamegraph.pl, speedscope and
+// Perfetto read, one "thread;outermost;...;innermost count" line per stack. Frames
+// are named by symbol where the binary exports one (a build linked with -rdynamic)
+// and as module+offset, of the function's start where the unwind tables give it,
+// otherwise. It samples wall time: a thread blocked in a wait shows the wait.
+//
+// Each sample stops a thread for one unwind, a few microseconds, and nothing is
+// allocated while it is stopped, so the thread may be anywhere, the allocator
+// included. The time the threads spent stopped is reported at exit as a share of
+// theirs; at 1 kHz it stays well under 1%.
+struct SamplingProfiler {
+    static const int STACK_DEPTH = ThreadStacks::MAX_DEPTH;
+    static constexpr double ANSWER_WAIT = 0.002; // seconds a thread has to answer one sample
+
+    struct Sampled {
+        std::string name;
+        std::map<std::vector<void *>, uint64_t> stacks; // innermost frame first
+        uint64_t samples = 0, missed = 0;               // missed: not running yet, exited or not answering
+    };
+
+    bool enabled = false;
+    double rate = 1000.0;
+    std::string path;
+    std::vector<Sampled> threads;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    double stopped = 0.0; // seconds the sampled threads spent stopped, summed
+    double elapsed = 0.0; // seconds sampled
+
+    // names: comma separated thread names, as given to configureThread
+    void start(double hz, const std::string &output, const std::string &names) {
+        rate = hz > 0.0 ? hz : 1000.0;
+        path = output;
+        threads.clear();
+        for (size_t begin = 0; begin <= names.size();) {
+            size_t end = std::min(names.find(',', begin), names.size());
+            if (end > begin) {
+                threads.push_back({names.substr(begin, end - begin)});
+            }
+            begin = end + 1;
+        }
+        ThreadStacks::install();
+        enabled = running = true;
+        worker = std::thread([this] { run(); });
+    }
+
+    // Stop sampling and write the profile
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        running = false;
+        worker.join();
+        enabled = false;
+        uint64_t samples = 0, missed = 0;
+        for (const Sampled &t : threads) {
+            samples += t.samples;
+            missed += t.missed;
+        }
+        double share = elapsed > 0.0 && !threads.empty() ? stopped / (elapsed * threads.size()) : 0.0;
+        std::printf("Sampling profiler: %llu samples at %.0f Hz, %llu missed, sampled threads stopped %.3f%% of the time\n",
+                    (unsigned long long)samples, rate, (unsigned long long)missed, share * 100.0);
+        std::printf(write() ? "Wrote sampled stacks to %s\n" : "Failed to write sampled stacks to %s\n", path.c_str());
+    }
+
+    void run() {
+        configureThread(THREAD_IO, "sampling profiler");
+        using Clock = std::chrono::steady_clock;
+        const Clock::duration period =
+            std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+        const Clock::time_point begin = Clock::now();
+        Clock::time_point next = begin;
+        void *frames[STACK_DEPTH];
+        std::vector<void *> stack;
+        stack.reserve(STACK_DEPTH);
+        while (running) {
+            next += period;
+            Clock::time_point now = Clock::now();
+            if (now > next + period) {
+                next = now; // fell behind (a descheduled sampler): skip, rather than burst, the lost samples
+            }
+            std::this_thread::sleep_until(next);
+            for (Sampled &t : threads) {
+                const ThreadConfig::Registered *r = latest(t.name.c_str());
+                double seconds = 0.0;
+                int depth = r ? ThreadStacks::capture(*r, frames, STACK_DEPTH, ANSWER_WAIT, &seconds) : -1;
+                stopped += seconds;
+                if (depth <= 0) {
+                    t.missed++;
+                    continue;
+                }
+                stack.assign(frames, frames + depth);
+                t.stacks[stack]++;
+                t.samples++;
+            }
+        }
+        elapsed = std::chrono::duration<double>(Clock::now() - begin).count();
+    }
+
+    // The newest registration under name: a restarted thread registers again
+    static const ThreadConfig::Registered *latest(const char *name) {
+        uint32_t count = threadConfig.registered.load(std::memory_order_acquire);
+        uint32_t oldest = count > ThreadConfig::MAX_THREADS ? count - ThreadConfig::MAX_THREADS : 0;
+        for (uint32_t i = count; i-- > oldest;) {
+            const ThreadConfig::Registered &r = threadConfig.threads[i % ThreadConfig::MAX_THREADS];
+            if (r.name && std::strcmp(r.name, name) == 0) {
+                return &r;
+            }
+        }
+        return nullptr;
+    }
+
+    // A frame's name for the profile: the symbol, or module+offset
+    static std::string frameName(void *frame) {
+        char text[256];
+#ifdef _WIN32
+#if defined(_M_X64) || defined(__x86_64__)
+        DWORD64 imageBase = 0;
+        if (PRUNTIME_FUNCTION function = RtlLookupFunctionEntry((DWORD64)frame, &imageBase, nullptr)) {
+            frame = (void *)(uintptr_t)(imageBase + function->BeginAddress); // so a function's samples merge
+        }
+#endif
+#else
+        Dl_info info;
+        if (dladdr(frame, &info) && info.dli_sname) {
+            int status = -1;
+            char *demangled = abi::__cxa_demangle(info.dli_sname, nullptr, nullptr, &status);
+            std::string name = status == 0 && demangled ? demangled : info.dli_sname;
+            std::free(demangled);
+            std::replace(name.begin(), name.end(), ';', ','); // the folded format's separator
+            return name;
+        }
+#endif
+        AllocationGuard::formatFrame(frame, text, sizeof(text));
+        return text;
+    }
+
+    // Stacks that differ only in where within the same functions they were merge here
+    bool write() const {
+        FILE *out = std::fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::unordered_map<void *, std::string> names;
+        std::map<std::string, uint64_t> folded;
+        for (const Sampled &t : threads) {
+            for (const auto &[stack, count] : t.stacks) {
+                std::string line = t.name;
+                for (size_t f = stack.size(); f-- > 0;) {
+                    auto it = names.find(stack[f]);
+                    if (it == names.end()) {
+                        it = names.emplace(stack[f], frameName(stack[f])).first;
+                    }
+                    line += ';';
+                    line += it->second;
+                }
+                folded[line] += count;
+            }
+        }
+        for (const auto &[line, count] : folded) {
+            std::fprintf(out, "%s %llu\n", line.c_str(), (unsigned long long)count);
+        }
+        return std::fclose(out) == 0;
+    }
+};
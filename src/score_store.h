@@ -0,0 +1,164 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include "mapped_file.h"
+#include "thread_config.h"
+
+// One finished run on the leaderboard
+struct ScoreEntry {
+    uint64_t ticks;   // simulation ticks survived, the score
+    uint64_t seed;    // spawn sequence, so the run can be replayed with --seed
+    int64_t endedAt;  // unix seconds
+    uint32_t simRate; // ticks per second, for showing ticks as time
+    uint32_t reserved;
+};
+
+// Everything the store keeps, in one copy
+struct ScoreTable {
+    static const uint32_t LEADERBOARD_SIZE = 16;
+
+    uint64_t sessions;   // runs recorded
+    uint64_t totalTicks; // simulated across every run
+    uint64_t totalFrames;
+    uint32_t count; // leaderboard entries used, best first
+    uint32_t reserved;
+    ScoreEntry best[LEADERBOARD_SIZE];
+};
+
+// File layout: a header and two tables, of which current is the live one. An update
+// writes the other table and then flips current with one release store, so a crash
+// or power cut at any moment leaves one complete table; there is no torn record to
+// detect on load.
+struct ScoreFile {
+    static const uint32_t MAGIC = 0x45524353; // "SCRE"
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    std::atomic<uint32_t> current; // 0 or 1
+    uint32_t reserved;
+    ScoreTable tables[2];
+};
+
+static_assert(std::is_standard_layout<ScoreFile>::value, "ScoreFile is mapped straight from disk");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "ScoreFile::current must be a plain 32-bit word");
+static_assert(sizeof(ScoreFile) == 16 + 2 * sizeof(ScoreTable), "ScoreFile has padding");
+
+// Persistent leaderboard and play totals in a memory-mapped ScoreFile. Loading is
+// a pointer cast after a magic and version check; a missing or foreign file starts
+// empty. record() updates the mapping with a few stores from the caller's thread
+// and wakes the flusher thread, which writes the pages back at most every
+// FLUSH_INTERVAL, so no frame ever waits for the disk. Owned by one thread; the
+// flusher only ever reads the mapping.
+struct ScoreStore {
+    static constexpr double FLUSH_INTERVAL = 1.0; // seconds
+
+    WritableMappedFile mapped;
+    ScoreFile *file = nullptr;
+    std::thread flusher;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+    std::atomic<bool> dirty{false};
+    std::atomic<uint32_t> flushes{0}, failures{0};
+
+    bool open(const std::string &path) {
+        if (!mapped.open(path, sizeof(ScoreFile))) {
+            return false;
+        }
+        file = (ScoreFile *)mapped.data;
+        if (file->magic != ScoreFile::MAGIC || file->version != ScoreFile::VERSION || file->current.load() > 1 ||
+            file->tables[0].count > ScoreTable::LEADERBOARD_SIZE || file->tables[1].count > ScoreTable::LEADERBOARD_SIZE) {
+            // unknown, or corrupt enough that the leaderboard would be read past its end: start over
+            std::memset((void *)file, 0, sizeof(ScoreFile));
+            file->magic = ScoreFile::MAGIC;
+            file->version = ScoreFile::VERSION;
+            dirty = true;
+        }
+        running = true;
+        flusher = std::thread([this] { flushLoop(); });
+        return true;
+    }
+
+    // The live table, straight from the mapping; null when no file is open
+    const ScoreTable *table() const {
+        return file ? &file->tables[file->current.load(std::memory_order_acquire)] : nullptr;
+    }
+
+    // Add a finished run: totals always, the leaderboard if it places. Returns its
+    // rank from 1, or 0 if it did not place.
+    int record(uint64_t ticks, uint64_t frames, uint64_t seed, uint32_t simRate) {
+        if (!file) {
+            return 0;
+        }
+        uint32_t live = file->current.load(std::memory_order_relaxed);
+        ScoreTable &next = file->tables[live ^ 1];
+        next = file->tables[live];
+        next.sessions++;
+        next.totalTicks += ticks;
+        next.totalFrames += frames;
+        uint32_t rank = 0;
+        while (rank < next.count && next.best[rank].ticks >= ticks) {
+            rank++;
+        }
+        if (rank < ScoreTable::LEADERBOARD_SIZE) {
+            uint32_t last = std::min(next.count, ScoreTable::LEADERBOARD_SIZE - 1);
+            std::memmove(&next.best[rank + 1], &next.best[rank], (last - rank) * sizeof(ScoreEntry));
+            next.best[rank] = {ticks, seed, (int64_t)std::time(nullptr), simRate, 0};
+            next.count = last + 1;
+        }
+        file->current.store(live ^ 1, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            dirty = true;
+        }
+        wake.notify_one();
+        return rank < ScoreTable::LEADERBOARD_SIZE ? (int)rank + 1 : 0;
+    }
+
+    void flushLoop() {
+        configureThread(THREAD_IO, "score flusher");
+        auto interval = std::chrono::duration<double>(FLUSH_INTERVAL);
+        while (running) {
+            {
+                std::unique_lock<std::mutex> lock(wakeLock);
+                wake.wait(lock, [this] { return !running || dirty; });
+            }
+            if (dirty.exchange(false)) {
+                (mapped.flush() ? flushes : failures).fetch_add(1, std::memory_order_relaxed);
+            }
+            std::unique_lock<std::mutex> lock(wakeLock);
+            wake.wait_for(lock, interval, [this] { return !running; }); // batch bursts of records
+        }
+    }
+
+    // Stop the flusher after a last flush and unmap the file
+    void close() {
+        if (!file) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        flusher.join();
+        if (dirty.exchange(false)) {
+            mapped.flush();
+        }
+        mapped.close();
+        file = nullptr;
+    }
+};
+
+inline ScoreStore scores;
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "perf_overlay.h"
+
+// Signed distance field of the overlay's 5x8 font, for text drawn at any size. Each
+// texel holds the distance from its centre to the nearest glyph edge, in font
+// pixels, mapped so 0.5 is the edge and SPREAD pixels either side reach 0 and 1.
+// The SDF sprite variant turns that back into coverage with a smoothstep one
+// screen pixel wide, so a single R8 texture stays crisp under any view scale
+// instead of needing an atlas per size. Baked at setup from the bitmap, in well
+// under a millisecond.
+struct SdfFont {
+    static const int RES = 3;     // texels per font pixel
+    static const int PAD = 4;     // texels around each glyph, enough for the spread
+    static constexpr float SPREAD = (float)PAD / RES; // font pixels from the edge to 0 or 1
+    static const int GLYPH_COLUMNS = 5, GLYPH_ROWS = 8;
+    static const int CELL_W = PerfOverlay::GLYPH_WIDTH * RES + 2 * PAD, CELL_H = GLYPH_ROWS * RES + 2 * PAD;
+    static const int COLUMNS = 16;
+    static const int GLYPHS = PerfOverlay::LAST_GLYPH - PerfOverlay::FIRST_GLYPH + 1;
+    static const int TEX_WIDTH = COLUMNS * CELL_W, TEX_HEIGHT = (GLYPHS + COLUMNS - 1) / COLUMNS * CELL_H;
+
+    GLuint texture = 0;
+
+    void setup() {
+        MemoryScope memory(MEM_CPU_TOOLS);
+        std::vector<unsigned char> texels(TEX_WIDTH * TEX_HEIGHT, 0);
+        for (int g = 0; g < GLYPHS; g++) {
+            bakeGlyph(g, &texels[(g / COLUMNS) * CELL_H * TEX_WIDTH + (g % COLUMNS) * CELL_W]);
+        }
+        texture = createTexture2D();
+        textureStorage2D(texture, 1, GL_R8, TEX_WIDTH, TEX_HEIGHT);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        textureSubImage2D(texture, 0, 0, 0, TEX_WIDTH, TEX_HEIGHT, GL_RED, GL_UNSIGNED_BYTE, texels.data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        memoryStats.trackGl(GL_TEXTURE, texture, MEM_TEXTURES, TEX_WIDTH * TEX_HEIGHT);
+        glMarkers.label(GL_TEXTURE, texture, "sdf font");
+    }
+
+    static bool inked(int glyph, int column, int row) {
+        return column >= 0 && column < GLYPH_COLUMNS && row >= 0 && row < GLYPH_ROWS &&
+               (PerfOverlay::FONT[glyph][column] >> row & 1);
+    }
+
+    // Brute force over the glyph's 5x8 pixels: a texel's distance is to the nearest
+    // pixel square of the other state, positive inside the ink
+    static void bakeGlyph(int glyph, unsigned char *cell) {
+        for (int ty = 0; ty < CELL_H; ty++) {
+            for (int tx = 0; tx < CELL_W; tx++) {
+                float px = (tx - PAD + 0.5f) / RES, py = (ty - PAD + 0.5f) / RES; // in font pixels
+                bool inside = inked(glyph, (int)std::floor(px), (int)std::floor(py));
+                float nearest = SPREAD;
+                for (int row = -1; row <= GLYPH_ROWS; row++) {
+                    for (int column = -1; column <= GLYPH_COLUMNS; column++) {
+                        if (inked(glyph, column, row) == inside) {
+                            continue;
+                        }
+                        float dx = std::max({column - px, 0.0f, px - (column + 1)});
+                        float dy = std::max({row - py, 0.0f, py - (row + 1)});
+                        nearest = std::min(nearest, std::sqrt(dx * dx + dy * dy));
+                    }
+                }
+                float distance = inside ? nearest : -nearest;
+                float value = 0.5f + 0.5f * distance / SPREAD;
+                cell[ty * TEX_WIDTH + tx] = (unsigned char)std::lround(std::min(std::max(value, 0.0f), 1.0f) * 255.0f);
+            }
+        }
+    }
+
+    // UV rect of a glyph's GLYPH_WIDTH x 8 pixels, as PerfOverlay::glyphRect; c as returned by glyphOf
+    static glm::vec4 glyphRect(char c) {
+        int g = c - PerfOverlay::FIRST_GLYPH;
+        return glm::vec4((float)(g % COLUMNS * CELL_W + PAD) / TEX_WIDTH, (float)(g / COLUMNS * CELL_H + PAD) / TEX_HEIGHT,
+                         (float)(PerfOverlay::GLYPH_WIDTH * RES) / TEX_WIDTH, (float)(GLYPH_ROWS * RES) / TEX_HEIGHT);
+    }
+
+    void release() {
+        if (!texture) {
+            return;
+        }
+        memoryStats.untrackGl(GL_TEXTURE, texture);
+        glState.deleteTextures(1, &texture);
+        texture = 0;
+    }
+};
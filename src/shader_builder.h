@@ -0,0 +1,233 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "memory_stats.h"
+#include "program_cache.h"
+#include "shader_source.h"
+
+// Builds GL programs without stalling on each one. Every program is submitted up
+// front, which only issues the compiles; poll() then advances each build through
+// compile -> link -> ready as the driver finishes it. With KHR_parallel_shader_compile
+// the driver compiles on its own threads and poll() asks GL_COMPLETION_STATUS_KHR, so
+// it never blocks; without it the status queries wait for the driver as before.
+// Failed builds print the full shader or program info log.
+struct ShaderBuilder {
+    enum State { COMPILING, LINKING, READY, FAILED };
+
+    struct Build {
+        std::string name;
+        std::vector<std::pair<GLenum, const GLchar *>> stages;
+        std::vector<const GLchar *> varyings; // transform feedback outputs, interleaved
+        std::vector<GLuint> shaders;
+        GLuint program = 0;
+        uint64_t key = 0;
+        State state = COMPILING;
+    };
+
+    std::vector<Build> builds;
+    ProgramCache *cache = nullptr;
+
+    // Start building a program from embedded stages; fragment may be null for a
+    // transform feedback program. Returns a handle for ready()/program().
+    int submit(const std::string &name, const ShaderSource &vertex, const ShaderSource *fragment,
+               std::vector<const GLchar *> varyings = {}) {
+        return submit(name, vertex.text, fragment ? fragment->text : nullptr, hashMix(vertex.hash, fragment ? fragment->hash : 0),
+                      std::move(varyings));
+    }
+
+    // Start building a program from source text, such as an embedded stage with
+    // defines added; sourceHash must change whenever the text does, and keys the
+    // program cache along with the varyings. The sources are only read during the call.
+    int submit(const std::string &name, const GLchar *vertexSource, const GLchar *fragmentSource, uint64_t sourceHash,
+               std::vector<const GLchar *> varyings = {}) {
+        std::vector<std::pair<GLenum, const GLchar *>> stages = {{GL_VERTEX_SHADER, vertexSource}};
+        if (fragmentSource) {
+            stages.push_back({GL_FRAGMENT_SHADER, fragmentSource});
+        }
+        return submitStages(name, std::move(stages), sourceHash, std::move(varyings));
+    }
+
+    // The same for any set of stages: a geometry stage between the two, or a compute
+    // stage alone
+    int submitStages(const std::string &name, std::vector<std::pair<GLenum, const GLchar *>> stages, uint64_t sourceHash,
+                     std::vector<const GLchar *> varyings = {}) {
+        MemoryScope memory(MEM_CPU_RENDERER);
+        builds.emplace_back();
+        Build &b = builds.back();
+        b.name = name;
+        b.stages = std::move(stages);
+        b.varyings = std::move(varyings);
+
+        if (cache) {
+            uint64_t hash = sourceHash;
+            for (const GLchar *varying : b.varyings) {
+                hash = fnv1a(varying, hash);
+            }
+            b.key = cache->key(hash);
+            b.program = cache->load(b.key);
+            if (b.program) {
+                b.state = READY;
+                glMarkers.label(GL_PROGRAM, b.program, b.name.c_str());
+                return (int)builds.size() - 1;
+            }
+        }
+
+        for (auto &stage : b.stages) {
+            GLuint shader = glCreateShader(stage.first);
+            glShaderSource(shader, 1, &stage.second, NULL);
+            glCompileShader(shader);
+            b.shaders.push_back(shader);
+        }
+        return (int)builds.size() - 1;
+    }
+
+    // Advance every build whose driver work has finished; true once none is pending
+    bool poll() {
+        MemoryScope memory(MEM_CPU_RENDERER);
+        bool pending = false;
+        for (Build &b : builds) {
+            if (b.state == COMPILING && compiled(b)) {
+                link(b);
+            }
+            if (b.state == LINKING && complete(b.program, true)) {
+                finishLink(b);
+            }
+            pending |= b.state == COMPILING || b.state == LINKING;
+        }
+        return !pending;
+    }
+
+    // Poll until every build is done; false if any failed
+    bool finish() {
+        while (!poll()) {
+        }
+        return !anyFailed();
+    }
+
+    bool ready(int handle) const {
+        return builds[handle].state == READY;
+    }
+
+    bool anyFailed() const {
+        for (const Build &b : builds) {
+            if (b.state == FAILED) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // The linked program; 0 until ready. The caller owns it afterwards.
+    GLuint program(int handle) const {
+        return builds[handle].state == READY ? builds[handle].program : 0;
+    }
+
+    // Whether the driver is done with a shader or program; always true without the extension
+    static bool complete(GLuint object, bool isProgram) {
+        if (!glExt.parallelShaderCompile) {
+            return true;
+        }
+        GLint done = GL_FALSE;
+        if (isProgram) {
+            glGetProgramiv(object, GL_COMPLETION_STATUS_KHR, &done);
+        } else {
+            glGetShaderiv(object, GL_COMPLETION_STATUS_KHR, &done);
+        }
+        return done == GL_TRUE;
+    }
+
+    // True once every stage has compiled; fails the build on a compile error
+    bool compiled(Build &b) {
+        for (GLuint shader : b.shaders) {
+            if (!complete(shader, false)) {
+                return false;
+            }
+        }
+        for (size_t i = 0; i < b.shaders.size(); i++) {
+            GLint status = GL_FALSE;
+            glGetShaderiv(b.shaders[i], GL_COMPILE_STATUS, &status);
+            if (!status) {
+                GLenum type = b.stages[i].first;
+                const char *stage = type == GL_VERTEX_SHADER     ? "vertex"
+                                    : type == GL_GEOMETRY_SHADER ? "geometry"
+                                    : type == GL_COMPUTE_SHADER  ? "compute"
+                                                                 : "fragment";
+                std::cout << "Failed to compile the " << b.name << " " << stage << " shader:\n"
+                          << infoLog(b.shaders[i], false) << std::endl;
+                fail(b);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void link(Build &b) {
+        b.program = glCreateProgram();
+        if (cache) {
+            cache->prepare(b.program);
+        }
+        for (GLuint shader : b.shaders) {
+            glAttachShader(b.program, shader);
+        }
+        if (!b.varyings.empty()) {
+            glTransformFeedbackVaryings(b.program, (GLsizei)b.varyings.size(), b.varyings.data(), GL_INTERLEAVED_ATTRIBS);
+        }
+        glLinkProgram(b.program);
+        b.state = LINKING;
+    }
+
+    void finishLink(Build &b) {
+        GLint status = GL_FALSE;
+        glGetProgramiv(b.program, GL_LINK_STATUS, &status);
+        if (!status) {
+            std::cout << "Failed to link the " << b.name << " program:\n" << infoLog(b.program, true) << std::endl;
+            fail(b);
+            return;
+        }
+        for (GLuint shader : b.shaders) {
+            glDetachShader(b.program, shader);
+            glDeleteShader(shader);
+        }
+        b.shaders.clear();
+        if (cache) {
+            cache->store(b.key, b.program);
+        }
+        b.state = READY;
+        glMarkers.label(GL_PROGRAM, b.program, b.name.c_str());
+    }
+
+    static std::string infoLog(GLuint object, bool isProgram) {
+        GLint length = 0;
+        if (isProgram) {
+            glGetProgramiv(object, GL_INFO_LOG_LENGTH, &length);
+        } else {
+            glGetShaderiv(object, GL_INFO_LOG_LENGTH, &length);
+        }
+        std::string log(length > 0 ? length : 1, '\0');
+        if (isProgram) {
+            glGetProgramInfoLog(object, (GLsizei)log.size(), nullptr, &log[0]);
+        } else {
+            glGetShaderInfoLog(object, (GLsizei)log.size(), nullptr, &log[0]);
+        }
+        log.resize(std::char_traits<char>::length(log.c_str()));
+        return log;
+    }
+
+    static void fail(Build &b) {
+        for (GLuint shader : b.shaders) {
+            glDeleteShader(shader);
+        }
+        b.shaders.clear();
+        if (b.program) {
+            glDeleteProgram(b.program);
+            b.program = 0;
+        }
+        b.state = FAILED;
+    }
+};
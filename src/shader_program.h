@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstring>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "gl_state.h"
+
+// Linked GL program with its active uniforms reflected once at link time.
+// Uniforms are addressed by index and only uploaded when their value changes.
+struct ShaderProgram {
+    // One active uniform and the last value uploaded to it
+    struct Uniform {
+        std::string name;
+        GLint location;
+        GLenum type;
+        GLfloat value[16];
+        bool uploaded;
+    };
+
+    GLuint id = 0;
+    std::vector<Uniform> uniforms;
+    int uploads = 0; // glUniform* calls actually issued
+    bool bindless = false; // samples the per-instance texture handle, so texture changes need no new draw
+
+    // Query every active uniform of the linked program and cache its location
+    void reflect() {
+        uniforms.clear();
+        GLint count = 0, maxLength = 0;
+        glGetProgramiv(id, GL_ACTIVE_UNIFORMS, &count);
+        glGetProgramiv(id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+        std::vector<GLchar> nameBuffer(maxLength > 0 ? maxLength : 1);
+        for (GLint i = 0; i < count; i++) {
+            GLsizei length = 0;
+            GLint size = 0;
+            GLenum type = 0;
+            glGetActiveUniform(id, (GLuint)i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+            Uniform u;
+            u.name.assign(nameBuffer.data(), length);
+            size_t bracket = u.name.find('[');
+            if (bracket != std::string::npos) {
+                u.name.erase(bracket); // arrays are reported as "name[0]"
+            }
+            u.location = glGetUniformLocation(id, u.name.c_str());
+            u.type = type;
+            u.uploaded = false;
+            std::memset(u.value, 0, sizeof(u.value));
+            uniforms.push_back(u);
+        }
+    }
+
+    // Returns the index of a uniform for use with set(), or -1 if it is not active.
+    // Intended for setup code; the hot path should keep the returned index.
+    int find(const char *name) const {
+        for (size_t i = 0; i < uniforms.size(); i++) {
+            if (uniforms[i].name == name) {
+                return (int)i;
+            }
+        }
+        return -1;
+    }
+
+    void use() const {
+        glState.useProgram(id);
+    }
+
+    // The setters below apply to this program, which must be the one in use
+
+    void set(int index, GLint v) {
+        GLfloat raw[16] = {};
+        std::memcpy(raw, &v, sizeof(v));
+        if (changed(index, raw, 1)) {
+            glUniform1i(uniforms[index].location, v);
+        }
+    }
+
+    void set(int index, GLfloat v) {
+        if (changed(index, &v, 1)) {
+            glUniform1f(uniforms[index].location, v);
+        }
+    }
+
+    void set(int index, const glm::vec2 &v) {
+        if (changed(index, glm::value_ptr(v), 2)) {
+            glUniform2fv(uniforms[index].location, 1, glm::value_ptr(v));
+        }
+    }
+
+    void set(int index, const glm::vec4 &v) {
+        if (changed(index, glm::value_ptr(v), 4)) {
+            glUniform4fv(uniforms[index].location, 1, glm::value_ptr(v));
+        }
+    }
+
+    void set(int index, const glm::mat4 &m) {
+        if (changed(index, glm::value_ptr(m), 16)) {
+            glUniformMatrix4fv(uniforms[index].location, 1, GL_FALSE, glm::value_ptr(m));
+        }
+    }
+
+    // Compares against the cached value and stores the new one; false means skip the upload
+    bool changed(int index, const GLfloat *v, int count) {
+        if (index < 0) {
+            return false;
+        }
+        Uniform &u = uniforms[index];
+        size_t bytes = count * sizeof(GLfloat);
+        if (u.uploaded && std::memcmp(u.value, v, bytes) == 0) {
+            return false;
+        }
+        std::memcpy(u.value, v, bytes);
+        u.uploaded = true;
+        uploads++;
+        return true;
+    }
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+// 64-bit FNV-1a, usable in constant expressions so embedded sources are hashed by
+// the compiler rather than at startup
+constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+constexpr uint64_t FNV_PRIME = 0x100000001B3ull;
+
+constexpr uint64_t fnv1a(const char *s, uint64_t h = FNV_OFFSET) {
+    for (; *s; s++) {
+        h = (h ^ (unsigned char)*s) * FNV_PRIME;
+    }
+    return h;
+}
+
+// Fold the eight bytes of value into the hash h
+constexpr uint64_t hashMix(uint64_t h, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        h = (h ^ (value >> (i * 8) & 0xFF)) * FNV_PRIME;
+    }
+    return h;
+}
+
+// One shader stage's GLSL as embedded by embed_shaders from src/shaders/, with its
+// #include lines already expanded; hash is fnv1a of text, so equal hashes mean
+// equal sources and the program cache can key on it without reading the text
+struct ShaderSource {
+    const char *name; // file it was embedded from, e.g. "sprite.vert.glsl"
+    const char *text;
+    uint64_t hash;
+};
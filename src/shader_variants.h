@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "shader_builder.h"
+#include "shader_program.h"
+#include "shader_source.h"
+
+// Feature bits of a program variant; each set bit becomes a #define in every stage
+enum ShaderFeature : uint32_t {
+    FEATURE_ROTATION = 1u << 0,   // ROTATION: turn by the per-instance angle and spin
+    FEATURE_ANIMATED = 1u << 1,   // ANIMATED: play the per-instance flipbook
+    FEATURE_ALPHA_TEST = 1u << 2, // ALPHA_TEST: discard texels under half alpha
+    FEATURE_BINDLESS = 1u << 3,   // BINDLESS: sample the per-instance ARB_bindless_texture handle
+    FEATURE_VERTEX_ID = 1u << 4,  // VERTEX_ID: derive the quad corner from gl_VertexID, with no vertex buffer
+    FEATURE_SDF = 1u << 5,        // SDF: the texture's red channel is a distance field; draw white coverage from it
+    FEATURE_ARRAY = 1u << 6,      // ARRAY: sample the per-instance layer of a GL_TEXTURE_2D_ARRAY
+    FEATURE_VIEWS = 1u << 7,      // VIEWS: route instance copies to the split-screen viewports
+    FEATURE_CULLED = 1u << 8,     // CULLED: comets are the culling pass's compacted survivors
+    FEATURE_POINTS = 1u << 9,     // POINTS: each comet arrives as a point for the geometry stage to expand
+    FEATURE_CUTOUT = 1u << 10     // CUTOUT: with ALPHA_TEST, keep only fully opaque texels, leaving the soft edge to a blended pass
+};
+static const int FEATURE_BITS = 3; // features combined per material; the others are picked once for every variant
+static const int FEATURE_COUNT = 11;
+
+// Every variant of one program, built from a feature bitmask by inserting #define
+// lines after the #version line of each source, so the shaders test features with
+// #ifdef instead of branching at run time. All variants are submitted together at
+// startup, where the builder compiles them in parallel and the program cache keeps
+// them, and are looked up by bitmask afterwards: no variant is ever compiled the
+// first time it is drawn.
+struct ShaderVariants {
+    std::string name;
+    std::map<uint32_t, int> builds;             // features -> ShaderBuilder handle
+    std::map<uint32_t, ShaderProgram> programs; // features -> program, once linked
+
+    static const char *featureName(int bit) {
+        static const char *const NAMES[FEATURE_COUNT] = {"ROTATION", "ANIMATED", "ALPHA_TEST", "BINDLESS", "VERTEX_ID", "SDF",
+                                                                  "ARRAY", "VIEWS", "CULLED", "POINTS", "CUTOUT"};
+        return NAMES[bit];
+    }
+
+    // Source with a #define for every feature in the mask, after its #version line
+    static std::string expand(const GLchar *source, uint32_t features) {
+        std::string text(source);
+        std::string defines;
+        for (int bit = 0; bit < FEATURE_COUNT; bit++) {
+            if (features >> bit & 1) {
+                defines += std::string("#define ") + featureName(bit) + "\n";
+            }
+        }
+        size_t firstLine = text.compare(0, 8, "#version") == 0 ? text.find('\n') + 1 : 0;
+        text.insert(firstLine, defines);
+        return text;
+    }
+
+    // Start building one variant, keyed by the embedded sources' hashes and its mask,
+    // so no expanded text is ever hashed; for programs built in a single variant,
+    // with a geometry stage if one is given
+    static int submitVariant(ShaderBuilder &builder, const std::string &name, const ShaderSource &vertexSource,
+                             const ShaderSource &fragmentSource, uint32_t features, const ShaderSource *geometrySource = nullptr) {
+        std::string vertex = expand(vertexSource.text, features), fragment = expand(fragmentSource.text, features);
+        uint64_t hash = hashMix(hashMix(vertexSource.hash, fragmentSource.hash), features);
+        if (!geometrySource) {
+            return builder.submit(name, vertex.c_str(), fragment.c_str(), hash);
+        }
+        std::string geometry = expand(geometrySource->text, features);
+        return builder.submitStages(name, {{GL_VERTEX_SHADER, vertex.c_str()}, {GL_GEOMETRY_SHADER, geometry.c_str()},
+                                           {GL_FRAGMENT_SHADER, fragment.c_str()}},
+                                    hashMix(hash, geometrySource->hash));
+    }
+
+    // Start building the variant of every feature mask listed
+    void submit(ShaderBuilder &builder, const std::string &programName, const ShaderSource &vertexSource,
+                const ShaderSource &fragmentSource, const std::vector<uint32_t> &featureSets) {
+        name = programName;
+        for (uint32_t features : featureSets) {
+            builds[features] = submitVariant(builder, name + " " + std::to_string(features), vertexSource, fragmentSource, features);
+        }
+    }
+
+    // Every mask of the first bits features, each with the extra ones set, for
+    // warming all combinations
+    static std::vector<uint32_t> allOf(int bits, uint32_t extra = 0) {
+        std::vector<uint32_t> sets;
+        for (uint32_t features = 0; features < (1u << bits); features++) {
+            sets.push_back(features | extra);
+        }
+        return sets;
+    }
+
+    // Take over the built programs; link turns a builder handle into a ShaderProgram
+    template <typename Link>
+    void link(Link link) {
+        for (const auto &build : builds) {
+            programs[build.first] = link(build.second);
+            programs[build.first].bindless = (build.first & FEATURE_BINDLESS) != 0;
+        }
+    }
+
+    // The variant for a feature mask, or nullptr if it was not submitted. The pointer
+    // stays valid for the lifetime of the set.
+    ShaderProgram *find(uint32_t features) {
+        auto it = programs.find(features);
+        return it == programs.end() ? nullptr : &it->second;
+    }
+};
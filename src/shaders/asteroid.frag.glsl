@@ -0,0 +1,69 @@
+#version 400
+// Procedural asteroids, drawn at startup over the fullscreen triangle into each layer
+// of a texture array in turn, one variant per layer. The outline is a circle whose radius
+// follows noise sampled around it, so it closes without a seam; the surface is a
+// sphere lit from the upper left, its normal bumped by noise, with darker pits
+// where a ridged noise peaks. Rows count down from the top of the asteroid, as an
+// image's do, so the layers are sampled like loaded images. Premultiplied alpha,
+// as every texture the game draws is.
+uniform float cellSize; // texels per side of a layer
+uniform float variant;  // the layer being drawn
+out vec4 color;
+
+// glm's gtc/noise simplex(vec2): Ashima Arts' and Stefan Gustavson's 2D simplex noise
+vec3 mod289(vec3 x) {
+    return x - floor(x * (1.0 / 289.0)) * 289.0;
+}
+vec2 mod289(vec2 x) {
+    return x - floor(x * (1.0 / 289.0)) * 289.0;
+}
+vec3 permute(vec3 x) {
+    return mod289(((x * 34.0) + 1.0) * x);
+}
+float simplex(vec2 v) {
+    const vec4 C = vec4(0.211324865405187, 0.366025403784439, -0.577350269189626, 0.024390243902439);
+    vec2 i = floor(v + dot(v, C.yy));
+    vec2 x0 = v - i + dot(i, C.xx);
+    vec2 i1 = x0.x > x0.y ? vec2(1.0, 0.0) : vec2(0.0, 1.0);
+    vec4 x12 = x0.xyxy + C.xxzz;
+    x12.xy -= i1;
+    i = mod289(i);
+    vec3 p = permute(permute(i.y + vec3(0.0, i1.y, 1.0)) + i.x + vec3(0.0, i1.x, 1.0));
+    vec3 m = max(0.5 - vec3(dot(x0, x0), dot(x12.xy, x12.xy), dot(x12.zw, x12.zw)), 0.0);
+    m = m * m;
+    m = m * m;
+    vec3 x = 2.0 * fract(p * C.www) - 1.0;
+    vec3 h = abs(x) - 0.5;
+    vec3 a0 = x - floor(x + 0.5);
+    m *= 1.79284291400159 - 0.85373472095314 * (a0 * a0 + h * h);
+    vec3 g = vec3(a0.x * x0.x + h.x * x0.y, a0.yz * x12.xz + h.yz * x12.yw);
+    return 130.0 * dot(m, g);
+}
+
+// Four octaves, within about [-0.94, 0.94]
+float fbm(vec2 p) {
+    float sum = 0.0, amplitude = 0.5;
+    for (int octave = 0; octave < 4; octave++) {
+        sum += amplitude * simplex(p);
+        p = p * 2.03 + vec2(17.0, 31.0);
+        amplitude *= 0.5;
+    }
+    return sum;
+}
+
+void main() {
+    vec2 offset = vec2(variant * 37.1, variant * 11.7); // each variant's own stretch of noise
+    vec2 p = gl_FragCoord.xy / cellSize * 2.0 - 1.0; // [-1, 1], y down
+    float theta = atan(p.y, p.x);
+    float edge = 0.72 + 0.16 * fbm(vec2(cos(theta), sin(theta)) * 1.3 + offset); // stays inside the layer
+    float alpha = 1.0 - smoothstep(edge - 2.0 / cellSize, edge + 2.0 / cellSize, length(p));
+
+    vec2 q = p / edge;
+    float z = sqrt(max(1.0 - dot(q, q), 0.0));
+    vec2 bump = vec2(fbm(p * 3.0 + offset + 5.0), fbm(p * 3.0 + offset - 5.0));
+    vec3 normal = normalize(vec3(q + 0.35 * bump, z + 0.2));
+    float light = clamp(dot(normal, normalize(vec3(-0.5, -0.6, 0.7))), 0.0, 1.0);
+    float pits = smoothstep(0.55, 0.8, 1.0 - abs(simplex(p * 2.5 + offset * 1.7)));
+    vec3 rock = mix(vec3(0.42, 0.36, 0.31), vec3(0.58, 0.54, 0.5), 0.5 + 0.5 * fbm(p * 5.0 + offset));
+    color = vec4(rock * (0.25 + 0.85 * light) * (1.0 - 0.35 * pits) * alpha, alpha);
+}
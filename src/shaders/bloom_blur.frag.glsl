@@ -0,0 +1,20 @@
+#version 400
+// One axis of bloom's separable Gaussian: nine texels in five bilinear taps, the
+// pairs either side of the centre each read between the two texels they weigh.
+uniform sampler2D source;
+uniform vec4 mapping; // source uv = (gl_FragCoord.xy - mapping.xy) * mapping.zw
+uniform vec2 texel;   // one source texel along the blurred axis, in uv
+uniform vec2 uvMax;   // last texel centre of the source's drawn region
+out vec4 color;
+
+vec3 tap(vec2 uv) {
+    return texture(source, min(uv, uvMax)).rgb;
+}
+
+void main() {
+    vec2 uv = (gl_FragCoord.xy - mapping.xy) * mapping.zw;
+    vec3 c = tap(uv) * 0.2270270270;
+    c += (tap(uv + texel * 1.3846153846) + tap(uv - texel * 1.3846153846)) * 0.3162162162;
+    c += (tap(uv + texel * 3.2307692308) + tap(uv - texel * 3.2307692308)) * 0.0702702703;
+    color = vec4(c, 1.0);
+}
@@ -0,0 +1,22 @@
+#version 400
+// Bloom's last pass: the scene plus its blurred levels, written over the region of
+// the target the scene would have been drawn to. The levels are weighed separately
+// so a chain without the half-resolution level only adds the quarter.
+uniform sampler2D scene;
+uniform sampler2D halfLevel;
+uniform sampler2D quarterLevel;
+uniform vec2 origin;       // the region's lower left corner in the target
+uniform vec2 sceneScale;   // uv per pixel of the region, for each texture
+uniform vec2 halfScale;
+uniform vec2 quarterScale;
+uniform vec2 halfMax;      // last texel centre of each level's drawn region
+uniform vec2 quarterMax;
+uniform vec2 weights;      // of the half and quarter levels
+out vec4 color;
+
+void main() {
+    vec2 p = gl_FragCoord.xy - origin;
+    vec3 glow = texture(halfLevel, min(p * halfScale, halfMax)).rgb * weights.x;
+    glow += texture(quarterLevel, min(p * quarterScale, quarterMax)).rgb * weights.y;
+    color = vec4(texture(scene, p * sceneScale).rgb + glow, 1.0);
+}
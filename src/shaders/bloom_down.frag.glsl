@@ -0,0 +1,29 @@
+#version 400
+// Bloom's bright pass and downsample, over the fullscreen triangle into the next
+// level of the chain. Four bilinear taps a source texel either side of the target
+// texel's centre average the source texels under it; the bright pass then keeps
+// what rises above threshold, with a soft knee so the glow fades in rather than
+// popping on. A threshold of 0 only downsamples.
+uniform sampler2D source;
+uniform vec4 mapping;    // source uv = (gl_FragCoord.xy - mapping.xy) * mapping.zw
+uniform vec2 texel;      // one source texel, in uv
+uniform vec2 uvMax;      // last texel centre of the source's drawn region; the rest is stale
+uniform float threshold; // brightness the glow starts from; 0 passes everything
+uniform float knee;      // width of the soft start below threshold
+out vec4 color;
+
+vec3 tap(vec2 uv) {
+    return texture(source, min(uv, uvMax)).rgb;
+}
+
+void main() {
+    vec2 uv = (gl_FragCoord.xy - mapping.xy) * mapping.zw;
+    vec3 c = 0.25 * (tap(uv - texel) + tap(uv + texel) + tap(uv + vec2(texel.x, -texel.y)) + tap(uv + vec2(-texel.x, texel.y)));
+    if (threshold > 0.0) {
+        float brightness = max(c.r, max(c.g, c.b));
+        float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+        soft = soft * soft / (4.0 * knee + 1e-4);
+        c *= max(soft, brightness - threshold) / max(brightness, 1e-4);
+    }
+    color = vec4(c, 1.0);
+}
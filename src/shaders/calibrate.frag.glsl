@@ -0,0 +1,7 @@
+#version 400
+// GPU calibration: half-transparent white, so with blending on every covered pixel
+// is a read-modify-write
+out vec4 color;
+void main() {
+    color = vec4(0.5);
+}
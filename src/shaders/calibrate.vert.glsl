@@ -0,0 +1,11 @@
+#version 400
+// GPU calibration (gpu_calibration.h): instance i is a quad of the given clip-space
+// size, from gl_VertexID alone, scattered over the target by a hash of i; a size
+// of 2 or more covers the whole target instead
+uniform vec2 size;
+void main() {
+    vec2 corner = vec2(gl_VertexID >> 1, gl_VertexID & 1) - 0.5;
+    uint hash = uint(gl_InstanceID) * 2654435761u;
+    vec2 centre = size.x < 2.0 ? vec2(hash & 0xFFFFu, hash >> 16) / 65535.0 * 2.0 - 1.0 : vec2(0.0);
+    gl_Position = vec4(centre + corner * size, 0.0, 1.0);
+}
@@ -0,0 +1,15 @@
+#version 400
+// The quad of one culled comet, for the transform feedback path: its draw has the
+// captured survivor count as a vertex count and no instance count, so each survivor
+// arrives as a point. Corners in the order of the shared quad's strip.
+layout (points) in;
+layout (triangle_strip, max_vertices = 4) out;
+in vec4 pointSpawn[];
+#include "comet_vertex.glsl"
+void main() {
+    for (int i = 0; i < 4; i++) {
+        vec2 texc = vec2(i >> 1, i & 1);
+        cometCorner(pointSpawn[0], uint(pointSpawn[0].w), texc - 0.5, texc);
+        EmitVertex();
+    }
+}
@@ -0,0 +1,27 @@
+#version 400
+// Comets drawn from their spawn parameters: x = spawn time, y = lane, z = speed, w = live.
+// Built with ARRAY when the comets' texture is a texture array, like sprite.vert.glsl's.
+// CULLED variants draw the survivors the culling pass compacted, every one live, so
+// w carries the comet's slot instead. POINTS variants take each survivor as a point
+// and leave the quad to comet.geom.glsl.
+layout (location = 2) in vec4 spawn;
+#ifdef POINTS
+out vec4 pointSpawn;
+void main() {
+    pointSpawn = spawn;
+}
+#else
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texc;
+#include "comet_vertex.glsl"
+void main() {
+#ifdef CULLED
+    cometCorner(spawn, uint(spawn.w), position.xy, texc);
+#else
+    cometCorner(spawn, uint(gl_InstanceID), position.xy, texc); // the slot is the handle
+    if (spawn.w <= 0.0) {
+        gl_Position = vec4(2.0, 2.0, 2.0, 1.0);
+    }
+#endif
+}
+#endif
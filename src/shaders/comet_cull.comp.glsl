@@ -0,0 +1,39 @@
+#version 430
+// Culls the comet field on the GPU: one invocation per slot appends its comet, if
+// visible, to the compacted survivor buffer, slot in w, and the draw command's
+// instance count is the append counter. Each workgroup counts its survivors in
+// shared memory first, so the command sees one atomic per group, not per comet.
+layout (local_size_x = 256) in;
+#include "comet_motion.glsl"
+layout (std430, binding = 0) readonly buffer Slots {
+    vec4 slots[];
+};
+layout (std430, binding = 1) writeonly buffer Survivors {
+    vec4 survivors[];
+};
+layout (std430, binding = 2) buffer Command { // a DrawArraysIndirectCommand
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint baseInstance;
+};
+uniform int slotCount;
+shared uint groupCount;
+shared uint groupBase;
+void main() {
+    if (gl_LocalInvocationIndex == 0u) {
+        groupCount = 0u;
+    }
+    barrier();
+    uint slot = gl_GlobalInvocationID.x;
+    bool keep = slot < uint(slotCount) && cometVisible(slots[slot]);
+    uint index = keep ? atomicAdd(groupCount, 1u) : 0u;
+    barrier();
+    if (gl_LocalInvocationIndex == 0u) {
+        groupBase = atomicAdd(instanceCount, groupCount);
+    }
+    barrier();
+    if (keep) {
+        survivors[groupBase + index] = vec4(slots[slot].xyz, float(slot));
+    }
+}
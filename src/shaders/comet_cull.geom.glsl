@@ -0,0 +1,14 @@
+#version 400
+// Captures a visible comet's point, slot in w; points are drawn from slot 0, so the
+// primitive index is the slot
+layout (points) in;
+layout (points, max_vertices = 1) out;
+in vec4 slotSpawn[];
+#include "comet_motion.glsl"
+out vec4 survivor;
+void main() {
+    if (cometVisible(slotSpawn[0])) {
+        survivor = vec4(slotSpawn[0].xyz, float(gl_PrimitiveIDIn));
+        EmitVertex();
+    }
+}
@@ -0,0 +1,8 @@
+#version 400
+// Transform feedback twin of comet_cull.comp.glsl for GL 4.0: one point per slot,
+// which comet_cull.geom.glsl keeps or drops
+layout (location = 0) in vec4 spawn;
+out vec4 slotSpawn;
+void main() {
+    slotSpawn = spawn;
+}
@@ -0,0 +1,16 @@
+// Where a comet is at the View block's clock, from its spawn parameters: x = spawn
+// time, y = lane, z = speed, w = live. Shared by the comet programs and the culling
+// passes, so a comet is kept exactly where it is drawn.
+#include "view.glsl"
+uniform vec2 size;
+uniform vec2 field; // x = lane width, y = spawn height
+
+vec2 cometCentre(vec4 spawn) {
+    return vec2((spawn.y + 0.5) * field.x, field.y - spawn.z * (clock.x - spawn.x));
+}
+
+// Live, and overlapping the playfield
+bool cometVisible(vec4 spawn) {
+    vec2 centre = cometCentre(spawn), reach = size * 0.5;
+    return spawn.w > 0.0 && all(greaterThan(centre + reach, vec2(0.0))) && all(lessThan(centre - reach, logical.xy));
+}
@@ -0,0 +1,22 @@
+// One corner of a comet quad, for comet.vert.glsl per vertex and comet.geom.glsl per
+// emitted vertex; slot picks the layer of ARRAY variants as AsteroidVariants does
+#include "comet_motion.glsl"
+uniform vec4 texRect;
+uniform float depth;
+uniform vec4 animation; // the material's flipbook; each comet starts it at spawn
+out vec2 texCoord;
+#ifdef ARRAY
+uniform float layers; // of the texture
+flat out float texLayer;
+#endif
+#include "flipbook.glsl"
+
+void cometCorner(vec4 spawn, uint slot, vec2 corner, vec2 texc) {
+    gl_Position = projection * vec4(cometCentre(spawn) + corner * size, depth, 1.0);
+#ifdef ARRAY
+    texLayer = float((slot * 2654435761u >> 16u) % uint(layers));
+    texCoord = texRect.xy + vec2(texc.s, 1.0 - texc.t) * texRect.zw;
+#else
+    texCoord = flipbookUV(texRect, vec4(animation.xyz, spawn.x), vec2(texc.s, 1.0 - texc.t), clock.x);
+#endif
+}
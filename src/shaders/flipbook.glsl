@@ -0,0 +1,13 @@
+// Index of the current frame of a flipbook, animation as in SpriteInstance::animation
+float flipbookFrame(vec4 animation, float time) {
+    return mod(floor((time - animation.w) * animation.z), animation.x);
+}
+
+// Texture coordinate of uv in the current frame of a flipbook: rect as in
+// SpriteInstance::texRect, animation as in SpriteInstance::animation
+vec2 flipbookUV(vec4 rect, vec4 animation, vec2 uv, float time) {
+    float frame = flipbookFrame(animation, time);
+    vec2 grid = vec2(animation.y, ceil(animation.x / animation.y));
+    vec2 cell = vec2(mod(frame, animation.y), floor(frame / animation.y));
+    return rect.xy + (cell + uv) / grid * rect.zw;
+}
@@ -0,0 +1,8 @@
+#version 400
+// The overdraw view's colour ramp, over the fullscreen triangle: drawn once per
+// level, with the stencil test keeping the pixels covered that many times
+uniform vec4 tint;
+out vec4 color;
+void main() {
+    color = tint;
+}
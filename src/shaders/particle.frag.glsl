@@ -0,0 +1,11 @@
+#version 400
+uniform sampler2D debrisTexture;
+in vec2 local;
+in vec4 tint;
+in vec2 texCoord;
+flat in int textured;
+out vec4 color;
+void main() {
+    color = textured != 0 ? texture(debrisTexture, texCoord) * tint
+                          : vec4(tint.rgb * clamp(1.0 - length(local), 0.0, 1.0), 0.0);
+}
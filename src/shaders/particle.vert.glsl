@@ -0,0 +1,29 @@
+#version 400
+// Particles drawn as instanced quads that shrink and fade over their lifetime. Debris
+// keeps its size and spins; each piece shows one cell of an 8x8 grid over debrisRect,
+// picked by its random life.w, which also sets its spin.
+layout (location = 0) in vec3 position;
+layout (location = 2) in vec4 state;
+layout (location = 3) in vec4 life;
+#include "view.glsl"
+uniform vec4 debrisRect; // atlas rect the pieces are cut from: xy = offset, zw = scale
+uniform float debrisSize; // pixels per piece
+out vec2 local;
+out vec4 tint;
+out vec2 texCoord;
+flat out int textured;
+void main() {
+    float t = life.x / max(life.y, 0.0001);
+    bool trail = life.z < 0.5, debris = life.z > 1.5;
+    float size = debris ? debrisSize : mix(trail ? 10.0 : 18.0, 2.0, t);
+    float spin = (life.w - 0.5) * 24.0 * life.x;
+    vec2 corner = debris ? mat2(cos(spin), sin(spin), -sin(spin), cos(spin)) * position.xy : position.xy;
+    gl_Position = t < 1.0 ? projection * vec4(state.xy + corner * size, 0.0, 1.0) : vec4(2.0, 2.0, 2.0, 1.0);
+    local = position.xy * 2.0;
+    float cell = floor(life.w * 64.0);
+    vec2 grid = vec2(mod(cell, 8.0), floor(cell / 8.0)) + vec2(position.x + 0.5, 0.5 - position.y);
+    texCoord = debrisRect.xy + grid / 8.0 * debrisRect.zw;
+    textured = debris ? 1 : 0;
+    tint = debris ? vec4(1.0 - t * t)
+         : (trail ? vec4(0.5, 0.7, 1.0, 1.0) : mix(vec4(1.0, 0.9, 0.4, 1.0), vec4(1.0, 0.2, 0.0, 1.0), t)) * (1.0 - t);
+}
@@ -0,0 +1,37 @@
+#version 400
+// Transform-feedback particle update: respawns slots claimed by this frame's bursts,
+// otherwise integrates live particles with a little drag
+layout (location = 0) in vec4 state; // xy = position, zw = velocity
+layout (location = 1) in vec4 life; // x = age, y = lifetime, z = kind
+uniform float dt;
+uniform int seed;
+uniform int capacity;
+uniform int burstCount;
+uniform ivec4 burstRange[32]; // first slot, count, kind
+uniform vec4 burstSource[32]; // origin xy, speed, lifetime
+out vec4 outState;
+out vec4 outLife;
+float hash(uint n) {
+    n = (n << 13u) ^ n;
+    n = n * (n * n * 15731u + 789221u) + 1376312589u;
+    return float(n & 0x7fffffffu) / 2147483647.0;
+}
+void main() {
+    for (int b = 0; b < burstCount; b++) {
+        if ((gl_VertexID - burstRange[b].x + capacity) % capacity < burstRange[b].y) {
+            uint n = uint(gl_VertexID) * 2u + uint(seed) * 7919u;
+            float angle = hash(n) * 6.2831853;
+            float speed = burstSource[b].z * (0.25 + 0.75 * hash(n + 1u));
+            outState = vec4(burstSource[b].xy, cos(angle) * speed, sin(angle) * speed);
+            outLife = vec4(0.0, burstSource[b].w, float(burstRange[b].z), hash(n + 2u));
+            return;
+        }
+    }
+    outState = state;
+    outLife = life;
+    if (life.x < life.y) {
+        outState.xy += state.zw * dt;
+        outState.zw *= 1.0 - 1.5 * dt;
+        outLife.x += dt;
+    }
+}
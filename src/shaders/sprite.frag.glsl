@@ -0,0 +1,41 @@
+#version 400
+// Sprite program; see sprite.vert.glsl. Also the comet program's fragment stage.
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+flat in uvec2 texHandle;
+#elif defined(ARRAY)
+uniform sampler2DArray texBuffer;
+#else
+uniform sampler2D texBuffer;
+#endif
+#ifdef ARRAY
+flat in float texLayer;
+#endif
+in vec2 texCoord;
+out vec4 color;
+void main() {
+#if defined(BINDLESS) && defined(ARRAY)
+    color = texture(sampler2DArray(texHandle), vec3(texCoord, texLayer));
+#elif defined(BINDLESS)
+    color = texture(sampler2D(texHandle), texCoord);
+#elif defined(ARRAY)
+    color = texture(texBuffer, vec3(texCoord, texLayer));
+#else
+    color = texture(texBuffer, texCoord);
+#endif
+#ifdef SDF
+    // 0.5 is the glyph's edge; blend across about one screen pixel whatever the scale
+    float width = max(fwidth(color.r) * 0.7, 1e-4);
+    color = vec4(smoothstep(0.5 - width, 0.5 + width, color.r)); // white, premultiplied
+#endif
+#if defined(ALPHA_TEST) && defined(CUTOUT)
+    // Interior of a soft-edged sprite: anything short of opaque is left to its blended edge pass
+    if (color.a < 254.5 / 255.0) {
+        discard;
+    }
+#elif defined(ALPHA_TEST)
+    if (color.a < 0.5) {
+        discard;
+    }
+#endif
+}
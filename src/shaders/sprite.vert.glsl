@@ -0,0 +1,72 @@
+#version 400
+// Sprite program, built in ShaderVariants with one variant per ShaderFeature mask;
+// features are tested with #ifdef. BINDLESS variants turn on the extension before
+// any declaration and pass the instance's handle through. VERTEX_ID variants read no
+// per-vertex attributes: vertices 0-3 of the strip are the unit quad's corners in
+// geometryCache order, so the corner is the index's two bits. ARRAY variants sample
+// a texture array at the instance's layer, and an animated one plays its frames
+// through consecutive layers instead of across a sheet. VIEWS variants draw each
+// instance split.x times in a row, once into each split-screen viewport with that
+// view's projection; the batch steps the instance attributes at the same rate.
+#ifdef BINDLESS
+#extension GL_ARB_bindless_texture : require
+#endif
+#ifdef VIEWS
+#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+#ifndef VERTEX_ID
+layout (location = 0) in vec3 position;
+layout (location = 1) in vec2 texc;
+#endif
+layout (location = 2) in vec4 placement; // xy = centre, zw = size
+layout (location = 3) in vec2 rotation; // radians at simulated time 0, radians per second
+layout (location = 4) in vec4 texRect;
+layout (location = 5) in float depth;
+layout (location = 6) in vec4 animation; // frames, columns, frames per second, start
+layout (location = 7) in float layer;
+#include "view.glsl"
+out vec2 texCoord;
+#ifdef ARRAY
+flat out float texLayer;
+#endif
+#ifdef BINDLESS
+layout (location = 8) in uvec2 textureHandle;
+flat out uvec2 texHandle;
+#endif
+#ifdef ANIMATED
+#include "flipbook.glsl"
+#endif
+void main() {
+#ifdef BINDLESS
+    texHandle = textureHandle;
+#endif
+#ifdef VERTEX_ID
+    vec2 texc = vec2(gl_VertexID >> 1, gl_VertexID & 1);
+    vec2 p = (texc - 0.5) * placement.zw;
+#else
+    vec2 p = position.xy * placement.zw;
+#endif
+#ifdef ROTATION
+    float angle = rotation.x + rotation.y * clock.x;
+    vec2 turn = vec2(cos(angle), sin(angle));
+    p = vec2(p.x * turn.x - p.y * turn.y, p.x * turn.y + p.y * turn.x);
+#endif
+#ifdef VIEWS
+    int view = gl_InstanceID % int(split.x);
+    gl_ViewportIndex = view;
+    gl_Position = projections[view] * vec4(placement.xy + p, depth, 1.0);
+#else
+    gl_Position = projection * vec4(placement.xy + p, depth, 1.0);
+#endif
+#if defined(ARRAY) && defined(ANIMATED)
+    texLayer = layer + flipbookFrame(animation, clock.x);
+    texCoord = texRect.xy + vec2(texc.s, 1.0 - texc.t) * texRect.zw;
+#elif defined(ARRAY)
+    texLayer = layer;
+    texCoord = texRect.xy + vec2(texc.s, 1.0 - texc.t) * texRect.zw;
+#elif defined(ANIMATED)
+    texCoord = flipbookUV(texRect, animation, vec2(texc.s, 1.0 - texc.t), clock.x);
+#else
+    texCoord = texRect.xy + vec2(texc.s, 1.0 - texc.t) * texRect.zw;
+#endif
+}
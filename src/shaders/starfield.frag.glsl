@@ -0,0 +1,35 @@
+#version 400
+// Three star layers scrolling down at different speeds. Each layer is a grid of
+// cells in playfield units and a hash of the cell decides whether it holds a star,
+// where, and how bright. Every layer scrolls half a cell per second, so after
+// ViewTransform::CLOCK_PERIOD seconds it has moved a whole number of cells (ROWS) and
+// the wrapped clock shows the same sky.
+#include "view.glsl"
+out vec4 color;
+const float ROWS = 1000.0; // cells scrolled per period: 0.5 cells/s * 2000 s
+float hash(vec2 cell, float salt) {
+    uvec2 q = uvec2(cell) + uvec2(uint(salt) * 7919u, 0u);
+    uint n = q.x * 1597334673u ^ q.y * 3812015801u;
+    n = (n ^ (n >> 16u)) * 2246822519u;
+    n ^= n >> 13u;
+    return float(n) / 4294967295.0;
+}
+void main() {
+    vec3 sky = vec3(0.01, 0.01, 0.035);
+    for (int layer = 0; layer < 3; layer++) {
+        float size = 24.0 * float(1 << layer); // cell size: far layers are denser and slower
+        vec2 p = (gl_FragCoord.xy - viewport.xy) * logical.xy / viewport.zw + vec2(0.0, clock.y * size * 0.5);
+        vec2 cell = floor(p / size);
+        cell.y = mod(cell.y, ROWS);
+        float salt = float(layer * 3);
+        if (hash(cell, salt) > 0.35) {
+            continue;
+        }
+        vec2 centre = (vec2(hash(cell, salt + 1.0), hash(cell, salt + 2.0)) * 0.7 + 0.15) * size;
+        float d = length(mod(p, size) - centre);
+        float radius = 0.8 + 0.6 * float(layer);
+        float brightness = 0.3 + 0.35 * float(layer);
+        sky += vec3(0.85, 0.9, 1.0) * brightness * clamp(1.0 - d / radius, 0.0, 1.0);
+    }
+    color = vec4(sky, 1.0);
+}
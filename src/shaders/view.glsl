@@ -0,0 +1,10 @@
+// The View block shared by every program that draws in playfield units; matches
+// ViewTransform::Block and is bound at ViewTransform::BINDING
+layout (std140) uniform View {
+    mat4 projection;
+    vec4 viewport; // xy = origin, zw = size, in pixels
+    vec4 logical;  // xy = playfield size
+    vec4 clock;    // x = seconds, y = x wrapped, z = frame
+    mat4 projections[2]; // per split-screen view, ViewTransform::MAX_VIEWS
+    vec4 split;    // x = views one instanced draw reaches
+};
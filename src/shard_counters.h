@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// What the sharded counters count; all only ever go up
+enum CounterId {
+    COUNTER_DRAWS,           // scene draw calls, added once per rendered frame
+    COUNTER_GL_CALLS,        // GL calls, in trace builds (gl_call_stats.h)
+    COUNTER_SPAWNS,          // comets released by the waves
+    COUNTER_LANE_CHANGES,
+    COUNTER_COLLISIONS,
+    COUNTER_ALLOCATIONS,     // heap allocations AllocationGuard::record sees
+    COUNTER_ALLOCATED_BYTES,
+    COUNTER_COUNT
+};
+
+static const char *const COUNTER_NAMES[COUNTER_COUNT] = {
+    "draws", "gl_calls", "spawns", "lane_changes", "collisions", "allocations", "allocated_bytes"};
+
+// Event counts bumped from any thread without the threads fighting over a cache
+// line. Each thread claims a Shard of its own on its first add, a whole number of
+// cache lines, and is its only writer, so an add is a relaxed load and store on a
+// line no other thread writes. Readers (the overlay, the metrics thread, the
+// telemetry drain) sum the shards on demand; a sum taken while threads are adding
+// may miss their latest adds but never goes backwards. Threads past SHARDS share
+// the last shard and add to it atomically. Constant-initialised, so the allocator
+// can count before static constructors have run.
+struct ShardedCounters {
+    static constexpr int SHARDS = 32;
+    static constexpr size_t CACHE_LINE = 64;
+
+    struct alignas(CACHE_LINE) Shard {
+        std::atomic<uint64_t> values[COUNTER_COUNT];
+    };
+
+    // Every counter summed over the shards at one moment
+    struct Totals {
+        uint64_t values[COUNTER_COUNT] = {};
+
+        uint64_t operator[](CounterId id) const {
+            return values[id];
+        }
+    };
+
+    Shard shards[SHARDS] = {};
+    std::atomic<int> claimed{0};
+
+    void add(CounterId id, uint64_t n = 1) {
+        Shard &s = shard();
+        if (&s == &shards[SHARDS - 1]) {
+            s.values[id].fetch_add(n, std::memory_order_relaxed);
+        } else {
+            s.values[id].store(s.values[id].load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t total(CounterId id) const {
+        uint64_t sum = 0;
+        for (int i = 0; i < used(); i++) {
+            sum += shards[i].values[id].load(std::memory_order_relaxed);
+        }
+        return sum;
+    }
+
+    Totals totals() const {
+        Totals t;
+        for (int i = 0; i < used(); i++) {
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                t.values[c] += shards[i].values[c].load(std::memory_order_relaxed);
+            }
+        }
+        return t;
+    }
+
+    int used() const {
+        return std::min(claimed.load(std::memory_order_acquire), SHARDS);
+    }
+
+    // The calling thread's shard, claimed on its first add
+    Shard &shard() {
+        static thread_local Shard *mine = nullptr;
+        if (!mine) {
+            mine = &shards[std::min(claimed.fetch_add(1, std::memory_order_acq_rel), SHARDS - 1)];
+        }
+        return *mine;
+    }
+};
+
+static_assert(sizeof(ShardedCounters::Shard) % ShardedCounters::CACHE_LINE == 0, "shards must not share a cache line");
+
+inline ShardedCounters counters;
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+// Simulation level of detail for entities whose motion is a straight fall. Those
+// that can neither meet the ship nor fall out of the field within the next PERIOD
+// ticks sleep in an archetype no per-tick system visits: not moved, not bucketed by
+// the broadphase, not checked for their lifetime. On anchor ticks, one in PERIOD,
+// the sleepers are moved the whole period at once and every candidate is classified
+// again, so all sleepers share the last anchor tick; in between, their position is
+// the stored one plus vy times the time since it, which the render snapshot works
+// out in closed form.
+//
+// The ship's reach over a period is its box widened by the farthest a glide can
+// carry it: the eased glide peaks at 1.5 times its average speed, over at most the
+// span of the lanes.
+struct SimulationLod {
+    static const uint32_t PERIOD = 8;
+
+    bool enabled = true;
+    float reachLeft = 0.0f, reachRight = 0.0f, reachTop = 0.0f; // of the ship's box over the period
+    float floorY = 0.0f; // where lifetimes end: sleepers stay above it
+
+    static bool anchorTick(uint64_t tick) {
+        return tick % PERIOD == 0;
+    }
+
+    // Ticks since the sleepers' anchor once ticks ticks have run
+    static uint32_t sinceAnchor(uint64_t ticks) {
+        return ticks ? (uint32_t)((ticks - 1) % PERIOD) : 0;
+    }
+
+    // Where the ship at (x, y) can be over the next period of ticks dt seconds long
+    void reach(float x, float y, float halfW, float halfH, float laneSpan, float glideTime, float dt, float despawnY) {
+        float glide = std::min(laneSpan, 1.5f * laneSpan * PERIOD * dt / glideTime);
+        reachLeft = x - halfW - glide;
+        reachRight = x + halfW + glide;
+        reachTop = y + halfH;
+        floorY = despawnY;
+    }
+
+    // True if an entity at (x, y) with a box of half size (halfW, halfH), falling at
+    // vy, stays clear of the ship's reach and above the floor for the whole period
+    bool canSleep(float x, float y, float vy, float halfW, float halfH, float dt) const {
+        float lowest = y + std::min(vy, 0.0f) * (PERIOD * dt);
+        bool aside = x + halfW < reachLeft || x - halfW > reachRight;
+        return lowest >= floorY && (aside || lowest - halfH > reachTop);
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+template <typename Signature, size_t Capacity = 32>
+struct SmallFunction;
+
+// Type-erased callable stored inline, for hot callbacks that std::function would put
+// on the heap once their captures outgrow its own small buffer. Anything larger
+// than Capacity, or more strictly aligned than max_align_t, fails to compile
+// rather than allocating. A call is one indirect jump through the invoker.
+template <typename R, typename... Args, size_t Capacity>
+struct SmallFunction<R(Args...), Capacity> {
+    alignas(std::max_align_t) unsigned char storage[Capacity];
+    R (*invoker)(void *, Args...) = nullptr;
+    void (*mover)(void *to, void *from) = nullptr; // move-constructs into to and destroys from; to null only destroys
+
+    SmallFunction() = default;
+
+    template <typename F, typename = std::enable_if_t<!std::is_same<std::decay_t<F>, SmallFunction>::value>>
+    SmallFunction(F &&f) {
+        using T = std::decay_t<F>;
+        static_assert(sizeof(T) <= Capacity, "callable does not fit the SmallFunction's buffer");
+        static_assert(alignof(T) <= alignof(std::max_align_t), "callable is over-aligned for SmallFunction");
+        new (storage) T(std::forward<F>(f));
+        invoker = [](void *self, Args... args) -> R { return (*(T *)self)(std::forward<Args>(args)...); };
+        mover = [](void *to, void *from) {
+            if (to) {
+                new (to) T(std::move(*(T *)from));
+            }
+            ((T *)from)->~T();
+        };
+    }
+
+    SmallFunction(SmallFunction &&other) noexcept {
+        take(other);
+    }
+
+    SmallFunction &operator=(SmallFunction &&other) noexcept {
+        if (this != &other) {
+            reset();
+            take(other);
+        }
+        return *this;
+    }
+
+    SmallFunction(const SmallFunction &) = delete;
+    SmallFunction &operator=(const SmallFunction &) = delete;
+
+    ~SmallFunction() {
+        reset();
+    }
+
+    explicit operator bool() const {
+        return invoker != nullptr;
+    }
+
+    R operator()(Args... args) {
+        return invoker(storage, std::forward<Args>(args)...);
+    }
+
+    void reset() {
+        if (mover) {
+            mover(nullptr, storage);
+        }
+        invoker = nullptr;
+        mover = nullptr;
+    }
+
+    void take(SmallFunction &other) {
+        if (other.mover) {
+            other.mover(storage, other.storage);
+        }
+        invoker = other.invoker;
+        mover = other.mover;
+        other.invoker = nullptr;
+        other.mover = nullptr;
+    }
+};
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "draw_list.h"
+#include "geometry_cache.h"
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "gl_state.h"
+#include "instance_packing.h"
+#include "memory_stats.h"
+#include "stream_buffer.h"
+#include "texture_handles.h"
+
+// Submits a sorted DrawList: every instance is streamed in one write, then each run
+// of commands with the same layer, shader and texture becomes one instanced draw of
+// the texture binding's outline, or of the shared quad,
+// switching program or texture only where the key changes. With indirect on, the
+// runs are also streamed as DrawArraysIndirectCommands, the hook for culling on the
+// GPU later, and where ARB_multi_draw_indirect is present every stretch of runs
+// that needs no state change between them goes out in one multi-draw. Bindless programs read
+// the texture handle written into each instance instead, so their runs only split
+// on layer and shader and bind no texture. Opaque runs write depth without
+// blending; at the first translucent run blending is switched on and depth writes
+// off, once per submit. The caller decides whether the depth test is on. For
+// split-screen, views > 1 draws every instance that many times in a row, the
+// attributes stepping once per views instances, for the VIEWS programs to route.
+// Where ARB_base_instance is present the instance attributes are pointed at each
+// buffer once and every draw names its first instance instead, so a run costs one
+// draw call and no vertex array edits. With packed on, instances are streamed as
+// PackedSpriteInstances (instance_packing.h), and the attribute formats say so.
+struct SpriteBatch {
+    // GL's layout of one glDrawArraysIndirect command
+    struct DrawArraysIndirectCommand {
+        GLuint count, instanceCount, first, baseInstance;
+    };
+
+    // Commands [first, first + count) of the sorted list, drawn with one state
+    struct Run {
+        uint64_t key;
+        GLuint first, count;
+        bool handles; // a bindless program: the texture field does not split the run, only its outline
+        GLint firstVertex;
+        GLsizei vertices;
+    };
+
+    GLuint VAO = 0;
+    StreamBuffer instanceStream;
+    StreamBuffer indirectStream; // a DrawArraysIndirectCommand per run, when indirect
+    GLsizei vertexCount = 0; // vertices of the shared quad
+    int drawCalls = 0;    // draws issued by the last submit
+    int stateChanges = 0; // program and texture binds issued by the last submit
+    bool bindless = false; // the instances carry texture handles (textureHandles.enabled at setup)
+    bool indirect = true;  // draw runs from a command buffer; set before setup()
+    bool vertexId = false; // the programs build the quad from gl_VertexID, so no per-vertex buffer; set before setup()
+    bool packed = false;   // stream instances as PackedSpriteInstances; set before setup()
+    int views = 1;   // copies drawn of each instance; ViewTransform::instancedViews()
+    int divisor = 1; // instance attribute divisor the VAO has now
+    GLuint pointedBuffer = 0; // buffer and byte offset the instance attributes read now
+    size_t pointedBase = 0;
+    uint64_t uploadedBytes = 0; // instance bytes streamed since setup
+
+    // Locations of the per-instance attributes
+    static const GLuint PLACEMENT_ATTRIB = 2;
+    static const GLuint ROTATION_ATTRIB = 3;
+    static const GLuint TEX_RECT_ATTRIB = 4;
+    static const GLuint DEPTH_ATTRIB = 5;
+    static const GLuint ANIMATION_ATTRIB = 6;
+    static const GLuint LAYER_ATTRIB = 7;
+    static const GLuint TEXTURE_ATTRIB = 8; // bindless handle, only set up when bindless
+    // Vertex buffer binding feeding all of them under direct state access
+    static const GLuint INSTANCE_BINDING = PLACEMENT_ATTRIB;
+
+    // Format and offset of one per-instance float attribute in a streamed layout
+    struct InstanceAttrib {
+        GLuint index;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLuint offset;
+    };
+    static const int INSTANCE_ATTRIBS = 6; // all but the bindless handle
+    static constexpr InstanceAttrib FULL_ATTRIBS[INSTANCE_ATTRIBS] = {
+        {PLACEMENT_ATTRIB, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, placement)},
+        {ROTATION_ATTRIB, 2, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, rotation)},
+        {TEX_RECT_ATTRIB, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, texRect)},
+        {DEPTH_ATTRIB, 1, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, depth)},
+        {ANIMATION_ATTRIB, 4, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, animation)},
+        {LAYER_ATTRIB, 1, GL_FLOAT, GL_FALSE, offsetof(SpriteInstance, layer)}};
+    static constexpr InstanceAttrib PACKED_ATTRIBS[INSTANCE_ATTRIBS] = {
+        {PLACEMENT_ATTRIB, 4, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedSpriteInstance, placement)},
+        {ROTATION_ATTRIB, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedSpriteInstance, rotation)},
+        {TEX_RECT_ATTRIB, 4, GL_SHORT, GL_TRUE, offsetof(PackedSpriteInstance, texRect)},
+        {DEPTH_ATTRIB, 1, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedSpriteInstance, depth)},
+        {ANIMATION_ATTRIB, 4, GL_HALF_FLOAT, GL_FALSE, offsetof(PackedSpriteInstance, animation)},
+        {LAYER_ATTRIB, 1, GL_UNSIGNED_BYTE, GL_FALSE, offsetof(PackedSpriteInstance, layer)}};
+
+    const InstanceAttrib *instanceAttribs() const {
+        return packed ? PACKED_ATTRIBS : FULL_ATTRIBS;
+    }
+
+    // Bytes per streamed instance; packed ones leave the handle off when nothing reads it
+    GLsizei stride() const {
+        return packed ? (GLsizei)(bindless ? sizeof(PackedSpriteInstance) : PACKED_INSTANCE_BYTES) : (GLsizei)sizeof(SpriteInstance);
+    }
+
+    GLuint textureOffset() const {
+        return packed ? offsetof(PackedSpriteInstance, texture) : offsetof(SpriteInstance, texture);
+    }
+
+    // Create the instance buffer and a VAO pairing it with the shared quad
+    void setup(const Mesh &quad, GLsizeiptr capacity = 256) {
+        VAO = createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, VAO, MEM_BUFFERS, 0);
+
+        // Per-vertex position and texture coordinates come from the shared quad, unless
+        // the VERTEX_ID programs derive them from the vertex index; the draws still
+        // cover its vertexCount strip vertices either way
+        if (!vertexId) {
+            quad.bindAttribs(VAO);
+        }
+        vertexCount = quad.vertexCount;
+
+        // Per-instance transform, UV rect and flipbook, streamed through a fenced ring so
+        // uploads never wait on in-flight draws. Under direct state access the
+        // attributes all share one buffer binding, so moving them to a run is a single call.
+        bindless = textureHandles.enabled;
+        instanceStream.name = "sprite instances";
+        instanceStream.setup(capacity * stride());
+        if (glExt.directStateAccess) {
+            for (int a = 0; a < INSTANCE_ATTRIBS; a++) {
+                instanceFormat(instanceAttribs()[a]);
+            }
+            if (bindless) {
+                glExt.VertexArrayAttribIFormat(VAO, TEXTURE_ATTRIB, 2, GL_UNSIGNED_INT, textureOffset());
+                glExt.VertexArrayAttribBinding(VAO, TEXTURE_ATTRIB, INSTANCE_BINDING);
+                glExt.EnableVertexArrayAttrib(VAO, TEXTURE_ATTRIB);
+            }
+            glExt.VertexArrayBindingDivisor(VAO, INSTANCE_BINDING, 1);
+        } else {
+            glState.bindVertexArray(VAO);
+            for (GLuint attrib = PLACEMENT_ATTRIB; attrib <= (bindless ? TEXTURE_ATTRIB : LAYER_ATTRIB); attrib++) {
+                glEnableVertexAttribArray(attrib);
+                glVertexAttribDivisor(attrib, 1);
+            }
+        }
+        pointInstanceAttribs(0);
+        glMarkers.label(GL_VERTEX_ARRAY, VAO, "sprite batch");
+
+        if (indirect) {
+            indirectStream.target = GL_DRAW_INDIRECT_BUFFER;
+            indirectStream.name = "sprite draw commands";
+            indirectStream.setup(64 * sizeof(DrawArraysIndirectCommand));
+        }
+    }
+
+    // Start a new frame of the instance and command streams
+    void begin() {
+        instanceStream.beginFrame();
+        if (indirect) {
+            indirectStream.beginFrame();
+        }
+    }
+
+    // True if run b can be drawn straight after run a without touching GL state
+    static bool sameState(const Run &a, const Run &b) {
+        return DrawList::translucentOf(a.key) == DrawList::translucentOf(b.key) &&
+               DrawList::shaderOf(a.key) == DrawList::shaderOf(b.key) &&
+               (a.handles || DrawList::textureOf(a.key) == DrawList::textureOf(b.key));
+    }
+
+    // Upload the list's instances in key order and draw each run of equal state at once.
+    // The list must already be sorted.
+    void submit(const DrawList &list) {
+        drawCalls = 0;
+        stateChanges = 0;
+        if (list.empty()) {
+            return;
+        }
+
+        // Sorted copy of the list's instances, staged in frame memory, with the resident
+        // handle of each command's texture when bindless programs may read it
+        const size_t count = list.commands.size();
+        SpriteInstance *instances = frameArena.allocate<SpriteInstance>(count);
+        for (size_t i = 0; i < count; i++) {
+            instances[i] = list.instances[list.commands[i].instance];
+        }
+        if (bindless) {
+            glm::uvec2 *handles = frameArena.allocate<glm::uvec2>(list.textures.size());
+            for (size_t t = 0; t < list.textures.size(); t++) {
+                GLuint64 handle = textureHandles.get(list.textures[t].texture, list.textures[t].sampler);
+                handles[t] = glm::uvec2((uint32_t)handle, (uint32_t)(handle >> 32));
+            }
+            for (size_t i = 0; i < count; i++) {
+                instances[i].texture = handles[DrawList::textureOf(list.commands[i].key)];
+            }
+        }
+
+        glState.bindVertexArray(VAO);
+        stepInstances();
+        GLsizeiptr capacity = instanceStream.regionSize;
+        GLintptr base = instanceStream.write(encode(instances, count), count * stride());
+        uploadedBytes += count * stride();
+        if (instanceStream.regionSize != capacity) {
+            pointedBuffer = 0; // grown into a new buffer, which may have been given the old one's name
+        }
+
+        // Split the list into runs of equal state
+        Run *runs = frameArena.allocate<Run>(count);
+        size_t runCount = 0;
+        for (size_t start = 0; start < count;) {
+            uint64_t key = list.commands[start].key;
+            bool handles = bindless && list.shaders[DrawList::shaderOf(key)]->bindless;
+            uint64_t (*stateOf)(uint64_t) = handles ? DrawList::programStateOf : DrawList::stateOf;
+            const DrawList::TextureBinding &binding = list.textures[DrawList::textureOf(key)];
+            GLint firstVertex = vertexId ? 0 : binding.firstVertex;
+            size_t end = start + 1;
+            while (end < count && stateOf(list.commands[end].key) == stateOf(key) &&
+                   (vertexId || list.textures[DrawList::textureOf(list.commands[end].key)].firstVertex == firstVertex)) {
+                end++;
+            }
+            GLsizei vertices = vertexId || !binding.vertexCount ? vertexCount : binding.vertexCount;
+            runs[runCount++] = {key, (GLuint)start, (GLuint)(end - start), handles, firstVertex, vertices};
+            start = end;
+        }
+
+        // With base instances the attributes stay at the start of the upload and each
+        // draw names its first instance; GL 4.0 has no such parameter and requires the
+        // indirect field to be 0, so runs repoint instead. Indirect submission streams
+        // one command per run up front.
+        if (glExt.baseInstance) {
+            pointInstanceAttribs(base);
+        }
+        GLintptr commandBase = 0;
+        if (indirect) {
+            DrawArraysIndirectCommand *commands = frameArena.allocate<DrawArraysIndirectCommand>(runCount);
+            for (size_t r = 0; r < runCount; r++) {
+                commands[r] = {(GLuint)runs[r].vertices, runs[r].count * views, (GLuint)runs[r].firstVertex,
+                               glExt.baseInstance ? runs[r].first : 0};
+            }
+            commandBase = indirectStream.write(commands, runCount * sizeof(DrawArraysIndirectCommand));
+            glState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectStream.buffer);
+        }
+
+        int shader = -1, texture = -1, translucent = -1;
+        for (size_t r = 0; r < runCount;) {
+            uint64_t key = runs[r].key;
+            if ((int)DrawList::translucentOf(key) != translucent) {
+                translucent = DrawList::translucentOf(key);
+                if (translucent) {
+                    glState.enable(GL_BLEND);
+                } else {
+                    glState.disable(GL_BLEND);
+                }
+                glState.depthMask(translucent ? GL_FALSE : GL_TRUE);
+                stateChanges++;
+            }
+            if (DrawList::shaderOf(key) != shader) {
+                shader = DrawList::shaderOf(key);
+                list.shaders[shader]->use();
+                stateChanges++;
+            }
+            if (!runs[r].handles && DrawList::textureOf(key) != texture) {
+                texture = DrawList::textureOf(key);
+                glState.bindTexture(0, list.textures[texture].texture, list.textures[texture].target);
+                glState.bindSampler(0, list.textures[texture].sampler);
+                stateChanges++;
+            }
+
+            // The following runs that split only on layer need no state change of their own
+            size_t last = r + 1;
+            while (last < runCount && sameState(runs[r], runs[last])) {
+                last++;
+            }
+            if (indirect && glExt.baseInstance && glExt.multiDrawIndirect) {
+                glExt.MultiDrawArraysIndirect(GL_TRIANGLE_STRIP, (GLvoid*)(commandBase + r * sizeof(DrawArraysIndirectCommand)),
+                                              (GLsizei)(last - r), 0);
+                drawCalls++;
+                r = last;
+                continue;
+            }
+            for (; r < last; r++) {
+                // Without base instances, each run starts its attributes at its own offset
+                if (!glExt.baseInstance) {
+                    pointInstanceAttribs(base + runs[r].first * stride());
+                }
+                if (indirect) {
+                    glDrawArraysIndirect(GL_TRIANGLE_STRIP, (GLvoid*)(commandBase + r * sizeof(DrawArraysIndirectCommand)));
+                } else if (glExt.baseInstance) {
+                    glExt.DrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, runs[r].firstVertex, runs[r].vertices,
+                                                          (GLsizei)(runs[r].count * views), runs[r].first);
+                } else {
+                    glDrawArraysInstanced(GL_TRIANGLE_STRIP, runs[r].firstVertex, runs[r].vertices, (GLsizei)(runs[r].count * views));
+                }
+                drawCalls++;
+            }
+        }
+
+        glState.depthMask(GL_TRUE);
+    }
+
+    // The instances as they are streamed: themselves, or packed into frame memory.
+    // Callers keeping instances in their own buffer upload them through this too.
+    const void *encode(const SpriteInstance *instances, size_t count) const {
+        if (!packed) {
+            return instances;
+        }
+        unsigned char *bytes = frameArena.allocate<unsigned char>(count * stride());
+        packSpriteInstances(instances, count, bytes, stride());
+        return bytes;
+    }
+
+    // Draw count instances kept in a caller's own buffer, from first, blended with one
+    // program and texture; for retained geometry that is not re-uploaded every frame.
+    // The bindless handles must already be in the instances. Leaves the stream's
+    // attributes to be repointed by the next submit; with base instances, draws from
+    // the same buffer share one pointing.
+    void drawRetained(GLuint buffer, GLuint first, GLsizei count, ShaderProgram *program, GLuint texture, GLuint sampler) {
+        if (count <= 0) {
+            return;
+        }
+        glState.bindVertexArray(VAO);
+        stepInstances();
+        pointInstanceAttribs(glExt.baseInstance ? 0 : first * stride(), buffer);
+        glState.enable(GL_BLEND);
+        glState.depthMask(GL_FALSE);
+        program->use();
+        if (!program->bindless) {
+            glState.bindTexture(0, texture);
+            glState.bindSampler(0, sampler);
+        }
+        if (glExt.baseInstance) {
+            glExt.DrawArraysInstancedBaseInstance(GL_TRIANGLE_STRIP, 0, vertexCount, count * views, first);
+        } else {
+            glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, vertexCount, count * views);
+        }
+        glState.depthMask(GL_TRUE);
+        drawCalls++;
+    }
+
+    // Stream instances with another upload strategy from the next frame on; used by
+    // the upload benchmark
+    void setUploadStrategy(UploadStrategy strategy) {
+        GLsizeiptr bytes = instanceStream.regionSize;
+        instanceStream.release();
+        instanceStream.strategy = strategy;
+        instanceStream.setup(bytes);
+        pointedBuffer = 0;
+    }
+
+    // Delete the batch's GL objects; must run while the context is still current
+    void release() {
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, VAO);
+        glState.deleteVertexArrays(1, &VAO);
+        VAO = 0;
+        pointedBuffer = 0;
+        instanceStream.release();
+        indirectStream.release();
+    }
+
+    // Direct state access: read one instance attribute from the shared binding
+    void instanceFormat(const InstanceAttrib &a) {
+        glExt.VertexArrayAttribFormat(VAO, a.index, a.size, a.type, a.normalized, a.offset);
+        glExt.VertexArrayAttribBinding(VAO, a.index, INSTANCE_BINDING);
+        glExt.EnableVertexArrayAttrib(VAO, a.index);
+    }
+
+    // Step the instance attributes once per views instances; the fallback edits the
+    // bound VAO, so it must be this batch's
+    void stepInstances() {
+        if (views == divisor) {
+            return;
+        }
+        divisor = views;
+        if (glExt.directStateAccess) {
+            glExt.VertexArrayBindingDivisor(VAO, INSTANCE_BINDING, (GLuint)divisor);
+            return;
+        }
+        for (GLuint attrib = PLACEMENT_ATTRIB; attrib <= (bindless ? TEXTURE_ATTRIB : LAYER_ATTRIB); attrib++) {
+            glVertexAttribDivisor(attrib, (GLuint)divisor);
+        }
+    }
+
+    // Point the per-instance attributes at the given byte offset of the instance stream,
+    // or of another buffer of SpriteInstances, unless they already read there; the
+    // fallback edits the bound VAO, so it must be this batch's
+    void pointInstanceAttribs(size_t base, GLuint buffer = 0) {
+        buffer = buffer ? buffer : instanceStream.buffer;
+        if (buffer == pointedBuffer && base == pointedBase) {
+            return;
+        }
+        pointedBuffer = buffer;
+        pointedBase = base;
+        if (glExt.directStateAccess) {
+            glExt.VertexArrayVertexBuffer(VAO, INSTANCE_BINDING, buffer, base, stride());
+            return;
+        }
+        glState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+        for (int i = 0; i < INSTANCE_ATTRIBS; i++) {
+            const InstanceAttrib &a = instanceAttribs()[i];
+            glVertexAttribPointer(a.index, a.size, a.type, a.normalized, stride(), (GLvoid*)(base + a.offset));
+        }
+        if (bindless) {
+            glVertexAttribIPointer(TEXTURE_ATTRIB, 2, GL_UNSIGNED_INT, stride(), (GLvoid*)(base + textureOffset()));
+        }
+    }
+};
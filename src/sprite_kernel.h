@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+#include <immintrin.h>
+#endif
+
+// A snapshot's render fields, one array per field: centre at this tick and the one
+// before, size, and the rotation the vertex shader applies
+struct SpriteSoA {
+    const float *x, *y, *prevX, *prevY, *width, *height, *angle, *spin;
+};
+
+// Render extract for sprites [begin, end) in one pass: each centre interpolated
+// between ticks by alpha, packed with the size as SpriteInstance::placement into
+// placement[i], and whether the sprite reaches into the view [0, viewW] x [0, viewH]
+// into visible[i]. Sprites that turn are tested by their bounding circle. placement
+// is 16-byte aligned, so the SSE2 path transposes four sprites' fields into four
+// placements per step and stores each whole. An eight-wide AVX version was no
+// faster: the loop is bound by those stores, not the arithmetic.
+
+inline void placeSpritesScalar(SpriteSoA s, uint32_t begin, uint32_t end, float alpha, float viewW, float viewH,
+                               glm::aligned_vec4 *placement, uint8_t *visible) {
+    for (uint32_t i = begin; i < end; i++) {
+        float cx = s.prevX[i] + alpha * (s.x[i] - s.prevX[i]), cy = s.prevY[i] + alpha * (s.y[i] - s.prevY[i]);
+        float hw = s.width[i] * 0.5f, hh = s.height[i] * 0.5f;
+        if (s.angle[i] != 0.0f || s.spin[i] != 0.0f) {
+            hw = hh = std::sqrt(hw * hw + hh * hh);
+        }
+        placement[i] = glm::aligned_vec4(cx, cy, s.width[i], s.height[i]);
+        visible[i] = cx + hw > 0.0f && cx - hw < viewW && cy + hh > 0.0f && cy - hh < viewH;
+    }
+}
+
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+// Four sprites' centres and sizes as four placements
+inline void storePlacements(glm::aligned_vec4 *out, __m128 cx, __m128 cy, __m128 w, __m128 h) {
+    _MM_TRANSPOSE4_PS(cx, cy, w, h);
+    _mm_store_ps(&out[0].x, cx);
+    _mm_store_ps(&out[1].x, cy);
+    _mm_store_ps(&out[2].x, w);
+    _mm_store_ps(&out[3].x, h);
+}
+
+// Four lanes of a movemask as four 0/1 bytes
+inline void storeVisible(uint8_t *out, int mask) {
+    static const uint32_t spread[16] = {0x00000000, 0x00000001, 0x00000100, 0x00000101, 0x00010000, 0x00010001,
+                                        0x00010100, 0x00010101, 0x01000000, 0x01000001, 0x01000100, 0x01000101,
+                                        0x01010000, 0x01010001, 0x01010100, 0x01010101};
+    std::memcpy(out, &spread[mask & 15], 4);
+}
+
+inline void placeSpritesSse2(SpriteSoA s, uint32_t begin, uint32_t end, float alpha, float viewW, float viewH,
+                             glm::aligned_vec4 *placement, uint8_t *visible) {
+    const __m128 va = _mm_set1_ps(alpha), half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+    const __m128 vw = _mm_set1_ps(viewW), vh = _mm_set1_ps(viewH);
+    uint32_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 px = _mm_loadu_ps(s.prevX + i), py = _mm_loadu_ps(s.prevY + i);
+        __m128 cx = _mm_add_ps(px, _mm_mul_ps(va, _mm_sub_ps(_mm_loadu_ps(s.x + i), px)));
+        __m128 cy = _mm_add_ps(py, _mm_mul_ps(va, _mm_sub_ps(_mm_loadu_ps(s.y + i), py)));
+        __m128 w = _mm_loadu_ps(s.width + i), h = _mm_loadu_ps(s.height + i);
+        __m128 hw = _mm_mul_ps(w, half), hh = _mm_mul_ps(h, half);
+        __m128 turns = _mm_or_ps(_mm_cmpneq_ps(_mm_loadu_ps(s.angle + i), zero), _mm_cmpneq_ps(_mm_loadu_ps(s.spin + i), zero));
+        __m128 radius = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(hw, hw), _mm_mul_ps(hh, hh)));
+        hw = _mm_or_ps(_mm_and_ps(turns, radius), _mm_andnot_ps(turns, hw));
+        hh = _mm_or_ps(_mm_and_ps(turns, radius), _mm_andnot_ps(turns, hh));
+        __m128 inX = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(cx, hw), zero), _mm_cmplt_ps(_mm_sub_ps(cx, hw), vw));
+        __m128 inY = _mm_and_ps(_mm_cmpgt_ps(_mm_add_ps(cy, hh), zero), _mm_cmplt_ps(_mm_sub_ps(cy, hh), vh));
+        storeVisible(visible + i, _mm_movemask_ps(_mm_and_ps(inX, inY)));
+        storePlacements(placement + i, cx, cy, w, h);
+    }
+    placeSpritesScalar(s, i, end, alpha, viewW, viewH, placement, visible);
+}
+#endif
+
+inline void placeSprites(SpriteSoA s, uint32_t begin, uint32_t end, float alpha, float viewW, float viewH,
+                         glm::aligned_vec4 *placement, uint8_t *visible) {
+#if GLM_ARCH & GLM_ARCH_SSE2_BIT
+    placeSpritesSse2(s, begin, end, alpha, viewW, viewH, placement, visible);
+#else
+    placeSpritesScalar(s, begin, end, alpha, viewW, viewH, placement, visible);
+#endif
+}
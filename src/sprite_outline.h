@@ -0,0 +1,143 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+// Tight convex outline of a sprite image, drawn in place of its whole quad so the
+// clear corners cost no fragment shading. add() collects the corners of each row's
+// outermost texels with any alpha, padded by a texel for bilinear filtering; finish()
+// takes their convex hull and then, while it has more than MAX_VERTICES corners,
+// removes the edge whose two neighbours, extended until they meet, add the least
+// area, so the outline only ever grows and still contains every visible texel. An
+// outline that would cover nearly the whole quad, or cannot be cut down inside it,
+// is dropped and the sprite keeps its quad. Points are region-local: u right, v down
+// in [0, 1], as image rows and texRect run.
+struct SpriteOutline {
+    static const int MAX_VERTICES = 8;
+    static constexpr float MAX_COVERAGE = 0.85f; // of the quad; above it the quad is as cheap
+
+    std::vector<glm::vec2> points; // candidates from add(), then the outline, counter-clockwise in (u, v)
+    float coverage = 1.0f;         // outline area / quad area
+
+    bool empty() const {
+        return points.empty();
+    }
+
+    // Collect a w x h region of an alpha plane (one byte per texel, stride texels per
+    // row); every region added is fitted to the same unit square, so the frames of a
+    // flipbook or the layers of a texture array share one outline
+    void add(const unsigned char *alpha, int stride, int x, int y, int w, int h) {
+        for (int r = 0; r < h; r++) {
+            const unsigned char *row = alpha + (size_t)(y + r) * stride + x;
+            int left = -1, right = -1;
+            for (int c = 0; c < w; c++) {
+                if (row[c]) {
+                    left = left < 0 ? c : left;
+                    right = c;
+                }
+            }
+            if (left < 0) {
+                continue;
+            }
+            float u0 = std::max(left - 1, 0) / (float)w, u1 = std::min(right + 2, w) / (float)w;
+            float v0 = std::max(r - 1, 0) / (float)h, v1 = std::min(r + 2, h) / (float)h;
+            points.insert(points.end(), {glm::vec2(u0, v0), glm::vec2(u0, v1), glm::vec2(u1, v0), glm::vec2(u1, v1)});
+        }
+    }
+
+    static float cross(const glm::vec2 &o, const glm::vec2 &a, const glm::vec2 &b) {
+        return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+    }
+
+    // Replace the collected points with the outline; empty if the quad should be kept
+    void finish() {
+        if (points.size() < 3) {
+            points.clear();
+            return;
+        }
+        // Andrew's monotone chain
+        std::sort(points.begin(), points.end(),
+                  [](const glm::vec2 &a, const glm::vec2 &b) { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+        std::vector<glm::vec2> hull(points.size() * 2);
+        size_t k = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            while (k >= 2 && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f) {
+                k--;
+            }
+            hull[k++] = points[i];
+        }
+        for (size_t i = points.size() - 1, lower = k + 1; i-- > 0;) {
+            while (k >= lower && cross(hull[k - 2], hull[k - 1], points[i]) <= 0.0f) {
+                k--;
+            }
+            hull[k++] = points[i];
+        }
+        hull.resize(k - 1);
+
+        while (hull.size() > (size_t)MAX_VERTICES && removeCheapestEdge(hull)) {
+        }
+        float area = 0.0f;
+        for (size_t i = 0; i < hull.size(); i++) {
+            area += cross(glm::vec2(0.0f), hull[i], hull[(i + 1) % hull.size()]) * 0.5f;
+        }
+        coverage = std::fabs(area);
+        points = hull;
+        if (points.size() > (size_t)MAX_VERTICES || coverage > MAX_COVERAGE) {
+            points.clear();
+            coverage = 1.0f;
+        }
+    }
+
+    // Merge the edge that grows the polygon least into the meeting point of its
+    // neighbours; false if no edge can go without leaving the unit square
+    static bool removeCheapestEdge(std::vector<glm::vec2> &hull) {
+        const size_t n = hull.size();
+        float best = INFINITY;
+        size_t bestEdge = 0;
+        glm::vec2 bestPoint(0.0f);
+        for (size_t i = 0; i < n; i++) {
+            const glm::vec2 &before = hull[(i + n - 1) % n], &a = hull[i], &b = hull[(i + 1) % n], &after = hull[(i + 2) % n];
+            glm::vec2 d1 = a - before, d2 = b - after;
+            float denominator = d1.x * d2.y - d1.y * d2.x;
+            if (std::fabs(denominator) < 1e-9f) {
+                continue; // parallel neighbours never meet
+            }
+            glm::vec2 w = b - a;
+            float t = (w.x * d2.y - w.y * d2.x) / denominator, s = (w.x * d1.y - w.y * d1.x) / denominator;
+            glm::vec2 meet = a + d1 * t;
+            if (t <= 0.0f || s <= 0.0f || meet.x < -1e-5f || meet.x > 1.0f + 1e-5f || meet.y < -1e-5f || meet.y > 1.0f + 1e-5f) {
+                continue; // they diverge past the edge, or meet outside the quad
+            }
+            float added = std::fabs(cross(a, meet, b)) * 0.5f;
+            if (added < best) {
+                best = added;
+                bestEdge = i;
+                bestPoint = glm::clamp(meet, glm::vec2(0.0f), glm::vec2(1.0f));
+            }
+        }
+        if (best == INFINITY) {
+            return false;
+        }
+        hull[bestEdge] = bestPoint;
+        hull.erase(hull.begin() + (bestEdge + 1) % n);
+        return true;
+    }
+
+    // The outline as a triangle strip in the unit quad's vertex layout (position xyz
+    // centred on the origin, y up; texture coordinates st, t up), zig-zagging from
+    // the first point so a convex polygon needs no more vertices than corners.
+    // Returns the vertex count; out has room for MAX_VERTICES * 5 floats.
+    int stripVertices(GLfloat *out) const {
+        const int n = (int)points.size();
+        for (int i = 0; i < n; i++) {
+            int p = i % 2 ? (i + 1) / 2 : (n - i / 2) % n; // 0, 1, n-1, 2, n-2, ...
+            const glm::vec2 &uv = points[p];
+            GLfloat vertex[5] = {uv.x - 0.5f, 0.5f - uv.y, 0.0f, uv.x, 1.0f - uv.y};
+            std::copy(vertex, vertex + 5, out + i * 5);
+        }
+        return n;
+    }
+};
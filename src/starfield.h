@@ -0,0 +1,32 @@
+#pragma once
+
+#include <glad/glad.h>
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+
+// Procedural parallax starfield: one fullscreen triangle whose fragment shader
+// places stars by hashing grid cells, so it has no vertex data and no per-frame
+// CPU work at all: it scrolls with the wrapped clock of the View block, and its
+// layers are built to repeat after ViewTransform::CLOCK_PERIOD. The core profile
+// still needs a vertex array bound to draw, so an empty one is kept for it.
+struct Starfield {
+    GLuint VAO = 0;
+
+    void setup() {
+        VAO = createVertexArray();
+        memoryStats.trackGl(GL_VERTEX_ARRAY, VAO, MEM_BUFFERS, 0);
+    }
+
+    // Fill the target with the stars; the program must be in use
+    void draw() {
+        glState.bindVertexArray(VAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+
+    void release() {
+        memoryStats.untrackGl(GL_VERTEX_ARRAY, VAO);
+        glState.deleteVertexArrays(1, &VAO);
+        VAO = 0;
+    }
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+
+// Hash of the simulation state after a tick, for catching the first tick on which
+// two runs that should agree (a replay and its recording, two racing cabinets, the
+// game on one thread and on many) stop agreeing. Each field is hashed as raw bytes
+// with xxHash64's round: four independent 64-bit accumulators over 32-byte stripes,
+// so the multiplies of neighbouring lanes overlap in the pipeline, at several bytes
+// per cycle. Order-dependent: the same state laid out differently hashes differently,
+// which is what a determinism check wants. Not a cryptographic hash.
+struct StateHash {
+    static const uint64_t P1 = 11400714785074694791ull, P2 = 14029467366897019727ull;
+    static const uint64_t P3 = 1609587929392839161ull, P4 = 9650029242287828579ull, P5 = 2870177450012600261ull;
+
+    uint64_t value = P5;
+
+    static uint64_t rotl(uint64_t x, int r) {
+        return (x << r) | (x >> (64 - r));
+    }
+
+    static uint64_t round(uint64_t acc, uint64_t lane) {
+        return rotl(acc + lane * P2, 31) * P1;
+    }
+
+    static uint64_t read64(const unsigned char *p) {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    // Hash of one block of bytes, seeded
+    static uint64_t block(const void *data, size_t size, uint64_t seed) {
+        const unsigned char *p = (const unsigned char *)data, *end = p + size;
+        uint64_t h;
+        if (size >= 32) {
+            uint64_t a = seed + P1 + P2, b = seed + P2, c = seed, d = seed - P1;
+            for (; p + 32 <= end; p += 32) {
+                a = round(a, read64(p));
+                b = round(b, read64(p + 8));
+                c = round(c, read64(p + 16));
+                d = round(d, read64(p + 24));
+            }
+            h = rotl(a, 1) + rotl(b, 7) + rotl(c, 12) + rotl(d, 18);
+            for (uint64_t acc : {a, b, c, d}) {
+                h = (h ^ round(0, acc)) * P1 + P4;
+            }
+        } else {
+            h = seed + P5;
+        }
+        h += size;
+        for (; p + 8 <= end; p += 8) {
+            h = rotl(h ^ round(0, read64(p)), 27) * P1 + P4;
+        }
+        for (; p < end; p++) {
+            h = rotl(h ^ (*p * P5), 11) * P1;
+        }
+        h ^= h >> 33;
+        h *= P2;
+        h ^= h >> 29;
+        h *= P3;
+        return h ^ (h >> 32);
+    }
+
+    // Fold a field into the hash; the running value seeds it, so order matters
+    void add(const void *data, size_t size) {
+        value = block(data, size, value);
+    }
+
+    template <typename T>
+    void add(const T &field) {
+        add(&field, sizeof(field));
+    }
+
+    // 32 bits of it, as replays store
+    uint32_t folded() const {
+        return (uint32_t)(value ^ (value >> 32));
+    }
+};
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cstring>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+
+// How a StreamBuffer gets each frame's data to the GPU
+enum UploadStrategy {
+    UPLOAD_AUTO,           // persistent where ARB_buffer_storage allows, else unsynchronized
+    UPLOAD_PERSISTENT,     // one persistent, coherent mapping, written in place
+    UPLOAD_UNSYNCHRONIZED, // each write maps its range with GL_MAP_UNSYNCHRONIZED_BIT
+    UPLOAD_ORPHAN,         // glBufferData(nullptr) each frame, then glBufferSubData into the fresh storage
+    UPLOAD_SUBDATA,        // glBufferSubData into the same storage, leaving synchronization to the driver
+    UPLOAD_STRATEGIES
+};
+
+static const char *const UPLOAD_STRATEGY_NAMES[UPLOAD_STRATEGIES] = {"auto", "persistent", "unsynchronized", "orphan", "subdata"};
+
+// The strategy named name, or UPLOAD_STRATEGIES if there is none
+inline UploadStrategy findUploadStrategy(const char *name) {
+    for (int s = 0; s < UPLOAD_STRATEGIES; s++) {
+        if (std::strcmp(UPLOAD_STRATEGY_NAMES[s], name) == 0) {
+            return (UploadStrategy)s;
+        }
+    }
+    return UPLOAD_STRATEGIES;
+}
+
+// Ring of per-frame regions in one GL buffer for streaming vertex data.
+// Each frame writes only into its own region; a fence placed after the frame's
+// draws guards the region until the GPU is done reading it. With
+// ARB_buffer_storage the buffer is persistently mapped; otherwise each write maps
+// its range with GL_MAP_UNSYNCHRONIZED_BIT, relying on the same fences. Maps go
+// through gl_objects.h, so under direct state access writes touch no binding.
+// The orphaning and glBufferSubData strategies, kept to compare against
+// (--upload-bench), use a single region and no fences: the driver renames or waits.
+struct StreamBuffer {
+    static const int REGIONS = 3;
+
+    GLuint buffer = 0;
+    GLenum target = GL_ARRAY_BUFFER;
+    const char *name = "stream"; // its label in frame debuggers (gl_markers.h)
+    GLsizeiptr regionSize = 0;
+    GLsync fences[REGIONS] = {};
+    int region = 0;
+    GLsizeiptr used = 0; // bytes written into the current region
+    unsigned char *mapped = nullptr; // persistent mapping, if any
+    int stalls = 0; // times a region was still in use by the GPU when needed
+    UploadStrategy strategy = UPLOAD_AUTO; // set before setup()
+
+    void setup(GLsizeiptr bytesPerFrame) {
+        if (strategy == UPLOAD_AUTO || (strategy == UPLOAD_PERSISTENT && !glExt.bufferStorage)) {
+            strategy = glExt.bufferStorage ? UPLOAD_PERSISTENT : UPLOAD_UNSYNCHRONIZED;
+        }
+        allocate(bytesPerFrame > 0 ? bytesPerFrame : 4096);
+    }
+
+    bool fenced() const {
+        return strategy == UPLOAD_PERSISTENT || strategy == UPLOAD_UNSYNCHRONIZED;
+    }
+
+    // Fence the region written last frame and move to the next one, waiting for it if
+    // needed; or orphan the storage, for that strategy
+    void beginFrame() {
+        if (!fenced()) {
+            if (strategy == UPLOAD_ORPHAN && used > 0) {
+                bufferData(target, buffer, regionSize, nullptr, GL_STREAM_DRAW);
+            }
+            used = 0;
+            return;
+        }
+        if (used > 0) {
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            region = (region + 1) % REGIONS;
+        }
+        used = 0;
+        waitRegion(region);
+    }
+
+    // Copy data into this frame's region and return its byte offset inside the buffer.
+    // Growing reallocates, and so renames the buffer, and may stall once.
+    GLintptr write(const void *data, GLsizeiptr bytes) {
+        if (used + bytes > regionSize) {
+            GLsizeiptr size = regionSize;
+            while (used + bytes > size) {
+                size *= 2;
+            }
+            release();
+            allocate(size);
+        }
+
+        GLintptr offset = region * regionSize + used;
+        if (mapped) {
+            std::memcpy(mapped + offset, data, bytes);
+        } else if (!fenced()) {
+            bufferSubData(target, buffer, offset, bytes, data);
+        } else {
+            void *dst = mapBufferRange(target, buffer, offset, bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+            std::memcpy(dst, data, bytes);
+            unmapBuffer(target, buffer);
+        }
+        used += bytes;
+        return offset;
+    }
+
+    void release() {
+        for (int i = 0; i < REGIONS; i++) {
+            waitRegion(i);
+        }
+        if (buffer) {
+            if (mapped) {
+                unmapBuffer(target, buffer);
+                mapped = nullptr;
+            }
+            memoryStats.untrackGl(GL_BUFFER, buffer);
+            glState.deleteBuffers(1, &buffer);
+            buffer = 0;
+        }
+        region = 0;
+        used = 0;
+    }
+
+    void allocate(GLsizeiptr bytesPerRegion) {
+        regionSize = bytesPerRegion;
+        GLsizeiptr size = regionSize * (fenced() ? REGIONS : 1);
+        if (strategy == UPLOAD_PERSISTENT) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            buffer = createBufferStorage(target, size, nullptr, flags);
+            mapped = (unsigned char *)mapBufferRange(target, buffer, 0, size, flags);
+        } else {
+            buffer = createBuffer(target, size, nullptr, GL_STREAM_DRAW);
+        }
+        memoryStats.trackGl(GL_BUFFER, buffer, MEM_BUFFERS, size);
+        glMarkers.label(GL_BUFFER, buffer, name);
+    }
+
+    void waitRegion(int i) {
+        if (!fences[i]) {
+            return;
+        }
+        GLenum status = glClientWaitSync(fences[i], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            stalls++;
+            while (glClientWaitSync(fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+            }
+        }
+        glDeleteSync(fences[i]);
+        fences[i] = nullptr;
+    }
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <fcntl.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+#include "game_clock.h"
+#include "lockfree_queue.h"
+#include "shard_counters.h"
+#include "thread_config.h"
+
+// Kinds of telemetry record, and what their fields hold
+enum TelemetryKind : uint16_t {
+    TELEMETRY_SESSION_START, // count = sim rate, value = seed
+    TELEMETRY_FRAME,         // count = frame, value = frame ms, extra = GPU ms or -1
+    TELEMETRY_HITCH,         // count = frame, value = frame ms, extra = budget ms
+    TELEMETRY_COLLISION,     // count = tick
+    TELEMETRY_SESSION_END,   // count = frames, value = seconds played, extra = ticks
+    TELEMETRY_COUNTER        // count = CounterId, value = its total (shard_counters.h); thread = THREAD_SLOTS
+};
+
+// One fixed-size record; files are a TelemetryHeader followed by these, raw
+struct TelemetryRecord {
+    uint64_t time; // gameClock ticks
+    uint16_t kind;
+    uint16_t thread; // ring slot of the writer
+    uint32_t count;
+    double value, extra;
+};
+
+static_assert(sizeof(TelemetryRecord) == 32, "TelemetryRecord is written to disk as is");
+
+struct TelemetryHeader {
+    static const uint32_t MAGIC = 0x4C545453; // "STTL"
+    static const uint32_t VERSION = 1;
+
+    uint32_t magic;
+    uint32_t version;
+    uint64_t frequency; // gameClock ticks per second
+    int64_t startedAt;  // unix seconds; names the session's files
+    uint32_t part;      // rotation index, or UINT32_MAX for the crash file
+    uint32_t recordSize;
+};
+
+// Binary session telemetry for operations: frame times, hitches, collisions and
+// session length. event() appends a record to the calling thread's SpscQueue,
+// claimed from a fixed table on its first event, so logging is a timer read and a
+// few stores with no lock or allocation. A drain thread empties the rings every
+// DRAIN_INTERVAL into DIR/telemetry-<start>-<part>.bin, starting a new part at
+// MAX_FILE_BYTES and deleting the oldest beyond MAX_FILES. A full ring drops the
+// record and counts it. If the process dies on a fatal signal, the handler writes
+// every record not yet drained to DIR/telemetry-<start>-crash.bin with raw writes
+// before the default action runs. Every COUNTER_INTERVAL, and once more at stop,
+// the drain thread also writes the total of each sharded counter that has moved.
+struct Telemetry {
+    static const int THREAD_SLOTS = 8; // events of threads beyond these are dropped
+    static const uint32_t RING_CAPACITY = 4096;
+    static constexpr double DRAIN_INTERVAL = 0.25; // seconds
+    static const uint64_t MAX_FILE_BYTES = 4 << 20;
+    static const uint32_t MAX_FILES = 8;
+    static constexpr double COUNTER_INTERVAL = 1.0; // seconds between counter records
+
+    using Ring = SpscQueue<TelemetryRecord, RING_CAPACITY>;
+
+    bool enabled = false;
+    std::string directory;
+    int64_t startedAt = 0;
+    Ring rings[THREAD_SLOTS];
+    std::atomic<int> ringCount{0};
+    std::atomic<uint64_t> dropped{0};
+    char crashPath[512] = {};
+    std::thread drainer;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    std::atomic<bool> running{false};
+    FILE *out = nullptr; // the drain thread's
+    uint32_t part = 0;
+    uint64_t partBytes = 0;
+    uint64_t written = 0; // records on disk
+    uint64_t countersAt = 0; // gameClock time of the last counter records
+    ShardedCounters::Totals countersWritten;
+
+    bool start(const std::string &dir) {
+        std::error_code ec;
+        std::filesystem::create_directories(dir, ec);
+        directory = dir;
+        startedAt = (int64_t)std::time(nullptr);
+        if (!openPart()) {
+            return false;
+        }
+        std::snprintf(crashPath, sizeof(crashPath), "%s/telemetry-%lld-crash.bin", directory.c_str(), (long long)startedAt);
+        for (int sig : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+            std::signal(sig, crashHandler);
+        }
+        enabled = true;
+        running = true;
+        drainer = std::thread([this] { drainLoop(); });
+        return true;
+    }
+
+    // Append one record from any thread; a no-op while disabled
+    void event(TelemetryKind kind, uint32_t count = 0, double value = 0.0, double extra = 0.0) {
+        if (!enabled) {
+            return;
+        }
+        int slot = threadSlot();
+        if (slot >= THREAD_SLOTS || !rings[slot].push({gameClock.now(), kind, (uint16_t)slot, count, value, extra})) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // The calling thread's ring, claimed on its first event; THREAD_SLOTS once they are all taken
+    int threadSlot() {
+        static thread_local int slot = -1;
+        if (slot < 0) {
+            slot = ringCount.fetch_add(1, std::memory_order_acq_rel);
+        }
+        return slot;
+    }
+
+    void drainLoop() {
+        configureThread(THREAD_IO, "telemetry");
+        auto interval = std::chrono::duration<double>(DRAIN_INTERVAL);
+        while (running) {
+            drain();
+            std::unique_lock<std::mutex> lock(wakeLock);
+            wake.wait_for(lock, interval, [this] { return !running; });
+        }
+    }
+
+    // Move every queued record to the current part, then the counters that moved
+    // since they were last written, if they are due
+    void drain(bool final = false) {
+        int used = std::min(ringCount.load(std::memory_order_acquire), THREAD_SLOTS);
+        bool wrote = false;
+        for (int i = 0; i < used; i++) {
+            while (TelemetryRecord *record = rings[i].front()) {
+                wrote |= write(*record);
+                rings[i].popFront();
+            }
+        }
+        uint64_t now = gameClock.now();
+        if (final || (double)(now - countersAt) >= COUNTER_INTERVAL * (double)gameClock.frequency) {
+            countersAt = now;
+            ShardedCounters::Totals totals = counters.totals();
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                if (totals.values[c] != countersWritten.values[c]) {
+                    wrote |= write({now, TELEMETRY_COUNTER, (uint16_t)THREAD_SLOTS, (uint32_t)c, (double)totals.values[c], 0.0});
+                    countersWritten.values[c] = totals.values[c];
+                }
+            }
+        }
+        if (wrote) {
+            std::fflush(out);
+        }
+    }
+
+    // Append a record to the current part, rotating as parts fill
+    bool write(const TelemetryRecord &record) {
+        if (out && partBytes + sizeof(TelemetryRecord) > MAX_FILE_BYTES) {
+            std::fclose(out);
+            part++;
+            openPart();
+        }
+        if (!out || std::fwrite(&record, sizeof(TelemetryRecord), 1, out) != 1) {
+            return false;
+        }
+        partBytes += sizeof(TelemetryRecord);
+        written++;
+        return true;
+    }
+
+    bool openPart() {
+        out = std::fopen(partPath(part).c_str(), "wb");
+        if (!out) {
+            return false;
+        }
+        TelemetryHeader header = {TelemetryHeader::MAGIC, TelemetryHeader::VERSION, gameClock.frequency, startedAt, part,
+                                  (uint32_t)sizeof(TelemetryRecord)};
+        std::fwrite(&header, sizeof(header), 1, out);
+        partBytes = sizeof(header);
+        if (part >= MAX_FILES) {
+            std::error_code ec;
+            std::filesystem::remove(partPath(part - MAX_FILES), ec);
+        }
+        return true;
+    }
+
+    std::string partPath(uint32_t index) const {
+        return directory + "/telemetry-" + std::to_string(startedAt) + "-" + std::to_string(index) + ".bin";
+    }
+
+    // Signal handler: dump what the drain thread has not taken yet. Only open, write
+    // and close are called, and the rings are read without being consumed.
+    static void crashHandler(int sig);
+
+    void crashFlush() {
+        if (!enabled) {
+            return;
+        }
+#ifdef _WIN32
+        int fd = _open(crashPath, _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, 0644);
+#else
+        int fd = ::open(crashPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+        if (fd < 0) {
+            return;
+        }
+        TelemetryHeader header = {TelemetryHeader::MAGIC, TelemetryHeader::VERSION, gameClock.frequency, startedAt, UINT32_MAX,
+                                  (uint32_t)sizeof(TelemetryRecord)};
+        writeAll(fd, &header, sizeof(header));
+        int used = std::min(ringCount.load(std::memory_order_acquire), THREAD_SLOTS);
+        for (int i = 0; i < used; i++) {
+            rings[i].forEachPending([&](const TelemetryRecord &record) { writeAll(fd, &record, sizeof(record)); });
+        }
+#ifdef _WIN32
+        _close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+
+    static void writeAll(int fd, const void *data, size_t size) {
+#ifdef _WIN32
+        _write(fd, data, (unsigned)size);
+#else
+        ssize_t unused = ::write(fd, data, size);
+        (void)unused;
+#endif
+    }
+
+    // Drain what is left and close the last part
+    void stop() {
+        if (!enabled) {
+            return;
+        }
+        enabled = false;
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        drainer.join();
+        drain(true);
+        if (out) {
+            std::fclose(out);
+            out = nullptr;
+        }
+        for (int sig : {SIGSEGV, SIGABRT, SIGFPE, SIGILL}) {
+            std::signal(sig, SIG_DFL);
+        }
+        std::printf("Telemetry: %llu records in %u parts under %s, %llu dropped\n", (unsigned long long)written, part + 1,
+                    directory.c_str(), (unsigned long long)dropped.load());
+    }
+};
+
+inline Telemetry telemetry;
+
+inline void Telemetry::crashHandler(int sig) {
+    std::signal(sig, SIG_DFL);
+    telemetry.crashFlush();
+    std::raise(sig);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <stb_image.h>
+#include "asset_pack.h"
+#include "gl_objects.h"
+#include "memory_stats.h"
+#include "premultiplied_alpha.h"
+
+// Same-sized images as the layers of one GL_TEXTURE_2D_ARRAY, for sprites that come
+// in variants or frames of one size. Unlike an atlas region, a layer needs no padding
+// and no UV rect: it is sampled over [0, 1] with clamped edges, and each layer's mip
+// chain is filtered from that layer alone, so no level ever bleeds a neighbour in.
+struct TextureArrayImages {
+    int width = 0, height = 0, layers = 0;
+    std::vector<unsigned char> pixels; // premultiplied RGBA8, one layer after another, rows top down
+    std::string error;                 // why decode() failed
+
+    // Decode each file (or its copy in the asset pack) into the next layer; false if
+    // one cannot be read or differs in size from the first
+    bool decode(const std::vector<std::string> &paths) {
+        for (const std::string &path : paths) {
+            int w, h;
+            unsigned char *data = loadImage(path, &w, &h);
+            if (!data) {
+                error = "cannot read " + path;
+                return false;
+            }
+            if (layers > 0 && (w != width || h != height)) {
+                stbi_image_free(data);
+                error = path + " is not " + std::to_string(width) + "x" + std::to_string(height) + " like the others";
+                return false;
+            }
+            width = w;
+            height = h;
+            premultiplyAlpha(data, (size_t)w * h);
+            pixels.insert(pixels.end(), data, data + (size_t)w * h * 4);
+            stbi_image_free(data);
+            layers++;
+        }
+        if (layers == 0) {
+            error = "no images";
+        }
+        return layers > 0;
+    }
+
+    const unsigned char *layer(int i) const {
+        return pixels.data() + (size_t)i * width * height * 4;
+    }
+};
+
+// Mip levels from width x height down to 1x1
+inline int mipLevels(int width, int height) {
+    int levels = 1;
+    while ((width | height) >> levels) {
+        levels++;
+    }
+    return levels;
+}
+
+// New mipmapped GL_TEXTURE_2D_ARRAY holding the images, a layer each
+inline GLuint createTextureArray(const TextureArrayImages &images) {
+    int levels = mipLevels(images.width, images.height);
+    GLuint texture = createTexture2D(GL_TEXTURE_2D_ARRAY);
+    textureStorage2DArray(texture, levels, GL_RGBA8, images.width, images.height, images.layers);
+    memoryStats.trackGl(GL_TEXTURE, texture, MEM_TEXTURES,
+                        textureBytes(images.width, images.height, 4, levels) * images.layers);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    for (int i = 0; i < images.layers; i++) {
+        textureSubImage2DArray(texture, 0, 0, 0, i, images.width, images.height, GL_RGBA, GL_UNSIGNED_BYTE, images.layer(i));
+    }
+    generateMipmap(texture, GL_TEXTURE_2D_ARRAY);
+    return texture;
+}
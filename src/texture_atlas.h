@@ -0,0 +1,319 @@
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <stb_image.h>
+#include "alpha_mask.h"
+#include "asset_pack.h"
+#include "baked_texture.h"
+#include "block_compress.h"
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "image_decoder.h"
+#include "memory_stats.h"
+#include "premultiplied_alpha.h"
+#include "sampler_cache.h"
+#include "sprite_outline.h"
+#include "texture_format.h"
+
+// Every image of a directory (or of the asset pack) packed into one GL texture at startup.
+// Regions are addressed by file stem ("spaceship" for spaceship.png) and
+// expressed as a UV rect: xy = offset, zw = scale, in top-down image space.
+// The bake tool stores the packed result as BAKED_ATLAS in the same directory;
+// when that file is newer than every PNG it is mapped and uploaded as is.
+struct TextureAtlas {
+    static constexpr const char *BAKED_ATLAS = "atlas.stex";
+
+    GLuint texID = 0;
+    int width = 0, height = 0;
+    int levels = 1; // mip levels stored; choose a mipmapped sampler only if above 1
+    std::map<std::string, glm::vec4> regions;
+    std::vector<unsigned char> alpha; // level 0 alpha, one byte per texel, for alphaMask(); empty if unavailable
+
+    // Pixels left between packed images; border pixels are extruded into it
+    static const int PADDING = 2;
+
+    // Decoded source image waiting to be packed
+    struct Image {
+        std::string name;
+        int w, h;
+        unsigned char *pixels;
+        int x, y;
+    };
+
+    // Map the directory's baked atlas if it is newer than every PNG; false means
+    // the PNGs have to be packed with build() or compose()
+    bool loadBaked(const std::string &directory) {
+        std::string baked = directory + "/" + BAKED_ATLAS;
+        return bakeIsCurrent(directory, baked) && load(baked);
+    }
+
+    // Load every .png in the directory, shelf-pack them and upload the result
+    bool build(const std::string &directory) {
+        std::vector<unsigned char> pixels;
+        if (!compose(directory, pixels)) {
+            return false;
+        }
+        GLenum format = textureFormat.choose(pixels.data(), (size_t)width * height);
+        createTexture(1, format);
+        textureSubImage2D(texID, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        memoryStats.trackGl(GL_TEXTURE, texID, MEM_TEXTURES, textureBytes(width, height, TextureFormat::bytesPerTexel(format)));
+        return true;
+    }
+
+    // Map a baked atlas and upload its levels straight from the mapping
+    bool load(const std::string &path) {
+        BakedTexture baked;
+        return baked.open(path) && load(baked);
+    }
+
+    // Upload a baked atlas compiled into the executable
+    bool loadEmbedded(const unsigned char *bytes, size_t size) {
+        BakedTexture baked;
+        return baked.openMemory(bytes, size) && load(baked);
+    }
+
+    // Upload an opened container. Block-compressed bakes need the matching extension;
+    // without it this fails and the PNGs are used.
+    bool load(const BakedTexture &baked) {
+        if (!describe(baked)) {
+            return false;
+        }
+        // RGBA8 bakes are stored as textureFormat picks from level 0; compressed ones as baked
+        GLenum compressed = TextureFormat::compressed(baked.header->format);
+        GLenum format = compressed ? compressed : textureFormat.choose(baked.levelData(0), (size_t)width * height);
+        createTexture((int)baked.header->levelCount, format);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        int64_t bytes = 0;
+        for (uint32_t level = 0; level < baked.header->levelCount; level++) {
+            const BakedLevel &l = baked.levels[level];
+            bytes += compressed ? (int64_t)l.bytes : (int64_t)l.bytes / 4 * TextureFormat::bytesPerTexel(format);
+            if (compressed) {
+                compressedTextureSubImage2D(texID, level, 0, 0, l.width, l.height, compressed, (GLsizei)l.bytes,
+                                            baked.levelData(level));
+            } else {
+                textureSubImage2D(texID, level, 0, 0, l.width, l.height, GL_RGBA, GL_UNSIGNED_BYTE, baked.levelData(level));
+            }
+        }
+        memoryStats.trackGl(GL_TEXTURE, texID, MEM_TEXTURES, bytes);
+        return true;
+    }
+
+    // Take the size, regions and alpha of an opened container without uploading it,
+    // for when a TextureStreamer holds the texture; false if its format is unsupported
+    bool describe(const BakedTexture &baked) {
+        if (baked.header->format != BAKED_RGBA8 && !TextureFormat::compressed(baked.header->format)) {
+            std::cout << "Baked atlas format " << baked.header->format << " is not supported here" << std::endl;
+            return false;
+        }
+        width = (int)baked.header->width;
+        height = (int)baked.header->height;
+        alpha.clear();
+        if (baked.header->format == BAKED_RGBA8) {
+            alpha.resize((size_t)width * height);
+            for (size_t i = 0; i < alpha.size(); i++) {
+                alpha[i] = baked.levelData(0)[i * 4 + 3];
+            }
+        } else if (baked.header->format == BAKED_BC3) {
+            alpha.resize((size_t)width * height);
+            decompressBc3Alpha(baked.levelData(0), (uint32_t)width, (uint32_t)height, alpha.data());
+        }
+        regions.clear();
+        for (uint32_t i = 0; i < baked.header->regionCount; i++) {
+            const BakedRegion &r = baked.regions[i];
+            std::string name(r.name, strnlen(r.name, sizeof(r.name)));
+            regions[name] = glm::vec4(r.rect[0], r.rect[1], r.rect[2], r.rect[3]);
+        }
+        return true;
+    }
+
+    // True if the baked file exists and is newer than every PNG it was made from
+    static bool bakeIsCurrent(const std::string &directory, const std::string &baked) {
+        std::error_code ec;
+        auto bakedTime = std::filesystem::last_write_time(baked, ec);
+        if (ec) {
+            return false;
+        }
+        for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+            if (entry.path().extension() == ".png" && entry.last_write_time(ec) > bakedTime) {
+                return false;
+            }
+        }
+        return !ec;
+    }
+
+    // Decode and pack every .png in the directory into premultiplied RGBA8 pixels. Fills width,
+    // height and regions without touching GL, so the bake tool can use it too.
+    bool compose(const std::string &directory, std::vector<unsigned char> &pixels) {
+        std::vector<Image> images;
+        std::error_code ec;
+        for (const auto &entry : std::filesystem::directory_iterator(directory, ec)) {
+            if (entry.path().extension() != ".png") {
+                continue;
+            }
+            Image img = {entry.path().stem().string(), 0, 0, nullptr, 0, 0};
+            img.pixels = decodeImageFile(entry.path().string(), &img.w, &img.h);
+            if (!img.pixels) {
+                std::cout << "Failed to load texture " << entry.path().string() << std::endl;
+                continue;
+            }
+            premultiplyAlpha(img.pixels, (size_t)img.w * img.h);
+            images.push_back(img);
+        }
+        if (images.empty()) {
+            std::cout << "No textures found in " << directory << std::endl;
+            return false;
+        }
+        compose(images, pixels);
+        return true;
+    }
+
+    // The same for every .png in an asset pack, decoded straight from the mapping
+    bool compose(AssetPack &assets, std::vector<unsigned char> &pixels) {
+        std::vector<Image> images;
+        for (uint32_t i = 0; i < assets.count(); i++) {
+            const PackEntry &e = assets.entries[i];
+            std::string name = e.name;
+            if (name.size() < 4 || name.compare(name.size() - 4, 4, ".png") != 0) {
+                continue;
+            }
+            Image img = {name.substr(0, name.size() - 4), 0, 0, nullptr, 0, 0};
+            img.pixels = assets.loadImage(e, &img.w, &img.h);
+            if (!img.pixels) {
+                std::cout << "Failed to load texture " << name << " from the asset pack" << std::endl;
+                continue;
+            }
+            premultiplyAlpha(img.pixels, (size_t)img.w * img.h);
+            images.push_back(img);
+        }
+        if (images.empty()) {
+            std::cout << "No textures found in the asset pack" << std::endl;
+            return false;
+        }
+        compose(images, pixels);
+        return true;
+    }
+
+    // Pack decoded images and compose them into pixels, freeing each
+    void compose(std::vector<Image> &images, std::vector<unsigned char> &pixels) {
+        pack(images);
+
+        // Compose the atlas, extruding each image's edges into its padding
+        pixels.assign((size_t)width * height * 4, 0);
+        for (const Image &img : images) {
+            for (int y = -PADDING; y < img.h + PADDING; y++) {
+                int sy = std::min(std::max(y, 0), img.h - 1);
+                for (int x = -PADDING; x < img.w + PADDING; x++) {
+                    int sx = std::min(std::max(x, 0), img.w - 1);
+                    std::memcpy(&pixels[((size_t)(img.y + y) * width + (img.x + x)) * 4],
+                                &img.pixels[((size_t)sy * img.w + sx) * 4], 4);
+                }
+            }
+            regions[img.name] = glm::vec4((float)img.x / width, (float)img.y / height,
+                                          (float)img.w / width, (float)img.h / height);
+            stbi_image_free(img.pixels);
+        }
+        alpha.resize((size_t)width * height);
+        for (size_t i = 0; i < alpha.size(); i++) {
+            alpha[i] = pixels[i * 4 + 3];
+        }
+    }
+
+    // Create the atlas texture with storage for the given number of mip levels at the
+    // current size. Filtering and wrapping come from the sampler each draw binds; storing
+    // exactly these levels keeps the texture complete under either kind of filter.
+    void createTexture(int levelCount, GLenum internalFormat) {
+        levels = levelCount;
+        texID = createTexture2D();
+        textureStorage2D(texID, levels, internalFormat, width, height);
+        glMarkers.label(GL_TEXTURE, texID, "atlas");
+    }
+
+    // Filtering for the atlas as stored: nearest texels, plus nearest mips if baked with them
+    SamplerState samplerState() const {
+        SamplerState state;
+        state.minFilter = levels > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+        return state;
+    }
+
+    // UV rect of a packed image, or the whole atlas if the name is unknown
+    glm::vec4 region(const std::string &name) const {
+        auto it = regions.find(name);
+        if (it == regions.end()) {
+            std::cout << "Atlas has no region " << name << std::endl;
+            return glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+        }
+        return it->second;
+    }
+
+    // Opacity of a UV rect of the atlas sampled at w x h pixels; empty when the atlas
+    // kept no alpha (a BC7 bake)
+    AlphaMask alphaMask(const glm::vec4 &rect, int w, int h) const {
+        AlphaMask mask;
+        if (alpha.empty()) {
+            return mask;
+        }
+        int x = (int)std::lround(rect.x * width), y = (int)std::lround(rect.y * height);
+        int srcW = std::max((int)std::lround(rect.z * width), 1), srcH = std::max((int)std::lround(rect.w * height), 1);
+        mask.build(alpha.data(), width, x, y, srcW, srcH, w, h);
+        return mask;
+    }
+
+    // Collect a UV rect's visible texels into outline; nothing when no alpha was kept
+    void addOutline(const glm::vec4 &rect, SpriteOutline &outline) const {
+        if (alpha.empty()) {
+            return;
+        }
+        int x = (int)std::lround(rect.x * width), y = (int)std::lround(rect.y * height);
+        int w = std::max((int)std::lround(rect.z * width), 1), h = std::max((int)std::lround(rect.w * height), 1);
+        outline.add(alpha.data(), width, x, y, w, h);
+    }
+
+    // Shelf packing: tallest images first, left to right, new shelf when a row is full
+    void pack(std::vector<Image> &images) {
+        std::sort(images.begin(), images.end(),
+                  [](const Image &a, const Image &b) { return a.h > b.h; });
+
+        long long area = 0;
+        int widest = 0;
+        for (const Image &img : images) {
+            area += (long long)(img.w + 2 * PADDING) * (img.h + 2 * PADDING);
+            widest = std::max(widest, img.w + 2 * PADDING);
+        }
+        width = 1;
+        while ((long long)width * width < area || width < widest) {
+            width *= 2;
+        }
+
+        int x = 0, y = 0, shelfHeight = 0;
+        for (Image &img : images) {
+            int w = img.w + 2 * PADDING, h = img.h + 2 * PADDING;
+            if (x + w > width) {
+                x = 0;
+                y += shelfHeight;
+                shelfHeight = 0;
+            }
+            img.x = x + PADDING;
+            img.y = y + PADDING;
+            x += w;
+            shelfHeight = std::max(shelfHeight, h);
+        }
+        height = y + shelfHeight;
+    }
+
+    // Delete the atlas texture; must run while the context is still current
+    void release() {
+        memoryStats.untrackGl(GL_TEXTURE, texID);
+        glState.deleteTextures(1, &texID);
+        texID = 0;
+    }
+};
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <glad/glad.h>
+#include "baked_texture.h"
+#include "gl_extensions.h"
+
+#ifndef GL_RGB565
+#define GL_RGB565 0x8D62
+#endif
+
+// Sized internal format for uncompressed textures decoded as 8-bit RGBA, so VRAM use
+// does not depend on what the driver picks for an unsized GL_RGBA. Normally that is
+// GL_RGBA8. The low-memory mode (--texture-memory=low) halves it: GL_RGB565 when
+// every texel is opaque, GL_RGBA4 otherwise, with the driver converting at upload.
+// Block-compressed atlases keep their own format either way.
+struct TextureFormat {
+    bool lowMemory = false;
+
+    // The format to store width x height texels of rgba in
+    GLenum choose(const unsigned char *rgba, size_t texels) const {
+        if (!lowMemory) {
+            return GL_RGBA8;
+        }
+        for (size_t i = 0; i < texels; i++) {
+            if (rgba[i * 4 + 3] != 255) {
+                return GL_RGBA4;
+            }
+        }
+        return GL_RGB565;
+    }
+
+    // Bytes per texel of a format choose() returns
+    static int bytesPerTexel(GLenum format) {
+        return format == GL_RGBA8 ? 4 : 2;
+    }
+
+    // The GL format a block-compressed bake uploads as; 0 for RGBA8 bakes and for
+    // block formats the driver lacks the extension for
+    static GLenum compressed(uint32_t bakedFormat) {
+        switch (bakedFormat) {
+        case BAKED_BC3:
+            return glExt.textureCompressionS3tc ? GL_COMPRESSED_RGBA_S3TC_DXT5_EXT : 0;
+        case BAKED_BC7:
+            return glExt.textureCompressionBptc ? GL_COMPRESSED_RGBA_BPTC_UNORM : 0;
+        default:
+            return 0;
+        }
+    }
+};
+
+inline TextureFormat textureFormat;
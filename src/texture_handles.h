@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <glad/glad.h>
+#include "gl_extensions.h"
+
+// Resident ARB_bindless_texture handles, one per texture and sampler pair, made on
+// first use. A bindless sprite reads its texture from the handle in its instance, so
+// sprites with different textures share one draw. A handle freezes the parameters of
+// its texture and sampler, and a name can be reused once deleted, so glState drops a
+// name's handles before deleting it, and code that redefines a texture in place
+// calls forgetTextures() first. Off, nothing is ever stored and forgetting is free.
+struct TextureHandles {
+    bool enabled = false; // glExt.bindlessTexture, unless --bindless=0
+    std::unordered_map<uint64_t, GLuint64> handles; // texture << 32 | sampler -> resident handle
+
+    // The resident handle sampling texture through sampler (0: its own parameters)
+    GLuint64 get(GLuint texture, GLuint sampler) {
+        uint64_t key = (uint64_t)texture << 32 | sampler;
+        auto it = handles.find(key);
+        if (it != handles.end()) {
+            return it->second;
+        }
+        GLuint64 handle = sampler ? glExt.GetTextureSamplerHandle(texture, sampler) : glExt.GetTextureHandle(texture);
+        glExt.MakeTextureHandleResident(handle);
+        handles[key] = handle;
+        return handle;
+    }
+
+    void forgetTextures(GLsizei n, const GLuint *names) {
+        forget(n, names, 32);
+    }
+
+    void forgetSamplers(GLsizei n, const GLuint *names) {
+        forget(n, names, 0);
+    }
+
+    // Make every handle whose texture (shift 32) or sampler (shift 0) is listed non-resident
+    void forget(GLsizei n, const GLuint *names, int shift) {
+        for (auto it = handles.begin(); it != handles.end();) {
+            bool listed = false;
+            for (GLsizei i = 0; i < n && !listed; i++) {
+                listed = names[i] != 0 && (GLuint)(it->first >> shift) == names[i];
+            }
+            if (listed) {
+                glExt.MakeTextureHandleNonResident(it->second);
+                it = handles.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+};
+
+inline TextureHandles textureHandles;
@@ -0,0 +1,322 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <stb_image.h>
+#include "asset_pack.h"
+#include "gl_extensions.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "image_arena.h"
+#include "memory_stats.h"
+#include "premultiplied_alpha.h"
+#include "texture_format.h"
+#include "thread_config.h"
+
+// Loads textures without blocking the render thread. A background thread produces
+// RGBA8 pixels (decoding, packing, ...) and copies them into a pixel-unpack buffer
+// the render thread mapped for it; update() then uploads from that buffer a few rows
+// per frame, within a byte budget, so a large texture never causes a hitch. Until a
+// texture is complete its handle resolves to a shared 1x1 placeholder. Once ready,
+// the GL texture belongs to the caller.
+//
+// Given a hidden window whose context shares objects with the render thread's, the
+// loader thread instead makes that context current and creates and fills each
+// texture itself, then fences the upload; update() only polls the fence, without
+// waiting, and marks the texture ready once it has signalled. The render thread then
+// pays for no resource creation or upload at all. The loader thread goes straight
+// to GL there, never through glState, whose cache belongs to the render thread.
+struct TextureLoader {
+    // Fills pixels with width * height RGBA8 texels; runs on the loader thread
+    typedef std::function<bool(std::vector<unsigned char> &pixels, int &width, int &height)> Producer;
+
+    enum State {
+        QUEUED,    // waiting for the loader thread to produce pixels
+        PRODUCED,  // pixels ready; needs a mapped unpack buffer
+        MAPPED,    // unpack buffer mapped; the loader thread copies into it
+        FILLED,    // copy done; needs unmap
+        UPLOADING, // strips being uploaded across frames
+        FENCED,    // created and filled on the loader's context; waiting for its fence
+        READY,
+        FAILED
+    };
+
+    struct Request {
+        Producer produce;
+        State state = QUEUED;
+        std::vector<unsigned char> pixels;
+        int width = 0, height = 0;
+        GLenum format = GL_RGBA8; // textureFormat's pick, made on the loader thread from the pixels
+        GLuint pbo = 0, texID = 0;
+        GLsync fence = nullptr; // the loader context's upload, while FENCED
+        void *mapped = nullptr;
+        int rowsUploaded = 0;
+    };
+
+    // Bytes uploaded per update() call across all requests
+    static const size_t UPLOAD_BUDGET = 256 * 1024;
+
+    std::vector<std::unique_ptr<Request>> requests;
+    GLuint placeholder = 0;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread worker;
+    bool running = false;
+    ImageArena arena; // decoder scratch on the loader thread, reset after each request
+    GLFWwindow *context = nullptr; // hidden window sharing with the render context, when the loader uploads itself
+
+    // Create the placeholder and start the loader thread; needs a current context.
+    // With a shared context the loader thread creates and uploads every texture; the
+    // loader owns the window from here and destroys it in stop().
+    void start(GLFWwindow *sharedContext = nullptr) {
+        context = sharedContext;
+        const unsigned char grey[4] = {128, 128, 128, 255};
+        placeholder = createTexture2D();
+        textureParameter(placeholder, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        textureParameter(placeholder, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        textureStorage2D(placeholder, 1, GL_RGBA8, 1, 1);
+        textureSubImage2D(placeholder, 0, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+        memoryStats.trackGl(GL_TEXTURE, placeholder, MEM_TEXTURES, 4);
+        running = true;
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    // Queue a load and return its handle
+    int request(Producer produce) {
+        std::lock_guard<std::mutex> guard(lock);
+        requests.emplace_back(new Request());
+        requests.back()->produce = std::move(produce);
+        wake.notify_one();
+        return (int)requests.size() - 1;
+    }
+
+    // Queue a texture file, decoded with stb_image (from the asset pack if it holds
+    // the file) and premultiplied
+    int request(const std::string &path) {
+        return request([path](std::vector<unsigned char> &pixels, int &width, int &height) {
+            unsigned char *data = loadImage(path, &width, &height);
+            if (!data) {
+                return false;
+            }
+            premultiplyAlpha(data, (size_t)width * height);
+            pixels.assign(data, data + (size_t)width * height * 4);
+            stbi_image_free(data);
+            return true;
+        });
+    }
+
+    // The texture to bind for a handle: the real one once ready, else the placeholder
+    GLuint texture(int handle) {
+        std::lock_guard<std::mutex> guard(lock);
+        return requests[handle]->state == READY ? requests[handle]->texID : placeholder;
+    }
+
+    bool ready(int handle) {
+        std::lock_guard<std::mutex> guard(lock);
+        return requests[handle]->state == READY;
+    }
+
+    bool failed(int handle) {
+        std::lock_guard<std::mutex> guard(lock);
+        return requests[handle]->state == FAILED;
+    }
+
+    // Render thread, once per frame: advance every request by at most one GL step and
+    // upload strips until the byte budget is spent
+    void update(size_t budget = UPLOAD_BUDGET) {
+        std::unique_lock<std::mutex> guard(lock);
+        for (auto &r : requests) {
+            if (r->state == FENCED) {
+                GLenum status = glClientWaitSync(r->fence, 0, 0); // poll; never waits
+                if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED) {
+                    glDeleteSync(r->fence);
+                    r->fence = nullptr;
+                    memoryStats.trackGl(GL_TEXTURE, r->texID, MEM_TEXTURES,
+                                        textureBytes(r->width, r->height, TextureFormat::bytesPerTexel(r->format)));
+                    r->state = READY;
+                }
+            } else if (r->state == PRODUCED) {
+                size_t bytes = r->pixels.size();
+                r->pbo = createBuffer(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+                memoryStats.trackGl(GL_BUFFER, r->pbo, MEM_BUFFERS, (int64_t)bytes);
+                r->mapped = mapBufferRange(GL_PIXEL_UNPACK_BUFFER, r->pbo, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0); // a no-op under direct state access
+                r->state = r->mapped ? MAPPED : FAILED;
+                wake.notify_one();
+            } else if (r->state == FILLED) {
+                unmapBuffer(GL_PIXEL_UNPACK_BUFFER, r->pbo);
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                r->mapped = nullptr;
+
+                r->texID = createTexture2D();
+                textureParameter(r->texID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+                textureParameter(r->texID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+                textureParameter(r->texID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+                textureParameter(r->texID, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+                textureStorage2D(r->texID, 1, r->format, r->width, r->height);
+                memoryStats.trackGl(GL_TEXTURE, r->texID, MEM_TEXTURES,
+                                    textureBytes(r->width, r->height, TextureFormat::bytesPerTexel(r->format)));
+                r->state = UPLOADING;
+            }
+
+            if (r->state == UPLOADING && budget > 0) {
+                size_t rowBytes = (size_t)r->width * 4;
+                int rows = std::max(1, (int)std::min<size_t>(budget / rowBytes, (size_t)(r->height - r->rowsUploaded)));
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, r->pbo); // the source, even under direct state access
+                glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+                textureSubImage2D(r->texID, 0, 0, r->rowsUploaded, r->width, rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                                  (GLvoid*)(r->rowsUploaded * rowBytes));
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                r->rowsUploaded += rows;
+                budget -= std::min(budget, rows * rowBytes);
+                if (r->rowsUploaded >= r->height) {
+                    memoryStats.untrackGl(GL_BUFFER, r->pbo);
+                    glState.deleteBuffers(1, &r->pbo);
+                    r->pbo = 0;
+                    r->state = READY;
+                }
+            }
+        }
+    }
+
+    // Block until every request is ready or failed; for benchmarks and tools
+    void finish() {
+        while (true) {
+            update(SIZE_MAX);
+            std::unique_lock<std::mutex> guard(lock);
+            bool pending = false;
+            for (auto &r : requests) {
+                pending |= r->state != READY && r->state != FAILED;
+            }
+            if (!pending) {
+                return;
+            }
+            guard.unlock();
+            std::this_thread::yield();
+        }
+    }
+
+    // Stop the loader thread and delete the placeholder and unfinished uploads;
+    // ready textures are left to their owners
+    void stop() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            running = false;
+        }
+        wake.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        for (auto &r : requests) {
+            if (r->pbo) {
+                if (r->mapped) {
+                    unmapBuffer(GL_PIXEL_UNPACK_BUFFER, r->pbo);
+                }
+                glState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                memoryStats.untrackGl(GL_BUFFER, r->pbo);
+                glState.deleteBuffers(1, &r->pbo);
+            }
+            if (r->fence) {
+                glDeleteSync(r->fence);
+            }
+            if (r->state != READY && r->texID) {
+                memoryStats.untrackGl(GL_TEXTURE, r->texID);
+                glState.deleteTextures(1, &r->texID);
+            }
+        }
+        requests.clear();
+        if (context) {
+            glfwDestroyWindow(context); // the loader thread released it before exiting
+            context = nullptr;
+        }
+        memoryStats.untrackGl(GL_TEXTURE, placeholder);
+        glState.deleteTextures(1, &placeholder);
+        placeholder = 0;
+    }
+
+    // Loader thread: produce queued requests and fill mapped buffers, or upload them
+    // through the shared context
+    void workerLoop() {
+        configureThread(THREAD_IO, "texture loader");
+        MemoryScope memory(MEM_CPU_ASSETS);
+        if (context) {
+            glfwMakeContextCurrent(context);
+        }
+        std::unique_lock<std::mutex> guard(lock);
+        while (running) {
+            Request *work = nullptr;
+            for (auto &r : requests) {
+                if (r->state == QUEUED || r->state == MAPPED) {
+                    work = r.get();
+                    break;
+                }
+            }
+            if (!work) {
+                wake.wait(guard);
+                continue;
+            }
+
+            State state = work->state;
+            guard.unlock();
+            if (state == QUEUED) {
+                bool ok;
+                {
+                    ImageArenaScope scope(arena);
+                    ok = work->produce(work->pixels, work->width, work->height) && !work->pixels.empty();
+                }
+                if (ok) {
+                    work->format = textureFormat.choose(work->pixels.data(), (size_t)work->width * work->height);
+                }
+                arena.reset(); // the producer copied what it keeps into work->pixels
+                if (ok && context) {
+                    upload(*work);
+                }
+                guard.lock();
+                work->state = !ok ? FAILED : context ? FENCED : PRODUCED;
+            } else {
+                std::memcpy(work->mapped, work->pixels.data(), work->pixels.size());
+                std::vector<unsigned char>().swap(work->pixels);
+                guard.lock();
+                work->state = FILLED;
+            }
+        }
+        guard.unlock();
+        if (context) {
+            glfwMakeContextCurrent(nullptr); // so the render thread can destroy the window
+        }
+    }
+
+    // Loader thread, on the shared context: create the texture, upload it whole from
+    // the pixels and fence the upload. The flush puts the fence in the queue, so the
+    // render thread's poll sees it signal without this context doing anything more.
+    void upload(Request &r) {
+        glGenTextures(1, &r.texID);
+        glBindTexture(GL_TEXTURE_2D, r.texID);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        if (glExt.textureStorage) {
+            glExt.TexStorage2D(GL_TEXTURE_2D, 1, r.format, r.width, r.height);
+        } else {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+            glTexImage2D(GL_TEXTURE_2D, 0, r.format, r.width, r.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, r.width, r.height, GL_RGBA, GL_UNSIGNED_BYTE, r.pixels.data());
+        glBindTexture(GL_TEXTURE_2D, 0);
+        r.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        std::vector<unsigned char>().swap(r.pixels);
+    }
+};
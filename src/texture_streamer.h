@@ -0,0 +1,230 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glad/glad.h>
+#include "baked_texture.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "texture_format.h"
+
+// Baked textures kept in VRAM only as far as a residency budget allows. Each stays
+// mapped, and is uploaded from the mapping on demand: once used, the coarsest levels
+// come in first and finer ones follow over the next frames, at most UPLOAD_BUDGET
+// bytes a frame, until the level asked for is resident. Storage is immutable, so
+// changing which levels are resident means a new texture holding the chain from
+// that level down; texture() returns its name, which callers compare against the
+// one they hold. When a finer chain would go over the budget, textures not used
+// this frame are evicted least recently used first; if that is not enough, the
+// texture falls back to the finest coarser chain that fits, and tries again once
+// the budget frees up. Resident bytes are counted under MEM_STREAMED.
+struct TextureStreamer {
+    static const int64_t UPLOAD_BUDGET = 1024 * 1024; // bytes uploaded per update(); a coarsest level comes in regardless
+
+    struct Texture {
+        BakedTexture baked;
+        std::string name;
+        GLenum compressed = 0; // 0 for RGBA8 bakes
+        GLuint texID = 0;
+        int resident = -1;     // finest level stored, or -1 while evicted
+        int wanted = 0;        // finest level asked for
+        int64_t bytes = 0;
+        uint64_t lastUsed = 0; // frame of the last use(), 0 never
+    };
+
+    std::vector<std::unique_ptr<Texture>> textures; // by handle; null once released
+    int64_t budget = 0;   // resident bytes allowed across every texture
+    int64_t resident = 0;
+    uint64_t frame = 1;
+    uint64_t uploads = 0, evictions = 0, fallbacks = 0;
+
+    // Map a baked file; returns its handle, or -1 if it is missing, malformed or in a
+    // block format the driver lacks
+    int add(const std::string &path) {
+        std::unique_ptr<Texture> t(new Texture());
+        if (!t->baked.open(path)) {
+            return -1;
+        }
+        t->name = path;
+        return add(std::move(t));
+    }
+
+    // A baked container held in memory, such as an embedded asset
+    int addMemory(const unsigned char *bytes, size_t size, const std::string &name) {
+        std::unique_ptr<Texture> t(new Texture());
+        if (!t->baked.openMemory(bytes, size)) {
+            return -1;
+        }
+        t->name = name;
+        return add(std::move(t));
+    }
+
+    int add(std::unique_ptr<Texture> t) {
+        t->compressed = TextureFormat::compressed(t->baked.header->format);
+        if (t->baked.header->format != BAKED_RGBA8 && !t->compressed) {
+            std::cout << "Cannot stream " << t->name << ": format " << t->baked.header->format << " is not supported here"
+                      << std::endl;
+            return -1;
+        }
+        textures.push_back(std::move(t));
+        return (int)textures.size() - 1;
+    }
+
+    const BakedTexture &baked(int handle) const {
+        return textures[handle]->baked;
+    }
+
+    // Mark a texture used this frame, asking for level and coarser to be resident
+    void use(int handle, int level = 0) {
+        Texture &t = *textures[handle];
+        t.lastUsed = frame;
+        t.wanted = std::min(level, (int)t.baked.header->levelCount - 1);
+    }
+
+    // The texture's current name, 0 while it is evicted
+    GLuint texture(int handle) const {
+        return textures[handle]->texID;
+    }
+
+    // Levels the current texture holds
+    int levels(int handle) const {
+        const Texture &t = *textures[handle];
+        return t.resident < 0 ? 0 : (int)t.baked.header->levelCount - t.resident;
+    }
+
+    // Bytes of the chain from level down as baked: what it takes in VRAM, or at most
+    // that for RGBA8 bakes stored in a low-memory format
+    static int64_t chainBytes(const Texture &t, int level) {
+        int64_t bytes = 0;
+        for (uint32_t l = level; l < t.baked.header->levelCount; l++) {
+            bytes += (int64_t)t.baked.levels[l].bytes;
+        }
+        return bytes;
+    }
+
+    // Once per frame, after this frame's use() calls: bring the textures used this
+    // frame closer to the levels they asked for, then start the next frame
+    void update() {
+        int64_t uploadBudget = UPLOAD_BUDGET;
+        for (std::unique_ptr<Texture> &entry : textures) {
+            Texture *t = entry.get();
+            if (!t || t->lastUsed != frame || (t->resident >= 0 && t->resident <= t->wanted)) {
+                continue;
+            }
+            int coarsest = (int)t->baked.header->levelCount - 1;
+            int level = t->resident < 0 ? coarsest : t->resident;
+            while (level > t->wanted && chainBytes(*t, level - 1) <= uploadBudget) {
+                level--;
+            }
+            // The coarsest level is kept even over budget: a texture in use shows something
+            bool fellBack = false;
+            while (level < coarsest && !makeRoom(*t, chainBytes(*t, level))) {
+                level++;
+                fellBack = true;
+            }
+            if (t->resident < 0 || level < t->resident) {
+                fallbacks += fellBack;
+                uploadBudget -= chainBytes(*t, level);
+                upload(*t, level);
+            }
+        }
+        frame++;
+    }
+
+    // Evict textures not used this frame, least recently used first, until a chain of
+    // bytes fits in place of t's; false, evicting nothing, if even all of them would not do
+    bool makeRoom(const Texture &t, int64_t bytes) {
+        int64_t evictable = 0;
+        for (std::unique_ptr<Texture> &entry : textures) {
+            evictable += entry && entry.get() != &t && entry->lastUsed < frame ? entry->bytes : 0;
+        }
+        if (resident - t.bytes - evictable + bytes > budget) {
+            return false;
+        }
+        while (resident - t.bytes + bytes > budget) {
+            Texture *victim = nullptr;
+            for (std::unique_ptr<Texture> &entry : textures) {
+                Texture *other = entry.get();
+                if (other && other != &t && other->resident >= 0 && other->lastUsed < frame &&
+                    (!victim || other->lastUsed < victim->lastUsed)) {
+                    victim = other;
+                }
+            }
+            drop(*victim);
+            evictions++;
+        }
+        return true;
+    }
+
+    // Replace t's texture with one holding the chain from level down
+    void upload(Texture &t, int level) {
+        const BakedTexture &baked = t.baked;
+        const BakedLevel &top = baked.levels[level];
+        GLenum format = t.compressed ? t.compressed
+                                     : textureFormat.choose(baked.levelData(level), (size_t)top.width * top.height);
+        GLuint texID = createTexture2D();
+        int count = (int)baked.header->levelCount - level;
+        textureStorage2D(texID, count, format, top.width, top.height);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        int64_t bytes = 0;
+        for (int i = 0; i < count; i++) {
+            const BakedLevel &l = baked.levels[level + i];
+            bytes += t.compressed ? (int64_t)l.bytes : (int64_t)l.bytes / 4 * TextureFormat::bytesPerTexel(format);
+            if (t.compressed) {
+                compressedTextureSubImage2D(texID, i, 0, 0, l.width, l.height, t.compressed, (GLsizei)l.bytes,
+                                            baked.levelData(level + i));
+            } else {
+                textureSubImage2D(texID, i, 0, 0, l.width, l.height, GL_RGBA, GL_UNSIGNED_BYTE, baked.levelData(level + i));
+            }
+        }
+        if (t.texID) {
+            drop(t);
+        }
+        memoryStats.trackGl(GL_TEXTURE, texID, MEM_STREAMED, bytes);
+        t.texID = texID;
+        t.resident = level;
+        t.bytes = bytes;
+        resident += bytes;
+        uploads++;
+    }
+
+    // Delete t's texture, leaving it evicted
+    void drop(Texture &t) {
+        memoryStats.untrackGl(GL_TEXTURE, t.texID);
+        glState.deleteTextures(1, &t.texID);
+        resident -= t.bytes;
+        t.texID = 0;
+        t.resident = -1;
+        t.bytes = 0;
+    }
+
+    // Delete a texture and unmap its file; the handle is not reused
+    void release(int handle) {
+        if (textures[handle]->texID) {
+            drop(*textures[handle]);
+        }
+        textures[handle].reset();
+    }
+
+    // Must run while the context is still current
+    void releaseAll() {
+        for (size_t i = 0; i < textures.size(); i++) {
+            if (textures[i]) {
+                release((int)i);
+            }
+        }
+        textures.clear();
+    }
+
+    void print() const {
+        printf("Texture streaming: %.2f of %.2f MB resident, %llu uploads, %llu evictions, %llu fallbacks\n",
+               resident / 1048576.0, budget / 1048576.0, (unsigned long long)uploads, (unsigned long long)evictions,
+               (unsigned long long)fallbacks);
+    }
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <pthread.h>
+#ifdef __linux__
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#endif
+
+// What a thread does, which decides where it may run and how urgently
+enum ThreadRole {
+    THREAD_RENDER,     // the main thread: input, draw, present
+    THREAD_SIMULATION, // the fixed-rate tick
+    THREAD_AUDIO,      // the mixer feeding the device
+    THREAD_WORKER,     // job system workers and the wave stream
+    THREAD_IO,         // texture loading, score, telemetry, capture and network threads
+    THREAD_ROLE_COUNT
+};
+
+static const char *const THREAD_ROLE_NAMES[THREAD_ROLE_COUNT] = {"render", "simulation", "audio", "worker", "io"};
+
+// Names threads and places them: a core set and a priority per role, and on Windows
+// the MMCSS task that lets the scheduler boost the render and audio threads past
+// background load. Every thread calls configureThread(role, name) first thing; until
+// setup() has run (and in the headless tools, which never call it) that only names
+// the thread. By default, on four or more cores, render, audio and simulation each
+// get a core of their own and workers share the rest, so a burst of jobs cannot
+// preempt a frame or starve the mixer; I/O threads float at low priority. With fewer
+// cores nothing is pinned. Placement is best effort: calls the OS refuses (raising a
+// priority without the right, or a core the machine lacks) are counted and skipped.
+// Every configured thread is also registered, with what another thread needs to
+// stop it and read its stack, for the hang detector; the table is a ring, so
+// threads started again and again (the simulation, on restart) overwrite old ones.
+struct ThreadConfig {
+    static const uint32_t MAX_THREADS = 64;
+
+    struct Registered {
+        const char *name = nullptr;
+#ifdef _WIN32
+        HANDLE handle = nullptr; // suspend, resume and get-context rights
+#elif defined(__linux__)
+        pid_t tid = 0;
+#endif
+    };
+
+    struct Placement {
+        uint64_t cores = 0; // bit per core allowed; 0 leaves the OS to choose
+        int priority = 0;   // -2 lowest to 2 highest, 3 time critical; 0 is the default
+        const char *mmcss = nullptr; // Windows MMCSS task, or nullptr
+    };
+
+    Placement roles[THREAD_ROLE_COUNT];
+    bool enabled = false;
+    bool priorities = true;
+    unsigned coreCount = 1;
+    std::atomic<uint32_t> failures{0};
+    Registered threads[MAX_THREADS];
+    std::atomic<uint32_t> registered{0}; // threads ever registered
+
+    static uint64_t coreRange(unsigned first, unsigned last) {
+        uint64_t mask = 0;
+        for (unsigned c = first; c <= last && c < 64; c++) {
+            mask |= 1ull << c;
+        }
+        return mask;
+    }
+
+    // Default placement for a machine with cores cores
+    void setup(unsigned cores, bool setPriorities) {
+        enabled = true;
+        priorities = setPriorities;
+        coreCount = cores < 1 ? 1 : cores;
+        roles[THREAD_RENDER] = {0, 1, "Games"};
+        roles[THREAD_SIMULATION] = {0, 1, "Games"};
+        roles[THREAD_AUDIO] = {0, 3, "Pro Audio"};
+        roles[THREAD_WORKER] = {0, 0, nullptr};
+        roles[THREAD_IO] = {0, -1, nullptr};
+        if (coreCount >= 4) {
+            roles[THREAD_RENDER].cores = coreRange(0, 0);
+            roles[THREAD_AUDIO].cores = coreRange(1, 1);
+            roles[THREAD_SIMULATION].cores = coreRange(2, 2);
+            roles[THREAD_WORKER].cores = coreRange(3, coreCount - 1);
+        }
+    }
+
+    // Override core sets from "role:cores,role:cores", cores a core or a range like
+    // 2-7; false on an unknown role or a core past the machine's
+    bool parse(const char *list) {
+        while (*list) {
+            const char *colon = std::strchr(list, ':');
+            if (!colon) {
+                return false;
+            }
+            int role = -1;
+            for (int r = 0; r < THREAD_ROLE_COUNT; r++) {
+                if (std::strlen(THREAD_ROLE_NAMES[r]) == (size_t)(colon - list) &&
+                    std::strncmp(list, THREAD_ROLE_NAMES[r], colon - list) == 0) {
+                    role = r;
+                }
+            }
+            char *end;
+            unsigned first = (unsigned)std::strtoul(colon + 1, &end, 10), last = first;
+            if (*end == '-') {
+                last = (unsigned)std::strtoul(end + 1, &end, 10);
+            }
+            if (role < 0 || end == colon + 1 || last < first || last >= coreCount || last >= 64 || (*end && *end != ',')) {
+                return false;
+            }
+            roles[role].cores = coreRange(first, last);
+            list = *end ? end + 1 : end;
+        }
+        return true;
+    }
+
+    // One line per role for the startup log
+    std::string describe() const {
+        std::string text;
+        for (int r = 0; r < THREAD_ROLE_COUNT; r++) {
+            char part[64];
+            uint64_t mask = roles[r].cores;
+            int first = -1, last = -1;
+            for (int c = 0; c < 64; c++) {
+                if (mask >> c & 1) {
+                    first = first < 0 ? c : first;
+                    last = c;
+                }
+            }
+            if (first < 0) {
+                snprintf(part, sizeof(part), "%s any", THREAD_ROLE_NAMES[r]);
+            } else if (first == last) {
+                snprintf(part, sizeof(part), "%s core %d", THREAD_ROLE_NAMES[r], first);
+            } else {
+                snprintf(part, sizeof(part), "%s cores %d-%d", THREAD_ROLE_NAMES[r], first, last);
+            }
+            text += (r ? ", " : "") + std::string(part);
+        }
+        return text;
+    }
+
+    // Name the calling thread and, once set up, place it for its role
+    void apply(ThreadRole role, const char *name) {
+        registerCurrent(name);
+        nameCurrent(name);
+        if (!enabled) {
+            return;
+        }
+        const Placement &p = roles[role];
+        uint64_t cores = p.cores ? p.cores : coreRange(0, coreCount - 1); // explicit, as threads inherit their creator's set
+        bool ok = true;
+#ifdef _WIN32
+        ok &= SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cores) != 0;
+        if (priorities) {
+            static const int LEVELS[] = {THREAD_PRIORITY_LOWEST, THREAD_PRIORITY_BELOW_NORMAL, THREAD_PRIORITY_NORMAL,
+                                         THREAD_PRIORITY_ABOVE_NORMAL, THREAD_PRIORITY_HIGHEST, THREAD_PRIORITY_TIME_CRITICAL};
+            ok &= SetThreadPriority(GetCurrentThread(), LEVELS[p.priority + 2]) != 0;
+        }
+        if (priorities && p.mmcss) {
+            // avrt.dll is looked up at run time, so the build needs no extra import library
+            using AvSet = HANDLE(WINAPI *)(LPCSTR, LPDWORD);
+            static HMODULE avrt = LoadLibraryA("avrt.dll");
+            AvSet set = avrt ? (AvSet)(void *)GetProcAddress(avrt, "AvSetMmThreadCharacteristicsA") : nullptr;
+            DWORD index = 0;
+            ok &= set && set(p.mmcss, &index) != nullptr;
+        }
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (unsigned c = 0; c < 64; c++) {
+            if (cores >> c & 1) {
+                CPU_SET(c, &set);
+            }
+        }
+        ok &= pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+        if (priorities) {
+            // Per-thread nice value; raising one needs CAP_SYS_NICE or an rlimit
+            ok &= setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), -5 * p.priority) == 0;
+        }
+#endif
+        if (!ok) {
+            failures.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void registerCurrent(const char *name) {
+        Registered &r = threads[registered.fetch_add(1, std::memory_order_acq_rel) % MAX_THREADS];
+#ifdef _WIN32
+        if (r.handle) {
+            CloseHandle(r.handle);
+        }
+        r.handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT | THREAD_QUERY_INFORMATION, FALSE,
+                              GetCurrentThreadId());
+#elif defined(__linux__)
+        r.tid = (pid_t)syscall(SYS_gettid);
+#endif
+        r.name = name;
+    }
+
+    static void nameCurrent(const char *name) {
+#ifdef _WIN32
+        using SetDescription = HRESULT(WINAPI *)(HANDLE, PCWSTR);
+        static SetDescription describe =
+            (SetDescription)(void *)GetProcAddress(GetModuleHandleA("kernel32.dll"), "SetThreadDescription");
+        if (describe) {
+            wchar_t wide[64];
+            size_t i = 0;
+            for (; name[i] && i < 63; i++) {
+                wide[i] = (wchar_t)name[i];
+            }
+            wide[i] = 0;
+            describe(GetCurrentThread(), wide);
+        }
+#elif defined(__APPLE__)
+        pthread_setname_np(name);
+#else
+        char shortName[16]; // the kernel keeps 15 characters
+        snprintf(shortName, sizeof(shortName), "%s", name);
+        pthread_setname_np(pthread_self(), shortName);
+#endif
+    }
+};
+
+inline ThreadConfig threadConfig;
+
+inline void configureThread(ThreadRole role, const char *name) {
+    threadConfig.apply(role, name);
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include "thread_config.h"
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <csignal>
+#include <execinfo.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+#endif
+
+// The stack of another thread configureThread registered, read while it runs, for
+// the hang detector and the sampling profiler. On Linux the thread is sent SIGNAL
+// and records its own stack from the handler, innermost frame first, the handler's
+// own frames dropped; on 64-bit Windows it is suspended and unwound from its
+// context with the unwind tables, no dbghelp needed. Elsewhere, or for a thread that
+// does not answer within the wait, there is no stack. One capture runs at a time,
+// as the handler has one slot to fill. The time the thread was kept from its own
+// work, the handler's run or the suspension, is measured for the sampling profiler.
+struct ThreadStacks {
+    static const int MAX_DEPTH = 64;
+#ifndef _WIN32
+    static const int SIGNAL = SIGUSR2;
+    static const int HANDLER_FRAMES = 2; // recordStack and the kernel's signal trampoline
+#endif
+
+    static inline std::mutex lock;
+    static inline std::once_flag installed;
+    static inline void *signalFrames[MAX_DEPTH + 2];
+    static inline std::atomic<int> signalDepth{-1};
+    static inline double signalSeconds = 0.0; // the handler's own time, published with signalDepth
+
+    // Before the first capture, from a thread that may allocate
+    static void install() {
+#ifndef _WIN32
+        std::call_once(installed, [] {
+            // backtrace() loads its unwinder on first use, which may allocate: not in a handler
+            void *frames[1];
+            backtrace(frames, 1);
+            struct sigaction action {};
+            action.sa_handler = recordStack;
+            sigemptyset(&action.sa_mask);
+            action.sa_flags = SA_RESTART;
+            sigaction(SIGNAL, &action, nullptr);
+        });
+#endif
+    }
+
+    // Up to maxDepth of r's frames into frames, or -1 if it has exited, is this
+    // thread or does not answer within wait seconds; stopped, if given, gets the
+    // seconds r spent stopped. Nothing here allocates while r is stopped, so r may be
+    // inside the allocator.
+    static int capture(const ThreadConfig::Registered &r, void **frames, int maxDepth, double wait,
+                       double *stopped = nullptr) {
+        std::lock_guard<std::mutex> guard(lock);
+#ifdef _WIN32
+        (void)wait;
+        DWORD exitCode = 0;
+        if (!r.handle || !GetExitCodeThread(r.handle, &exitCode) || exitCode != STILL_ACTIVE ||
+            GetThreadId(r.handle) == GetCurrentThreadId()) {
+            return -1;
+        }
+        auto suspended = std::chrono::steady_clock::now();
+        if (SuspendThread(r.handle) == (DWORD)-1) {
+            return -1;
+        }
+        int depth = 0;
+        CONTEXT context = {};
+        context.ContextFlags = CONTEXT_FULL;
+        if (GetThreadContext(r.handle, &context)) {
+#if defined(_M_X64) || defined(__x86_64__)
+            while (depth < maxDepth && context.Rip) {
+                frames[depth++] = (void *)context.Rip;
+                DWORD64 imageBase = 0;
+                PRUNTIME_FUNCTION function = RtlLookupFunctionEntry(context.Rip, &imageBase, nullptr);
+                if (!function) {
+                    context.Rip = *(DWORD64 *)context.Rsp; // a leaf: the return address is on top
+                    context.Rsp += 8;
+                    continue;
+                }
+                void *handlerData = nullptr;
+                DWORD64 establisher = 0;
+                RtlVirtualUnwind(UNW_FLAG_NHANDLER, imageBase, context.Rip, function, &context, &handlerData, &establisher,
+                                 nullptr);
+            }
+#else
+            frames[depth++] = (void *)(uintptr_t)context.Eip;
+#endif
+        }
+        ResumeThread(r.handle);
+        if (stopped) {
+            *stopped = std::chrono::duration<double>(std::chrono::steady_clock::now() - suspended).count();
+        }
+        return depth;
+#elif defined(__linux__)
+        if (!r.tid || r.tid == (pid_t)syscall(SYS_gettid)) {
+            return -1;
+        }
+        signalDepth.store(-1, std::memory_order_relaxed);
+        if (syscall(SYS_tgkill, getpid(), r.tid, SIGNAL) != 0) {
+            return -1; // exited
+        }
+        // Delivery to a running thread takes microseconds, so spin first
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                                std::chrono::duration<double>(wait));
+        int depth;
+        for (int spins = 0; (depth = signalDepth.load(std::memory_order_acquire)) < 0; spins++) {
+            if (std::chrono::steady_clock::now() >= deadline) {
+                signalDepth.store(MAX_DEPTH + 2, std::memory_order_relaxed); // a late answer records nothing
+                return -1;
+            }
+            if (spins < 1000) {
+                std::this_thread::yield();
+            } else {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        }
+        if (stopped) {
+            *stopped = signalSeconds;
+        }
+        depth = depth > HANDLER_FRAMES ? depth - HANDLER_FRAMES : 0;
+        depth = depth < maxDepth ? depth : maxDepth;
+        for (int f = 0; f < depth; f++) {
+            frames[f] = signalFrames[f + HANDLER_FRAMES];
+        }
+        return depth;
+#else
+        (void)r;
+        (void)frames;
+        (void)maxDepth;
+        (void)wait;
+        (void)stopped;
+        return -1;
+#endif
+    }
+
+#ifndef _WIN32
+    // Runs on the signalled thread, inside whatever it was doing
+    static void recordStack(int) {
+        if (signalDepth.load(std::memory_order_relaxed) < 0) {
+            auto begin = std::chrono::steady_clock::now(); // clock_gettime, safe in a handler
+            int depth = backtrace(signalFrames, MAX_DEPTH + HANDLER_FRAMES);
+            signalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            signalDepth.store(depth, std::memory_order_release);
+        }
+    }
+#endif
+};
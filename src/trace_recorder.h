@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Records timed spans and writes them as Chrome trace event JSON, which
+// chrome://tracing and ui.perfetto.dev both open. Used for the startup timeline:
+// the clock starts at static initialisation, spans are recorded up to the first
+// swap, and write() then dumps the file and stops recording. Any thread may record.
+struct TraceRecorder {
+    struct Event {
+        const char *name; // string literal or otherwise static
+        char phase;       // 'X' complete span, 'i' instant
+        double start, duration; // microseconds since origin
+        uint32_t thread;
+    };
+
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    std::string path;
+    std::atomic<bool> enabled{false};
+    std::vector<Event> events;
+    std::map<std::thread::id, uint32_t> threads; // small ids in first-seen order
+    std::vector<std::string> threadNames;
+    std::mutex lock;
+
+    // Start recording; an empty path leaves the recorder off
+    void start(const std::string &tracePath) {
+        path = tracePath;
+        enabled = !path.empty();
+    }
+
+    double now() const {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+    }
+
+    // Label the calling thread in the trace viewer
+    void nameThread(const char *name) {
+        if (!enabled) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        threadNames[threadId()] = name;
+    }
+
+    void span(const char *name, double start, double end) {
+        if (!enabled) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        events.push_back({name, 'X', start, end - start, threadId()});
+    }
+
+    void instant(const char *name) {
+        if (!enabled) {
+            return;
+        }
+        double t = now();
+        std::lock_guard<std::mutex> guard(lock);
+        events.push_back({name, 'i', t, 0.0, threadId()});
+    }
+
+    // Write the trace file and stop recording; returns false if it could not be written
+    bool write() {
+        if (!enabled) {
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(lock);
+        enabled = false;
+        FILE *out = std::fopen(path.c_str(), "w");
+        if (!out) {
+            return false;
+        }
+        std::fprintf(out, "{\"traceEvents\":[\n");
+        for (size_t i = 0; i < threadNames.size(); i++) {
+            std::fprintf(out, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}},\n",
+                         (unsigned)i, threadNames[i].c_str());
+        }
+        for (size_t i = 0; i < events.size(); i++) {
+            const Event &e = events[i];
+            std::fprintf(out, "{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"%c\",\"ts\":%.3f,", e.name, e.phase, e.start);
+            if (e.phase == 'X') {
+                std::fprintf(out, "\"dur\":%.3f,", e.duration);
+            } else {
+                std::fprintf(out, "\"s\":\"p\",");
+            }
+            std::fprintf(out, "\"pid\":1,\"tid\":%u}%s\n", e.thread, i + 1 < events.size() ? "," : "");
+        }
+        std::fprintf(out, "],\"displayTimeUnit\":\"ms\"}\n");
+        return std::fclose(out) == 0;
+    }
+
+    // Caller holds lock
+    uint32_t threadId() {
+        auto it = threads.find(std::this_thread::get_id());
+        if (it != threads.end()) {
+            return it->second;
+        }
+        uint32_t id = (uint32_t)threads.size();
+        threads[std::this_thread::get_id()] = id;
+        threadNames.push_back(id == 0 ? "main" : "thread " + std::to_string(id));
+        return id;
+    }
+};
+
+inline TraceRecorder startupTrace;
+
+// Records a span covering the scope's lifetime
+struct TraceScope {
+    const char *name;
+    double start;
+
+    explicit TraceScope(const char *spanName) : name(spanName), start(startupTrace.enabled ? startupTrace.now() : 0.0) {
+    }
+
+    ~TraceScope() {
+        if (startupTrace.enabled) {
+            startupTrace.span(name, start, startupTrace.now());
+        }
+    }
+};
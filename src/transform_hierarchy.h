@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+#include "generational_handle.h"
+
+// A 2D placement: offset, rotation in degrees counter-clockwise and uniform scale
+struct Transform2D {
+    glm::vec2 position = glm::vec2(0.0f);
+    float angle = 0.0f;
+    float scale = 1.0f;
+
+    bool operator==(const Transform2D &other) const {
+        return position == other.position && angle == other.angle && scale == other.scale;
+    }
+};
+
+// Parent-relative placements for things carried by an entity: an attachment's local
+// transform is set once, and its world transform follows the parent's. Flat SoA
+// arrays sorted by depth (roots, then their children, then theirs), so a parent
+// always comes before its children. Setting a local transform only marks the node
+// when it actually changed; update() is one linear pass that recomputes the marked
+// nodes and everything below them, reading each parent's world transform and the
+// cosine and sine of its angle as they were just written, then clears the marks.
+// Nothing else is recomputed, so a hierarchy that sat still costs one pass over its
+// parent indices and marks. Nodes are stable generational handles over dense indices, like EntityPool:
+// creating one opens a slot at the end of its depth's range by moving the first node
+// of every deeper range to its end, and destroying one fills its hole the same way
+// backwards, repointing the children of every node that moves.
+struct TransformHierarchy {
+    static constexpr uint32_t INVALID = UINT32_MAX;
+    static const int MAX_DEPTH = 8;
+
+    std::vector<float> localX, localY, localAngle, localScale;
+    std::vector<float> worldX, worldY, worldAngle, worldScale, worldCos, worldSin;
+    std::vector<uint32_t> parent; // dense index, or INVALID for a root
+    std::vector<uint8_t> dirty;
+    std::vector<uint32_t> handleOf; // dense index -> handle
+    std::vector<uint32_t> indexOf;  // handle's slot -> generation and dense index, or next free slot
+    uint32_t freeHead = INVALID;    // first free slot
+    uint32_t depthStart[MAX_DEPTH + 1] = {}; // first index per depth, then size()
+    uint32_t updated = 0; // nodes the last update() recomputed
+
+    size_t size() const {
+        return parent.size();
+    }
+
+    void reserve(size_t capacity) {
+        for (std::vector<float> *field : {&localX, &localY, &localAngle, &localScale, &worldX, &worldY, &worldAngle, &worldScale,
+                                          &worldCos, &worldSin}) {
+            field->reserve(capacity);
+        }
+        parent.reserve(capacity);
+        dirty.reserve(capacity);
+        handleOf.reserve(capacity);
+        indexOf.reserve(capacity);
+    }
+
+    // Dense index of a live node
+    uint32_t index(uint32_t handle) const {
+        return handleIndex(indexOf[handleIndex(handle)]);
+    }
+
+    // False once the node is destroyed, even after its slot went to another
+    bool alive(uint32_t handle) const {
+        uint32_t s = handleIndex(handle);
+        return handle != INVALID && s < indexOf.size() && sameGeneration(indexOf[s], handle) && index(handle) < size() &&
+               handleOf[index(handle)] == handle;
+    }
+
+    int depthOf(uint32_t i) const {
+        int d = 0;
+        while (depthStart[d + 1] <= i) {
+            d++;
+        }
+        return d;
+    }
+
+    // A node placed by local relative to parentHandle, or a root when that is INVALID;
+    // returns INVALID past MAX_DEPTH
+    uint32_t create(uint32_t parentHandle, const Transform2D &local) {
+        uint32_t parentIndex = parentHandle == INVALID ? INVALID : index(parentHandle);
+        int depth = parentIndex == INVALID ? 0 : depthOf(parentIndex) + 1;
+        if (depth >= MAX_DEPTH) {
+            return INVALID;
+        }
+        uint32_t s;
+        if (freeHead != INVALID) {
+            s = freeHead;
+            uint32_t next = handleIndex(indexOf[s]);
+            freeHead = next == HANDLE_INDEX_MASK ? INVALID : next;
+        } else {
+            s = (uint32_t)indexOf.size();
+            indexOf.push_back(0);
+        }
+        uint32_t handle = withIndex(indexOf[s], s);
+
+        for (std::vector<float> *field : {&localX, &localY, &localAngle, &localScale, &worldX, &worldY, &worldAngle, &worldScale,
+                                          &worldCos, &worldSin}) {
+            field->push_back(0.0f);
+        }
+        parent.push_back(INVALID);
+        dirty.push_back(0);
+        handleOf.push_back(INVALID);
+        uint32_t slot = (uint32_t)size() - 1;
+        depthStart[MAX_DEPTH]++;
+        for (int d = MAX_DEPTH - 1; d > depth; d--) {
+            if (depthStart[d] != slot) {
+                move(depthStart[d], slot);
+            }
+            slot = depthStart[d]++;
+        }
+
+        localX[slot] = local.position.x;
+        localY[slot] = local.position.y;
+        localAngle[slot] = local.angle;
+        localScale[slot] = local.scale;
+        parent[slot] = parentIndex;
+        dirty[slot] = 1;
+        handleOf[slot] = handle;
+        indexOf[s] = withIndex(handle, slot);
+        return handle;
+    }
+
+    // Remove a node and everything attached below it
+    void destroy(uint32_t handle) {
+        uint32_t i = index(handle);
+        int depth = depthOf(i);
+        if (depth + 1 < MAX_DEPTH) {
+            for (uint32_t c = depthStart[depth + 1]; c < depthStart[depth + 2];) {
+                if (parent[c] == i) {
+                    destroy(handleOf[c]); // refills c, and never moves i: only deeper nodes move
+                } else {
+                    c++;
+                }
+            }
+        }
+        uint32_t hole = i;
+        for (int d = depth; d < MAX_DEPTH; d++) {
+            uint32_t last = depthStart[d + 1] - 1;
+            if (last != hole) {
+                move(last, hole);
+            }
+            hole = last;
+            depthStart[d + 1]--;
+        }
+        for (std::vector<float> *field : {&localX, &localY, &localAngle, &localScale, &worldX, &worldY, &worldAngle, &worldScale,
+                                          &worldCos, &worldSin}) {
+            field->pop_back();
+        }
+        parent.pop_back();
+        dirty.pop_back();
+        handleOf.pop_back();
+        uint32_t s = handleIndex(handle);
+        indexOf[s] = retiredEntry(indexOf[s], handleIndex(freeHead));
+        freeHead = s;
+    }
+
+    // Copy the node at from into slot to, repointing its handle and its children
+    void move(uint32_t from, uint32_t to) {
+        localX[to] = localX[from]; localY[to] = localY[from];
+        localAngle[to] = localAngle[from]; localScale[to] = localScale[from];
+        worldX[to] = worldX[from]; worldY[to] = worldY[from];
+        worldAngle[to] = worldAngle[from]; worldScale[to] = worldScale[from];
+        worldCos[to] = worldCos[from]; worldSin[to] = worldSin[from];
+        parent[to] = parent[from];
+        dirty[to] = dirty[from];
+        handleOf[to] = handleOf[from];
+        uint32_t s = handleIndex(handleOf[to]);
+        indexOf[s] = withIndex(indexOf[s], to);
+        int depth = depthOf(from);
+        if (depth + 1 < MAX_DEPTH) {
+            for (uint32_t c = depthStart[depth + 1]; c < depthStart[depth + 2]; c++) {
+                if (parent[c] == from) {
+                    parent[c] = to;
+                }
+            }
+        }
+    }
+
+    // Place a node relative to its parent; marks it only when that changes anything
+    void setLocal(uint32_t handle, const Transform2D &transform) {
+        uint32_t i = index(handle);
+        if (transform == local(handle)) {
+            return;
+        }
+        localX[i] = transform.position.x;
+        localY[i] = transform.position.y;
+        localAngle[i] = transform.angle;
+        localScale[i] = transform.scale;
+        dirty[i] = 1;
+    }
+
+    Transform2D local(uint32_t handle) const {
+        uint32_t i = index(handle);
+        return {glm::vec2(localX[i], localY[i]), localAngle[i], localScale[i]};
+    }
+
+    // As of the last update()
+    Transform2D world(uint32_t handle) const {
+        uint32_t i = index(handle);
+        return {glm::vec2(worldX[i], worldY[i]), worldAngle[i], worldScale[i]};
+    }
+
+    // Recompute the world transforms of marked nodes and their descendants
+    void update() {
+        const uint32_t count = (uint32_t)size();
+        const float RADIANS = 3.14159265f / 180.0f;
+        uint32_t recomputed = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t p = parent[i];
+            dirty[i] |= p != INVALID && dirty[p]; // the parent's mark is final: it came first
+            if (!dirty[i]) {
+                continue;
+            }
+            recomputed++;
+            if (p == INVALID) {
+                worldX[i] = localX[i];
+                worldY[i] = localY[i];
+                worldAngle[i] = localAngle[i];
+                worldScale[i] = localScale[i];
+            } else {
+                float x = localX[i] * worldScale[p], y = localY[i] * worldScale[p];
+                worldX[i] = worldX[p] + x * worldCos[p] - y * worldSin[p];
+                worldY[i] = worldY[p] + x * worldSin[p] + y * worldCos[p];
+                worldAngle[i] = worldAngle[p] + localAngle[i];
+                worldScale[i] = worldScale[p] * localScale[i];
+            }
+            worldCos[i] = std::cos(worldAngle[i] * RADIANS);
+            worldSin[i] = std::sin(worldAngle[i] * RADIANS);
+        }
+        std::fill(dirty.begin(), dirty.end(), 0);
+        updated = recomputed;
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free single-producer/single-consumer triple buffer. The producer always owns
+// one slot to write, the consumer one slot to read, and the third holds the most
+// recently published value. Publishing and acquiring are one atomic exchange each,
+// so neither side ever waits for the other and the consumer always sees the latest
+// complete value.
+template <typename T>
+struct TripleBuffer {
+    static const uint8_t FRESH = 0x4; // set on the middle index when it holds an unread value
+
+    T slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0;  // producer's slot
+    uint8_t front = 2; // consumer's slot
+
+    // Producer: the slot to fill before publish()
+    T &writeSlot() {
+        return slots[back];
+    }
+
+    // Producer: hand the written slot over and take the old middle one to write next
+    void publish() {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 0x3;
+    }
+
+    // Consumer: swap in the newest published value if there is one; returns true if it changed
+    bool acquire() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH)) {
+            return false;
+        }
+        front = middle.exchange(front, std::memory_order_acq_rel) & 0x3;
+        return true;
+    }
+
+    // Consumer: the latest value acquired
+    const T &readSlot() const {
+        return slots[front];
+    }
+};
@@ -0,0 +1,246 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "draw_list.h"
+#include "game_rules.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+#include "perf_overlay.h"
+#include "sdf_font.h"
+#include "shader_program.h"
+#include "sprite_batch.h"
+#include "texture_handles.h"
+
+// Retained-mode UI for screens that sit still most of the time: the pause screen,
+// game over and the leaderboard. Nodes are panels (a solid swatch of the overlay's
+// texture) and text lines, positioned relative to their parent, with children
+// after their parents. Each node owns a fixed range of SpriteInstances in one
+// persistent GL buffer: panels at the front, glyphs behind them. Changing a node
+// only marks it, and showing, hiding or moving one marks its subtree; draw()
+// rebuilds the marked nodes' instances, uploads the one span of the buffer they
+// cover, and draws the panels and then the text, each in a single instanced draw
+// of its whole section. Hidden nodes keep their slots as zero-size instances. A
+// frame where nothing changed uploads nothing, and one with nothing shown draws nothing.
+struct UiTree {
+    static const int MAX_NODES = 64;
+    static const int MAX_PANELS = 16;
+    static const int MAX_TEXT = 32; // characters per text node
+    static const int MAX_GLYPHS = 512;
+
+    enum Kind : uint8_t { PANEL, TEXT };
+
+    struct Node {
+        Kind kind;
+        bool visible;
+        bool dirty;
+        uint8_t swatch;  // panels: PerfOverlay::Swatch
+        int parent;      // -1 for a root
+        glm::vec2 position; // top-left corner, down and right of the parent's; roots from the playfield's
+        glm::vec2 size;     // panels only
+        float scale;        // text: playfield units per font pixel
+        uint32_t first;     // first instance in the buffer
+        char text[MAX_TEXT + 1];
+    };
+
+    struct Section {
+        ShaderProgram *program;
+        GLuint texture, sampler;
+    };
+
+    std::vector<Node> nodes;           // reserved at setup, never reallocated
+    std::vector<SpriteInstance> shadow; // CPU copy of the buffer
+    GLuint buffer = 0;
+    Section panels = {}, glyphs = {};
+    bool sdf = false; // text rects into SdfFont's texture
+    uint32_t panelCount = 0, glyphCount = 0; // slots handed out per section
+    uint32_t dirtyNodes = 0;
+    bool empty = true; // nothing shown: draw() issues no draws
+    uint64_t uploads = 0, uploadedBytes = 0, rebuilt = 0;
+
+    // panelProgram draws the overlay's texture; textProgram draws textTexture, the
+    // overlay's or, with sdfText, SdfFont's with the SDF variant
+    void setup(ShaderProgram *panelProgram, GLuint overlayTexture, GLuint panelSampler, ShaderProgram *textProgram,
+               GLuint textTexture, GLuint textSampler, bool sdfText) {
+        nodes.reserve(MAX_NODES);
+        shadow.assign(MAX_PANELS + MAX_GLYPHS, makeSpriteInstance(glm::vec2(0.0f), glm::vec2(0.0f), 0.0f, glm::vec4(0.0f)));
+        GLsizeiptr bytes = (GLsizeiptr)(shadow.size() * sizeof(SpriteInstance));
+        buffer = createBuffer(GL_ARRAY_BUFFER, bytes, shadow.data(), GL_DYNAMIC_DRAW);
+        memoryStats.trackGl(GL_BUFFER, buffer, MEM_BUFFERS, bytes);
+        panels = {panelProgram, overlayTexture, panelSampler};
+        glyphs = {textProgram, textTexture, textSampler};
+        sdf = sdfText;
+    }
+
+    // Add a panel or a line of text; returns the node, or -1 when the tree or its section is full
+    int panel(int parent, const glm::vec2 &position, const glm::vec2 &size, PerfOverlay::Swatch swatch) {
+        if (nodes.size() == MAX_NODES || panelCount == MAX_PANELS) {
+            return -1;
+        }
+        nodes.push_back({PANEL, true, true, (uint8_t)swatch, parent, position, size, 0.0f, panelCount++, {}});
+        dirtyNodes++;
+        return (int)nodes.size() - 1;
+    }
+
+    int text(int parent, const glm::vec2 &position, float scale, const char *s = "") {
+        if (nodes.size() == MAX_NODES || glyphCount + MAX_TEXT > MAX_GLYPHS) {
+            return -1;
+        }
+        nodes.push_back({TEXT, true, true, 0, parent, position, glm::vec2(0.0f), scale, MAX_PANELS + glyphCount, {}});
+        glyphCount += MAX_TEXT;
+        dirtyNodes++;
+        setText((int)nodes.size() - 1, s);
+        return (int)nodes.size() - 1;
+    }
+
+    // Change a text node; a no-op when the text is the same
+    void setText(int node, const char *s) {
+        Node &n = nodes[node];
+        if (std::strncmp(n.text, s, MAX_TEXT) != 0) {
+            std::strncpy(n.text, s, MAX_TEXT);
+            n.text[MAX_TEXT] = 0;
+            markDirty(node, false);
+        }
+    }
+
+    void setVisible(int node, bool visible) {
+        if (nodes[node].visible != visible) {
+            nodes[node].visible = visible;
+            markDirty(node, true);
+        }
+    }
+
+    void move(int node, const glm::vec2 &position) {
+        if (nodes[node].position != position) {
+            nodes[node].position = position;
+            markDirty(node, true);
+        }
+    }
+
+    void markDirty(int node, bool subtree) {
+        for (int i = node; i < (int)nodes.size(); i++) {
+            if (i == node || (subtree && descends(i, node))) {
+                dirtyNodes += !nodes[i].dirty;
+                nodes[i].dirty = true;
+            }
+        }
+    }
+
+    bool descends(int node, int ancestor) const {
+        for (int p = nodes[node].parent; p >= 0; p = nodes[p].parent) {
+            if (p == ancestor) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Shown, and every ancestor shown too
+    bool shown(int node) const {
+        for (int i = node; i >= 0; i = nodes[i].parent) {
+            if (!nodes[i].visible) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    glm::vec2 origin(int node) const {
+        glm::vec2 p(0.0f, (float)HEIGHT);
+        for (int i = node; i >= 0; i = nodes[i].parent) {
+            p += glm::vec2(nodes[i].position.x, -nodes[i].position.y);
+        }
+        return p;
+    }
+
+    // Rebuild the marked nodes' instances and upload the span they cover, in the
+    // batch's instance layout
+    void update(const SpriteBatch &batch) {
+        if (dirtyNodes == 0) {
+            return;
+        }
+        uint32_t low = UINT32_MAX, high = 0;
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            Node &n = nodes[i];
+            if (!n.dirty) {
+                continue;
+            }
+            uint32_t slots = n.kind == PANEL ? 1 : MAX_TEXT;
+            rebuild(i);
+            low = std::min(low, n.first);
+            high = std::max(high, n.first + slots);
+            n.dirty = false;
+            rebuilt++;
+        }
+        dirtyNodes = 0;
+        empty = true;
+        for (int i = 0; i < (int)nodes.size() && empty; i++) {
+            empty = !shown(i);
+        }
+        GLsizeiptr bytes = (GLsizeiptr)(high - low) * batch.stride();
+        bufferSubData(GL_ARRAY_BUFFER, buffer, low * batch.stride(), bytes, batch.encode(&shadow[low], high - low));
+        uploads++;
+        uploadedBytes += bytes;
+    }
+
+    void rebuild(int node) {
+        const Node &n = nodes[node];
+        bool visible = shown(node);
+        glm::vec2 corner = origin(node);
+        SpriteInstance hidden = makeSpriteInstance(glm::vec2(0.0f), glm::vec2(0.0f), 0.0f, glm::vec4(0.0f));
+        if (n.kind == PANEL) {
+            shadow[n.first] = visible ? makeSpriteInstance(corner + glm::vec2(n.size.x, -n.size.y) * 0.5f, n.size, 0.0f,
+                                                           PerfOverlay::cellRect(PerfOverlay::SWATCH_CELL + n.swatch))
+                                      : hidden;
+            stampHandle(shadow[n.first], panels);
+            return;
+        }
+        float w = PerfOverlay::GLYPH_WIDTH * n.scale, h = PerfOverlay::CELL * n.scale;
+        int length = (int)std::strlen(n.text);
+        for (int c = 0; c < MAX_TEXT; c++) {
+            char g = c < length ? PerfOverlay::glyphOf(n.text[c]) : ' ';
+            size_t slot = n.first + c;
+            if (!visible || g == ' ') {
+                shadow[slot] = hidden;
+            } else {
+                glm::vec2 centre(corner.x + c * w + w / 2, corner.y - h / 2);
+                shadow[slot] = makeSpriteInstance(centre, glm::vec2(w, h), 0.0f,
+                                                  sdf ? SdfFont::glyphRect(g) : PerfOverlay::glyphRect(g));
+            }
+            stampHandle(shadow[slot], glyphs);
+        }
+    }
+
+    // Bindless programs read the texture from the instance, which SpriteBatch would
+    // otherwise fill in at submit
+    static void stampHandle(SpriteInstance &instance, const Section &section) {
+        if (section.program && section.program->bindless) {
+            GLuint64 handle = textureHandles.get(section.texture, section.sampler);
+            instance.texture = glm::uvec2((uint32_t)handle, (uint32_t)(handle >> 32));
+        }
+    }
+
+    // Panels, then text over them: two draws
+    void draw(SpriteBatch &batch) {
+        update(batch);
+        if (empty) {
+            return;
+        }
+        batch.drawRetained(buffer, 0, (GLsizei)panelCount, panels.program, panels.texture, panels.sampler);
+        batch.drawRetained(buffer, MAX_PANELS, (GLsizei)glyphCount, glyphs.program, glyphs.texture, glyphs.sampler);
+    }
+
+    void release() {
+        if (!buffer) {
+            return;
+        }
+        memoryStats.untrackGl(GL_BUFFER, buffer);
+        glState.deleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+};
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "lockfree_queue.h"
+#include "memory_stats.h"
+#include "thread_config.h"
+
+// Raw frames streamed into an external encoder's stdin (ffmpeg by default) from a
+// writer thread of its own. The render thread only copies a mapped frame into a
+// recycled buffer and queues it; the pipe write, which blocks whenever the encoder
+// is busy, happens on the writer. Frames go to the writer and their buffers come
+// back through two SpscQueues, so neither thread ever waits on a lock held by the
+// other; the writer only sleeps on wake while it has nothing to write. Once
+// QUEUE_LIMIT frames are waiting, new ones
+// are dropped and counted instead of queued, so a slow encoder costs frames, never
+// frame time. The encoder is started with the first frame, which fixes the size:
+// frames of any other size (after a window resize) are dropped too.
+struct VideoPipe {
+    static const uint32_t QUEUE_LIMIT = 8; // power of two
+
+    struct Frame {
+        std::vector<uint8_t> pixels; // BGRA, bottom row first
+        int width = 0, height = 0;
+    };
+
+    std::string encoder, output;
+    double fps = 60.0;
+    FILE *pipe = nullptr; // writer thread only
+    int width = 0, height = 0; // size of the stream, once the first frame has fixed it
+
+    std::thread writer;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+    SpscQueue<Frame, QUEUE_LIMIT> queue;                         // render thread to writer
+    SpscQueue<std::vector<uint8_t>, 2 * QUEUE_LIMIT> spare;      // written frames' buffers back, for reuse
+    std::atomic<bool> running{false};
+    std::atomic<bool> broken{false}; // the encoder could not be started or stopped reading
+
+    // Statistics
+    uint64_t submitted = 0, dropped = 0, resized = 0;
+    std::atomic<uint64_t> written{0}; // by the writer
+
+    // Encode into output at rate frames per second with the given encoder executable
+    void start(const std::string &encoderPath, const std::string &outputPath, double rate) {
+        encoder = encoderPath;
+        output = outputPath;
+        fps = rate;
+#ifndef _WIN32
+        std::signal(SIGPIPE, SIG_IGN); // an encoder that exits early fails the write instead
+#endif
+        running = true;
+        writer = std::thread([this] { writerLoop(); });
+    }
+
+    bool active() const {
+        return writer.joinable();
+    }
+
+    // Render thread: queue a copy of a mapped frame, or drop it if the writer is behind
+    void submit(const void *pixels, int w, int h) {
+        submitted++;
+        if (width == 0) {
+            width = w;
+            height = h;
+        }
+        if (w != width || h != height) {
+            resized++;
+            return;
+        }
+        if (queue.full() || broken) {
+            dropped++;
+            return;
+        }
+        std::vector<uint8_t> buffer;
+        spare.pop(buffer); // a recycled buffer if there is one
+        size_t bytes = (size_t)w * h * 4;
+        {
+            MemoryScope memory(MEM_CPU_TOOLS);
+            buffer.resize(bytes);
+        }
+        std::memcpy(buffer.data(), pixels, bytes);
+        queue.push({std::move(buffer), w, h});
+        wake.notify_one();
+    }
+
+    // Write out what is queued, close the encoder's stdin and wait for it to finish
+    void stop() {
+        if (!active()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        writer.join();
+        std::printf("video: %llu frames to %s, %llu dropped behind the encoder, %llu dropped after a resize%s\n",
+                    (unsigned long long)written.load(), output.c_str(), (unsigned long long)dropped,
+                    (unsigned long long)resized, broken ? " (encoder failed)" : "");
+    }
+
+    // Command line for a raw BGRA stream of the fixed size; GL rows are bottom-up
+    std::string command() const {
+        char format[128];
+        std::snprintf(format, sizeof(format), " -loglevel error -y -f rawvideo -pix_fmt bgra -s %dx%d -r %g -i - ",
+                      width, height, fps);
+        return "\"" + encoder + "\"" + format + "-vf vflip -pix_fmt yuv420p \"" + output + "\"";
+    }
+
+    void writerLoop() {
+        configureThread(THREAD_IO, "video writer");
+        for (;;) {
+            Frame frame;
+            bool stopping = !running; // read first: everything submitted before stop() is then in the queue
+            if (!queue.pop(frame)) {
+                if (stopping) {
+                    break;
+                }
+                // A notify can slip in between the check and the wait; the timeout bounds the delay
+                std::unique_lock<std::mutex> guard(wakeLock);
+                wake.wait_for(guard, std::chrono::milliseconds(20), [this] { return queue.size() > 0 || !running; });
+                continue;
+            }
+            if (!pipe && !broken) {
+#ifdef _WIN32
+                pipe = _popen(command().c_str(), "wb");
+#else
+                pipe = popen(command().c_str(), "w");
+#endif
+            }
+            bool ok = pipe && std::fwrite(frame.pixels.data(), 1, frame.pixels.size(), pipe) == frame.pixels.size();
+            if (ok) {
+                written++;
+            } else {
+                broken = true; // everything from here on is dropped at submit
+            }
+            spare.push(std::move(frame.pixels)); // freed here instead if the spares are full
+        }
+        if (pipe) {
+#ifdef _WIN32
+            _pclose(pipe);
+#else
+            pclose(pipe);
+#endif
+            pipe = nullptr;
+        }
+    }
+};
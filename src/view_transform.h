@@ -0,0 +1,206 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "gl_extensions.h"
+#include "gl_markers.h"
+#include "gl_objects.h"
+#include "gl_state.h"
+#include "memory_stats.h"
+
+// Maps the fixed logical playfield into whatever framebuffer the window has. The
+// playfield keeps its aspect ratio and is scaled to the largest viewport that fits,
+// centred, with black bars on the other axis. The projection, viewport and frame
+// clock live in one uniform buffer bound at BINDING, shared by every program that
+// declares the View block, so a resize or a new frame is one buffer update rather
+// than a uniform per program.
+//
+// Split-screen puts views copies of the playfield side by side, each with its own
+// projection, and fits their combined width instead. Between beginViews() and
+// endViews() a draw reaches all of them: with viewport arrays, the VIEWS sprite
+// variants send each instance to every viewport in one instanced draw and
+// instancedViews() tells the batch how many copies to make; every other program, and
+// every program without the extension, draws through eachView() once per view.
+// Offscreen targets and post passes keep seeing one region spanning all views.
+struct ViewTransform {
+    static const GLuint BINDING = 0;
+    static const int MAX_VIEWS = 2;
+
+    // clock.y repeats after this many seconds; the time is wrapped in double precision
+    // so shaders that only need periodic motion never lose float precision
+    static constexpr double CLOCK_PERIOD = 2000.0;
+
+    // std140 layout of the View block
+    struct Block {
+        glm::mat4 projection;
+        glm::vec4 viewport;
+        glm::vec4 logical;
+        glm::vec4 clock; // x = simulated seconds, y = x wrapped to CLOCK_PERIOD, z = frame index mod 2^24
+        glm::mat4 projections[MAX_VIEWS]; // per view, for the VIEWS variants
+        glm::vec4 split; // x = views one instanced draw reaches
+    };
+
+    float logicalWidth = 0.0f, logicalHeight = 0.0f;
+    int framebufferWidth = 0, framebufferHeight = 0;
+    int x = 0, y = 0, width = 0, height = 0; // letterboxed viewport in pixels
+    glm::vec4 clock = glm::vec4(0.0f);
+    GLuint buffer = 0;
+    int views = 1;           // side-by-side views of the playfield; set before setup()
+    bool singlePass = false; // one instanced draw reaches every view; set before setup()
+    glm::mat4 projections[MAX_VIEWS];
+    bool splitting = false;           // between beginViews() and endViews()
+    mutable glm::vec4 region = glm::vec4(0.0f); // the viewport last set, spanning every view
+
+    void setup(float playfieldWidth, float playfieldHeight) {
+        logicalWidth = playfieldWidth;
+        logicalHeight = playfieldHeight;
+        views = std::clamp(views, 1, MAX_VIEWS);
+        singlePass = singlePass && views > 1 && glExt.viewportLayerArray;
+        for (glm::mat4 &p : projections) {
+            p = glm::ortho(0.0f, logicalWidth, 0.0f, logicalHeight, -1.0f, 1.0f);
+        }
+        buffer = createBuffer(GL_UNIFORM_BUFFER, sizeof(Block), nullptr, GL_DYNAMIC_DRAW);
+        memoryStats.trackGl(GL_BUFFER, buffer, MEM_BUFFERS, sizeof(Block));
+        glMarkers.label(GL_BUFFER, buffer, "view block");
+        glState.bindBufferBase(GL_UNIFORM_BUFFER, BINDING, buffer);
+    }
+
+    // Point a linked program's View block at the shared buffer; GL 4.0 shaders
+    // cannot name the binding themselves
+    static void bindProgram(GLuint program) {
+        GLuint index = glGetUniformBlockIndex(program, "View");
+        if (index != GL_INVALID_INDEX) {
+            glUniformBlockBinding(program, index, BINDING);
+        }
+    }
+
+    // Fit the playfield into a framebuffer of the given pixel size and upload the
+    // result. A zero-sized framebuffer (minimized) keeps the previous view.
+    void resize(int fbWidth, int fbHeight) {
+        if (fbWidth <= 0 || fbHeight <= 0) {
+            return;
+        }
+        framebufferWidth = fbWidth;
+        framebufferHeight = fbHeight;
+        float scale = std::min(fbWidth / (logicalWidth * views), fbHeight / logicalHeight);
+        width = std::max(1, (int)std::lround(logicalWidth * views * scale));
+        height = std::max(1, (int)std::lround(logicalHeight * scale));
+        x = (fbWidth - width) / 2;
+        y = (fbHeight - height) / 2;
+        region = glm::vec4(x, y, width, height);
+        glViewport(x, y, width, height);
+
+        Block block;
+        block.projection = glm::ortho(0.0f, logicalWidth, 0.0f, logicalHeight, -1.0f, 1.0f);
+        block.viewport = glm::vec4(x, y, width, height);
+        block.logical = glm::vec4(logicalWidth, logicalHeight, 0.0f, 0.0f);
+        block.clock = clock;
+        for (int v = 0; v < MAX_VIEWS; v++) {
+            block.projections[v] = projections[v];
+        }
+        block.split = glm::vec4(1.0f, 0.0f, 0.0f, 0.0f);
+        bufferSubData(GL_UNIFORM_BUFFER, buffer, 0, sizeof(Block), &block);
+    }
+
+    // Draw the playfield into the bottom-left w x h pixels of another target
+    void drawInto(int w, int h) const {
+        setViewport(glm::vec4(0.0f, 0.0f, w, h));
+    }
+
+    // Back to the letterboxed viewport of the framebuffer
+    void apply() const {
+        setViewport(glm::vec4(x, y, width, height));
+    }
+
+    // Publish the time a frame is drawn at, once before its first draw
+    void setClock(double seconds, uint64_t frame) {
+        clock = glm::vec4((float)seconds, (float)std::fmod(seconds, CLOCK_PERIOD), (float)(frame & 0xFFFFFF), 0.0f);
+        bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, clock), sizeof(clock), &clock);
+    }
+
+    void setViewport(const glm::vec4 &viewport) const {
+        region = viewport;
+        place(viewport);
+    }
+
+    // View v's share of the current region, in pixels
+    glm::vec4 viewRect(int v) const {
+        float w = region.z / views;
+        return glm::vec4(region.x + w * v, region.y, w, region.w);
+    }
+
+    // Copies of each instance the sprite batch draws for the views
+    int instancedViews() const {
+        return splitting && singlePass ? views : 1;
+    }
+
+    // Start drawing into every view of the current region
+    void beginViews() {
+        if (views < 2) {
+            return;
+        }
+        splitting = true;
+        if (singlePass) {
+            spread();
+            glm::vec4 split((float)views, 0.0f, 0.0f, 0.0f);
+            bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, split), sizeof(split), &split);
+        }
+    }
+
+    // Back to one viewport over the whole region
+    void endViews() {
+        if (!splitting) {
+            return;
+        }
+        splitting = false;
+        place(region);
+        glm::vec4 split(1.0f, 0.0f, 0.0f, 0.0f);
+        bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, split), sizeof(split), &split);
+    }
+
+    // Run draw once per view for programs that draw into viewport 0 with the shared
+    // projection; just once outside beginViews()
+    template <typename Draw>
+    void eachView(Draw draw) const {
+        if (!splitting) {
+            draw();
+            return;
+        }
+        for (int v = 0; v < views; v++) {
+            place(viewRect(v));
+            bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, projection), sizeof(glm::mat4), &projections[v]);
+            draw();
+        }
+        glm::mat4 shared = glm::ortho(0.0f, logicalWidth, 0.0f, logicalHeight, -1.0f, 1.0f);
+        bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, projection), sizeof(shared), &shared);
+        place(region);
+        if (singlePass) {
+            spread();
+        }
+    }
+
+    // glViewport sets every viewport of the array to the same rectangle
+    void place(const glm::vec4 &viewport) const {
+        glViewport((GLint)viewport.x, (GLint)viewport.y, (GLsizei)viewport.z, (GLsizei)viewport.w);
+        bufferSubData(GL_UNIFORM_BUFFER, buffer, offsetof(Block, viewport), sizeof(viewport), &viewport);
+    }
+
+    // Viewport v of the array to view v
+    void spread() const {
+        for (int v = 0; v < views; v++) {
+            glm::vec4 r = viewRect(v);
+            glExt.ViewportIndexedf((GLuint)v, r.x, r.y, r.z, r.w);
+        }
+    }
+
+    void release() {
+        memoryStats.untrackGl(GL_BUFFER, buffer);
+        glState.deleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+
+// Fixed pool of coroutine frames for wave scripts. Every script frame comes from
+// here through the promise's operator new, so starting, suspending and finishing a
+// script never touches the heap. A frame larger than BLOCK_SIZE, or a start with
+// every block in use, fails: the script is not created and the failure is counted.
+// Used from one thread at a time: scripts are created before the simulation starts
+// and destroyed by the tick that finishes them.
+struct WaveScriptPool {
+    static const size_t BLOCK_SIZE = 512;
+    static const int BLOCKS = 32;
+
+    alignas(std::max_align_t) unsigned char blocks[BLOCKS][BLOCK_SIZE];
+    uint8_t freeList[BLOCKS];
+    int freeCount = -1; // -1 until the free list is first filled
+    int peak = 0;
+    uint32_t failures = 0;
+
+    void *allocate(size_t size) {
+        if (freeCount < 0) {
+            for (int i = 0; i < BLOCKS; i++) {
+                freeList[i] = (uint8_t)(BLOCKS - 1 - i);
+            }
+            freeCount = BLOCKS;
+        }
+        if (size > BLOCK_SIZE || freeCount == 0) {
+            failures++;
+            return nullptr;
+        }
+        void *frame = blocks[freeList[--freeCount]];
+        peak = std::max(peak, BLOCKS - freeCount);
+        return frame;
+    }
+
+    void release(void *frame) {
+        freeList[freeCount++] = (uint8_t)(((unsigned char *)frame - blocks[0]) / BLOCK_SIZE);
+    }
+};
+
+inline WaveScriptPool waveScriptPool;
+
+// A spawn pattern written as sequential code: a coroutine that spawns comets and
+// co_awaits waitFor() between them. Scripts start suspended and only run when the
+// WaveScheduler resumes them from a simulation tick. Move-only; the owner destroys
+// the frame.
+struct WaveScript {
+    struct promise_type {
+        double wake = 0.0;  // simulated seconds at which the script runs next
+        uint32_t order = 0; // start order, so scripts due together run in a fixed order
+
+        static void *operator new(size_t size) noexcept {
+            return waveScriptPool.allocate(size);
+        }
+
+        static void operator delete(void *frame, size_t) noexcept {
+            waveScriptPool.release(frame);
+        }
+
+        static WaveScript get_return_object_on_allocation_failure() {
+            return WaveScript();
+        }
+
+        WaveScript get_return_object() {
+            return WaveScript(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+    };
+
+    using Handle = std::coroutine_handle<promise_type>;
+
+    Handle handle;
+
+    WaveScript() = default;
+    explicit WaveScript(Handle h) : handle(h) {}
+    WaveScript(WaveScript &&other) noexcept : handle(other.handle) {
+        other.handle = nullptr;
+    }
+    WaveScript &operator=(WaveScript &&other) noexcept {
+        std::swap(handle, other.handle);
+        return *this;
+    }
+    WaveScript(const WaveScript &) = delete;
+    WaveScript &operator=(const WaveScript &) = delete;
+
+    ~WaveScript() {
+        if (handle) {
+            handle.destroy();
+        }
+    }
+
+    // Hand the frame over to the caller
+    Handle release() {
+        Handle h = handle;
+        handle = nullptr;
+        return h;
+    }
+};
+
+// Suspends a script for the given simulated seconds, counted from when it was due
+// rather than from the tick that resumed it, so waits never drift
+struct WaveWait {
+    double seconds;
+
+    bool await_ready() const noexcept {
+        return false;
+    }
+
+    void await_suspend(WaveScript::Handle script) const noexcept {
+        script.promise().wake += seconds;
+    }
+
+    void await_resume() const noexcept {}
+};
+
+inline WaveWait waitFor(double seconds) {
+    return {std::max(seconds, 0.0)};
+}
+
+// Runs wave scripts from the fixed-step simulation. Suspended scripts wait in a
+// min-heap ordered by wake time, so a tick costs one comparison while none is due:
+// idle scripts are never polled. A script that awaits zero seconds runs again in
+// the same tick.
+struct WaveScheduler {
+    static const int MAX_SCRIPTS = 16;
+
+    WaveScript::Handle queue[MAX_SCRIPTS];
+    int count = 0;
+    uint32_t started = 0, finished = 0;
+
+    // Take a script over, to run first at the given simulated time; false if it could not be created or there is no room
+    bool start(WaveScript script, double at = 0.0) {
+        if (!script.handle || count == MAX_SCRIPTS) {
+            return false;
+        }
+        WaveScript::Handle h = script.release();
+        h.promise().wake = at;
+        h.promise().order = started++;
+        queue[count++] = h;
+        std::push_heap(queue, queue + count, later);
+        return true;
+    }
+
+    // Simulation: run every script due at or before until, in wake order
+    void resume(double until) {
+        while (count > 0 && queue[0].promise().wake <= until) {
+            std::pop_heap(queue, queue + count, later);
+            WaveScript::Handle h = queue[--count];
+            h.resume();
+            if (h.done()) {
+                h.destroy();
+                finished++;
+            } else {
+                queue[count++] = h;
+                std::push_heap(queue, queue + count, later);
+            }
+        }
+    }
+
+    // Destroy every script still running
+    void clear() {
+        while (count > 0) {
+            queue[--count].destroy();
+        }
+    }
+
+    static bool later(WaveScript::Handle a, WaveScript::Handle b) {
+        const WaveScript::promise_type &pa = a.promise(), &pb = b.promise();
+        return pa.wake > pb.wake || (pa.wake == pb.wake && pa.order > pb.order);
+    }
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include "lockfree_queue.h"
+#include "thread_config.h"
+
+// One comet to release, at a time in simulated seconds
+struct WaveSpawn {
+    double time;
+    float speed; // pixels per second
+    uint8_t lane;
+};
+
+// Spawns generated ahead of the simulation on a worker thread and handed over
+// through an SpscQueue, so neither decoding a level nor rolling random waves
+// ever runs inside a tick. The worker stays LOOKAHEAD simulated seconds ahead of
+// what the simulation last asked for. A tick that asks for spawns the worker has not
+// produced yet waits for them rather than going without, so what spawns on a tick
+// never depends on thread timing.
+struct WaveStream {
+    static const uint32_t CAPACITY = 1024; // power of two
+    static constexpr double LOOKAHEAD = 5.0;
+
+    // Worker side: writes the next spawn in time order, or returns false once there are no more
+    typedef std::function<bool(WaveSpawn &)> Source;
+
+    SpscQueue<WaveSpawn, CAPACITY> spawns; // worker to simulation
+    std::atomic<double> generated{0.0}; // every spawn earlier than this has been pushed
+    std::atomic<double> demand{0.0};    // latest time the simulation asked for
+    std::atomic<bool> running{false};
+    std::atomic<bool> refill{false};    // the simulation has used half the lookahead
+    std::atomic<uint32_t> stalls{0};    // pops that had to wait for the worker
+    Source source;
+    std::thread worker;
+    std::mutex wakeLock;
+    std::condition_variable wake;
+
+    // Start from an empty queue; after stop() too, with a source moved on to where
+    // the simulation now is
+    void start(Source spawnSource) {
+        WaveSpawn stale;
+        while (spawns.pop(stale)) {
+        }
+        generated = demand = 0.0;
+        source = std::move(spawnSource);
+        running = true;
+        worker = std::thread([this] { workerLoop(); });
+    }
+
+    void stop() {
+        if (!running) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(wakeLock);
+            running = false;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    // Simulation: take the oldest spawn due at or before until, false when none is due
+    bool popUntil(double until, WaveSpawn &spawn) {
+        demand.store(until, std::memory_order_relaxed);
+        if (generated.load(std::memory_order_relaxed) - until < LOOKAHEAD / 2 && !refill.exchange(true)) {
+            wake.notify_one(); // early, so a simulation running faster than real time rarely waits
+        }
+        for (;;) {
+            double ready = generated.load(std::memory_order_acquire); // before the ring, see below
+            if (const WaveSpawn *oldest = spawns.front()) {
+                if (oldest->time > until) {
+                    return false;
+                }
+                spawn = *oldest;
+                spawns.popFront();
+                return true;
+            }
+            // Empty: everything pushed before ready was read is consumed, so nothing
+            // due is missing once the worker has generated past until
+            if (ready > until || !running) {
+                return false;
+            }
+            stalls.fetch_add(1, std::memory_order_relaxed);
+            wake.notify_one();
+            std::this_thread::yield();
+        }
+    }
+
+    void workerLoop() {
+        configureThread(THREAD_WORKER, "wave stream");
+        WaveSpawn next;
+        bool exhausted = false;
+        while (running) {
+            refill = false;
+            while (!exhausted && !spawns.full() &&
+                   generated.load(std::memory_order_relaxed) <= demand.load(std::memory_order_relaxed) + LOOKAHEAD) {
+                if (!source(next)) {
+                    exhausted = true;
+                    generated.store(std::numeric_limits<double>::infinity(), std::memory_order_release);
+                    break;
+                }
+                spawns.push(next);
+                generated.store(next.time, std::memory_order_release);
+            }
+            std::unique_lock<std::mutex> lock(wakeLock);
+            wake.wait_for(lock, std::chrono::milliseconds(20), [this] { return !running || refill; });
+        }
+    }
+};